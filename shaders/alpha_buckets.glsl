@@ -0,0 +1,45 @@
+#ifndef ALPHA_BUCKETS_GLSL
+#define ALPHA_BUCKETS_GLSL
+
+// Alpha-mode buckets of the culling phases (see ComputeCulling.h). Masked items go to
+// the second half of the phase's list, at params.maskedBase, counted after the opaque
+// counters; blended items go to the transparent list with a key for
+// sort_transparent.comp. The includer declares
+// `params` (CullParams), `stats`, ObjectData and VkDrawIndexedIndirectCommand first
+// and defines TRANSPARENT_BINDING, the first of three consecutive set 0 bindings.
+
+const uint OBJ_ALPHA_MASK  = 1u;   // GPUObjectData::flags, see IndirectRenderer.h
+const uint OBJ_ALPHA_BLEND = 2u;
+
+const uint STAT_MASKED_DRAWS      = 7;
+const uint STAT_TRANSPARENT_DRAWS = 8;
+
+const uint TRANSPARENT_SORT_MAX = 2048u;   // ComputeCulling::TRANSPARENT_SORT_MAX
+
+layout(std430, set = 0, binding = TRANSPARENT_BINDING) writeonly buffer TransparentScratch {
+    VkDrawIndexedIndirectCommand transparentCmds[];   // list order
+};
+
+layout(std430, set = 0, binding = TRANSPARENT_BINDING + 1) writeonly buffer TransparentKeys {
+    uint transparentKeys[];
+};
+
+layout(std430, set = 0, binding = TRANSPARENT_BINDING + 2) buffer TransparentCount {
+    uint transparentCountOut[2];   // per index class
+};
+
+// The key is the view distance of the bounds' center with its low bits replaced by
+// the slot: sorting keys sorts by distance, and the slot finds the draw again
+void EmitTransparent(ObjectData obj, vec3 worldMin, vec3 worldMax, VkDrawIndexedIndirectCommand cmd) {
+    uint cls  = obj.indexClass;
+    uint base = cls == 0 ? 0 : params.uint32ClassBase;
+    uint slot = atomicAdd(transparentCountOut[cls], 1);
+    transparentCmds[base + slot] = cmd;
+    if (slot < TRANSPARENT_SORT_MAX) {
+        float dist = length((worldMin + worldMax) * 0.5 - params.cameraPosition.xyz);
+        transparentKeys[base + slot] = (floatBitsToUint(dist) & ~(TRANSPARENT_SORT_MAX - 1u)) | slot;
+    }
+    atomicAdd(stats[STAT_TRANSPARENT_DRAWS], 1);
+}
+
+#endif
@@ -1,3 +1,42 @@
 #version 460
+#extension GL_EXT_nonuniform_qualifier : enable
 
-void main() {}
+// Occluder depth. The opaque pipeline's fragment stage does nothing; the masked
+// variant (ALPHA_MODE 1) alpha-tests like pbr_indirect.frag so cutouts leave holes
+// in the depth and Hi-Z the later passes see.
+
+layout(location = 2) in vec2 fragTexCoord;
+layout(location = 5) flat in uint fragMaterialIndex;
+
+layout(set = 0, binding = 0) uniform sampler2D textures[];
+
+struct MaterialParams {
+    vec4  baseColorFactor;
+    float metallicFactor;
+    float roughnessFactor;
+    uint  baseColorTexIdx;
+    uint  normalTexIdx;
+    uint  metallicRoughnessTexIdx;
+    uint  aoTexIdx;
+    uint  emissiveTexIdx;
+    float alphaCutoff;
+    uint  alphaMode;       // 0 opaque, 1 mask, 2 blend
+    uint  _pad0;
+    uint  _pad1;
+    uint  _pad2;
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer MaterialSSBO {
+    MaterialParams materials[];
+};
+
+layout(constant_id = 1) const uint ALPHA_MODE = 0;
+
+void main() {
+    if (ALPHA_MODE == 1u) {
+        MaterialParams mat = materials[fragMaterialIndex];
+        float alpha = mat.baseColorFactor.a *
+            texture(textures[nonuniformEXT(mat.baseColorTexIdx)], fragTexCoord).a;
+        if (alpha < mat.alphaCutoff) discard;
+    }
+}
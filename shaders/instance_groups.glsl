@@ -0,0 +1,45 @@
+#ifndef INSTANCE_GROUPS_GLSL
+#define INSTANCE_GROUPS_GLSL
+
+// Instanced draws of the culling phases (see IndirectRenderer::GetGroupBuffer). Opaque
+// and masked objects sharing a (mesh, material) have one command per LOD level, reset to
+// no instances every frame; a surviving object bumps its level's instanceCount and lists
+// its slot at that command's firstInstance + count. Phase two uses its own commands at
+// params.groupPhaseBase. The includer declares `params` (CullParams), `stats` and
+// VkDrawIndexedIndirectCommand first and defines INSTANCE_GROUP_BINDING, the first of
+// three consecutive set 0 bindings.
+
+const uint INSTANCE_LIST_BIT = 0x80000000u;   // IndirectRenderer.h
+const uint NO_GROUP          = 0xFFFFFFFFu;   // IndirectRenderer::INVALID_GROUP
+
+const uint STAT_INSTANCED_DRAWS = 9;
+const uint STAT_INSTANCES       = 10;
+
+layout(std430, set = 0, binding = INSTANCE_GROUP_BINDING) buffer GroupIndirect {
+    VkDrawIndexedIndirectCommand groupCmds[];   // phase one, then phase two at params.groupPhaseBase
+};
+
+layout(std430, set = 0, binding = INSTANCE_GROUP_BINDING + 1) writeonly buffer InstanceList {
+    uint instanceObjects[];
+};
+
+layout(std430, set = 0, binding = INSTANCE_GROUP_BINDING + 2) readonly buffer SlotGroups {
+    uint slotGroups[];   // per object slot: its group's first command, NO_GROUP: drawn alone
+};
+
+// Lists object slot `slot` as an instance of its group's command for `lod` in the phase
+// whose commands start at phaseBase. False if the object draws on its own: instancing
+// is off or the object is blended.
+bool EmitInstance(uint slot, uint lod, uint phaseBase) {
+    uint group = slotGroups[slot];
+    if (params.groupPhaseBase == 0 || group == NO_GROUP) return false;
+
+    uint c = phaseBase + group + lod;
+    uint n = atomicAdd(groupCmds[c].instanceCount, 1);
+    instanceObjects[(groupCmds[c].firstInstance & ~INSTANCE_LIST_BIT) + n] = slot;
+    if (n == 0) atomicAdd(stats[STAT_INSTANCED_DRAWS], 1);
+    atomicAdd(stats[STAT_INSTANCES], 1);
+    return true;
+}
+
+#endif
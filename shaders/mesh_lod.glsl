@@ -0,0 +1,46 @@
+#ifndef MESH_LOD_GLSL
+#define MESH_LOD_GLSL
+
+// Screen-space-error LOD selection (see GPU/MeshPool.h). Both culling phases include
+// this so an item gets the same level in whichever phase draws it. The includer
+// declares `params` (CullParams), ObjectData and VkDrawIndexedIndirectCommand first
+// and defines MESH_LOD_BINDING, the set 0 binding of the per-mesh table.
+
+struct MeshLODs {
+    uint  firstIndex[4];   // relative to the mesh's index sub-pool
+    uint  indexCount[4];
+    float error[4];        // object-space, increasing
+    uint  lodCount;
+    uint  _pad0;
+    uint  _pad1;
+    uint  _pad2;
+};
+
+layout(std430, set = 0, binding = MESH_LOD_BINDING) readonly buffer MeshLODBuf {
+    MeshLODs meshLODs[];   // per mesh, indexed by ObjectData.meshIndex
+};
+
+// Replaces the draw's index range with the coarsest level whose error, projected at the
+// point of the world bounds closest to the eye, stays within params.lodThreshold pixels,
+// and returns that level.
+uint ApplyLOD(inout VkDrawIndexedIndirectCommand cmd, ObjectData obj, vec3 worldMin, vec3 worldMax) {
+    MeshLODs lods = meshLODs[obj.meshIndex];
+    if (lods.lodCount <= 1 || params.lodThreshold <= 0.0) return 0;
+
+    vec3  s      = vec3(length(obj.model[0].xyz), length(obj.model[1].xyz), length(obj.model[2].xyz));
+    float scale  = max(s.x, max(s.y, s.z));
+    vec3  center = (worldMin + worldMax) * 0.5;
+    float radius = length(worldMax - worldMin) * 0.5;
+    float dist   = max(length(center - params.cameraPosition.xyz) - radius, params.nearPlane);
+    float pixelsPerUnit = scale * params.lodScale / dist;
+
+    uint lod = 0;
+    for (uint i = 1; i < lods.lodCount; i++)
+        if (lods.error[i] * pixelsPerUnit <= params.lodThreshold) lod = i;
+
+    cmd.firstIndex = lods.firstIndex[lod];
+    cmd.indexCount = lods.indexCount[lod];
+    return lod;
+}
+
+#endif
@@ -29,7 +29,11 @@ struct MaterialParams {
     uint  metallicRoughnessTexIdx;
     uint  aoTexIdx;
     uint  emissiveTexIdx;
-    float _pad;
+    float alphaCutoff;
+    uint  alphaMode;       // 0 opaque, 1 mask, 2 blend
+    uint  _pad0;
+    uint  _pad1;
+    uint  _pad2;
 };
 
 layout(std430, set = 1, binding = 1) readonly buffer MaterialSSBO {
@@ -42,12 +46,15 @@ layout(set = 1, binding = 4) uniform samplerCube prefilterMap;
 layout(set = 1, binding = 5) uniform sampler2D   brdfLUT;
 
 layout(push_constant) uniform PushConstants {
-    mat4 model;
     uint materialIndex;
 } pc;
 
 layout(location = 0) out vec4 outColor;
 
+// AlphaMode of the pipeline variant; only the masked variant compiles the discard,
+// so the opaque pipeline keeps early depth testing. Blending uses outColor.a.
+layout(constant_id = 1) const uint ALPHA_MODE = 0;
+
 const float PI = 3.14159265359;
 const float MAX_PREFILTER_LOD = 4.0;
 
@@ -138,6 +145,7 @@ void main() {
 
     vec4 baseColor = mat.baseColorFactor *
         texture(textures[nonuniformEXT(mat.baseColorTexIdx)], fragTexCoord);
+    if (ALPHA_MODE == 1u && baseColor.a < mat.alphaCutoff) discard;
 
     vec4 mrSample = texture(textures[nonuniformEXT(mat.metallicRoughnessTexIdx)], fragTexCoord);
     float roughness = clamp(mat.roughnessFactor * mrSample.g, 0.04, 1.0);
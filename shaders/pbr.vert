@@ -1,6 +1,10 @@
 #version 450
 
-layout(location = 0) in vec3 inPosition;
+#extension GL_GOOGLE_include_directive : require
+
+#include "vertex_packing.glsl"
+
+layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec4 inTangent;
@@ -16,9 +20,16 @@ layout(std140, set = 1, binding = 0) uniform FrameUBO {
     vec4  cascadeSplits;
 } frame;
 
+// One instanced draw per (mesh, material) batch: the batch's world matrices are
+// consecutive, starting at the draw's firstInstance
+layout(std430, set = 2, binding = 0) readonly buffer InstanceSSBO {
+    mat4 instanceModels[];
+};
+
 layout(push_constant) uniform PushConstants {
-    mat4 model;
     uint materialIndex;
+    vec4 aabbMin;
+    vec4 aabbMax;
 } pc;
 
 layout(location = 0) out vec3  fragWorldPos;
@@ -28,12 +39,22 @@ layout(location = 3) out float fragViewDepth;
 layout(location = 4) out vec4  fragTangent;
 
 void main() {
-    vec4 worldPos = pc.model * vec4(inPosition, 1.0);
+    vec3 position = inPosition.xyz;
+    vec3 normal   = inNormal;
+    vec4 tangent  = inTangent;
+    if (PACKED_VERTICES) {
+        position = DequantizePosition(inPosition.xyz, pc.aabbMin.xyz, pc.aabbMax.xyz);
+        normal   = OctDecode(inNormal.xy);
+        tangent  = vec4(OctDecode(inTangent.xy), inPosition.w < 0.0 ? -1.0 : 1.0);
+    }
+
+    mat4 model    = instanceModels[gl_InstanceIndex];
+    vec4 worldPos = model * vec4(position, 1.0);
     fragWorldPos  = worldPos.xyz;
 
-    mat3 normalMat = mat3(pc.model);
-    fragNormal  = normalMat * inNormal;
-    fragTangent = vec4(normalMat * inTangent.xyz, inTangent.w);
+    mat3 normalMat = mat3(model);
+    fragNormal  = normalMat * normal;
+    fragTangent = vec4(normalMat * tangent.xyz, tangent.w);
 
     fragTexCoord = inTexCoord;
 
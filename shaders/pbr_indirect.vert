@@ -1,6 +1,10 @@
 #version 460
 
-layout(location = 0) in vec3 inPosition;
+#extension GL_GOOGLE_include_directive : require
+
+#include "vertex_packing.glsl"
+
+layout(location = 0) in vec4 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 layout(location = 3) in vec4 inTangent;
@@ -21,15 +25,22 @@ struct ObjectData {
     vec4  aabbMin;
     vec4  aabbMax;
     uint  materialIndex;
-    uint  _pad0;
-    uint  _pad1;
-    uint  _pad2;
+    uint  indexClass;
+    uint  flags;
+    uint  meshIndex;
 };
 
 layout(std430, set = 1, binding = 6) readonly buffer ObjectSSBO {
     ObjectData objects[];
 };
 
+// Object slots of the instanced group draws, listed by the culling
+layout(std430, set = 1, binding = 7) readonly buffer InstanceList {
+    uint instanceObjects[];
+};
+
+const uint INSTANCE_LIST_BIT = 0x80000000u;   // IndirectRenderer.h
+
 layout(location = 0) out vec3  fragWorldPos;
 layout(location = 1) out vec3  fragNormal;
 layout(location = 2) out vec2  fragTexCoord;
@@ -38,15 +49,28 @@ layout(location = 4) out vec4  fragTangent;
 layout(location = 5) flat out uint fragMaterialIndex;
 
 void main() {
-    ObjectData obj = objects[gl_BaseInstance];
+    // Single draws carry their slot in firstInstance; group draws mark it with
+    // INSTANCE_LIST_BIT and find their objects in the instance list from there
+    uint instance = uint(gl_InstanceIndex);
+    uint slot = (instance & INSTANCE_LIST_BIT) != 0u ? instanceObjects[instance & ~INSTANCE_LIST_BIT] : instance;
+    ObjectData obj = objects[slot];
     mat4 model = obj.model;
 
-    vec4 worldPos = model * vec4(inPosition, 1.0);
+    vec3 position = inPosition.xyz;
+    vec3 normal   = inNormal;
+    vec4 tangent  = inTangent;
+    if (PACKED_VERTICES) {
+        position = DequantizePosition(inPosition.xyz, obj.aabbMin.xyz, obj.aabbMax.xyz);
+        normal   = OctDecode(inNormal.xy);
+        tangent  = vec4(OctDecode(inTangent.xy), inPosition.w < 0.0 ? -1.0 : 1.0);
+    }
+
+    vec4 worldPos = model * vec4(position, 1.0);
     fragWorldPos  = worldPos.xyz;
 
     mat3 normalMat = mat3(model);
-    fragNormal  = normalMat * inNormal;
-    fragTangent = vec4(normalMat * inTangent.xyz, inTangent.w);
+    fragNormal  = normalMat * normal;
+    fragTangent = vec4(normalMat * tangent.xyz, tangent.w);
 
     fragTexCoord = inTexCoord;
     fragMaterialIndex = obj.materialIndex;
@@ -15,6 +15,7 @@ struct HitPayload {
 
 const uint MAT_FLAG_EMISSIVE     = 1u;
 const uint MAT_FLAG_TRANSMISSIVE = 2u;
+const uint MAT_FLAG_LIGHT        = 4u;   // triangle is in the light buffer, sampled by NEE
 
 struct Vertex {
     vec3 position;
@@ -32,16 +33,26 @@ struct MaterialParams {
     uint  metallicRoughnessTexIdx;
     uint  aoTexIdx;
     uint  emissiveTexIdx;
-    float _pad;
+    float alphaCutoff;
+    uint  alphaMode;       // 0 opaque, 1 mask, 2 blend
+    uint  _pad0;
+    uint  _pad1;
+    uint  _pad2;
 };
 
 struct InstanceInfo {
     int  vertexOffset;
-    uint firstIndex;
+    uint firstIndex;      // absolute, in elements of the instance's index width
     uint indexCount;
     uint materialIndex;
+    uint indexClass;      // 0 = uint16 (two per word), 1 = uint32
+    uint lightOffset;     // light buffer index of primitive 0, LIGHT_NONE if not emissive
 };
 
+// Light indices (pt_lights.glsl): the sun is a virtual light outside the buffer
+const uint LIGHT_SUN  = 0xFFFFFFFEu;
+const uint LIGHT_NONE = 0xFFFFFFFFu;
+
 const float PI     = 3.14159265359;
 const float INV_PI = 0.31830988618;
 const float EPSILON = 1e-4;
@@ -100,4 +111,117 @@ vec3 FresnelSchlick(float cosTheta, vec3 F0) {
     return F0 + (1.0 - F0) * pow(clamp(1.0 - cosTheta, 0.0, 1.0), 5.0);
 }
 
+// ---------- Path vertex (shared by the megakernel and wavefront integrators) ----------
+
+// Sun direction jittered over a disk of the given radius; u.x picks the angle, u.y the radius.
+vec3 JitterSunDirection(vec3 L, float radius, vec2 u) {
+    vec3 T = normalize(cross(L, abs(L.y) < 0.99 ? vec3(0,1,0) : vec3(1,0,0)));
+    vec3 B = cross(L, T);
+    float angle = u.x * 2.0 * PI;
+    float r     = sqrt(u.y) * radius;
+    return normalize(L + T * cos(angle) * r + B * sin(angle) * r);
+}
+
+// (diffuse + specular) * NdotL towards an unoccluded light direction L.
+vec3 EvalSunBRDF(vec3 N, vec3 V, vec3 L, float NdotL,
+                 vec3 albedo, float metallic, float roughness) {
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    vec3 H = normalize(V + L);
+    float NdotH = max(dot(N, H), 0.0);
+    float VdotH = max(dot(V, H), 0.0);
+    float NdotV = max(dot(N, V), 0.001);
+    float a2 = roughness * roughness * roughness * roughness;
+
+    float D = DistributionGGX(NdotH, a2);
+    float G = GeometrySmith(NdotV, NdotL, a2);
+    vec3  F = FresnelSchlick(VdotH, F0);
+
+    vec3 spec = (D * G * F) / (4.0 * NdotV * NdotL + 0.0001);
+    vec3 kD = (1.0 - F) * (1.0 - metallic);
+    vec3 diff = kD * albedo * INV_PI;
+    return (diff + spec) * NdotL;
+}
+
+// Picks the specular or diffuse lobe with uLobe and samples it with u. Returns false
+// when the specular sample points below the surface and the path ends.
+bool SampleBSDF(vec3 N, vec3 V, vec3 albedo, float metallic, float roughness,
+                float uLobe, vec2 u, out vec3 newDir, out vec3 weight) {
+    vec3 F0 = mix(vec3(0.04), albedo, metallic);
+    float NdotV = max(dot(N, V), 0.001);
+    vec3 F_avg = FresnelSchlick(NdotV, F0);
+    float specWeight = (F_avg.r + F_avg.g + F_avg.b) / 3.0;
+    float diffWeight = (1.0 - specWeight) * (1.0 - metallic);
+    float pSpec = clamp(specWeight / max(specWeight + diffWeight, 0.001), 0.1, 0.9);
+
+    if (uLobe < pSpec) {
+        float a = max(roughness * roughness, 0.001);
+        vec3 T = normalize(cross(N, abs(N.y) < 0.99 ? vec3(0,1,0) : vec3(1,0,0)));
+        vec3 B = cross(N, T);
+        mat3 TBN = mat3(T, B, N);
+        vec3 Ve = transpose(TBN) * V;
+
+        vec3 Hlocal = sampleGGXVNDF(Ve, roughness, u);
+        vec3 H = TBN * Hlocal;
+        newDir = reflect(-V, H);
+        weight = vec3(0.0);
+
+        if (dot(newDir, N) <= 0.0) return false;
+
+        float VdotH = max(dot(V, H), 0.0);
+        float NdotL = max(dot(N, newDir), 0.0);
+        float a2 = a * a;
+
+        vec3 F = FresnelSchlick(VdotH, F0);
+        float G = GeometrySmith(NdotV, NdotL, a2);
+        float G1 = GeometrySmithG1(NdotV, a2);
+
+        weight = F * (G / max(G1, 0.001)) / pSpec;
+    } else {
+        newDir = sampleCosineHemisphere(N, u);
+        vec3 kD = (1.0 - F_avg) * (1.0 - metallic);
+        weight = kD * albedo / (1.0 - pSpec);
+    }
+    return true;
+}
+
+// Throughput clamp and Russian roulette after bounce 2. Returns false when the path ends.
+bool ContinuePath(inout vec3 throughput, uint bounce, float u) {
+    float tMax = max(throughput.r, max(throughput.g, throughput.b));
+    if (tMax > 2.0)
+        throughput *= 2.0 / tMax;
+
+    if (bounce > 1) {
+        float p = clamp(tMax, 0.05, 0.9);
+        if (u > p) return false;
+        throughput /= p;
+    }
+    return true;
+}
+
+float Luminance(vec3 c) { return dot(c, vec3(0.2126, 0.7152, 0.0722)); }
+
+// NaN/Inf protection and firefly suppression of a finished path sample.
+vec3 ClampSample(vec3 color) {
+    if (any(isnan(color)) || any(isinf(color))) color = vec3(0.0);
+    color = max(color, vec3(0.0));
+    float cMax = max(color.r, max(color.g, color.b));
+    if (cMax > 50.0)
+        color *= 50.0 / cMax;
+    return color;
+}
+
+// Path sample dimensions: one 2D sample per bounce and purpose (PathSample2D)
+const uint SAMPLE_CAMERA   = 0u;   // pixel jitter, bounce 0 only
+const uint SAMPLE_LIGHT    = 1u;   // point on the chosen light (sun disk, triangle)
+const uint SAMPLE_BSDF     = 2u;   // direction within the chosen lobe
+const uint SAMPLE_LOBE_RR  = 3u;   // x = lobe choice, y = Russian roulette
+const uint SAMPLE_LIGHT_SELECT = 4u;   // x = light choice
+const uint SAMPLE_PURPOSES = 5u;
+
+// Adaptive sampling: one sample budget per ADAPTIVE_TILE x ADAPTIVE_TILE pixels (PathTracer.h)
+const uint ADAPTIVE_TILE = 8;
+
+// NRD: viewZ > denoisingRange marks sky/infinite - use large value so NRD skips denoising there
+const float NRD_SKY_VIEWZ = 600000.0;  // > denoisingRange (500000)
+
 #endif
@@ -0,0 +1,137 @@
+#ifndef PT_LIGHTS_GLSL
+#define PT_LIGHTS_GLSL
+
+// Light buffer of the path tracer (LightBuffer on the CPU side): KHR_lights_punctual
+// point/spot lights and emissive triangles at set 0 bindings 21-22, with the sun as a
+// virtual light (LIGHT_SUN) chosen with probability frame.lights.y.
+// Include after pt_common.glsl, the FrameUBO `frame` (lights: x = buffer light count,
+// y = sun selection probability, z = punctual intensity scale) and the PTPushConstants block.
+
+const uint LIGHT_POINT    = 0u;
+const uint LIGHT_SPOT     = 1u;
+const uint LIGHT_TRIANGLE = 2u;
+
+struct PTLight {
+    vec3  position;    // point/spot position, triangle vertex 0 (world space)
+    uint  type;        // LIGHT_*
+    vec3  direction;   // spot axis (direction of emission), triangle edge v1 - v0
+    float range;       // punctual range (0 = unlimited), triangle area
+    vec3  radiance;    // punctual color * intensity, triangle emitted radiance
+    float cosOuter;
+    vec3  edge2;       // triangle edge v2 - v0
+    float cosInner;
+};
+
+// Vose alias table over the buffer lights, proportional to emitted power
+struct AliasEntry {
+    float prob;    // chance of keeping this slot rather than jumping to its alias
+    uint  alias;
+    float pdf;     // selection probability of the light in this slot
+    uint  pad;
+};
+
+layout(std430, set = 0, binding = 21) readonly buffer LightBuffer { PTLight lights[]; };
+layout(std430, set = 0, binding = 22) readonly buffer AliasBuffer { AliasEntry aliasTable[]; };
+
+uint LightCount() { return uint(frame.lights.x); }
+
+// Picks the sun or a buffer light with one uniform number; pdf is the chance of that pick
+uint SelectLight(float u, out float pdf) {
+    float pSun = frame.lights.y;
+    if (u < pSun) {
+        pdf = pSun;
+        return LIGHT_SUN;
+    }
+    uint n = LightCount();
+    if (n == 0u) {
+        pdf = 0.0;
+        return LIGHT_NONE;
+    }
+    float x     = (u - pSun) / (1.0 - pSun) * float(n);
+    uint  slot  = min(uint(x), n - 1u);
+    AliasEntry e = aliasTable[slot];
+    uint  light = fract(x) < e.prob ? slot : e.alias;
+    pdf = (1.0 - pSun) * aliasTable[light].pdf;
+    return light;
+}
+
+struct LightSample {
+    vec3  L;         // unit direction towards the light point
+    float dist;      // shadow ray length
+    vec3  Li;        // incident radiance times the light-side geometry term
+    float areaPdf;   // density of the point on the light: 1 / area for triangles, 1 otherwise
+};
+
+// Light point of sample uv seen from P. The point depends only on (light, uv), so a
+// reservoir's sample can be re-evaluated at another pixel's surface.
+LightSample EvalLightSample(uint light, vec2 uv, vec3 P) {
+    LightSample s;
+    s.areaPdf = 1.0;
+    if (light == LIGHT_SUN) {
+        s.L    = JitterSunDirection(normalize(sunDirAndRadius.xyz), sunDirAndRadius.w, uv);
+        s.dist = 10000.0;
+        s.Li   = sunColorIntensity.rgb * sunColorIntensity.w;
+        return s;
+    }
+
+    PTLight l = lights[light];
+    if (l.type == LIGHT_TRIANGLE) {
+        // Uniform point on the triangle; emission is two-sided like ShadeSurface's
+        float su = sqrt(uv.x);
+        vec3  Y  = l.position + l.direction * (su * (1.0 - uv.y)) + l.edge2 * (su * uv.y);
+        vec3  d  = Y - P;
+        float d2 = max(dot(d, d), 1e-8);
+        vec3  n  = cross(l.direction, l.edge2);
+        s.dist    = sqrt(d2);
+        s.L       = d / s.dist;
+        s.Li      = l.radiance * abs(dot(n, s.L)) / (max(length(n), 1e-12) * d2);
+        s.areaPdf = 1.0 / max(l.range, 1e-12);
+        return s;
+    }
+
+    vec3  d  = l.position - P;
+    float d2 = max(dot(d, d), 1e-8);
+    s.dist = sqrt(d2);
+    s.L    = d / s.dist;
+
+    // KHR_lights_punctual: inverse square with a smooth window at the range
+    float atten = 1.0 / d2;
+    if (l.range > 0.0) {
+        float r4 = d2 * d2 / (l.range * l.range * l.range * l.range);
+        float window = clamp(1.0 - r4, 0.0, 1.0);
+        atten *= window * window;
+    }
+    if (l.type == LIGHT_SPOT) {
+        float t = clamp((dot(l.direction, -s.L) - l.cosOuter) / max(l.cosInner - l.cosOuter, 1e-4), 0.0, 1.0);
+        atten *= t * t;
+    }
+    s.Li = l.radiance * (frame.lights.z * atten);
+    return s;
+}
+
+// Unshadowed (diffuse + specular) * NdotL * Li of a light sample at a surface
+vec3 LightContribution(LightSample s, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness) {
+    float NdotL = dot(N, s.L);
+    if (NdotL <= 0.0) return vec3(0.0);
+    return EvalSunBRDF(N, V, s.L, NdotL, albedo, metallic, roughness) * s.Li;
+}
+
+// One-sample next-event estimate over the sun and the light buffer. Returns false when
+// nothing can contribute; otherwise the caller traces a shadow ray of length dist along
+// L and adds contribution if it is unoccluded.
+bool SampleDirectLight(vec3 P, vec3 N, vec3 V, vec3 albedo, float metallic, float roughness,
+                       float uSelect, vec2 uLight,
+                       out vec3 L, out float dist, out vec3 contribution) {
+    float selectPdf;
+    uint  light = SelectLight(uSelect, selectPdf);
+    L = vec3(0.0); dist = 0.0; contribution = vec3(0.0);
+    if (light == LIGHT_NONE || selectPdf <= 0.0) return false;
+
+    LightSample s = EvalLightSample(light, uLight, P);
+    contribution = LightContribution(s, N, V, albedo, metallic, roughness) / (selectPdf * s.areaPdf);
+    L    = s.L;
+    dist = s.dist * 0.999;   // stop short of the emitting triangle
+    return any(greaterThan(contribution, vec3(0.0)));
+}
+
+#endif
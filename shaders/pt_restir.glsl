@@ -0,0 +1,115 @@
+#ifndef PT_RESTIR_GLSL
+#define PT_RESTIR_GLSL
+
+// ReSTIR DI passes of the path tracer (ReSTIRDI on the CPU side). The integrators write
+// the primary surface and leave its direct light out; pt_restir_initial.comp resamples
+// light candidates and the pixel's reprojected history, pt_restir_spatial.comp reuses
+// neighbors, shades the chosen sample and accumulates the frame.
+
+#include "pt_common.glsl"
+#include "pt_surface.glsl"
+
+layout(set = 0, binding = 0) uniform accelerationStructureEXT tlas;
+layout(set = 0, binding = 3, rgba16f) uniform image2D normalOutput;
+layout(set = 0, binding = 4, rgba8)   uniform image2D albedoOutput;
+layout(set = 0, binding = 23, rgba32f) uniform image2D surfaceOutput;
+
+layout(set = 0, binding = 14) uniform FrameUBO {
+    mat4  viewProj;
+    mat4  prevViewProj;
+    uvec4 adaptive;
+    uvec4 sampling;
+    uvec4 restir;       // x = enabled, y = initial candidates, z = spatial neighbors,
+                        // w = output slice (bit 0) | history valid (bit 1)
+    vec4  lights;       // pt_lights.glsl; w = spatial radius in pixels
+} frame;
+
+layout(push_constant) uniform PushConstants {
+    mat4  invViewProj;
+    vec4  cameraPosAndFrame;
+    vec4  sunDirAndRadius;
+    vec4  sunColorIntensity;
+    uvec4 params;           // x = maxBounces, y = sample offset, z = MIS flag (unused here), w = accumFrames
+};
+
+#include "pt_lights.glsl"
+#include "restir.glsl"
+
+// Three slices of one reservoir per pixel: two alternating final slices (this frame's
+// output is next frame's temporal history) and the initial pass's output
+layout(std430, set = 2, binding = 0) buffer ReservoirBuffer { Reservoir reservoirs[]; };
+
+const uint RESTIR_SLICE_INITIAL   = 2u;
+const uint RESTIR_HISTORY_VALID   = 2u;
+const float RESTIR_DEPTH_TOLERANCE  = 0.1;   // relative view depth difference
+const float RESTIR_NORMAL_THRESHOLD = 0.9;   // minimum cosine between surface normals
+
+uint ReservoirIndex(ivec2 pixel, ivec2 size, uint slice) {
+    return (slice * uint(size.y) + uint(pixel.y)) * uint(size.x) + uint(pixel.x);
+}
+
+uint rngState;
+
+float rand01() {
+    rngState = pcgHash(rngState);
+    return float(rngState) / 4294967296.0;
+}
+
+vec2 rand2() { return vec2(rand01(), rand01()); }
+
+struct Surface {
+    vec3  P;
+    float metallic;
+    vec3  N;
+    float roughness;
+    vec3  albedo;
+    float depth;     // view depth
+    vec3  V;
+};
+
+bool LoadSurface(ivec2 pixel, out Surface s) {
+    vec4 posMetal = imageLoad(surfaceOutput, pixel);
+    if (posMetal.w < 0.0) return false;
+
+    vec4 normalRough = imageLoad(normalOutput, pixel);
+    s.P         = posMetal.xyz;
+    s.metallic  = posMetal.w;
+    s.N         = normalize(normalRough.xyz);
+    s.roughness = normalRough.w;
+    s.albedo    = imageLoad(albedoOutput, pixel).rgb;
+    s.depth     = (frame.viewProj * vec4(s.P, 1.0)).w;
+    s.V         = normalize(cameraPosAndFrame.xyz - s.P);
+    return true;
+}
+
+// Reuse is only valid between reservoirs of (nearly) the same surface
+bool SimilarSurface(Reservoir r, float depth, vec3 N) {
+    return r.M > 0.0 &&
+           abs(r.depth - depth) <= RESTIR_DEPTH_TOLERANCE * depth &&
+           dot(UnpackNormal(r.normal), N) >= RESTIR_NORMAL_THRESHOLD;
+}
+
+// p-hat: luminance of the unshadowed contribution of a light sample at the surface
+float TargetPdf(Surface s, uint light, vec2 uv) {
+    if (light == LIGHT_NONE || (light != LIGHT_SUN && light >= LightCount())) return 0.0;
+    LightSample ls = EvalLightSample(light, uv, s.P);
+    return Luminance(LightContribution(ls, s.N, s.V, s.albedo, s.metallic, s.roughness));
+}
+
+// Shadow test with the integrators' alpha coverage, so cut-out texels let light through
+bool Visible(Surface s, LightSample ls, ivec2 pixel) {
+    float blendThreshold = AlphaBlendThreshold(uvec2(pixel));
+    rayQueryEXT rq;
+    rayQueryInitializeEXT(rq, tlas, gl_RayFlagsTerminateOnFirstHitEXT, 0xFF,
+                          s.P + s.N * EPSILON, EPSILON, ls.L, ls.dist * 0.999);
+    while (rayQueryProceedEXT(rq)) {
+        if (rayQueryGetIntersectionTypeEXT(rq, false) == gl_RayQueryCandidateIntersectionTriangleEXT &&
+            AlphaTestPasses(uint(rayQueryGetIntersectionInstanceCustomIndexEXT(rq, false)),
+                            uint(rayQueryGetIntersectionPrimitiveIndexEXT(rq, false)),
+                            rayQueryGetIntersectionBarycentricsEXT(rq, false), blendThreshold))
+            rayQueryConfirmIntersectionEXT(rq);
+    }
+    return rayQueryGetIntersectionTypeEXT(rq, true) == gl_RayQueryCommittedIntersectionNoneEXT;
+}
+
+#endif
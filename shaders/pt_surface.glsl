@@ -0,0 +1,156 @@
+#ifndef PT_SURFACE_GLSL
+#define PT_SURFACE_GLSL
+
+// Surface evaluation and alpha coverage shared by the hit shaders, the wavefront integrator
+// and ReSTIR. Requires GL_EXT_nonuniform_qualifier, GL_EXT_scalar_block_layout and pt_common.glsl.
+
+#include "vertex_packing.glsl"
+
+// Material class of the hit group (RTMaterialClass). The RT pipeline specializes one
+// closest hit per class; the wavefront integrator keeps HIT_CLASS_ANY and shades fully.
+const uint HIT_CLASS_OPAQUE       = 0u;
+const uint HIT_CLASS_ALPHA_TESTED = 1u;
+const uint HIT_CLASS_EMISSIVE     = 2u;
+const uint HIT_CLASS_ANY          = 0xFFu;
+layout(constant_id = 1) const uint HIT_CLASS = HIT_CLASS_ANY;
+
+layout(scalar, set = 0, binding = 6) readonly buffer VertexBuffer  { Vertex vertices[]; };
+layout(scalar, set = 0, binding = 6) readonly buffer PackedVertexBuffer { PackedVertex packedVertices[]; };
+layout(scalar, set = 0, binding = 7) readonly buffer IndexBuffer   { uint indices[]; };
+layout(std430, set = 0, binding = 8) readonly buffer MaterialBuffer { MaterialParams materials[]; };
+layout(std430, set = 0, binding = 9) readonly buffer InstanceBuffer { InstanceInfo instanceInfos[]; };
+
+layout(set = 1, binding = 0) uniform sampler2D textures[];
+
+uint FetchIndex(InstanceInfo info, uint i) {
+    uint e = info.firstIndex + i;
+    if (info.indexClass == 0) {
+        uint word = indices[e >> 1];
+        return (e & 1u) != 0 ? word >> 16 : word & 0xFFFFu;
+    }
+    return indices[e];
+}
+
+// Position is not fetched: the hit point comes from the ray.
+void FetchVertex(uint idx, out vec3 normal, out vec2 texCoord, out vec4 tangent) {
+    if (PACKED_VERTICES) {
+        PackedVertex v = packedVertices[idx];
+        normal   = PackedNormal(v);
+        texCoord = PackedUV(v);
+        tangent  = PackedTangent(v);
+    } else {
+        Vertex v = vertices[idx];
+        normal   = v.normal;
+        texCoord = v.texCoord;
+        tangent  = v.tangent;
+    }
+}
+
+vec2 FetchTexCoord(uint idx) {
+    return PACKED_VERTICES ? PackedUV(packedVertices[idx]) : vertices[idx].texCoord;
+}
+
+// Per-pixel threshold for the stochastic test of blended materials, fixed for all of
+// the pixel's rays so every integrator cuts the same texels
+float AlphaBlendThreshold(uvec2 pixel) {
+    uint seed = (pixel.x | (pixel.y << 16)) * 747796405u + 2891336453u;
+    return float(seed) / 4294967296.0;
+}
+
+// Coverage of a candidate hit: masked materials keep texels at or above their cutoff,
+// blended ones above blendThreshold. Opaque materials always cover, since their texture
+// alpha is not coverage. The any-hit shader ignores and ray queries skip what fails.
+bool AlphaTestPasses(uint instIdx, uint primitive, vec2 barycentrics, float blendThreshold) {
+    InstanceInfo info  = instanceInfos[instIdx];
+    MaterialParams mat = materials[info.materialIndex];
+    if (mat.alphaMode == 0u) return true;
+
+    vec2 uv0 = FetchTexCoord(uint(int(FetchIndex(info, primitive * 3 + 0)) + info.vertexOffset));
+    vec2 uv1 = FetchTexCoord(uint(int(FetchIndex(info, primitive * 3 + 1)) + info.vertexOffset));
+    vec2 uv2 = FetchTexCoord(uint(int(FetchIndex(info, primitive * 3 + 2)) + info.vertexOffset));
+    vec3 bary = vec3(1.0 - barycentrics.x - barycentrics.y, barycentrics.x, barycentrics.y);
+    vec2 uv   = uv0 * bary.x + uv1 * bary.y + uv2 * bary.z;
+
+    float alpha = mat.baseColorFactor.a *
+        texture(textures[nonuniformEXT(mat.baseColorTexIdx)], uv).a;
+    return alpha >= (mat.alphaMode == 1u ? mat.alphaCutoff : blendThreshold);
+}
+
+// Interpolated world-space attributes of a hit, before any texture is sampled.
+struct SurfaceGeometry {
+    vec3  normal;
+    uint  materialIndex;
+    vec3  tangent;        // world space, not normalized
+    float tangentW;
+    vec2  texCoord;
+};
+
+SurfaceGeometry FetchSurfaceGeometry(uint instIdx, uint primitive, vec2 barycentrics, mat3 normalMat) {
+    InstanceInfo info = instanceInfos[instIdx];
+
+    uint i0 = FetchIndex(info, primitive * 3 + 0);
+    uint i1 = FetchIndex(info, primitive * 3 + 1);
+    uint i2 = FetchIndex(info, primitive * 3 + 2);
+
+    vec3 n0, n1, n2;
+    vec2 uv0, uv1, uv2;
+    vec4 t0, t1, t2;
+    FetchVertex(uint(int(i0) + info.vertexOffset), n0, uv0, t0);
+    FetchVertex(uint(int(i1) + info.vertexOffset), n1, uv1, t1);
+    FetchVertex(uint(int(i2) + info.vertexOffset), n2, uv2, t2);
+
+    vec3 bary = vec3(1.0 - barycentrics.x - barycentrics.y, barycentrics.x, barycentrics.y);
+
+    SurfaceGeometry g;
+    g.normal        = normalize(normalMat * (n0 * bary.x + n1 * bary.y + n2 * bary.z));
+    g.materialIndex = info.materialIndex;
+    g.tangent       = normalMat * (t0.xyz * bary.x + t1.xyz * bary.y + t2.xyz * bary.z);
+    g.tangentW      = t0.w;
+    g.texCoord      = uv0 * bary.x + uv1 * bary.y + uv2 * bary.z;
+    return g;
+}
+
+struct SurfaceSample {
+    vec3  normal;         // normal-mapped
+    float metallic;
+    vec3  albedo;
+    float roughness;
+    vec3  emissive;
+    uint  flags;
+};
+
+SurfaceSample ShadeSurface(SurfaceGeometry g) {
+    MaterialParams mat = materials[g.materialIndex];
+
+    vec4 baseColor = mat.baseColorFactor *
+        texture(textures[nonuniformEXT(mat.baseColorTexIdx)], g.texCoord);
+
+    vec4 mrSample = texture(textures[nonuniformEXT(mat.metallicRoughnessTexIdx)], g.texCoord);
+
+    SurfaceSample s;
+    s.roughness = clamp(mat.roughnessFactor * mrSample.g, 0.04, 1.0);
+    s.metallic  = clamp(mat.metallicFactor  * mrSample.b, 0.0, 1.0);
+    s.albedo    = baseColor.rgb;
+
+    // Normal mapping
+    vec3 N = g.normal;
+    vec3 T = normalize(g.tangent);
+    if (length(T) > 0.001) {
+        T = normalize(T - dot(T, N) * N);
+        vec3 B = cross(N, T) * g.tangentW;
+        mat3 TBN = mat3(T, B, N);
+        vec3 normalSample = texture(textures[nonuniformEXT(mat.normalTexIdx)], g.texCoord).rgb;
+        normalSample = normalSample * 2.0 - 1.0;
+        N = normalize(TBN * normalSample);
+    }
+    s.normal = N;
+
+    // Emissive; the opaque class only holds materials bound to the black texture
+    vec3 emissiveTex = HIT_CLASS == HIT_CLASS_OPAQUE ? vec3(0.0)
+                     : texture(textures[nonuniformEXT(mat.emissiveTexIdx)], g.texCoord).rgb;
+    s.emissive = emissiveTex * mat.baseColorFactor.rgb;
+    s.flags    = dot(s.emissive, s.emissive) > 0.0 ? MAT_FLAG_EMISSIVE : 0u;
+    return s;
+}
+
+#endif
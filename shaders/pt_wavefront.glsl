@@ -0,0 +1,116 @@
+#ifndef PT_WAVEFRONT_GLSL
+#define PT_WAVEFRONT_GLSL
+
+// Wavefront path tracer: per-path state, queues and counters (set 2).
+// Each bounce runs extend -> scan -> scatter -> shade -> args -> connect as separate
+// compute dispatches; queue sizes are read back on the GPU through indirect dispatch.
+
+#include "pt_common.glsl"
+
+#define SOBOL_SET 0
+#define SOBOL_BINDING 19
+#define BLUE_NOISE_SET 0
+#define BLUE_NOISE_BINDING 20
+#include "sampling.glsl"
+
+const uint WF_GROUP_SIZE = 64;
+
+const uint PATH_FLAG_FIRST_HIT = 1u;   // G-buffer has been written for this pixel
+
+struct PathState {
+    vec3  origin;
+    uint  rng;
+    vec3  direction;
+    uint  pixel;        // x | y << 16
+    vec3  throughput;
+    uint  flags;
+    vec3  radiance;
+    uint  pad;
+};
+
+// Geometry of a hit, written by extend and consumed by shade.
+struct HitRecord {
+    vec3  position;
+    float hitT;
+    vec3  normal;
+    uint  materialIndex;
+    vec3  tangent;
+    float tangentW;
+    vec2  texCoord;
+    uint  path;
+    uint  flags;        // MAT_FLAG_LIGHT when the triangle is in the light buffer
+};
+
+struct ShadowRay {
+    vec3  origin;
+    uint  path;
+    vec3  direction;
+    float tMax;
+    vec3  contribution;  // added to the path's radiance if the ray is unoccluded
+    uint  pad1;
+};
+
+layout(std430, set = 2, binding = 0) buffer PathBuffer      { PathState paths[]; };
+layout(std430, set = 2, binding = 1) buffer HitBuffer       { HitRecord hits[]; };
+layout(std430, set = 2, binding = 2) buffer RayQueueBuffer  { uint rayQueue[]; };     // 2 x pathCount, ping-pong
+layout(std430, set = 2, binding = 3) buffer SortedBuffer    { uint sortedHits[]; };
+layout(std430, set = 2, binding = 4) buffer ShadowBuffer    { ShadowRay shadowRays[]; };
+layout(std430, set = 2, binding = 5) buffer CounterBuffer {
+    uint  rayCount[2];
+    uint  hitCount;
+    uint  shadowCount;
+    uvec4 extendArgs;   // VkDispatchIndirectCommand at byte offset 16
+    uvec4 shadeArgs;    // offset 32, also used by scatter
+    uvec4 connectArgs;  // offset 48
+} counters;
+layout(std430, set = 2, binding = 6) buffer MaterialBinBuffer { uint bins[]; };   // counts[M] then offsets[M], the scatter cursors
+
+layout(set = 0, binding = 14) uniform FrameUBO {
+    mat4  viewProj;
+    mat4  prevViewProj;
+    uvec4 adaptive;
+    uvec4 sampling;     // x = SAMPLER_* mode
+    uvec4 restir;       // x = enabled (pt_restir_*.comp shade the primary hit's direct light)
+    vec4  lights;       // pt_lights.glsl
+} frame;
+
+layout(push_constant) uniform PushConstants {
+    mat4  invViewProj;
+    vec4  cameraPosAndFrame;    // w = sequence index of this pass
+    vec4  sunDirAndRadius;
+    vec4  sunColorIntensity;
+    uvec4 params;           // x = maxBounces, y = sample offset, z = bounce, w = accumFrames
+};
+
+#include "pt_lights.glsl"
+
+uint rngState;
+
+float rand01() {
+    rngState = pcgHash(rngState);
+    return float(rngState) / 4294967296.0;
+}
+
+vec2 rand2() { return vec2(rand01(), rand01()); }
+
+// Same dimensions as the megakernel's PathSample2D; the hash RNG state lives in the path
+vec2 PathSample2D(ivec2 pixel, uint bounce, uint purpose) {
+    uint dimension = bounce * SAMPLE_PURPOSES + purpose;
+    uint index     = uint(cameraPosAndFrame.w);
+    if (frame.sampling.x == SAMPLER_SOBOL)
+        return SobolSample2D(uint(pixel.x) | (uint(pixel.y) << 16), index, dimension);
+    if (frame.sampling.x == SAMPLER_BLUE_NOISE)
+        return BlueNoise2D(pixel, index, dimension);
+    return rand2();
+}
+
+uint PathCount()     { return uint(paths.length()); }
+uint MaterialCount() { return uint(bins.length()) / 2u; }
+
+ivec2 PathPixel(PathState p) { return ivec2(p.pixel & 0xFFFFu, p.pixel >> 16); }
+
+uvec4 DispatchArgs(uint count) {
+    return uvec4((count + WF_GROUP_SIZE - 1u) / WF_GROUP_SIZE, 1u, 1u, 0u);
+}
+
+#endif
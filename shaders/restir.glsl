@@ -0,0 +1,85 @@
+#ifndef RESTIR_GLSL
+#define RESTIR_GLSL
+
+// Reservoir math of ReSTIR DI (Bitterli et al. 2020). Mirrors src/RayTracing/ReSTIR.h
+// line for line; keep the two in sync.
+
+const float RESTIR_MAX_HISTORY = 20.0;   // ReSTIR::kMaxHistory
+
+struct Reservoir {
+    vec2  uv;          // sample position on the light
+    uint  light;       // light buffer index, LIGHT_SUN or LIGHT_NONE
+    float M;           // candidates the reservoir stands for
+    float weight;      // wSum while streaming, W = wSum / (M * targetPdf) after Finalize
+    float targetPdf;   // p-hat of the selected sample at the reservoir's surface
+    float depth;       // view depth of that surface, for reuse validation
+    uint  normal;      // octahedral-packed surface normal
+};
+
+Reservoir EmptyReservoir() {
+    Reservoir r;
+    r.uv        = vec2(0.0);
+    r.light     = LIGHT_NONE;
+    r.M         = 0.0;
+    r.weight    = 0.0;
+    r.targetPdf = 0.0;
+    r.depth     = 0.0;
+    r.normal    = 0u;
+    return r;
+}
+
+bool ReservoirUpdate(inout Reservoir r, uint light, vec2 uv, float targetPdf, float sourcePdf, float u) {
+    float w = sourcePdf > 0.0 ? targetPdf / sourcePdf : 0.0;
+    r.weight += w;
+    r.M      += 1.0;
+    if (w > 0.0 && u * r.weight < w) {
+        r.light     = light;
+        r.uv        = uv;
+        r.targetPdf = targetPdf;
+        return true;
+    }
+    return false;
+}
+
+// `other` is finalized; targetPdfHere is p-hat of its sample at r's surface
+bool ReservoirMerge(inout Reservoir r, Reservoir other, float targetPdfHere, float u) {
+    float w = targetPdfHere * other.weight * other.M;
+    r.weight += w;
+    r.M      += other.M;
+    if (w > 0.0 && u * r.weight < w) {
+        r.light     = other.light;
+        r.uv        = other.uv;
+        r.targetPdf = targetPdfHere;
+        return true;
+    }
+    return false;
+}
+
+void ReservoirFinalize(inout Reservoir r) {
+    float denom = r.M * r.targetPdf;
+    r.weight = denom > 0.0 ? r.weight / denom : 0.0;
+}
+
+void ReservoirClampHistory(inout Reservoir history, float currentM) {
+    history.M = min(history.M, RESTIR_MAX_HISTORY * max(currentM, 1.0));
+}
+
+uint PackNormal(vec3 n) {
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    vec2 p = n.xy;
+    if (n.z < 0.0)
+        p = (1.0 - abs(p.yx)) * vec2(p.x >= 0.0 ? 1.0 : -1.0, p.y >= 0.0 ? 1.0 : -1.0);
+    uvec2 q = uvec2(clamp(p * 0.5 + 0.5, 0.0, 1.0) * 65535.0 + 0.5);
+    return q.x | (q.y << 16);
+}
+
+vec3 UnpackNormal(uint packed) {
+    vec2 p = vec2(float(packed & 0xFFFFu), float(packed >> 16)) / 65535.0 * 2.0 - 1.0;
+    vec3 n = vec3(p, 1.0 - abs(p.x) - abs(p.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef RT_TRACE_MODE_GLSL
+#define RT_TRACE_MODE_GLSL
+
+// Trace layouts of rt_shadows / rt_reflections (RTTraceMode in RTTraceMode.h)
+const uint RT_TRACE_FULL         = 0u;
+const uint RT_TRACE_HALF         = 1u;
+const uint RT_TRACE_QUARTER      = 2u;
+const uint RT_TRACE_CHECKERBOARD = 3u;
+
+ivec2 TraceScale(uint mode) {
+    if (mode == RT_TRACE_HALF)         return ivec2(2, 2);
+    if (mode == RT_TRACE_QUARTER)      return ivec2(4, 4);
+    if (mode == RT_TRACE_CHECKERBOARD) return ivec2(2, 1);
+    return ivec2(1, 1);
+}
+
+ivec2 TraceExtent(ivec2 fullRes, uint mode) {
+    ivec2 s = TraceScale(mode);
+    return (fullRes + s - 1) / s;
+}
+
+// Index i of the 2x2 Bayer order: (0,0), (1,1), (1,0), (0,1)
+ivec2 Bayer2(uint i) {
+    return ivec2((i ^ (i >> 1u)) & 1u, i & 1u);
+}
+
+// Full-resolution pixel that trace texel `tp` samples this frame. The pixel walks the
+// block in Bayer order, so consecutive frames land as far apart as possible and
+// temporal accumulation sees every pixel of the block.
+ivec2 TraceSourcePixel(ivec2 tp, ivec2 fullRes, uint mode, uint frame) {
+    ivec2 offset = ivec2(0);
+    if (mode == RT_TRACE_HALF)
+        offset = Bayer2(frame & 3u);
+    else if (mode == RT_TRACE_QUARTER)
+        offset = 2 * Bayer2(frame & 3u) + Bayer2((frame >> 2u) & 3u);
+    else if (mode == RT_TRACE_CHECKERBOARD)
+        offset = ivec2((uint(tp.y) + frame) & 1u, 0);
+    return min(tp * TraceScale(mode) + offset, fullRes - 1);
+}
+
+#endif
@@ -0,0 +1,78 @@
+#ifndef SAMPLING_GLSL
+#define SAMPLING_GLSL
+
+// Sample sources shared by the RT passes (RTSampler on the CPU side).
+// Define SOBOL_SET/SOBOL_BINDING and/or BLUE_NOISE_SET/BLUE_NOISE_BINDING before
+// including; only the tables a shader binds are declared.
+//
+// Owen-scrambled Sobol follows Burley, "Practical Hash-based Owen Scrambling" (2020):
+// every 2D sample request gets its own scramble seed, so dimensions are padded from
+// independently scrambled copies of the first two Sobol dimensions.
+
+const uint SAMPLER_RANDOM     = 0u;
+const uint SAMPLER_SOBOL      = 1u;
+const uint SAMPLER_BLUE_NOISE = 2u;
+
+const uint BLUE_NOISE_SIZE = 64u;   // RTSampler::kBlueNoiseSize
+
+uint SamplerHash(uint v) {
+    uint state = v * 747796405u + 2891336453u;
+    uint word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+// Randomizes lower bits from higher ones only: a nested uniform scramble of the reversed value
+uint LaineKarrasPermutation(uint x, uint seed) {
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint NestedUniformScramble(uint x, uint seed) {
+    return bitfieldReverse(LaineKarrasPermutation(bitfieldReverse(x), seed));
+}
+
+#ifdef SOBOL_BINDING
+layout(std430, set = SOBOL_SET, binding = SOBOL_BINDING) readonly buffer SobolBuffer {
+    uint sobolDirections[];   // [dimension * 32 + bit]
+};
+
+// Point index of a per-pixel (0,2)-sequence: the index is shuffled and both
+// coordinates Owen-scrambled with seeds derived from the one given
+vec2 SobolOwen2D(uint index, uint seed) {
+    index = NestedUniformScramble(index, seed);
+    uvec2 x = uvec2(0u);
+    for (uint bit = 0u; index != 0u; bit++, index >>= 1u) {
+        if ((index & 1u) != 0u)
+            x ^= uvec2(sobolDirections[bit], sobolDirections[32u + bit]);
+    }
+    x.x = NestedUniformScramble(x.x, SamplerHash(seed ^ 0xa511e9b3u));
+    x.y = NestedUniformScramble(x.y, SamplerHash(seed ^ 0x63d83595u));
+    return vec2(x >> 8u) / 16777216.0;
+}
+
+// 2D sample `dimension` (bounce * purposes + purpose) of the pixel's sequence
+vec2 SobolSample2D(uint pixelKey, uint index, uint dimension) {
+    return SobolOwen2D(index, SamplerHash(pixelKey ^ SamplerHash(dimension + 1u)));
+}
+#endif
+
+#ifdef BLUE_NOISE_BINDING
+layout(set = BLUE_NOISE_SET, binding = BLUE_NOISE_BINDING) uniform sampler2D blueNoiseTex;
+
+// Spatiotemporal blue noise: each dimension reads the tile at an R2 offset, and each frame
+// rotates the values by the R2 step so a pixel's values over time are low-discrepancy too
+vec2 BlueNoise2D(ivec2 pixel, uint time, uint dimension) {
+    const vec2 r2 = vec2(0.75487766624669276, 0.56984029099805327);
+    ivec2 offset  = ivec2(fract(r2 * float(dimension >> 1u)) * float(BLUE_NOISE_SIZE));
+    ivec2 texel   = (pixel + offset) & ivec2(BLUE_NOISE_SIZE - 1u);
+    vec4  n       = texelFetch(blueNoiseTex, texel, 0);
+    vec2  v       = (dimension & 1u) != 0u ? n.ba : n.rg;
+    return fract(v + 0.5 / 256.0 + r2 * float(time % 4096u));
+}
+#endif
+
+#endif
@@ -1,13 +1,27 @@
 #version 450
 
+#extension GL_GOOGLE_include_directive : require
+
+#include "vertex_packing.glsl"
+
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
 layout(location = 2) in vec2 inTexCoord;
 
+// One instanced draw per mesh batch, world matrices from the draw's firstInstance on
+layout(std430, set = 0, binding = 0) readonly buffer InstanceSSBO {
+    mat4 instanceModels[];
+};
+
 layout(push_constant) uniform PushConstants {
-    mat4 mvp;
+    mat4 cascadeViewProj;
+    vec4 aabbMin;            // dequantization box for packed vertices
+    vec4 aabbMax;
 } pc;
 
 void main() {
-    gl_Position = pc.mvp * vec4(inPosition, 1.0);
+    vec3 position = PACKED_VERTICES
+        ? DequantizePosition(inPosition, pc.aabbMin.xyz, pc.aabbMax.xyz)
+        : inPosition;
+    gl_Position = pc.cascadeViewProj * instanceModels[gl_InstanceIndex] * vec4(position, 1.0);
 }
@@ -1,4 +1,7 @@
 #version 460
+#extension GL_GOOGLE_include_directive : require
+
+#include "vertex_packing.glsl"
 
 layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inNormal;
@@ -10,9 +13,9 @@ struct ObjectData {
     vec4  aabbMin;
     vec4  aabbMax;
     uint  materialIndex;
-    uint  _pad0;
-    uint  _pad1;
-    uint  _pad2;
+    uint  indexClass;
+    uint  flags;
+    uint  meshIndex;
 };
 
 layout(std430, set = 0, binding = 0) readonly buffer ObjectSSBO {
@@ -25,5 +28,8 @@ layout(push_constant) uniform PushConstants {
 
 void main() {
     ObjectData obj = objects[gl_BaseInstance];
-    gl_Position = pc.cascadeViewProj * obj.model * vec4(inPosition, 1.0);
+    vec3 position = PACKED_VERTICES
+        ? DequantizePosition(inPosition, obj.aabbMin.xyz, obj.aabbMax.xyz)
+        : inPosition;
+    gl_Position = pc.cascadeViewProj * obj.model * vec4(position, 1.0);
 }
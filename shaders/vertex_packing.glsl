@@ -0,0 +1,41 @@
+#ifndef VERTEX_PACKING_GLSL
+#define VERTEX_PACKING_GLSL
+
+// Decode helpers for the 20-byte PackedVertex layout (see GPU/VertexFormat.h).
+// Attribute fetch with the packed format yields:
+//   location 0 (vec4): SNORM position in [-1,1]^3 relative to the mesh AABB, w = tangent sign
+//   location 1 (xy)  : octahedral normal
+//   location 2 (xy)  : half-float UV
+//   location 3 (xy)  : octahedral tangent
+
+layout(constant_id = 0) const bool PACKED_VERTICES = false;
+
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.x += n.x >= 0.0 ? -t : t;
+    n.y += n.y >= 0.0 ? -t : t;
+    return normalize(n);
+}
+
+vec3 DequantizePosition(vec3 q, vec3 aabbMin, vec3 aabbMax) {
+    return (aabbMin + aabbMax) * 0.5 + q * ((aabbMax - aabbMin) * 0.5);
+}
+
+// Storage-buffer view of a PackedVertex (scalar layout, 5 words).
+struct PackedVertex {
+    uint positionXY;
+    uint positionZW;
+    uint normal;
+    uint tangent;
+    uint texCoord;
+};
+
+vec3 PackedNormal(PackedVertex v)  { return OctDecode(unpackSnorm2x16(v.normal)); }
+vec2 PackedUV(PackedVertex v)      { return unpackHalf2x16(v.texCoord); }
+vec4 PackedTangent(PackedVertex v) {
+    return vec4(OctDecode(unpackSnorm2x16(v.tangent)),
+                unpackSnorm2x16(v.positionZW).y < 0.0 ? -1.0 : 1.0);
+}
+
+#endif
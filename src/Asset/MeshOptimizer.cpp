@@ -0,0 +1,372 @@
+#include "Asset/MeshOptimizer.h"
+#include "Core/ThreadPool.h"
+#include "Core/Logger.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <unordered_map>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+
+// -----------------------------------------------------------------------
+// Cache simulation
+// -----------------------------------------------------------------------
+
+VertexCacheStats MeshOptimizer::AnalyzeVertexCache(const std::vector<uint32_t>& indices,
+                                                   size_t vertexCount, uint32_t cacheSize) {
+    VertexCacheStats stats;
+    stats.triangles = indices.size() / 3;
+
+    // FIFO: a vertex is resident while fewer than cacheSize misses happened since it was loaded
+    std::vector<uint64_t> loadedAt(vertexCount, 0);
+    std::vector<uint8_t>  seen(vertexCount, 0);
+    uint64_t clock = static_cast<uint64_t>(cacheSize) + 1;
+
+    for (uint32_t idx : indices) {
+        if (clock - loadedAt[idx] > cacheSize) {
+            loadedAt[idx] = clock++;
+            stats.misses++;
+        }
+        if (!seen[idx]) { seen[idx] = 1; stats.vertices++; }
+    }
+    return stats;
+}
+
+// -----------------------------------------------------------------------
+// Welding
+// -----------------------------------------------------------------------
+
+namespace {
+
+struct VertexHasher {
+    const std::vector<MeshVertex>* vertices;
+    size_t operator()(uint32_t i) const {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&(*vertices)[i]);
+        uint64_t h = 14695981039346656037ull;
+        for (size_t b = 0; b < sizeof(MeshVertex); b++) {
+            h ^= bytes[b];
+            h *= 1099511628211ull;
+        }
+        return static_cast<size_t>(h);
+    }
+};
+
+struct VertexEqual {
+    const std::vector<MeshVertex>* vertices;
+    bool operator()(uint32_t a, uint32_t b) const {
+        return std::memcmp(&(*vertices)[a], &(*vertices)[b], sizeof(MeshVertex)) == 0;
+    }
+};
+
+} // namespace
+
+void MeshOptimizer::WeldVertices(MeshData& mesh) {
+    const size_t count = mesh.vertices.size();
+    if (count == 0) return;
+
+    std::unordered_map<uint32_t, uint32_t, VertexHasher, VertexEqual> unique(
+        count, VertexHasher{&mesh.vertices}, VertexEqual{&mesh.vertices});
+
+    std::vector<uint32_t>   remap(count);
+    std::vector<MeshVertex> welded;
+    welded.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        auto it = unique.find(i);
+        if (it != unique.end()) {
+            remap[i] = it->second;
+        } else {
+            remap[i] = static_cast<uint32_t>(welded.size());
+            unique.emplace(i, remap[i]);
+            welded.push_back(mesh.vertices[i]);
+        }
+    }
+
+    for (auto& idx : mesh.indices) idx = remap[idx];
+    mesh.vertices = std::move(welded);
+}
+
+// -----------------------------------------------------------------------
+// Vertex cache ordering (Forsyth)
+// -----------------------------------------------------------------------
+
+static float ForsythVertexScore(int32_t cachePos, uint32_t remaining) {
+    if (remaining == 0) return -1.0f;
+
+    constexpr uint32_t kCache = MeshOptimizer::CACHE_SIZE;
+    float score = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3)
+            score = 0.75f;
+        else
+            score = std::pow(1.0f - float(cachePos - 3) / float(kCache - 3), 1.5f);
+    }
+    // Valence boost: favour vertices with few triangles left so they leave the cache early
+    score += 2.0f / std::sqrt(static_cast<float>(remaining));
+    return score;
+}
+
+void MeshOptimizer::OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount) {
+    const size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    // vertex -> triangle adjacency (CSR)
+    std::vector<uint32_t> remaining(vertexCount, 0);
+    for (uint32_t idx : indices) remaining[idx]++;
+
+    std::vector<uint32_t> offsets(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + remaining[v];
+
+    std::vector<uint32_t> adjacency(indices.size());
+    {
+        std::vector<uint32_t> cursor(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); i++)
+            adjacency[cursor[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<int32_t> cachePos(vertexCount, -1);
+    std::vector<float>   vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++)
+        vertexScore[v] = ForsythVertexScore(-1, remaining[v]);
+
+    std::vector<float>   triScore(triCount);
+    std::vector<uint8_t> emitted(triCount, 0);
+    for (size_t t = 0; t < triCount; t++)
+        triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] +
+                      vertexScore[indices[t * 3 + 2]];
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+
+    uint32_t cache[CACHE_SIZE + 3];
+    uint32_t cacheCount = 0;
+    size_t   scan       = 0;
+    int64_t  best       = -1;
+
+    auto updateVertex = [&](uint32_t v, int32_t pos, float& bestScore) {
+        cachePos[v] = pos;
+        float s     = ForsythVertexScore(pos, remaining[v]);
+        float delta = s - vertexScore[v];
+        vertexScore[v] = s;
+        for (uint32_t a = offsets[v]; a < offsets[v + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            triScore[t] += delta;
+            if (pos >= 0 && triScore[t] > bestScore) {
+                bestScore = triScore[t];
+                best      = t;
+            }
+        }
+    };
+
+    for (size_t n = 0; n < triCount; n++) {
+        if (best < 0) {
+            // Cache has nothing useful left: restart from the next unemitted triangle
+            while (emitted[scan]) scan++;
+            best = static_cast<int64_t>(scan);
+        }
+
+        const uint32_t t = static_cast<uint32_t>(best);
+        emitted[t] = 1;
+        const uint32_t* tri = &indices[t * 3];
+        out.insert(out.end(), tri, tri + 3);
+
+        uint32_t next[CACHE_SIZE + 3];
+        uint32_t nextCount = 0;
+        for (int k = 0; k < 3; k++) {
+            remaining[tri[k]]--;
+            if (std::find(next, next + nextCount, tri[k]) == next + nextCount)
+                next[nextCount++] = tri[k];
+        }
+        for (uint32_t i = 0; i < cacheCount; i++)
+            if (std::find(tri, tri + 3, cache[i]) == tri + 3)
+                next[nextCount++] = cache[i];
+
+        float bestScore = -1.0f;
+        best = -1;
+        for (uint32_t i = CACHE_SIZE; i < nextCount; i++)
+            updateVertex(next[i], -1, bestScore);
+
+        cacheCount = std::min(nextCount, CACHE_SIZE);
+        std::copy(next, next + cacheCount, cache);
+        for (uint32_t i = 0; i < cacheCount; i++)
+            updateVertex(cache[i], static_cast<int32_t>(i), bestScore);
+    }
+
+    indices = std::move(out);
+}
+
+// -----------------------------------------------------------------------
+// Overdraw ordering (Tipsify-style cluster sort)
+// -----------------------------------------------------------------------
+
+void MeshOptimizer::OptimizeOverdraw(std::vector<uint32_t>& indices,
+                                     const std::vector<MeshVertex>& vertices,
+                                     float threshold) {
+    const size_t triCount = indices.size() / 3;
+    if (triCount < 2) return;
+
+    // --- hard boundaries: triangles that miss on all three vertices start a new cluster ---
+    std::vector<uint32_t> hard;
+    {
+        std::vector<uint64_t> loadedAt(vertices.size(), 0);
+        uint64_t clock = CACHE_SIZE + 1;
+        for (size_t t = 0; t < triCount; t++) {
+            uint32_t misses = 0;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                if (clock - loadedAt[v] > CACHE_SIZE) { loadedAt[v] = clock++; misses++; }
+            }
+            if (t == 0 || misses == 3) hard.push_back(static_cast<uint32_t>(t));
+        }
+    }
+    hard.push_back(static_cast<uint32_t>(triCount));
+
+    // --- soft boundaries: split a hard cluster once its running ACMR is close to the cluster's ---
+    std::vector<uint32_t> clusters;
+    std::vector<uint64_t> loadedAt(vertices.size(), 0);
+    uint64_t clock = CACHE_SIZE + 1;
+    auto simulate = [&](size_t t) {
+        uint32_t misses = 0;
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = indices[t * 3 + k];
+            if (clock - loadedAt[v] > CACHE_SIZE) { loadedAt[v] = clock++; misses++; }
+        }
+        return misses;
+    };
+
+    for (size_t h = 0; h + 1 < hard.size(); h++) {
+        const uint32_t start = hard[h], end = hard[h + 1];
+
+        clock += CACHE_SIZE + 1;
+        uint32_t clusterMisses = 0;
+        for (uint32_t t = start; t < end; t++) clusterMisses += simulate(t);
+        const float clusterACMR = float(clusterMisses) / float(end - start);
+
+        clock += CACHE_SIZE + 1;
+        clusters.push_back(start);
+        uint32_t subStart = start, misses = 0;
+        for (uint32_t t = start; t < end; t++) {
+            misses += simulate(t);
+            float acmr = float(misses) / float(t - subStart + 1);
+            if (t + 1 < end && acmr <= clusterACMR * threshold) {
+                clusters.push_back(t + 1);
+                subStart = t + 1;
+                misses   = 0;
+                clock   += CACHE_SIZE + 1;
+            }
+        }
+    }
+    clusters.push_back(static_cast<uint32_t>(triCount));
+
+    // --- sort clusters so outward-facing ones are drawn first ---
+    glm::vec3 meshCentroid(0.0f);
+    for (const auto& v : vertices) meshCentroid += v.position;
+    if (!vertices.empty()) meshCentroid /= static_cast<float>(vertices.size());
+
+    const size_t clusterCount = clusters.size() - 1;
+    std::vector<float> sortKey(clusterCount);
+    for (size_t c = 0; c < clusterCount; c++) {
+        glm::vec3 centroid(0.0f), normal(0.0f);
+        float     area = 0.0f;
+        for (uint32_t t = clusters[c]; t < clusters[c + 1]; t++) {
+            const glm::vec3& p0 = vertices[indices[t * 3 + 0]].position;
+            const glm::vec3& p1 = vertices[indices[t * 3 + 1]].position;
+            const glm::vec3& p2 = vertices[indices[t * 3 + 2]].position;
+            glm::vec3 n = glm::cross(p1 - p0, p2 - p0);
+            float     a = glm::length(n);
+            centroid += (p0 + p1 + p2) * (a / 3.0f);
+            normal   += n;
+            area     += a;
+        }
+        if (area > 0.0f) centroid /= area;
+        float len = glm::length(normal);
+        if (len > 0.0f) normal /= len;
+        sortKey[c] = glm::dot(centroid - meshCentroid, normal);
+    }
+
+    std::vector<uint32_t> order(clusterCount);
+    std::iota(order.begin(), order.end(), 0u);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+    std::vector<uint32_t> out;
+    out.reserve(indices.size());
+    for (uint32_t c : order)
+        out.insert(out.end(), indices.begin() + clusters[c] * 3, indices.begin() + clusters[c + 1] * 3);
+    indices = std::move(out);
+}
+
+// -----------------------------------------------------------------------
+// Vertex fetch remap
+// -----------------------------------------------------------------------
+
+void MeshOptimizer::OptimizeVertexFetch(MeshData& mesh) {
+    std::vector<uint32_t>   remap(mesh.vertices.size(), UINT32_MAX);
+    std::vector<MeshVertex> ordered;
+    ordered.reserve(mesh.vertices.size());
+
+    for (auto& idx : mesh.indices) {
+        if (remap[idx] == UINT32_MAX) {
+            remap[idx] = static_cast<uint32_t>(ordered.size());
+            ordered.push_back(mesh.vertices[idx]);
+        }
+        idx = remap[idx];
+    }
+    mesh.vertices = std::move(ordered);
+}
+
+// -----------------------------------------------------------------------
+// Driver
+// -----------------------------------------------------------------------
+
+void MeshOptimizer::OptimizeMesh(MeshData& mesh) {
+    if (mesh.indices.size() < 3) return;
+    WeldVertices(mesh);
+    OptimizeVertexCache(mesh.indices, mesh.vertices.size());
+    OptimizeOverdraw(mesh.indices, mesh.vertices);
+    OptimizeVertexFetch(mesh);
+}
+
+MeshOptimizeReport MeshOptimizer::OptimizeMeshes(std::vector<MeshData>& meshes, ThreadPool* pool) {
+    auto t0 = std::chrono::high_resolution_clock::now();
+
+    struct PerMesh { VertexCacheStats before, after; size_t vBefore = 0, vAfter = 0; };
+    std::vector<PerMesh> results(meshes.size());
+
+    auto optimize = [&meshes, &results](size_t i) {
+        MeshData& mesh = meshes[i];
+        results[i].vBefore = mesh.vertices.size();
+        results[i].before  = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+        OptimizeMesh(mesh);
+        results[i].vAfter  = mesh.vertices.size();
+        results[i].after   = AnalyzeVertexCache(mesh.indices, mesh.vertices.size());
+    };
+    // One chunk per worker; mesh sizes vary, so each claims meshes from a shared counter
+    std::atomic<size_t> next{0};
+    uint32_t workers = ParallelChunkCount(pool, meshes.size());
+    ParallelForChunks(pool, workers, workers, [&](uint32_t, size_t, size_t) {
+        for (size_t i; (i = next.fetch_add(1)) < meshes.size();)
+            optimize(i);
+    });
+
+    MeshOptimizeReport report;
+    for (const auto& r : results) {
+        report.before.Add(r.before);
+        report.after.Add(r.after);
+        report.verticesBefore += r.vBefore;
+        report.verticesAfter  += r.vAfter;
+    }
+    report.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::high_resolution_clock::now() - t0).count();
+
+    LOG_INFO("Mesh optimization: {} meshes in {:.1f} ms, ACMR {:.3f} -> {:.3f}, "
+             "ATVR {:.3f} -> {:.3f}, vertices {} -> {}",
+             meshes.size(), report.milliseconds,
+             report.before.ACMR(), report.after.ACMR(),
+             report.before.ATVR(), report.after.ATVR(),
+             report.verticesBefore, report.verticesAfter);
+    return report;
+}
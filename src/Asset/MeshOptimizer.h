@@ -0,0 +1,62 @@
+#pragma once
+
+#include "Asset/ModelLoader.h"
+
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/// Post-transform vertex cache statistics from a FIFO cache simulation.
+struct VertexCacheStats {
+    uint64_t triangles = 0;
+    uint64_t vertices  = 0;
+    uint64_t misses    = 0;
+
+    float ACMR() const { return triangles ? float(misses) / float(triangles) : 0.0f; } // misses per triangle
+    float ATVR() const { return vertices  ? float(misses) / float(vertices)  : 0.0f; } // misses per vertex
+
+    void Add(const VertexCacheStats& o) {
+        triangles += o.triangles; vertices += o.vertices; misses += o.misses;
+    }
+};
+
+struct MeshOptimizeReport {
+    VertexCacheStats before;
+    VertexCacheStats after;
+    uint64_t verticesBefore = 0;
+    uint64_t verticesAfter  = 0;
+    double   milliseconds   = 0.0;
+};
+
+/// Import-time mesh optimization: weld -> vertex cache order -> overdraw order -> fetch remap.
+class MeshOptimizer {
+public:
+    static constexpr uint32_t CACHE_SIZE        = 32;
+    static constexpr float    OVERDRAW_THRESHOLD = 1.05f;
+
+    /// Optimizes every mesh, one pool task each, and returns aggregated before/after
+    /// statistics. pool may be null.
+    static MeshOptimizeReport OptimizeMeshes(std::vector<MeshData>& meshes, ThreadPool* pool);
+    static void               OptimizeMesh(MeshData& mesh);
+
+    /// Merges bit-identical vertices and rewrites the index buffer.
+    static void WeldVertices(MeshData& mesh);
+
+    /// Forsyth-style linear-speed vertex cache optimization.
+    static void OptimizeVertexCache(std::vector<uint32_t>& indices, size_t vertexCount);
+
+    /// Tipsify-style cluster sort: keeps cache order inside clusters and draws
+    /// outward-facing clusters first. Expects cache-optimized input.
+    static void OptimizeOverdraw(std::vector<uint32_t>& indices,
+                                 const std::vector<MeshVertex>& vertices,
+                                 float threshold = OVERDRAW_THRESHOLD);
+
+    /// Reorders vertices into first-use order and drops unreferenced ones.
+    static void OptimizeVertexFetch(MeshData& mesh);
+
+    /// FIFO post-transform cache simulator.
+    static VertexCacheStats AnalyzeVertexCache(const std::vector<uint32_t>& indices,
+                                               size_t vertexCount,
+                                               uint32_t cacheSize = CACHE_SIZE);
+};
@@ -0,0 +1,470 @@
+#include "Asset/MeshSimplifier.h"
+#include "Asset/MeshOptimizer.h"
+#include "Core/ThreadPool.h"
+#include "Core/Logger.h"
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <atomic>
+#include <unordered_map>
+#include <chrono>
+#include <cstring>
+#include <cmath>
+
+namespace {
+
+// -----------------------------------------------------------------------
+// Quadrics
+// -----------------------------------------------------------------------
+
+/// Symmetric 4x4 sum of weighted squared plane distances, plus the total weight.
+struct Quadric {
+    double a00 = 0, a01 = 0, a02 = 0, a03 = 0;
+    double a11 = 0, a12 = 0, a13 = 0;
+    double a22 = 0, a23 = 0;
+    double a33 = 0;
+    double weight = 0;
+
+    void AddPlane(const glm::dvec3& n, double d, double w) {
+        a00 += w * n.x * n.x; a01 += w * n.x * n.y; a02 += w * n.x * n.z; a03 += w * n.x * d;
+        a11 += w * n.y * n.y; a12 += w * n.y * n.z; a13 += w * n.y * d;
+        a22 += w * n.z * n.z; a23 += w * n.z * d;
+        a33 += w * d * d;
+        weight += w;
+    }
+
+    Quadric& operator+=(const Quadric& o) {
+        a00 += o.a00; a01 += o.a01; a02 += o.a02; a03 += o.a03;
+        a11 += o.a11; a12 += o.a12; a13 += o.a13;
+        a22 += o.a22; a23 += o.a23;
+        a33 += o.a33;
+        weight += o.weight;
+        return *this;
+    }
+
+    double Evaluate(const glm::dvec3& p) const {
+        double r = a00 * p.x * p.x + 2.0 * a01 * p.x * p.y + 2.0 * a02 * p.x * p.z + 2.0 * a03 * p.x
+                 + a11 * p.y * p.y + 2.0 * a12 * p.y * p.z + 2.0 * a13 * p.y
+                 + a22 * p.z * p.z + 2.0 * a23 * p.z
+                 + a33;
+        return std::max(r, 0.0);
+    }
+};
+
+// Border edges get a perpendicular constraint plane so open boundaries keep their shape
+constexpr double kBorderWeight   = 10.0;
+// A collapse may not turn any remaining triangle's normal by more than ~78 degrees
+constexpr double kMinNormalDot   = 0.2;
+constexpr uint32_t kInvalid      = ~0u;
+
+enum VertexKind : uint8_t {
+    KIND_MANIFOLD = 0,   // may collapse onto any neighbour
+    KIND_BORDER,         // on one open boundary: may collapse along it only
+    KIND_LOCKED,         // attribute seam or non-manifold: never moves
+};
+
+struct Candidate {
+    double   error;
+    uint32_t from;   // position ids
+    uint32_t to;
+
+    bool operator<(const Candidate& o) const {
+        if (error != o.error) return error < o.error;
+        if (from != o.from)   return from < o.from;
+        return to < o.to;
+    }
+};
+
+// -----------------------------------------------------------------------
+// Simplifier state
+// -----------------------------------------------------------------------
+
+/// Works on welded positions: vertices with identical positions share a
+/// position id, so seams do not look like borders. Triangles keep their
+/// original vertex indices, which is what the output references.
+class Simplifier {
+public:
+    Simplifier(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices);
+
+    /// Collapses until at most targetTriangles remain or nothing valid is left.
+    void Run(size_t targetTriangles);
+
+    std::vector<uint32_t> Indices() const;
+    size_t TriangleCount() const { return mLiveTriangles; }
+    float  Error()         const { return static_cast<float>(mError); }
+
+private:
+    bool Pass(size_t targetTriangles);
+    bool TryCollapse(const Candidate& c, std::vector<uint8_t>& touched);
+
+    uint32_t Pos(uint32_t tri, uint32_t k) const { return mVertexPos[mCorners[tri * 3 + k]]; }
+
+    std::vector<glm::dvec3> mPositions;     // per position id
+    std::vector<uint32_t>   mVertexPos;     // vertex -> position id
+    std::vector<uint8_t>    mSeam;          // per position id: several vertices share it
+    std::vector<Quadric>    mQuadrics;      // per position id
+    std::vector<uint32_t>   mCorners;       // 3 vertex indices per triangle
+    std::vector<uint8_t>    mAlive;         // per triangle
+    size_t                  mLiveTriangles = 0;
+    double                  mError         = 0.0;
+
+    // Rebuilt every pass: position -> live triangles (CSR), sorted edges with use counts
+    std::vector<uint32_t> mAdjOffsets;
+    std::vector<uint32_t> mAdjacency;
+    std::vector<uint64_t> mEdges;
+    std::vector<uint32_t> mEdgeUses;
+    std::vector<uint8_t>  mKind;
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b) {
+    return a < b ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+}
+
+glm::dvec3 TriangleNormal(const glm::dvec3& p0, const glm::dvec3& p1, const glm::dvec3& p2) {
+    return glm::cross(p1 - p0, p2 - p0);
+}
+
+Simplifier::Simplifier(const std::vector<MeshVertex>& vertices, const std::vector<uint32_t>& indices) {
+    // --- weld positions (bit-exact) ---
+    struct PosKey { float x, y, z; };
+    struct PosHash {
+        size_t operator()(const PosKey& k) const {
+            uint32_t b[3];
+            std::memcpy(b, &k, sizeof(b));
+            return size_t(b[0]) * 73856093u ^ size_t(b[1]) * 19349663u ^ size_t(b[2]) * 83492791u;
+        }
+    };
+    struct PosEq {
+        bool operator()(const PosKey& a, const PosKey& b) const { return std::memcmp(&a, &b, sizeof(PosKey)) == 0; }
+    };
+    std::unordered_map<PosKey, uint32_t, PosHash, PosEq> unique(vertices.size());
+
+    mVertexPos.resize(vertices.size());
+    std::vector<uint32_t> firstVertex;
+    for (uint32_t v = 0; v < vertices.size(); v++) {
+        const glm::vec3& p = vertices[v].position;
+        auto [it, inserted] = unique.emplace(PosKey{p.x, p.y, p.z}, static_cast<uint32_t>(mPositions.size()));
+        if (inserted) {
+            mPositions.push_back(glm::dvec3(p));
+            firstVertex.push_back(v);
+        }
+        mVertexPos[v] = it->second;
+    }
+
+    // A position is a seam when the triangles reference more than one of its vertices
+    mSeam.assign(mPositions.size(), 0);
+    std::vector<uint32_t> usedVertex(mPositions.size(), kInvalid);
+
+    // --- triangles and plane quadrics; triangles without three distinct positions are dropped ---
+    mQuadrics.resize(mPositions.size());
+    const size_t triCount = indices.size() / 3;
+    mCorners.reserve(triCount * 3);
+    for (size_t t = 0; t < triCount; t++) {
+        const uint32_t* tri = &indices[t * 3];
+        uint32_t p0 = mVertexPos[tri[0]], p1 = mVertexPos[tri[1]], p2 = mVertexPos[tri[2]];
+        if (p0 == p1 || p1 == p2 || p0 == p2) continue;
+
+        for (int k = 0; k < 3; k++) {
+            uint32_t p = mVertexPos[tri[k]];
+            if (usedVertex[p] == kInvalid)   usedVertex[p] = tri[k];
+            else if (usedVertex[p] != tri[k]) mSeam[p] = 1;
+        }
+
+        glm::dvec3 n = TriangleNormal(mPositions[p0], mPositions[p1], mPositions[p2]);
+        double len = glm::length(n);
+        if (len > 0.0) {
+            n /= len;
+            double area = 0.5 * len;
+            double d    = -glm::dot(n, mPositions[p0]);
+            mQuadrics[p0].AddPlane(n, d, area);
+            mQuadrics[p1].AddPlane(n, d, area);
+            mQuadrics[p2].AddPlane(n, d, area);
+        }
+        mCorners.insert(mCorners.end(), tri, tri + 3);
+    }
+    mAlive.assign(mCorners.size() / 3, 1);
+    mLiveTriangles = mAlive.size();
+
+    // --- border constraint planes ---
+    std::vector<uint64_t> edges;
+    edges.reserve(mCorners.size());
+    for (uint32_t t = 0; t < mAlive.size(); t++)
+        for (uint32_t k = 0; k < 3; k++)
+            edges.push_back(EdgeKey(Pos(t, k), Pos(t, (k + 1) % 3)));
+    std::vector<uint64_t> sorted = edges;
+    std::sort(sorted.begin(), sorted.end());
+    for (uint32_t t = 0; t < mAlive.size(); t++) {
+        for (uint32_t k = 0; k < 3; k++) {
+            uint64_t key = edges[t * 3 + k];
+            auto range = std::equal_range(sorted.begin(), sorted.end(), key);
+            if (range.second - range.first != 1) continue;
+
+            uint32_t a = Pos(t, k), b = Pos(t, (k + 1) % 3), c = Pos(t, (k + 2) % 3);
+            glm::dvec3 edge = mPositions[b] - mPositions[a];
+            glm::dvec3 n    = glm::cross(TriangleNormal(mPositions[a], mPositions[b], mPositions[c]), edge);
+            double len = glm::length(n);
+            if (len <= 0.0) continue;
+            n /= len;
+            double d = -glm::dot(n, mPositions[a]);
+            double w = kBorderWeight * glm::dot(edge, edge);
+            mQuadrics[a].AddPlane(n, d, w);
+            mQuadrics[b].AddPlane(n, d, w);
+        }
+    }
+}
+
+void Simplifier::Run(size_t targetTriangles) {
+    while (mLiveTriangles > targetTriangles && Pass(targetTriangles)) {}
+}
+
+std::vector<uint32_t> Simplifier::Indices() const {
+    std::vector<uint32_t> out;
+    out.reserve(mLiveTriangles * 3);
+    for (uint32_t t = 0; t < mAlive.size(); t++)
+        if (mAlive[t]) out.insert(out.end(), &mCorners[t * 3], &mCorners[t * 3] + 3);
+    return out;
+}
+
+// One round of independent collapses: every collapse locks the one-ring it
+// changed, so the candidates computed at the start of the pass stay valid.
+bool Simplifier::Pass(size_t targetTriangles) {
+    const uint32_t posCount = static_cast<uint32_t>(mPositions.size());
+
+    // --- position -> live triangle adjacency ---
+    mAdjOffsets.assign(posCount + 1, 0);
+    for (uint32_t t = 0; t < mAlive.size(); t++)
+        if (mAlive[t])
+            for (uint32_t k = 0; k < 3; k++) mAdjOffsets[Pos(t, k) + 1]++;
+    for (uint32_t p = 0; p < posCount; p++) mAdjOffsets[p + 1] += mAdjOffsets[p];
+    mAdjacency.resize(mAdjOffsets[posCount]);
+    {
+        std::vector<uint32_t> cursor(mAdjOffsets.begin(), mAdjOffsets.end() - 1);
+        for (uint32_t t = 0; t < mAlive.size(); t++)
+            if (mAlive[t])
+                for (uint32_t k = 0; k < 3; k++) mAdjacency[cursor[Pos(t, k)]++] = t;
+    }
+
+    // --- unique edges with the number of triangles using them ---
+    std::vector<uint64_t> all;
+    all.reserve(mLiveTriangles * 3);
+    for (uint32_t t = 0; t < mAlive.size(); t++)
+        if (mAlive[t])
+            for (uint32_t k = 0; k < 3; k++) all.push_back(EdgeKey(Pos(t, k), Pos(t, (k + 1) % 3)));
+    std::sort(all.begin(), all.end());
+    mEdges.clear();
+    mEdgeUses.clear();
+    for (uint64_t key : all) {
+        if (!mEdges.empty() && mEdges.back() == key) { mEdgeUses.back()++; continue; }
+        mEdges.push_back(key);
+        mEdgeUses.push_back(1);
+    }
+
+    // --- classify positions ---
+    std::vector<uint8_t> borderEdges(posCount, 0);
+    mKind.assign(posCount, KIND_MANIFOLD);
+    for (size_t e = 0; e < mEdges.size(); e++) {
+        uint32_t a = static_cast<uint32_t>(mEdges[e] >> 32), b = static_cast<uint32_t>(mEdges[e]);
+        if (mEdgeUses[e] > 2) {
+            mKind[a] = mKind[b] = KIND_LOCKED;
+        } else if (mEdgeUses[e] == 1) {
+            borderEdges[a] = static_cast<uint8_t>(std::min(borderEdges[a] + 1, 255));
+            borderEdges[b] = static_cast<uint8_t>(std::min(borderEdges[b] + 1, 255));
+        }
+    }
+    for (uint32_t p = 0; p < posCount; p++) {
+        if (mSeam[p] || borderEdges[p] > 2) mKind[p] = KIND_LOCKED;
+        else if (borderEdges[p] && mKind[p] != KIND_LOCKED) mKind[p] = KIND_BORDER;
+    }
+
+    // --- candidates: the cheaper direction of every edge that can collapse ---
+    std::vector<Candidate> candidates;
+    candidates.reserve(mEdges.size());
+    for (size_t e = 0; e < mEdges.size(); e++) {
+        uint32_t p = static_cast<uint32_t>(mEdges[e] >> 32), q = static_cast<uint32_t>(mEdges[e]);
+        Quadric sum = mQuadrics[p];
+        sum += mQuadrics[q];
+        const double norm = sum.weight > 0.0 ? 1.0 / sum.weight : 0.0;
+
+        Candidate best{0.0, kInvalid, kInvalid};
+        auto consider = [&](uint32_t from, uint32_t to) {
+            if (mKind[from] == KIND_LOCKED) return;
+            if (mKind[from] == KIND_BORDER && mEdgeUses[e] != 1) return;
+            Candidate c{std::sqrt(sum.Evaluate(mPositions[to]) * norm), from, to};
+            if (best.from == kInvalid || c < best) best = c;
+        };
+        consider(p, q);
+        consider(q, p);
+        if (best.from != kInvalid) candidates.push_back(best);
+    }
+    std::sort(candidates.begin(), candidates.end());
+
+    std::vector<uint8_t> touched(posCount, 0);
+    bool progress = false;
+    for (const Candidate& c : candidates) {
+        if (mLiveTriangles <= targetTriangles) break;
+        if (touched[c.from] || touched[c.to]) continue;
+        if (TryCollapse(c, touched)) progress = true;
+    }
+    return progress;
+}
+
+bool Simplifier::TryCollapse(const Candidate& c, std::vector<uint8_t>& touched) {
+    const uint32_t a = c.from, b = c.to;
+    const uint32_t* trisA    = mAdjacency.data() + mAdjOffsets[a];
+    const uint32_t  trisACnt = mAdjOffsets[a + 1] - mAdjOffsets[a];
+
+    // The triangles on edge ab decide which of b's vertices the rest of a's fan switches to;
+    // a is not a seam, so they all lie in one attribute chart
+    uint32_t bVertex = kInvalid;
+    uint32_t shared  = 0;
+    std::vector<uint32_t> ringA;
+    for (uint32_t i = 0; i < trisACnt; i++) {
+        uint32_t t = trisA[i];
+        bool hasB = false;
+        for (uint32_t k = 0; k < 3; k++) {
+            uint32_t p = Pos(t, k);
+            if (p == b) {
+                hasB = true;
+                uint32_t v = mCorners[t * 3 + k];
+                if (bVertex != kInvalid && bVertex != v) return false;
+                bVertex = v;
+            } else if (p != a) {
+                ringA.push_back(p);
+            }
+        }
+        shared += hasB ? 1u : 0u;
+    }
+    if (shared == 0 || bVertex == kInvalid) return false;
+
+    // Link condition: a and b may only share the neighbours opposite edge ab
+    std::sort(ringA.begin(), ringA.end());
+    ringA.erase(std::unique(ringA.begin(), ringA.end()), ringA.end());
+    std::vector<uint32_t> ringB;
+    for (uint32_t i = mAdjOffsets[b]; i < mAdjOffsets[b + 1]; i++) {
+        uint32_t t = mAdjacency[i];
+        for (uint32_t k = 0; k < 3; k++) {
+            uint32_t p = Pos(t, k);
+            if (p != a && p != b) ringB.push_back(p);
+        }
+    }
+    std::sort(ringB.begin(), ringB.end());
+    ringB.erase(std::unique(ringB.begin(), ringB.end()), ringB.end());
+    uint32_t common = 0;
+    for (size_t i = 0, j = 0; i < ringA.size() && j < ringB.size();) {
+        if      (ringA[i] < ringB[j]) i++;
+        else if (ringB[j] < ringA[i]) j++;
+        else { common++; i++; j++; }
+    }
+    if (common != shared) return false;
+
+    // Fold-over: the triangles that survive must keep roughly their orientation
+    for (uint32_t i = 0; i < trisACnt; i++) {
+        uint32_t t = trisA[i];
+        glm::dvec3 before[3], after[3];
+        bool hasB = false;
+        for (uint32_t k = 0; k < 3; k++) {
+            uint32_t p = Pos(t, k);
+            hasB |= (p == b);
+            before[k] = mPositions[p];
+            after[k]  = mPositions[p == a ? b : p];
+        }
+        if (hasB) continue;
+        glm::dvec3 n0 = TriangleNormal(before[0], before[1], before[2]);
+        glm::dvec3 n1 = TriangleNormal(after[0], after[1], after[2]);
+        double l0 = glm::length(n0), l1 = glm::length(n1);
+        if (l1 <= 0.0) return false;
+        if (l0 > 0.0 && glm::dot(n0, n1) < kMinNormalDot * l0 * l1) return false;
+    }
+
+    // --- apply ---
+    for (uint32_t i = 0; i < trisACnt; i++) {
+        uint32_t t = trisA[i];
+        bool hasB = false;
+        for (uint32_t k = 0; k < 3; k++) hasB |= (Pos(t, k) == b);
+        if (hasB) {
+            mAlive[t] = 0;
+            mLiveTriangles--;
+            continue;
+        }
+        for (uint32_t k = 0; k < 3; k++)
+            if (Pos(t, k) == a) mCorners[t * 3 + k] = bVertex;
+    }
+    mQuadrics[b] += mQuadrics[a];
+    mError = std::max(mError, c.error);
+
+    touched[a] = touched[b] = 1;
+    for (uint32_t p : ringA) touched[p] = 1;
+    return true;
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------
+// Public interface
+// -----------------------------------------------------------------------
+
+std::vector<uint32_t> MeshSimplifier::Simplify(const std::vector<MeshVertex>& vertices,
+                                               const std::vector<uint32_t>& indices,
+                                               size_t targetIndexCount, float& outError) {
+    Simplifier s(vertices, indices);
+    s.Run(targetIndexCount / 3);
+    outError = s.Error();
+    return s.Indices();
+}
+
+void MeshSimplifier::BuildLODChain(MeshData& mesh) {
+    mesh.lods.clear();
+    const size_t triangles = mesh.indices.size() / 3;
+    if (triangles < MIN_TRIANGLES) return;
+
+    Simplifier s(mesh.vertices, mesh.indices);
+    size_t previous = triangles;
+    for (uint32_t level = 1; level < MAX_LODS; level++) {
+        size_t target = static_cast<size_t>(double(previous) * LEVEL_RATIO);
+        s.Run(target);
+        if (double(s.TriangleCount()) > double(previous) * MIN_LEVEL_RATIO || s.TriangleCount() == 0) break;
+
+        MeshLODData lod;
+        lod.indices = s.Indices();
+        lod.error   = s.Error();
+        MeshOptimizer::OptimizeVertexCache(lod.indices, mesh.vertices.size());
+        mesh.lods.push_back(std::move(lod));
+        previous = s.TriangleCount();
+    }
+}
+
+MeshLODReport MeshSimplifier::GenerateLODs(std::vector<MeshData>& meshes, ThreadPool* pool) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    // One chunk per worker; each claims meshes from a shared counter
+    std::atomic<size_t> next{0};
+    uint32_t workers = ParallelChunkCount(pool, meshes.size());
+    ParallelForChunks(pool, workers, workers, [&](uint32_t, size_t, size_t) {
+        for (size_t i; (i = next.fetch_add(1)) < meshes.size();)
+            BuildLODChain(meshes[i]);
+    });
+
+    MeshLODReport report;
+    report.meshes = meshes.size();
+    for (const auto& m : meshes) {
+        if (!m.lods.empty()) report.meshesWithLODs++;
+        uint64_t tris = m.indices.size() / 3;
+        report.triangles[0] += tris;
+        for (uint32_t level = 1; level < MAX_LODS; level++) {
+            if (level <= m.lods.size()) {
+                tris = m.lods[level - 1].indices.size() / 3;
+                report.maxError = std::max(report.maxError, m.lods[level - 1].error);
+            }
+            report.triangles[level] += tris;
+        }
+    }
+    report.milliseconds = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    LOG_INFO("LOD generation: {} of {} meshes simplified in {:.1f} ms, triangles {} / {} / {} / {}, "
+             "max error {:.4f}",
+             report.meshesWithLODs, report.meshes, report.milliseconds,
+             report.triangles[0], report.triangles[1], report.triangles[2], report.triangles[3],
+             report.maxError);
+    return report;
+}
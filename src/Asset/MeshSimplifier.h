@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Asset/ModelLoader.h"
+
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/// LOD chain generation results summed over all meshes.
+struct MeshLODReport {
+    static constexpr uint32_t MAX_LEVELS = 4;   // LOD0 included
+
+    uint64_t meshes                = 0;
+    uint64_t meshesWithLODs        = 0;
+    uint64_t triangles[MAX_LEVELS] = {};     // per level; a mesh missing a level counts its coarsest one
+    float    maxError              = 0.0f;   // largest object-space error of any generated level
+    double   milliseconds          = 0.0;
+};
+
+/// Offline quadric-error-metric simplification (Garland-Heckbert) by half-edge
+/// collapse onto existing vertices, so every LOD indexes the mesh's own vertex
+/// buffer. Vertices on UV/normal seams stay put, open borders only slide along
+/// themselves, and collapses that fold a triangle over are rejected. The result
+/// depends only on the input: candidates are ordered by (cost, vertex ids).
+class MeshSimplifier {
+public:
+    static constexpr uint32_t MAX_LODS        = MeshLODReport::MAX_LEVELS;
+    static constexpr uint32_t MIN_TRIANGLES   = 64;     // smaller meshes get no LODs
+    static constexpr float    LEVEL_RATIO     = 0.5f;   // triangle target per level
+    static constexpr float    MIN_LEVEL_RATIO = 0.8f;   // a level must get below this of the previous one
+
+    /// Simplifies toward targetIndexCount indices. outError receives the RMS
+    /// distance (object space) of the collapsed vertices to their original planes.
+    static std::vector<uint32_t> Simplify(const std::vector<MeshVertex>& vertices,
+                                          const std::vector<uint32_t>& indices,
+                                          size_t targetIndexCount, float& outError);
+
+    /// Replaces mesh.lods with up to MAX_LODS - 1 cache-optimized levels, each
+    /// continuing from the previous one so errors grow monotonically.
+    static void BuildLODChain(MeshData& mesh);
+
+    /// BuildLODChain for every mesh, one pool task each. pool may be null.
+    static MeshLODReport GenerateLODs(std::vector<MeshData>& meshes, ThreadPool* pool);
+};
@@ -0,0 +1,205 @@
+#include "Asset/MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+
+// -----------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------
+
+static glm::vec3 TriangleNormal(const glm::vec3& a, const glm::vec3& b, const glm::vec3& c) {
+    return glm::cross(b - a, c - a);
+}
+
+static void OrthoBasis(const glm::vec3& n, glm::vec3& t, glm::vec3& b) {
+    t = std::abs(n.x) < 0.9f ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    t = glm::normalize(glm::cross(n, t));
+    b = glm::cross(n, t);
+}
+
+// Ritter's sphere: start from the most separated pair of axis extremes, then grow.
+static void BoundingSphere(const std::vector<glm::vec3>& points, glm::vec3& center, float& radius) {
+    size_t minIdx[3] = {0, 0, 0};
+    size_t maxIdx[3] = {0, 0, 0};
+    for (size_t i = 1; i < points.size(); i++) {
+        for (int a = 0; a < 3; a++) {
+            if (points[i][a] < points[minIdx[a]][a]) minIdx[a] = i;
+            if (points[i][a] > points[maxIdx[a]][a]) maxIdx[a] = i;
+        }
+    }
+
+    int   axis = 0;
+    float span = -1.0f;
+    for (int a = 0; a < 3; a++) {
+        glm::vec3 d = points[maxIdx[a]] - points[minIdx[a]];
+        float len = glm::dot(d, d);
+        if (len > span) { span = len; axis = a; }
+    }
+
+    center = (points[minIdx[axis]] + points[maxIdx[axis]]) * 0.5f;
+    radius = std::sqrt(span) * 0.5f;
+
+    for (const auto& p : points) {
+        float d = glm::length(p - center);
+        if (d > radius) {
+            float r = (radius + d) * 0.5f;
+            center += (p - center) * ((r - radius) / d);
+            radius  = r;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+// Build
+// -----------------------------------------------------------------------
+
+void MeshletBuilder::Build(const MeshData& mesh, std::vector<Meshlet>& out, MeshletStats& stats) {
+    const uint32_t triCount = static_cast<uint32_t>(mesh.indices.size() / 3);
+    if (triCount == 0) return;
+
+    // stamp[v] == current meshlet id + 1 while v is part of it
+    std::vector<uint32_t> stamp(mesh.vertices.size(), 0);
+    uint32_t id = 1;
+
+    Meshlet current{};
+    auto flush = [&](uint32_t nextTriangle) {
+        if (current.triangleCount == 0) return;
+        ComputeBounds(mesh, current);
+        stats.meshlets++;
+        stats.triangles += current.triangleCount;
+        stats.vertices  += current.vertexCount;
+        if (current.coneCutoff < 1.0f) stats.coneCullable++;
+        out.push_back(current);
+
+        current = {};
+        current.firstTriangle = nextTriangle;
+        id++;
+    };
+
+    for (uint32_t t = 0; t < triCount; t++) {
+        const uint32_t* tri = &mesh.indices[t * 3];
+
+        uint32_t newVerts = 0;
+        for (int k = 0; k < 3; k++) {
+            bool dup = (k > 0 && tri[k] == tri[0]) || (k > 1 && tri[k] == tri[1]);
+            if (stamp[tri[k]] != id && !dup) newVerts++;
+        }
+
+        if (current.vertexCount + newVerts > MAX_VERTICES || current.triangleCount + 1 > MAX_TRIANGLES)
+            flush(t);
+
+        for (int k = 0; k < 3; k++) {
+            if (stamp[tri[k]] != id) {
+                stamp[tri[k]] = id;
+                current.vertexCount++;
+            }
+        }
+        current.triangleCount++;
+    }
+    flush(triCount);
+}
+
+void MeshletBuilder::ComputeBounds(const MeshData& mesh, Meshlet& m) {
+    std::vector<glm::vec3> points;
+    points.reserve(m.triangleCount * 3);
+    for (uint32_t t = 0; t < m.triangleCount; t++)
+        for (int k = 0; k < 3; k++)
+            points.push_back(mesh.vertices[mesh.indices[(m.firstTriangle + t) * 3 + k]].position);
+
+    BoundingSphere(points, m.center, m.radius);
+
+    // Cone axis: average of the unit triangle normals
+    glm::vec3 axis(0.0f);
+    std::vector<glm::vec3> normals(m.triangleCount, glm::vec3(0.0f));
+    for (uint32_t t = 0; t < m.triangleCount; t++) {
+        glm::vec3 n = TriangleNormal(points[t * 3], points[t * 3 + 1], points[t * 3 + 2]);
+        float len = glm::length(n);
+        if (len > 0.0f) {
+            normals[t] = n / len;
+            axis += normals[t];
+        }
+    }
+
+    m.coneApex   = m.center;
+    m.coneAxis   = glm::vec3(0.0f, 0.0f, 1.0f);
+    m.coneCutoff = 1.0f;
+
+    float axisLen = glm::length(axis);
+    if (axisLen <= 0.0f) return;
+    axis /= axisLen;
+
+    float minDot = 1.0f;
+    for (const auto& n : normals)
+        if (glm::dot(n, n) > 0.0f) minDot = std::min(minDot, glm::dot(n, axis));
+
+    // Normals spread over more than ~84 degrees: the cone would never reject anything
+    if (minDot <= 0.1f) {
+        m.coneAxis = axis;
+        return;
+    }
+
+    // Move the apex back along the axis until it is behind every triangle plane
+    float maxT = 0.0f;
+    for (uint32_t t = 0; t < m.triangleCount; t++) {
+        if (glm::dot(normals[t], normals[t]) <= 0.0f) continue;
+        float dc = glm::dot(m.center - points[t * 3], normals[t]);
+        float dn = glm::dot(axis, normals[t]);
+        maxT = std::max(maxT, dc / dn);
+    }
+
+    m.coneApex   = m.center - axis * maxT;
+    m.coneAxis   = axis;
+    m.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+// -----------------------------------------------------------------------
+// Cone test
+// -----------------------------------------------------------------------
+
+bool MeshletBuilder::IsConeBackfacing(const glm::vec3& apex, const glm::vec3& axis, float cutoff,
+                                      const glm::vec3& cameraPos) {
+    glm::vec3 v = apex - cameraPos;
+    float len = glm::length(v);
+    if (len <= 0.0f) return cutoff < 1.0f;
+    return glm::dot(v / len, axis) >= cutoff;
+}
+
+MeshletConeCheck MeshletBuilder::ValidateCone(const MeshData& mesh, const Meshlet& m) {
+    MeshletConeCheck check;
+    if (m.coneCutoff >= 1.0f) return check;
+
+    glm::vec3 t, b;
+    OrthoBasis(m.coneAxis, t, b);
+
+    // Directions from the camera towards the apex: the axis, plus four just inside the cone edge
+    float cosA = std::min(1.0f, m.coneCutoff + (1.0f - m.coneCutoff) * 1e-3f);
+    float sinA = std::sqrt(1.0f - cosA * cosA);
+    const glm::vec3 dirs[5] = {
+        m.coneAxis,
+        m.coneAxis * cosA + t * sinA, m.coneAxis * cosA - t * sinA,
+        m.coneAxis * cosA + b * sinA, m.coneAxis * cosA - b * sinA,
+    };
+    const float dists[3] = {0.25f, 1.0f, 8.0f};
+    const float eps      = std::max(m.radius, 1e-6f) * 1e-4f;
+
+    for (const auto& d : dirs) {
+        for (float s : dists) {
+            glm::vec3 cam = m.coneApex - d * (s * std::max(m.radius, 1e-3f));
+            if (!IsConeBackfacing(m.coneApex, m.coneAxis, m.coneCutoff, cam)) continue;
+            check.views++;
+
+            for (uint32_t i = 0; i < m.triangleCount; i++) {
+                const uint32_t* tri = &mesh.indices[(m.firstTriangle + i) * 3];
+                const glm::vec3& p0 = mesh.vertices[tri[0]].position;
+                glm::vec3 n = TriangleNormal(p0, mesh.vertices[tri[1]].position, mesh.vertices[tri[2]].position);
+                float len = glm::length(n);
+                if (len <= 0.0f) continue;
+                if (glm::dot(n / len, cam - p0) > eps) {
+                    check.violations++;
+                    break;
+                }
+            }
+        }
+    }
+    return check;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Asset/ModelLoader.h"
+
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/// A cluster of consecutive triangles of one mesh. Triangles are not reordered,
+/// so a meshlet is a contiguous range of the mesh's index buffer.
+struct Meshlet {
+    uint32_t  firstTriangle = 0;
+    uint32_t  triangleCount = 0;
+    uint32_t  vertexCount   = 0;     // unique vertices referenced
+
+    glm::vec3 center{0.0f};          // bounding sphere, mesh-local
+    float     radius     = 0.0f;
+
+    glm::vec3 coneApex{0.0f};        // backface cone, mesh-local
+    glm::vec3 coneAxis{0.0f, 0.0f, 1.0f};
+    float     coneCutoff = 1.0f;     // >= 1 disables the cone test
+};
+
+struct MeshletStats {
+    uint64_t meshlets       = 0;
+    uint64_t triangles      = 0;
+    uint64_t vertices       = 0;     // sum of per-meshlet unique vertices
+    uint64_t coneCullable   = 0;     // meshlets with a usable cone
+    double   milliseconds   = 0.0;
+
+    float AvgTriangles() const { return meshlets ? float(triangles) / float(meshlets) : 0.0f; }
+    float AvgVertices()  const { return meshlets ? float(vertices)  / float(meshlets) : 0.0f; }
+
+    void Add(const MeshletStats& o) {
+        meshlets += o.meshlets; triangles += o.triangles; vertices += o.vertices;
+        coneCullable += o.coneCullable;
+    }
+};
+
+/// Result of MeshletBuilder::ValidateCone
+struct MeshletConeCheck {
+    uint64_t views      = 0;     // sample views the cone test rejected
+    uint64_t violations = 0;     // ...of which still had a front-facing triangle
+};
+
+/// Greedy, deterministic meshlet builder with bounding spheres and normal cones.
+class MeshletBuilder {
+public:
+    static constexpr uint32_t MAX_VERTICES  = 64;
+    static constexpr uint32_t MAX_TRIANGLES = 124;
+
+    /// Splits the mesh in index order (expects cache-optimized input) and appends to `out`.
+    static void Build(const MeshData& mesh, std::vector<Meshlet>& out, MeshletStats& stats);
+
+    /// Fills the bounding sphere and cone of a meshlet from its triangles.
+    static void ComputeBounds(const MeshData& mesh, Meshlet& meshlet);
+
+    /// True if every triangle of the cluster faces away from `cameraPos`.
+    static bool IsConeBackfacing(const glm::vec3& apex, const glm::vec3& axis, float cutoff,
+                                 const glm::vec3& cameraPos);
+
+    /// Probes the cone test from views inside and on the edge of the culled region and
+    /// checks each rejected view against the actual triangle facing. For the CPU tests:
+    /// Build does not call it.
+    static MeshletConeCheck ValidateCone(const MeshData& mesh, const Meshlet& meshlet);
+};
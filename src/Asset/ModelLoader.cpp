@@ -287,6 +287,12 @@ bool ModelLoader::LoadGLTF(const std::string& path, ModelData& outModel) {
             static_cast<float>(mat.emissiveFactor[1]),
             static_cast<float>(mat.emissiveFactor[2]));
 
+        if (mat.alphaMode == "MASK")
+            material.alphaMode = AlphaMode::Mask;
+        else if (mat.alphaMode == "BLEND")
+            material.alphaMode = AlphaMode::Blend;
+        material.alphaCutoff = static_cast<float>(mat.alphaCutoff);
+
         outModel.materials.push_back(material);
     }
 
@@ -452,6 +458,26 @@ bool ModelLoader::LoadGLTF(const std::string& path, ModelData& outModel) {
             }
         }
 
+        // Directional glTF lights are skipped: the renderer's sun entity drives those
+        if (node.light >= 0 && node.light < static_cast<int>(gltfModel.lights.size())) {
+            const auto& gl = gltfModel.lights[node.light];
+            if (gl.type == "point" || gl.type == "spot") {
+                LightData light;
+                light.type      = gl.type == "spot" ? LightData::Type::Spot : LightData::Type::Point;
+                light.position  = glm::vec3(world[3]);
+                light.direction = glm::normalize(glm::vec3(world * glm::vec4(0.0f, 0.0f, -1.0f, 0.0f)));
+                if (gl.color.size() == 3)
+                    light.color = glm::vec3(float(gl.color[0]), float(gl.color[1]), float(gl.color[2]));
+                light.intensity = static_cast<float>(gl.intensity);
+                light.range     = static_cast<float>(gl.range);
+                if (light.type == LightData::Type::Spot) {
+                    light.innerConeAngle = static_cast<float>(gl.spot.innerConeAngle);
+                    light.outerConeAngle = static_cast<float>(gl.spot.outerConeAngle);
+                }
+                outModel.lights.push_back(light);
+            }
+        }
+
         for (int child : node.children)
             traverseNode(child, world);
     };
@@ -470,9 +496,9 @@ bool ModelLoader::LoadGLTF(const std::string& path, ModelData& outModel) {
         }
     }
 
-    LOG_INFO("Loaded glTF: {} meshes, {} textures, {} materials, {} instances",
+    LOG_INFO("Loaded glTF: {} meshes, {} textures, {} materials, {} instances, {} lights",
              outModel.meshes.size(), outModel.textures.size(),
-             outModel.materials.size(), outModel.instances.size());
+             outModel.materials.size(), outModel.instances.size(), outModel.lights.size());
     return true;
 }
 
@@ -13,9 +13,16 @@ struct MeshVertex {
     glm::vec4 tangent{0.0f}; // xyz = tangent, w = handedness (+1 or -1)
 };
 
+/// A simplified index list over its mesh's vertices (see MeshSimplifier).
+struct MeshLODData {
+    std::vector<uint32_t> indices;
+    float error = 0.0f;   // object-space deviation from the full-detail mesh
+};
+
 struct MeshData {
-    std::vector<MeshVertex> vertices;
-    std::vector<uint32_t>   indices;
+    std::vector<MeshVertex>  vertices;
+    std::vector<uint32_t>    indices;
+    std::vector<MeshLODData> lods;   // progressively coarser levels after `indices` (LOD0)
     int materialIndex = -1;
 };
 
@@ -26,6 +33,14 @@ struct TextureData {
     uint32_t channels = 4;
 };
 
+/// glTF alphaMode. Masked materials are alpha-tested against their cutoff and drawn
+/// after the opaque ones; blended materials are drawn last, back to front.
+enum class AlphaMode : uint32_t {
+    Opaque = 0,
+    Mask   = 1,
+    Blend  = 2,
+};
+
 struct MaterialData {
     int       baseColorTextureIndex        = -1;
     int       normalTextureIndex           = -1;
@@ -36,6 +51,8 @@ struct MaterialData {
     float     metallicFactor  = 0.0f;
     float     roughnessFactor = 0.5f;
     glm::vec3 emissiveFactor{0.0f};
+    AlphaMode alphaMode   = AlphaMode::Opaque;
+    float     alphaCutoff = 0.5f;
 };
 
 struct MeshInstance {
@@ -45,11 +62,25 @@ struct MeshInstance {
     glm::vec3 scale{1.0f};
 };
 
+/// KHR_lights_punctual point or spot light placed by a node, flattened to world space.
+struct LightData {
+    enum class Type : uint32_t { Point = 0, Spot = 1 };
+    Type      type = Type::Point;
+    glm::vec3 position{0.0f};
+    glm::vec3 direction{0.0f, 0.0f, -1.0f};   // spot axis: the direction the light shines
+    glm::vec3 color{1.0f};
+    float     intensity      = 1.0f;          // candela
+    float     range          = 0.0f;          // 0 = unlimited
+    float     innerConeAngle = 0.0f;
+    float     outerConeAngle = 0.78539816f;
+};
+
 struct ModelData {
     std::vector<MeshData>     meshes;
     std::vector<TextureData>  textures;
     std::vector<MaterialData> materials;
     std::vector<MeshInstance> instances;
+    std::vector<LightData>    lights;
 };
 
 class ModelLoader {
@@ -1,10 +1,12 @@
 #include "Core/Application.h"
 #include "Core/Logger.h"
+#include "Core/FrameWriter.h"
 #include "RHI/VulkanUtils.h"
 #include "RenderGraph/Passes/ShadowPass.h"
 #include "RenderGraph/Passes/ForwardPass.h"
 #include "RenderGraph/Passes/PresentPass.h"
 #include "RenderGraph/Passes/FrustumCullPass.h"
+#include "RenderGraph/Passes/ShadowCullPass.h"
 #include "RenderGraph/Passes/OccluderDepthPass.h"
 #include "RenderGraph/Passes/HiZBuildPass.h"
 #include "RenderGraph/Passes/OcclusionTestPass.h"
@@ -16,12 +18,16 @@
 #include "GPU/IndirectRenderer.h"
 #include "GPU/HiZBuffer.h"
 #include "GPU/ComputeCulling.h"
+#include "GPU/DrawKey.h"
+#include "Culling/SoftwareOcclusion.h"
+#include "Culling/SceneBVH.h"
 #include "VisualUI/DebugUI.h"
 #include "VisualUI/ImGuiPass.h"
 #include "VisualUI/GPUProfiler.h"
 #include "VisualUI/ObjectLabeling.h"
 #include "VisualUI/DebugVisualization.h"
 #include "VisualUI/PipelineStatistics.h"
+#include "Scene/CameraPath.h"
 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -29,7 +35,11 @@
 
 #include <cstdio>
 #include <cstring>
+#include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
 
 #include <filesystem>
 #include <array>
@@ -41,7 +51,14 @@ Application::~Application() = default;
 void Application::Run() {
     InitWindow();
     InitVulkan();
+    RenderCPUReference();
+    ApplyInitialRenderMode();
 
+    MainLoop();
+    CleanupVulkan();
+}
+
+void Application::ApplyInitialRenderMode() {
     if (mInitialRenderMode.has_value() || mInitialDenoiser.has_value()) {
         if (mInitialRenderMode.has_value()) {
             mActiveRenderMode = *mInitialRenderMode;
@@ -54,24 +71,24 @@ void Application::Run() {
             mDebugUI.GetState().ptEnableDenoiser = *mInitialDenoiser;
         }
     }
-
-    MainLoop();
-    CleanupVulkan();
 }
 
-void Application::RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusionCulling) {
+bool Application::RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusionCulling) {
     InitWindow();
     InitVulkan();
 
     mGPUDriven        = gpuDriven;
     mOcclusionCulling  = occlusionCulling;
     mShowUI            = false;
+    ApplyInitialRenderMode();
 
     constexpr uint32_t kWarmup = 30;
     uint32_t totalFrames = kWarmup + frameCount;
 
     double benchStart = 0.0;
     double totalCpu   = 0.0;
+    double ptGpuMs    = 0.0;
+    uint32_t ptFrames = 0;
     float  minMs = 1e9f, maxMs = 0.0f;
 
     std::printf("=== BENCHMARK: %u frames, GPU-driven=%d, occlusion=%d ===\n",
@@ -89,7 +106,15 @@ void Application::RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusi
         mWindow.ResetInputDeltas();
         mRegistry.UpdateTransforms();
 
-        if (i == kWarmup) benchStart = glfwGetTime();
+        if (i == kWarmup) {
+            benchStart = glfwGetTime();
+            mComputeCulling.ResetStats();
+            mSoftwareOcclusion.ResetStats();
+            mSceneBVH.ResetStats();
+            mInstanceBatcher.ResetStats();
+            mAccelStructure.ResetUpdateStats();
+            mPathTracer.ResetHitClassStats();
+        }
 
         DrawFrame();
 
@@ -99,10 +124,18 @@ void Application::RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusi
             totalCpu += frameMs;
             minMs = std::min(minMs, frameMs);
             maxMs = std::max(maxMs, frameMs);
+            for (const auto& r : mGPUProfiler.GetResults())
+                if (r.name == "PathTracing") { ptGpuMs += r.durationMs; ptFrames++; }
         }
     }
 
     mDevice.WaitIdle();
+    if (mGPUDriven)
+        for (uint32_t f = 0; f < FRAMES_IN_FLIGHT; f++)
+            mComputeCulling.BeginFrame(f);   // collect the frames still in flight
+    if (mRTPipelineSupported)
+        for (uint32_t f = 0; f < FRAMES_IN_FLIGHT; f++)
+            mPathTracer.BeginFrame(f);
 
     double benchEnd   = glfwGetTime();
     double wallTimeS  = benchEnd - benchStart;
@@ -121,6 +154,204 @@ void Application::RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusi
     std::printf("  Avg frame:    %.3f ms\n", avgMs);
     std::printf("  Min frame:    %.3f ms\n", minMs);
     std::printf("  Max frame:    %.3f ms\n", maxMs);
+    if (mMeshOptimization)
+        std::printf("  Mesh ACMR:    %.3f -> %.3f (ATVR %.3f -> %.3f, %.1f ms)\n",
+                    mMeshOptReport.before.ACMR(), mMeshOptReport.after.ACMR(),
+                    mMeshOptReport.before.ATVR(), mMeshOptReport.after.ATVR(),
+                    mMeshOptReport.milliseconds);
+    if (mMeshPool.GetVertexFormat() == VertexFormat::Packed) {
+        const auto& ps = mMeshPool.GetPackingStats();
+        std::printf("  Vertex pack:  %.2f MB -> %.2f MB (saved %.2f MB, %.1f ms)\n",
+                    ps.floatBytes / (1024.0 * 1024.0), ps.packedBytes / (1024.0 * 1024.0),
+                    ps.BytesSaved() / (1024.0 * 1024.0), ps.milliseconds);
+        std::printf("  Pack error:   pos %.2e of extent, normal %.4f deg, tangent %.4f deg, uv %.2e, sign %llu\n",
+                    ps.maxPositionError, ps.maxNormalError, ps.maxTangentError, ps.maxUVError,
+                    static_cast<unsigned long long>(ps.signMismatches));
+    }
+    {
+        const auto& ms = mMeshPool.GetMeshletStats();
+        std::printf("  Meshlets:     %llu (%.1f tris, %.1f verts avg, %llu with cones, %.1f ms)%s\n",
+                    static_cast<unsigned long long>(ms.meshlets), ms.AvgTriangles(), ms.AvgVertices(),
+                    static_cast<unsigned long long>(ms.coneCullable), ms.milliseconds,
+                    mClusterCulling ? ", cluster culling ON" : "");
+    }
+    std::printf("  Index pool:   %.2f MB (%.2f MB as uint32 only, %u/%u draws uint16)\n",
+                mMeshPool.GetIndexBytes() / (1024.0 * 1024.0),
+                mMeshPool.GetIndexBytesUint32() / (1024.0 * 1024.0),
+                mIndirectRenderer.GetObjectCount(INDEX_CLASS_UINT16),
+                mIndirectRenderer.GetObjectCount());
+    {
+        const auto& ss = mIndirectRenderer.GetSyncStats();
+        std::printf("  Scene sync:   %.1f objects, %.1f regions, %.2f KB per frame (%llu allocs, %llu frees, %llu reallocs, %.3f ms/frame CPU)\n",
+                    ss.AvgDirty(), ss.AvgRegions(), ss.AvgBytes() / 1024.0,
+                    static_cast<unsigned long long>(ss.allocations),
+                    static_cast<unsigned long long>(ss.frees),
+                    static_cast<unsigned long long>(ss.reallocations),
+                    ss.syncs ? ss.milliseconds / ss.syncs : 0.0);
+    }
+    if (mGPUDriven && mOcclusionCulling) {
+        uint32_t mips = mHiZBuffer.GetMipCount();
+        if (mHiZBuffer.UsesSinglePass())
+            std::printf("  Hi-Z build:   %ux%u, %u mips in 1 dispatch (single pass)\n",
+                        mHiZBuffer.GetWidth(), mHiZBuffer.GetHeight(), mips);
+        else
+            std::printf("  Hi-Z build:   %ux%u, %u mips in %u dispatches, %u barriers (per mip)\n",
+                        mHiZBuffer.GetWidth(), mHiZBuffer.GetHeight(), mips, mips, mips ? mips - 1 : 0);
+    }
+    if (mGPUDriven) {
+        const auto& os = mComputeCulling.GetStats();
+        double n = os.frames ? double(os.frames) : 1.0;
+        std::printf("  Occlusion:    %.1f + %.1f of %.1f draws, %.2fM of %.2fM tris per frame (saved %.1f%% draws, %.1f%% tris)\n",
+                    os.phase1Draws / n, os.phase2Draws / n, os.frustumDraws / n,
+                    os.Tris() / n / 1e6, os.frustumTris / n / 1e6,
+                    100.0 * os.DrawSavings(), 100.0 * os.TriSavings());
+        std::printf("  Alpha draws:  %.1f masked, %.1f transparent per frame\n",
+                    os.maskedDraws / n, os.transparentDraws / n);
+        const auto& ss = mIndirectRenderer.GetSyncStats();
+        std::printf("  Instancing:   %.1f draws for %.1f objects (%.1f in %.1f group draws) per frame, %u groups, %llu rebuilds%s\n",
+                    os.Submitted() / n, os.Draws() / n, os.instances / n, os.instancedDraws / n,
+                    mIndirectRenderer.GetGroupCount(), static_cast<unsigned long long>(ss.groupRebuilds),
+                    mGPUInstancing ? (mClusterCulling ? " (cluster culling draws alone)" : "") : " (instancing off)");
+    }
+    if (mMeshLODs) {
+        const auto& lr = mLODReport;
+        std::printf("  LOD chain:    %llu of %llu meshes, %.2fM / %.2fM / %.2fM / %.2fM tris, max error %.4f, %.1f ms\n",
+                    static_cast<unsigned long long>(lr.meshesWithLODs),
+                    static_cast<unsigned long long>(lr.meshes),
+                    lr.triangles[0] / 1e6, lr.triangles[1] / 1e6, lr.triangles[2] / 1e6, lr.triangles[3] / 1e6,
+                    lr.maxError, lr.milliseconds);
+
+        // Submitted triangles against what the same draws cost at LOD0
+        uint64_t frames = 0, tris = 0, lod0Tris = 0;
+        if (mGPUDriven) {
+            const auto& os = mComputeCulling.GetStats();
+            frames = os.frames; tris = os.Tris(); lod0Tris = os.lod0Tris;
+        } else {
+            const auto& is = mInstanceBatcher.GetStats();
+            frames = is.frames; tris = is.triangles; lod0Tris = is.lod0Triangles;
+        }
+        double n = frames ? double(frames) : 1.0;
+        std::printf("  LOD:          %.2fM -> %.2fM tris per frame (saved %.1f%%, %.1f px threshold)%s\n",
+                    lod0Tris / n / 1e6, tris / n / 1e6,
+                    lod0Tris ? 100.0 * (1.0 - double(tris) / double(lod0Tris)) : 0.0,
+                    mLODThreshold, (mGPUDriven && mClusterCulling) ? " (cluster culling draws LOD0)" : "");
+    }
+    if (!mGPUDriven) {
+        const auto& bs = mSceneBVH.GetStats();
+        double q = bs.queries ? double(bs.queries) : 1.0;
+        double f = bs.syncs ? double(bs.syncs) : 1.0;
+        std::printf("  Scene BVH:    %u leaves, height %d, %.1f moved + %.1f reinserted per frame, %.0f nodes / %.0f accepted per query, sync %.3f ms, cull %.3f ms per frame\n",
+                    mSceneBVH.GetLeafCount(), mSceneBVH.GetHeight(),
+                    bs.refitted / f, bs.reinserted / f, bs.nodesVisited / q, bs.accepted / q,
+                    bs.syncMs / f, bs.queryMs / f);
+        BenchmarkSceneBVH();
+
+        const auto& is = mInstanceBatcher.GetStats();
+        std::printf("  Instancing:   %.1f draws for %.1f objects (%.1fx), shadows %.1f draws for %.1f, build %.3f ms, record %.3f ms per frame%s\n",
+                    is.PerFrame(is.draws), is.PerFrame(is.instances),
+                    is.draws ? double(is.instances) / double(is.draws) : 0.0,
+                    is.PerFrame(is.shadowDraws), is.PerFrame(is.shadowInstances),
+                    is.AvgBuildMs(), is.AvgRecordMs(),
+                    mInstanceBatcher.IsEnabled() ? "" : " (instancing off)");
+
+        const DrawStateChanges& fs = is.forwardState;
+        const DrawStateChanges& ss = is.shadowState;
+        std::printf("  Draw state:   %.1f changes for %.1f draws (index %.1f, material %.1f, bounds %.1f), shadows %.1f for %.1f, %.1fK keys sorted in %.3f ms per frame\n",
+                    is.PerFrame(fs.Total()), is.PerFrame(is.draws),
+                    is.PerFrame(fs.indexBinds), is.PerFrame(fs.materialPushes), is.PerFrame(fs.boundsPushes),
+                    is.PerFrame(ss.Total()), is.PerFrame(is.shadowDraws),
+                    is.PerFrame(is.sortedKeys) / 1e3, is.AvgSortMs());
+        std::printf("  Alpha draws:  %.1f masked, %.1f transparent per frame (%.1f pipeline binds)\n",
+                    is.PerFrame(is.maskedDraws), is.PerFrame(is.transparentDraws), is.PerFrame(fs.pipelineBinds));
+        BenchmarkDrawSort();
+    }
+    if (!mGPUDriven && mOcclusionCulling) {
+        const auto& so = mSoftwareOcclusion.GetStats();
+        double n = so.frames ? double(so.frames) : 1.0;
+        std::printf("  SW occlusion: %.1f%% of %.0f objects culled (%.1f%% occluded), %.1f occluders / %.1fK tris, %.3f ms/frame (raster %.3f, test %.3f, %s)\n",
+                    100.0 * so.CulledFraction(), so.objects / n, 100.0 * so.OcclusionFraction(),
+                    so.occluders / n, so.occluderTriangles / n / 1e3,
+                    so.AvgMs(), so.AvgRasterMs(), so.AvgTestMs(),
+                    mSoftwareOcclusion.UsesAVX2() ? "AVX2" : "scalar");
+        BenchmarkSoftwareOcclusion();
+    }
+    if (mCSMEnabled) {
+        // Reference counts from the CPU version of the cull_shadow.comp test, last frame's cascades
+        constexpr uint32_t CC = CascadedShadowMap::CASCADE_COUNT;
+        uint32_t casters[CC] = {};
+        uint32_t total = 0;
+        const auto& drawCmds = mMeshPool.GetDrawCommands();
+        mRegistry.ForEachRenderable([&](Entity, const TransformComponent& tc,
+                                        const MeshComponent& mc, const MaterialComponent&) {
+            if (mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
+            uint32_t mask = mCSM.CasterMask(drawCmds[mc.meshIndex].bounds, tc.worldMatrix);
+            for (uint32_t c = 0; c < CC; c++)
+                if (mask & (1u << c)) casters[c]++;
+            total++;
+        });
+        std::printf("  Shadow casters: %u / %u / %u / %u of %u per cascade (%.0f%% of unculled draws)\n",
+                    casters[0], casters[1], casters[2], casters[3], total,
+                    total ? 100.0 * (casters[0] + casters[1] + casters[2] + casters[3]) / (CC * total) : 0.0);
+    }
+    if (!mCPUReferencePath.empty()) {
+        RenderCPUReference();
+        const auto& pt = mCPUPathTracer.GetStats();
+        const auto& ps = mCPUPathTracer.GetSettings();
+        std::printf("  CPU path tracer: %ux%u at %u spp, %.2f Mrays/s (%.2f per core, %u threads), %.1f ms\n",
+                    ps.width, ps.height, ps.samplesPerPixel, pt.MRaysPerSecond(), pt.MRaysPerSecondPerCore(),
+                    pt.threads, pt.renderMs);
+        std::printf("    %.2fM rays (%.2fM primary, %.2fM bounce, %.2fM shadow), %.1f nodes and %.1f triangles per ray\n",
+                    pt.Rays() / 1e6, pt.primaryRays / 1e6, pt.bounceRays / 1e6, pt.shadowRays / 1e6,
+                    pt.Rays() ? double(pt.traversal.nodeTests) / pt.Rays() : 0.0,
+                    pt.Rays() ? double(pt.traversal.triTests) / pt.Rays() : 0.0);
+        std::printf("    BVH: %u meshes / %.1fK tris in %.2f ms (SAH %.1f), %u instances in %.2f ms (SAH %.1f)\n",
+                    pt.meshes, pt.triangles / 1e3, pt.blasMs, pt.blasSAHCost,
+                    pt.instances, pt.tlasMs, pt.tlasSAHCost);
+    }
+    if (ptFrames > 0) {
+        std::printf("  Path tracer:  %s integrator, %d bounces, %.3f ms GPU per frame\n",
+                    mPathTracer.GetActiveIntegrator() == PTIntegrator::Wavefront ? "wavefront" : "megakernel",
+                    mPathTracer.maxBounces, ptGpuMs / ptFrames);
+        if (mLightBuffer.GetLightCount() > 0)
+            std::printf("  Lights:       %u punctual + %u emissive triangles, ReSTIR DI %s\n",
+                        mLightBuffer.GetPunctualCount(), mLightBuffer.GetTriangleCount(),
+                        mPathTracer.IsReSTIRActive() ? "on" : "off");
+        const PTAdaptiveStats& as = mPathTracer.GetAdaptiveStats();
+        if (as.tiles > 0) {
+            std::printf("  Adaptive:     %.1f%% of %u tiles converged, %.2fM samples vs %.2fM uniform at equal RMSE (%.2fx), RMSE %.4f\n",
+                        100.0 * as.ConvergedFraction(), as.tiles, as.samples / 1e6, as.UniformSamples() / 1e6,
+                        as.samples > 0.0 ? as.UniformSamples() / as.samples : 0.0, as.Rmse());
+        }
+        const PTHitClassStats& hs = mPathTracer.GetHitClassStats();
+        if (hs.frames > 0) {
+            const RTClassCounts& inst = mAccelStructure.GetClassInstanceCounts();
+            std::printf("  Hit classes:  %s, invocations per frame:\n",
+                        mAccelStructure.IsForceOpaque() ? "opaque/emissive instances FORCE_OPAQUE"
+                                                        : "all instances FORCE_NO_OPAQUE (baseline)");
+            for (uint32_t c = 0; c < kRTMaterialClassCount; c++)
+                std::printf("    %-12s  %5u instances, %.3fM any-hit, %.3fM closest-hit\n",
+                            RTMaterialClassName(static_cast<RTMaterialClass>(c)), inst[c],
+                            hs.AnyHitPerFrame(c) / 1e6, hs.ClosestHitPerFrame(c) / 1e6);
+        }
+    }
+    if (mRayTracingEnabled) {
+        const TLASUpdateStats& ts = mAccelStructure.GetUpdateStats();
+        std::printf("  TLAS update:  %.1f moved, %.1f instances written per frame; %llu refits, %llu rebuilds, %llu restructures; CPU %.3f ms, GPU %.3f ms per build\n",
+                    ts.PerFrame(ts.movedInstances), ts.PerFrame(ts.instancesWritten),
+                    static_cast<unsigned long long>(ts.refits), static_cast<unsigned long long>(ts.rebuilds),
+                    static_cast<unsigned long long>(ts.restructures), ts.AvgCpuMs(), ts.AvgGpuMs());
+        const BLASBuildStats& bs = mAccelStructure.GetBLASBuildStats();
+        std::printf("  BLAS build:   %u/%u meshes in %u batches (%s), build %.0f tris/ms, compaction %.0f tris/ms, %.1f KB -> %.1f KB\n",
+                    bs.meshesReady, bs.meshes, bs.batches,
+                    mAccelStructure.IsBLASBuildComplete() ? "done" : "in progress",
+                    bs.BuildTrisPerMs(), bs.CompactTrisPerMs(),
+                    bs.memoryBuilt / 1024.0, bs.memoryCompacted / 1024.0);
+    }
+    std::printf("  Scene upload: %llu uploads, %.2f MB, %.0f uploads/s, %.1f MB/s\n",
+                static_cast<unsigned long long>(mSceneUploadStats.uploadCount),
+                mSceneUploadStats.bytes / (1024.0 * 1024.0),
+                mSceneUploadStats.UploadsPerSecond(),
+                mSceneUploadStats.BytesPerSecond() / (1024.0 * 1024.0));
 
     mGPUProfiler.CollectResults(mDevice.GetHandle(), mFrameIndex);
     const auto& gpuResults = mGPUProfiler.GetResults();
@@ -129,10 +360,598 @@ void Application::RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusi
         for (const auto& r : gpuResults)
             std::printf("    %s: %.3f ms\n", r.name.c_str(), r.durationMs);
     }
+    if (mSelfCheckFailures > 0)
+        std::printf("  Self-checks:  %u FAILED\n", mSelfCheckFailures);
+    else
+        std::printf("  Self-checks:  all passed\n");
     std::printf("=========================\n");
     std::fflush(stdout);
 
     CleanupVulkan();
+    return mSelfCheckFailures == 0;
+}
+
+// Scripted cameras through the scene bounds, so culling rates compare across runs
+// regardless of where the interactive camera is. CPU only, nothing is drawn.
+void Application::BenchmarkSoftwareOcclusion() {
+    const auto& drawCmds = mMeshPool.GetDrawCommands();
+    AABB scene;
+    mRegistry.ForEachRenderable([&](Entity, const TransformComponent& tc,
+                                    const MeshComponent& mc, const MaterialComponent&) {
+        if (mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
+        const AABB& b = drawCmds[mc.meshIndex].bounds;
+        if (!b.Valid()) return;
+        for (uint32_t i = 0; i < 8; i++) {
+            glm::vec3 corner((i & 1) ? b.max.x : b.min.x, (i & 2) ? b.max.y : b.min.y, (i & 4) ? b.max.z : b.min.z);
+            scene.Include(glm::vec3(tc.worldMatrix * glm::vec4(corner, 1.0f)));
+        }
+    });
+    if (!scene.Valid()) return;
+
+    VkExtent2D extent = mSwapchain.GetExtent();
+    glm::mat4 proj = mCamera.GetProjectionMatrix(static_cast<float>(extent.width) / static_cast<float>(extent.height));
+
+    // Walk down the long horizontal axis at eye height, turn on the spot in the middle,
+    // circle close to the walls looking at the center
+    constexpr uint32_t kSteps = 120;
+    constexpr float    kTwoPi = 6.28318531f;
+    const glm::vec3 center = scene.Center();
+    const glm::vec3 ext    = scene.Extent();
+    const glm::vec3 along  = ext.x >= ext.z ? glm::vec3(1.0f, 0.0f, 0.0f) : glm::vec3(0.0f, 0.0f, 1.0f);
+    const float     eyeY   = scene.min.y + std::min(1.6f, ext.y * 0.5f);
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    const char*     names[] = {"walk", "turn", "orbit"};
+
+    for (uint32_t path = 0; path < 3; path++) {
+        mSoftwareOcclusion.ResetStats();
+        for (uint32_t i = 0; i < kSteps; i++) {
+            float t = static_cast<float>(i) / static_cast<float>(kSteps - 1);
+            glm::vec3 eye(center.x, eyeY, center.z), target;
+            if (path == 0) {
+                eye   += along * (glm::dot(ext, along) * (t - 0.5f) * 0.8f);
+                target = eye + along;
+            } else if (path == 1) {
+                target = eye + glm::vec3(std::cos(t * kTwoPi), 0.0f, std::sin(t * kTwoPi));
+            } else {
+                eye   += glm::vec3(std::cos(t * kTwoPi) * ext.x, 0.0f, std::sin(t * kTwoPi) * ext.z) * 0.4f;
+                target = glm::vec3(center.x, eyeY, center.z);
+            }
+            mSoftwareOcclusion.Cull(mRegistry, drawCmds, proj * glm::lookAt(eye, target, up), &mThreadPool);
+        }
+
+        const auto& so = mSoftwareOcclusion.GetStats();
+        std::printf("    %-5s  %.1f%% culled (%.1f%% occluded), %.1f occluders, %.3f ms/frame over %u cameras\n",
+                    names[path], 100.0 * so.CulledFraction(), 100.0 * so.OcclusionFraction(),
+                    so.occluders / double(so.frames), so.AvgMs(), kSteps);
+    }
+}
+
+// Synthetic instance fields at growing sizes: build, refit with 1% of the instances
+// moving, and frustum queries against the brute-force loops over the same boxes.
+// Timings only; tests/SceneBVHTests.cpp checks that the three agree.
+void Application::BenchmarkSceneBVH() {
+    using Clock = std::chrono::steady_clock;
+    auto ms = [](Clock::time_point a, Clock::time_point b) {
+        return std::chrono::duration<double, std::milli>(b - a).count();
+    };
+
+    VkExtent2D extent = mSwapchain.GetExtent();
+    glm::mat4 proj = mCamera.GetProjectionMatrix(static_cast<float>(extent.width) / static_cast<float>(extent.height));
+
+    constexpr uint32_t kSizes[] = {10000, 100000, 1000000};
+    constexpr uint32_t kQueries = 16;
+    constexpr float    kTwoPi   = 6.28318531f;
+
+    for (uint32_t count : kSizes) {
+        // Constant density: ~1000 boxes of 0.5-2 units per 40x10x40 block
+        const float half = 20.0f * std::cbrt(static_cast<float>(count) / 1000.0f);
+        std::mt19937 rng(1234);
+        std::uniform_real_distribution<float> pos(-half, half), size(0.25f, 1.0f), jitter(-0.3f, 0.3f);
+
+        std::vector<AABB> boxes(count);
+        for (auto& b : boxes) {
+            glm::vec3 c(pos(rng), pos(rng) * 0.25f, pos(rng));
+            glm::vec3 h(size(rng), size(rng), size(rng));
+            b.min = c - h;
+            b.max = c + h;
+        }
+
+        SceneBVH bvh;
+        auto t0 = Clock::now();
+        for (Entity e = 0; e < count; e++)
+            bvh.Insert(e, boxes[e]);
+        auto t1 = Clock::now();
+
+        const uint32_t moving = std::max(count / 100, 1u);
+        for (uint32_t i = 0; i < moving; i++) {
+            Entity e = static_cast<Entity>(rng() % count);
+            glm::vec3 d(jitter(rng), jitter(rng), jitter(rng));
+            boxes[e].min += d;
+            boxes[e].max += d;
+            bvh.Update(e, boxes[e]);
+        }
+        auto t2 = Clock::now();
+        const auto& stats = bvh.GetStats();
+        uint64_t reinserted = stats.reinserted;
+
+        double treeMs = 0.0, sseMs = 0.0, scalarMs = 0.0;
+        uint64_t visible = 0;
+        uint64_t visitedBefore = stats.nodesVisited;
+        std::vector<uint8_t> treeMask, sseMask, scalarMask;
+        for (uint32_t q = 0; q < kQueries; q++) {
+            float a = kTwoPi * static_cast<float>(q) / static_cast<float>(kQueries);
+            glm::vec3 eye(0.0f, 2.0f, 0.0f);
+            glm::vec3 target = eye + glm::vec3(std::cos(a), -0.1f, std::sin(a));
+            glm::vec4 planes[6];
+            ExtractFrustumPlanes(proj * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f)), planes);
+            CullVolumes volumes;
+            volumes.Set(0, planes, 6);
+
+            auto q0 = Clock::now();
+            visible += bvh.Cull(volumes, treeMask);
+            auto q1 = Clock::now();
+            bvh.CullLinear(volumes, sseMask, true);
+            auto q2 = Clock::now();
+            bvh.CullLinear(volumes, scalarMask, false);
+            auto q3 = Clock::now();
+            treeMs   += ms(q0, q1);
+            sseMs    += ms(q1, q2);
+            scalarMs += ms(q2, q3);
+        }
+
+        std::printf("    %7u  build %.1f ms (height %d), refit %u moved %.3f ms (%llu reinserted), cull %.3f ms"
+                    " (%.1f%% visible, %.0f nodes) vs linear SSE %.3f / scalar %.3f ms\n",
+                    count, ms(t0, t1), bvh.GetHeight(), moving, ms(t1, t2),
+                    static_cast<unsigned long long>(reinserted),
+                    treeMs / kQueries, 100.0 * visible / (double(count) * kQueries),
+                    double(stats.nodesVisited - visitedBefore) / kQueries,
+                    sseMs / kQueries, scalarMs / kQueries);
+    }
+}
+
+// Draw-key sort at 100K draws: the radix sort on the calling thread and on the pool
+// against std::stable_sort of the same (key, draw) pairs, which it must match exactly
+void Application::BenchmarkDrawSort() {
+    constexpr uint32_t kDraws = 100000;
+    constexpr int      kRuns  = 10;
+
+    std::vector<uint64_t> keys(kDraws);
+    std::mt19937_64 rng(1234);
+    for (uint32_t i = 0; i < kDraws; i++) {
+        uint64_t r = rng();
+        uint32_t pipeline = static_cast<uint32_t>(r & 3u);
+        uint32_t cls      = static_cast<uint32_t>((r >> 2) & 1u);
+        uint32_t material = static_cast<uint32_t>((r >> 8) % 1024u);
+        uint32_t depth    = static_cast<uint32_t>((r >> 32) & DrawKey::DEPTH_MAX);
+        keys[i] = (r >> 63) ? DrawKey::Transparent(pipeline, cls, material, depth)
+                            : DrawKey::Opaque(pipeline, cls, material, depth);
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t>> reference(kDraws);
+    for (uint32_t i = 0; i < kDraws; i++) reference[i] = {keys[i], i};
+    std::stable_sort(reference.begin(), reference.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    RadixSorter sorter;
+    std::vector<uint64_t> sortKeys;
+    std::vector<uint32_t> sortValues;
+    auto time = [&](ThreadPool* pool, bool& matches) {
+        double best = 1e30;
+        for (int run = 0; run < kRuns; run++) {
+            sortKeys = keys;
+            sortValues.resize(kDraws);
+            for (uint32_t i = 0; i < kDraws; i++) sortValues[i] = i;
+            auto t0 = std::chrono::steady_clock::now();
+            sorter.Sort(sortKeys, sortValues, pool);
+            best = std::min(best, std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - t0).count());
+        }
+        matches = true;
+        for (uint32_t i = 0; i < kDraws && matches; i++)
+            matches = sortKeys[i] == reference[i].first && sortValues[i] == reference[i].second;
+        return best;
+    };
+
+    bool serialMatches = false, parallelMatches = false;
+    double serialMs   = time(nullptr, serialMatches);
+    uint32_t passes   = sorter.GetLastPassCount();
+    double parallelMs = time(&mThreadPool, parallelMatches);
+    uint32_t chunks   = sorter.GetLastChunkCount();
+
+    double stdMs = 1e30;
+    std::vector<std::pair<uint64_t, uint32_t>> pairs(kDraws);
+    for (int run = 0; run < kRuns; run++) {
+        for (uint32_t i = 0; i < kDraws; i++) pairs[i] = {keys[i], i};
+        auto t0 = std::chrono::steady_clock::now();
+        std::sort(pairs.begin(), pairs.end());
+        stdMs = std::min(stdMs, std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count());
+    }
+
+    std::printf("    %uK keys: radix %.3f ms (%u passes), %u threads %.3f ms, std::sort %.3f ms, %s\n",
+                kDraws / 1000, serialMs, passes, chunks, parallelMs, stdMs,
+                (serialMatches && parallelMatches) ? "matches stable order" : "ORDER MISMATCH");
+    mSelfCheckFailures += !serialMatches || !parallelMatches;
+}
+
+// Reference image of the current camera on the CPU tracer, at the swapchain aspect.
+// The sun is the one DrawFrame uses, so the GPU path tracer can be compared against it.
+void Application::RenderCPUReference() {
+    if (mCPUReferencePath.empty() || !mCPUPathTracer.HasMeshes()) return;
+
+    VkExtent2D extent = mSwapchain.GetExtent();
+    float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+    uint32_t width = mCPUPathTracer.GetSettings().width;
+    TraceCPUReference(width, std::max(static_cast<uint32_t>(width / aspect + 0.5f), 1u));
+}
+
+bool Application::TraceCPUReference(uint32_t width, uint32_t height) {
+    auto& settings = mCPUPathTracer.GetSettings();
+    settings.width           = width;
+    settings.height          = height;
+    settings.samplesPerPixel = std::max(mCPUReferenceSpp, 1u);
+    float aspect = static_cast<float>(width) / static_cast<float>(height);
+
+    const auto* sunLight = mRegistry.GetLight(mSunEntity);
+    float az = glm::radians(mLightAzimuth);
+    float el = glm::radians(mLightElevation);
+    glm::vec3 sunDir = glm::normalize(glm::vec3(
+        -glm::cos(el) * glm::sin(az), -glm::sin(el), -glm::cos(el) * glm::cos(az)));
+
+    CPUTraceView view;
+    view.invViewProj  = glm::inverse(mCamera.GetProjectionMatrix(aspect) * mCamera.GetViewMatrix());
+    view.cameraPos    = mCamera.GetPosition();
+    view.sunDir       = -sunDir;
+    view.sunColor     = sunLight ? sunLight->color     : glm::vec3(1.0f);
+    view.sunIntensity = sunLight ? sunLight->intensity : 1.0f;
+    view.lightRadius  = mRTLightRadius;
+
+    mCPUPathTracer.SetScene(mRegistry, mGPUMaterials, &mThreadPool);
+    mCPUPathTracer.Render(view, &mThreadPool);
+    if (!mCPUPathTracer.WritePFM(mCPUReferencePath)) {
+        LOG_ERROR("Failed to write CPU reference to {}", mCPUReferencePath);
+        return false;
+    }
+    LOG_INFO("CPU reference written to {} ({}x{}, {} spp)", mCPUReferencePath,
+             settings.width, settings.height, settings.samplesPerPixel);
+    return true;
+}
+
+// The glTF scene through LoadScene's mesh processing, traced from the startup camera
+// without a window or Vulkan device. Materials are the factors the CPU tracer reads;
+// the demo objects LoadScene adds on ray tracing devices are not in the image.
+bool Application::RunCPUReference(uint32_t width, uint32_t height) {
+    Logger::Initialize();
+    mThreadPool.Initialize();
+
+    AddSceneSun();
+    if (!LoadSceneModel()) {
+        LOG_ERROR("CPU reference: no glTF scene found (use --scene)");
+        mThreadPool.Shutdown();
+        return false;
+    }
+    for (const auto& mat : mModelData.materials) {
+        GPUMaterialData g{};
+        g.baseColorFactor = mat.baseColorFactor;
+        g.metallicFactor  = mat.metallicFactor;
+        g.roughnessFactor = mat.roughnessFactor;
+        g.alphaCutoff     = mat.alphaCutoff;
+        g.alphaMode       = static_cast<uint32_t>(mat.alphaMode);
+        mGPUMaterials.push_back(g);
+    }
+    if (mGPUMaterials.empty())
+        mGPUMaterials.push_back(GPUMaterialData{});
+    AddModelEntities();
+    mRegistry.UpdateTransforms();
+
+    if (mMeshOptimization)
+        mMeshOptReport = MeshOptimizer::OptimizeMeshes(mModelData.meshes, &mThreadPool);
+    if (mMeshLODs)
+        mLODReport = MeshSimplifier::GenerateLODs(mModelData.meshes, &mThreadPool);
+    mCPUPathTracer.SetMeshes(mModelData.meshes);
+
+    mCamera.Init(glm::vec3(0, 1.6f, 0), glm::vec3(0, 1.6f, -1.0f), 45.0f, 0.01f, 100.0f);
+    const auto& defaults = mCPUPathTracer.GetSettings();
+    bool written = TraceCPUReference(width ? width : defaults.width, height ? height : defaults.height);
+
+    const auto& pt = mCPUPathTracer.GetStats();
+    std::printf("CPU reference: %ux%u at %u spp, %.2f Mrays/s (%u threads), %.1f ms\n",
+                mCPUPathTracer.GetSettings().width, mCPUPathTracer.GetSettings().height,
+                mCPUPathTracer.GetSettings().samplesPerPixel, pt.MRaysPerSecond(), pt.threads, pt.renderMs);
+    mThreadPool.Shutdown();
+    return written;
+}
+
+// =======================================================================
+// Offline rendering
+// =======================================================================
+namespace {
+
+// "out/frame_####.exr" -> "out/frame_0042.exr". Without '#' a single frame keeps the name
+// and a sequence gets "_NNNN" before the extension.
+std::string FramePath(const std::string& pattern, uint32_t frame, bool sequence) {
+    size_t first = pattern.find('#');
+    if (first == std::string::npos) {
+        if (!sequence) return pattern;
+        char num[16];
+        std::snprintf(num, sizeof(num), "_%04u", frame);
+        size_t dot   = pattern.find_last_of('.');
+        size_t slash = pattern.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return pattern + num;
+        return pattern.substr(0, dot) + num + pattern.substr(dot);
+    }
+    size_t last = pattern.find_first_not_of('#', first);
+    if (last == std::string::npos) last = pattern.size();
+    std::string num = std::to_string(frame);
+    if (num.size() < last - first) num.insert(0, last - first - num.size(), '0');
+    return pattern.substr(0, first) + num + pattern.substr(last);
+}
+
+std::string JsonEscape(const std::string& s) {
+    std::string out;
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (static_cast<unsigned char>(c) < 0x20) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        } else out += c;
+    }
+    return out;
+}
+
+} // namespace
+
+// Traces every camera of the path into the path tracer's accumulation image, off screen.
+// Submissions alternate between FRAMES_IN_FLIGHT command buffers; the last one of a frame
+// copies the accumulation into a FrameWriter slot, which is encoded on the thread pool
+// once its fence signals, while the next frame is already tracing.
+bool Application::RunOfflineRender(const OfflineRenderSettings& settings) {
+    Logger::Initialize();
+    mInput.Initialize();
+
+    CameraPath cameraPath;
+    if (!cameraPath.Load(settings.cameraPath))
+        return false;
+
+    mHeadless       = true;
+    mHeadlessExtent = {settings.width  ? settings.width  : WINDOW_WIDTH,
+                       settings.height ? settings.height : WINDOW_HEIGHT};
+    InitVulkan();
+    mShowUI = false;
+    if (!mRTPipelineSupported) {
+        LOG_ERROR("--render needs ray tracing pipeline support");
+        CleanupVulkan();
+        return false;
+    }
+
+    // All BLAS batches must be in the TLAS before the first sample
+    while (!mAccelStructure.IsBLASBuildComplete()) {
+        mAccelStructure.UpdateBLASBuilds();
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    mRegistry.UpdateTransforms();
+    mTransfer.Flush();
+    RestructureTLAS();
+
+    auto device    = mDevice.GetHandle();
+    auto allocator = mMemory.GetAllocator();
+    const uint32_t width  = mHeadlessExtent.width;
+    const uint32_t height = mHeadlessExtent.height;
+    mPathTracer.progressive = true;
+
+    constexpr uint32_t kSlots = FRAMES_IN_FLIGHT;
+    // Passes per submission: amortizes the submit, short enough to stay clear of device timeouts
+    constexpr uint32_t kPassesPerSubmit = 8;
+
+    VkCommandPool cmdPool = VK_NULL_HANDLE;
+    VkCommandBuffer cmds[kSlots]{};
+    VkFence fences[kSlots]{};
+    VkQueryPool queryPool = VK_NULL_HANDLE;
+    {
+        VkCommandPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+        poolCI.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        poolCI.queueFamilyIndex = mDevice.GetQueueFamilyIndices().graphicsFamily;
+        VK_CHECK(vkCreateCommandPool(device, &poolCI, nullptr, &cmdPool));
+
+        VkCommandBufferAllocateInfo allocCI{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+        allocCI.commandPool        = cmdPool;
+        allocCI.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocCI.commandBufferCount = kSlots;
+        VK_CHECK(vkAllocateCommandBuffers(device, &allocCI, cmds));
+
+        VkFenceCreateInfo fenceCI{VK_STRUCTURE_TYPE_FENCE_CREATE_INFO};
+        fenceCI.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+        for (auto& f : fences) VK_CHECK(vkCreateFence(device, &fenceCI, nullptr, &f));
+
+        // Begin / end of each frame still in flight
+        VkQueryPoolCreateInfo queryCI{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+        queryCI.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+        queryCI.queryCount = 2 * kSlots;
+        VK_CHECK(vkCreateQueryPool(device, &queryCI, nullptr, &queryPool));
+    }
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(mDevice.GetPhysicalDevice(), &props);
+    const double timestampMs = props.limits.timestampPeriod / 1e6;
+
+    FrameWriter writer;
+    writer.Initialize(allocator, &mThreadPool, width, height, kSlots);
+    if (!settings.referencePath.empty()) {
+        std::vector<float> reference;
+        uint32_t refW = 0, refH = 0;
+        if (!ReadPFM(settings.referencePath, reference, refW, refH))
+            LOG_ERROR("Cannot read reference image {}", settings.referencePath);
+        else if (refW != width || refH != height)
+            LOG_ERROR("Reference {} is {}x{}, frames are {}x{}; skipping RMSE",
+                      settings.referencePath, refW, refH, width, height);
+        else
+            writer.SetReference(std::move(reference));
+    }
+
+    const uint32_t frameCount = static_cast<uint32_t>(cameraPath.GetFrameCount());
+    const bool     sequence   = frameCount > 1;
+    {
+        std::filesystem::path dir = std::filesystem::path(FramePath(settings.outputPattern, 0, sequence)).parent_path();
+        std::error_code ec;
+        if (!dir.empty()) std::filesystem::create_directories(dir, ec);
+    }
+
+    struct FrameRecord {
+        uint32_t passes    = 0;
+        double   spp       = 0.0;
+        bool     converged = false;
+        double   gpuMs     = 0.0;
+        double   wallMs    = 0.0;   // first submission to readback complete
+        std::chrono::steady_clock::time_point start;
+    };
+    std::vector<FrameRecord> records(frameCount);
+    int32_t slotFrame[kSlots];
+    std::fill(std::begin(slotFrame), std::end(slotFrame), -1);
+
+    // The slot's fence has signaled: collect adaptive statistics and hand a finished frame to the writer
+    auto retireSlot = [&](uint32_t s) {
+        mPathTracer.BeginFrame(s);
+        if (slotFrame[s] < 0) return;
+        uint32_t f = static_cast<uint32_t>(slotFrame[s]);
+        slotFrame[s] = -1;
+
+        FrameRecord& rec = records[f];
+        uint64_t ts[2] = {};
+        if (vkGetQueryPoolResults(device, queryPool, 2 * (f % kSlots), 2, sizeof(ts), ts,
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS)
+            rec.gpuMs = double(ts[1] - ts[0]) * timestampMs;
+        rec.wallMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - rec.start).count();
+        writer.Encode(f % kSlots, f, FramePath(settings.outputPattern, f, sequence));
+    };
+
+    uint32_t submitIndex = 0;
+    auto beginSlot = [&]() {
+        uint32_t s = submitIndex++ % kSlots;
+        VK_CHECK(vkWaitForFences(device, 1, &fences[s], VK_TRUE, UINT64_MAX));
+        retireSlot(s);
+        VK_CHECK(vkResetFences(device, 1, &fences[s]));
+        VK_CHECK(vkResetCommandBuffer(cmds[s], 0));
+        VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+        beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+        VK_CHECK(vkBeginCommandBuffer(cmds[s], &beginInfo));
+        return s;
+    };
+    auto submitSlot = [&](uint32_t s) {
+        VK_CHECK(vkEndCommandBuffer(cmds[s]));
+        VkSubmitInfo submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO};
+        submitInfo.commandBufferCount = 1;
+        submitInfo.pCommandBuffers    = &cmds[s];
+        VK_CHECK(vkQueueSubmit(mDevice.GetGraphicsQueue(), 1, &submitInfo, fences[s]));
+    };
+
+    float az = glm::radians(mLightAzimuth);
+    float el = glm::radians(mLightElevation);
+    glm::vec3 sunDir = glm::normalize(glm::vec3(
+        -glm::cos(el) * glm::sin(az), -glm::sin(el), -glm::cos(el) * glm::cos(az)));
+    const auto* sunLight = mRegistry.GetLight(mSunEntity);
+    glm::vec3 sunColor     = sunLight ? sunLight->color     : glm::vec3(1.0f);
+    float     sunIntensity = sunLight ? sunLight->intensity : 1.0f;
+    const float aspect = static_cast<float>(width) / static_cast<float>(height);
+    const uint32_t targetSpp = std::max(settings.targetSpp, 1u);
+
+    LOG_INFO("Offline render: {} frames at {}x{}, {} spp{}", frameCount, width, height, targetSpp,
+             mPathTracer.adaptiveSampling ? " or until converged" : "");
+    auto renderStart = std::chrono::steady_clock::now();
+
+    for (uint32_t f = 0; f < frameCount; f++) {
+        const CameraPath::Frame& key = cameraPath.GetFrame(f);
+        mCamera.Init(key.position, key.target, key.fovDeg, mCamera.GetNear(), mCamera.GetFar());
+        glm::mat4 viewProj    = mCamera.GetProjectionMatrix(aspect) * mCamera.GetViewMatrix();
+        glm::mat4 invViewProj = glm::inverse(viewProj);
+        mPathTracer.ResetAccumulation();
+
+        FrameRecord& rec = records[f];
+        rec.start = std::chrono::steady_clock::now();
+        const uint32_t query = 2 * (f % kSlots);
+
+        // Convergence comes from a readback a couple of submissions old, so it may overshoot slightly
+        while (rec.passes < targetSpp && !(rec.passes > 0 && mPathTracer.IsConverged())) {
+            uint32_t s = beginSlot();
+            if (rec.passes == 0) {
+                vkCmdResetQueryPool(cmds[s], queryPool, query, 2);
+                vkCmdWriteTimestamp2(cmds[s], VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, queryPool, query);
+            }
+            uint32_t passes = std::min(kPassesPerSubmit, targetSpp - rec.passes);
+            for (uint32_t p = 0; p < passes; p++)
+                mPathTracer.Trace(cmds[s], invViewProj, viewProj, mCamera.GetPosition(),
+                                  -sunDir, sunColor, sunIntensity, mRTLightRadius, false);
+            rec.passes += passes;
+            submitSlot(s);
+        }
+
+        const PTAdaptiveStats& as = mPathTracer.GetAdaptiveStats();
+        rec.converged = mPathTracer.IsConverged();
+        rec.spp = (mPathTracer.adaptiveSampling && as.pixels) ? as.samples / double(as.pixels) : double(rec.passes);
+
+        uint32_t s = beginSlot();
+        writer.RecordCopy(cmds[s], mPathTracer.GetAccumOutputImage(), f % kSlots);
+        vkCmdWriteTimestamp2(cmds[s], VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, queryPool, query + 1);
+        slotFrame[s] = static_cast<int32_t>(f);
+        submitSlot(s);
+    }
+
+    // Oldest submission first so frames reach the writer in order
+    for (uint32_t i = 0; i < kSlots; i++) {
+        uint32_t s = (submitIndex + i) % kSlots;
+        VK_CHECK(vkWaitForFences(device, 1, &fences[s], VK_TRUE, UINT64_MAX));
+        retireSlot(s);
+    }
+    const auto& results = writer.Flush();
+    double totalS = std::chrono::duration<double>(std::chrono::steady_clock::now() - renderStart).count();
+
+    bool allWritten = results.size() == frameCount;
+    for (const auto& r : results) allWritten = allWritten && r.ok;
+
+    if (FILE* report = std::fopen(settings.reportPath.c_str(), "w")) {
+        std::fprintf(report, "{\n");
+        std::fprintf(report, "  \"cameraPath\": \"%s\",\n", JsonEscape(settings.cameraPath).c_str());
+        std::fprintf(report, "  \"width\": %u,\n  \"height\": %u,\n", width, height);
+        std::fprintf(report, "  \"targetSpp\": %u,\n", targetSpp);
+        std::fprintf(report, "  \"integrator\": \"%s\",\n",
+                     mPathTracer.GetActiveIntegrator() == PTIntegrator::Wavefront ? "wavefront" : "megakernel");
+        std::fprintf(report, "  \"maxBounces\": %d,\n", mPathTracer.maxBounces);
+        std::fprintf(report, "  \"sampler\": \"%s\",\n",
+                     mPathTracer.sampler == PTSampler::LowDiscrepancy ? "sobol" : "random");
+        if (mPathTracer.adaptiveSampling)
+            std::fprintf(report, "  \"adaptiveThreshold\": %g,\n", mPathTracer.adaptiveThreshold);
+        std::fprintf(report, "  \"lights\": %u,\n  \"restir\": %s,\n", mLightBuffer.GetLightCount(),
+                     mPathTracer.IsReSTIRActive() ? "true" : "false");
+        std::fprintf(report, "  \"totalSeconds\": %.3f,\n", totalS);
+        std::fprintf(report, "  \"frames\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const auto& r   = results[i];
+            const auto& rec = records[r.frame];
+            std::fprintf(report,
+                "    {\"frame\": %u, \"file\": \"%s\", \"written\": %s, \"passes\": %u, \"spp\": %.2f, "
+                "\"converged\": %s, \"gpuMs\": %.3f, \"wallMs\": %.3f, \"encodeMs\": %.3f",
+                r.frame, JsonEscape(r.path).c_str(), r.ok ? "true" : "false", rec.passes, rec.spp,
+                rec.converged ? "true" : "false", rec.gpuMs, rec.wallMs, r.encodeMs);
+            if (r.rmse >= 0.0)
+                std::fprintf(report, ", \"rmse\": %.6g", r.rmse);
+            std::fprintf(report, "}%s\n", i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(report, "  ]\n}\n");
+        std::fclose(report);
+    } else {
+        LOG_ERROR("Cannot write render report {}", settings.reportPath);
+    }
+
+    LOG_INFO("Offline render: {} of {} frames written in {:.2f} s, report {}",
+             results.size(), frameCount, totalS, settings.reportPath);
+
+    writer.Shutdown(allocator);
+    vkDestroyQueryPool(device, queryPool, nullptr);
+    for (auto f : fences) vkDestroyFence(device, f, nullptr);
+    vkDestroyCommandPool(device, cmdPool, nullptr);
+    CleanupVulkan();
+    return allWritten;
 }
 
 // =======================================================================
@@ -148,16 +967,19 @@ void Application::InitWindow() {
 }
 
 void Application::InitVulkan() {
-    mVulkanInstance.Initialize("VulkanRenderVB");
-    mSurface = mVulkanInstance.CreateSurface(mWindow.GetHandle());
+    mVulkanInstance.Initialize("VulkanRenderVB", !mHeadless);
+    if (!mHeadless)
+        mSurface = mVulkanInstance.CreateSurface(mWindow.GetHandle());
     mDevice.Initialize(mVulkanInstance.GetHandle(), mSurface);
     mMemory.Initialize(mVulkanInstance.GetHandle(), mDevice.GetPhysicalDevice(), mDevice.GetHandle());
-    mSwapchain.Initialize(mDevice.GetHandle(), mDevice.GetPhysicalDevice(),
-                          mSurface, mWindow.GetHandle(), mDevice.GetQueueFamilyIndices());
-    mSync.Initialize(mDevice.GetHandle(), FRAMES_IN_FLIGHT, mSwapchain.GetImageCount());
+    if (!mHeadless)
+        mSwapchain.Initialize(mDevice.GetHandle(), mDevice.GetPhysicalDevice(),
+                              mSurface, mWindow.GetHandle(), mDevice.GetQueueFamilyIndices());
+    const uint32_t imageCount = mHeadless ? FRAMES_IN_FLIGHT : mSwapchain.GetImageCount();
+    mSync.Initialize(mDevice.GetHandle(), FRAMES_IN_FLIGHT, imageCount);
     mCommandBuffers.Initialize(mDevice.GetHandle(), mDevice.GetQueueFamilyIndices().graphicsFamily,
-                               mSwapchain.GetImageCount());
-    mImageFences.resize(mSwapchain.GetImageCount(), VK_NULL_HANDLE);
+                               imageCount);
+    mImageFences.resize(imageCount, VK_NULL_HANDLE);
 
     {
         VkPhysicalDeviceProperties props;
@@ -171,8 +993,9 @@ void Application::InitVulkan() {
         LOG_INFO("Supported MSAA up to: {}x", static_cast<int>(mSupportedMSAA.back()));
     }
 
-    mTransfer.Initialize(mDevice.GetHandle(), mDevice.GetQueueFamilyIndices().graphicsFamily,
-                         mDevice.GetGraphicsQueue());
+    mTransfer.Initialize(mDevice.GetHandle(), mMemory.GetAllocator(),
+                         mDevice.GetQueueFamilyIndices().transferFamily, mDevice.GetTransferQueue(),
+                         mDevice.GetQueueFamilyIndices().graphicsFamily, mDevice.GetGraphicsQueue());
     mDescriptors.Initialize(mDevice.GetHandle());
     mShaders.Initialize(mDevice.GetHandle());
     mPipelines.Initialize(mDevice.GetHandle());
@@ -186,30 +1009,39 @@ void Application::InitVulkan() {
     mImageCache.Initialize(mDevice.GetHandle(), mMemory.GetAllocator());
     mRenderGraph.Initialize(mDevice.GetHandle(), &mImageCache);
 
+    // Scene import (mesh optimization), the software occlusion culler and the draw sort
+    // use the workers even without multi-threaded recording
+    mThreadPool.Initialize();
+
+    mTransfer.ResetStats();
     CreateDefaultTextures();
     if (mCurrentScene == SceneType::TestScene)
         LoadTestScene();
     else
         LoadScene();
+    FinishSceneUpload();
     CreateDepthBuffer();
     CreateFrameDescriptors();
+    mInstanceBatcher.Initialize(mDevice.GetHandle(), mMemory.GetAllocator(), FRAMES_IN_FLIGHT);
     CreatePipelines();
 
     InitGPUDriven();
     InitRayTracing();
 
     {
-        auto extent = mSwapchain.GetExtent();
+        auto extent = GetOutputExtent();
         mPostProcess.Initialize(mDevice.GetHandle(), mMemory.GetAllocator(), mShaders,
-                                mSwapchain.GetImageFormat(), extent.width, extent.height);
+                                GetOutputFormat(), extent.width, extent.height);
     }
 
     InitDebugUI();
 
     mModelData = ModelData{};
 
+    mInstanceBatcher.SetThreadPool(&mThreadPool);
+    mSoftwareOcclusion.Initialize();
+
     if (mMultiThreading) {
-        mThreadPool.Initialize();
         mSubmitThread.Initialize(mDevice.GetGraphicsQueue(), mDevice.GetPresentQueue());
 
         uint32_t workerCount = mThreadPool.GetThreadCount();
@@ -232,7 +1064,7 @@ void Application::InitVulkan() {
     }
 
     mCamera.Init(glm::vec3(0, 1.6f, 0), glm::vec3(0, 1.6f, -1.0f), 45.0f, 0.01f, 100.0f);
-    mLastFrameTime = glfwGetTime();
+    mLastFrameTime = mHeadless ? 0.0 : glfwGetTime();
     mInput.LoadBindings("input_bindings.cfg");
 
     LOG_INFO("Vulkan initialization complete (Phase 7 - Debug Tools & Profiling)");
@@ -273,17 +1105,18 @@ void Application::CreateDefaultTextures() {
 // =======================================================================
 // Scene loading (ECS-based)
 // =======================================================================
-void Application::LoadScene() {
-    auto device    = mDevice.GetHandle();
-    auto allocator = mMemory.GetAllocator();
-
+// Sun of the glTF scenes: LoadScene and the headless CPU reference
+void Application::AddSceneSun() {
     mSunEntity = mRegistry.CreateEntity();
     mRegistry.AddTransform(mSunEntity);
     auto& sunLight = mRegistry.AddLight(mSunEntity);
     sunLight.direction = glm::normalize(glm::vec3(-0.4f, -0.8f, -0.3f));
     sunLight.color     = glm::vec3(1.0f, 0.95f, 0.85f);
     sunLight.intensity = 3.5f;
+}
 
+// --scene if given, else the first model found under assets/, into mModelData
+bool Application::LoadSceneModel() {
     bool loaded = false;
 
     if (!mScenePathOverride.empty()) {
@@ -319,9 +1152,49 @@ void Application::LoadScene() {
         }
     }
 
-    if (loaded) {
+    if (loaded)
         ModelLoader::SortMeshesByVolume(mModelData.meshes);
+    return loaded;
+}
+
+// One entity per glTF mesh instance and KHR_lights_punctual light of mModelData
+void Application::AddModelEntities() {
+    for (const auto& inst : mModelData.instances) {
+        if (inst.meshIndex < 0 || inst.meshIndex >= static_cast<int>(mModelData.meshes.size()))
+            continue;
+        Entity e = mRegistry.CreateEntity();
+        auto& tc = mRegistry.AddTransform(e);
+        tc.localPosition = inst.translation;
+        tc.localRotation = inst.rotation;
+        tc.localScale    = inst.scale;
+        mRegistry.AddMesh(e).meshIndex = inst.meshIndex;
+        mRegistry.AddMaterial(e).materialIndex = std::max(0, mModelData.meshes[inst.meshIndex].materialIndex);
+    }
 
+    // KHR_lights_punctual: lit by the path tracer's light buffer
+    for (const auto& light : mModelData.lights) {
+        Entity e = mRegistry.CreateEntity();
+        mRegistry.AddTransform(e).localPosition = light.position;
+        auto& lc = mRegistry.AddLight(e);
+        lc.type           = light.type == LightData::Type::Spot ? LightComponent::Type::Spot
+                                                                : LightComponent::Type::Point;
+        lc.direction      = light.direction;
+        lc.color          = light.color;
+        lc.intensity      = light.intensity;
+        lc.range          = light.range;
+        lc.innerConeAngle = light.innerConeAngle;
+        lc.outerConeAngle = light.outerConeAngle;
+    }
+}
+
+void Application::LoadScene() {
+    auto device    = mDevice.GetHandle();
+    auto allocator = mMemory.GetAllocator();
+
+    AddSceneSun();
+    bool loaded = LoadSceneModel();
+
+    if (loaded) {
         std::vector<bool> isLinear(mModelData.textures.size(), false);
         for (const auto& mat : mModelData.materials) {
             if (mat.metallicRoughnessTextureIndex >= 0)
@@ -361,21 +1234,12 @@ void Application::LoadScene() {
             g.metallicRoughnessTexIdx = resolveIdx(mat.metallicRoughnessTextureIndex, mWhiteTexDescIdx);
             g.aoTexIdx                = resolveIdx(mat.occlusionTextureIndex, mWhiteTexDescIdx);
             g.emissiveTexIdx          = resolveIdx(mat.emissiveTextureIndex, mBlackTexDescIdx);
+            g.alphaCutoff             = mat.alphaCutoff;
+            g.alphaMode               = static_cast<uint32_t>(mat.alphaMode);
             mGPUMaterials.push_back(g);
         }
 
-        for (const auto& inst : mModelData.instances) {
-            if (inst.meshIndex < 0 || inst.meshIndex >= static_cast<int>(mModelData.meshes.size()))
-                continue;
-            Entity e = mRegistry.CreateEntity();
-            auto& tc = mRegistry.AddTransform(e);
-            tc.localPosition = inst.translation;
-            tc.localRotation = inst.rotation;
-            tc.localScale    = inst.scale;
-            mRegistry.AddMesh(e).meshIndex = inst.meshIndex;
-            mRegistry.AddMaterial(e).materialIndex = std::max(0, mModelData.meshes[inst.meshIndex].materialIndex);
-        }
-
+        AddModelEntities();
     } else {
         LOG_INFO("No glTF model found, generating procedural scene");
 
@@ -523,6 +1387,17 @@ void Application::LoadScene() {
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
         mGPUMaterials.data(), mGPUMaterials.size() * sizeof(GPUMaterialData));
 
+    if (mMeshOptimization)
+        mMeshOptReport = MeshOptimizer::OptimizeMeshes(mModelData.meshes, &mThreadPool);
+    if (mMeshLODs)
+        mLODReport = MeshSimplifier::GenerateLODs(mModelData.meshes, &mThreadPool);
+
+    mSoftwareOcclusion.SetMeshes(mModelData.meshes);
+    if (!mCPUReferencePath.empty())
+        mCPUPathTracer.SetMeshes(mModelData.meshes);
+    if (mDevice.IsRayTracingSupported())
+        mLightBuffer.SetMeshes(mModelData.meshes, mModelData.materials, mModelData.textures);
+
     if (mDevice.IsRayTracingSupported()) {
         mMeshPool.Upload(allocator, mTransfer, mModelData.meshes,
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
@@ -543,20 +1418,29 @@ void Application::LoadScene() {
 // =======================================================================
 // Depth buffer
 // =======================================================================
+VkExtent2D Application::GetOutputExtent() const {
+    return mHeadless ? mHeadlessExtent : mSwapchain.GetExtent();
+}
+
+// Headless runs still build the post-process and debug pipelines; they only need a format
+VkFormat Application::GetOutputFormat() const {
+    return mHeadless ? VK_FORMAT_B8G8R8A8_SRGB : mSwapchain.GetImageFormat();
+}
+
 void Application::CreateDepthBuffer() {
-    auto extent = mSwapchain.GetExtent();
+    auto extent = GetOutputExtent();
     mDepthImage.CreateDepth(mMemory.GetAllocator(), mDevice.GetHandle(),
                             extent.width, extent.height);
 }
 
 // =======================================================================
-// Frame descriptors (set 1: 7 bindings -- UBO + mat SSBO + shadow + IBL + object SSBO)
+// Frame descriptors (set 1: 8 bindings -- UBO + mat SSBO + shadow + IBL + object SSBO + instance list)
 // =======================================================================
 void Application::CreateFrameDescriptors() {
     auto device     = mDevice.GetHandle();
     uint32_t frames = FRAMES_IN_FLIGHT;
 
-    VkDescriptorSetLayoutBinding bindings[7]{};
+    VkDescriptorSetLayoutBinding bindings[8]{};
     bindings[0] = {0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1,
                    VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
     bindings[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
@@ -571,16 +1455,18 @@ void Application::CreateFrameDescriptors() {
                    VK_SHADER_STAGE_FRAGMENT_BIT, nullptr};
     bindings[6] = {6, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
                    VK_SHADER_STAGE_VERTEX_BIT, nullptr};
+    bindings[7] = {7, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1,
+                   VK_SHADER_STAGE_VERTEX_BIT, nullptr};
 
     VkDescriptorSetLayoutCreateInfo layoutCI{};
     layoutCI.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutCI.bindingCount = 7;
+    layoutCI.bindingCount = 8;
     layoutCI.pBindings    = bindings;
     VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &mFrameSetLayout));
 
     VkDescriptorPoolSize poolSizes[] = {
         { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,         frames },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         frames * 2 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,         frames * 3 },
         { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, frames * 4 },
     };
     VkDescriptorPoolCreateInfo poolCI{};
@@ -640,7 +1526,7 @@ void Application::CreateFrameDescriptors() {
         vkUpdateDescriptorSets(device, 6, writes, 0, nullptr);
     }
 
-    LOG_INFO("Frame descriptors created ({} sets, 7 bindings each)", frames);
+    LOG_INFO("Frame descriptors created ({} sets, 8 bindings each)", frames);
 }
 
 // =======================================================================
@@ -649,23 +1535,10 @@ void Application::CreateFrameDescriptors() {
 void Application::CreatePipelines() {
     auto device = mDevice.GetHandle();
 
-    VkVertexInputBindingDescription bindingDesc{};
-    bindingDesc.binding   = 0;
-    bindingDesc.stride    = sizeof(MeshVertex);
-    bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription attrDescs[4]{};
-    attrDescs[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, position)};
-    attrDescs[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, normal)};
-    attrDescs[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT,       offsetof(MeshVertex, texCoord)};
-    attrDescs[3] = {3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(MeshVertex, tangent)};
-
-    VkPipelineVertexInputStateCreateInfo vertexInput{};
-    vertexInput.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInput.vertexBindingDescriptionCount   = 1;
-    vertexInput.pVertexBindingDescriptions      = &bindingDesc;
-    vertexInput.vertexAttributeDescriptionCount = 4;
-    vertexInput.pVertexAttributeDescriptions    = attrDescs;
+    // Vertex layout and the PACKED_VERTICES specialization follow the mesh pool format
+    VertexInputLayout          vertexLayout(mMeshPool.GetVertexFormat());
+    VertexFormatSpecialization vertexSpec(mMeshPool.GetVertexFormat());
+    const VkPipelineVertexInputStateCreateInfo& vertexInput = vertexLayout.state;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -693,7 +1566,7 @@ void Application::CreatePipelines() {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -719,15 +1592,18 @@ void Application::CreatePipelines() {
         colorBlend.attachmentCount = 1;
         colorBlend.pAttachments    = &blendAtt;
 
-        VkDescriptorSetLayout setLayouts[] = { mDescriptors.GetLayout(), mFrameSetLayout };
+        // Set 2: per-instance world matrices, the draws are instanced batches
+        VkDescriptorSetLayout setLayouts[] = { mDescriptors.GetLayout(), mFrameSetLayout,
+                                               mInstanceBatcher.GetSetLayout() };
         VkPushConstantRange pushRange{};
         pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
         pushRange.offset     = 0;
-        pushRange.size       = static_cast<uint32_t>(sizeof(glm::mat4) + sizeof(uint32_t));
+        pushRange.size       = static_cast<uint32_t>(4 * sizeof(uint32_t) +
+                                                     2 * sizeof(glm::vec4));   // material + dequant AABB
 
         VkPipelineLayoutCreateInfo layoutCI{};
         layoutCI.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-        layoutCI.setLayoutCount         = 2;
+        layoutCI.setLayoutCount         = 3;
         layoutCI.pSetLayouts            = setLayouts;
         layoutCI.pushConstantRangeCount = 1;
         layoutCI.pPushConstantRanges    = &pushRange;
@@ -756,6 +1632,7 @@ void Application::CreatePipelines() {
         ci.layout              = mPBRPipelineLayout;
 
         VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ci, nullptr, &mPBRPipeline));
+        CreateAlphaVariants(ci, &mPBRMaskedPipeline, &mPBRBlendPipeline);
     }
 
     // -------- Shadow pipeline --------
@@ -765,7 +1642,7 @@ void Application::CreatePipelines() {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -778,6 +1655,7 @@ void Application::CreatePipelines() {
         rasterizer.depthBiasEnable         = VK_TRUE;
         rasterizer.depthBiasConstantFactor = 1.25f;
         rasterizer.depthBiasSlopeFactor    = 1.75f;
+        rasterizer.depthClampEnable        = VK_TRUE;   // casters in front of the cascade pancake onto its near plane
 
         VkPipelineDepthStencilStateCreateInfo depthStencil{};
         depthStencil.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -789,13 +1667,16 @@ void Application::CreatePipelines() {
         colorBlend.sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
         colorBlend.attachmentCount = 0;
 
+        VkDescriptorSetLayout instanceLayout = mInstanceBatcher.GetSetLayout();
         VkPushConstantRange pushRange{};
         pushRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT;
         pushRange.offset     = 0;
-        pushRange.size       = sizeof(glm::mat4);
+        pushRange.size       = static_cast<uint32_t>(sizeof(glm::mat4) + 2 * sizeof(glm::vec4));
 
         VkPipelineLayoutCreateInfo layoutCI{};
         layoutCI.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        layoutCI.setLayoutCount         = 1;
+        layoutCI.pSetLayouts            = &instanceLayout;
         layoutCI.pushConstantRangeCount = 1;
         layoutCI.pPushConstantRanges    = &pushRange;
         VK_CHECK(vkCreatePipelineLayout(device, &layoutCI, nullptr, &mShadowPipelineLayout));
@@ -829,7 +1710,7 @@ void Application::CreatePipelines() {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -886,6 +1767,7 @@ void Application::CreatePipelines() {
         ciI.layout              = mPBRIndirectPipelineLayout;
 
         VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ciI, nullptr, &mPBRIndirectPipeline));
+        CreateAlphaVariants(ciI, &mPBRIndirectMaskedPipeline, &mPBRIndirectBlendPipeline);
     }
 
     // -------- Depth pre-pass pipeline (for occluder draw) --------
@@ -895,7 +1777,7 @@ void Application::CreatePipelines() {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -943,6 +1825,7 @@ void Application::CreatePipelines() {
         ciDP.layout              = mDepthPrepassPipelineLayout;
 
         VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ciDP, nullptr, &mDepthPrepassPipeline));
+        CreateAlphaVariants(ciDP, &mDepthPrepassMaskedPipeline, nullptr);
     }
 
     // -------- Shadow indirect pipeline --------
@@ -952,7 +1835,7 @@ void Application::CreatePipelines() {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -965,6 +1848,7 @@ void Application::CreatePipelines() {
         rasterizer.depthBiasEnable         = VK_TRUE;
         rasterizer.depthBiasConstantFactor = 1.25f;
         rasterizer.depthBiasSlopeFactor    = 1.75f;
+        rasterizer.depthClampEnable        = VK_TRUE;   // casters in front of the cascade pancake onto its near plane
 
         VkPipelineDepthStencilStateCreateInfo depthStencilS{};
         depthStencilS.sType            = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
@@ -1089,6 +1973,17 @@ void Application::DrawFrame() {
 
     vkResetFences(device, 1, &frameFence);
 
+    // Push scene changes into this frame's staging; the copies are recorded below
+    if (mGPUDriven && mIndirectRenderer.Sync(mMemory.GetAllocator(), mTransfer, mMeshPool,
+                                             mRegistry, mGPUMaterials, mFrameIndex))
+        UpdateGPUSceneDescriptors();
+    if (mGPUDriven && (mStaleSceneDescFrames & (1u << mFrameIndex)))
+        UpdateFrameSceneDescriptors(mFrameIndex);
+    if (mGPUDriven)
+        mComputeCulling.BeginFrame(mFrameIndex);
+    if (mRTPipelineSupported)
+        mPathTracer.BeginFrame(mFrameIndex);
+
     VkExtent2D extent = mSwapchain.GetExtent();
     float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
     glm::mat4 view = mCamera.GetViewMatrix();
@@ -1123,22 +2018,55 @@ void Application::DrawFrame() {
     mGPUProfiler.CollectResults(device, mFrameIndex);
     mPipelineStats.CollectResults(device, mFrameIndex);
 
+    // Moved entities reach the TLAS this frame; only their instances are rewritten
+    TLASUpdate tlasUpdate = TLASUpdate::None;
+    if (mRayTracingEnabled) {
+        for (const auto& r : mGPUProfiler.GetResults())
+            if (r.name == "TLAS Update") mAccelStructure.AddUpdateGPUTime(r.durationMs);
+        mAccelStructure.UpdateBLASBuilds();
+        tlasUpdate = mAccelStructure.PrepareUpdate(mFrameIndex, mRegistry, mMeshPool);
+        if (tlasUpdate == TLASUpdate::Restructure)
+            RestructureTLAS();
+        if (tlasUpdate != TLASUpdate::None && mRTPipelineSupported)
+            mPathTracer.ResetAccumulation();
+    }
+
     auto cmd = mCommandBuffers.Begin(device, imageIndex);
 
     mGPUProfiler.BeginFrame(cmd, mFrameIndex);
+    if (tlasUpdate == TLASUpdate::Refit || tlasUpdate == TLASUpdate::Rebuild) {
+        mGPUProfiler.BeginScope(cmd, mFrameIndex, "TLAS Update");
+        mAccelStructure.RecordUpdate(cmd);
+        mGPUProfiler.EndScope(cmd, mFrameIndex);
+    }
+    if (mGPUDriven)
+        mIndirectRenderer.RecordUploads(cmd, mFrameIndex);
     BuildAndExecuteRenderGraph(cmd, imageIndex);
     mGPUProfiler.EndFrame(cmd, mFrameIndex);
 
     mCommandBuffers.End(imageIndex);
 
-    VkSemaphore          waitSems[]   = { acquireSem };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+    // Uploads queued since the last frame must land before this frame reads them, and
+    // so must the BLAS builds the TLAS now references (already complete on the host)
+    UploadToken uploads = mTransfer.Flush();
+
+    VkSemaphore          waitSems[]   = { acquireSem, mTransfer.GetTimeline(), mAccelStructure.GetBLASTimeline() };
+    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+                                          VK_PIPELINE_STAGE_ALL_COMMANDS_BIT,
+                                          VK_PIPELINE_STAGE_ALL_COMMANDS_BIT };
+    uint64_t             waitValues[] = { 0, uploads, mAccelStructure.GetBLASReadyValue() };
+    const uint32_t       waitCount    = mRayTracingEnabled ? 3 : 2;
     VkSemaphore          signalSems[] = { mSync.GetRenderFinishedSemaphore(imageIndex) };
     VkCommandBuffer      cmdBuf       = mCommandBuffers.Get(imageIndex);
 
+    VkTimelineSemaphoreSubmitInfo timelineInfo{VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO};
+    timelineInfo.waitSemaphoreValueCount = waitCount;
+    timelineInfo.pWaitSemaphoreValues    = waitValues;
+
     VkSubmitInfo submitInfo{};
     submitInfo.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount   = 1;
+    submitInfo.pNext                = &timelineInfo;
+    submitInfo.waitSemaphoreCount   = waitCount;
     submitInfo.pWaitSemaphores      = waitSems;
     submitInfo.pWaitDstStageMask    = waitStages;
     submitInfo.commandBufferCount   = 1;
@@ -1176,8 +2104,26 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
 
     bool useGPU       = mGPUDriven && mIndirectRenderer.GetDrawCount() > 0;
     bool useOcclusion = useGPU && mOcclusionCulling;
+    bool useClusters  = useGPU && mClusterCulling && mIndirectRenderer.GetClusterCount() > 0;
+    bool useGroups    = useGPU && mGPUInstancing && !useClusters;   // meshlets always draw alone
+
+    // Culling outputs are partitioned like the work list: per object or per meshlet
+    const IndexClassRanges& cullRanges = useClusters ? mIndirectRenderer.GetClusterRanges()
+                                                     : mIndirectRenderer.GetDrawRanges();
+    // Masked draws fill the second half of each list, after every opaque slot
+    IndexClassRanges maskedRanges = cullRanges;
+    for (uint32_t c = 0; c < INDEX_CLASS_COUNT; c++)
+        maskedRanges.first[c] += mComputeCulling.GetMaskedListBase();
+
+    // Alpha modes in use; the masked and blended indirect draws are skipped without them
+    bool anyMasked = false, anyBlended = false;
+    for (const GPUMaterialData& mat : mGPUMaterials) {
+        anyMasked  |= mat.alphaMode == static_cast<uint32_t>(AlphaMode::Mask);
+        anyBlended |= mat.alphaMode == static_cast<uint32_t>(AlphaMode::Blend);
+    }
 
-    CullParams cullParams{};
+    CullParams       cullParams{};
+    ShadowCullParams shadowCullParams{};   // read by ShadowCullPass at execute time
     if (useGPU) {
         float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
         glm::mat4 view = mCamera.GetViewMatrix();
@@ -1189,15 +2135,28 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
         cullParams.hiZSize        = glm::vec2(float(mHiZBuffer.GetWidth()), float(mHiZBuffer.GetHeight()));
         cullParams.nearPlane      = mCamera.GetNear();
         cullParams.farPlane       = mCamera.GetFar();
-        cullParams.drawCount      = mIndirectRenderer.GetDrawCount();
-        cullParams.occluderCount  = useOcclusion ? mIndirectRenderer.GetOccluderCount()
-                                                 : mIndirectRenderer.GetDrawCount();
-        cullParams.candidateCount = 0;
+        cullParams.drawCount      = useClusters ? mIndirectRenderer.GetClusterCount()
+                                                : mIndirectRenderer.GetDrawCount();
+        cullParams.allOccluders   = useOcclusion ? 0u : 1u;
+        cullParams.uint32ClassBase = cullRanges.first[INDEX_CLASS_UINT32];
+        cullParams.cameraPosition  = glm::vec4(mCamera.GetPosition(), 1.0f);
+        cullParams.clusterMode     = useClusters ? 1u : 0u;
+        cullParams.lodScale        = LODScale(extent.height);
+        cullParams.lodThreshold    = mMeshLODs ? mLODThreshold : 0.0f;
+        cullParams.groupPhaseBase  = useGroups ? mIndirectRenderer.GetGroupCapacity() : 0u;
+
+        // Phase one tests against the pyramid the previous frame built, in that frame's view
+        cullParams.prevHiZValid       = (useOcclusion && mHiZHistoryValid) ? 1u : 0u;
+        cullParams.prevViewProjection = cullParams.prevHiZValid ? mPrevCullViewProj : viewProj;
+        mHiZHistoryValid = useOcclusion;
+        mPrevCullViewProj = viewProj;
 
         if (mFrameNumber == 0)
-            LOG_INFO("Culling: {} draws, {} occluders (ratio {}), occlusion {}",
-                     cullParams.drawCount, cullParams.occluderCount, mOccluderRatio,
+            LOG_INFO("Culling: {} {}, two-phase occlusion {}",
+                     cullParams.drawCount, useClusters ? "meshlets" : "draw slots",
                      useOcclusion ? "ON" : "OFF");
+    } else {
+        mHiZHistoryValid = false;
     }
 
     mRenderGraph.BeginFrame(mFrameNumber);
@@ -1240,7 +2199,12 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
             odDesc.frameDescSet          = mFrameDescSets[mFrameIndex];
             odDesc.meshPool              = &mMeshPool;
             odDesc.culling               = &mComputeCulling;
-            odDesc.maxDrawCount          = mIndirectRenderer.GetDrawCount();
+            odDesc.drawRanges            = cullRanges;
+            odDesc.maskedPipeline        = anyMasked ? mDepthPrepassMaskedPipeline : VK_NULL_HANDLE;
+            odDesc.maskedRanges          = maskedRanges;
+            odDesc.groupBuffer           = useGroups ? mComputeCulling.GetGroupIndirectBuffer() : VK_NULL_HANDLE;
+            odDesc.groupRanges           = mIndirectRenderer.GetGroupRanges();
+            odDesc.maskedGroupRanges     = mIndirectRenderer.GetMaskedGroupRanges();
             auto occDepthPassH = mRenderGraph.AddPass(std::make_unique<OccluderDepthPass>(odDesc));
 
             HiZBuildPass::Desc hzDesc{};
@@ -1267,22 +2231,88 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
     RenderGraph::PassHandle forwardPassH = RenderGraph::INVALID_PASS;
 
     if (needsRasterPasses) {
+        RenderGraph::PassHandle shadowCullPassH = RenderGraph::INVALID_PASS;
+        if (useGPU && mCSMEnabled) {
+            for (uint32_t c = 0; c < CC; c++)
+                for (uint32_t p = 0; p < CascadedShadowMap::CASTER_PLANE_COUNT; p++)
+                    shadowCullParams.casterPlanes[c * CascadedShadowMap::CASTER_PLANE_COUNT + p] =
+                        mCSM.GetCasterPlanes(c)[p];
+            shadowCullParams.drawCount       = mIndirectRenderer.GetDrawCount();
+            shadowCullParams.uint32ClassBase = mIndirectRenderer.GetDrawRanges().first[INDEX_CLASS_UINT32];
+            shadowCullParams.listStride      = mComputeCulling.GetShadowListStride();
+            shadowCullParams.cascadeCount    = CC;
+
+            ShadowCullPass::Desc scDesc{};
+            scDesc.culling = &mComputeCulling;
+            scDesc.params  = &shadowCullParams;
+            shadowCullPassH = mRenderGraph.AddPass(std::make_unique<ShadowCullPass>(scDesc));
+        }
+
+        // CPU draw path: camera and cascade caster culling through the scene BVH,
+        // the fallback for everything cull.comp / cull_shadow.comp do on the GPU
+        if (!useGPU) {
+            mSceneBVH.Sync(mRegistry, mMeshPool.GetDrawCommands());
+
+            float aspect = static_cast<float>(extent.width) / static_cast<float>(extent.height);
+            glm::mat4 viewProj = mCamera.GetProjectionMatrix(aspect) * mCamera.GetViewMatrix();
+            glm::vec4 planes[6];
+            ExtractFrustumPlanes(viewProj, planes);
+            CullVolumes camera;
+            camera.Set(0, planes, 6);
+            mSceneBVH.Cull(camera, mCameraVisibility);
+
+            if (mCSMEnabled) {
+                CullVolumes cascades;
+                for (uint32_t c = 0; c < CC; c++)
+                    cascades.Set(c, mCSM.GetCasterPlanes(c), CascadedShadowMap::CASTER_PLANE_COUNT);
+                mSceneBVH.Cull(cascades, mCasterMasks);
+            }
+
+            const std::vector<uint8_t>* visibility = &mCameraVisibility;
+            if (mOcclusionCulling) {
+                mSoftwareOcclusion.Cull(mRegistry, mMeshPool.GetDrawCommands(), viewProj, &mThreadPool,
+                                        &mCameraVisibility);
+                visibility = &mSoftwareOcclusion.GetVisibility();
+            }
+
+            // What survived culling becomes instanced draws, one per (mesh, LOD, material) run
+            glm::mat4 view = mCamera.GetViewMatrix();
+            BatchView batchView{};
+            batchView.eye          = mCamera.GetPosition();
+            batchView.forward      = -glm::vec3(view[0][2], view[1][2], view[2][2]);
+            batchView.nearPlane    = mCamera.GetNear();
+            batchView.farPlane     = mCamera.GetFar();
+            batchView.lodScale     = LODScale(extent.height);
+            batchView.lodThreshold = mMeshLODs ? mLODThreshold : 0.0f;
+            mInstanceBatcher.SetView(batchView);
+            mInstanceBatcher.Begin();
+            mInstanceBatcher.BuildForward(mRegistry, mMeshPool.GetDrawCommands(), mGPUMaterials, visibility);
+            if (mCSMEnabled)
+                mInstanceBatcher.BuildShadow(mRegistry, mMeshPool.GetDrawCommands(), mCasterMasks, CC);
+            mInstanceBatcher.Upload(mMemory.GetAllocator(), mFrameIndex);
+        }
+
         ShadowPass::Desc shadowDesc{};
         shadowDesc.csmResource   = csmRes;
         shadowDesc.csm           = &mCSM;
         shadowDesc.skip          = !mCSMEnabled;
         shadowDesc.pipeline      = mShadowPipeline;
         shadowDesc.pipelineLayout = mShadowPipelineLayout;
-        shadowDesc.registry      = &mRegistry;
         shadowDesc.meshPool      = &mMeshPool;
         if (useGPU) {
             shadowDesc.gpuDriven                  = true;
             shadowDesc.indirectPipeline           = mShadowIndirectPipeline;
             shadowDesc.indirectPipelineLayout     = mShadowIndirectPipelineLayout;
-            shadowDesc.indirectDescSet            = mShadowIndirectDescSet;
-            shadowDesc.indirectBuffer             = mIndirectRenderer.GetIndirectBuffer();
-            shadowDesc.countBuffer                = mIndirectRenderer.GetCountBuffer();
-            shadowDesc.maxDrawCount               = mIndirectRenderer.GetDrawCount();
+            shadowDesc.indirectDescSet            = mShadowIndirectDescSets[mFrameIndex];
+            shadowDesc.indirectBuffer             = mComputeCulling.GetShadowIndirectBuffer();
+            shadowDesc.countBuffer                = mComputeCulling.GetShadowCountBuffer();
+            shadowDesc.drawRanges                 = mIndirectRenderer.GetDrawRanges();
+            shadowDesc.cascadeCulled              = shadowCullPassH != RenderGraph::INVALID_PASS;
+            shadowDesc.shadowCullPassHandle       = shadowCullPassH;
+            shadowDesc.cascadeListStride          = mComputeCulling.GetShadowListStride();
+            shadowDesc.cascadeCountStride         = mComputeCulling.GetShadowCountStride();
+        } else {
+            shadowDesc.instances                  = &mInstanceBatcher;
         }
         shadowPassH = mRenderGraph.AddPass(std::make_unique<ShadowPass>(shadowDesc));
     }
@@ -1302,11 +2332,11 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
         fwdDesc.depthView          = mDepthImage.GetView();
         fwdDesc.pipeline           = mPBRPipeline;
         fwdDesc.pipelineLayout     = mPBRPipelineLayout;
+        fwdDesc.maskedPipeline     = mPBRMaskedPipeline;
+        fwdDesc.blendPipeline      = mPBRBlendPipeline;
         fwdDesc.bindlessSet        = mDescriptors.GetSet();
         fwdDesc.frameDescSet       = mFrameDescSets[mFrameIndex];
-        fwdDesc.registry           = &mRegistry;
         fwdDesc.meshPool           = &mMeshPool;
-        fwdDesc.gpuMaterials       = &mGPUMaterials;
         if (mCurrentMSAA != VK_SAMPLE_COUNT_1_BIT && mPostProcess.GetMSAAColorView()) {
             fwdDesc.msaaSamples       = mCurrentMSAA;
             fwdDesc.msaaColorImage    = mPostProcess.GetMSAAColorImage();
@@ -1324,12 +2354,22 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
             fwdDesc.indirectPipelineLayout   = mPBRIndirectPipelineLayout;
             fwdDesc.occluderBuffer           = mComputeCulling.GetOccluderIndirectBuffer();
             fwdDesc.occluderCountBuffer      = mComputeCulling.GetOccluderCountBuffer();
-            fwdDesc.maxOccluderCount         = mIndirectRenderer.GetDrawCount();
             fwdDesc.visibleBuffer            = mComputeCulling.GetVisibleIndirectBuffer();
             fwdDesc.visibleCountBuffer       = mComputeCulling.GetVisibleCountBuffer();
-            fwdDesc.maxVisibleCount          = mIndirectRenderer.GetDrawCount();
+            fwdDesc.drawRanges               = cullRanges;
+            fwdDesc.indirectMaskedPipeline   = anyMasked ? mPBRIndirectMaskedPipeline : VK_NULL_HANDLE;
+            fwdDesc.indirectBlendPipeline    = anyBlended ? mPBRIndirectBlendPipeline : VK_NULL_HANDLE;
+            fwdDesc.maskedRanges             = maskedRanges;
+            fwdDesc.transparentBuffer        = mComputeCulling.GetTransparentIndirectBuffer();
+            fwdDesc.transparentCountBuffer   = mComputeCulling.GetTransparentCountBuffer();
+            fwdDesc.groupBuffer              = useGroups ? mComputeCulling.GetGroupIndirectBuffer() : VK_NULL_HANDLE;
+            fwdDesc.groupRanges              = mIndirectRenderer.GetGroupRanges();
+            fwdDesc.maskedGroupRanges        = mIndirectRenderer.GetMaskedGroupRanges();
+            fwdDesc.groupPhaseBase           = mIndirectRenderer.GetGroupCapacity();
             fwdDesc.occlusionTestPassHandle  = occlusionTestPassH;
             fwdDesc.frustumCullPassHandle    = frustumCullPassH;
+        } else {
+            fwdDesc.instances                = &mInstanceBatcher;
         }
         forwardPassH = mRenderGraph.AddPass(std::make_unique<ForwardPass>(fwdDesc));
     }
@@ -1439,6 +2479,10 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
             rtDesc.shadows           = &mRTShadows;
             rtDesc.reflections       = &mRTReflections;
             rtDesc.accel             = &mAccelStructure;
+        rtDesc.profiler          = &mGPUProfiler;
+        rtDesc.frameIndex        = mFrameIndex;
+            rtDesc.profiler          = &mGPUProfiler;
+            rtDesc.frameIndex        = mFrameIndex;
             rtDesc.depthView         = mDepthImage.GetView();
             rtDesc.depthSampler      = mRTDepthSampler;
             rtDesc.extent            = extent;
@@ -1522,6 +2566,8 @@ void Application::BuildAndExecuteRenderGraph(VkCommandBuffer cmd, uint32_t image
         rtDesc.shadows           = &mRTShadows;
         rtDesc.reflections       = &mRTReflections;
         rtDesc.accel             = &mAccelStructure;
+        rtDesc.profiler          = &mGPUProfiler;
+        rtDesc.frameIndex        = mFrameIndex;
         rtDesc.depthView         = mDepthImage.GetView();
         rtDesc.depthSampler      = mRTDepthSampler;
         rtDesc.extent            = extent;
@@ -1598,67 +2644,93 @@ void Application::InitGPUDriven() {
         return;
     }
 
-    mIndirectRenderer.Initialize(allocator, device);
+    mIndirectRenderer.Initialize(allocator, device, FRAMES_IN_FLIGHT);
     mRegistry.UpdateTransforms();
-    mIndirectRenderer.BuildCommands(allocator, mTransfer, mMeshPool, mRegistry, mOccluderRatio);
+    mIndirectRenderer.Sync(allocator, mTransfer, mMeshPool, mRegistry, mGPUMaterials, mFrameIndex);
 
     mHiZBuffer.Initialize(device, allocator, mShaders);
-    auto extent = mSwapchain.GetExtent();
+    mHiZBuffer.SetSinglePass(mHiZSinglePass);
+    auto extent = GetOutputExtent();
     mHiZBuffer.Resize(device, allocator, extent.width, extent.height);
     mHiZBuffer.SetSourceDepth(mDepthImage.GetView());
 
-    mComputeCulling.Initialize(device, allocator, mShaders);
-    mComputeCulling.UpdateBuffers(allocator,
-        mIndirectRenderer.GetIndirectBuffer(),
-        mIndirectRenderer.GetDrawCount(),
-        mIndirectRenderer.GetObjectBuffer(),
-        mHiZBuffer.GetView(),
-        mHiZBuffer.GetSampler());
-
-    // Object SSBO descriptor for frame sets (binding 6)
-    if (mIndirectRenderer.GetObjectBuffer() != VK_NULL_HANDLE) {
-        for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
-            VkDescriptorBufferInfo objInfo{mIndirectRenderer.GetObjectBuffer(), 0, VK_WHOLE_SIZE};
-            VkWriteDescriptorSet write{};
-            write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-            write.dstSet          = mFrameDescSets[i];
-            write.dstBinding      = 6;
-            write.descriptorCount = 1;
-            write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
-            write.pBufferInfo     = &objInfo;
-            vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
-        }
-    }
+    mComputeCulling.Initialize(device, allocator, mShaders, FRAMES_IN_FLIGHT);
+    mHiZHistoryValid = false;
 
     // Shadow indirect descriptor set
     {
-        VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1};
+        VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, FRAMES_IN_FLIGHT};
         VkDescriptorPoolCreateInfo poolCI{};
         poolCI.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-        poolCI.maxSets       = 1;
+        poolCI.maxSets       = FRAMES_IN_FLIGHT;
         poolCI.poolSizeCount = 1;
         poolCI.pPoolSizes    = &poolSize;
         VK_CHECK(vkCreateDescriptorPool(device, &poolCI, nullptr, &mShadowIndirectDescPool));
 
+        VkDescriptorSetLayout layouts[FRAMES_IN_FLIGHT];
+        for (auto& layout : layouts) layout = mShadowIndirectDescLayout;
         VkDescriptorSetAllocateInfo allocCI{};
         allocCI.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         allocCI.descriptorPool     = mShadowIndirectDescPool;
-        allocCI.descriptorSetCount = 1;
-        allocCI.pSetLayouts        = &mShadowIndirectDescLayout;
-        VK_CHECK(vkAllocateDescriptorSets(device, &allocCI, &mShadowIndirectDescSet));
+        allocCI.descriptorSetCount = FRAMES_IN_FLIGHT;
+        allocCI.pSetLayouts        = layouts;
+        VK_CHECK(vkAllocateDescriptorSets(device, &allocCI, mShadowIndirectDescSets));
+    }
 
-        VkDescriptorBufferInfo objInfo{mIndirectRenderer.GetObjectBuffer(), 0, VK_WHOLE_SIZE};
-        VkWriteDescriptorSet write{};
+    UpdateGPUSceneDescriptors();
+
+    LOG_INFO("GPU-Driven rendering initialized ({} objects, {} slots)",
+             mIndirectRenderer.GetObjectCount(), mIndirectRenderer.GetDrawCount());
+}
+
+// Everything that points at the GPU scene buffers; rerun whenever IndirectRenderer::Sync reallocates.
+// The other frame may still be in flight with its sets, so each frame slot picks up the new
+// object buffer in UpdateFrameSceneDescriptors once its fence has been waited.
+void Application::UpdateGPUSceneDescriptors() {
+    auto allocator = mMemory.GetAllocator();
+
+    mComputeCulling.UpdateBuffers(allocator,
+        mIndirectRenderer.GetIndirectBuffer(),
+        mIndirectRenderer.GetDrawCount(),
+        mIndirectRenderer.GetObjectBuffer(),
+        mIndirectRenderer.GetClusterBuffer(),
+        mIndirectRenderer.GetClusterCapacity(),
+        mMeshPool.GetMeshletBuffer(),
+        mMeshPool.GetLODBuffer(),
+        mIndirectRenderer.GetGroupBuffer(),
+        mIndirectRenderer.GetGroupCapacity(),
+        mIndirectRenderer.GetSlotGroupBuffer(),
+        mIndirectRenderer.GetInstanceCapacity(),
+        mHiZBuffer.GetView(),
+        mHiZBuffer.GetSampler());
+
+    mStaleSceneDescFrames = (1u << FRAMES_IN_FLIGHT) - 1;
+}
+
+// Object SSBO and instance list for the frame's set (bindings 6 and 7) and the object
+// SSBO for its shadow indirect set
+void Application::UpdateFrameSceneDescriptors(uint32_t frameIndex) {
+    if (mIndirectRenderer.GetObjectBuffer() == VK_NULL_HANDLE) return;
+    mStaleSceneDescFrames &= ~(1u << frameIndex);
+
+    VkDescriptorBufferInfo objInfo{mIndirectRenderer.GetObjectBuffer(), 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo instInfo{mComputeCulling.GetInstanceBuffer(), 0, VK_WHOLE_SIZE};
+
+    VkWriteDescriptorSet writes[3]{};
+    for (auto& write : writes) {
         write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        write.dstSet          = mShadowIndirectDescSet;
-        write.dstBinding      = 0;
         write.descriptorCount = 1;
         write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         write.pBufferInfo     = &objInfo;
-        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
     }
-
-    LOG_INFO("GPU-Driven rendering initialized ({} indirect draws)", mIndirectRenderer.GetDrawCount());
+    writes[0].dstSet      = mFrameDescSets[frameIndex];
+    writes[0].dstBinding  = 6;
+    writes[1].dstSet      = mFrameDescSets[frameIndex];
+    writes[1].dstBinding  = 7;
+    writes[1].pBufferInfo = &instInfo;
+    writes[2].dstSet      = mShadowIndirectDescSets[frameIndex];
+    writes[2].dstBinding  = 0;
+    vkUpdateDescriptorSets(mDevice.GetHandle(), writes[2].dstSet ? 3 : 2, writes, 0, nullptr);
 }
 
 // =======================================================================
@@ -1667,16 +2739,18 @@ void Application::InitGPUDriven() {
 void Application::InitDebugUI() {
     auto device = mDevice.GetHandle();
 
-    mDebugUI.Initialize(
-        mVulkanInstance.GetHandle(), device, mDevice.GetPhysicalDevice(),
-        mDevice.GetQueueFamilyIndices().graphicsFamily,
-        mDevice.GetGraphicsQueue(), mWindow.GetHandle(),
-        mSwapchain.GetImageFormat(), FRAMES_IN_FLIGHT);
+    // ImGui draws into the window; a headless run keeps only the profilers
+    if (!mHeadless)
+        mDebugUI.Initialize(
+            mVulkanInstance.GetHandle(), device, mDevice.GetPhysicalDevice(),
+            mDevice.GetQueueFamilyIndices().graphicsFamily,
+            mDevice.GetGraphicsQueue(), mWindow.GetHandle(),
+            mSwapchain.GetImageFormat(), FRAMES_IN_FLIGHT);
 
     auto& uiState = mDebugUI.GetState();
     uiState.gpuDriven        = mGPUDriven;
     uiState.occlusionCulling = mOcclusionCulling;
-    uiState.occluderRatio    = mOccluderRatio;
+    uiState.clusterCulling   = mClusterCulling;
     uiState.sceneType        = mCurrentScene;
     uiState.lightAzimuth     = mLightAzimuth;
     uiState.lightElevation   = mLightElevation;
@@ -1688,18 +2762,37 @@ void Application::InitDebugUI() {
     uiState.rtShadowStrength    = mRTShadowStrength;
     uiState.rtReflStrength      = mRTReflStrength;
     uiState.rtReflRoughness     = mRTReflRoughness;
+    uiState.rtShadowTrace       = static_cast<int>(mRTShadows.GetTraceMode());
+    uiState.rtReflTrace         = static_cast<int>(mRTReflections.GetTraceMode());
+    uiState.rtTracePreset       = static_cast<int>(std::size(kRTTracePresets));
+    for (int i = 0; i < static_cast<int>(std::size(kRTTracePresets)); i++) {
+        if (kRTTracePresets[i].shadows == mRTShadows.GetTraceMode() &&
+            kRTTracePresets[i].reflections == mRTReflections.GetTraceMode())
+            uiState.rtTracePreset = i;
+    }
     uiState.rtLightRadius       = mRTLightRadius;
     uiState.renderMode          = mActiveRenderMode;
     uiState.ptMaxBounces        = mPathTracer.maxBounces;
+    uiState.ptIntegrator        = static_cast<int>(mPathTracer.integrator);
+    uiState.ptSampler           = static_cast<int>(mPathTracer.sampler);
     uiState.ptEnableMIS         = mPathTracer.enableMIS;
     uiState.ptProgressive       = mPathTracer.progressive;
-
-    mGPUProfiler.Initialize(device, mDevice.GetPhysicalDevice(), FRAMES_IN_FLIGHT, 32);
+    uiState.ptAdaptive          = mPathTracer.adaptiveSampling;
+    uiState.ptAdaptiveThreshold = mPathTracer.adaptiveThreshold;
+    uiState.ptAdaptiveMaxSpp    = mPathTracer.adaptiveMaxSpp;
+    uiState.ptReSTIR            = mPathTracer.restirDI;
+    uiState.ptReSTIRCandidates  = mPathTracer.restirCandidates;
+    uiState.ptLightScale        = mPathTracer.punctualLightScale;
+    uiState.ptForceOpaque       = mAccelStructure.IsForceOpaque();
+    uiState.ptHitStats          = mPathTracer.hitClassStats;
+
+    mGPUProfiler.Initialize(device, mDevice.GetPhysicalDevice(), FRAMES_IN_FLIGHT, 48);
     mPipelineStats.Initialize(device, FRAMES_IN_FLIGHT);
 
     mDebugVis.Initialize(device, mShaders, mPipelines,
-                         mSwapchain.GetImageFormat(),
-                         mDescriptors.GetLayout(), mFrameSetLayout);
+                         GetOutputFormat(),
+                         mDescriptors.GetLayout(), mFrameSetLayout,
+                         mMeshPool.GetVertexFormat());
 
     LabelVulkanObjects();
 
@@ -1711,18 +2804,20 @@ void Application::ShutdownDebugUI() {
     mDebugVis.Shutdown(device);
     mPipelineStats.Shutdown(device);
     mGPUProfiler.Shutdown(device);
-    mDebugUI.Shutdown(device);
+    if (!mHeadless)
+        mDebugUI.Shutdown(device);
 }
 
 void Application::SyncUIState() {
     auto& uiState = mDebugUI.GetState();
 
     bool gpuChanged = (mGPUDriven != uiState.gpuDriven) ||
-                      (mOcclusionCulling != uiState.occlusionCulling);
+                      (mOcclusionCulling != uiState.occlusionCulling) ||
+                      (mClusterCulling != uiState.clusterCulling);
 
     mGPUDriven        = uiState.gpuDriven;
     mOcclusionCulling = uiState.occlusionCulling;
-    mOccluderRatio    = uiState.occluderRatio;
+    mClusterCulling   = uiState.clusterCulling;
 
     mPipelineStats.SetEnabled(uiState.pipelineStatsEnabled);
 
@@ -1739,6 +2834,8 @@ void Application::SyncUIState() {
     mRTShadowStrength           = uiState.rtShadowStrength;
     mRTReflStrength             = uiState.rtReflStrength;
     mRTReflRoughness            = uiState.rtReflRoughness;
+    mRTShadows.SetTraceMode(static_cast<RTTraceMode>(uiState.rtShadowTrace));
+    mRTReflections.SetTraceMode(static_cast<RTTraceMode>(uiState.rtReflTrace));
     mRTLightRadius              = uiState.rtLightRadius;
     mRTDebugShadowVis           = uiState.rtDebugShadowVis;
 
@@ -1754,13 +2851,64 @@ void Application::SyncUIState() {
     // Sync path tracer settings
     if (mRTPipelineSupported) {
         mPathTracer.maxBounces  = uiState.ptMaxBounces;
+        auto integrator = static_cast<PTIntegrator>(uiState.ptIntegrator);
+        if (integrator != mPathTracer.integrator) {
+            mPathTracer.integrator = integrator;
+            mPathTracer.ResetAccumulation();
+        }
+        mPathTracer.sampler     = static_cast<PTSampler>(uiState.ptSampler);   // Trace resets on a change
         mPathTracer.enableMIS   = uiState.ptEnableMIS;
         mPathTracer.progressive = uiState.ptProgressive;
+        if (uiState.ptAdaptive != mPathTracer.adaptiveSampling ||
+            uiState.ptAdaptiveThreshold != mPathTracer.adaptiveThreshold) {
+            mPathTracer.adaptiveSampling  = uiState.ptAdaptive;
+            mPathTracer.adaptiveThreshold = uiState.ptAdaptiveThreshold;
+            mPathTracer.ResetAccumulation();
+        }
+        mPathTracer.adaptiveMaxSpp = uiState.ptAdaptiveMaxSpp;
+        if (uiState.ptReSTIRCandidates != mPathTracer.restirCandidates ||
+            uiState.ptLightScale != mPathTracer.punctualLightScale) {
+            mPathTracer.restirCandidates   = uiState.ptReSTIRCandidates;
+            mPathTracer.punctualLightScale = uiState.ptLightScale;
+            mPathTracer.ResetAccumulation();
+        }
+        mPathTracer.restirDI = uiState.ptReSTIR;   // Trace resets on a change
+        uiState.ptReSTIRActive = mPathTracer.IsReSTIRActive();
+        uiState.ptLightCount   = static_cast<int>(mLightBuffer.GetLightCount());
+
+        const PTAdaptiveStats& as = mPathTracer.GetAdaptiveStats();
+        uiState.ptAdaptiveConverged = static_cast<float>(as.ConvergedFraction());
+        uiState.ptAdaptiveSpp       = as.pixels ? static_cast<float>(as.samples / double(as.pixels)) : 0.0f;
+        uiState.ptAdaptiveSavings   = as.samples > 0.0 ? static_cast<float>(as.UniformSamples() / as.samples) : 0.0f;
+
+        if (uiState.ptHitStats != mPathTracer.hitClassStats) {
+            mPathTracer.hitClassStats = uiState.ptHitStats;
+            mPathTracer.ResetHitClassStats();
+        }
+        if (uiState.ptForceOpaque != mAccelStructure.IsForceOpaque()) {
+            // Rates measured without FORCE_OPAQUE are the baseline the forced mode is compared against
+            const PTHitClassStats& hs = mPathTracer.GetHitClassStats();
+            if (!mAccelStructure.IsForceOpaque() && hs.frames > 0) {
+                for (uint32_t c = 0; c < kRTMaterialClassCount; c++)
+                    mAnyHitBaseline[c] = hs.AnyHitPerFrame(c);
+            }
+            mAccelStructure.SetForceOpaque(uiState.ptForceOpaque);
+            RestructureTLAS();
+            mPathTracer.ResetHitClassStats();
+        }
+        const PTHitClassStats& hs = mPathTracer.GetHitClassStats();
+        const RTClassCounts& inst = mAccelStructure.GetClassInstanceCounts();
+        for (uint32_t c = 0; c < kRTMaterialClassCount; c++) {
+            uiState.ptClassInstances[c]      = static_cast<int>(inst[c]);
+            uiState.ptClassAnyHit[c]         = static_cast<float>(hs.AnyHitPerFrame(c));
+            uiState.ptClassClosestHit[c]     = static_cast<float>(hs.ClosestHitPerFrame(c));
+            uiState.ptClassAnyHitBaseline[c] = static_cast<float>(mAnyHitBaseline[c]);
+        }
     }
 
     if (gpuChanged) {
-        LOG_INFO("Render mode changed: GPU-driven={}, occlusion={}",
-                 mGPUDriven, mOcclusionCulling);
+        LOG_INFO("Render mode changed: GPU-driven={}, occlusion={}, meshlets={}",
+                 mGPUDriven, mOcclusionCulling, mClusterCulling);
     }
 
     if (uiState.msaaChanged) {
@@ -1789,14 +2937,22 @@ void Application::LabelVulkanObjects() {
     ObjectLabeling::NameImageView(device, mDepthImage.GetView(), "DepthBuffer_View");
 
     ObjectLabeling::NamePipeline(device, mPBRPipeline, "PBR_Pipeline");
+    ObjectLabeling::NamePipeline(device, mPBRMaskedPipeline, "PBR_Masked_Pipeline");
+    ObjectLabeling::NamePipeline(device, mPBRBlendPipeline, "PBR_Blend_Pipeline");
     ObjectLabeling::NamePipeline(device, mShadowPipeline, "Shadow_Pipeline");
 
     if (mPBRIndirectPipeline)
         ObjectLabeling::NamePipeline(device, mPBRIndirectPipeline, "PBR_Indirect_Pipeline");
+    if (mPBRIndirectMaskedPipeline)
+        ObjectLabeling::NamePipeline(device, mPBRIndirectMaskedPipeline, "PBR_Indirect_Masked_Pipeline");
+    if (mPBRIndirectBlendPipeline)
+        ObjectLabeling::NamePipeline(device, mPBRIndirectBlendPipeline, "PBR_Indirect_Blend_Pipeline");
     if (mShadowIndirectPipeline)
         ObjectLabeling::NamePipeline(device, mShadowIndirectPipeline, "Shadow_Indirect_Pipeline");
     if (mDepthPrepassPipeline)
         ObjectLabeling::NamePipeline(device, mDepthPrepassPipeline, "DepthPrepass_Pipeline");
+    if (mDepthPrepassMaskedPipeline)
+        ObjectLabeling::NamePipeline(device, mDepthPrepassMaskedPipeline, "DepthPrepass_Masked_Pipeline");
 
     for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
         std::string name = "FrameUBO_" + std::to_string(i);
@@ -1817,6 +2973,8 @@ void Application::ShutdownGPUDriven() {
     mIndirectRenderer.Shutdown(allocator);
 
     if (mShadowIndirectDescPool) { vkDestroyDescriptorPool(device, mShadowIndirectDescPool, nullptr); mShadowIndirectDescPool = VK_NULL_HANDLE; }
+    for (auto& set : mShadowIndirectDescSets) set = VK_NULL_HANDLE;
+    mStaleSceneDescFrames = 0;
 }
 
 // =======================================================================
@@ -1832,15 +2990,21 @@ void Application::InitRayTracing() {
     mRayTracingEnabled = true;
     auto device    = mDevice.GetHandle();
     auto allocator = mMemory.GetAllocator();
-    auto extent    = mSwapchain.GetExtent();
+    auto extent    = GetOutputExtent();
 
-    mAccelStructure.Initialize(device, allocator, mTransfer);
+    mAccelStructure.Initialize(device, mDevice.GetPhysicalDevice(), allocator, mTransfer, FRAMES_IN_FLIGHT,
+                               mDevice.GetAsyncQueue(), mDevice.GetQueueFamilyIndices().graphicsFamily);
     mAccelStructure.BuildBLAS(mMeshPool);
     mRegistry.UpdateTransforms();
-    mAccelStructure.BuildTLAS(mRegistry, mMeshPool);
+    // Materials never change after load: classify once for the instance flags and hit groups
+    mAccelStructure.SetMaterialClasses(ClassifyMaterials(mGPUMaterials, mBlackTexDescIdx));
+    mAccelStructure.BuildTLAS(mRegistry, mMeshPool, PathTracer::kRayTypes);
 
+    mRTSampler.Initialize(device, allocator, mTransfer, "sampler_cache.bin");
     mRTShadows.Initialize(device, allocator, mShaders, extent.width, extent.height);
     mRTReflections.Initialize(device, allocator, mShaders, extent.width, extent.height);
+    mRTShadows.SetBlueNoise(mRTSampler.GetBlueNoiseView(), mRTSampler.GetBlueNoiseSampler());
+    mRTReflections.SetBlueNoise(mRTSampler.GetBlueNoiseView(), mRTSampler.GetBlueNoiseSampler());
 
     // Depth sampler for RT passes
     VkSamplerCreateInfo samplerCI{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
@@ -1906,8 +3070,9 @@ void Application::InitRayTracing() {
 
     mRTCompositeDescDirty = true;
 
-    LOG_INFO("Ray tracing initialized: BLAS {:.1f} KB, TLAS {:.1f} KB",
-             mAccelStructure.GetTotalBLASMemory() / 1024.0f,
+    LOG_INFO("Ray tracing initialized: {} BLAS building on the {} queue, TLAS {:.1f} KB",
+             mAccelStructure.GetBLASBuildStats().meshes,
+             mDevice.HasAsyncQueue() ? "async" : "graphics",
              mAccelStructure.GetTLASMemory() / 1024.0f);
 
     InitRTPipeline();
@@ -1934,6 +3099,7 @@ void Application::ShutdownRayTracing() {
     mRTDepthSampler        = VK_NULL_HANDLE;
 
     ShutdownRTPipeline();
+    mRTSampler.Shutdown(device, allocator);
 }
 
 // =======================================================================
@@ -1950,11 +3116,11 @@ void Application::InitRTPipeline() {
     mRTPipelineSupported = true;
     auto device    = mDevice.GetHandle();
     auto allocator = mMemory.GetAllocator();
-    auto extent    = mSwapchain.GetExtent();
+    auto extent    = GetOutputExtent();
 
     mPathTracer.Initialize(device, allocator, mShaders, mTransfer,
                            mDevice.GetRTPipelineProperties(),
-                           extent.width, extent.height);
+                           extent.width, extent.height, FRAMES_IN_FLIGHT);
 
     mNRDDenoiser.Initialize(mVulkanInstance.GetHandle(), device, allocator, mShaders,
                              mDevice.GetPhysicalDevice(),
@@ -1962,18 +3128,12 @@ void Application::InitRTPipeline() {
                              mDevice.GetQueueFamilyIndices().graphicsFamily,
                              extent.width, extent.height);
 
-    // Rebuild TLAS (SBT simplified — single hit group pair, offset = 0)
-    mAccelStructure.BuildTLAS(mRegistry, mMeshPool);
+    // Rebuild TLAS: instances select their material class's hit groups in the SBT
+    mAccelStructure.BuildTLAS(mRegistry, mMeshPool, PathTracer::kRayTypes);
 
     // Update path tracer scene data
-    mPathTracer.UpdateScene(device, allocator, mTransfer,
-        mAccelStructure.GetTLAS(), mMeshPool,
-        mAccelStructure.GetInstanceInfos(),
-        mMaterialSSBO.GetHandle(), mGPUMaterials.size() * sizeof(GPUMaterialData),
-        mDescriptors.GetSet(), mDescriptors.GetLayout(),
-        mIBL.GetEnvCubeView(), mIBL.GetCubeSampler(),
-        mIBL.GetIrradianceView(),
-        mIBL.GetBRDFLutView(), mIBL.GetLutSampler());
+    mPathTracer.SetSampler(&mRTSampler);
+    UpdatePathTracerScene();
 
     // PT composite pipeline (copies PT output to HDR image)
     {
@@ -2148,11 +3308,37 @@ void Application::InitRTPipeline() {
     LOG_INFO("RT Pipeline (Phase 10) initialized: path tracer + NRD denoiser");
 }
 
+void Application::UpdatePathTracerScene() {
+    // The light list follows the TLAS instance order and tags emissive instances
+    std::vector<RTInstanceInfo> instanceInfos = mAccelStructure.GetInstanceInfos();
+    mLightBuffer.Build(mMemory.GetAllocator(), mTransfer, mRegistry, mAccelStructure, instanceInfos);
+    mPathTracer.SetLightBuffer(&mLightBuffer);
+
+    mPathTracer.UpdateScene(mDevice.GetHandle(), mMemory.GetAllocator(), mTransfer,
+        mAccelStructure.GetTLAS(), mMeshPool,
+        instanceInfos,
+        mMaterialSSBO.GetHandle(), mGPUMaterials.size() * sizeof(GPUMaterialData),
+        mDescriptors.GetSet(), mDescriptors.GetLayout(),
+        mIBL.GetEnvCubeView(), mIBL.GetCubeSampler(),
+        mIBL.GetIrradianceView(),
+        mIBL.GetBRDFLutView(), mIBL.GetLutSampler());
+}
+
+// Renderables were added, removed or remapped: the instance list and its RTInstanceInfo
+// change size, so the TLAS is recreated outside the frame and the path tracer rebound
+void Application::RestructureTLAS() {
+    mDevice.WaitIdle();
+    mAccelStructure.BuildTLAS(mRegistry, mMeshPool, PathTracer::kRayTypes);
+    if (mRTPipelineSupported)
+        UpdatePathTracerScene();
+}
+
 void Application::ShutdownRTPipeline() {
     auto device    = mDevice.GetHandle();
     auto allocator = mMemory.GetAllocator();
 
     mPathTracer.Shutdown(device, allocator);
+    mLightBuffer.Destroy(allocator);
     mNRDDenoiser.Shutdown(device, allocator);
 
     if (mPTCompositePipeline)   { vkDestroyPipeline(device, mPTCompositePipeline, nullptr);       mPTCompositePipeline   = VK_NULL_HANDLE; }
@@ -2265,6 +3451,7 @@ void Application::ClearScene() {
     mMaterialSSBO.Destroy(allocator);
 
     mRegistry.Clear();
+    mSceneBVH.Clear();
     mSunEntity = INVALID_ENTITY;
     mModelData = ModelData{};
     mRayTracingEnabled = false;
@@ -2393,6 +3580,17 @@ void Application::LoadTestScene() {
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
         mGPUMaterials.data(), mGPUMaterials.size() * sizeof(GPUMaterialData));
 
+    if (mMeshOptimization)
+        mMeshOptReport = MeshOptimizer::OptimizeMeshes(mModelData.meshes, &mThreadPool);
+    if (mMeshLODs)
+        mLODReport = MeshSimplifier::GenerateLODs(mModelData.meshes, &mThreadPool);
+
+    mSoftwareOcclusion.SetMeshes(mModelData.meshes);
+    if (!mCPUReferencePath.empty())
+        mCPUPathTracer.SetMeshes(mModelData.meshes);
+    if (mDevice.IsRayTracingSupported())
+        mLightBuffer.SetMeshes(mModelData.meshes, mModelData.materials, mModelData.textures);
+
     if (mDevice.IsRayTracingSupported()) {
         mMeshPool.Upload(allocator, mTransfer, mModelData.meshes,
             VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
@@ -2417,11 +3615,13 @@ void Application::ReloadScene(SceneType newType) {
 
     ClearScene();
 
+    mTransfer.ResetStats();
     if (newType == SceneType::TestScene) {
         LoadTestScene();
     } else {
         LoadScene();
     }
+    FinishSceneUpload();
 
     // Update material SSBO binding in frame descriptor sets
     for (uint32_t i = 0; i < FRAMES_IN_FLIGHT; i++) {
@@ -2450,6 +3650,17 @@ void Application::ReloadScene(SceneType newType) {
     LOG_INFO("Scene switched to: {}", newType == SceneType::TestScene ? "Test Scene" : "Sponza");
 }
 
+void Application::FinishSceneUpload() {
+    mTransfer.WaitIdle();
+    mSceneUploadStats = mTransfer.GetStats();
+    LOG_INFO("Scene upload: {} uploads, {:.2f} MB in {} submits ({} ring stalls), "
+             "{:.0f} uploads/s, {:.1f} MB/s",
+             mSceneUploadStats.uploadCount, mSceneUploadStats.bytes / (1024.0 * 1024.0),
+             mSceneUploadStats.submits, mSceneUploadStats.ringStalls,
+             mSceneUploadStats.UploadsPerSecond(),
+             mSceneUploadStats.BytesPerSecond() / (1024.0 * 1024.0));
+}
+
 // =======================================================================
 // Compute culling
 // =======================================================================
@@ -2467,6 +3678,11 @@ void Application::ExtractFrustumPlanes(const glm::mat4& vp, glm::vec4 planes[6])
     }
 }
 
+// Screen pixels covered by one world unit at distance 1, for projected LOD error
+float Application::LODScale(uint32_t viewportHeight) const {
+    return static_cast<float>(viewportHeight) / (2.0f * std::tan(mCamera.GetFovRad() * 0.5f));
+}
+
 
 // =======================================================================
 // Swapchain recreation
@@ -2490,13 +3706,9 @@ void Application::RecreateSwapchain() {
         auto extent = mSwapchain.GetExtent();
         mHiZBuffer.Resize(mDevice.GetHandle(), mMemory.GetAllocator(), extent.width, extent.height);
         mHiZBuffer.SetSourceDepth(mDepthImage.GetView());
+        mHiZHistoryValid = false;
 
-        mComputeCulling.UpdateBuffers(mMemory.GetAllocator(),
-            mIndirectRenderer.GetIndirectBuffer(),
-            mIndirectRenderer.GetDrawCount(),
-            mIndirectRenderer.GetObjectBuffer(),
-            mHiZBuffer.GetView(),
-            mHiZBuffer.GetSampler());
+        UpdateGPUSceneDescriptors();
     }
 
     {
@@ -2540,8 +3752,8 @@ void Application::CleanupVulkan() {
             if (pool) vkDestroyCommandPool(device, pool, nullptr);
         mWorkerCommandPools.clear();
         mSecondaryCommandBuffers.clear();
-        mThreadPool.Shutdown();
     }
+    mThreadPool.Shutdown();
 
     mPostProcess.Shutdown(device, allocator);
 
@@ -2576,6 +3788,8 @@ void Application::CleanupVulkan() {
     mFrameDescPool  = VK_NULL_HANDLE;
     mFrameSetLayout = VK_NULL_HANDLE;
 
+    mInstanceBatcher.Shutdown(allocator);
+
     mRenderGraph.Shutdown();
     mImageCache.Shutdown();
     mIBL.Shutdown(allocator, device);
@@ -2583,15 +3797,20 @@ void Application::CleanupVulkan() {
     mDepthImage.Destroy(allocator, device);
 
     if (mPBRPipeline)              vkDestroyPipeline(device, mPBRPipeline, nullptr);
+    if (mPBRMaskedPipeline)        vkDestroyPipeline(device, mPBRMaskedPipeline, nullptr);
+    if (mPBRBlendPipeline)         vkDestroyPipeline(device, mPBRBlendPipeline, nullptr);
     if (mPBRPipelineLayout)        vkDestroyPipelineLayout(device, mPBRPipelineLayout, nullptr);
     if (mShadowPipeline)           vkDestroyPipeline(device, mShadowPipeline, nullptr);
     if (mShadowPipelineLayout)     vkDestroyPipelineLayout(device, mShadowPipelineLayout, nullptr);
     if (mPBRIndirectPipeline)      vkDestroyPipeline(device, mPBRIndirectPipeline, nullptr);
+    if (mPBRIndirectMaskedPipeline) vkDestroyPipeline(device, mPBRIndirectMaskedPipeline, nullptr);
+    if (mPBRIndirectBlendPipeline)  vkDestroyPipeline(device, mPBRIndirectBlendPipeline, nullptr);
     if (mPBRIndirectPipelineLayout) vkDestroyPipelineLayout(device, mPBRIndirectPipelineLayout, nullptr);
     if (mShadowIndirectPipeline)       vkDestroyPipeline(device, mShadowIndirectPipeline, nullptr);
     if (mShadowIndirectPipelineLayout) vkDestroyPipelineLayout(device, mShadowIndirectPipelineLayout, nullptr);
     if (mShadowIndirectDescLayout)     vkDestroyDescriptorSetLayout(device, mShadowIndirectDescLayout, nullptr);
     if (mDepthPrepassPipeline)         vkDestroyPipeline(device, mDepthPrepassPipeline, nullptr);
+    if (mDepthPrepassMaskedPipeline)   vkDestroyPipeline(device, mDepthPrepassMaskedPipeline, nullptr);
     if (mDepthPrepassPipelineLayout)   vkDestroyPipelineLayout(device, mDepthPrepassPipelineLayout, nullptr);
 
     mShaders.Shutdown();
@@ -2611,34 +3830,72 @@ void Application::CleanupVulkan() {
     }
 
     mVulkanInstance.Shutdown();
-    mWindow.Shutdown();
+    if (!mHeadless)
+        mWindow.Shutdown();
 
     LOG_INFO("Cleanup complete");
 }
 
-void Application::RecreatePBRPipelines(VkSampleCountFlagBits samples) {
+// Masked and blended variants of an opaque PBR or depth prepass pipeline. Both
+// specialize ALPHA_MODE (constant 1) of the fragment stage, pStages[1]; the blended
+// one also stops writing depth and blends over what the opaque passes drew.
+void Application::CreateAlphaVariants(const VkGraphicsPipelineCreateInfo& opaque,
+                                      VkPipeline* masked, VkPipeline* blend) {
     auto device = mDevice.GetHandle();
 
-    if (mPBRPipeline)         { vkDestroyPipeline(device, mPBRPipeline, nullptr);         mPBRPipeline = VK_NULL_HANDLE; }
-    if (mPBRIndirectPipeline) { vkDestroyPipeline(device, mPBRIndirectPipeline, nullptr); mPBRIndirectPipeline = VK_NULL_HANDLE; }
+    VkPipelineShaderStageCreateInfo stages[2] = { opaque.pStages[0], opaque.pStages[1] };
+    VkGraphicsPipelineCreateInfo ci = opaque;
+    ci.pStages = stages;
+
+    uint32_t alphaMode = 0;
+    VkSpecializationMapEntry entry{1, 0, sizeof(uint32_t)};
+    VkSpecializationInfo spec{};
+    spec.mapEntryCount = 1;
+    spec.pMapEntries   = &entry;
+    spec.dataSize      = sizeof(uint32_t);
+    spec.pData         = &alphaMode;
+    stages[1].pSpecializationInfo = &spec;
+
+    if (masked) {
+        alphaMode = static_cast<uint32_t>(AlphaMode::Mask);
+        VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ci, nullptr, masked));
+    }
+
+    if (blend) {
+        VkPipelineDepthStencilStateCreateInfo depthStencil = *opaque.pDepthStencilState;
+        depthStencil.depthWriteEnable = VK_FALSE;
+
+        VkPipelineColorBlendAttachmentState blendAtt = opaque.pColorBlendState->pAttachments[0];
+        blendAtt.blendEnable         = VK_TRUE;
+        blendAtt.srcColorBlendFactor = VK_BLEND_FACTOR_SRC_ALPHA;
+        blendAtt.dstColorBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        blendAtt.colorBlendOp        = VK_BLEND_OP_ADD;
+        blendAtt.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        blendAtt.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+        blendAtt.alphaBlendOp        = VK_BLEND_OP_ADD;
+
+        VkPipelineColorBlendStateCreateInfo colorBlend = *opaque.pColorBlendState;
+        colorBlend.pAttachments = &blendAtt;
+
+        ci.pDepthStencilState = &depthStencil;
+        ci.pColorBlendState   = &colorBlend;
+        alphaMode = static_cast<uint32_t>(AlphaMode::Blend);
+        VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ci, nullptr, blend));
+    }
+}
 
-    VkVertexInputBindingDescription bindingDesc{};
-    bindingDesc.binding   = 0;
-    bindingDesc.stride    = sizeof(MeshVertex);
-    bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+void Application::RecreatePBRPipelines(VkSampleCountFlagBits samples) {
+    auto device = mDevice.GetHandle();
 
-    VkVertexInputAttributeDescription attrDescs[4]{};
-    attrDescs[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, position)};
-    attrDescs[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, normal)};
-    attrDescs[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT,       offsetof(MeshVertex, texCoord)};
-    attrDescs[3] = {3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(MeshVertex, tangent)};
+    for (VkPipeline* p : { &mPBRPipeline, &mPBRMaskedPipeline, &mPBRBlendPipeline,
+                           &mPBRIndirectPipeline, &mPBRIndirectMaskedPipeline, &mPBRIndirectBlendPipeline }) {
+        if (*p) { vkDestroyPipeline(device, *p, nullptr); *p = VK_NULL_HANDLE; }
+    }
 
-    VkPipelineVertexInputStateCreateInfo vertexInput{};
-    vertexInput.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInput.vertexBindingDescriptionCount   = 1;
-    vertexInput.pVertexBindingDescriptions      = &bindingDesc;
-    vertexInput.vertexAttributeDescriptionCount = 4;
-    vertexInput.pVertexAttributeDescriptions    = attrDescs;
+    // Vertex layout and the PACKED_VERTICES specialization follow the mesh pool format
+    VertexInputLayout          vertexLayout(mMeshPool.GetVertexFormat());
+    VertexFormatSpecialization vertexSpec(mMeshPool.GetVertexFormat());
+    const VkPipelineVertexInputStateCreateInfo& vertexInput = vertexLayout.state;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -2691,7 +3948,7 @@ void Application::RecreatePBRPipelines(VkSampleCountFlagBits samples) {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -2718,6 +3975,7 @@ void Application::RecreatePBRPipelines(VkSampleCountFlagBits samples) {
         ci.layout              = mPBRPipelineLayout;
 
         VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ci, nullptr, &mPBRPipeline));
+        CreateAlphaVariants(ci, &mPBRMaskedPipeline, &mPBRBlendPipeline);
     }
 
     {
@@ -2726,7 +3984,7 @@ void Application::RecreatePBRPipelines(VkSampleCountFlagBits samples) {
 
         VkPipelineShaderStageCreateInfo stages[2]{};
         stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", nullptr};
+                     VK_SHADER_STAGE_VERTEX_BIT, vert, "main", &vertexSpec.info};
         stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                      VK_SHADER_STAGE_FRAGMENT_BIT, frag, "main", nullptr};
 
@@ -2759,6 +4017,7 @@ void Application::RecreatePBRPipelines(VkSampleCountFlagBits samples) {
         ci.layout              = mPBRIndirectPipelineLayout;
 
         VK_CHECK(vkCreateGraphicsPipelines(device, mPipelines.GetCache(), 1, &ci, nullptr, &mPBRIndirectPipeline));
+        CreateAlphaVariants(ci, &mPBRIndirectMaskedPipeline, &mPBRIndirectBlendPipeline);
     }
 
     mCurrentMSAA = samples;
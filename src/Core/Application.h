@@ -17,6 +17,8 @@
 #include "Resource/ShaderManager.h"
 #include "Resource/PipelineManager.h"
 #include "Asset/ModelLoader.h"
+#include "Asset/MeshOptimizer.h"
+#include "Asset/MeshSimplifier.h"
 #include "Scene/Camera.h"
 #include "Scene/Scene.h"
 #include "Scene/ECS.h"
@@ -28,6 +30,9 @@
 #include "GPU/IndirectRenderer.h"
 #include "GPU/HiZBuffer.h"
 #include "GPU/ComputeCulling.h"
+#include "GPU/InstanceBatcher.h"
+#include "Culling/SoftwareOcclusion.h"
+#include "Culling/SceneBVH.h"
 #include "PostProcess/PostProcessStack.h"
 #include "VisualUI/DebugUI.h"
 #include "VisualUI/GPUProfiler.h"
@@ -36,30 +41,79 @@
 #include "RayTracing/AccelStructure.h"
 #include "RayTracing/RTShadows.h"
 #include "RayTracing/RTReflections.h"
+#include "RayTracing/RTSampler.h"
 #include "RayTracing/PathTracer.h"
+#include "RayTracing/LightBuffer.h"
 #include "RayTracing/NRDDenoiser.h"
+#include "RayTracing/CPUPathTracer.h"
 
+#include <array>
 #include <optional>
 #include <string>
 #include <vector>
 
+/// Headless batch rendering of a camera path with the path tracer (--render).
+struct OfflineRenderSettings {
+    std::string cameraPath;
+    std::string outputPattern = "frame_####.exr";  // '#' run = zero-padded frame number
+    std::string reportPath    = "render_report.json";
+    std::string referencePath;         // optional PFM: per-frame RMSE in the report
+    uint32_t    width         = 0;     // 0: WINDOW_WIDTH x WINDOW_HEIGHT
+    uint32_t    height        = 0;
+    uint32_t    targetSpp     = 256;   // passes per frame; adaptive sampling may stop earlier
+};
+
 class Application {
 public:
     ~Application();
     void Run();
-    void RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusionCulling);
+    /// Returns false when one of the CPU self-checks printed with the results failed.
+    bool RunBenchmark(uint32_t frameCount, bool gpuDriven, bool occlusionCulling);
+    bool RunOfflineRender(const OfflineRenderSettings& settings);
+    /// Writes the SetCPUReference image without a window or Vulkan device. 0 keeps the
+    /// CPU tracer's default size. Returns false when no scene loaded or the write failed.
+    bool RunCPUReference(uint32_t width, uint32_t height);
     void SetScenePath(const std::string& path) { mScenePathOverride = path; }
     void SetInitialRenderMode(DebugUIState::RenderMode mode) { mInitialRenderMode = mode; }
     void SetInitialDenoiser(bool on) { mInitialDenoiser = on; }
+    void SetMeshOptimization(bool on) { mMeshOptimization = on; }
+    void SetMeshLODs(bool on) { mMeshLODs = on; }
+    void SetLODThreshold(float pixels) { mLODThreshold = pixels; }
+    void SetClusterCulling(bool on) { mClusterCulling = on; }
+    void SetHiZSinglePass(bool on) { mHiZSinglePass = on; }
+    void SetInstancing(bool on) { mInstanceBatcher.SetEnabled(on); mGPUInstancing = on; }
+    void SetBLASScratchBudget(VkDeviceSize bytes) { mAccelStructure.SetScratchBudget(bytes); }
+    void SetPathTracerIntegrator(PTIntegrator integrator) { mPathTracer.integrator = integrator; }
+    void SetPathTracerSampler(PTSampler sampler) { mPathTracer.sampler = sampler; }
+    void SetReSTIR(bool enabled) { mPathTracer.restirDI = enabled; }
+    void SetRTTracePreset(int preset) {
+        mRTShadows.SetTraceMode(kRTTracePresets[preset].shadows);
+        mRTReflections.SetTraceMode(kRTTracePresets[preset].reflections);
+    }
+    void SetForceOpaqueInstances(bool on) { mAccelStructure.SetForceOpaque(on); }
+    void SetHitClassStats(bool on) { mPathTracer.hitClassStats = on; }
+    void SetAdaptiveSampling(float threshold) {
+        mPathTracer.adaptiveSampling  = true;
+        mPathTracer.adaptiveThreshold = threshold;
+    }
+    void SetCPUReference(const std::string& path, uint32_t spp) { mCPUReferencePath = path; mCPUReferenceSpp = spp; }
+    void SetPackedVertices(bool on) {
+        mMeshPool.SetVertexFormat(on ? VertexFormat::Packed : VertexFormat::Float);
+    }
 
 private:
     void InitWindow();
+    void ApplyInitialRenderMode();
     void InitVulkan();
     void CreateDefaultTextures();
     void LoadScene();
+    void AddSceneSun();
+    bool LoadSceneModel();
+    void AddModelEntities();
     void CreateDepthBuffer();
     void CreateFrameDescriptors();
     void CreatePipelines();
+    void CreateAlphaVariants(const VkGraphicsPipelineCreateInfo& opaque, VkPipeline* masked, VkPipeline* blend);
     void MainLoop();
     void DrawFrame();
     void DrawFrameMultiThreaded();
@@ -69,11 +123,24 @@ private:
 
     void InitGPUDriven();
     void ShutdownGPUDriven();
+    void UpdateGPUSceneDescriptors();
+    void UpdateFrameSceneDescriptors(uint32_t frameIndex);
+    void BenchmarkSoftwareOcclusion();
+    void BenchmarkSceneBVH();
+    void BenchmarkDrawSort();
+    void RenderCPUReference();
+    bool TraceCPUReference(uint32_t width, uint32_t height);
     void ExtractFrustumPlanes(const glm::mat4& vp, glm::vec4 planes[6]);
+    float LODScale(uint32_t viewportHeight) const;
 
     void ClearScene();
     void LoadTestScene();
     void ReloadScene(SceneType newType);
+    void FinishSceneUpload();
+
+    /// Swapchain extent and format, or the offline render size when headless.
+    VkExtent2D GetOutputExtent() const;
+    VkFormat   GetOutputFormat() const;
 
     void InitDebugUI();
     void ShutdownDebugUI();
@@ -89,6 +156,8 @@ private:
     InputManager        mInput;
     VulkanInstance      mVulkanInstance;
     VkSurfaceKHR        mSurface = VK_NULL_HANDLE;
+    bool                mHeadless = false;    // --render: no window, surface or swapchain
+    VkExtent2D          mHeadlessExtent{};
     VulkanDevice        mDevice;
     VulkanMemory        mMemory;
     VulkanSwapchain     mSwapchain;
@@ -97,6 +166,7 @@ private:
 
     // --- resource managers ---
     TransferManager   mTransfer;
+    TransferStats     mSceneUploadStats;
     DescriptorManager mDescriptors;
     ShaderManager     mShaders;
     PipelineManager   mPipelines;
@@ -120,6 +190,12 @@ private:
 
     // --- GPU scene data ---
     ModelData                    mModelData;
+    bool                         mMeshOptimization = true;
+    MeshOptimizeReport           mMeshOptReport;
+    bool                         mMeshLODs         = true;
+    float                        mLODThreshold     = 1.0f;   // projected error in pixels
+    MeshLODReport                mLODReport;
+    uint32_t                     mSelfCheckFailures = 0;   // benchmark self-checks that failed
     std::vector<VulkanImage>     mGPUTextures;
     std::vector<uint32_t>        mTextureDescriptorIndices;
     std::vector<GPUMaterialData> mGPUMaterials;
@@ -146,28 +222,49 @@ private:
     // --- pipelines ---
     VkPipelineLayout mPBRPipelineLayout        = VK_NULL_HANDLE;
     VkPipeline       mPBRPipeline              = VK_NULL_HANDLE;
+    VkPipeline       mPBRMaskedPipeline        = VK_NULL_HANDLE;   // AlphaMode variants of mPBRPipeline
+    VkPipeline       mPBRBlendPipeline         = VK_NULL_HANDLE;
     VkPipelineLayout mShadowPipelineLayout     = VK_NULL_HANDLE;
     VkPipeline       mShadowPipeline           = VK_NULL_HANDLE;
 
     // --- GPU-driven rendering (Phase 6) ---
     bool             mGPUDriven = true;
     bool             mOcclusionCulling = true;
-    float            mOccluderRatio = 0.2f;
+    bool             mClusterCulling   = false;   // cull and draw per meshlet instead of per object
+    bool             mGPUInstancing    = true;    // object culling draws (mesh, material) groups instanced
+    bool             mHiZSinglePass    = true;    // one SPD-style dispatch instead of one per mip
+    bool             mHiZHistoryValid = false;   // the Hi-Z holds last frame's pyramid, seen from mPrevCullViewProj
+    glm::mat4        mPrevCullViewProj{1.0f};
     MeshPool         mMeshPool;
     IndirectRenderer mIndirectRenderer;
     HiZBuffer        mHiZBuffer;
     ComputeCulling   mComputeCulling;
 
+    // CPU draw path: occluders rasterized on the thread pool, per-entity visibility
+    SoftwareOcclusion mSoftwareOcclusion;
+
+    // CPU draw path: frustum and shadow caster culling, per-entity masks rebuilt each frame
+    SceneBVH             mSceneBVH;
+    std::vector<uint8_t> mCameraVisibility;
+    std::vector<uint8_t> mCasterMasks;   // bit c: caster for cascade c
+
+    // CPU draw path: culling survivors grouped by (mesh, material) into instanced draws
+    InstanceBatcher      mInstanceBatcher;
+
     VkPipelineLayout mPBRIndirectPipelineLayout    = VK_NULL_HANDLE;
     VkPipeline       mPBRIndirectPipeline          = VK_NULL_HANDLE;
+    VkPipeline       mPBRIndirectMaskedPipeline    = VK_NULL_HANDLE;
+    VkPipeline       mPBRIndirectBlendPipeline     = VK_NULL_HANDLE;
     VkPipelineLayout mShadowIndirectPipelineLayout = VK_NULL_HANDLE;
     VkPipeline       mShadowIndirectPipeline       = VK_NULL_HANDLE;
     VkPipelineLayout mDepthPrepassPipelineLayout   = VK_NULL_HANDLE;
     VkPipeline       mDepthPrepassPipeline         = VK_NULL_HANDLE;
+    VkPipeline       mDepthPrepassMaskedPipeline   = VK_NULL_HANDLE;   // alpha-tested occluders
 
     VkDescriptorSetLayout mShadowIndirectDescLayout = VK_NULL_HANDLE;
     VkDescriptorPool      mShadowIndirectDescPool   = VK_NULL_HANDLE;
-    VkDescriptorSet       mShadowIndirectDescSet    = VK_NULL_HANDLE;
+    VkDescriptorSet       mShadowIndirectDescSets[FRAMES_IN_FLIGHT] = {};
+    uint32_t              mStaleSceneDescFrames     = 0;   // bit per frame slot still pointing at old scene buffers
 
     // --- Post-processing (Phase 8) ---
     PostProcessStack mPostProcess;
@@ -184,6 +281,7 @@ private:
     AccelStructure   mAccelStructure;
     RTShadows        mRTShadows;
     RTReflections    mRTReflections;
+    RTSampler        mRTSampler;
 
 
     VkPipeline       mRTCompositePipeline    = VK_NULL_HANDLE;
@@ -200,7 +298,9 @@ private:
     // --- Ray Tracing Pipeline (Phase 10) ---
     bool            mRTPipelineSupported = false;
     PathTracer      mPathTracer;
+    LightBuffer     mLightBuffer;      // point/spot/emissive-triangle lights the path tracer samples
     NRDDenoiser     mNRDDenoiser;
+    std::array<double, kRTMaterialClassCount> mAnyHitBaseline{-1.0, -1.0, -1.0};   // per frame, without FORCE_OPAQUE
 
     VkPipeline       mPTCompositePipeline   = VK_NULL_HANDLE;
     VkPipelineLayout mPTCompositePipeLayout = VK_NULL_HANDLE;
@@ -234,6 +334,8 @@ private:
 
     void InitRTPipeline();
     void ShutdownRTPipeline();
+    void UpdatePathTracerScene();
+    void RestructureTLAS();
     void UpdatePTCompositeDescriptors();
     void RebuildRenderGraphForMode(DebugUIState::RenderMode mode);
 
@@ -266,6 +368,11 @@ private:
     // --- timing ---
     double mLastFrameTime = 0.0;
 
+    // --- CPU reference path tracer: golden images without the GPU ---
+    CPUPathTracer mCPUPathTracer;
+    std::string   mCPUReferencePath;   // empty: off
+    uint32_t      mCPUReferenceSpp = 16;
+
     // --- scene override ---
     std::string mScenePathOverride;
     SceneType   mCurrentScene = SceneType::TestScene;
@@ -0,0 +1,258 @@
+#include "Core/FrameWriter.h"
+#include "Core/ThreadPool.h"
+#include "Core/Logger.h"
+
+#include <stb_image_write.h>
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+std::string Extension(const std::string& path) {
+    size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos) return {};
+    std::string ext = path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return ext;
+}
+
+bool WritePFM(const std::string& path, const float* rgba, uint32_t w, uint32_t h) {
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    // Little-endian (negative scale), rows bottom to top
+    std::fprintf(f, "PF\n%u %u\n-1.0\n", w, h);
+    std::vector<float> row(size_t(w) * 3);
+    for (uint32_t y = h; y-- > 0;) {
+        const float* src = rgba + size_t(y) * w * 4;
+        for (uint32_t x = 0; x < w; x++)
+            std::memcpy(&row[size_t(x) * 3], &src[size_t(x) * 4], 3 * sizeof(float));
+        std::fwrite(row.data(), sizeof(float), row.size(), f);
+    }
+    bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+// Single-part scanline OpenEXR, no compression, FLOAT channels B, G, R (alphabetical)
+bool WriteEXR(const std::string& path, const float* rgba, uint32_t w, uint32_t h) {
+    std::vector<uint8_t> header;
+    auto put = [&header](const void* p, size_t n) {
+        const uint8_t* b = static_cast<const uint8_t*>(p);
+        header.insert(header.end(), b, b + n);
+    };
+    auto putI32 = [&put](int32_t v) { put(&v, 4); };
+    auto putF32 = [&put](float v)   { put(&v, 4); };
+    auto putStr = [&put](const char* s) { put(s, std::strlen(s) + 1); };
+    auto attr   = [&](const char* name, const char* type, int32_t size) {
+        putStr(name); putStr(type); putI32(size);
+    };
+
+    const uint32_t magic = 20000630;
+    const uint32_t version = 2;
+    put(&magic, 4);
+    put(&version, 4);
+
+    attr("channels", "chlist", 3 * (2 + 16) + 1);
+    for (const char* ch : {"B", "G", "R"}) {
+        putStr(ch);
+        putI32(2);                       // FLOAT
+        const uint8_t linearAndReserved[4] = {0, 0, 0, 0};
+        put(linearAndReserved, 4);
+        putI32(1); putI32(1);            // x/y sampling
+    }
+    header.push_back(0);
+
+    attr("compression", "compression", 1);
+    header.push_back(0);                 // NO_COMPRESSION
+    attr("dataWindow", "box2i", 16);
+    putI32(0); putI32(0); putI32(int32_t(w) - 1); putI32(int32_t(h) - 1);
+    attr("displayWindow", "box2i", 16);
+    putI32(0); putI32(0); putI32(int32_t(w) - 1); putI32(int32_t(h) - 1);
+    attr("lineOrder", "lineOrder", 1);
+    header.push_back(0);                 // INCREASING_Y
+    attr("pixelAspectRatio", "float", 4);
+    putF32(1.0f);
+    attr("screenWindowCenter", "v2f", 8);
+    putF32(0.0f); putF32(0.0f);
+    attr("screenWindowWidth", "float", 4);
+    putF32(1.0f);
+    header.push_back(0);                 // end of header
+
+    // Offset table: one uncompressed scanline per chunk
+    const uint32_t lineBytes = w * 3 * sizeof(float);
+    const uint64_t firstChunk = header.size() + uint64_t(h) * sizeof(uint64_t);
+    for (uint32_t y = 0; y < h; y++) {
+        uint64_t offset = firstChunk + uint64_t(y) * (8 + lineBytes);
+        put(&offset, 8);
+    }
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) return false;
+    std::fwrite(header.data(), 1, header.size(), f);
+
+    std::vector<float> line(size_t(w) * 3);
+    for (uint32_t y = 0; y < h; y++) {
+        const float* src = rgba + size_t(y) * w * 4;
+        for (uint32_t x = 0; x < w; x++) {
+            line[x]                 = src[size_t(x) * 4 + 2];   // B
+            line[w + x]             = src[size_t(x) * 4 + 1];   // G
+            line[2 * size_t(w) + x] = src[size_t(x) * 4 + 0];   // R
+        }
+        int32_t chunk[2] = {int32_t(y), int32_t(lineBytes)};
+        std::fwrite(chunk, sizeof(chunk), 1, f);
+        std::fwrite(line.data(), sizeof(float), line.size(), f);
+    }
+    bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    return ok;
+}
+
+bool WritePNG(const std::string& path, const float* rgba, uint32_t w, uint32_t h) {
+    auto encode = [](float c) {
+        c = std::clamp(std::isfinite(c) ? c : 0.0f, 0.0f, 1.0f);
+        c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+        return static_cast<uint8_t>(c * 255.0f + 0.5f);
+    };
+    std::vector<uint8_t> pixels(size_t(w) * h * 3);
+    for (size_t i = 0; i < size_t(w) * h; i++)
+        for (int c = 0; c < 3; c++)
+            pixels[i * 3 + c] = encode(rgba[i * 4 + c]);
+    return stbi_write_png(path.c_str(), int(w), int(h), 3, pixels.data(), int(w * 3)) != 0;
+}
+
+} // namespace
+
+bool WriteImageFile(const std::string& path, const float* rgba, uint32_t width, uint32_t height) {
+    std::string ext = Extension(path);
+    if (ext == "exr") return WriteEXR(path, rgba, width, height);
+    if (ext == "pfm") return WritePFM(path, rgba, width, height);
+    if (ext == "png") return WritePNG(path, rgba, width, height);
+    LOG_ERROR("Unsupported output format '{}' (use .exr, .pfm or .png)", path);
+    return false;
+}
+
+bool ReadPFM(const std::string& path, std::vector<float>& rgba, uint32_t& width, uint32_t& height) {
+    FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) return false;
+    char  type[3] = {};
+    float scale   = 0.0f;
+    bool ok = std::fscanf(f, "%2s %u %u %f", type, &width, &height, &scale) == 4 &&
+              (std::strcmp(type, "PF") == 0 || std::strcmp(type, "Pf") == 0) &&
+              scale < 0.0f && width > 0 && height > 0;   // little-endian only
+    ok = ok && std::fgetc(f) != EOF;                      // single whitespace before the raster
+    if (ok) {
+        const uint32_t channels = type[1] == 'F' ? 3 : 1;
+        std::vector<float> row(size_t(width) * channels);
+        rgba.assign(size_t(width) * height * 4, 1.0f);
+        for (uint32_t y = height; ok && y-- > 0;) {
+            ok = std::fread(row.data(), sizeof(float), row.size(), f) == row.size();
+            float* dst = &rgba[size_t(y) * width * 4];
+            for (uint32_t x = 0; ok && x < width; x++)
+                for (uint32_t c = 0; c < 3; c++)
+                    dst[size_t(x) * 4 + c] = row[size_t(x) * channels + (channels == 3 ? c : 0)];
+        }
+    }
+    std::fclose(f);
+    return ok;
+}
+
+void FrameWriter::Initialize(VmaAllocator allocator, ThreadPool* pool,
+                             uint32_t width, uint32_t height, uint32_t slots) {
+    mAllocator = allocator;
+    mPool      = pool;
+    mWidth     = width;
+    mHeight    = height;
+    mSlots.resize(slots);
+    for (auto& s : mSlots)
+        s.readback.CreateReadback(allocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                  VkDeviceSize(width) * height * 4 * sizeof(float));
+    mResults.clear();
+}
+
+void FrameWriter::Shutdown(VmaAllocator allocator) {
+    Flush();
+    for (auto& s : mSlots) s.readback.Destroy(allocator);
+    mSlots.clear();
+}
+
+void FrameWriter::Collect(Slot& slot) {
+    if (!slot.encode.valid()) return;
+    slot.encode.get();
+    mResults.push_back(std::move(slot.result));
+    slot.result = {};
+}
+
+void FrameWriter::RecordCopy(VkCommandBuffer cmd, VkImage image, uint32_t slot) {
+    Slot& s = mSlots[slot];
+    Collect(s);   // the worker may still be reading the buffer this copy overwrites
+
+    VkMemoryBarrier2 toCopy{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    toCopy.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    toCopy.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    toCopy.dstStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    toCopy.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &toCopy;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    VkBufferImageCopy region{};
+    region.imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.imageExtent      = {mWidth, mHeight, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_GENERAL, s.readback.GetHandle(), 1, &region);
+
+    VkMemoryBarrier2 toHost{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    toHost.srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    toHost.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    toHost.dstStageMask  = VK_PIPELINE_STAGE_2_HOST_BIT;
+    toHost.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+    dep.pMemoryBarriers = &toHost;
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+void FrameWriter::Encode(uint32_t slot, uint32_t frame, const std::string& path) {
+    Slot& s = mSlots[slot];
+    s.readback.Invalidate(mAllocator);
+    s.result.frame = frame;
+    s.result.path  = path;
+
+    const float* pixels = static_cast<const float*>(s.readback.GetMappedData());
+    uint32_t w = mWidth, h = mHeight;
+    Result* result = &s.result;
+    const float* reference = mReference.size() == size_t(w) * h * 4 ? mReference.data() : nullptr;
+    s.encode = mPool->Submit([pixels, w, h, result, reference]() {
+        auto t0 = std::chrono::steady_clock::now();
+        result->ok = WriteImageFile(result->path, pixels, w, h);
+        result->encodeMs = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - t0).count();
+        if (!result->ok)
+            LOG_ERROR("Failed to write frame {} to {}", result->frame, result->path);
+
+        if (reference) {
+            double sum = 0.0;
+            for (size_t i = 0; i < size_t(w) * h; i++)
+                for (int c = 0; c < 3; c++) {
+                    double d = double(pixels[i * 4 + c]) - double(reference[i * 4 + c]);
+                    sum += std::isfinite(d) ? d * d : 0.0;
+                }
+            result->rmse = std::sqrt(sum / (double(w) * h * 3));
+        }
+    });
+}
+
+const std::vector<FrameWriter::Result>& FrameWriter::Flush() {
+    // Oldest first: slots are handed out round-robin
+    std::vector<Slot*> pending;
+    for (auto& s : mSlots)
+        if (s.encode.valid()) pending.push_back(&s);
+    std::sort(pending.begin(), pending.end(),
+              [](const Slot* a, const Slot* b) { return a->result.frame < b->result.frame; });
+    for (Slot* s : pending) Collect(*s);
+    return mResults;
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Resource/VulkanBuffer.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/// Writes linear RGBA32F pixels (top row first) picked by extension: .exr (uncompressed
+/// 32-bit float RGB), .pfm, or .png (clamped to [0,1] and sRGB encoded).
+bool WriteImageFile(const std::string& path, const float* rgba, uint32_t width, uint32_t height);
+
+/// Reads a PFM (as written by WriteImageFile or --cpu-reference) into RGBA32F, top row first.
+bool ReadPFM(const std::string& path, std::vector<float>& rgba, uint32_t& width, uint32_t& height);
+
+/// Readback ring for offline rendering: frame N is encoded on the thread pool while the
+/// GPU traces frame N+1 into the path tracer's accumulation image.
+class FrameWriter {
+public:
+    struct Result {
+        uint32_t    frame    = 0;
+        std::string path;
+        double      encodeMs = 0.0;
+        double      rmse     = -1.0;   // against the reference image, if one is set
+        bool        ok       = false;
+    };
+
+    void Initialize(VmaAllocator allocator, ThreadPool* pool,
+                    uint32_t width, uint32_t height, uint32_t slots = 2);
+    void Shutdown(VmaAllocator allocator);
+
+    /// Copies a GENERAL RGBA32F image written by ray tracing or compute shaders into the
+    /// slot's buffer. Blocks until the slot's previous encode has finished.
+    void RecordCopy(VkCommandBuffer cmd, VkImage image, uint32_t slot);
+
+    /// The slot's copy has completed on the GPU: encode it on a worker.
+    void Encode(uint32_t slot, uint32_t frame, const std::string& path);
+
+    /// Waits for every encode; results in the order frames were handed to Encode.
+    const std::vector<Result>& Flush();
+
+    /// Every encoded frame is also compared to this RGBA32F image (same size as the frames).
+    void SetReference(std::vector<float> rgba) { mReference = std::move(rgba); }
+
+    uint32_t GetSlotCount() const { return static_cast<uint32_t>(mSlots.size()); }
+
+private:
+    struct Slot {
+        VulkanBuffer      readback;
+        std::future<void> encode;
+        Result            result;   // written by the worker, collected after encode
+    };
+
+    void Collect(Slot& slot);
+
+    VmaAllocator        mAllocator = VK_NULL_HANDLE;
+    ThreadPool*         mPool      = nullptr;
+    uint32_t            mWidth = 0, mHeight = 0;
+    std::vector<Slot>   mSlots;
+    std::vector<Result> mResults;
+    std::vector<float>  mReference;
+};
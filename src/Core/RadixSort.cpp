@@ -0,0 +1,91 @@
+#include "Core/RadixSort.h"
+#include "Core/ThreadPool.h"
+
+#include <algorithm>
+
+void RadixSorter::Sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, ThreadPool* pool) {
+    const size_t n = keys.size();
+    mLastPasses = 0;
+    mLastChunks = 0;
+    if (n < 2) return;
+
+    const uint32_t chunks = n >= PARALLEL_MIN ? ParallelChunkCount(pool, n, PARALLEL_MIN / 4) : 1;
+    mLastChunks = chunks;
+
+    mKeys.resize(n);
+    mValues.resize(n);
+    mCounts.assign(size_t(chunks) * DIGITS * RADIX, 0u);
+
+    auto counts = [this](uint32_t c, uint32_t d) { return &mCounts[(size_t(c) * DIGITS + d) * RADIX]; };
+
+    // Every digit's histogram in one read, to find the passes that can be skipped
+    ParallelForChunks(pool, n, chunks, [&](uint32_t c, size_t begin, size_t end) {
+        uint32_t* hist = counts(c, 0);
+        for (size_t i = begin; i < end; i++) {
+            uint64_t k = keys[i];
+            for (uint32_t d = 0; d < DIGITS; d++)
+                hist[d * RADIX + ((k >> (d * RADIX_BITS)) & (RADIX - 1))]++;
+        }
+    });
+
+    bool active[DIGITS];
+    for (uint32_t d = 0; d < DIGITS; d++) {
+        uint32_t bucket = static_cast<uint32_t>((keys[0] >> (d * RADIX_BITS)) & (RADIX - 1));
+        size_t   same   = 0;
+        for (uint32_t c = 0; c < chunks; c++) same += counts(c, d)[bucket];
+        active[d] = same != n;
+    }
+
+    uint64_t* srcKeys   = keys.data();
+    uint32_t* srcValues = values.data();
+    uint64_t* dstKeys   = mKeys.data();
+    uint32_t* dstValues = mValues.data();
+
+    for (uint32_t d = 0; d < DIGITS; d++) {
+        if (!active[d]) continue;
+        const uint32_t shift = d * RADIX_BITS;
+
+        // The first pass reads the input order the histograms were taken on; later
+        // passes moved keys between chunks, so their chunk counts are retaken (a
+        // single chunk's counts are the whole input's and never change)
+        if (mLastPasses > 0 && chunks > 1) {
+            ParallelForChunks(pool, n, chunks, [&](uint32_t c, size_t begin, size_t end) {
+                uint32_t* hist = counts(c, d);
+                std::fill(hist, hist + RADIX, 0u);
+                for (size_t i = begin; i < end; i++)
+                    hist[(srcKeys[i] >> shift) & (RADIX - 1)]++;
+            });
+        }
+
+        // Digit-major, chunk-minor prefix: chunk c's keys of digit b land after every
+        // smaller digit and after earlier chunks' keys of digit b, which keeps it stable
+        uint32_t running = 0;
+        for (uint32_t b = 0; b < RADIX; b++) {
+            for (uint32_t c = 0; c < chunks; c++) {
+                uint32_t& slot = counts(c, d)[b];
+                uint32_t  count = slot;
+                slot     = running;
+                running += count;
+            }
+        }
+
+        ParallelForChunks(pool, n, chunks, [&](uint32_t c, size_t begin, size_t end) {
+            uint32_t* offset = counts(c, d);
+            for (size_t i = begin; i < end; i++) {
+                uint32_t pos = offset[(srcKeys[i] >> shift) & (RADIX - 1)]++;
+                dstKeys[pos]   = srcKeys[i];
+                dstValues[pos] = srcValues[i];
+            }
+        });
+
+        std::swap(srcKeys, dstKeys);
+        std::swap(srcValues, dstValues);
+        mLastPasses++;
+    }
+
+    // An odd pass count leaves the result in the scratch buffers; trade them
+    if (srcKeys != keys.data()) {
+        keys.swap(mKeys);
+        values.swap(mValues);
+    }
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/// Stable LSD radix sort of 64-bit keys carrying a 32-bit payload, 8 bits per pass.
+/// A pass whose digit is the same for every key is skipped, so keys with unused
+/// fields cost only the passes over the bits that vary. Large inputs split into one
+/// chunk per pool thread: each chunk counts its digits, a prefix over (digit, chunk)
+/// gives every chunk its own output ranges, and the chunks scatter in parallel.
+/// The scratch buffers persist, so a per-frame sort allocates only when it grows.
+class RadixSorter {
+public:
+    static constexpr uint32_t RADIX_BITS   = 8;
+    static constexpr uint32_t RADIX        = 1u << RADIX_BITS;
+    static constexpr uint32_t DIGITS       = 64 / RADIX_BITS;
+    static constexpr uint32_t PARALLEL_MIN = 32768;   // keys; below this the sort stays on the caller
+
+    /// Sorts keys ascending and permutes values alongside (values.size() == keys.size()).
+    /// pool may be null.
+    void Sort(std::vector<uint64_t>& keys, std::vector<uint32_t>& values, ThreadPool* pool = nullptr);
+
+    /// Scatter passes the last Sort ran (at most DIGITS) and the chunks it used.
+    uint32_t GetLastPassCount()  const { return mLastPasses; }
+    uint32_t GetLastChunkCount() const { return mLastChunks; }
+
+private:
+    std::vector<uint64_t> mKeys;
+    std::vector<uint32_t> mValues;
+    std::vector<uint32_t> mCounts;   // [chunk][digit][RADIX]
+    uint32_t              mLastPasses = 0;
+    uint32_t              mLastChunks = 0;
+};
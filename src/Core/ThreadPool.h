@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <thread>
 #include <vector>
 #include <queue>
@@ -29,3 +30,30 @@ private:
     uint32_t                mActiveTasks = 0;
     bool                    mStopping    = false;
 };
+
+/// Chunks for `count` items, at least `grain` each: at most one per pool thread plus the
+/// calling thread, and 1 without a pool.
+inline uint32_t ParallelChunkCount(const ThreadPool* pool, size_t count, size_t grain = 1) {
+    size_t threads = pool ? size_t(pool->GetThreadCount()) + 1 : 1;
+    grain = std::max<size_t>(grain, 1);
+    return static_cast<uint32_t>(std::clamp<size_t>((count + grain - 1) / grain, 1, threads));
+}
+
+/// Splits [0, count) into `chunks` contiguous ranges and runs fn(chunk, begin, end) for
+/// each: chunk 0 on the calling thread, the rest as pool tasks. Returns when all are
+/// done, and waits only for its own tasks, so the pool can be shared. pool may be null
+/// when chunks is 1.
+template<typename Fn>
+void ParallelForChunks(ThreadPool* pool, size_t count, uint32_t chunks, Fn&& fn) {
+    auto begin = [count, chunks](uint32_t c) { return count * c / chunks; };
+    if (chunks <= 1) {
+        fn(0u, size_t(0), count);
+        return;
+    }
+    std::vector<std::future<void>> pending;
+    pending.reserve(chunks - 1);
+    for (uint32_t c = 1; c < chunks; c++)
+        pending.push_back(pool->Submit([&fn, &begin, c] { fn(c, begin(c), begin(c + 1)); }));
+    fn(0u, size_t(0), begin(1));
+    for (auto& f : pending) f.get();
+}
@@ -0,0 +1,490 @@
+#include "Culling/SceneBVH.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRB_BVH_SSE 1
+#include <emmintrin.h>
+#endif
+
+// -----------------------------------------------------------------------
+// Box tests
+// -----------------------------------------------------------------------
+
+enum Containment : uint32_t {
+    CONTAIN_OUTSIDE,
+    CONTAIN_INTERSECT,
+    CONTAIN_INSIDE,
+};
+
+void CullVolumes::Set(uint32_t volume, const glm::vec4* planes, uint32_t planeCount) {
+    planeCount = std::min(planeCount, MAX_GROUPS * 4);
+    count = std::max(count, volume + 1);
+    groupCount[volume] = (planeCount + 3) / 4;
+
+    for (uint32_t i = 0; i < groupCount[volume] * 4; i++) {
+        glm::vec4 p = i < planeCount ? planes[i] : glm::vec4(0.0f, 0.0f, 0.0f, 1e30f);
+        PlaneGroup& g = groups[volume][i / 4];
+        uint32_t    l = i % 4;
+        g.nx[l] = p.x;
+        g.ny[l] = p.y;
+        g.nz[l] = p.z;
+        g.ax[l] = std::abs(p.x);
+        g.ay[l] = std::abs(p.y);
+        g.az[l] = std::abs(p.z);
+        g.d[l]  = p.w;
+    }
+}
+
+// Center-extent form: the box is outside a plane when its nearest corner is,
+// i.e. dist(center) + dot(|n|, extent) < 0, and fully inside when dist - that >= 0
+static Containment ClassifyScalar(const CullVolumes& volumes, uint32_t v, const glm::vec3& c, const glm::vec3& e) {
+    bool intersect = false;
+    for (uint32_t gi = 0; gi < volumes.groupCount[v]; gi++) {
+        const auto& g = volumes.groups[v][gi];
+        for (uint32_t l = 0; l < 4; l++) {
+            float dist = (g.nx[l] * c.x + g.ny[l] * c.y) + (g.nz[l] * c.z + g.d[l]);   // same order as SSE
+            float rad  = g.ax[l] * e.x + g.ay[l] * e.y + g.az[l] * e.z;
+            if (dist + rad < 0.0f) return CONTAIN_OUTSIDE;
+            if (dist - rad < 0.0f) intersect = true;
+        }
+    }
+    return intersect ? CONTAIN_INTERSECT : CONTAIN_INSIDE;
+}
+
+#if defined(VRB_BVH_SSE)
+// Four planes per step
+static Containment ClassifySSE(const CullVolumes& volumes, uint32_t v, const glm::vec3& c, const glm::vec3& e) {
+    const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+    const __m128 ex = _mm_set1_ps(e.x), ey = _mm_set1_ps(e.y), ez = _mm_set1_ps(e.z);
+    const __m128 zero = _mm_setzero_ps();
+
+    bool intersect = false;
+    for (uint32_t gi = 0; gi < volumes.groupCount[v]; gi++) {
+        const auto& g = volumes.groups[v][gi];
+        __m128 dist = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(g.nx), cx), _mm_mul_ps(_mm_load_ps(g.ny), cy)),
+                                 _mm_add_ps(_mm_mul_ps(_mm_load_ps(g.nz), cz), _mm_load_ps(g.d)));
+        __m128 rad  = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_load_ps(g.ax), ex), _mm_mul_ps(_mm_load_ps(g.ay), ey)),
+                                 _mm_mul_ps(_mm_load_ps(g.az), ez));
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_add_ps(dist, rad), zero))) return CONTAIN_OUTSIDE;
+        if (_mm_movemask_ps(_mm_cmplt_ps(_mm_sub_ps(dist, rad), zero))) intersect = true;
+    }
+    return intersect ? CONTAIN_INTERSECT : CONTAIN_INSIDE;
+}
+#endif
+
+static Containment Classify(const CullVolumes& volumes, uint32_t v, const glm::vec3& c, const glm::vec3& e) {
+#if defined(VRB_BVH_SSE)
+    return ClassifySSE(volumes, v, c, e);
+#else
+    return ClassifyScalar(volumes, v, c, e);
+#endif
+}
+
+// -----------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------
+
+static AABB Union(const AABB& a, const AABB& b) {
+    AABB r = a;
+    r.Include(b);
+    return r;
+}
+
+// Half the surface area, the SAH cost measure
+static float Area(const AABB& b) {
+    glm::vec3 e = b.Extent();
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+static bool Contains(const AABB& outer, const AABB& inner) {
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static AABB Fatten(const AABB& b) {
+    glm::vec3 margin = b.Extent() * SceneBVH::FAT_MARGIN + glm::vec3(1e-3f);
+    AABB r;
+    r.min = b.min - margin;
+    r.max = b.max + margin;
+    return r;
+}
+
+AABB SceneBVH::TransformBounds(const AABB& local, const glm::mat4& model) {
+    glm::vec3 c = glm::vec3(model * glm::vec4(local.Center(), 1.0f));
+    glm::vec3 h = local.Extent() * 0.5f;
+    glm::vec3 e(std::abs(model[0][0]) * h.x + std::abs(model[1][0]) * h.y + std::abs(model[2][0]) * h.z,
+                std::abs(model[0][1]) * h.x + std::abs(model[1][1]) * h.y + std::abs(model[2][1]) * h.z,
+                std::abs(model[0][2]) * h.x + std::abs(model[1][2]) * h.y + std::abs(model[2][2]) * h.z);
+    AABB r;
+    r.min = c - e;
+    r.max = c + e;
+    return r;
+}
+
+// -----------------------------------------------------------------------
+// Nodes
+// -----------------------------------------------------------------------
+
+int32_t SceneBVH::AllocateNode() {
+    if (mFreeList == NULL_NODE) {
+        mNodes.emplace_back();
+        mFreeList = static_cast<int32_t>(mNodes.size()) - 1;
+        mNodes.back().parent = NULL_NODE;
+    }
+    int32_t n = mFreeList;
+    mFreeList = mNodes[n].parent;
+    mNodes[n] = Node{};
+    mNodes[n].height = 0;
+    return n;
+}
+
+void SceneBVH::FreeNode(int32_t node) {
+    mNodes[node].height = -1;
+    mNodes[node].entity = INVALID_ENTITY;
+    mNodes[node].parent = mFreeList;
+    mFreeList = node;
+}
+
+void SceneBVH::RefitUpwards(int32_t node) {
+    while (node != NULL_NODE) {
+        node = Balance(node);
+        Node& n = mNodes[node];
+        const Node& a = mNodes[n.child[0]];
+        const Node& b = mNodes[n.child[1]];
+        n.height = 1 + std::max(a.height, b.height);
+        n.bounds = Union(a.bounds, b.bounds);
+        node = n.parent;
+    }
+}
+
+void SceneBVH::InsertLeaf(int32_t leaf) {
+    mFlatDirty = true;
+    if (mRoot == NULL_NODE) {
+        mRoot = leaf;
+        mNodes[leaf].parent = NULL_NODE;
+        return;
+    }
+
+    // Descend towards the sibling with the smallest surface-area cost
+    const AABB leafBounds = mNodes[leaf].bounds;
+    int32_t index = mRoot;
+    while (mNodes[index].height > 0) {
+        const Node& n = mNodes[index];
+        float area         = Area(n.bounds);
+        float combinedArea = Area(Union(n.bounds, leafBounds));
+        float cost         = 2.0f * combinedArea;             // new parent here
+        float inheritance  = 2.0f * (combinedArea - area);    // growth pushed onto ancestors
+
+        float childCost[2];
+        for (int k = 0; k < 2; k++) {
+            const Node& c = mNodes[n.child[k]];
+            float grown = Area(Union(c.bounds, leafBounds));
+            childCost[k] = (c.height == 0 ? grown : grown - Area(c.bounds)) + inheritance;
+        }
+        if (cost < childCost[0] && cost < childCost[1]) break;
+        index = childCost[0] < childCost[1] ? n.child[0] : n.child[1];
+    }
+
+    int32_t sibling   = index;
+    int32_t oldParent = mNodes[sibling].parent;
+    int32_t newParent = AllocateNode();
+    Node&   p         = mNodes[newParent];
+    p.parent   = oldParent;
+    p.bounds   = Union(leafBounds, mNodes[sibling].bounds);
+    p.height   = mNodes[sibling].height + 1;
+    p.child[0] = sibling;
+    p.child[1] = leaf;
+
+    if (oldParent != NULL_NODE) {
+        Node& op = mNodes[oldParent];
+        op.child[op.child[0] == sibling ? 0 : 1] = newParent;
+    } else {
+        mRoot = newParent;
+    }
+    mNodes[sibling].parent = newParent;
+    mNodes[leaf].parent    = newParent;
+
+    // Starts at the new parent: the descent may stop above a tall subtree
+    RefitUpwards(newParent);
+}
+
+void SceneBVH::RemoveLeaf(int32_t leaf) {
+    mFlatDirty = true;
+    if (leaf == mRoot) {
+        mRoot = NULL_NODE;
+        return;
+    }
+
+    int32_t parent      = mNodes[leaf].parent;
+    int32_t grandParent = mNodes[parent].parent;
+    int32_t sibling     = mNodes[parent].child[mNodes[parent].child[0] == leaf ? 1 : 0];
+
+    if (grandParent != NULL_NODE) {
+        Node& gp = mNodes[grandParent];
+        gp.child[gp.child[0] == parent ? 0 : 1] = sibling;
+        mNodes[sibling].parent = grandParent;
+        FreeNode(parent);
+        RefitUpwards(grandParent);
+    } else {
+        mRoot = sibling;
+        mNodes[sibling].parent = NULL_NODE;
+        FreeNode(parent);
+    }
+}
+
+// Rotates the taller grandchild up when the children's heights differ by more than one.
+// Returns the node now at this position.
+int32_t SceneBVH::Balance(int32_t iA) {
+    Node& A = mNodes[iA];
+    if (A.height == 0) return iA;   // A's own height may be stale, the children's are not
+
+    int32_t iB = A.child[0];
+    int32_t iC = A.child[1];
+    int32_t balance = mNodes[iC].height - mNodes[iB].height;
+
+    // Rotate C (or B, mirrored) up into A's place
+    auto rotate = [&](int32_t iUp, int32_t iStay, int slot) -> int32_t {
+        Node& up   = mNodes[iUp];
+        int32_t iF = up.child[0];
+        int32_t iG = up.child[1];
+
+        up.child[0] = iA;
+        up.parent   = A.parent;
+        A.parent    = iUp;
+        if (up.parent != NULL_NODE) {
+            Node& pp = mNodes[up.parent];
+            pp.child[pp.child[0] == iA ? 0 : 1] = iUp;
+        } else {
+            mRoot = iUp;
+        }
+
+        // The taller grandchild stays under the rotated node, the other moves to A
+        int32_t iKeep = mNodes[iF].height > mNodes[iG].height ? iF : iG;
+        int32_t iMove = iKeep == iF ? iG : iF;
+        up.child[1]       = iKeep;
+        A.child[slot]     = iMove;
+        mNodes[iMove].parent = iA;
+
+        A.bounds  = Union(mNodes[iStay].bounds, mNodes[iMove].bounds);
+        A.height  = 1 + std::max(mNodes[iStay].height, mNodes[iMove].height);
+        up.bounds = Union(A.bounds, mNodes[iKeep].bounds);
+        up.height = 1 + std::max(A.height, mNodes[iKeep].height);
+        return iUp;
+    };
+
+    if (balance > 1)  return rotate(iC, iB, 1);
+    if (balance < -1) return rotate(iB, iC, 0);
+    return iA;
+}
+
+// -----------------------------------------------------------------------
+// Leaves
+// -----------------------------------------------------------------------
+
+void SceneBVH::Insert(Entity e, const AABB& worldBounds) {
+    if (e >= mEntities.size()) mEntities.resize(e + 1);
+    EntityRecord& rec = mEntities[e];
+    if (rec.leaf != NULL_NODE) {
+        Update(e, worldBounds);
+        return;
+    }
+
+    int32_t leaf = AllocateNode();
+    mNodes[leaf].entity = e;
+    mNodes[leaf].tight  = worldBounds;
+    mNodes[leaf].bounds = Fatten(worldBounds);
+    InsertLeaf(leaf);
+
+    rec.leaf = leaf;
+    mLeafCount++;
+    mStats.inserted++;
+}
+
+void SceneBVH::Update(Entity e, const AABB& worldBounds) {
+    if (e >= mEntities.size() || mEntities[e].leaf == NULL_NODE) {
+        Insert(e, worldBounds);
+        return;
+    }
+
+    int32_t leaf = mEntities[e].leaf;
+    mNodes[leaf].tight = worldBounds;
+    if (Contains(mNodes[leaf].bounds, worldBounds)) {
+        // Ancestors still enclose it: only the leaf's own box changes
+        if (!mFlatDirty) {
+            FlatNode& f = mFlat[mNodes[leaf].flat];
+            f.center = worldBounds.Center();
+            f.extent = worldBounds.Extent() * 0.5f;
+        }
+        mStats.refitted++;
+        return;
+    }
+
+    RemoveLeaf(leaf);
+    mNodes[leaf].bounds = Fatten(worldBounds);
+    InsertLeaf(leaf);
+    mStats.reinserted++;
+}
+
+void SceneBVH::Remove(Entity e) {
+    if (e >= mEntities.size() || mEntities[e].leaf == NULL_NODE) return;
+    RemoveLeaf(mEntities[e].leaf);
+    FreeNode(mEntities[e].leaf);
+    mEntities[e] = EntityRecord{};
+    mLeafCount--;
+    mStats.removed++;
+}
+
+void SceneBVH::Clear() {
+    mNodes.clear();
+    mEntities.clear();
+    mFlat.clear();
+    mFlatLeaves.clear();
+    mRoot      = NULL_NODE;
+    mFreeList  = NULL_NODE;
+    mLeafCount = 0;
+    mFlatDirty = true;
+}
+
+void SceneBVH::Sync(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds) {
+    auto start = std::chrono::steady_clock::now();
+    mSyncIndex++;
+
+    registry.ForEachRenderable([&](Entity e, const TransformComponent& tc,
+                                   const MeshComponent& mc, const MaterialComponent&) {
+        if (mc.meshIndex < 0 || mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
+        if (!drawCmds[mc.meshIndex].bounds.Valid()) return;
+        if (e >= mEntities.size()) mEntities.resize(e + 1);
+
+        EntityRecord& rec = mEntities[e];
+        rec.lastSeen = mSyncIndex;
+        if (rec.leaf != NULL_NODE && rec.meshIndex == mc.meshIndex &&
+            std::memcmp(&rec.model, &tc.worldMatrix, sizeof(glm::mat4)) == 0)
+            return;
+
+        rec.meshIndex = mc.meshIndex;
+        rec.model     = tc.worldMatrix;
+        AABB world = TransformBounds(drawCmds[mc.meshIndex].bounds, tc.worldMatrix);
+        if (rec.leaf == NULL_NODE) Insert(e, world);
+        else                       Update(e, world);
+    });
+
+    for (Entity e = 0; e < mEntities.size(); e++)
+        if (mEntities[e].leaf != NULL_NODE && mEntities[e].lastSeen != mSyncIndex)
+            Remove(e);
+
+    mStats.syncs++;
+    mStats.syncMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+// -----------------------------------------------------------------------
+// Queries
+// -----------------------------------------------------------------------
+
+uint32_t SceneBVH::FlattenNode(int32_t node) {
+    uint32_t index = static_cast<uint32_t>(mFlat.size());
+    mFlat.emplace_back();
+
+    const Node& n = mNodes[node];
+    FlatNode f{};
+    f.leafBegin = static_cast<uint32_t>(mFlatLeaves.size());
+    if (n.height == 0) {
+        mFlatLeaves.push_back(n.entity);
+        mNodes[node].flat = index;
+        f.center = n.tight.Center();
+        f.extent = n.tight.Extent() * 0.5f;
+    } else {
+        FlattenNode(n.child[0]);
+        f.right  = FlattenNode(n.child[1]);
+        f.center = n.bounds.Center();
+        f.extent = n.bounds.Extent() * 0.5f;
+    }
+    f.leafEnd = static_cast<uint32_t>(mFlatLeaves.size());
+    mFlat[index] = f;
+    return index;
+}
+
+// Depth-first copy of the tree for queries: the left child follows its parent and every
+// subtree's leaves are contiguous. Rebuilt after structural changes only.
+void SceneBVH::Flatten() {
+    mFlat.clear();
+    mFlatLeaves.clear();
+    mFlat.reserve(mLeafCount * 2);
+    mFlatLeaves.reserve(mLeafCount);
+    if (mRoot != NULL_NODE) FlattenNode(mRoot);
+    mFlatDirty = false;
+    mStats.flattens++;
+}
+
+uint32_t SceneBVH::Cull(const CullVolumes& volumes, std::vector<uint8_t>& masks) {
+    auto start = std::chrono::steady_clock::now();
+    if (mFlatDirty) Flatten();
+    masks.assign(mEntities.size(), 0);
+
+    uint32_t accepted = 0;
+    uint64_t visited  = 0;
+    if (!mFlat.empty() && volumes.count > 0) {
+        mStack.clear();
+        mStack.push_back({0u, (1u << volumes.count) - 1, 0u});
+
+        while (!mStack.empty()) {
+            StackEntry entry = mStack.back();
+            mStack.pop_back();
+            const FlatNode& node = mFlat[entry.node];
+            visited++;
+
+            // Volumes a node is fully inside are not tested again below it
+            uint32_t undecided = entry.undecided;
+            for (uint32_t v = 0; v < volumes.count; v++) {
+                if (!(entry.undecided & (1u << v))) continue;
+                Containment c = Classify(volumes, v, node.center, node.extent);
+                if (c != CONTAIN_INTERSECT) undecided &= ~(1u << v);
+                if (c == CONTAIN_INSIDE)    entry.inside |= 1u << v;
+            }
+            uint32_t any = undecided | entry.inside;
+            if (!any) continue;
+
+            // Leaf, or nothing left to decide: the whole leaf range takes the mask
+            if (!undecided || node.leafEnd - node.leafBegin == 1) {
+                for (uint32_t l = node.leafBegin; l < node.leafEnd; l++)
+                    masks[mFlatLeaves[l]] = static_cast<uint8_t>(any);
+                accepted += node.leafEnd - node.leafBegin;
+                continue;
+            }
+            mStack.push_back({node.right,     undecided, entry.inside});
+            mStack.push_back({entry.node + 1, undecided, entry.inside});
+        }
+    }
+
+    mStats.queries++;
+    mStats.nodesVisited += visited;
+    mStats.accepted     += accepted;
+    mStats.queryMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return accepted;
+}
+
+uint32_t SceneBVH::CullLinear(const CullVolumes& volumes, std::vector<uint8_t>& masks, bool simd) const {
+    masks.assign(mEntities.size(), 0);
+    uint32_t accepted = 0;
+    for (Entity e = 0; e < mEntities.size(); e++) {
+        int32_t leaf = mEntities[e].leaf;
+        if (leaf == NULL_NODE) continue;
+
+        const AABB& box = mNodes[leaf].tight;
+        glm::vec3 c = box.Center();
+        glm::vec3 h = box.Extent() * 0.5f;
+        uint32_t mask = 0;
+        for (uint32_t v = 0; v < volumes.count; v++) {
+            Containment r = simd ? Classify(volumes, v, c, h) : ClassifyScalar(volumes, v, c, h);
+            if (r != CONTAIN_OUTSIDE) mask |= 1u << v;
+        }
+        masks[e] = static_cast<uint8_t>(mask);
+        accepted += mask ? 1 : 0;
+    }
+    return accepted;
+}
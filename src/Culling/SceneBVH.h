@@ -0,0 +1,137 @@
+#pragma once
+
+#include "GPU/MeshPool.h"
+#include "Scene/ECS.h"
+#include "Math/AABB.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+/// Up to MAX_VOLUMES convex volumes (camera frustum, shadow caster boxes), each stored as
+/// groups of four planes in SoA form for the SSE box test. Planes point inwards:
+/// dot(xyz, p) + w >= 0 is inside, the convention of ExtractFrustumPlanes and cull.comp.
+struct CullVolumes {
+    static constexpr uint32_t MAX_VOLUMES = 8;
+    static constexpr uint32_t MAX_GROUPS  = 2;   // 8 planes per volume
+
+    struct alignas(16) PlaneGroup {
+        float nx[4], ny[4], nz[4];
+        float ax[4], ay[4], az[4];   // |n|, projects the box extent onto the normal
+        float d[4];
+    };
+
+    /// Unused plane slots are padded with planes every point is inside of.
+    void Set(uint32_t volume, const glm::vec4* planes, uint32_t planeCount);
+
+    uint32_t   count = 0;
+    uint32_t   groupCount[MAX_VOLUMES]{};
+    PlaneGroup groups[MAX_VOLUMES][MAX_GROUPS];
+};
+
+/// Accumulated until ResetStats().
+struct SceneBVHStats {
+    uint64_t syncs        = 0;
+    uint64_t inserted     = 0;
+    uint64_t removed      = 0;
+    uint64_t refitted     = 0;   // moved, still inside the fat bounds: no tree change
+    uint64_t reinserted   = 0;   // moved out of the fat bounds
+    uint64_t queries      = 0;
+    uint64_t nodesVisited = 0;
+    uint64_t accepted     = 0;   // leaves inside at least one volume
+    uint64_t flattens     = 0;   // query layout rebuilt after structural changes
+    double   syncMs       = 0.0;
+    double   queryMs      = 0.0;
+};
+
+/// Dynamic AABB tree over the world-space bounds of every renderable, for the CPU draw
+/// path. Leaves keep fattened bounds so small movements only update the leaf; anything
+/// that leaves its fat box is removed and reinserted (surface-area cost descent, AVL
+/// rotations on the way up). Queries walk a depth-first copy of the tree once for several
+/// volumes and stop testing a volume below nodes fully inside it; subtrees fully decided
+/// are accepted as one contiguous leaf range.
+class SceneBVH {
+public:
+    /// Fat bounds grow by this fraction of the extent on each side.
+    static constexpr float FAT_MARGIN = 0.1f;
+
+    /// Incremental: only entities whose mesh or world matrix changed are touched.
+    void Sync(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds);
+
+    void Insert(Entity e, const AABB& worldBounds);
+    void Update(Entity e, const AABB& worldBounds);
+    void Remove(Entity e);
+    void Clear();
+
+    /// masks[e] bit v set when e's bounds touch volume v, sized to the largest entity + 1.
+    /// Returns the number of entities with any bit set.
+    uint32_t Cull(const CullVolumes& volumes, std::vector<uint8_t>& masks);
+
+    /// Same result without the tree, one box test per leaf. Reference for validation and
+    /// benchmarks; simd = false uses the scalar test.
+    uint32_t CullLinear(const CullVolumes& volumes, std::vector<uint8_t>& masks, bool simd = true) const;
+
+    uint32_t GetLeafCount() const { return mLeafCount; }
+    int32_t  GetHeight()    const { return mRoot == NULL_NODE ? 0 : mNodes[mRoot].height; }
+
+    const SceneBVHStats& GetStats() const { return mStats; }
+    void ResetStats() { mStats = {}; }
+
+    static AABB TransformBounds(const AABB& local, const glm::mat4& model);
+
+private:
+    static constexpr int32_t NULL_NODE = -1;
+
+    struct Node {
+        AABB    bounds;                       // fattened for leaves
+        AABB    tight;                        // leaves only: what queries test
+        int32_t parent   = NULL_NODE;         // next free node while on the free list
+        int32_t child[2] = {NULL_NODE, NULL_NODE};
+        int32_t height   = -1;                // 0 = leaf, -1 = free
+        Entity  entity   = INVALID_ENTITY;
+        uint32_t flat    = 0;                 // leaves: index in mFlat
+    };
+
+    struct FlatNode {
+        glm::vec3 center;
+        glm::vec3 extent;                     // half size
+        uint32_t  right     = 0;              // left child is the next node
+        uint32_t  leafBegin = 0;              // subtree's leaves in mFlatLeaves
+        uint32_t  leafEnd   = 0;
+    };
+
+    struct EntityRecord {
+        int32_t   leaf      = NULL_NODE;
+        int       meshIndex = -1;
+        uint32_t  lastSeen  = 0;
+        glm::mat4 model{1.0f};
+    };
+
+    struct StackEntry {
+        uint32_t node;        // into mFlat
+        uint32_t undecided;   // volumes the node intersects
+        uint32_t inside;      // volumes the node is fully inside
+    };
+
+    int32_t AllocateNode();
+    void    FreeNode(int32_t node);
+    void    InsertLeaf(int32_t leaf);
+    void    RemoveLeaf(int32_t leaf);
+    int32_t Balance(int32_t node);
+    void    RefitUpwards(int32_t node);
+    void     Flatten();
+    uint32_t FlattenNode(int32_t node);
+
+    std::vector<Node>         mNodes;
+    int32_t                   mRoot      = NULL_NODE;
+    int32_t                   mFreeList  = NULL_NODE;
+    uint32_t                  mLeafCount = 0;
+    uint32_t                  mSyncIndex = 0;
+    std::vector<EntityRecord> mEntities;
+    std::vector<FlatNode>     mFlat;
+    std::vector<Entity>       mFlatLeaves;
+    bool                      mFlatDirty = true;
+    std::vector<StackEntry>   mStack;
+
+    SceneBVHStats mStats;
+};
@@ -0,0 +1,510 @@
+#include "Culling/SoftwareOcclusion.h"
+#include "Core/ThreadPool.h"
+#include "Core/Logger.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define VRB_SWOC_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define VRB_AVX2_TARGET
+#else
+#define VRB_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+// -----------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------
+
+// Occluder triangles are clipped to x, y in [-GUARD_BAND * w, GUARD_BAND * w] so the
+// pixel-space edge functions stay well inside float precision.
+static constexpr float GUARD_BAND = 2.0f;
+
+static const glm::vec4 CLIP_PLANES[5] = {
+    { 0.0f,  0.0f, 1.0f, 0.0f},          // near: z >= 0
+    { 1.0f,  0.0f, 0.0f, GUARD_BAND},
+    {-1.0f,  0.0f, 0.0f, GUARD_BAND},
+    { 0.0f,  1.0f, 0.0f, GUARD_BAND},
+    { 0.0f, -1.0f, 0.0f, GUARD_BAND},
+};
+
+enum OutCode : uint32_t {
+    OUT_LEFT   = 1u << 0,
+    OUT_RIGHT  = 1u << 1,
+    OUT_BOTTOM = 1u << 2,
+    OUT_TOP    = 1u << 3,
+    OUT_NEAR   = 1u << 4,
+    OUT_FAR    = 1u << 5,
+    OUT_GUARD  = 1u << 6,   // needs clipping, not a frustum side
+};
+
+static uint32_t ComputeOutCode(const glm::vec4& c) {
+    uint32_t code = 0;
+    if (c.x < -c.w) code |= OUT_LEFT;
+    if (c.x >  c.w) code |= OUT_RIGHT;
+    if (c.y < -c.w) code |= OUT_BOTTOM;
+    if (c.y >  c.w) code |= OUT_TOP;
+    if (c.z <  0.0f) code |= OUT_NEAR;
+    if (c.z >  c.w) code |= OUT_FAR;
+    float guard = GUARD_BAND * c.w;
+    if (c.x < -guard || c.x > guard || c.y < -guard || c.y > guard) code |= OUT_GUARD;
+    return code;
+}
+
+// Sutherland-Hodgman against one clip-space plane, keeps dot(plane, v) >= 0
+static uint32_t ClipPolygon(const glm::vec4* in, uint32_t count, const glm::vec4& plane, glm::vec4* out) {
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const glm::vec4& a = in[i];
+        const glm::vec4& b = in[(i + 1) % count];
+        float da = glm::dot(plane, a);
+        float db = glm::dot(plane, b);
+        if (da >= 0.0f) out[n++] = a;
+        if ((da >= 0.0f) != (db >= 0.0f))
+            out[n++] = a + (b - a) * (da / (da - db));
+    }
+    return n;
+}
+
+static bool CpuHasAVX2() {
+#if !defined(VRB_SWOC_X86)
+    return false;
+#elif defined(_MSC_VER) && !defined(__clang__)
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 7) return false;
+    __cpuid(info, 1);
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    bool avx     = (info[2] & (1 << 28)) != 0;
+    if (!osxsave || !avx || (_xgetbv(0) & 6) != 6) return false;
+    __cpuidex(info, 7, 0);
+    return (info[1] & (1 << 5)) != 0;
+#else
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// -----------------------------------------------------------------------
+// Rasterization
+// -----------------------------------------------------------------------
+
+// Same operation order and sign test as RasterizeAVX2, so both write identical depth
+static void RasterizeScalar(const SoftwareOcclusion::Triangle& t, float* depth, uint32_t width,
+                            int32_t y0, int32_t y1) {
+    for (int32_t y = y0; y <= y1; y++) {
+        float  fy  = static_cast<float>(y);
+        float* row = depth + static_cast<size_t>(y) * width;
+        float  c0  = t.edgeB[0] * fy + t.edgeC[0];
+        float  c1  = t.edgeB[1] * fy + t.edgeC[1];
+        float  c2  = t.edgeB[2] * fy + t.edgeC[2];
+        float  zc  = t.zB * fy + t.zC;
+        for (int32_t x = t.minX; x <= t.maxX; x++) {
+            float fx = static_cast<float>(x);
+            float e0 = t.edgeA[0] * fx + c0;
+            float e1 = t.edgeA[1] * fx + c1;
+            float e2 = t.edgeA[2] * fx + c2;
+            if (std::signbit(e0) || std::signbit(e1) || std::signbit(e2)) continue;
+            float z = std::min(t.zA * fx + zc, t.zMax);
+            row[x] = std::min(row[x], z);
+        }
+    }
+}
+
+#if defined(VRB_SWOC_X86)
+// Eight pixels per step. Rows are padded to whole tiles, so the aligned start never
+// reads past the row; lanes outside the triangle's pixel bounds are masked like the
+// edge test, so the result matches RasterizeScalar pixel for pixel.
+VRB_AVX2_TARGET
+static void RasterizeAVX2(const SoftwareOcclusion::Triangle& t, float* depth, uint32_t width,
+                          int32_t y0, int32_t y1) {
+    const __m256 lanes = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+    const __m256 step  = _mm256_set1_ps(8.0f);
+    const __m256 zMax  = _mm256_set1_ps(t.zMax);
+    const __m256 xMin  = _mm256_set1_ps(static_cast<float>(t.minX));
+    const __m256 xMax  = _mm256_set1_ps(static_cast<float>(t.maxX));
+    const int32_t xStart = t.minX & ~7;
+
+    __m256 a[3];
+    for (int k = 0; k < 3; k++) a[k] = _mm256_set1_ps(t.edgeA[k]);
+    const __m256 zA = _mm256_set1_ps(t.zA);
+
+    for (int32_t y = y0; y <= y1; y++) {
+        float  fy  = static_cast<float>(y);
+        float* row = depth + static_cast<size_t>(y) * width;
+
+        __m256 fx = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(xStart)), lanes);
+        __m256 c0 = _mm256_set1_ps(t.edgeB[0] * fy + t.edgeC[0]);
+        __m256 c1 = _mm256_set1_ps(t.edgeB[1] * fy + t.edgeC[1]);
+        __m256 c2 = _mm256_set1_ps(t.edgeB[2] * fy + t.edgeC[2]);
+        __m256 zc = _mm256_set1_ps(t.zB * fy + t.zC);
+
+        for (int32_t x = xStart; x <= t.maxX; x += 8) {
+            __m256 e0 = _mm256_add_ps(_mm256_mul_ps(a[0], fx), c0);
+            __m256 e1 = _mm256_add_ps(_mm256_mul_ps(a[1], fx), c1);
+            __m256 e2 = _mm256_add_ps(_mm256_mul_ps(a[2], fx), c2);
+            // Sign bit set in any edge, or all bits in a lane past the bounds: outside
+            __m256 outside = _mm256_or_ps(e0, _mm256_or_ps(e1, e2));
+            outside = _mm256_or_ps(outside, _mm256_or_ps(_mm256_cmp_ps(fx, xMin, _CMP_LT_OQ),
+                                                         _mm256_cmp_ps(fx, xMax, _CMP_GT_OQ)));
+
+            __m256 z   = _mm256_min_ps(_mm256_add_ps(_mm256_mul_ps(zA, fx), zc), zMax);
+            __m256 cur = _mm256_loadu_ps(row + x);
+            _mm256_storeu_ps(row + x, _mm256_blendv_ps(_mm256_min_ps(cur, z), cur, outside));
+
+            fx = _mm256_add_ps(fx, step);
+        }
+    }
+}
+#endif
+
+// -----------------------------------------------------------------------
+// Setup
+// -----------------------------------------------------------------------
+
+void SoftwareOcclusion::Initialize(uint32_t width, uint32_t height) {
+    mTilesX = (std::max(width,  1u) + TILE_WIDTH  - 1) / TILE_WIDTH;
+    mTilesY = (std::max(height, 1u) + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    mWidth  = mTilesX * TILE_WIDTH;
+    mHeight = mTilesY * TILE_HEIGHT;
+
+    mDepth.assign(static_cast<size_t>(mWidth) * mHeight, 1.0f);
+    mTileMax.assign(static_cast<size_t>(mTilesX) * mTilesY, 1.0f);
+    mAVX2 = CpuHasAVX2();
+
+    LOG_INFO("Software occlusion: {}x{} depth, {}x{} tiles, {}", mWidth, mHeight,
+             mTilesX, mTilesY, mAVX2 ? "AVX2" : "scalar");
+}
+
+void SoftwareOcclusion::SetMeshes(const std::vector<MeshData>& meshes) {
+    mMeshes.clear();
+    mMeshes.resize(meshes.size());
+    for (size_t i = 0; i < meshes.size(); i++) {
+        auto& dst = mMeshes[i];
+        dst.positions.reserve(meshes[i].vertices.size());
+        for (const auto& v : meshes[i].vertices)
+            dst.positions.push_back(v.position);
+        dst.indices = meshes[i].indices;
+    }
+}
+
+void SoftwareOcclusion::ProjectObject(Object& obj) const {
+    obj.inFrustum   = true;
+    obj.crossesNear = true;
+    obj.rectMin     = glm::vec2(0.0f);
+    obj.rectMax     = glm::vec2(float(mWidth), float(mHeight));
+    obj.nearestZ    = 0.0f;
+    obj.screenArea  = 1.0f;
+    if (!obj.bounds.Valid()) return;
+
+    uint32_t  allOut = OUT_LEFT | OUT_RIGHT | OUT_BOTTOM | OUT_TOP | OUT_NEAR | OUT_FAR;
+    bool      behind = false;
+    glm::vec2 ndcMin(std::numeric_limits<float>::max());
+    glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+    float     nearestZ = 1.0f;
+
+    for (uint32_t i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? obj.bounds.max.x : obj.bounds.min.x,
+                         (i & 2) ? obj.bounds.max.y : obj.bounds.min.y,
+                         (i & 4) ? obj.bounds.max.z : obj.bounds.min.z);
+        glm::vec4 c = obj.mvp * glm::vec4(corner, 1.0f);
+        allOut &= ComputeOutCode(c);
+
+        if (c.w <= 1e-6f || c.z < 0.0f) {
+            behind = true;
+            continue;
+        }
+        glm::vec2 ndc = glm::vec2(c) / c.w;
+        ndcMin   = glm::min(ndcMin, ndc);
+        ndcMax   = glm::max(ndcMax, ndc);
+        nearestZ = std::min(nearestZ, c.z / c.w);
+    }
+
+    obj.inFrustum = allOut == 0;
+    if (!obj.inFrustum || behind) return;
+
+    glm::vec2 size(static_cast<float>(mWidth), static_cast<float>(mHeight));
+    obj.crossesNear = false;
+    obj.rectMin     = (ndcMin * 0.5f + 0.5f) * size;
+    obj.rectMax     = (ndcMax * 0.5f + 0.5f) * size;
+    obj.nearestZ    = std::max(nearestZ, 0.0f);
+
+    glm::vec2 clipped = glm::clamp(obj.rectMax, glm::vec2(0.0f), size) -
+                        glm::clamp(obj.rectMin, glm::vec2(0.0f), size);
+    obj.screenArea  = std::max(clipped.x, 0.0f) * std::max(clipped.y, 0.0f) / (size.x * size.y);
+}
+
+glm::vec3 SoftwareOcclusion::ToScreen(const glm::vec4& clip) const {
+    float iw = 1.0f / clip.w;
+    return glm::vec3((clip.x * iw * 0.5f + 0.5f) * static_cast<float>(mWidth),
+                     (clip.y * iw * 0.5f + 0.5f) * static_cast<float>(mHeight),
+                     clip.z * iw);
+}
+
+void SoftwareOcclusion::EmitTriangle(const glm::vec3& s0, const glm::vec3& s1, const glm::vec3& s2,
+                                     std::vector<Triangle>& out) const {
+    glm::vec3 s[3] = {s0, s1, s2};
+
+    // Buffer rows run top-down like the framebuffer, so the renderer's front faces
+    // (counter-clockwise, back faces culled) come out with negative area here
+    float area = (s[1].x - s[0].x) * (s[2].y - s[0].y) - (s[2].x - s[0].x) * (s[1].y - s[0].y);
+    if (!(area < 0.0f)) return;
+    std::swap(s[1], s[2]);
+    area = -area;
+
+    float minX = std::min({s[0].x, s[1].x, s[2].x});
+    float maxX = std::max({s[0].x, s[1].x, s[2].x});
+    float minY = std::min({s[0].y, s[1].y, s[2].y});
+    float maxY = std::max({s[0].y, s[1].y, s[2].y});
+
+    // Pixels whose centers can fall inside
+    Triangle t{};
+    t.minX = std::max(0, static_cast<int32_t>(std::ceil(minX - 0.5f)));
+    t.minY = std::max(0, static_cast<int32_t>(std::ceil(minY - 0.5f)));
+    t.maxX = std::min(static_cast<int32_t>(mWidth)  - 1, static_cast<int32_t>(std::floor(maxX - 0.5f)));
+    t.maxY = std::min(static_cast<int32_t>(mHeight) - 1, static_cast<int32_t>(std::floor(maxY - 0.5f)));
+    if (t.minX > t.maxX || t.minY > t.maxY) return;
+
+    for (int k = 0; k < 3; k++) {
+        const glm::vec3& a = s[k];
+        const glm::vec3& b = s[(k + 1) % 3];
+        t.edgeA[k] = a.y - b.y;
+        t.edgeB[k] = b.x - a.x;
+        t.edgeC[k] = a.x * b.y - a.y * b.x + 0.5f * (t.edgeA[k] + t.edgeB[k]);
+    }
+
+    // NDC depth is affine in screen space. Evaluated at the center, then pushed to the
+    // farthest value the plane takes inside the pixel, so partial slopes stay conservative.
+    float dz1 = s[1].z - s[0].z, dz2 = s[2].z - s[0].z;
+    float dx1 = s[1].x - s[0].x, dx2 = s[2].x - s[0].x;
+    float dy1 = s[1].y - s[0].y, dy2 = s[2].y - s[0].y;
+    t.zA   = (dz1 * dy2 - dz2 * dy1) / area;
+    t.zB   = (dz2 * dx1 - dz1 * dx2) / area;
+    t.zC   = s[0].z - t.zA * s[0].x - t.zB * s[0].y
+           + 0.5f * (t.zA + t.zB) + 0.5f * (std::abs(t.zA) + std::abs(t.zB));
+    t.zMax = std::min(std::max({s[0].z, s[1].z, s[2].z}), 1.0f);
+
+    out.push_back(t);
+}
+
+void SoftwareOcclusion::SetupOccluder(const Object& obj, std::vector<Triangle>& out) const {
+    out.clear();
+    const OccluderMesh& mesh = mMeshes[obj.meshIndex];
+
+    // Per vertex, so shared vertices are divided once; only valid without OUT_NEAR/OUT_GUARD
+    thread_local std::vector<glm::vec4> clipPos;
+    thread_local std::vector<glm::vec3> screenPos;
+    thread_local std::vector<uint32_t>  outCodes;
+    clipPos.resize(mesh.positions.size());
+    screenPos.resize(mesh.positions.size());
+    outCodes.resize(mesh.positions.size());
+    for (size_t i = 0; i < mesh.positions.size(); i++) {
+        clipPos[i]  = obj.mvp * glm::vec4(mesh.positions[i], 1.0f);
+        outCodes[i] = ComputeOutCode(clipPos[i]);
+        if (!(outCodes[i] & (OUT_NEAR | OUT_GUARD)))
+            screenPos[i] = ToScreen(clipPos[i]);
+    }
+
+    for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+        uint32_t i0 = mesh.indices[i], i1 = mesh.indices[i + 1], i2 = mesh.indices[i + 2];
+        uint32_t codeAnd = outCodes[i0] & outCodes[i1] & outCodes[i2];
+        uint32_t codeOr  = outCodes[i0] | outCodes[i1] | outCodes[i2];
+        if (codeAnd & ~OUT_GUARD) continue;
+
+        if (!(codeOr & (OUT_NEAR | OUT_GUARD))) {
+            EmitTriangle(screenPos[i0], screenPos[i1], screenPos[i2], out);
+            continue;
+        }
+
+        // 3 vertices + at most one more per plane
+        glm::vec4 bufA[8] = {clipPos[i0], clipPos[i1], clipPos[i2]};
+        glm::vec4 bufB[8];
+        glm::vec4* src = bufA;
+        glm::vec4* dst = bufB;
+        uint32_t n = 3;
+        for (const auto& plane : CLIP_PLANES) {
+            n = ClipPolygon(src, n, plane, dst);
+            std::swap(src, dst);
+            if (n < 3) break;
+        }
+        if (n < 3) continue;
+        glm::vec3 first = ToScreen(src[0]);
+        glm::vec3 prev  = ToScreen(src[1]);
+        for (uint32_t k = 2; k < n; k++) {
+            glm::vec3 next = ToScreen(src[k]);
+            EmitTriangle(first, prev, next, out);
+            prev = next;
+        }
+    }
+}
+
+// -----------------------------------------------------------------------
+// Rasterize and test
+// -----------------------------------------------------------------------
+
+void SoftwareOcclusion::RasterizeBand(uint32_t tileRowBegin, uint32_t tileRowEnd) {
+    int32_t y0 = static_cast<int32_t>(tileRowBegin * TILE_HEIGHT);
+    int32_t y1 = static_cast<int32_t>(tileRowEnd * TILE_HEIGHT) - 1;
+    std::fill(mDepth.begin() + static_cast<size_t>(y0) * mWidth,
+              mDepth.begin() + static_cast<size_t>(y1 + 1) * mWidth, 1.0f);
+
+    for (size_t o = 0; o < mOccluders.size(); o++) {
+        for (const Triangle& t : mTriangles[o]) {
+            int32_t ya = std::max(t.minY, y0);
+            int32_t yb = std::min(t.maxY, y1);
+            if (ya > yb) continue;
+#if defined(VRB_SWOC_X86)
+            if (UsesAVX2()) {
+                RasterizeAVX2(t, mDepth.data(), mWidth, ya, yb);
+                continue;
+            }
+#endif
+            RasterizeScalar(t, mDepth.data(), mWidth, ya, yb);
+        }
+    }
+
+    for (uint32_t ty = tileRowBegin; ty < tileRowEnd; ty++) {
+        for (uint32_t tx = 0; tx < mTilesX; tx++) {
+            float farthest = 0.0f;
+            for (uint32_t y = 0; y < TILE_HEIGHT; y++) {
+                const float* row = &mDepth[static_cast<size_t>(ty * TILE_HEIGHT + y) * mWidth + tx * TILE_WIDTH];
+                for (uint32_t x = 0; x < TILE_WIDTH; x++)
+                    farthest = std::max(farthest, row[x]);
+            }
+            mTileMax[ty * mTilesX + tx] = farthest;
+        }
+    }
+}
+
+bool SoftwareOcclusion::TestObject(const Object& obj) const {
+    if (obj.crossesNear) return true;
+
+    int32_t x0 = std::max(0, static_cast<int32_t>(std::floor(obj.rectMin.x)));
+    int32_t y0 = std::max(0, static_cast<int32_t>(std::floor(obj.rectMin.y)));
+    int32_t x1 = std::min(static_cast<int32_t>(mWidth)  - 1, static_cast<int32_t>(std::floor(obj.rectMax.x)));
+    int32_t y1 = std::min(static_cast<int32_t>(mHeight) - 1, static_cast<int32_t>(std::floor(obj.rectMax.y)));
+    if (x0 > x1 || y0 > y1) return true;   // sliver outside the buffer, leave it to the GPU
+
+    const float z = obj.nearestZ;
+    for (int32_t ty = y0 / int32_t(TILE_HEIGHT); ty <= y1 / int32_t(TILE_HEIGHT); ty++) {
+        for (int32_t tx = x0 / int32_t(TILE_WIDTH); tx <= x1 / int32_t(TILE_WIDTH); tx++) {
+            // Behind the farthest occluder depth in the tile: hidden everywhere in it
+            if (z > mTileMax[ty * mTilesX + tx]) continue;
+
+            int32_t py0 = std::max(y0, ty * int32_t(TILE_HEIGHT));
+            int32_t py1 = std::min(y1, ty * int32_t(TILE_HEIGHT) + int32_t(TILE_HEIGHT) - 1);
+            int32_t px0 = std::max(x0, tx * int32_t(TILE_WIDTH));
+            int32_t px1 = std::min(x1, tx * int32_t(TILE_WIDTH) + int32_t(TILE_WIDTH) - 1);
+            for (int32_t y = py0; y <= py1; y++) {
+                const float* row = &mDepth[static_cast<size_t>(y) * mWidth];
+                for (int32_t x = px0; x <= px1; x++)
+                    if (z <= row[x]) return true;
+            }
+        }
+    }
+    return false;
+}
+
+void SoftwareOcclusion::Cull(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds,
+                             const glm::mat4& viewProj, ThreadPool* pool,
+                             const std::vector<uint8_t>* frustumMask) {
+    using Clock = std::chrono::steady_clock;
+    auto start = Clock::now();
+
+    mObjects.clear();
+    Entity entityEnd = 0;
+    registry.ForEachRenderable([&](Entity e, const TransformComponent& tc,
+                                   const MeshComponent& mc, const MaterialComponent&) {
+        if (mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
+        Object obj{};
+        obj.entity    = e;
+        obj.meshIndex = mc.meshIndex;
+        obj.mvp       = viewProj * tc.worldMatrix;
+        obj.bounds    = drawCmds[mc.meshIndex].bounds;
+        obj.inFrustum = !frustumMask || e >= frustumMask->size() || (*frustumMask)[e] != 0;
+        mObjects.push_back(obj);
+        entityEnd = std::max(entityEnd, e + 1);
+    });
+    mVisibility.assign(entityEnd, 1);
+
+    const uint32_t objectCount = static_cast<uint32_t>(mObjects.size());
+    ParallelForChunks(pool, objectCount, ParallelChunkCount(pool, objectCount, 256),
+                      [this](uint32_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            if (mObjects[i].inFrustum) ProjectObject(mObjects[i]);
+    });
+
+    // --- Occluders: largest on screen first, within the triangle budget ---
+    std::vector<uint32_t> candidates;
+    for (uint32_t i = 0; i < objectCount; i++) {
+        const Object& obj = mObjects[i];
+        if (!obj.inFrustum || obj.screenArea < mSettings.minOccluderArea) continue;
+        if (obj.meshIndex >= static_cast<int>(mMeshes.size()) || mMeshes[obj.meshIndex].indices.empty()) continue;
+        candidates.push_back(i);
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [this](uint32_t a, uint32_t b) {
+        return mObjects[a].screenArea > mObjects[b].screenArea;
+    });
+
+    mOccluders.clear();
+    uint64_t budget = mSettings.maxOccluderTriangles;
+    for (uint32_t i : candidates) {
+        if (mOccluders.size() >= mSettings.maxOccluders) break;
+        uint64_t tris = mMeshes[mObjects[i].meshIndex].indices.size() / 3;
+        if (tris > budget) continue;
+        budget -= tris;
+        mOccluders.push_back(i);
+    }
+    if (mTriangles.size() < mOccluders.size())
+        mTriangles.resize(mOccluders.size());
+
+    const uint32_t occluderCount = static_cast<uint32_t>(mOccluders.size());
+    ParallelForChunks(pool, occluderCount, ParallelChunkCount(pool, occluderCount),
+                      [this](uint32_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++)
+            SetupOccluder(mObjects[mOccluders[i]], mTriangles[i]);
+    });
+
+    uint64_t triangles = 0;
+    for (uint32_t i = 0; i < occluderCount; i++)
+        triangles += mTriangles[i].size();
+
+    ParallelForChunks(pool, mTilesY, ParallelChunkCount(pool, mTilesY),
+                      [this](uint32_t, size_t begin, size_t end) {
+        RasterizeBand(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+    });
+    auto rasterEnd = Clock::now();
+
+    // --- Test every object ---
+    const bool anyOccluder = triangles > 0;
+    ParallelForChunks(pool, objectCount, ParallelChunkCount(pool, objectCount, 256),
+                      [this, anyOccluder](uint32_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const Object& obj = mObjects[i];
+            bool visible = obj.inFrustum && (!anyOccluder || TestObject(obj));
+            mVisibility[obj.entity] = visible ? 1 : 0;
+        }
+    });
+
+    uint32_t frustumCulled = 0, occlusionCulled = 0;
+    for (const Object& obj : mObjects) {
+        if (!obj.inFrustum)                frustumCulled++;
+        else if (!mVisibility[obj.entity]) occlusionCulled++;
+    }
+
+    auto end = Clock::now();
+    mStats.frames++;
+    mStats.objects           += objectCount;
+    mStats.frustumCulled     += frustumCulled;
+    mStats.occlusionCulled   += occlusionCulled;
+    mStats.occluders         += occluderCount;
+    mStats.occluderTriangles += triangles;
+    mStats.rasterMs += std::chrono::duration<double, std::milli>(rasterEnd - start).count();
+    mStats.testMs   += std::chrono::duration<double, std::milli>(end - rasterEnd).count();
+    mStats.totalMs  += std::chrono::duration<double, std::milli>(end - start).count();
+}
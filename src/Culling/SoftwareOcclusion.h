@@ -0,0 +1,132 @@
+#pragma once
+
+#include "GPU/MeshPool.h"
+#include "Asset/ModelLoader.h"
+#include "Scene/ECS.h"
+#include "Math/AABB.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/// Accumulated over Cull() calls until ResetStats().
+struct SoftwareOcclusionStats {
+    uint64_t frames            = 0;
+    uint64_t objects           = 0;
+    uint64_t frustumCulled     = 0;
+    uint64_t occlusionCulled   = 0;
+    uint64_t occluders         = 0;
+    uint64_t occluderTriangles = 0;   // after back-face rejection and clipping
+    double   rasterMs          = 0.0; // projection, occluder setup and rasterization
+    double   testMs            = 0.0; // object bounds against the depth buffer
+    double   totalMs           = 0.0;
+
+    double CulledFraction() const {
+        return objects ? double(frustumCulled + occlusionCulled) / double(objects) : 0.0;
+    }
+    double OcclusionFraction() const { return objects ? double(occlusionCulled) / double(objects) : 0.0; }
+    double AvgMs()       const { return frames ? totalMs  / double(frames) : 0.0; }
+    double AvgRasterMs() const { return frames ? rasterMs / double(frames) : 0.0; }
+    double AvgTestMs()   const { return frames ? testMs   / double(frames) : 0.0; }
+};
+
+/// CPU occlusion culling for the non-GPU-driven path, after masked occlusion culling:
+/// the largest on-screen meshes are rasterized into a small depth buffer, then every
+/// renderable's bounds are tested against it. Depth is kept per pixel plus a max per
+/// 8x4 tile, so most rejected objects only touch the tile level. Rasterization runs in
+/// horizontal bands and the tests in object chunks, both spread over a ThreadPool.
+/// Uses AVX2 (8 pixels per step) when the CPU has it, a scalar loop otherwise.
+class SoftwareOcclusion {
+public:
+    static constexpr uint32_t TILE_WIDTH  = 8;
+    static constexpr uint32_t TILE_HEIGHT = 4;
+
+    struct Settings {
+        uint32_t maxOccluders         = 64;
+        uint32_t maxOccluderTriangles = 100000;  // per frame, over all occluders
+        float    minOccluderArea      = 0.01f;   // fraction of the screen the bounds cover
+        bool     allowAVX2            = true;    // false: scalar rasterizer even on AVX2 CPUs
+    };
+
+    /// Buffer size is rounded up to whole tiles.
+    void Initialize(uint32_t width = 256, uint32_t height = 128);
+
+    /// Keeps positions and indices of every mesh, indexed like MeshComponent::meshIndex.
+    void SetMeshes(const std::vector<MeshData>& meshes);
+
+    /// Renders occluders and tests every renderable. pool may be null or empty.
+    /// frustumMask (per Entity, 0 = outside) skips objects already frustum-culled.
+    void Cull(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds,
+              const glm::mat4& viewProj, ThreadPool* pool,
+              const std::vector<uint8_t>* frustumMask = nullptr);
+
+    /// Indexed by Entity; entities past the end (created after Cull) count as visible.
+    const std::vector<uint8_t>& GetVisibility() const { return mVisibility; }
+    bool IsVisible(Entity e) const { return e >= mVisibility.size() || mVisibility[e] != 0; }
+
+    const float* GetDepth()  const { return mDepth.data(); }
+    uint32_t     GetWidth()  const { return mWidth; }
+    uint32_t     GetHeight() const { return mHeight; }
+    bool         UsesAVX2()  const { return mAVX2 && mSettings.allowAVX2; }
+    bool         HasAVX2()   const { return mAVX2; }
+
+    Settings&       GetSettings()       { return mSettings; }
+    const Settings& GetSettings() const { return mSettings; }
+
+    const SoftwareOcclusionStats& GetStats() const { return mStats; }
+    void ResetStats() { mStats = {}; }
+
+    /// Screen-space triangle ready for rasterization: edge functions and depth plane are
+    /// in pixel units, evaluated at pixel centers.
+    struct Triangle {
+        float    edgeA[3], edgeB[3], edgeC[3];
+        float    zA, zB, zC;
+        float    zMax;
+        int32_t  minX, minY, maxX, maxY;   // inclusive pixel bounds, clamped to the buffer
+    };
+
+private:
+    struct OccluderMesh {
+        std::vector<glm::vec3> positions;
+        std::vector<uint32_t>  indices;
+    };
+
+    struct Object {
+        Entity    entity;
+        int       meshIndex;
+        glm::mat4 mvp;
+        AABB      bounds;             // mesh-local
+        glm::vec2 rectMin, rectMax;   // pixels
+        float     nearestZ;
+        float     screenArea;         // fraction of the buffer
+        bool      inFrustum;
+        bool      crossesNear;        // no usable screen rect: never occlusion-culled
+    };
+
+    void ProjectObject(Object& obj) const;
+    void SetupOccluder(const Object& obj, std::vector<Triangle>& out) const;
+    glm::vec3 ToScreen(const glm::vec4& clip) const;
+    void EmitTriangle(const glm::vec3& s0, const glm::vec3& s1, const glm::vec3& s2,
+                      std::vector<Triangle>& out) const;
+    void RasterizeBand(uint32_t tileRowBegin, uint32_t tileRowEnd);
+    bool TestObject(const Object& obj) const;
+
+    Settings mSettings;
+    uint32_t mWidth       = 0;
+    uint32_t mHeight      = 0;
+    uint32_t mTilesX      = 0;
+    uint32_t mTilesY      = 0;
+    bool     mAVX2        = false;
+
+    std::vector<OccluderMesh>          mMeshes;
+    std::vector<float>                 mDepth;      // NDC depth, 1 = far
+    std::vector<float>                 mTileMax;    // farthest depth in each tile
+    std::vector<Object>                mObjects;
+    std::vector<uint32_t>              mOccluders;  // into mObjects
+    std::vector<std::vector<Triangle>> mTriangles;  // one list per occluder, never shrunk
+    std::vector<uint8_t>               mVisibility;
+
+    SoftwareOcclusionStats mStats;
+};
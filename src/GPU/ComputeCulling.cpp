@@ -1,35 +1,49 @@
 #include "GPU/ComputeCulling.h"
+#include "GPU/MeshPool.h"
 #include "Resource/ShaderManager.h"
 #include "Core/Logger.h"
 #include "RHI/VulkanUtils.h"
 
+#include <algorithm>
 #include <cstring>
 
 static constexpr VkBufferUsageFlags kIndirectBufUsage =
     VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
 static constexpr VkBufferUsageFlags kCountBufUsage =
     VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-void ComputeCulling::Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders) {
-    mDevice    = device;
-    mAllocator = allocator;
-
-    // --- Frustum cull descriptor set layout (Set A) ---
+// One counter per index class; output lists are split at CullParams::uint32ClassBase
+static constexpr VkDeviceSize kCountBufSize = INDEX_CLASS_COUNT * sizeof(uint32_t);
+// Occluder and visible lists: opaque counts, then the masked half's at MASKED_COUNT_OFFSET
+static constexpr VkDeviceSize kListCountSize = ComputeCulling::MASKED_COUNT_OFFSET + kCountBufSize;
+static constexpr VkDeviceSize kStatsSize    = CULL_STAT_COUNT * sizeof(uint32_t);
+
+void ComputeCulling::Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders,
+                                uint32_t framesInFlight) {
+    mDevice         = device;
+    mAllocator      = allocator;
+    mFramesInFlight = framesInFlight;
+    mFrameCount     = 0;
+
+    // --- Phase one (frustum + previous Hi-Z) descriptor set layout (Set A) ---
     // 0: CullParams UBO, 1: srcIndirect, 2: objectSSBO,
-    // 3: occluderIndirect, 4: occluderCount, 5: candidateIndirect, 6: candidateCount
+    // 3: occluderIndirect, 4: occluderCount, 5: visibility,
+    // 6: clusters, 7: meshlets, 8: Hi-Z sampler, 9: stats, 10: mesh LODs,
+    // 11: transparent scratch, 12: transparent keys, 13: transparent count,
+    // 14: group commands, 15: instance list, 16: slot groups
     {
-        VkDescriptorSetLayoutBinding bindings[7]{};
-        for (uint32_t i = 0; i < 7; i++) {
+        VkDescriptorSetLayoutBinding bindings[17]{};
+        for (uint32_t i = 0; i < 17; i++) {
             bindings[i].binding         = i;
             bindings[i].descriptorCount = 1;
             bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
             bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
         }
         bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        bindings[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
 
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 7;
+        layoutInfo.bindingCount = 17;
         layoutInfo.pBindings    = bindings;
         VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mFrustumDescSetLayout));
 
@@ -50,12 +64,15 @@ void ComputeCulling::Initialize(VkDevice device, VmaAllocator allocator, ShaderM
         VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compInfo, nullptr, &mFrustumPipeline));
     }
 
-    // --- Occlusion test descriptor set layout (Set B) ---
-    // 0: CullParams UBO, 1: candidateIndirect, 2: objectSSBO,
-    // 3: visibleIndirect, 4: visibleCount, 5: Hi-Z sampler, 6: candidateCount
+    // --- Phase two (occlusion test) descriptor set layout (Set B) ---
+    // 0: CullParams UBO, 1: srcIndirect, 2: objectSSBO,
+    // 3: visibleIndirect, 4: visibleCount, 5: Hi-Z sampler, 6: visibility,
+    // 7: clusters, 8: meshlets, 9: stats, 10: mesh LODs,
+    // 11: transparent scratch, 12: transparent keys, 13: transparent count,
+    // 14: group commands, 15: instance list, 16: slot groups
     {
-        VkDescriptorSetLayoutBinding bindings[7]{};
-        for (uint32_t i = 0; i < 7; i++) {
+        VkDescriptorSetLayoutBinding bindings[17]{};
+        for (uint32_t i = 0; i < 17; i++) {
             bindings[i].binding         = i;
             bindings[i].descriptorCount = 1;
             bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
@@ -66,7 +83,7 @@ void ComputeCulling::Initialize(VkDevice device, VmaAllocator allocator, ShaderM
 
         VkDescriptorSetLayoutCreateInfo layoutInfo{};
         layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layoutInfo.bindingCount = 7;
+        layoutInfo.bindingCount = 17;
         layoutInfo.pBindings    = bindings;
         VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mOcclusionDescSetLayout));
 
@@ -87,19 +104,123 @@ void ComputeCulling::Initialize(VkDevice device, VmaAllocator allocator, ShaderM
         VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compInfo, nullptr, &mOcclusionPipeline));
     }
 
-    mParamsUBO.CreateHostVisible(allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(CullParams));
+    // --- Shadow cull descriptor set layout (Set C) ---
+    // 0: ShadowCullParams UBO, 1: srcIndirect, 2: objectSSBO, 3: shadowIndirect, 4: shadowCount
+    {
+        VkDescriptorSetLayoutBinding bindings[5]{};
+        for (uint32_t i = 0; i < 5; i++) {
+            bindings[i].binding         = i;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+            bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+        bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 5;
+        layoutInfo.pBindings    = bindings;
+        VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mShadowDescSetLayout));
+
+        VkPipelineLayoutCreateInfo pipeLayoutInfo{};
+        pipeLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeLayoutInfo.setLayoutCount = 1;
+        pipeLayoutInfo.pSetLayouts    = &mShadowDescSetLayout;
+        VK_CHECK(vkCreatePipelineLayout(device, &pipeLayoutInfo, nullptr, &mShadowPipelineLayout));
+
+        VkShaderModule compModule = shaders.GetOrLoad("shaders/cull_shadow.comp.spv");
+        VkComputePipelineCreateInfo compInfo{};
+        compInfo.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        compInfo.stage.sType        = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        compInfo.stage.stage        = VK_SHADER_STAGE_COMPUTE_BIT;
+        compInfo.stage.module       = compModule;
+        compInfo.stage.pName        = "main";
+        compInfo.layout             = mShadowPipelineLayout;
+        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compInfo, nullptr, &mShadowPipeline));
+    }
+
+    // --- Transparent sort descriptor set layout (Set D) ---
+    // 0: transparent keys, 1: transparent scratch, 2: transparent count, 3: transparent indirect
+    {
+        VkDescriptorSetLayoutBinding bindings[4]{};
+        for (uint32_t i = 0; i < 4; i++) {
+            bindings[i].binding         = i;
+            bindings[i].descriptorCount = 1;
+            bindings[i].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+            bindings[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        }
+
+        VkDescriptorSetLayoutCreateInfo layoutInfo{};
+        layoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        layoutInfo.bindingCount = 4;
+        layoutInfo.pBindings    = bindings;
+        VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mSortDescSetLayout));
 
-    LOG_INFO("ComputeCulling initialized (two-pass)");
+        VkPushConstantRange pushRange{};
+        pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        pushRange.size       = sizeof(uint32_t);   // uint32ClassBase
+
+        VkPipelineLayoutCreateInfo pipeLayoutInfo{};
+        pipeLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeLayoutInfo.setLayoutCount         = 1;
+        pipeLayoutInfo.pSetLayouts            = &mSortDescSetLayout;
+        pipeLayoutInfo.pushConstantRangeCount = 1;
+        pipeLayoutInfo.pPushConstantRanges    = &pushRange;
+        VK_CHECK(vkCreatePipelineLayout(device, &pipeLayoutInfo, nullptr, &mSortPipelineLayout));
+
+        VkShaderModule compModule = shaders.GetOrLoad("shaders/sort_transparent.comp.spv");
+        VkComputePipelineCreateInfo compInfo{};
+        compInfo.sType              = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        compInfo.stage.sType        = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        compInfo.stage.stage        = VK_SHADER_STAGE_COMPUTE_BIT;
+        compInfo.stage.module       = compModule;
+        compInfo.stage.pName        = "main";
+        compInfo.layout             = mSortPipelineLayout;
+        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compInfo, nullptr, &mSortPipeline));
+    }
+
+    mParamsUBO.CreateHostVisible(allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(CullParams));
+    mShadowParamsUBO.CreateHostVisible(allocator, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, sizeof(ShadowCullParams));
+
+    mStatsBuffer.CreateDeviceLocalEmpty(allocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        kStatsSize);
+    mStatsReadback.resize(framesInFlight);
+    for (auto& rb : mStatsReadback)
+        rb.CreateReadback(allocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT, kStatsSize);
+    mStatsPending.assign(framesInFlight, 0);
+    mStatsFrame = 0;
+    mStats      = {};
+
+    LOG_INFO("ComputeCulling initialized (two-phase)");
 }
 
 void ComputeCulling::Shutdown(VkDevice device, VmaAllocator allocator) {
+    ReleaseRetired(true);
     mOccluderIndirectBuffer.Destroy(allocator);
     mOccluderCountBuffer.Destroy(allocator);
-    mCandidateIndirectBuffer.Destroy(allocator);
-    mCandidateCountBuffer.Destroy(allocator);
     mVisibleIndirectBuffer.Destroy(allocator);
     mVisibleCountBuffer.Destroy(allocator);
+    mTransparentScratchBuffer.Destroy(allocator);
+    mTransparentKeyBuffer.Destroy(allocator);
+    mTransparentIndirectBuffer.Destroy(allocator);
+    mTransparentCountBuffer.Destroy(allocator);
+    mVisibilityBuffer.Destroy(allocator);
+    mStatsBuffer.Destroy(allocator);
+    for (auto& rb : mStatsReadback) rb.Destroy(allocator);
+    mStatsReadback.clear();
+    mStatsPending.clear();
     mParamsUBO.Destroy(allocator);
+    mShadowIndirectBuffer.Destroy(allocator);
+    mShadowCountBuffer.Destroy(allocator);
+    mShadowParamsUBO.Destroy(allocator);
+    mGroupIndirectBuffer.Destroy(allocator);
+    mInstanceBuffer.Destroy(allocator);
+    mMaxDrawCount     = 0;
+    mShadowListStride = 0;
+    mGroupSrcBuffer   = VK_NULL_HANDLE;
+    mGroupSize        = 0;
+    mInstanceCapacity = 0;
 
     if (mDescPool)                { vkDestroyDescriptorPool(device, mDescPool, nullptr);               mDescPool = VK_NULL_HANDLE; }
     if (mFrustumPipeline)         { vkDestroyPipeline(device, mFrustumPipeline, nullptr);              mFrustumPipeline = VK_NULL_HANDLE; }
@@ -108,74 +229,248 @@ void ComputeCulling::Shutdown(VkDevice device, VmaAllocator allocator) {
     if (mOcclusionPipeline)       { vkDestroyPipeline(device, mOcclusionPipeline, nullptr);            mOcclusionPipeline = VK_NULL_HANDLE; }
     if (mOcclusionPipelineLayout) { vkDestroyPipelineLayout(device, mOcclusionPipelineLayout, nullptr); mOcclusionPipelineLayout = VK_NULL_HANDLE; }
     if (mOcclusionDescSetLayout)  { vkDestroyDescriptorSetLayout(device, mOcclusionDescSetLayout, nullptr); mOcclusionDescSetLayout = VK_NULL_HANDLE; }
+    if (mShadowPipeline)          { vkDestroyPipeline(device, mShadowPipeline, nullptr);               mShadowPipeline = VK_NULL_HANDLE; }
+    if (mShadowPipelineLayout)    { vkDestroyPipelineLayout(device, mShadowPipelineLayout, nullptr);   mShadowPipelineLayout = VK_NULL_HANDLE; }
+    if (mShadowDescSetLayout)     { vkDestroyDescriptorSetLayout(device, mShadowDescSetLayout, nullptr); mShadowDescSetLayout = VK_NULL_HANDLE; }
+    if (mSortPipeline)            { vkDestroyPipeline(device, mSortPipeline, nullptr);                 mSortPipeline = VK_NULL_HANDLE; }
+    if (mSortPipelineLayout)      { vkDestroyPipelineLayout(device, mSortPipelineLayout, nullptr);     mSortPipelineLayout = VK_NULL_HANDLE; }
+    if (mSortDescSetLayout)       { vkDestroyDescriptorSetLayout(device, mSortDescSetLayout, nullptr); mSortDescSetLayout = VK_NULL_HANDLE; }
+}
+
+VkDeviceSize ComputeCulling::GetShadowCountStride() const {
+    return kCountBufSize;
+}
+
+void ComputeCulling::BeginFrame(uint32_t frameIndex) {
+    mFrameCount++;
+    ReleaseRetired(false);
+
+    mStatsFrame = frameIndex;
+    if (frameIndex >= mStatsPending.size() || !mStatsPending[frameIndex]) return;
+    mStatsPending[frameIndex] = 0;
+
+    const VulkanBuffer& rb = mStatsReadback[frameIndex];
+    rb.Invalidate(mAllocator);
+    const uint32_t* c = static_cast<const uint32_t*>(rb.GetMappedData());
+
+    mStats.frames++;
+    mStats.frustumDraws += c[CULL_STAT_FRUSTUM_DRAWS];
+    mStats.frustumTris  += c[CULL_STAT_FRUSTUM_TRIS];
+    mStats.phase1Draws  += c[CULL_STAT_PHASE1_DRAWS];
+    mStats.phase1Tris   += c[CULL_STAT_PHASE1_TRIS];
+    mStats.phase2Draws  += c[CULL_STAT_PHASE2_DRAWS];
+    mStats.phase2Tris   += c[CULL_STAT_PHASE2_TRIS];
+    mStats.lod0Tris     += c[CULL_STAT_LOD0_TRIS];
+    mStats.maskedDraws  += c[CULL_STAT_MASKED_DRAWS];
+    mStats.transparentDraws += c[CULL_STAT_TRANSPARENT_DRAWS];
+    mStats.instancedDraws   += c[CULL_STAT_INSTANCED_DRAWS];
+    mStats.instances        += c[CULL_STAT_INSTANCES];
+}
+
+// Called by whichever culling dispatch fills the transparent list last this frame.
+// One workgroup per index class sorts the first TRANSPARENT_SORT_MAX keys and
+// gathers the draws back to front; sort_transparent.comp copies any overflow as is.
+void ComputeCulling::RecordTransparentSort(VkCommandBuffer cmd, const CullParams& params) const {
+    VkMemoryBarrier2 listBarrier{};
+    listBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    listBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    listBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    listBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    listBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+
+    VkDependencyInfo dep{};
+    dep.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &listBarrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mSortPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            mSortPipelineLayout, 0, 1, &mSortDescSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mSortPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(uint32_t), &params.uint32ClassBase);
+    vkCmdDispatch(cmd, INDEX_CLASS_COUNT, 1, 1);
+
+    VkMemoryBarrier2 drawBarrier{};
+    drawBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    drawBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    drawBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    drawBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    drawBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+
+    dep.pMemoryBarriers = &drawBarrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+// Called by whichever culling dispatch writes the stats last this frame
+void ComputeCulling::RecordStatsReadback(VkCommandBuffer cmd) const {
+    VkMemoryBarrier2 toCopy{};
+    toCopy.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    toCopy.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    toCopy.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    toCopy.dstStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    toCopy.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+
+    VkDependencyInfo dep{};
+    dep.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &toCopy;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    VkBufferCopy region{0, 0, kStatsSize};
+    vkCmdCopyBuffer(cmd, mStatsBuffer.GetHandle(), mStatsReadback[mStatsFrame].GetHandle(), 1, &region);
+
+    VkMemoryBarrier2 toHost{};
+    toHost.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    toHost.srcStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    toHost.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    toHost.dstStageMask  = VK_PIPELINE_STAGE_2_HOST_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT;   // next frame's reset waits too
+    toHost.dstAccessMask = VK_ACCESS_2_HOST_READ_BIT;
+
+    dep.pMemoryBarriers = &toHost;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    mStatsPending[mStatsFrame] = 1;
+}
+
+void ComputeCulling::ReleaseRetired(bool all) {
+    auto done = std::remove_if(mRetired.begin(), mRetired.end(), [&](RetiredResources& r) {
+        if (!all && r.retireAt > mFrameCount) return false;
+        for (VulkanBuffer& b : r.buffers) b.Destroy(mAllocator);
+        if (r.pool) vkDestroyDescriptorPool(mDevice, r.pool, nullptr);
+        return true;
+    });
+    mRetired.erase(done, mRetired.end());
 }
 
 void ComputeCulling::UpdateBuffers(VmaAllocator allocator,
                                    VkBuffer srcIndirectBuffer, uint32_t drawCount,
                                    VkBuffer objectBuffer,
+                                   VkBuffer clusterBuffer, uint32_t clusterCount,
+                                   VkBuffer meshletBuffer, VkBuffer lodBuffer,
+                                   VkBuffer groupBuffer, uint32_t groupCapacity,
+                                   VkBuffer slotGroupBuffer, uint32_t instanceCapacity,
                                    VkImageView hiZView, VkSampler hiZSampler)
 {
-    if (drawCount != mMaxDrawCount) {
-        mOccluderIndirectBuffer.Destroy(allocator);
-        mOccluderCountBuffer.Destroy(allocator);
-        mCandidateIndirectBuffer.Destroy(allocator);
-        mCandidateCountBuffer.Destroy(allocator);
-        mVisibleIndirectBuffer.Destroy(allocator);
-        mVisibleCountBuffer.Destroy(allocator);
-
-        VkDeviceSize cmdSize = drawCount * sizeof(VkDrawIndexedIndirectCommand);
-        mOccluderIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, cmdSize);
-        mOccluderCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, sizeof(uint32_t));
-        mCandidateIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, cmdSize);
-        mCandidateCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, sizeof(uint32_t));
-        mVisibleIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, cmdSize);
-        mVisibleCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, sizeof(uint32_t));
-
-        mMaxDrawCount = drawCount;
+    // The previous frame may still read the old buffers and descriptor sets: keep them
+    // until its slot comes round again
+    RetiredResources retired;
+    retired.retireAt = mFrameCount + mFramesInFlight;
+    auto retire = [&](VulkanBuffer& buffer) {
+        if (buffer.GetHandle()) retired.buffers.push_back(buffer);
+        buffer = {};
+    };
+
+    const uint32_t capacity = std::max(drawCount, clusterCount);
+    if (capacity != mMaxDrawCount) {
+        for (VulkanBuffer* b : { &mOccluderIndirectBuffer, &mOccluderCountBuffer, &mVisibleIndirectBuffer,
+                                 &mVisibleCountBuffer, &mTransparentScratchBuffer, &mTransparentKeyBuffer,
+                                 &mTransparentIndirectBuffer, &mTransparentCountBuffer, &mVisibilityBuffer })
+            retire(*b);
+
+        // Occluder and visible lists hold the opaque items, then the masked ones
+        VkDeviceSize cmdSize = capacity * sizeof(VkDrawIndexedIndirectCommand);
+        mOccluderIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, 2 * cmdSize);
+        mOccluderCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, kListCountSize);
+        mVisibleIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, 2 * cmdSize);
+        mVisibleCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, kListCountSize);
+        mTransparentScratchBuffer.CreateDeviceLocalEmpty(allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, cmdSize);
+        mTransparentKeyBuffer.CreateDeviceLocalEmpty(allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                                     capacity * sizeof(uint32_t));
+        mTransparentIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, cmdSize);
+        mTransparentCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, kCountBufSize);
+        mVisibilityBuffer.CreateDeviceLocalEmpty(allocator,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            capacity * sizeof(uint32_t));
+
+        mMaxDrawCount    = capacity;
+        mClearVisibility = true;
+    }
+
+    if (drawCount != mShadowListStride) {
+        retire(mShadowIndirectBuffer);
+        retire(mShadowCountBuffer);
+
+        constexpr uint32_t CC = CascadedShadowMap::CASCADE_COUNT;
+        mShadowIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage,
+            VkDeviceSize(CC) * drawCount * sizeof(VkDrawIndexedIndirectCommand));
+        mShadowCountBuffer.CreateDeviceLocalEmpty(allocator, kCountBufUsage, CC * kCountBufSize);
+
+        mShadowListStride = drawCount;
     }
 
-    if (mDescPool) {
-        vkDestroyDescriptorPool(mDevice, mDescPool, nullptr);
-        mDescPool = VK_NULL_HANDLE;
+    // One copy of the group commands and one instance region per phase
+    const VkDeviceSize groupSize = VkDeviceSize(2) * groupCapacity * sizeof(VkDrawIndexedIndirectCommand);
+    if (groupSize != mGroupSize || instanceCapacity != mInstanceCapacity) {
+        retire(mGroupIndirectBuffer);
+        retire(mInstanceBuffer);
+
+        mGroupIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectBufUsage, groupSize);
+        mInstanceBuffer.CreateDeviceLocalEmpty(allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                               VkDeviceSize(2) * instanceCapacity * sizeof(uint32_t));
+        mGroupSize        = groupSize;
+        mInstanceCapacity = instanceCapacity;
     }
+    mGroupSrcBuffer = groupBuffer;
+
+    retired.pool = mDescPool;
+    mDescPool    = VK_NULL_HANDLE;
+    if (retired.pool || !retired.buffers.empty())
+        mRetired.push_back(std::move(retired));
 
     VkDescriptorPoolSize poolSizes[3]{};
-    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;         poolSizes[0].descriptorCount = 2;
-    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;         poolSizes[1].descriptorCount = 12;
-    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; poolSizes[2].descriptorCount = 1;
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;         poolSizes[0].descriptorCount = 3;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;         poolSizes[1].descriptorCount = 38;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; poolSizes[2].descriptorCount = 2;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.maxSets       = 2;
+    poolInfo.maxSets       = 4;
     poolInfo.poolSizeCount = 3;
     poolInfo.pPoolSizes    = poolSizes;
     VK_CHECK(vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescPool));
 
-    VkDescriptorSetLayout layouts[2] = { mFrustumDescSetLayout, mOcclusionDescSetLayout };
-    VkDescriptorSet sets[2]{};
+    VkDescriptorSetLayout layouts[4] = { mFrustumDescSetLayout, mOcclusionDescSetLayout, mShadowDescSetLayout,
+                                         mSortDescSetLayout };
+    VkDescriptorSet sets[4]{};
     VkDescriptorSetAllocateInfo allocInfo{};
     allocInfo.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
     allocInfo.descriptorPool     = mDescPool;
-    allocInfo.descriptorSetCount = 2;
+    allocInfo.descriptorSetCount = 4;
     allocInfo.pSetLayouts        = layouts;
     VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocInfo, sets));
     mFrustumDescSet  = sets[0];
     mOcclusionDescSet = sets[1];
+    mShadowDescSet    = sets[2];
+    mSortDescSet      = sets[3];
 
     VkDescriptorBufferInfo paramsInfo   { mParamsUBO.GetHandle(), 0, sizeof(CullParams) };
     VkDescriptorBufferInfo srcIndInfo   { srcIndirectBuffer, 0, VK_WHOLE_SIZE };
     VkDescriptorBufferInfo objInfo      { objectBuffer, 0, VK_WHOLE_SIZE };
     VkDescriptorBufferInfo occIndInfo   { mOccluderIndirectBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
-    VkDescriptorBufferInfo occCntInfo   { mOccluderCountBuffer.GetHandle(), 0, sizeof(uint32_t) };
-    VkDescriptorBufferInfo candIndInfo  { mCandidateIndirectBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
-    VkDescriptorBufferInfo candCntInfo  { mCandidateCountBuffer.GetHandle(), 0, sizeof(uint32_t) };
+    VkDescriptorBufferInfo occCntInfo   { mOccluderCountBuffer.GetHandle(), 0, kListCountSize };
     VkDescriptorBufferInfo visIndInfo   { mVisibleIndirectBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
-    VkDescriptorBufferInfo visCntInfo   { mVisibleCountBuffer.GetHandle(), 0, sizeof(uint32_t) };
+    VkDescriptorBufferInfo visCntInfo   { mVisibleCountBuffer.GetHandle(), 0, kListCountSize };
+    VkDescriptorBufferInfo clusterInfo  { clusterBuffer, 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo meshletInfo  { meshletBuffer, 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo visBitsInfo  { mVisibilityBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo statsInfo    { mStatsBuffer.GetHandle(), 0, kStatsSize };
+    VkDescriptorBufferInfo lodInfo      { lodBuffer, 0, VK_WHOLE_SIZE };
     VkDescriptorImageInfo  hizInfo      { hiZSampler, hiZView, VK_IMAGE_LAYOUT_GENERAL };
-
-    // --- Set A: frustum cull ---
-    VkWriteDescriptorSet writesA[7]{};
-    for (uint32_t i = 0; i < 7; i++) {
+    VkDescriptorBufferInfo shParamsInfo { mShadowParamsUBO.GetHandle(), 0, sizeof(ShadowCullParams) };
+    VkDescriptorBufferInfo shIndInfo    { mShadowIndirectBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo shCntInfo    { mShadowCountBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo trScrInfo    { mTransparentScratchBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo trKeyInfo    { mTransparentKeyBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo trIndInfo    { mTransparentIndirectBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo trCntInfo    { mTransparentCountBuffer.GetHandle(), 0, kCountBufSize };
+    VkDescriptorBufferInfo groupInfo    { mGroupIndirectBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo instInfo     { mInstanceBuffer.GetHandle(), 0, VK_WHOLE_SIZE };
+    VkDescriptorBufferInfo slotGrpInfo  { slotGroupBuffer, 0, VK_WHOLE_SIZE };
+
+    // --- Set A: phase one ---
+    VkWriteDescriptorSet writesA[17]{};
+    for (uint32_t i = 0; i < 17; i++) {
         writesA[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         writesA[i].dstSet          = mFrustumDescSet;
         writesA[i].dstBinding      = i;
@@ -187,13 +482,23 @@ void ComputeCulling::UpdateBuffers(VmaAllocator allocator,
     writesA[2].pBufferInfo = &objInfo;
     writesA[3].pBufferInfo = &occIndInfo;
     writesA[4].pBufferInfo = &occCntInfo;
-    writesA[5].pBufferInfo = &candIndInfo;
-    writesA[6].pBufferInfo = &candCntInfo;
-    vkUpdateDescriptorSets(mDevice, 7, writesA, 0, nullptr);
-
-    // --- Set B: occlusion test ---
-    VkWriteDescriptorSet writesB[7]{};
-    for (uint32_t i = 0; i < 7; i++) {
+    writesA[5].pBufferInfo = &visBitsInfo;
+    writesA[6].pBufferInfo = &clusterInfo;
+    writesA[7].pBufferInfo = &meshletInfo;
+    writesA[8].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; writesA[8].pImageInfo = &hizInfo;
+    writesA[9].pBufferInfo = &statsInfo;
+    writesA[10].pBufferInfo = &lodInfo;
+    writesA[11].pBufferInfo = &trScrInfo;
+    writesA[12].pBufferInfo = &trKeyInfo;
+    writesA[13].pBufferInfo = &trCntInfo;
+    writesA[14].pBufferInfo = &groupInfo;
+    writesA[15].pBufferInfo = &instInfo;
+    writesA[16].pBufferInfo = &slotGrpInfo;
+    vkUpdateDescriptorSets(mDevice, 17, writesA, 0, nullptr);
+
+    // --- Set B: phase two ---
+    VkWriteDescriptorSet writesB[17]{};
+    for (uint32_t i = 0; i < 17; i++) {
         writesB[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
         writesB[i].dstSet          = mOcclusionDescSet;
         writesB[i].dstBinding      = i;
@@ -201,34 +506,105 @@ void ComputeCulling::UpdateBuffers(VmaAllocator allocator,
         writesB[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
     }
     writesB[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;         writesB[0].pBufferInfo = &paramsInfo;
-    writesB[1].pBufferInfo = &candIndInfo;
+    writesB[1].pBufferInfo = &srcIndInfo;
     writesB[2].pBufferInfo = &objInfo;
     writesB[3].pBufferInfo = &visIndInfo;
     writesB[4].pBufferInfo = &visCntInfo;
     writesB[5].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER; writesB[5].pImageInfo  = &hizInfo;
-    writesB[6].pBufferInfo = &candCntInfo;
-    vkUpdateDescriptorSets(mDevice, 7, writesB, 0, nullptr);
+    writesB[6].pBufferInfo = &visBitsInfo;
+    writesB[7].pBufferInfo = &clusterInfo;
+    writesB[8].pBufferInfo = &meshletInfo;
+    writesB[9].pBufferInfo = &statsInfo;
+    writesB[10].pBufferInfo = &lodInfo;
+    writesB[11].pBufferInfo = &trScrInfo;
+    writesB[12].pBufferInfo = &trKeyInfo;
+    writesB[13].pBufferInfo = &trCntInfo;
+    writesB[14].pBufferInfo = &groupInfo;
+    writesB[15].pBufferInfo = &instInfo;
+    writesB[16].pBufferInfo = &slotGrpInfo;
+    vkUpdateDescriptorSets(mDevice, 17, writesB, 0, nullptr);
+
+    // --- Set C: shadow cascade cull ---
+    VkWriteDescriptorSet writesC[5]{};
+    for (uint32_t i = 0; i < 5; i++) {
+        writesC[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writesC[i].dstSet          = mShadowDescSet;
+        writesC[i].dstBinding      = i;
+        writesC[i].descriptorCount = 1;
+        writesC[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    }
+    writesC[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER; writesC[0].pBufferInfo = &shParamsInfo;
+    writesC[1].pBufferInfo = &srcIndInfo;
+    writesC[2].pBufferInfo = &objInfo;
+    writesC[3].pBufferInfo = &shIndInfo;
+    writesC[4].pBufferInfo = &shCntInfo;
+    vkUpdateDescriptorSets(mDevice, 5, writesC, 0, nullptr);
+
+    // --- Set D: transparent sort ---
+    VkWriteDescriptorSet writesD[4]{};
+    const VkDescriptorBufferInfo* sortInfos[4] = { &trKeyInfo, &trScrInfo, &trCntInfo, &trIndInfo };
+    for (uint32_t i = 0; i < 4; i++) {
+        writesD[i].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writesD[i].dstSet          = mSortDescSet;
+        writesD[i].dstBinding      = i;
+        writesD[i].descriptorCount = 1;
+        writesD[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writesD[i].pBufferInfo     = sortInfos[i];
+    }
+    vkUpdateDescriptorSets(mDevice, 4, writesD, 0, nullptr);
 }
 
 void ComputeCulling::DispatchFrustum(VkCommandBuffer cmd, const CullParams& params) const {
     if (mMaxDrawCount == 0) return;
 
-    std::memcpy(mParamsUBO.GetMappedData(), &params, sizeof(CullParams));
-
-    vkCmdFillBuffer(cmd, mOccluderCountBuffer.GetHandle(), 0, sizeof(uint32_t), 0);
-    vkCmdFillBuffer(cmd, mCandidateCountBuffer.GetHandle(), 0, sizeof(uint32_t), 0);
+    CullParams p = params;
+    p.maskedBase = GetMaskedListBase();
+    std::memcpy(mParamsUBO.GetMappedData(), &p, sizeof(CullParams));
+
+    // Both phases' group commands start from the scene's, with no instances. Last
+    // frame's draws read them, so the copy waits for those
+    if (mGroupSrcBuffer != VK_NULL_HANDLE) {
+        VkMemoryBarrier2 drawnBarrier{};
+        drawnBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        drawnBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+        drawnBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        drawnBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+        VkDependencyInfo drawnDep{};
+        drawnDep.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+        drawnDep.memoryBarrierCount = 1;
+        drawnDep.pMemoryBarriers    = &drawnBarrier;
+        vkCmdPipelineBarrier2(cmd, &drawnDep);
+
+        VkBufferCopy region{0, 0, mGroupSize};
+        vkCmdCopyBuffer(cmd, mGroupSrcBuffer, mGroupIndirectBuffer.GetHandle(), 1, &region);
+    }
+    vkCmdFillBuffer(cmd, mOccluderCountBuffer.GetHandle(), 0, kListCountSize, 0);
+    vkCmdFillBuffer(cmd, mTransparentCountBuffer.GetHandle(), 0, kCountBufSize, 0);
+    vkCmdFillBuffer(cmd, mStatsBuffer.GetHandle(), 0, kStatsSize, 0);
+    if (mClearVisibility) {
+        vkCmdFillBuffer(cmd, mVisibilityBuffer.GetHandle(), 0, VK_WHOLE_SIZE, 0);
+        mClearVisibility = false;
+    }
 
-    VkMemoryBarrier2 fillBarrier{};
-    fillBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
-    fillBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
-    fillBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-    fillBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-    fillBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    VkMemoryBarrier2 fillBarriers[2]{};
+    fillBarriers[0].sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    fillBarriers[0].srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    fillBarriers[0].srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    fillBarriers[0].dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    fillBarriers[0].dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    // Last frame's Hi-Z build and visibility writes (earlier in submission order)
+    fillBarriers[1].sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    fillBarriers[1].srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    fillBarriers[1].srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    fillBarriers[1].dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    fillBarriers[1].dstAccessMask = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                                    VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
 
     VkDependencyInfo dep{};
     dep.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
-    dep.memoryBarrierCount = 1;
-    dep.pMemoryBarriers    = &fillBarrier;
+    dep.memoryBarrierCount = 2;
+    dep.pMemoryBarriers    = fillBarriers;
     vkCmdPipelineBarrier2(cmd, &dep);
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mFrustumPipeline);
@@ -248,14 +624,22 @@ void ComputeCulling::DispatchFrustum(VkCommandBuffer cmd, const CullParams& para
     dep2.memoryBarrierCount = 1;
     dep2.pMemoryBarriers    = &computeBarrier;
     vkCmdPipelineBarrier2(cmd, &dep2);
+
+    // Without occlusion there is no phase two to finish the transparent list and the counters
+    if (params.allOccluders) {
+        RecordTransparentSort(cmd, params);
+        RecordStatsReadback(cmd);
+    }
 }
 
 void ComputeCulling::DispatchOcclusion(VkCommandBuffer cmd, const CullParams& params) const {
     if (mMaxDrawCount == 0) return;
 
-    std::memcpy(mParamsUBO.GetMappedData(), &params, sizeof(CullParams));
+    CullParams p = params;
+    p.maskedBase = GetMaskedListBase();
+    std::memcpy(mParamsUBO.GetMappedData(), &p, sizeof(CullParams));
 
-    vkCmdFillBuffer(cmd, mVisibleCountBuffer.GetHandle(), 0, sizeof(uint32_t), 0);
+    vkCmdFillBuffer(cmd, mVisibleCountBuffer.GetHandle(), 0, kListCountSize, 0);
 
     VkMemoryBarrier2 fillBarrier{};
     fillBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
@@ -273,7 +657,7 @@ void ComputeCulling::DispatchOcclusion(VkCommandBuffer cmd, const CullParams& pa
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mOcclusionPipeline);
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
                             mOcclusionPipelineLayout, 0, 1, &mOcclusionDescSet, 0, nullptr);
-    vkCmdDispatch(cmd, (mMaxDrawCount + 63) / 64, 1, 1);
+    vkCmdDispatch(cmd, (params.drawCount + 63) / 64, 1, 1);
 
     VkMemoryBarrier2 computeBarrier{};
     computeBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
@@ -287,4 +671,46 @@ void ComputeCulling::DispatchOcclusion(VkCommandBuffer cmd, const CullParams& pa
     dep2.memoryBarrierCount = 1;
     dep2.pMemoryBarriers    = &computeBarrier;
     vkCmdPipelineBarrier2(cmd, &dep2);
+
+    RecordTransparentSort(cmd, params);
+    RecordStatsReadback(cmd);
+}
+
+void ComputeCulling::DispatchShadow(VkCommandBuffer cmd, const ShadowCullParams& params) const {
+    if (mShadowListStride == 0) return;
+
+    std::memcpy(mShadowParamsUBO.GetMappedData(), &params, sizeof(ShadowCullParams));
+
+    vkCmdFillBuffer(cmd, mShadowCountBuffer.GetHandle(), 0, VK_WHOLE_SIZE, 0);
+
+    VkMemoryBarrier2 fillBarrier{};
+    fillBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    fillBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    fillBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    fillBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    fillBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+
+    VkDependencyInfo dep{};
+    dep.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &fillBarrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mShadowPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            mShadowPipelineLayout, 0, 1, &mShadowDescSet, 0, nullptr);
+    vkCmdDispatch(cmd, (params.drawCount + 63) / 64, 1, 1);
+
+    VkMemoryBarrier2 computeBarrier{};
+    computeBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    computeBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    computeBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    computeBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    computeBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+
+    VkDependencyInfo dep2{};
+    dep2.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep2.memoryBarrierCount = 1;
+    dep2.pMemoryBarriers    = &computeBarrier;
+    vkCmdPipelineBarrier2(cmd, &dep2);
 }
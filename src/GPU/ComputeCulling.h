@@ -5,43 +5,156 @@
 #include <glm/glm.hpp>
 
 #include "Resource/VulkanBuffer.h"
+#include "Lighting/CascadedShadowMap.h"
+#include "GPU/MeshPool.h"
 #include <cstdint>
+#include <vector>
 
 class ShaderManager;
 
 struct CullParams {
     glm::mat4 viewProjection;
+    glm::mat4 prevViewProjection; // camera the Hi-Z was built with, for the phase-one test
     glm::vec4 frustumPlanes[6];
     glm::vec2 hiZSize;
     float     nearPlane;
     float     farPlane;
     uint32_t  drawCount;
-    uint32_t  occluderCount;
-    uint32_t  candidateCount;
-    uint32_t  _pad;
+    uint32_t  allOccluders;      // 1: every visible item is drawn in phase one (occlusion culling off)
+    uint32_t  prevHiZValid;      // 0: the Hi-Z holds no previous frame (first frame, resize, occlusion was off)
+    uint32_t  uint32ClassBase;   // first draw of the uint32 index class (IndexClassRanges::first[1])
+    glm::vec4 cameraPosition;    // xyz = world-space eye, for meshlet cone culling
+    uint32_t  clusterMode;       // 1: work items are (object, meshlet) clusters instead of objects
+    float     lodScale;          // viewport height / (2 tan(fovY / 2)): pixels per unit at distance 1
+    float     lodThreshold;      // allowed projected LOD error in pixels, 0 = always LOD0
+    uint32_t  maskedBase;        // first draw of the alpha-masked lists; set by the dispatches
+    uint32_t  groupPhaseBase;    // phase two's group commands (IndirectRenderer::GetGroupCapacity); 0: no instancing
+};
+
+/// Per-item visibility history, one uint per work item (object slot or cluster).
+enum CullVisibility : uint32_t {
+    CULL_VIS_VISIBLE    = 1u << 0,   // passed the phase-two Hi-Z test last frame
+    CULL_VIS_IN_FRUSTUM = 1u << 1,   // passed frustum/cone culling this frame
+    CULL_VIS_PHASE1     = 1u << 2,   // drawn in phase one this frame
+};
+
+/// GPU counters written by the culling shaders, one block per frame in flight.
+enum CullStat : uint32_t {
+    CULL_STAT_FRUSTUM_DRAWS = 0,
+    CULL_STAT_FRUSTUM_TRIS,
+    CULL_STAT_PHASE1_DRAWS,
+    CULL_STAT_PHASE1_TRIS,
+    CULL_STAT_PHASE2_DRAWS,
+    CULL_STAT_PHASE2_TRIS,
+    CULL_STAT_LOD0_TRIS,     // drawn items at full detail, both phases
+    CULL_STAT_MASKED_DRAWS,  // alpha-tested items drawn after the opaque lists, both phases
+    CULL_STAT_TRANSPARENT_DRAWS,   // blended items listed for the sorted transparent draw
+    CULL_STAT_INSTANCED_DRAWS,     // group commands with at least one instance, both phases
+    CULL_STAT_INSTANCES,           // drawn items listed as instances of a group, both phases
+    CULL_STAT_COUNT = 16,  // padded to 64 bytes
+};
+
+/// Occlusion culling results accumulated over the frames read back so far.
+struct OcclusionStats {
+    uint64_t frames          = 0;
+    uint64_t frustumDraws    = 0;   // what frustum culling alone would draw
+    uint64_t frustumTris     = 0;
+    uint64_t phase1Draws     = 0;   // visible last frame, drawn before the Hi-Z rebuild
+    uint64_t phase1Tris      = 0;
+    uint64_t phase2Draws     = 0;   // newly disoccluded, drawn after it
+    uint64_t phase2Tris      = 0;
+    uint64_t lod0Tris        = 0;   // Tris() if every drawn item used LOD0
+    uint64_t maskedDraws     = 0;   // part of the phase draws, drawn after the opaque lists
+    uint64_t transparentDraws = 0;  // part of the phase draws, drawn last back to front
+    uint64_t instancedDraws  = 0;   // non-empty group commands
+    uint64_t instances       = 0;   // part of the phase draws, drawn through instancedDraws
+
+    uint64_t Draws() const { return phase1Draws + phase2Draws; }
+    uint64_t Tris()  const { return phase1Tris + phase2Tris; }
+    uint64_t Submitted() const { return Draws() - instances + instancedDraws; }   // draws that reach the rasterizer
+    double   DrawSavings() const { return frustumDraws ? 1.0 - double(Draws()) / double(frustumDraws) : 0.0; }
+    double   TriSavings()  const { return frustumTris  ? 1.0 - double(Tris())  / double(frustumTris)  : 0.0; }
+};
+
+struct ShadowCullParams {
+    glm::vec4 casterPlanes[CascadedShadowMap::CASCADE_COUNT * CascadedShadowMap::CASTER_PLANE_COUNT];
+    uint32_t  drawCount;
+    uint32_t  uint32ClassBase;   // as in CullParams
+    uint32_t  listStride;        // draws per cascade list (GetShadowListStride)
+    uint32_t  cascadeCount;
 };
 
 class ComputeCulling {
 public:
-    void Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders);
+    void Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders,
+                    uint32_t framesInFlight);
     void Shutdown(VkDevice device, VmaAllocator allocator);
 
     void UpdateBuffers(VmaAllocator allocator,
                        VkBuffer srcIndirectBuffer, uint32_t drawCount,
                        VkBuffer objectBuffer,
+                       VkBuffer clusterBuffer, uint32_t clusterCount,
+                       VkBuffer meshletBuffer, VkBuffer lodBuffer,
+                       VkBuffer groupBuffer, uint32_t groupCapacity,
+                       VkBuffer slotGroupBuffer, uint32_t instanceCapacity,
                        VkImageView hiZView, VkSampler hiZSampler);
 
+    /// Phase one: frustum/cone culls every work item. Items visible last frame that also
+    /// pass the previous frame's Hi-Z go to the occluder list; with allOccluders every
+    /// visible item does.
     void DispatchFrustum(VkCommandBuffer cmd, const CullParams& params) const;
+
+    /// Phase two, after the Hi-Z rebuild: tests every in-frustum item against the new
+    /// Hi-Z, rewrites the visibility history and lists those phase one did not draw.
     void DispatchOcclusion(VkCommandBuffer cmd, const CullParams& params) const;
 
+    /// Instanced group draws (see IndirectRenderer::GetGroupBuffer): phase one resets
+    /// both phases' copies from the scene's commands, each phase counts its surviving
+    /// grouped objects into them and lists their slots in the instance buffer, which
+    /// pbr_indirect.vert reads for draws with INSTANCE_LIST_BIT. Phase two's commands
+    /// start at CullParams::groupPhaseBase. Drawn with plain indirect draws over the
+    /// group ranges; commands nothing survived for have instanceCount 0.
+    VkBuffer GetGroupIndirectBuffer() const { return mGroupIndirectBuffer.GetHandle(); }
+    VkBuffer GetInstanceBuffer()      const { return mInstanceBuffer.GetHandle(); }
+
+    /// Alpha-masked items compact into a second half of the occluder and visible
+    /// lists, starting at draw GetMaskedListBase(), with their per-class counts at
+    /// byte MASKED_COUNT_OFFSET of the count buffers. Blended items never occlude:
+    /// they skip phase one, and whichever dispatch runs last lists the visible ones
+    /// in the transparent list sorted back to front.
+    static constexpr VkDeviceSize MASKED_COUNT_OFFSET = INDEX_CLASS_COUNT * sizeof(uint32_t);
+    static constexpr uint32_t     TRANSPARENT_SORT_MAX = 2048;   // per index class; the rest keep list order
+    uint32_t GetMaskedListBase() const { return mMaxDrawCount; }
+
+    /// Accumulates the stats the frame slot recorded last time round and selects it for
+    /// the frame being recorded, and frees what UpdateBuffers replaced once no frame in
+    /// flight uses it. Call after the frame's fence wait.
+    void BeginFrame(uint32_t frameIndex);
+    const OcclusionStats& GetStats() const { return mStats; }
+    void ResetStats() { mStats = {}; }
+
+    /// Tests every object against all cascade caster volumes in one dispatch and
+    /// writes one compacted indirect list (with per-index-class counts) per cascade.
+    void DispatchShadow(VkCommandBuffer cmd, const ShadowCullParams& params) const;
+
     VkBuffer GetOccluderIndirectBuffer()  const { return mOccluderIndirectBuffer.GetHandle(); }
     VkBuffer GetOccluderCountBuffer()     const { return mOccluderCountBuffer.GetHandle(); }
-    VkBuffer GetCandidateIndirectBuffer() const { return mCandidateIndirectBuffer.GetHandle(); }
-    VkBuffer GetCandidateCountBuffer()    const { return mCandidateCountBuffer.GetHandle(); }
     VkBuffer GetVisibleIndirectBuffer()   const { return mVisibleIndirectBuffer.GetHandle(); }
     VkBuffer GetVisibleCountBuffer()      const { return mVisibleCountBuffer.GetHandle(); }
+    VkBuffer GetTransparentIndirectBuffer() const { return mTransparentIndirectBuffer.GetHandle(); }
+    VkBuffer GetTransparentCountBuffer()    const { return mTransparentCountBuffer.GetHandle(); }
+
+    /// Cascade c's list starts at draw c * GetShadowListStride(); its counts at
+    /// byte c * GetShadowCountStride() of the count buffer.
+    VkBuffer     GetShadowIndirectBuffer() const { return mShadowIndirectBuffer.GetHandle(); }
+    VkBuffer     GetShadowCountBuffer()    const { return mShadowCountBuffer.GetHandle(); }
+    uint32_t     GetShadowListStride()     const { return mShadowListStride; }
+    VkDeviceSize GetShadowCountStride()    const;
 
 private:
+    void RecordTransparentSort(VkCommandBuffer cmd, const CullParams& params) const;
+    void RecordStatsReadback(VkCommandBuffer cmd) const;
+
     VkDevice     mDevice     = VK_NULL_HANDLE;
     VmaAllocator mAllocator  = VK_NULL_HANDLE;
 
@@ -55,15 +168,56 @@ private:
     VkDescriptorSetLayout mOcclusionDescSetLayout  = VK_NULL_HANDLE;
     VkDescriptorSet       mOcclusionDescSet        = VK_NULL_HANDLE;
 
+    VkPipeline            mShadowPipeline       = VK_NULL_HANDLE;
+    VkPipelineLayout      mShadowPipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mShadowDescSetLayout  = VK_NULL_HANDLE;
+    VkDescriptorSet       mShadowDescSet        = VK_NULL_HANDLE;
+
+    VkPipeline            mSortPipeline       = VK_NULL_HANDLE;
+    VkPipelineLayout      mSortPipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mSortDescSetLayout  = VK_NULL_HANDLE;
+    VkDescriptorSet       mSortDescSet        = VK_NULL_HANDLE;
+
     VkDescriptorPool mDescPool = VK_NULL_HANDLE;
 
     VulkanBuffer mOccluderIndirectBuffer;
     VulkanBuffer mOccluderCountBuffer;
-    VulkanBuffer mCandidateIndirectBuffer;
-    VulkanBuffer mCandidateCountBuffer;
     VulkanBuffer mVisibleIndirectBuffer;
     VulkanBuffer mVisibleCountBuffer;
+    VulkanBuffer mTransparentScratchBuffer;  // blended draws in list order
+    VulkanBuffer mTransparentKeyBuffer;      // distance | slot per listed draw, for the sort
+    VulkanBuffer mTransparentIndirectBuffer; // the same draws back to front
+    VulkanBuffer mTransparentCountBuffer;
+    VulkanBuffer mVisibilityBuffer;         // CULL_VIS_* per work item, persists across frames
+    VulkanBuffer mStatsBuffer;              // CULL_STAT_COUNT counters for the frame being recorded
+    std::vector<VulkanBuffer> mStatsReadback;   // per frame in flight
     VulkanBuffer mParamsUBO;
+    VulkanBuffer mShadowIndirectBuffer;     // CASCADE_COUNT lists of mShadowListStride draws
+    VulkanBuffer mShadowCountBuffer;
+    VulkanBuffer mShadowParamsUBO;
+    VulkanBuffer mGroupIndirectBuffer;      // both phases' group commands
+    VulkanBuffer mInstanceBuffer;           // object slots of the grouped draws, both phases
+    VkBuffer     mGroupSrcBuffer   = VK_NULL_HANDLE;   // IndirectRenderer's, reset source
+    VkDeviceSize mGroupSize        = 0;
+    uint32_t     mInstanceCapacity = 0;
+
+    // Buffers and descriptor pool replaced by UpdateBuffers, freed in BeginFrame
+    struct RetiredResources {
+        std::vector<VulkanBuffer> buffers;
+        VkDescriptorPool          pool     = VK_NULL_HANDLE;
+        uint64_t                  retireAt = 0;   // mFrameCount when no frame uses them
+    };
+    void ReleaseRetired(bool all);
+    std::vector<RetiredResources> mRetired;
+    uint64_t mFrameCount     = 0;
+    uint32_t mFramesInFlight = 0;
+
+    uint32_t mMaxDrawCount     = 0;   // output capacity: max(draws, clusters)
+    uint32_t mShadowListStride = 0;   // object slots; shadows always cull whole objects
 
-    uint32_t mMaxDrawCount = 0;
+    // Set by the dispatches, which the render graph reaches through const pointers
+    mutable bool                 mClearVisibility = false;   // buffer was recreated
+    mutable std::vector<uint8_t> mStatsPending;              // per frame: readback recorded
+    uint32_t       mStatsFrame = 0;
+    OcclusionStats mStats;
 };
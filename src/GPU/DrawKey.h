@@ -0,0 +1,63 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/// Render queue of a draw; the top field of its key, so queues never interleave.
+enum class DrawPass : uint32_t {
+    Opaque      = 0,
+    Masked      = 1,   // alpha-tested, after the opaques so those keep early-Z
+    Transparent = 3,   // drawn last, back to front
+};
+
+/// 64-bit sort keys for the CPU path's draw list. Sorted ascending, opaque and masked
+/// draws group by pipeline, then index buffer, then material, and go front to back
+/// within a material; transparent draws go strictly back to front and only group by
+/// state among draws at the same depth.
+///
+///   opaque/masked [63:62] pass | [61:59] pipeline | [58] index class | [57:38] material | [37:22] depth
+///   transparent   [63:62] pass | [61:46] ~depth   | [45:43] pipeline | [42] index class | [41:22] material
+///
+/// The low 22 bits are free; RadixSorter skips their passes when they stay zero.
+namespace DrawKey {
+
+constexpr uint32_t PIPELINE_BITS = 3;
+constexpr uint32_t MATERIAL_BITS = 20;
+constexpr uint32_t DEPTH_BITS    = 16;
+constexpr uint32_t DEPTH_MAX     = (1u << DEPTH_BITS) - 1;
+
+/// Log-spaced bucket of a view depth in [nearPlane, farPlane]: equal ratios of
+/// distance get equal bucket counts, so near geometry keeps its ordering.
+inline uint32_t DepthBucket(float viewDepth, float nearPlane, float farPlane) {
+    if (!(viewDepth > nearPlane)) return 0;
+    float t = std::log2(viewDepth / nearPlane) / std::log2(farPlane / nearPlane);
+    return static_cast<uint32_t>(std::min(t, 1.0f) * static_cast<float>(DEPTH_MAX));
+}
+
+constexpr uint64_t Opaque(uint32_t pipeline, uint32_t indexClass, uint32_t material, uint32_t depth,
+                          DrawPass pass = DrawPass::Opaque) {
+    return (uint64_t(pass) << 62)
+         | (uint64_t(pipeline & 7u) << 59)
+         | (uint64_t(indexClass & 1u) << 58)
+         | (uint64_t(material & 0xFFFFFu) << 38)
+         | (uint64_t(depth & DEPTH_MAX) << 22);
+}
+
+constexpr uint64_t Transparent(uint32_t pipeline, uint32_t indexClass, uint32_t material, uint32_t depth) {
+    return (uint64_t(DrawPass::Transparent) << 62)
+         | (uint64_t(~depth & DEPTH_MAX) << 46)
+         | (uint64_t(pipeline & 7u) << 43)
+         | (uint64_t(indexClass & 1u) << 42)
+         | (uint64_t(material & 0xFFFFFu) << 22);
+}
+
+constexpr uint64_t ForPass(DrawPass pass, uint32_t pipeline, uint32_t indexClass, uint32_t material,
+                           uint32_t depth) {
+    return pass == DrawPass::Transparent ? Transparent(pipeline, indexClass, material, depth)
+                                         : Opaque(pipeline, indexClass, material, depth, pass);
+}
+
+constexpr DrawPass PassOf(uint64_t key) { return static_cast<DrawPass>(key >> 62); }
+
+} // namespace DrawKey
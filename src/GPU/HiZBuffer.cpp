@@ -6,13 +6,16 @@
 #include <algorithm>
 #include <cmath>
 
-void HiZBuffer::Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders) {
+void HiZBuffer::Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders,
+                           Reduction reduction) {
     mDevice    = device;
     mAllocator = allocator;
+    mReduction = reduction;
 
     VkSamplerReductionModeCreateInfo reductionInfo{};
     reductionInfo.sType         = VK_STRUCTURE_TYPE_SAMPLER_REDUCTION_MODE_CREATE_INFO;
-    reductionInfo.reductionMode = VK_SAMPLER_REDUCTION_MODE_MAX;
+    reductionInfo.reductionMode = reduction == Reduction::Min ? VK_SAMPLER_REDUCTION_MODE_MIN
+                                                              : VK_SAMPLER_REDUCTION_MODE_MAX;
 
     VkSamplerCreateInfo samplerInfo{};
     samplerInfo.sType     = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
@@ -44,10 +47,16 @@ void HiZBuffer::Initialize(VkDevice device, VmaAllocator allocator, ShaderManage
     layoutInfo.pBindings    = bindings;
     VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &mDescSetLayout));
 
+    VkPushConstantRange reducePush{};
+    reducePush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    reducePush.size       = sizeof(uint32_t);
+
     VkPipelineLayoutCreateInfo pipeLayoutInfo{};
-    pipeLayoutInfo.sType          = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipeLayoutInfo.setLayoutCount = 1;
-    pipeLayoutInfo.pSetLayouts    = &mDescSetLayout;
+    pipeLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipeLayoutInfo.setLayoutCount         = 1;
+    pipeLayoutInfo.pSetLayouts            = &mDescSetLayout;
+    pipeLayoutInfo.pushConstantRangeCount = 1;
+    pipeLayoutInfo.pPushConstantRanges    = &reducePush;
     VK_CHECK(vkCreatePipelineLayout(device, &pipeLayoutInfo, nullptr, &mPipelineLayout));
 
     VkShaderModule compModule = shaders.GetOrLoad("shaders/hiz_reduce.comp.spv");
@@ -60,6 +69,46 @@ void HiZBuffer::Initialize(VkDevice device, VmaAllocator allocator, ShaderManage
     compInfo.layout       = mPipelineLayout;
     VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compInfo, nullptr, &mPipeline));
 
+    // --- Single pass ---
+    VkDescriptorSetLayoutBinding spdBindings[3]{};
+    spdBindings[0].binding         = 0;
+    spdBindings[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    spdBindings[0].descriptorCount = 1;
+    spdBindings[0].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    spdBindings[1].binding         = 1;
+    spdBindings[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    spdBindings[1].descriptorCount = SPD_MAX_MIPS;
+    spdBindings[1].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+    spdBindings[2].binding         = 2;
+    spdBindings[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    spdBindings[2].descriptorCount = 1;
+    spdBindings[2].stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkDescriptorSetLayoutCreateInfo spdLayoutInfo{};
+    spdLayoutInfo.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    spdLayoutInfo.bindingCount = 3;
+    spdLayoutInfo.pBindings    = spdBindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(device, &spdLayoutInfo, nullptr, &mSPDSetLayout));
+
+    VkPushConstantRange spdPush{};
+    spdPush.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    spdPush.size       = 5 * sizeof(uint32_t);
+
+    VkPipelineLayoutCreateInfo spdPipeLayoutInfo{};
+    spdPipeLayoutInfo.sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    spdPipeLayoutInfo.setLayoutCount         = 1;
+    spdPipeLayoutInfo.pSetLayouts            = &mSPDSetLayout;
+    spdPipeLayoutInfo.pushConstantRangeCount = 1;
+    spdPipeLayoutInfo.pPushConstantRanges    = &spdPush;
+    VK_CHECK(vkCreatePipelineLayout(device, &spdPipeLayoutInfo, nullptr, &mSPDPipelineLayout));
+
+    compInfo.stage.module = shaders.GetOrLoad("shaders/hiz_spd.comp.spv");
+    compInfo.layout       = mSPDPipelineLayout;
+    VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &compInfo, nullptr, &mSPDPipeline));
+
+    mSPDCounter.CreateDeviceLocalEmpty(allocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(uint32_t));
+
     LOG_INFO("HiZBuffer initialized");
 }
 
@@ -76,6 +125,13 @@ void HiZBuffer::Shutdown(VkDevice device, VmaAllocator allocator) {
     if (mPipelineLayout) { vkDestroyPipelineLayout(device, mPipelineLayout, nullptr); mPipelineLayout = VK_NULL_HANDLE; }
     if (mDescSetLayout)  { vkDestroyDescriptorSetLayout(device, mDescSetLayout, nullptr); mDescSetLayout = VK_NULL_HANDLE; }
     if (mReduceSampler)  { vkDestroySampler(device, mReduceSampler, nullptr); mReduceSampler = VK_NULL_HANDLE; }
+
+    if (mSPDPipeline)       { vkDestroyPipeline(device, mSPDPipeline, nullptr); mSPDPipeline = VK_NULL_HANDLE; }
+    if (mSPDPipelineLayout) { vkDestroyPipelineLayout(device, mSPDPipelineLayout, nullptr); mSPDPipelineLayout = VK_NULL_HANDLE; }
+    if (mSPDSetLayout)      { vkDestroyDescriptorSetLayout(device, mSPDSetLayout, nullptr); mSPDSetLayout = VK_NULL_HANDLE; }
+    mSPDCounter.Destroy(allocator);
+    mSPDSet            = VK_NULL_HANDLE;
+    mSPDCounterCleared = false;
 }
 
 void HiZBuffer::Resize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height) {
@@ -87,7 +143,10 @@ void HiZBuffer::Resize(VkDevice device, VmaAllocator allocator, uint32_t width,
     if (mHiZImage) { vmaDestroyImage(allocator, mHiZImage, mHiZAlloc); mHiZImage = VK_NULL_HANDLE; }
     if (mDescPool) { vkDestroyDescriptorPool(device, mDescPool, nullptr); mDescPool = VK_NULL_HANDLE; }
     mDescSets.clear();
+    mSPDSet = VK_NULL_HANDLE;
 
+    mSourceWidth  = width;
+    mSourceHeight = height;
     mWidth  = std::max(width  / 2, 1u);
     mHeight = std::max(height / 2, 1u);
     mMipCount = static_cast<uint32_t>(std::floor(std::log2(std::max(mWidth, mHeight)))) + 1;
@@ -136,16 +195,18 @@ void HiZBuffer::CreateHiZImage(VkDevice device, VmaAllocator allocator) {
 }
 
 void HiZBuffer::CreateDescriptors(VkDevice device) {
-    VkDescriptorPoolSize poolSizes[2]{};
+    VkDescriptorPoolSize poolSizes[3]{};
     poolSizes[0].type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    poolSizes[0].descriptorCount = mMipCount;
+    poolSizes[0].descriptorCount = mMipCount + 1;
     poolSizes[1].type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    poolSizes[1].descriptorCount = mMipCount;
+    poolSizes[1].descriptorCount = mMipCount + SPD_MAX_MIPS;
+    poolSizes[2].type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = 1;
 
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.maxSets       = mMipCount;
-    poolInfo.poolSizeCount = 2;
+    poolInfo.maxSets       = mMipCount + 1;
+    poolInfo.poolSizeCount = 3;
     poolInfo.pPoolSizes    = poolSizes;
     VK_CHECK(vkCreateDescriptorPool(device, &poolInfo, nullptr, &mDescPool));
 
@@ -157,6 +218,10 @@ void HiZBuffer::CreateDescriptors(VkDevice device) {
     allocInfo.pSetLayouts        = layouts.data();
     mDescSets.resize(mMipCount);
     VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, mDescSets.data()));
+
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts        = &mSPDSetLayout;
+    VK_CHECK(vkAllocateDescriptorSets(device, &allocInfo, &mSPDSet));
 }
 
 void HiZBuffer::SetSourceDepth(VkImageView depthView) {
@@ -194,14 +259,113 @@ void HiZBuffer::UpdateSourceDescriptor(VkDevice device) {
 
         vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
     }
+
+    // Single pass: slots past the last mip repeat it, the shader never writes them
+    VkDescriptorImageInfo srcInfo{};
+    srcInfo.sampler     = mReduceSampler;
+    srcInfo.imageView   = mSourceDepthView;
+    srcInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+    VkDescriptorImageInfo mipInfos[SPD_MAX_MIPS]{};
+    for (uint32_t i = 0; i < SPD_MAX_MIPS; i++) {
+        mipInfos[i].imageView   = mMipViews[std::min(i, mMipCount - 1)];
+        mipInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+
+    VkDescriptorBufferInfo counterInfo{};
+    counterInfo.buffer = mSPDCounter.GetHandle();
+    counterInfo.range  = sizeof(uint32_t);
+
+    VkWriteDescriptorSet spdWrites[3]{};
+    spdWrites[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    spdWrites[0].dstSet          = mSPDSet;
+    spdWrites[0].dstBinding      = 0;
+    spdWrites[0].descriptorCount = 1;
+    spdWrites[0].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    spdWrites[0].pImageInfo      = &srcInfo;
+
+    spdWrites[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    spdWrites[1].dstSet          = mSPDSet;
+    spdWrites[1].dstBinding      = 1;
+    spdWrites[1].descriptorCount = SPD_MAX_MIPS;
+    spdWrites[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    spdWrites[1].pImageInfo      = mipInfos;
+
+    spdWrites[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    spdWrites[2].dstSet          = mSPDSet;
+    spdWrites[2].dstBinding      = 2;
+    spdWrites[2].descriptorCount = 1;
+    spdWrites[2].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    spdWrites[2].pBufferInfo     = &counterInfo;
+
+    vkUpdateDescriptorSets(device, 3, spdWrites, 0, nullptr);
 }
 
 void HiZBuffer::BuildMipChain(VkCommandBuffer cmd) const {
     if (mMipCount == 0 || mSourceDepthView == VK_NULL_HANDLE) return;
+    if (UsesSinglePass()) BuildSinglePass(cmd);
+    else                  BuildPerMip(cmd);
+}
+
+void HiZBuffer::BuildSinglePass(VkCommandBuffer cmd) const {
+    // The counter starts at zero once; afterwards the last workgroup puts it back
+    if (!mSPDCounterCleared) {
+        vkCmdFillBuffer(cmd, mSPDCounter.GetHandle(), 0, sizeof(uint32_t), 0);
+        mSPDCounterCleared = true;
+    }
+
+    VkImageMemoryBarrier2 toGeneral{};
+    toGeneral.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+    toGeneral.srcStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;   // phase-one culling samples the old pyramid
+    toGeneral.srcAccessMask       = VK_ACCESS_2_NONE;
+    toGeneral.dstStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    toGeneral.dstAccessMask       = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    toGeneral.oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
+    toGeneral.newLayout           = VK_IMAGE_LAYOUT_GENERAL;
+    toGeneral.image               = mHiZImage;
+    toGeneral.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mMipCount, 0, 1 };
+
+    // Counter: the clear above, or the previous build's reset
+    VkBufferMemoryBarrier2 counterBarrier{};
+    counterBarrier.sType         = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2;
+    counterBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_CLEAR_BIT;
+    counterBarrier.srcAccessMask = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    counterBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    counterBarrier.dstAccessMask = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
+    counterBarrier.buffer        = mSPDCounter.GetHandle();
+    counterBarrier.size          = VK_WHOLE_SIZE;
+
+    VkDependencyInfo dep{};
+    dep.sType                    = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep.bufferMemoryBarrierCount = 1;
+    dep.pBufferMemoryBarriers    = &counterBarrier;
+    dep.imageMemoryBarrierCount  = 1;
+    dep.pImageMemoryBarriers     = &toGeneral;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    // Each workgroup covers 32x32 texels of mip 0
+    uint32_t groupsX = (mWidth  + 31) / 32;
+    uint32_t groupsY = (mHeight + 31) / 32;
+
+    struct {
+        int32_t  srcWidth, srcHeight;
+        uint32_t mipCount;
+        uint32_t groupCount;
+        uint32_t reduceMin;
+    } pc{ static_cast<int32_t>(mSourceWidth), static_cast<int32_t>(mSourceHeight),
+          mMipCount, groupsX * groupsY, mReduction == Reduction::Min ? 1u : 0u };
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mSPDPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
+                            mSPDPipelineLayout, 0, 1, &mSPDSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mSPDPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+}
 
+void HiZBuffer::BuildPerMip(VkCommandBuffer cmd) const {
     VkImageMemoryBarrier2 toGeneral{};
     toGeneral.sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-    toGeneral.srcStageMask        = VK_PIPELINE_STAGE_2_NONE;
+    toGeneral.srcStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;   // phase-one culling samples the old pyramid
     toGeneral.srcAccessMask       = VK_ACCESS_2_NONE;
     toGeneral.dstStageMask        = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
     toGeneral.dstAccessMask       = VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT;
@@ -217,6 +381,8 @@ void HiZBuffer::BuildMipChain(VkCommandBuffer cmd) const {
     vkCmdPipelineBarrier2(cmd, &dep);
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+    uint32_t reduceMin = mReduction == Reduction::Min ? 1u : 0u;
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(reduceMin), &reduceMin);
 
     for (uint32_t mip = 0; mip < mMipCount; mip++) {
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE,
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Resource/VulkanBuffer.h"
+
 #include <volk.h>
 #include <vk_mem_alloc.h>
 #include <vector>
@@ -7,9 +9,18 @@
 
 class ShaderManager;
 
+/// Depth pyramid at half the source resolution. Each texel holds the farthest (Max,
+/// occlusion culling) or nearest (Min, screen-space tracing) depth of its footprint.
+/// Built in one dispatch by hiz_spd.comp when the chain has at most SPD_MAX_MIPS levels,
+/// one dispatch per mip (hiz_reduce.comp) otherwise or when single pass is turned off.
 class HiZBuffer {
 public:
-    void Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders);
+    enum class Reduction { Max, Min };
+
+    static constexpr uint32_t SPD_MAX_MIPS = 12;   // source up to 4096x4096
+
+    void Initialize(VkDevice device, VmaAllocator allocator, ShaderManager& shaders,
+                    Reduction reduction = Reduction::Max);
     void Shutdown(VkDevice device, VmaAllocator allocator);
 
     void Resize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height);
@@ -18,17 +29,23 @@ public:
 
     void SetSourceDepth(VkImageView depthView);
 
+    void SetSinglePass(bool on) { mSinglePass = on; }
+    bool UsesSinglePass() const { return mSinglePass && mMipCount <= SPD_MAX_MIPS; }
+
     VkImageView GetView()     const { return mHiZView; }
     VkImage     GetImage()    const { return mHiZImage; }
     VkSampler   GetSampler()  const { return mReduceSampler; }
     uint32_t    GetWidth()    const { return mWidth; }
     uint32_t    GetHeight()   const { return mHeight; }
     uint32_t    GetMipCount() const { return mMipCount; }
+    Reduction   GetReduction() const { return mReduction; }
 
 private:
     void CreateHiZImage(VkDevice device, VmaAllocator allocator);
     void CreateDescriptors(VkDevice device);
     void UpdateSourceDescriptor(VkDevice device);
+    void BuildSinglePass(VkCommandBuffer cmd) const;
+    void BuildPerMip(VkCommandBuffer cmd) const;
 
     VkDevice      mDevice      = VK_NULL_HANDLE;
     VmaAllocator  mAllocator   = VK_NULL_HANDLE;
@@ -47,7 +64,20 @@ private:
     VkDescriptorPool      mDescPool      = VK_NULL_HANDLE;
     std::vector<VkDescriptorSet> mDescSets;
 
-    uint32_t mWidth    = 0;
-    uint32_t mHeight   = 0;
-    uint32_t mMipCount = 0;
+    // Single pass: all mips bound at once, plus the finished-workgroup counter
+    VkPipeline            mSPDPipeline       = VK_NULL_HANDLE;
+    VkPipelineLayout      mSPDPipelineLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mSPDSetLayout      = VK_NULL_HANDLE;
+    VkDescriptorSet       mSPDSet            = VK_NULL_HANDLE;
+    VulkanBuffer          mSPDCounter;
+    mutable bool          mSPDCounterCleared = false;   // the shader resets it after that
+
+    Reduction mReduction  = Reduction::Max;
+    bool      mSinglePass = true;
+
+    uint32_t mWidth        = 0;
+    uint32_t mHeight       = 0;
+    uint32_t mMipCount     = 0;
+    uint32_t mSourceWidth  = 0;
+    uint32_t mSourceHeight = 0;
 };
@@ -2,72 +2,658 @@
 #include "Resource/TransferManager.h"
 #include "Core/Logger.h"
 
+#include <algorithm>
+#include <chrono>
 #include <cmath>
+#include <cstring>
 
-void IndirectRenderer::Initialize(VmaAllocator, VkDevice device) {
-    mDevice = device;
+// Grown buffers are filled from the old ones on the GPU, so those that keep their
+// contents are copy sources too
+static constexpr VkBufferUsageFlags kIndirectUsage = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+static constexpr VkBufferUsageFlags kObjectUsage   = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+static constexpr VkBufferUsageFlags kCountUsage    = VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT |
+                                                     VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+static constexpr VkBufferUsageFlags kClusterUsage  = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+// Group commands are templates: culling copies them into its own buffer every frame
+static constexpr VkBufferUsageFlags kGroupUsage    = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+void IndirectRenderer::Initialize(VmaAllocator, VkDevice device, uint32_t framesInFlight) {
+    mDevice         = device;
+    mFramesInFlight = framesInFlight;
+    mStaging.resize(framesInFlight);
+    mPendingCopies.resize(framesInFlight);
+    mPendingGrowth.resize(framesInFlight);
+    std::fill(std::begin(mCommandRestage), std::end(mCommandRestage), INVALID_SLOT);
 }
 
 void IndirectRenderer::Shutdown(VmaAllocator allocator) {
     mIndirectBuffer.Destroy(allocator);
     mObjectSSBO.Destroy(allocator);
     mDrawCountBuffer.Destroy(allocator);
-    mDrawCount = 0;
+    mClusterBuffer.Destroy(allocator);
+    mGroupBuffer.Destroy(allocator);
+    mSlotGroupBuffer.Destroy(allocator);
+    ReleaseRetired(allocator, true);
+    for (auto& s : mStaging) s.Destroy(allocator);
+    mStaging.clear();
+    mPendingCopies.clear();
+    mPendingGrowth.clear();
+
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        mCommands[cls].clear();
+        mObjects[cls].clear();
+        mSlotMesh[cls].clear();
+        mFreeSlots[cls].clear();
+        mDirtyMask[cls].clear();
+        mDirtySlots[cls].clear();
+        mHighWater[cls]      = 0;
+        mLive[cls]           = 0;
+        mCommandRestage[cls] = INVALID_SLOT;
+    }
+    mEntities.clear();
+    mClusters.clear();
+    mClusterCount    = 0;
+    mClusterCapacity = 0;
+    mDrawRanges      = {};
+    mClusterRanges   = {};
+    mGroupCommands.clear();
+    mSlotGroups.clear();
+    mGroupCount        = 0;
+    mGroupCapacity     = 0;
+    mInstanceCapacity  = 0;
+    mGroupRanges       = {};
+    mMaskedGroupRanges = {};
+}
+
+// -----------------------------------------------------------------------
+// Slots
+// -----------------------------------------------------------------------
+
+uint32_t IndirectRenderer::AllocateSlot(uint32_t cls) {
+    mLive[cls]++;
+    if (!mFreeSlots[cls].empty()) {
+        uint32_t slot = mFreeSlots[cls].back();
+        mFreeSlots[cls].pop_back();
+        return slot;
+    }
+
+    uint32_t capacity = static_cast<uint32_t>(mCommands[cls].size());
+    if (mHighWater[cls] == capacity) {
+        capacity = std::max(MIN_CAPACITY, capacity * 2);
+        mCommands[cls].resize(capacity, VkDrawIndexedIndirectCommand{});
+        mObjects[cls].resize(capacity, GPUObjectData{});
+        mSlotMesh[cls].resize(capacity, -1);
+        mDirtyMask[cls].resize(capacity, 0);
+        mNeedsRealloc = true;
+    }
+    return mHighWater[cls]++;
 }
 
-void IndirectRenderer::BuildCommands(VmaAllocator allocator, const TransferManager& transfer,
-                                     const MeshPool& meshPool, const Registry& registry,
-                                     float occluderRatio)
+void IndirectRenderer::FreeSlot(EntitySlot& rec) {
+    const uint32_t cls = rec.cls;
+    // Keep firstInstance so the zero draw still points at its own slot
+    uint32_t firstInstance = mCommands[cls][rec.slot].firstInstance;
+    mCommands[cls][rec.slot] = {};
+    mCommands[cls][rec.slot].firstInstance = firstInstance;
+    mObjects[cls][rec.slot]  = {};
+    mSlotMesh[cls][rec.slot] = -1;
+    MarkDirty(cls, rec.slot);
+
+    mFreeSlots[cls].push_back(rec.slot);
+    mLive[cls]--;
+    mStats.frees++;
+    mClustersDirty = true;
+    mGroupsDirty   = true;
+    rec = {};
+}
+
+void IndirectRenderer::MarkDirty(uint32_t cls, uint32_t slot) {
+    if (mDirtyMask[cls][slot]) return;
+    mDirtyMask[cls][slot] = 1;
+    mDirtySlots[cls].push_back(slot);
+}
+
+// -----------------------------------------------------------------------
+// Sync
+// -----------------------------------------------------------------------
+
+bool IndirectRenderer::Sync(VmaAllocator allocator, TransferManager& transfer,
+                            const MeshPool& meshPool, const Registry& registry,
+                            const std::vector<GPUMaterialData>& materials, uint32_t frameIndex)
 {
+    auto start = std::chrono::steady_clock::now();
     const auto& meshDrawCmds = meshPool.GetDrawCommands();
+    mSyncIndex++;
+    mStagingFrame = frameIndex;
+    mPendingCopies[frameIndex].clear();
+    mPendingGrowth[frameIndex] = {};
+    ReleaseRetired(allocator, false);
 
-    std::vector<VkDrawIndexedIndirectCommand> indirectCmds;
-    std::vector<GPUObjectData> objectData;
-
-    registry.ForEachRenderable([&](Entity, const TransformComponent& tc,
+    registry.ForEachRenderable([&](Entity e, const TransformComponent& tc,
                                    const MeshComponent& mc, const MaterialComponent& matc) {
         if (mc.meshIndex < 0 || mc.meshIndex >= static_cast<int>(meshDrawCmds.size())) return;
 
         const auto& poolCmd = meshDrawCmds[mc.meshIndex];
+        if (e >= mEntities.size()) mEntities.resize(e + 1);
+        EntitySlot& rec = mEntities[e];
+
+        // A mesh from the other index class has to move to the other region
+        if (rec.slot != INVALID_SLOT && rec.cls != poolCmd.indexClass)
+            FreeSlot(rec);
+
+        if (rec.slot == INVALID_SLOT) {
+            rec.cls  = poolCmd.indexClass;
+            rec.slot = AllocateSlot(rec.cls);
+            mStats.allocations++;
+        }
+        rec.lastSeen = mSyncIndex;
+
+        GPUObjectData& obj = mObjects[rec.cls][rec.slot];
+        bool dirty = false;
+
+        if (rec.meshIndex != mc.meshIndex) {
+            auto& cmd = mCommands[rec.cls][rec.slot];
+            cmd.indexCount    = poolCmd.indexCount;
+            cmd.instanceCount = 1;
+            cmd.firstIndex    = poolCmd.firstIndex;
+            cmd.vertexOffset  = poolCmd.vertexOffset;
+            cmd.firstInstance = mDrawRanges.first[rec.cls] + rec.slot;
 
-        VkDrawIndexedIndirectCommand cmd{};
-        cmd.indexCount    = poolCmd.indexCount;
-        cmd.instanceCount = 1;
-        cmd.firstIndex    = poolCmd.firstIndex;
-        cmd.vertexOffset  = poolCmd.vertexOffset;
-        cmd.firstInstance = static_cast<uint32_t>(indirectCmds.size());
-        indirectCmds.push_back(cmd);
-
-        GPUObjectData obj{};
-        obj.model         = tc.worldMatrix;
-        obj.aabbMin       = glm::vec4(poolCmd.bounds.min, 0.0f);
-        obj.aabbMax       = glm::vec4(poolCmd.bounds.max, 0.0f);
-        obj.materialIndex = (matc.materialIndex >= 0) ? static_cast<uint32_t>(matc.materialIndex) : poolCmd.materialIndex;
-        objectData.push_back(obj);
+            obj.aabbMin    = glm::vec4(poolCmd.bounds.min, 0.0f);
+            obj.aabbMax    = glm::vec4(poolCmd.bounds.max, 0.0f);
+            obj.indexClass = poolCmd.indexClass;
+            obj.meshIndex  = static_cast<uint32_t>(mc.meshIndex);
+
+            rec.meshIndex = mc.meshIndex;
+            mSlotMesh[rec.cls][rec.slot] = mc.meshIndex;
+            mClustersDirty = true;
+            mGroupsDirty   = true;
+            dirty = true;
+        }
+
+        uint32_t material = (matc.materialIndex >= 0) ? static_cast<uint32_t>(matc.materialIndex)
+                                                       : poolCmd.materialIndex;
+        uint32_t flags = 0;
+        if (material < materials.size()) {
+            AlphaMode mode = static_cast<AlphaMode>(materials[material].alphaMode);
+            flags = mode == AlphaMode::Mask  ? OBJECT_FLAG_ALPHA_MASK
+                  : mode == AlphaMode::Blend ? OBJECT_FLAG_ALPHA_BLEND : 0u;
+        }
+        // The material picks the object's draw group; a transform alone never does
+        if (obj.materialIndex != material || obj.flags != flags) {
+            obj.materialIndex = material;
+            obj.flags         = flags;
+            mGroupsDirty = true;
+            dirty = true;
+        }
+        if (std::memcmp(&obj.model, &tc.worldMatrix, sizeof(glm::mat4)) != 0) {
+            obj.model = tc.worldMatrix;
+            dirty = true;
+        }
+
+        if (dirty) MarkDirty(rec.cls, rec.slot);
     });
 
-    mDrawCount = static_cast<uint32_t>(indirectCmds.size());
+    for (auto& rec : mEntities) {
+        if (rec.slot != INVALID_SLOT && rec.lastSeen != mSyncIndex)
+            FreeSlot(rec);
+    }
 
-    mOccluderCount = std::min(
-        static_cast<uint32_t>(std::ceil(mDrawCount * occluderRatio)),
-        mDrawCount);
+    const IndexClassRanges previous = mDrawRanges;
+    if (mNeedsRealloc) {
+        uint32_t first = 0;
+        for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+            mDrawRanges.first[cls] = first;
+            mDrawRanges.count[cls] = static_cast<uint32_t>(mCommands[cls].size());
+            for (uint32_t s = 0; s < mDrawRanges.count[cls]; s++)
+                mCommands[cls][s].firstInstance = first + s;
+            first += mDrawRanges.count[cls];
+        }
+    }
 
-    if (mDrawCount == 0) return;
+    if (mClustersDirty || mNeedsRealloc)
+        RebuildClusters(meshPool);
+    if (mGroupsDirty || mNeedsRealloc)
+        BuildCommands(meshPool);
 
-    mIndirectBuffer.Destroy(allocator);
-    mObjectSSBO.Destroy(allocator);
-    mDrawCountBuffer.Destroy(allocator);
+    bool reallocated = mNeedsRealloc;
+    if (mNeedsRealloc)
+        Reallocate(allocator, transfer, previous);
+    StageUploads(allocator);
+
+    mStats.syncs++;
+    mStats.milliseconds += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return reallocated;
+}
+
+void IndirectRenderer::RebuildClusters(const MeshPool& meshPool) {
+    const auto& meshDrawCmds = meshPool.GetDrawCommands();
+
+    mClusters.clear();
+    mClusterRanges = {};
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        mClusterRanges.first[cls] = static_cast<uint32_t>(mClusters.size());
+        for (uint32_t s = 0; s < mHighWater[cls]; s++) {
+            int mesh = mSlotMesh[cls][s];
+            if (mesh < 0) continue;
+            const auto& poolCmd = meshDrawCmds[mesh];
+            for (uint32_t m = 0; m < poolCmd.meshletCount; m++)
+                mClusters.push_back({mDrawRanges.first[cls] + s, poolCmd.meshletOffset + m});
+        }
+        mClusterRanges.count[cls] = static_cast<uint32_t>(mClusters.size()) - mClusterRanges.first[cls];
+    }
+    mClusterCount = static_cast<uint32_t>(mClusters.size());
+
+    if (mClusterCount > mClusterCapacity) {
+        uint32_t capacity = std::max(mClusterCapacity, MIN_CAPACITY);
+        while (capacity < mClusterCount) capacity *= 2;
+        mClusterCapacity = capacity;
+        mNeedsRealloc    = true;
+    }
+}
+
+// Groups by (alpha bucket, index class, mesh, material), so each bucket's commands are
+// one contiguous range per class and every group draws with one index buffer and one
+// pipeline. Rebuilt whole on membership changes, like the clusters; transforms only
+// move objects within their group.
+void IndirectRenderer::BuildCommands(const MeshPool& meshPool) {
+    const auto& meshDrawCmds = meshPool.GetDrawCommands();
+    mStats.groupRebuilds++;
+
+    struct Member {
+        uint64_t key;    // masked | class | mesh | material, high to low
+        uint32_t slot;   // over all classes
+    };
+    std::vector<Member> members;
+    members.reserve(GetObjectCount());
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        for (uint32_t s = 0; s < mHighWater[cls]; s++) {
+            int mesh = mSlotMesh[cls][s];
+            const GPUObjectData& obj = mObjects[cls][s];
+            if (mesh < 0 || (obj.flags & OBJECT_FLAG_ALPHA_BLEND)) continue;
+            uint64_t masked = (obj.flags & OBJECT_FLAG_ALPHA_MASK) ? 1 : 0;
+            uint64_t key = (masked << 63) | (uint64_t(cls) << 62) | (uint64_t(mesh) << 32) | obj.materialIndex;
+            members.push_back({key, mDrawRanges.first[cls] + s});
+        }
+    }
+    std::sort(members.begin(), members.end(), [](const Member& a, const Member& b) {
+        return a.key != b.key ? a.key < b.key : a.slot < b.slot;
+    });
+
+    mGroupCommands.clear();
+    mSlotGroups.assign(mDrawRanges.Total(), INVALID_GROUP);
+    mGroupRanges       = {};
+    mMaskedGroupRanges = {};
+    mGroupCount        = 0;
+    uint32_t instances = 0;
+    for (size_t i = 0; i < members.size();) {
+        size_t j = i + 1;
+        while (j < members.size() && members[j].key == members[i].key) j++;
+        const uint64_t key   = members[i].key;
+        const uint32_t cls   = static_cast<uint32_t>((key >> 62) & 1);
+        const auto& poolCmd  = meshDrawCmds[(key >> 32) & 0x3FFFFFFF];
+        const uint32_t first = static_cast<uint32_t>(mGroupCommands.size());
+        const uint32_t count = static_cast<uint32_t>(j - i);
+
+        // One command per level: culling picks the level per object, so each level's
+        // region holds every member
+        const uint32_t lodCount = std::max(poolCmd.lodCount, 1u);
+        for (uint32_t l = 0; l < lodCount; l++) {
+            VkDrawIndexedIndirectCommand cmd{};
+            cmd.indexCount    = poolCmd.lods[l].indexCount;
+            cmd.firstIndex    = poolCmd.lods[l].firstIndex;
+            cmd.vertexOffset  = poolCmd.vertexOffset;
+            cmd.firstInstance = INSTANCE_LIST_BIT | instances;
+            mGroupCommands.push_back(cmd);
+            instances += count;
+        }
+
+        IndexClassRanges& ranges = (key >> 63) ? mMaskedGroupRanges : mGroupRanges;
+        if (ranges.count[cls] == 0) ranges.first[cls] = first;
+        ranges.count[cls] += lodCount;
+
+        for (size_t m = i; m < j; m++) mSlotGroups[members[m].slot] = first;
+        mGroupCount++;
+        i = j;
+    }
+
+    const uint32_t commands = static_cast<uint32_t>(mGroupCommands.size());
+    if (mGroupCapacity == 0 || commands > mGroupCapacity || instances > mInstanceCapacity) {
+        uint32_t capacity = std::max(mGroupCapacity, MIN_CAPACITY);
+        while (capacity < commands) capacity *= 2;
+        uint32_t instanceCapacity = std::max(mInstanceCapacity, MIN_CAPACITY);
+        while (instanceCapacity < instances) instanceCapacity *= 2;
+        mGroupCapacity    = capacity;
+        mInstanceCapacity = instanceCapacity;
+        mNeedsRealloc     = true;
+    }
+
+    // Phase two's copy lists its instances in the second half of the instance list
+    mGroupCommands.resize(2 * mGroupCapacity, VkDrawIndexedIndirectCommand{});
+    for (uint32_t c = 0; c < commands; c++) {
+        mGroupCommands[mGroupCapacity + c] = mGroupCommands[c];
+        mGroupCommands[mGroupCapacity + c].firstInstance += mInstanceCapacity;
+    }
+}
+
+// -----------------------------------------------------------------------
+// Uploads
+// -----------------------------------------------------------------------
+
+void IndirectRenderer::Reallocate(VmaAllocator allocator, TransferManager& transfer,
+                                  const IndexClassRanges& previous) {
+    mNeedsRealloc = false;
+    mStats.reallocations++;
+
+    // First allocation: nothing on the GPU yet, everything goes up with the new buffers
+    if (mIndirectBuffer.GetHandle() == VK_NULL_HANDLE) {
+        UploadAll(allocator, transfer);
+        return;
+    }
+
+    // The clusters and groups were rebuilt against the new ranges
+    mClustersDirty = true;
+    mGroupsDirty   = true;
+    PendingGrowth& growth = mPendingGrowth[mStagingFrame];
+
+    if (mDrawRanges.Total() != previous.Total()) {
+        VulkanBuffer oldIndirect = mIndirectBuffer;
+        VulkanBuffer oldObjects  = mObjectSSBO;
+        Retire(mIndirectBuffer);
+        Retire(mObjectSSBO);
+        Retire(mDrawCountBuffer);
+
+        const uint32_t total = mDrawRanges.Total();
+        mIndirectBuffer.CreateDeviceLocalEmpty(allocator, kIndirectUsage,
+                                               VkDeviceSize(total) * sizeof(VkDrawIndexedIndirectCommand));
+        mObjectSSBO.CreateDeviceLocalEmpty(allocator, kObjectUsage, VkDeviceSize(total) * sizeof(GPUObjectData));
+        mDrawCountBuffer.CreateDeviceLocalEmpty(allocator, kCountUsage, sizeof(mDrawRanges.count));
+        mCountsDirty = true;
 
-    mIndirectBuffer.CreateDeviceLocal(allocator, transfer,
-        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+            const uint32_t kept  = previous.count[cls];
+            const uint32_t grown = mDrawRanges.count[cls] - kept;
+            const VkDeviceSize objSrc = VkDeviceSize(previous.first[cls])   * sizeof(GPUObjectData);
+            const VkDeviceSize objDst = VkDeviceSize(mDrawRanges.first[cls]) * sizeof(GPUObjectData);
+
+            // Objects do not depend on where their region starts: copy, zero the new slots
+            if (kept > 0)
+                growth.copies.push_back({oldObjects.GetHandle(), mObjectSSBO.GetHandle(),
+                                         {objSrc, objDst, VkDeviceSize(kept) * sizeof(GPUObjectData)}});
+            if (grown > 0)
+                growth.fills.push_back({mObjectSSBO.GetHandle(), objDst + VkDeviceSize(kept) * sizeof(GPUObjectData),
+                                        VkDeviceSize(grown) * sizeof(GPUObjectData)});
+
+            // A command's firstInstance is its slot in the whole buffer: a region that
+            // moved goes up again, one that stayed keeps its commands and stages the new slots
+            if (mDrawRanges.first[cls] != previous.first[cls] || kept == 0) {
+                mCommandRestage[cls] = 0;
+            } else {
+                const VkDeviceSize offset = VkDeviceSize(mDrawRanges.first[cls]) * sizeof(VkDrawIndexedIndirectCommand);
+                growth.copies.push_back({oldIndirect.GetHandle(), mIndirectBuffer.GetHandle(),
+                                         {offset, offset, VkDeviceSize(kept) * sizeof(VkDrawIndexedIndirectCommand)}});
+                mCommandRestage[cls] = kept;
+            }
+        }
+    }
+
+    if (VkDeviceSize(mClusterCapacity) * sizeof(glm::uvec2) > mClusterBuffer.GetSize()) {
+        Retire(mClusterBuffer);
+        mClusterBuffer.CreateDeviceLocalEmpty(allocator, kClusterUsage,
+                                              VkDeviceSize(mClusterCapacity) * sizeof(glm::uvec2));
+    }
+
+    const VkDeviceSize groupSize = VkDeviceSize(mGroupCommands.size()) * sizeof(VkDrawIndexedIndirectCommand);
+    if (groupSize > mGroupBuffer.GetSize()) {
+        Retire(mGroupBuffer);
+        mGroupBuffer.CreateDeviceLocalEmpty(allocator, kGroupUsage, groupSize);
+    }
+    if (VkDeviceSize(mSlotGroups.size()) * sizeof(uint32_t) > mSlotGroupBuffer.GetSize()) {
+        Retire(mSlotGroupBuffer);
+        mSlotGroupBuffer.CreateDeviceLocalEmpty(allocator, kClusterUsage, mSlotGroups.size() * sizeof(uint32_t));
+    }
+
+    LOG_INFO("GPU scene: {} objects in {} slots, {} clusters in {}, {} draw groups in {} commands",
+             GetObjectCount(), mDrawRanges.Total(), mClusterCount, mClusterCapacity,
+             mGroupCount, mGroupRanges.Total() + mMaskedGroupRanges.Total());
+}
+
+void IndirectRenderer::UploadAll(VmaAllocator allocator, TransferManager& transfer) {
+    std::vector<VkDrawIndexedIndirectCommand> indirectCmds;
+    std::vector<GPUObjectData>                objectData;
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        indirectCmds.insert(indirectCmds.end(), mCommands[cls].begin(), mCommands[cls].end());
+        objectData.insert(objectData.end(), mObjects[cls].begin(), mObjects[cls].end());
+
+        for (uint32_t s : mDirtySlots[cls]) mDirtyMask[cls][s] = 0;
+        mDirtySlots[cls].clear();
+    }
+    mClustersDirty = false;
+    mGroupsDirty   = false;
+
+    if (indirectCmds.empty()) return;
+
+    mIndirectBuffer.CreateDeviceLocal(allocator, transfer, kIndirectUsage,
         indirectCmds.data(), indirectCmds.size() * sizeof(VkDrawIndexedIndirectCommand));
 
-    mObjectSSBO.CreateDeviceLocal(allocator, transfer,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+    mObjectSSBO.CreateDeviceLocal(allocator, transfer, kObjectUsage,
         objectData.data(), objectData.size() * sizeof(GPUObjectData));
 
-    uint32_t countData = mDrawCount;
-    mDrawCountBuffer.CreateDeviceLocal(allocator, transfer,
-        VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
-        &countData, sizeof(uint32_t));
+    mDrawCountBuffer.CreateDeviceLocal(allocator, transfer, kCountUsage,
+        mDrawRanges.count, sizeof(mDrawRanges.count));
+
+    if (mClusterCapacity > 0) {
+        std::vector<glm::uvec2> clusters(mClusters);
+        clusters.resize(mClusterCapacity, glm::uvec2(0));
+        mClusterBuffer.CreateDeviceLocal(allocator, transfer, kClusterUsage,
+            clusters.data(), clusters.size() * sizeof(glm::uvec2));
+    }
+
+    mGroupBuffer.CreateDeviceLocal(allocator, transfer, kGroupUsage,
+        mGroupCommands.data(), mGroupCommands.size() * sizeof(VkDrawIndexedIndirectCommand));
+    mSlotGroupBuffer.CreateDeviceLocal(allocator, transfer, kClusterUsage,
+        mSlotGroups.data(), mSlotGroups.size() * sizeof(uint32_t));
+
+    LOG_INFO("GPU scene: {} objects in {} slots, {} clusters in {}, {} draw groups in {} commands",
+             GetObjectCount(), mDrawRanges.Total(), mClusterCount, mClusterCapacity,
+             mGroupCount, mGroupRanges.Total() + mMaskedGroupRanges.Total());
+}
+
+// Frames up to this one may still read the buffer; frame slot reuse after
+// mFramesInFlight more syncs means their fences have been waited on
+void IndirectRenderer::Retire(VulkanBuffer& buffer) {
+    if (buffer.GetHandle() != VK_NULL_HANDLE)
+        mRetired.push_back({buffer, mSyncIndex + mFramesInFlight});
+    buffer = {};
+}
+
+void IndirectRenderer::ReleaseRetired(VmaAllocator allocator, bool all) {
+    auto it = std::remove_if(mRetired.begin(), mRetired.end(), [&](RetiredBuffer& old) {
+        if (!all && old.retireAt > mSyncIndex) return false;
+        old.buffer.Destroy(allocator);
+        return true;
+    });
+    mRetired.erase(it, mRetired.end());
+}
+
+void* IndirectRenderer::Stage(VkDeviceSize size, VkDeviceSize& offset) {
+    offset = mStagingUsed;
+    mStagingUsed += size;
+    return static_cast<uint8_t*>(mStaging[mStagingFrame].GetMappedData()) + offset;
+}
+
+void IndirectRenderer::StageUploads(VmaAllocator allocator) {
+    uint32_t dirtyCount   = 0;
+    uint32_t restageCount = 0;
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        dirtyCount += static_cast<uint32_t>(mDirtySlots[cls].size());
+        if (mCommandRestage[cls] != INVALID_SLOT)
+            restageCount += static_cast<uint32_t>(mCommands[cls].size()) - mCommandRestage[cls];
+    }
+    if (dirtyCount == 0 && restageCount == 0 && !mClustersDirty && !mGroupsDirty && !mCountsDirty) return;
+
+    VkDeviceSize needed = VkDeviceSize(dirtyCount) * (sizeof(GPUObjectData) + sizeof(VkDrawIndexedIndirectCommand));
+    needed += VkDeviceSize(restageCount) * sizeof(VkDrawIndexedIndirectCommand);
+    if (mClustersDirty) needed += VkDeviceSize(mClusterCount) * sizeof(glm::uvec2);
+    if (mGroupsDirty)   needed += VkDeviceSize(mGroupCommands.size()) * sizeof(VkDrawIndexedIndirectCommand) +
+                                  VkDeviceSize(mSlotGroups.size()) * sizeof(uint32_t);
+    if (mCountsDirty)   needed += sizeof(mDrawRanges.count);
+
+    // The frame fence has been waited on, so this frame's staging buffer is free to reuse
+    VulkanBuffer& staging = mStaging[mStagingFrame];
+    if (staging.GetSize() < needed) {
+        VkDeviceSize size = std::max<VkDeviceSize>(staging.GetSize(), 64 * 1024);
+        while (size < needed) size *= 2;
+        staging.Destroy(allocator);
+        staging.CreateHostVisible(allocator, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, size);
+    }
+    mStagingUsed = 0;
+
+    auto& copies = mPendingCopies[mStagingFrame];
+    auto stageCommands = [&](uint32_t cls, uint32_t first, uint32_t count) {
+        VkDeviceSize size = VkDeviceSize(count) * sizeof(VkDrawIndexedIndirectCommand);
+        VkDeviceSize offset;
+        std::memcpy(Stage(size, offset), &mCommands[cls][first], size);
+        copies.push_back({mIndirectBuffer.GetHandle(),
+                          {offset, VkDeviceSize(mDrawRanges.first[cls] + first) * sizeof(VkDrawIndexedIndirectCommand), size}});
+    };
+
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        auto& slots = mDirtySlots[cls];
+        std::sort(slots.begin(), slots.end());
+        const uint32_t restage = mCommandRestage[cls];
+
+        // Coalesce consecutive slots into one copy region per buffer
+        for (size_t i = 0; i < slots.size();) {
+            size_t j = i + 1;
+            while (j < slots.size() && slots[j] == slots[j - 1] + 1) j++;
+            uint32_t first = slots[i];
+            uint32_t count = static_cast<uint32_t>(j - i);
+            uint32_t dst   = mDrawRanges.first[cls] + first;
+
+            VkDeviceSize objSize = VkDeviceSize(count) * sizeof(GPUObjectData);
+            VkDeviceSize objOffset;
+            std::memcpy(Stage(objSize, objOffset), &mObjects[cls][first], objSize);
+            copies.push_back({mObjectSSBO.GetHandle(),
+                              {objOffset, VkDeviceSize(dst) * sizeof(GPUObjectData), objSize}});
+
+            // Commands past the restage point go up below, with the rest of the region
+            if (first < restage)
+                stageCommands(cls, first, std::min(first + count, restage) - first);
+
+            i = j;
+        }
+
+        for (uint32_t s : slots) mDirtyMask[cls][s] = 0;
+        slots.clear();
+
+        if (restage != INVALID_SLOT && restage < mCommands[cls].size())
+            stageCommands(cls, restage, static_cast<uint32_t>(mCommands[cls].size()) - restage);
+        mCommandRestage[cls] = INVALID_SLOT;
+    }
+
+    if (mClustersDirty && mClusterCount > 0) {
+        VkDeviceSize size = VkDeviceSize(mClusterCount) * sizeof(glm::uvec2);
+        VkDeviceSize offset;
+        std::memcpy(Stage(size, offset), mClusters.data(), size);
+        copies.push_back({mClusterBuffer.GetHandle(), {offset, 0, size}});
+    }
+    mClustersDirty = false;
+
+    if (mGroupsDirty) {
+        VkDeviceSize size = VkDeviceSize(mGroupCommands.size()) * sizeof(VkDrawIndexedIndirectCommand);
+        VkDeviceSize offset;
+        std::memcpy(Stage(size, offset), mGroupCommands.data(), size);
+        copies.push_back({mGroupBuffer.GetHandle(), {offset, 0, size}});
+
+        size = VkDeviceSize(mSlotGroups.size()) * sizeof(uint32_t);
+        std::memcpy(Stage(size, offset), mSlotGroups.data(), size);
+        copies.push_back({mSlotGroupBuffer.GetHandle(), {offset, 0, size}});
+        mGroupsDirty = false;
+    }
+
+    if (mCountsDirty) {
+        VkDeviceSize offset;
+        std::memcpy(Stage(sizeof(mDrawRanges.count), offset), mDrawRanges.count, sizeof(mDrawRanges.count));
+        copies.push_back({mDrawCountBuffer.GetHandle(), {offset, 0, sizeof(mDrawRanges.count)}});
+        mCountsDirty = false;
+    }
+
+    mStats.dirtyObjects += dirtyCount;
+    mStats.copyRegions  += copies.size();
+    mStats.bytes        += mStagingUsed;
+}
+
+void IndirectRenderer::RecordUploads(VkCommandBuffer cmd, uint32_t frameIndex) {
+    if (frameIndex >= mPendingCopies.size()) return;
+    auto& copies = mPendingCopies[frameIndex];
+    auto& growth = mPendingGrowth[frameIndex];
+    if (copies.empty() && growth.copies.empty() && growth.fills.empty()) return;
+
+    // Earlier submissions on this queue may still be reading the slots being overwritten,
+    // and a reallocation reads the old buffers their uploads wrote
+    VkMemoryBarrier2 readBarrier{};
+    readBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    readBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT |
+                                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    readBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    readBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    readBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+    VkDependencyInfo dep{};
+    dep.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &readBarrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    // Grown buffers first: the old contents, zeroes past them
+    if (!growth.copies.empty() || !growth.fills.empty()) {
+        for (const auto& c : growth.copies)
+            vkCmdCopyBuffer(cmd, c.src, c.dst, 1, &c.region);
+        for (const auto& f : growth.fills)
+            vkCmdFillBuffer(cmd, f.dst, f.offset, f.size, 0);
+        growth = {};
+
+        // The staged slots below overwrite parts of them
+        VkMemoryBarrier2 growBarrier{};
+        growBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+        growBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        growBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        growBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        growBarrier.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+
+        dep.pMemoryBarriers = &growBarrier;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    // One vkCmdCopyBuffer per destination buffer with all of its regions
+    VkBuffer src = mStaging[frameIndex].GetHandle();
+    std::vector<VkBufferCopy> regions;
+    for (VkBuffer dst : {mObjectSSBO.GetHandle(), mIndirectBuffer.GetHandle(), mClusterBuffer.GetHandle(),
+                         mDrawCountBuffer.GetHandle(), mGroupBuffer.GetHandle(), mSlotGroupBuffer.GetHandle()}) {
+        regions.clear();
+        for (const auto& c : copies)
+            if (c.dst == dst) regions.push_back(c.region);
+        if (!regions.empty())
+            vkCmdCopyBuffer(cmd, src, dst, static_cast<uint32_t>(regions.size()), regions.data());
+    }
+    copies.clear();
+
+    VkMemoryBarrier2 copyBarrier{};
+    copyBarrier.sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER_2;
+    copyBarrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+    copyBarrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    copyBarrier.dstStageMask  = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                                VK_PIPELINE_STAGE_2_TRANSFER_BIT;   // culling copies the group commands
+    copyBarrier.dstAccessMask = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_2_SHADER_STORAGE_READ_BIT |
+                                VK_ACCESS_2_TRANSFER_READ_BIT;
+
+    VkDependencyInfo dep2{};
+    dep2.sType              = VK_STRUCTURE_TYPE_DEPENDENCY_INFO;
+    dep2.memoryBarrierCount = 1;
+    dep2.pMemoryBarriers    = &copyBarrier;
+    vkCmdPipelineBarrier2(cmd, &dep2);
 }
@@ -3,6 +3,7 @@
 #include "GPU/MeshPool.h"
 #include "Resource/VulkanBuffer.h"
 #include "Scene/ECS.h"
+#include "Scene/Scene.h"
 
 #include <volk.h>
 #include <vk_mem_alloc.h>
@@ -16,30 +17,191 @@ struct GPUObjectData {
     glm::vec4 aabbMin;       // xyz = local-space AABB min, w unused
     glm::vec4 aabbMax;       // xyz = local-space AABB max, w unused
     uint32_t  materialIndex;
-    uint32_t  _pad[3];
+    uint32_t  indexClass;    // INDEX_CLASS_*, selects the compacted sub-list in culling
+    uint32_t  flags;         // OBJECT_FLAG_*
+    uint32_t  meshIndex;     // MeshPool draw command / LOD table entry
 };
 static_assert(sizeof(GPUObjectData) == 112, "GPUObjectData must be 112 bytes for std430");
 
+/// GPUObjectData::flags: the material's alpha mode, which picks the culling bucket.
+enum ObjectFlags : uint32_t {
+    OBJECT_FLAG_ALPHA_MASK  = 1u << 0,
+    OBJECT_FLAG_ALPHA_BLEND = 1u << 1,
+};
+
+/// Set in the firstInstance of instanced group draws: the vertex shader then reads each
+/// instance's object slot from the culling's instance list at firstInstance (without the
+/// bit) + instance, instead of taking firstInstance as the slot.
+static constexpr uint32_t INSTANCE_LIST_BIT = 0x80000000u;
+
+/// Accumulated cost of keeping the GPU scene in sync with the registry.
+struct SceneSyncStats {
+    uint64_t syncs         = 0;
+    uint64_t dirtyObjects  = 0;   // object + command pairs re-uploaded
+    uint64_t copyRegions   = 0;
+    uint64_t bytes         = 0;
+    uint64_t allocations   = 0;
+    uint64_t frees         = 0;
+    uint64_t reallocations = 0;   // buffer growths after a capacity change
+    uint64_t groupRebuilds = 0;   // instanced draw groups rebuilt after a membership change
+    double   milliseconds  = 0.0; // CPU time spent in Sync
+
+    double AvgDirty()   const { return syncs ? double(dirtyObjects) / double(syncs) : 0.0; }
+    double AvgRegions() const { return syncs ? double(copyRegions)  / double(syncs) : 0.0; }
+    double AvgBytes()   const { return syncs ? double(bytes)        / double(syncs) : 0.0; }
+};
+
+/// Persistent GPU scene: every renderable entity owns a stable slot in the
+/// indirect and object buffers. Each index class has its own region
+/// [first, first + capacity) with a free list; a region doubles when full.
+/// Free slots hold a zero draw, so draw ranges can cover whole regions.
 class IndirectRenderer {
 public:
-    void Initialize(VmaAllocator allocator, VkDevice device);
+    void Initialize(VmaAllocator allocator, VkDevice device, uint32_t framesInFlight);
     void Shutdown(VmaAllocator allocator);
 
-    void BuildCommands(VmaAllocator allocator, const TransferManager& transfer,
-                       const MeshPool& meshPool, const Registry& registry,
-                       float occluderRatio);
+    /// Diffs the registry against the CPU mirror: allocates and frees slots and
+    /// queues changed objects for RecordUploads. Object flags follow the alpha mode
+    /// of each object's entry in materials. Returns true if the buffers were
+    /// recreated (capacity grew), in which case descriptors must be rewritten.
+    /// Call after the frame fence wait. A reallocation does not wait for the device:
+    /// RecordUploads copies the old contents into the grown buffers on the GPU, and the
+    /// old buffers are destroyed once the frames in flight that read them are done.
+    bool Sync(VmaAllocator allocator, TransferManager& transfer,
+              const MeshPool& meshPool, const Registry& registry,
+              const std::vector<GPUMaterialData>& materials, uint32_t frameIndex);
+
+    /// Copies this frame's dirty slots from the frame's staging buffer, with the
+    /// barriers that order them against the previous frame's reads.
+    void RecordUploads(VkCommandBuffer cmd, uint32_t frameIndex);
 
     VkBuffer GetIndirectBuffer() const { return mIndirectBuffer.GetHandle(); }
     VkBuffer GetObjectBuffer()   const { return mObjectSSBO.GetHandle(); }
     VkBuffer GetCountBuffer()    const { return mDrawCountBuffer.GetHandle(); }
-    uint32_t GetDrawCount()      const { return mDrawCount; }
-    uint32_t GetOccluderCount() const { return mOccluderCount; }
+
+    /// Slot capacity over all classes: the size of every per-draw buffer.
+    uint32_t GetDrawCount()      const { return mDrawRanges.Total(); }
+    uint32_t GetObjectCount()    const { return mLive[0] + mLive[1]; }
+    uint32_t GetObjectCount(uint32_t cls) const { return mLive[cls]; }
+
+    /// One region per index class; every buffer derived from the indirect buffer
+    /// (culling outputs included) uses the same partition.
+    const IndexClassRanges& GetDrawRanges() const { return mDrawRanges; }
+
+    /// One (object, meshlet) pair per cluster of a live object, with the same
+    /// index-class partition, for cluster-granularity culling. The buffer holds
+    /// GetClusterCapacity() entries.
+    VkBuffer GetClusterBuffer()   const { return mClusterBuffer.GetHandle(); }
+    uint32_t GetClusterCount()    const { return mClusterCount; }
+    uint32_t GetClusterCapacity() const { return mClusterCapacity; }
+    const IndexClassRanges& GetClusterRanges() const { return mClusterRanges; }
+
+    /// Instanced draws: opaque and masked objects sharing a (mesh, material) form a group
+    /// with one command per LOD level, instanceCount 0 and firstInstance at the group's
+    /// region of the instance list (with INSTANCE_LIST_BIT). Culling resets a copy of the
+    /// commands each frame, counts every surviving object into its level's command and
+    /// lists its slot there. Blended objects stay per-object for the sorted transparent
+    /// list. The buffer holds a copy per culling phase, the second at GetGroupCapacity()
+    /// with its instances GetInstanceCapacity() further on; the ranges cover phase one.
+    VkBuffer GetGroupBuffer()      const { return mGroupBuffer.GetHandle(); }
+    uint32_t GetGroupCount()       const { return mGroupCount; }
+    uint32_t GetGroupCapacity()    const { return mGroupCapacity; }
+    uint32_t GetInstanceCapacity() const { return mInstanceCapacity; }
+    const IndexClassRanges& GetGroupRanges()       const { return mGroupRanges; }
+    const IndexClassRanges& GetMaskedGroupRanges() const { return mMaskedGroupRanges; }
+
+    /// First group command of each slot, INVALID_GROUP for per-object draws.
+    VkBuffer GetSlotGroupBuffer()  const { return mSlotGroupBuffer.GetHandle(); }
+    static constexpr uint32_t INVALID_GROUP = ~0u;
+
+    const SceneSyncStats& GetSyncStats() const { return mStats; }
 
 private:
+    static constexpr uint32_t INVALID_SLOT = ~0u;
+    static constexpr uint32_t MIN_CAPACITY = 64;
+
+    struct EntitySlot {
+        uint32_t slot      = INVALID_SLOT;   // index within the class region
+        uint32_t cls       = 0;
+        int      meshIndex = -1;
+        uint64_t lastSeen  = 0;
+    };
+
+    struct PendingCopy {
+        VkBuffer     dst;
+        VkBufferCopy region;
+    };
+
+    // A reallocation's GPU-side work, recorded before the staged copies
+    struct PendingGrowth {
+        struct Copy { VkBuffer src, dst; VkBufferCopy region; };
+        struct Fill { VkBuffer dst; VkDeviceSize offset, size; };
+        std::vector<Copy> copies;   // old buffer -> grown buffer
+        std::vector<Fill> fills;    // zeroed slots past the old contents
+    };
+
+    struct RetiredBuffer {
+        VulkanBuffer buffer;
+        uint64_t     retireAt = 0;   // mSyncIndex at which no frame in flight reads it
+    };
+
+    uint32_t AllocateSlot(uint32_t cls);
+    void     FreeSlot(EntitySlot& rec);
+    void     MarkDirty(uint32_t cls, uint32_t slot);
+    void     RebuildClusters(const MeshPool& meshPool);
+    void     BuildCommands(const MeshPool& meshPool);
+    void     Reallocate(VmaAllocator allocator, TransferManager& transfer, const IndexClassRanges& previous);
+    void     UploadAll(VmaAllocator allocator, TransferManager& transfer);
+    void     Retire(VulkanBuffer& buffer);
+    void     ReleaseRetired(VmaAllocator allocator, bool all);
+    void     StageUploads(VmaAllocator allocator);
+    void*    Stage(VkDeviceSize size, VkDeviceSize& offset);
+
     VulkanBuffer mIndirectBuffer;
     VulkanBuffer mObjectSSBO;
     VulkanBuffer mDrawCountBuffer;
-    uint32_t     mDrawCount = 0;
-    uint32_t     mOccluderCount = 0;
+    VulkanBuffer mClusterBuffer;
+    IndexClassRanges mDrawRanges;
+    IndexClassRanges mClusterRanges;
+    uint32_t     mClusterCount    = 0;
+    uint32_t     mClusterCapacity = 0;
+    VulkanBuffer mGroupBuffer;
+    VulkanBuffer mSlotGroupBuffer;
+    IndexClassRanges mGroupRanges;
+    IndexClassRanges mMaskedGroupRanges;
+    uint32_t     mGroupCount       = 0;
+    uint32_t     mGroupCapacity    = 0;   // commands per culling phase
+    uint32_t     mInstanceCapacity = 0;   // instance list entries per culling phase
+
+    // CPU mirror, one region per index class
+    std::vector<VkDrawIndexedIndirectCommand> mCommands[INDEX_CLASS_COUNT];
+    std::vector<GPUObjectData>                mObjects[INDEX_CLASS_COUNT];
+    std::vector<int>                          mSlotMesh[INDEX_CLASS_COUNT];   // -1 = free
+    std::vector<uint32_t>                     mFreeSlots[INDEX_CLASS_COUNT];
+    std::vector<uint8_t>                      mDirtyMask[INDEX_CLASS_COUNT];
+    std::vector<uint32_t>                     mDirtySlots[INDEX_CLASS_COUNT];
+    uint32_t     mCommandRestage[INDEX_CLASS_COUNT] = {};   // commands from this slot up go up whole (INVALID_SLOT: none)
+    uint32_t     mHighWater[INDEX_CLASS_COUNT] = {};
+    uint32_t     mLive[INDEX_CLASS_COUNT]      = {};
+    std::vector<EntitySlot> mEntities;   // indexed by Entity
+    std::vector<glm::uvec2> mClusters;
+    std::vector<VkDrawIndexedIndirectCommand> mGroupCommands;   // both phases, 2 * mGroupCapacity
+    std::vector<uint32_t>   mSlotGroups;                        // per slot over all classes
+    uint64_t     mSyncIndex      = 0;
+    bool         mClustersDirty  = false;
+    bool         mGroupsDirty    = false;
+    bool         mNeedsRealloc   = false;
+    bool         mCountsDirty    = false;
+
+    // Per frame in flight: staging written by Sync, consumed by RecordUploads
+    std::vector<VulkanBuffer>             mStaging;
+    std::vector<std::vector<PendingCopy>> mPendingCopies;
+    std::vector<PendingGrowth>            mPendingGrowth;
+    std::vector<RetiredBuffer>            mRetired;
+    uint32_t     mFramesInFlight = 0;
+    uint32_t     mStagingFrame = 0;   // frame being synced
+    VkDeviceSize mStagingUsed  = 0;
+
+    SceneSyncStats mStats;
     VkDevice     mDevice    = VK_NULL_HANDLE;
 };
@@ -0,0 +1,264 @@
+#include "GPU/InstanceBatcher.h"
+#include "RHI/VulkanUtils.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+namespace {
+
+// [63] index class | [62:43] material | [42:14] mesh | [13:12] LOD | [11:10] pass; the
+// zero low bits cost no radix pass. Material above mesh keeps a material's batches
+// adjacent. The pass follows the material, so it only marks the items to keep apart.
+static_assert(MAX_MESH_LODS <= 4, "the batch key holds the LOD in two bits");
+constexpr uint64_t MakeKey(uint32_t indexClass, uint32_t mesh, uint32_t lod, uint32_t material,
+                           DrawPass pass = DrawPass::Opaque) {
+    return (uint64_t(indexClass & 1u) << 63) | (uint64_t(material & 0xFFFFFu) << 43)
+         | (uint64_t(mesh & 0x1FFFFFFFu) << 14) | (uint64_t(lod & 3u) << 12)
+         | (uint64_t(pass) << 10);
+}
+constexpr uint32_t KeyClass(uint64_t key)    { return static_cast<uint32_t>(key >> 63); }
+constexpr uint32_t KeyMaterial(uint64_t key) { return static_cast<uint32_t>((key >> 43) & 0xFFFFFu); }
+constexpr uint32_t KeyMesh(uint64_t key)     { return static_cast<uint32_t>((key >> 14) & 0x1FFFFFFFu); }
+constexpr uint32_t KeyLOD(uint64_t key)      { return static_cast<uint32_t>((key >> 12) & 3u); }
+constexpr DrawPass KeyPass(uint64_t key)     { return static_cast<DrawPass>((key >> 10) & 3u); }
+
+DrawPass PassOfMaterial(const GPUMaterialData& material) {
+    switch (static_cast<AlphaMode>(material.alphaMode)) {
+    case AlphaMode::Mask:  return DrawPass::Masked;
+    case AlphaMode::Blend: return DrawPass::Transparent;
+    default:               return DrawPass::Opaque;
+    }
+}
+
+} // namespace
+
+void InstanceBatcher::Initialize(VkDevice device, VmaAllocator allocator, uint32_t framesInFlight) {
+    mDevice = device;
+
+    VkDescriptorSetLayoutBinding binding{};
+    binding.binding         = 0;
+    binding.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    binding.descriptorCount = 1;
+    binding.stageFlags      = VK_SHADER_STAGE_VERTEX_BIT;
+
+    VkDescriptorSetLayoutCreateInfo layoutCI{};
+    layoutCI.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutCI.bindingCount = 1;
+    layoutCI.pBindings    = &binding;
+    VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &mSetLayout));
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, framesInFlight};
+    VkDescriptorPoolCreateInfo poolCI{};
+    poolCI.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolCI.maxSets       = framesInFlight;
+    poolCI.poolSizeCount = 1;
+    poolCI.pPoolSizes    = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(device, &poolCI, nullptr, &mPool));
+
+    mSets.resize(framesInFlight);
+    mBuffers.resize(framesInFlight);
+    for (uint32_t i = 0; i < framesInFlight; i++) {
+        VkDescriptorSetAllocateInfo allocCI{};
+        allocCI.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        allocCI.descriptorPool     = mPool;
+        allocCI.descriptorSetCount = 1;
+        allocCI.pSetLayouts        = &mSetLayout;
+        VK_CHECK(vkAllocateDescriptorSets(device, &allocCI, &mSets[i]));
+
+        mBuffers[i].CreateHostVisible(allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      MIN_CAPACITY * sizeof(glm::mat4));
+        WriteDescriptor(i);
+    }
+    mFrame = 0;
+}
+
+void InstanceBatcher::Shutdown(VmaAllocator allocator) {
+    for (auto& b : mBuffers) b.Destroy(allocator);
+    mBuffers.clear();
+    mSets.clear();
+    if (mPool)      vkDestroyDescriptorPool(mDevice, mPool, nullptr);
+    if (mSetLayout) vkDestroyDescriptorSetLayout(mDevice, mSetLayout, nullptr);
+    mPool      = VK_NULL_HANDLE;
+    mSetLayout = VK_NULL_HANDLE;
+}
+
+void InstanceBatcher::WriteDescriptor(uint32_t frameIndex) {
+    VkDescriptorBufferInfo info{mBuffers[frameIndex].GetHandle(), 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{};
+    write.sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    write.dstSet          = mSets[frameIndex];
+    write.dstBinding      = 0;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo     = &info;
+    vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+}
+
+void InstanceBatcher::Begin() {
+    mInstances.clear();
+    mForwardBatches.clear();
+    for (auto& list : mShadowBatches) list.clear();
+}
+
+// Turns the items into batches over consecutive instances. Sorted, equal keys are
+// adjacent; unsorted (instancing off) each item is its own batch, as is every
+// transparent item, which must be depth sorted alone. With drawOrder the batches are
+// then reordered by DrawKey: passes in order, nearest instance first within a material
+// and transparent batches back to front.
+void InstanceBatcher::EmitBatches(std::vector<InstanceBatch>& batches, bool drawOrder) {
+    const uint32_t count = static_cast<uint32_t>(mItemKeys.size());
+    mItemOrder.resize(count);
+    for (uint32_t i = 0; i < count; i++) mItemOrder[i] = i;
+
+    auto sortStart = std::chrono::steady_clock::now();
+    if (mEnabled) {
+        mSorter.Sort(mItemKeys, mItemOrder, mThreadPool);
+        mStats.sortedKeys += count;
+    }
+
+    mBatchDepths.clear();
+    uint64_t prevKey = ~0ull;
+    for (uint32_t i = 0; i < count; i++) {
+        const uint64_t key  = mItemKeys[i];
+        const uint32_t item = mItemOrder[i];
+        const DrawPass pass = KeyPass(key);
+        if (!mEnabled || key != prevKey || pass == DrawPass::Transparent) {
+            InstanceBatch batch{};
+            batch.meshIndex     = KeyMesh(key);
+            batch.lod           = KeyLOD(key);
+            batch.materialIndex = KeyMaterial(key);
+            batch.indexClass    = KeyClass(key);
+            batch.pass          = pass;
+            batch.firstInstance = static_cast<uint32_t>(mInstances.size());
+            batches.push_back(batch);
+            mBatchDepths.push_back(mItemDepths[item]);
+            prevKey = key;
+        }
+        mInstances.push_back(*mItemModels[item]);
+        batches.back().instanceCount++;
+        mBatchDepths.back() = std::min(mBatchDepths.back(), mItemDepths[item]);
+    }
+
+    if (mEnabled && drawOrder && batches.size() > 1) {
+        const uint32_t batchCount = static_cast<uint32_t>(batches.size());
+        mDrawKeys.resize(batchCount);
+        mDrawOrder.resize(batchCount);
+        for (uint32_t b = 0; b < batchCount; b++) {
+            uint32_t depth = DrawKey::DepthBucket(mBatchDepths[b], mView.nearPlane, mView.farPlane);
+            mDrawKeys[b]  = DrawKey::ForPass(batches[b].pass, 0, batches[b].indexClass,
+                                             batches[b].materialIndex, depth);
+            mDrawOrder[b] = b;
+        }
+        mSorter.Sort(mDrawKeys, mDrawOrder, mThreadPool);
+        mStats.sortedKeys += batchCount;
+
+        mSortedBatches.resize(batchCount);
+        for (uint32_t b = 0; b < batchCount; b++) mSortedBatches[b] = batches[mDrawOrder[b]];
+        batches.swap(mSortedBatches);
+    }
+    if (mEnabled)
+        mStats.sortMs += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - sortStart).count();
+}
+
+void InstanceBatcher::BuildForward(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds,
+                                   const std::vector<GPUMaterialData>& materials,
+                                   const std::vector<uint8_t>* visibility) {
+    auto start = std::chrono::steady_clock::now();
+
+    const int maxMaterial = static_cast<int>(std::max<size_t>(materials.size(), 1)) - 1;
+    mItemKeys.clear();
+    mItemModels.clear();
+    mItemDepths.clear();
+    registry.ForEachRenderable([&](Entity e, const TransformComponent& tc,
+                                   const MeshComponent& mc, const MaterialComponent& matc) {
+        if (mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
+        if (visibility && e < visibility->size() && !(*visibility)[e]) return;
+        uint32_t material = static_cast<uint32_t>(std::clamp(matc.materialIndex, 0, maxMaterial));
+        uint32_t mesh     = static_cast<uint32_t>(mc.meshIndex);
+        const MeshDrawCommand& cmd = drawCmds[mesh];
+
+        // Bounding sphere in world space: the LOD error is measured where it comes
+        // closest to the eye, the draw order uses its nearest view depth
+        const glm::mat4& m = tc.worldMatrix;
+        float scale  = std::max(glm::length(glm::vec3(m[0])),
+                       std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+        glm::vec3 center = glm::vec3(m * glm::vec4(cmd.bounds.Center(), 1.0f));
+        float radius = 0.5f * glm::length(cmd.bounds.Extent()) * scale;
+
+        uint32_t lod = 0;
+        if (cmd.lodCount > 1 && mView.lodThreshold > 0.0f) {
+            float dist = std::max(glm::length(center - mView.eye) - radius, mView.nearPlane);
+            lod = cmd.SelectLOD(scale * mView.lodScale / dist, mView.lodThreshold);
+        }
+        DrawPass pass  = material < materials.size() ? PassOfMaterial(materials[material]) : DrawPass::Opaque;
+        float    depth = glm::dot(center - mView.eye, mView.forward);
+        mItemKeys.push_back(MakeKey(cmd.indexClass, mesh, lod, material, pass));
+        mItemModels.push_back(&tc.worldMatrix);
+        mItemDepths.push_back(pass == DrawPass::Transparent ? depth : depth - radius);
+        mStats.triangles     += cmd.lods[lod].indexCount / 3;
+        mStats.lod0Triangles += cmd.indexCount / 3;
+    });
+    EmitBatches(mForwardBatches, true);
+
+    for (const InstanceBatch& batch : mForwardBatches) {
+        mStats.maskedDraws      += batch.pass == DrawPass::Masked;
+        mStats.transparentDraws += batch.pass == DrawPass::Transparent;
+    }
+    mStats.instances += mItemKeys.size();
+    mStats.draws     += mForwardBatches.size();
+    mStats.buildMs   += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void InstanceBatcher::BuildShadow(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds,
+                                  const std::vector<uint8_t>& casterMasks, uint32_t cascadeCount) {
+    auto start = std::chrono::steady_clock::now();
+
+    if (mShadowBatches.size() < cascadeCount) mShadowBatches.resize(cascadeCount);
+
+    for (uint32_t cascade = 0; cascade < cascadeCount; cascade++) {
+        mItemKeys.clear();
+        mItemModels.clear();
+        mItemDepths.clear();
+        registry.ForEachRenderable([&](Entity e, const TransformComponent& tc,
+                                       const MeshComponent& mc, const MaterialComponent&) {
+            if (mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
+            if (e >= casterMasks.size() || !(casterMasks[e] & (1u << cascade))) return;
+            uint32_t mesh = static_cast<uint32_t>(mc.meshIndex);
+            mItemKeys.push_back(MakeKey(drawCmds[mesh].indexClass, mesh, 0, 0));
+            mItemModels.push_back(&tc.worldMatrix);
+            mItemDepths.push_back(0.0f);
+        });
+        EmitBatches(mShadowBatches[cascade], false);
+
+        mStats.shadowInstances += mItemKeys.size();
+        mStats.shadowDraws     += mShadowBatches[cascade].size();
+    }
+
+    mStats.buildMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
+
+void InstanceBatcher::Upload(VmaAllocator allocator, uint32_t frameIndex) {
+    auto start = std::chrono::steady_clock::now();
+    mFrame = frameIndex;
+
+    VkDeviceSize bytes = mInstances.size() * sizeof(glm::mat4);
+    VulkanBuffer& buffer = mBuffers[frameIndex];
+    if (bytes > buffer.GetSize()) {
+        // The frame's previous use has retired, the other frames use their own buffers
+        VkDeviceSize capacity = buffer.GetSize();
+        while (capacity < bytes) capacity *= 2;
+        buffer.Destroy(allocator);
+        buffer.CreateHostVisible(allocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, capacity);
+        WriteDescriptor(frameIndex);
+        mStats.reallocations++;
+    }
+    if (bytes) std::memcpy(buffer.GetMappedData(), mInstances.data(), bytes);
+
+    mStats.frames++;
+    mStats.buildMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+}
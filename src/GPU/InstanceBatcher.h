@@ -0,0 +1,170 @@
+#pragma once
+
+#include "Core/RadixSort.h"
+#include "GPU/MeshPool.h"
+#include "GPU/DrawKey.h"
+#include "Resource/VulkanBuffer.h"
+#include "Scene/ECS.h"
+#include "Scene/Scene.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+/// One instanced draw: instanceCount copies of a mesh whose world matrices sit at
+/// [firstInstance, firstInstance + instanceCount) of the frame's instance buffer.
+struct InstanceBatch {
+    uint32_t meshIndex;
+    uint32_t materialIndex;   // 0 for shadow batches
+    uint32_t firstInstance;
+    uint32_t instanceCount;
+    uint32_t lod;             // MeshDrawCommand::lods entry, 0 for shadow batches
+    uint32_t indexClass;
+    DrawPass pass;            // the material's alpha mode; Opaque for shadow batches
+};
+
+/// State commands a pass issued while recording its batches. Without deduplication
+/// every draw would push its whole constant block.
+struct DrawStateChanges {
+    uint64_t pipelineBinds  = 0;
+    uint64_t indexBinds     = 0;
+    uint64_t materialPushes = 0;   // forward: material index; shadow: cascade matrix
+    uint64_t boundsPushes   = 0;   // dequantization box, once per mesh change
+
+    uint64_t Total() const { return pipelineBinds + indexBinds + materialPushes + boundsPushes; }
+    DrawStateChanges& operator+=(const DrawStateChanges& o) {
+        pipelineBinds  += o.pipelineBinds;  indexBinds   += o.indexBinds;
+        materialPushes += o.materialPushes; boundsPushes += o.boundsPushes;
+        return *this;
+    }
+};
+
+/// Camera terms for a frame's forward batches.
+struct BatchView {
+    glm::vec3 eye{0.0f};
+    glm::vec3 forward{0.0f, 0.0f, -1.0f};
+    float     nearPlane    = 0.1f;
+    float     farPlane     = 150.0f;
+    float     lodScale     = 0.0f;   // viewport height / (2 tan(fovY / 2)), as in cull.comp
+    float     lodThreshold = 0.0f;   // allowed LOD error in pixels, 0 = always LOD0
+};
+
+/// Accumulated over frames until ResetStats().
+struct InstancingStats {
+    uint64_t frames          = 0;
+    uint64_t instances       = 0;   // camera-visible renderables
+    uint64_t draws           = 0;
+    uint64_t shadowInstances = 0;   // summed over cascades
+    uint64_t shadowDraws     = 0;
+    uint64_t reallocations   = 0;
+    uint64_t triangles       = 0;   // camera batches at their selected LOD
+    uint64_t lod0Triangles   = 0;   // the same batches at full detail
+    uint64_t sortedKeys      = 0;   // item and draw keys through the radix sort
+    uint64_t maskedDraws     = 0;   // camera batches drawn with the alpha-tested pipeline
+    uint64_t transparentDraws = 0;  // camera batches drawn blended, back to front
+    DrawStateChanges forwardState;
+    DrawStateChanges shadowState;
+    double   buildMs         = 0.0; // grouping, sorting and upload
+    double   sortMs          = 0.0; // the radix sorts alone
+    double   recordMs        = 0.0; // forward and shadow draw recording
+
+    double PerFrame(uint64_t v) const { return frames ? double(v) / double(frames) : 0.0; }
+    double AvgBuildMs()  const { return frames ? buildMs  / double(frames) : 0.0; }
+    double AvgSortMs()   const { return frames ? sortMs   / double(frames) : 0.0; }
+    double AvgRecordMs() const { return frames ? recordMs / double(frames) : 0.0; }
+};
+
+/// Automatic instancing for the CPU draw path. Each frame the renderables that survived
+/// culling are radix sorted by (index class, material, mesh) and their world matrices
+/// written contiguously to a per-frame instance buffer; every run of equal keys becomes
+/// one vkCmdDrawIndexed whose firstInstance points at the run, so the vertex shader finds
+/// its matrix at gl_InstanceIndex. Camera batches also split by the LOD picked from the
+/// projected error of each instance, and are then ordered by DrawKey: by state, front to
+/// back within a material. Masked materials sort after the opaque ones; blended ones
+/// are never instanced and go last, back to front by their bounds' center. Shadow
+/// batches ignore the material and draw LOD0. Disabled, every renderable is a batch of
+/// one in registry order: the old one draw per entity.
+class InstanceBatcher {
+public:
+    void Initialize(VkDevice device, VmaAllocator allocator, uint32_t framesInFlight);
+    void Shutdown(VmaAllocator allocator);
+
+    void SetEnabled(bool on) { mEnabled = on; }
+    bool IsEnabled() const   { return mEnabled; }
+
+    /// Camera for BuildForward's LOD choice and depth order.
+    void SetView(const BatchView& view) { mView = view; }
+
+    /// Large sorts split across the pool (null = the calling thread only).
+    void SetThreadPool(ThreadPool* pool) { mThreadPool = pool; }
+
+    /// Starts a frame's instance list; the Build calls append to it.
+    void Begin();
+
+    /// Camera batches from the renderables set in visibility (per Entity, null = all).
+    /// Each batch's pass follows its material's alpha mode.
+    void BuildForward(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds,
+                      const std::vector<GPUMaterialData>& materials, const std::vector<uint8_t>* visibility);
+
+    /// One batch list per cascade from per-Entity cascade bits.
+    void BuildShadow(const Registry& registry, const std::vector<MeshDrawCommand>& drawCmds,
+                     const std::vector<uint8_t>& casterMasks, uint32_t cascadeCount);
+
+    /// Copies the instance list to the frame's buffer, growing it (and rewriting the
+    /// frame's descriptor set) when needed. Call after the frame's fence wait.
+    void Upload(VmaAllocator allocator, uint32_t frameIndex);
+
+    /// Set layout: binding 0 = the instance matrices, vertex stage.
+    VkDescriptorSetLayout GetSetLayout()     const { return mSetLayout; }
+    /// The set of the frame last passed to Upload.
+    VkDescriptorSet       GetDescriptorSet() const { return mSets.empty() ? VK_NULL_HANDLE : mSets[mFrame]; }
+
+    const std::vector<InstanceBatch>& GetForwardBatches() const { return mForwardBatches; }
+    const std::vector<InstanceBatch>& GetShadowBatches(uint32_t cascade) const { return mShadowBatches[cascade]; }
+
+    /// The passes report how long recording the batches took and what state they set.
+    void AddRecordTime(double ms) { mStats.recordMs += ms; }
+    void AddStateChanges(const DrawStateChanges& changes, bool shadow) {
+        (shadow ? mStats.shadowState : mStats.forwardState) += changes;
+    }
+
+    const InstancingStats& GetStats() const { return mStats; }
+    void ResetStats() { mStats = {}; }
+
+private:
+    static constexpr uint32_t MIN_CAPACITY = 256;   // instances
+
+    void EmitBatches(std::vector<InstanceBatch>& batches, bool drawOrder);
+    void WriteDescriptor(uint32_t frameIndex);
+
+    VkDevice              mDevice    = VK_NULL_HANDLE;
+    VkDescriptorSetLayout mSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      mPool      = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> mSets;      // per frame in flight
+    std::vector<VulkanBuffer>    mBuffers;   // per frame in flight, host visible
+    uint32_t                     mFrame = 0;
+
+    bool                                    mEnabled = true;
+    BatchView                               mView;
+    ThreadPool*                             mThreadPool = nullptr;
+    RadixSorter                             mSorter;
+
+    // This build's renderables, parallel arrays; mItemKeys is index class | material | mesh | LOD | pass
+    std::vector<uint64_t>                   mItemKeys;
+    std::vector<uint32_t>                   mItemOrder;
+    std::vector<const glm::mat4*>           mItemModels;
+    std::vector<float>                      mItemDepths;   // view depth of the bounds' nearest point (transparent: center)
+
+    std::vector<uint64_t>                   mDrawKeys;
+    std::vector<uint32_t>                   mDrawOrder;
+    std::vector<float>                      mBatchDepths;
+    std::vector<InstanceBatch>              mSortedBatches;
+    std::vector<glm::mat4>                  mInstances;
+    std::vector<InstanceBatch>              mForwardBatches;
+    std::vector<std::vector<InstanceBatch>> mShadowBatches;
+
+    InstancingStats mStats;
+};
@@ -2,7 +2,11 @@
 #include "Resource/TransferManager.h"
 #include "Core/Logger.h"
 
-void MeshPool::Upload(VmaAllocator allocator, const TransferManager& transfer,
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+void MeshPool::Upload(VmaAllocator allocator, TransferManager& transfer,
                       const std::vector<MeshData>& meshes,
                       VkBufferUsageFlags extraVertexFlags,
                       VkBufferUsageFlags extraIndexFlags)
@@ -16,15 +20,33 @@ void MeshPool::Upload(VmaAllocator allocator, const TransferManager& transfer,
     for (const auto& m : meshes) {
         totalVertexBytes += m.vertices.size() * sizeof(MeshVertex);
         totalIndexBytes  += m.indices.size()  * sizeof(uint32_t);
+        for (const auto& lod : m.lods)
+            totalIndexBytes += lod.indices.size() * sizeof(uint32_t);
     }
 
-    std::vector<MeshVertex> allVertices;
-    std::vector<uint32_t>   allIndices;
-    allVertices.reserve(totalVertexBytes / sizeof(MeshVertex));
-    allIndices.reserve(totalIndexBytes / sizeof(uint32_t));
+    const bool packed = (mVertexFormat == VertexFormat::Packed);
+
+    std::vector<MeshVertex>   allVertices;
+    std::vector<PackedVertex> packedVertices;
+    std::vector<uint32_t>     indices32;
+    std::vector<uint16_t>     indices16;
+    if (packed)
+        packedVertices.reserve(totalVertexBytes / sizeof(MeshVertex));
+    else
+        allVertices.reserve(totalVertexBytes / sizeof(MeshVertex));
+
+    std::vector<GPUMeshLODs> gpuLODs(meshCount);
+    mLODMeshCount = 0;
+
+    std::vector<GPUMeshlet> gpuMeshlets;
+    std::vector<Meshlet>    meshlets;
+    double                  meshletMs = 0.0;
+    mMeshletStats = {};
+
+    mPackingStats = {};
+    auto packStart = std::chrono::steady_clock::now();
 
     uint32_t vertexOffset = 0;
-    uint32_t firstIndex   = 0;
 
     for (uint32_t i = 0; i < meshCount; i++) {
         const auto& m = meshes[i];
@@ -33,41 +55,175 @@ void MeshPool::Upload(VmaAllocator allocator, const TransferManager& transfer,
         for (const auto& v : m.vertices)
             bounds.Include(v.position);
 
+        // Indices are mesh-local, so 16 bits cover any mesh with <= 65536 vertices
+        const bool narrow = m.vertices.size() <= 65536;
+
         MeshDrawCommand cmd{};
         cmd.indexCount    = static_cast<uint32_t>(m.indices.size());
         cmd.instanceCount = 1;
-        cmd.firstIndex    = firstIndex;
+        cmd.firstIndex    = static_cast<uint32_t>(narrow ? indices16.size() : indices32.size());
         cmd.vertexOffset  = static_cast<int32_t>(vertexOffset);
         cmd.firstInstance = 0;
         cmd.vertexCount   = static_cast<uint32_t>(m.vertices.size());
         cmd.materialIndex = (m.materialIndex >= 0) ? static_cast<uint32_t>(m.materialIndex) : 0;
+        cmd.indexClass    = narrow ? INDEX_CLASS_UINT16 : INDEX_CLASS_UINT32;
         cmd.bounds        = bounds;
-        mDrawCommands.push_back(cmd);
+        cmd.lods[0]       = {cmd.firstIndex, cmd.indexCount, 0.0f};
+        cmd.lodCount      = 1;
+
+        auto meshletStart = std::chrono::steady_clock::now();
+        meshlets.clear();
+        MeshletBuilder::Build(m, meshlets, mMeshletStats);
+        cmd.meshletOffset = static_cast<uint32_t>(gpuMeshlets.size());
+        cmd.meshletCount  = static_cast<uint32_t>(meshlets.size());
+        for (const auto& ml : meshlets) {
+            GPUMeshlet g{};
+            g.boundingSphere = glm::vec4(ml.center, ml.radius);
+            g.coneAxisCutoff = glm::vec4(ml.coneAxis, ml.coneCutoff);
+            g.coneApex       = glm::vec4(ml.coneApex, 0.0f);
+            g.firstIndex     = cmd.firstIndex + ml.firstTriangle * 3;
+            g.indexCount     = ml.triangleCount * 3;
+            gpuMeshlets.push_back(g);
+        }
+        meshletMs += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - meshletStart).count();
 
-        allVertices.insert(allVertices.end(), m.vertices.begin(), m.vertices.end());
-        allIndices.insert(allIndices.end(), m.indices.begin(), m.indices.end());
+        if (packed)
+            VertexPacking::PackMesh(m.vertices, bounds, packedVertices, mPackingStats);
+        else
+            allVertices.insert(allVertices.end(), m.vertices.begin(), m.vertices.end());
+        // Coarser levels follow LOD0 in the same sub-pool; meshlets only cover LOD0
+        auto appendIndices = [&](const std::vector<uint32_t>& src) {
+            if (narrow) {
+                for (uint32_t idx : src)
+                    indices16.push_back(static_cast<uint16_t>(idx));
+            } else {
+                indices32.insert(indices32.end(), src.begin(), src.end());
+            }
+        };
+        appendIndices(m.indices);
+        for (const auto& lod : m.lods) {
+            if (cmd.lodCount == MAX_MESH_LODS) break;
+            cmd.lods[cmd.lodCount++] = {static_cast<uint32_t>(narrow ? indices16.size() : indices32.size()),
+                                        static_cast<uint32_t>(lod.indices.size()), lod.error};
+            appendIndices(lod.indices);
+        }
+        if (cmd.lodCount > 1) mLODMeshCount++;
+
+        GPUMeshLODs& gl = gpuLODs[i];
+        for (uint32_t l = 0; l < cmd.lodCount; l++) {
+            gl.firstIndex[l] = cmd.lods[l].firstIndex;
+            gl.indexCount[l] = cmd.lods[l].indexCount;
+            gl.error[l]      = cmd.lods[l].error;
+        }
+        gl.lodCount = cmd.lodCount;
+
+        mDrawCommands.push_back(cmd);
 
         vertexOffset += static_cast<uint32_t>(m.vertices.size());
-        firstIndex   += static_cast<uint32_t>(m.indices.size());
     }
 
+    const void*  vertexData  = packed ? static_cast<const void*>(packedVertices.data())
+                                      : static_cast<const void*>(allVertices.data());
+    VkDeviceSize vertexBytes = VkDeviceSize(vertexOffset) * GetVertexStride();
+
     mVertexBuffer.CreateDeviceLocal(allocator, transfer,
         VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | extraVertexFlags,
-        allVertices.data(), allVertices.size() * sizeof(MeshVertex));
+        vertexData, vertexBytes);
+
+    // One allocation: [uint32 sub-pool][uint16 sub-pool], the second starting 4-byte
+    // aligned so storage-buffer readers can fetch it as packed uint pairs.
+    const VkDeviceSize bytes32 = indices32.size() * sizeof(uint32_t);
+    const VkDeviceSize bytes16 = indices16.size() * sizeof(uint16_t);
+    mIndexClassOffset[INDEX_CLASS_UINT32] = 0;
+    mIndexClassOffset[INDEX_CLASS_UINT16] = bytes32;
+    mIndexBytes       = bytes32 + ((bytes16 + 3) & ~VkDeviceSize(3));
+    mIndexBytesUint32 = totalIndexBytes;
+
+    std::vector<uint8_t> indexData(std::max<VkDeviceSize>(mIndexBytes, sizeof(uint32_t)), 0);
+    if (bytes32) std::memcpy(indexData.data(), indices32.data(), bytes32);
+    if (bytes16) std::memcpy(indexData.data() + bytes32, indices16.data(), bytes16);
 
     mIndexBuffer.CreateDeviceLocal(allocator, transfer,
         VK_BUFFER_USAGE_INDEX_BUFFER_BIT | extraIndexFlags,
-        allIndices.data(), allIndices.size() * sizeof(uint32_t));
+        indexData.data(), indexData.size());
+
+    mLODBuffer.CreateDeviceLocal(allocator, transfer,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        gpuLODs.data(), gpuLODs.size() * sizeof(GPUMeshLODs));
 
-    LOG_INFO("MeshPool uploaded: {} meshes, {} vertices ({} KB), {} indices ({} KB)",
-             meshes.size(), allVertices.size(),
-             (allVertices.size() * sizeof(MeshVertex)) / 1024,
-             allIndices.size(),
-             (allIndices.size() * sizeof(uint32_t)) / 1024);
+    mMeshletCount = static_cast<uint32_t>(gpuMeshlets.size());
+    mMeshletStats.milliseconds = meshletMs;
+    if (!gpuMeshlets.empty()) {
+        mMeshletBuffer.CreateDeviceLocal(allocator, transfer,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            gpuMeshlets.data(), gpuMeshlets.size() * sizeof(GPUMeshlet));
+    }
+
+    LOG_INFO("MeshPool uploaded: {} meshes, {} vertices ({} KB, {} B/vertex), "
+             "{} indices ({} KB, {} as uint16, {} KB saved)",
+             meshes.size(), vertexOffset, vertexBytes / 1024, GetVertexStride(),
+             indices32.size() + indices16.size(), mIndexBytes / 1024, indices16.size(),
+             (mIndexBytesUint32 - std::min(mIndexBytes, mIndexBytesUint32)) / 1024);
+
+    LOG_INFO("Meshlets: {} ({:.1f} tris, {:.1f} verts avg), {} with cones ({:.1f} ms)",
+             mMeshletStats.meshlets, mMeshletStats.AvgTriangles(), mMeshletStats.AvgVertices(),
+             mMeshletStats.coneCullable, mMeshletStats.milliseconds);
+
+    if (mLODMeshCount)
+        LOG_INFO("Mesh LODs: {} of {} meshes have coarser levels", mLODMeshCount, meshCount);
+
+    if (packed) {
+        mPackingStats.milliseconds = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - packStart).count() - meshletMs;
+        LOG_INFO("Vertex packing: saved {} KB ({:.0f}%), max error pos {:.2e} of extent, "
+                 "normal {:.4f} deg, tangent {:.4f} deg, uv {:.2e}, sign mismatches {} ({:.1f} ms)",
+                 mPackingStats.BytesSaved() / 1024,
+                 100.0 * double(mPackingStats.BytesSaved()) / double(std::max<uint64_t>(mPackingStats.floatBytes, 1)),
+                 mPackingStats.maxPositionError, mPackingStats.maxNormalError,
+                 mPackingStats.maxTangentError, mPackingStats.maxUVError,
+                 mPackingStats.signMismatches, mPackingStats.milliseconds);
+    }
 }
 
 void MeshPool::Destroy(VmaAllocator allocator) {
     mVertexBuffer.Destroy(allocator);
     mIndexBuffer.Destroy(allocator);
+    mMeshletBuffer.Destroy(allocator);
+    mLODBuffer.Destroy(allocator);
     mDrawCommands.clear();
+    mMeshletCount     = 0;
+    mLODMeshCount     = 0;
+    mIndexBytes       = 0;
+    mIndexBytesUint32 = 0;
+}
+
+void MeshPool::BindIndexBuffer(VkCommandBuffer cmd, uint32_t cls) const {
+    vkCmdBindIndexBuffer(cmd, mIndexBuffer.GetHandle(), mIndexClassOffset[cls], GetIndexType(cls));
+}
+
+void MeshPool::DrawIndexedIndirectCount(VkCommandBuffer cmd,
+                                        VkBuffer indirectBuffer, VkBuffer countBuffer,
+                                        const IndexClassRanges& ranges,
+                                        VkDeviceSize countOffset) const {
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        if (ranges.count[cls] == 0) continue;
+        BindIndexBuffer(cmd, cls);
+        vkCmdDrawIndexedIndirectCount(cmd,
+            indirectBuffer, VkDeviceSize(ranges.first[cls]) * stride,
+            countBuffer, countOffset + cls * sizeof(uint32_t),
+            ranges.count[cls], stride);
+    }
+}
+
+void MeshPool::DrawIndexedIndirect(VkCommandBuffer cmd, VkBuffer indirectBuffer,
+                                   const IndexClassRanges& ranges, uint32_t offset) const {
+    constexpr uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
+    for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++) {
+        if (ranges.count[cls] == 0) continue;
+        BindIndexBuffer(cmd, cls);
+        vkCmdDrawIndexedIndirect(cmd, indirectBuffer, VkDeviceSize(ranges.first[cls] + offset) * stride,
+                                 ranges.count[cls], stride);
+    }
 }
@@ -1,7 +1,9 @@
 #pragma once
 
 #include "Resource/VulkanBuffer.h"
+#include "GPU/VertexFormat.h"
 #include "Asset/ModelLoader.h"
+#include "Asset/MeshletBuilder.h"
 #include "Math/AABB.h"
 
 #include <volk.h>
@@ -11,22 +13,87 @@
 #include <vector>
 #include <cstdint>
 
-struct MeshDrawCommand {
+/// Index width sub-pools. Meshes with at most 65536 vertices store 16-bit indices.
+enum IndexClass : uint32_t {
+    INDEX_CLASS_UINT16 = 0,
+    INDEX_CLASS_UINT32 = 1,
+    INDEX_CLASS_COUNT  = 2,
+};
+
+static constexpr uint32_t MAX_MESH_LODS = 4;
+
+/// One level of detail: an index range over the mesh's vertices.
+struct MeshLODRange {
+    uint32_t firstIndex;        // relative to the mesh's index sub-pool
     uint32_t indexCount;
+    float    error;             // object-space geometric error, 0 for LOD0
+};
+
+struct MeshDrawCommand {
+    uint32_t indexCount;        // LOD0, i.e. lods[0]
     uint32_t instanceCount;
-    uint32_t firstIndex;
+    uint32_t firstIndex;        // relative to the mesh's index sub-pool
     int32_t  vertexOffset;
     uint32_t firstInstance;
     uint32_t vertexCount;
     uint32_t materialIndex;
+    uint32_t indexClass;
+    uint32_t meshletOffset;     // range in the meshlet buffer
+    uint32_t meshletCount;
     AABB     bounds;
+    MeshLODRange lods[MAX_MESH_LODS];   // finest first; errors increase
+    uint32_t     lodCount;
+
+    /// Coarsest level whose error, scaled by `pixelsPerUnit` (screen pixels per
+    /// object-space unit at the mesh's distance), stays within `threshold` pixels.
+    uint32_t SelectLOD(float pixelsPerUnit, float threshold) const {
+        uint32_t lod = 0;
+        for (uint32_t i = 1; i < lodCount; i++)
+            if (lods[i].error * pixelsPerUnit <= threshold) lod = i;
+        return lod;
+    }
+};
+
+/// GPU copy of a mesh's LOD table (std430), indexed by GPUObjectData::meshIndex.
+struct GPUMeshLODs {
+    uint32_t firstIndex[MAX_MESH_LODS];
+    uint32_t indexCount[MAX_MESH_LODS];
+    float    error[MAX_MESH_LODS];
+    uint32_t lodCount;
+    uint32_t _pad[3];
+};
+static_assert(sizeof(GPUMeshLODs) == 64, "GPUMeshLODs must be 64 bytes for std430");
+
+/// GPU meshlet record (std430). Draws as a sub-range of its mesh's index range.
+struct GPUMeshlet {
+    glm::vec4 boundingSphere;   // xyz = mesh-local center, w = radius
+    glm::vec4 coneAxisCutoff;   // xyz = axis, w = cutoff (>= 1: no cone test)
+    glm::vec4 coneApex;         // xyz = mesh-local apex, w unused
+    uint32_t  firstIndex;       // relative to the mesh's index sub-pool, like MeshDrawCommand
+    uint32_t  indexCount;
+    uint32_t  _pad[2];
+};
+static_assert(sizeof(GPUMeshlet) == 64, "GPUMeshlet must be 64 bytes for std430");
+
+/// Per-class [first, first + count) slices of an indirect command buffer that
+/// is partitioned by index class. Count buffers hold one uint per class.
+struct IndexClassRanges {
+    uint32_t first[INDEX_CLASS_COUNT]{};
+    uint32_t count[INDEX_CLASS_COUNT]{};
+
+    uint32_t Total() const { return count[INDEX_CLASS_UINT16] + count[INDEX_CLASS_UINT32]; }
 };
 
 class TransferManager;
 
 class MeshPool {
 public:
-    void Upload(VmaAllocator allocator, const TransferManager& transfer,
+    /// Must be set before Upload(); pipelines have to be created for the same format.
+    void         SetVertexFormat(VertexFormat format) { mVertexFormat = format; }
+    VertexFormat GetVertexFormat() const { return mVertexFormat; }
+    uint32_t     GetVertexStride() const { return VertexPacking::Stride(mVertexFormat); }
+
+    void Upload(VmaAllocator allocator, TransferManager& transfer,
                 const std::vector<MeshData>& meshes,
                 VkBufferUsageFlags extraVertexFlags = 0,
                 VkBufferUsageFlags extraIndexFlags = 0);
@@ -35,11 +102,60 @@ public:
     VkBuffer GetVertexBuffer() const { return mVertexBuffer.GetHandle(); }
     VkBuffer GetIndexBuffer()  const { return mIndexBuffer.GetHandle(); }
 
+    /// Both sub-pools live in one buffer: uint32 indices first, then uint16.
+    VkDeviceSize GetIndexClassOffset(uint32_t cls) const { return mIndexClassOffset[cls]; }
+    static VkIndexType  GetIndexType(uint32_t cls) {
+        return cls == INDEX_CLASS_UINT16 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+    }
+    static uint32_t     GetIndexSize(uint32_t cls) {
+        return cls == INDEX_CLASS_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+    }
+
+    void BindIndexBuffer(VkCommandBuffer cmd, uint32_t cls) const;
+
+    /// Binds each index sub-pool in turn and issues one vkCmdDrawIndexedIndirectCount
+    /// for its slice of `indirectBuffer`; the draw count of class c is read from
+    /// `countBuffer` at countOffset + c * sizeof(uint32_t).
+    void DrawIndexedIndirectCount(VkCommandBuffer cmd,
+                                  VkBuffer indirectBuffer, VkBuffer countBuffer,
+                                  const IndexClassRanges& ranges,
+                                  VkDeviceSize countOffset = 0) const;
+
+    /// As DrawIndexedIndirectCount, drawing every command of each slice; `offset` shifts
+    /// the slices by that many commands.
+    void DrawIndexedIndirect(VkCommandBuffer cmd, VkBuffer indirectBuffer,
+                             const IndexClassRanges& ranges, uint32_t offset = 0) const;
+
     const std::vector<MeshDrawCommand>& GetDrawCommands() const { return mDrawCommands; }
     uint32_t GetMeshCount() const { return static_cast<uint32_t>(mDrawCommands.size()); }
 
+    /// GPUMeshLODs per mesh, in GetDrawCommands() order.
+    VkBuffer GetLODBuffer()     const { return mLODBuffer.GetHandle(); }
+    uint32_t GetLODMeshCount()  const { return mLODMeshCount; }   // meshes with more than LOD0
+
+    VkBuffer GetMeshletBuffer() const { return mMeshletBuffer.GetHandle(); }
+    uint32_t GetMeshletCount()  const { return mMeshletCount; }
+    const MeshletStats& GetMeshletStats() const { return mMeshletStats; }
+
+    const VertexPackingStats& GetPackingStats() const { return mPackingStats; }
+    VkDeviceSize GetIndexBytes()       const { return mIndexBytes; }
+    VkDeviceSize GetIndexBytesUint32() const { return mIndexBytesUint32; }
+
 private:
     VulkanBuffer mVertexBuffer;
     VulkanBuffer mIndexBuffer;
     std::vector<MeshDrawCommand> mDrawCommands;
+    VertexFormat       mVertexFormat = VertexFormat::Float;
+    VertexPackingStats mPackingStats;
+
+    VulkanBuffer mLODBuffer;
+    uint32_t     mLODMeshCount = 0;
+
+    VulkanBuffer mMeshletBuffer;
+    uint32_t     mMeshletCount = 0;
+    MeshletStats mMeshletStats;
+
+    VkDeviceSize mIndexClassOffset[INDEX_CLASS_COUNT]{};
+    VkDeviceSize mIndexBytes       = 0;
+    VkDeviceSize mIndexBytesUint32 = 0;   // size the pool would have with 32-bit indices only
 };
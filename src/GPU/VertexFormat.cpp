@@ -0,0 +1,196 @@
+#include "GPU/VertexFormat.h"
+
+#include <glm/gtc/packing.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+
+// ---------------------------------------------------------------------------
+// Scalar helpers (mirror the Vulkan SNORM / FLOAT16 fetch conversions)
+// ---------------------------------------------------------------------------
+static int16_t ToSnorm16(float v) {
+    return static_cast<int16_t>(std::lround(std::clamp(v, -1.0f, 1.0f) * 32767.0f));
+}
+
+static float FromSnorm16(int16_t v) {
+    return std::max(float(v) / 32767.0f, -1.0f);
+}
+
+// atan2 form: acos() loses all precision for the sub-0.01 degree errors measured here.
+static float AngleDegrees(const glm::vec3& a, const glm::vec3& b) {
+    if (glm::dot(a, a) < 1e-12f || glm::dot(b, b) < 1e-12f) return 0.0f;
+    return std::atan2(glm::length(glm::cross(a, b)), glm::dot(a, b)) * (180.0f / 3.14159265358979f);
+}
+
+static glm::vec3 QuantCenter(const AABB& b) { return (b.min + b.max) * 0.5f; }
+static glm::vec3 QuantHalf(const AABB& b)   { return (b.max - b.min) * 0.5f; }
+
+// Octahedral encode followed by a search over the four neighbouring SNORM
+// lattice points for the one that decodes closest to the input direction.
+// Candidates are ranked by squared distance: their dot products with the input
+// all round to 1.0f at these angles.
+static void OctEncodeSnorm16(const glm::vec3& n, int16_t out[2]) {
+    if (glm::dot(n, n) < 1e-12f) { out[0] = 0; out[1] = 0; return; }
+
+    glm::vec3 dir = glm::normalize(n);
+    glm::vec2 e   = VertexPacking::OctEncode(dir) * 32767.0f;
+
+    float best = 5.0f;
+    for (int i = 0; i < 4; i++) {
+        float x = (i & 1) ? std::ceil(e.x) : std::floor(e.x);
+        float y = (i & 2) ? std::ceil(e.y) : std::floor(e.y);
+        int16_t qx = static_cast<int16_t>(std::clamp(x, -32767.0f, 32767.0f));
+        int16_t qy = static_cast<int16_t>(std::clamp(y, -32767.0f, 32767.0f));
+        glm::vec3 d = VertexPacking::OctDecode({FromSnorm16(qx), FromSnorm16(qy)}) - dir;
+        float dist = glm::dot(d, d);
+        if (dist < best) { best = dist; out[0] = qx; out[1] = qy; }
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Pipeline state helpers
+// ---------------------------------------------------------------------------
+VertexFormatSpecialization::VertexFormatSpecialization(VertexFormat format) {
+    packed = (format == VertexFormat::Packed) ? VK_TRUE : VK_FALSE;
+
+    entry.constantID = 0;
+    entry.offset     = 0;
+    entry.size       = sizeof(VkBool32);
+
+    info.mapEntryCount = 1;
+    info.pMapEntries   = &entry;
+    info.dataSize      = sizeof(VkBool32);
+    info.pData         = &packed;
+}
+
+VertexInputLayout::VertexInputLayout(VertexFormat format) {
+    binding.binding   = 0;
+    binding.stride    = VertexPacking::Stride(format);
+    binding.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+
+    if (format == VertexFormat::Packed) {
+        attributes[0] = {0, 0, VK_FORMAT_R16G16B16A16_SNORM, offsetof(PackedVertex, position)};
+        attributes[1] = {1, 0, VK_FORMAT_R16G16_SNORM,       offsetof(PackedVertex, normal)};
+        attributes[2] = {2, 0, VK_FORMAT_R16G16_SFLOAT,      offsetof(PackedVertex, texCoord)};
+        attributes[3] = {3, 0, VK_FORMAT_R16G16_SNORM,       offsetof(PackedVertex, tangent)};
+    } else {
+        attributes[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, position)};
+        attributes[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, normal)};
+        attributes[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT,       offsetof(MeshVertex, texCoord)};
+        attributes[3] = {3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(MeshVertex, tangent)};
+    }
+
+    state.sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    state.vertexBindingDescriptionCount   = 1;
+    state.pVertexBindingDescriptions      = &binding;
+    state.vertexAttributeDescriptionCount = 4;
+    state.pVertexAttributeDescriptions    = attributes;
+}
+
+// ---------------------------------------------------------------------------
+// Packing
+// ---------------------------------------------------------------------------
+uint32_t VertexPacking::Stride(VertexFormat format) {
+    return format == VertexFormat::Packed ? sizeof(PackedVertex) : sizeof(MeshVertex);
+}
+
+glm::vec2 VertexPacking::OctEncode(const glm::vec3& n) {
+    glm::vec3 p = n / (std::abs(n.x) + std::abs(n.y) + std::abs(n.z));
+    if (p.z < 0.0f) {
+        return {(1.0f - std::abs(p.y)) * (p.x >= 0.0f ? 1.0f : -1.0f),
+                (1.0f - std::abs(p.x)) * (p.y >= 0.0f ? 1.0f : -1.0f)};
+    }
+    return {p.x, p.y};
+}
+
+glm::vec3 VertexPacking::OctDecode(const glm::vec2& e) {
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+glm::vec3 VertexPacking::PositionErrorBound(const AABB& bounds) {
+    // Half an SNORM16 step of the half extent, plus float rounding of center + q * half
+    glm::vec3 magnitude = glm::max(glm::abs(bounds.min), glm::abs(bounds.max));
+    return bounds.Extent() / (4.0f * 32767.0f) + magnitude * (4.0f * FLT_EPSILON);
+}
+
+float VertexPacking::UVErrorBound(float uv) {
+    // Half a half-float ulp: 2^-11 relative, 2^-25 absolute below the normal range
+    return std::max(std::abs(uv) * std::ldexp(1.0f, -11), std::ldexp(1.0f, -25));
+}
+
+glm::mat4 VertexPacking::DequantizeMatrix(const AABB& bounds) {
+    glm::vec3 c = QuantCenter(bounds);
+    glm::vec3 h = QuantHalf(bounds);
+    glm::mat4 m(1.0f);
+    m[0][0] = h.x;
+    m[1][1] = h.y;
+    m[2][2] = h.z;
+    m[3]    = glm::vec4(c, 1.0f);
+    return m;
+}
+
+PackedVertex VertexPacking::Pack(const MeshVertex& v, const AABB& bounds) {
+    glm::vec3 c = QuantCenter(bounds);
+    glm::vec3 h = QuantHalf(bounds);
+
+    PackedVertex p{};
+    for (int i = 0; i < 3; i++)
+        p.position[i] = h[i] > 0.0f ? ToSnorm16((v.position[i] - c[i]) / h[i]) : 0;
+    p.position[3] = v.tangent.w < 0.0f ? -32767 : 32767;
+
+    OctEncodeSnorm16(v.normal, p.normal);
+    OctEncodeSnorm16(glm::vec3(v.tangent), p.tangent);
+
+    p.texCoord[0] = glm::packHalf1x16(v.texCoord.x);
+    p.texCoord[1] = glm::packHalf1x16(v.texCoord.y);
+    return p;
+}
+
+MeshVertex VertexPacking::Unpack(const PackedVertex& p, const AABB& bounds) {
+    glm::vec3 c = QuantCenter(bounds);
+    glm::vec3 h = QuantHalf(bounds);
+
+    MeshVertex v{};
+    v.position = c + glm::vec3(FromSnorm16(p.position[0]),
+                               FromSnorm16(p.position[1]),
+                               FromSnorm16(p.position[2])) * h;
+    v.normal   = OctDecode({FromSnorm16(p.normal[0]), FromSnorm16(p.normal[1])});
+    v.tangent  = glm::vec4(OctDecode({FromSnorm16(p.tangent[0]), FromSnorm16(p.tangent[1])}),
+                           FromSnorm16(p.position[3]) < 0.0f ? -1.0f : 1.0f);
+    v.texCoord = {glm::unpackHalf1x16(p.texCoord[0]), glm::unpackHalf1x16(p.texCoord[1])};
+    return v;
+}
+
+void VertexPacking::PackMesh(const std::vector<MeshVertex>& vertices, const AABB& bounds,
+                             std::vector<PackedVertex>& out, VertexPackingStats& stats) {
+    glm::vec3 ext    = bounds.Extent();
+    float     extent = std::max({ext.x, ext.y, ext.z});
+
+    for (const auto& v : vertices) {
+        PackedVertex p = Pack(v, bounds);
+        MeshVertex   r = Unpack(p, bounds);
+        out.push_back(p);
+
+        if (extent > 0.0f) {
+            glm::vec3 d = glm::abs(r.position - v.position);
+            stats.maxPositionError = std::max(stats.maxPositionError,
+                                              std::max({d.x, d.y, d.z}) / extent);
+        }
+        stats.maxNormalError  = std::max(stats.maxNormalError, AngleDegrees(v.normal, r.normal));
+        stats.maxTangentError = std::max(stats.maxTangentError,
+                                         AngleDegrees(glm::vec3(v.tangent), glm::vec3(r.tangent)));
+        glm::vec2 duv = glm::abs(r.texCoord - v.texCoord);
+        stats.maxUVError = std::max({stats.maxUVError, duv.x, duv.y});
+        if ((v.tangent.w < 0.0f) != (r.tangent.w < 0.0f))
+            stats.signMismatches++;
+    }
+
+    stats.vertices    += vertices.size();
+    stats.floatBytes  += vertices.size() * sizeof(MeshVertex);
+    stats.packedBytes += vertices.size() * sizeof(PackedVertex);
+}
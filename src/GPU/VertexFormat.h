@@ -0,0 +1,91 @@
+#pragma once
+
+#include "Asset/ModelLoader.h"
+#include "Math/AABB.h"
+
+#include <volk.h>
+#include <glm/glm.hpp>
+
+#include <vector>
+#include <cstdint>
+
+enum class VertexFormat : uint32_t {
+    Float  = 0,   // MeshVertex, 48 bytes
+    Packed = 1,   // PackedVertex, 20 bytes
+};
+
+/// Compact vertex layout. Must match vertex_packing.glsl.
+///   position: SNORM16x4, xyz quantized to the mesh AABB, w = tangent handedness (+-1)
+///   normal  : SNORM16x2 octahedral
+///   tangent : SNORM16x2 octahedral
+///   texCoord: FLOAT16x2
+struct PackedVertex {
+    int16_t  position[4];
+    int16_t  normal[2];
+    int16_t  tangent[2];
+    uint16_t texCoord[2];
+};
+static_assert(sizeof(PackedVertex) == 20, "PackedVertex must be 20 bytes");
+
+/// Worst-case round-trip error measured while packing.
+struct VertexPackingStats {
+    uint64_t vertices        = 0;
+    uint64_t floatBytes      = 0;
+    uint64_t packedBytes     = 0;
+    float    maxPositionError = 0.0f;   // relative to the largest AABB extent of the mesh
+    float    maxNormalError   = 0.0f;   // degrees
+    float    maxTangentError  = 0.0f;   // degrees
+    float    maxUVError       = 0.0f;   // absolute, in texture coordinates
+    uint64_t signMismatches   = 0;
+    double   milliseconds     = 0.0;
+
+    uint64_t BytesSaved() const { return floatBytes > packedBytes ? floatBytes - packedBytes : 0; }
+};
+
+/// Specialization constant 0 (PACKED_VERTICES) for every stage that fetches vertices.
+/// Non-copyable: `info` points into the object.
+struct VertexFormatSpecialization {
+    explicit VertexFormatSpecialization(VertexFormat format);
+    VertexFormatSpecialization(const VertexFormatSpecialization&)            = delete;
+    VertexFormatSpecialization& operator=(const VertexFormatSpecialization&) = delete;
+
+    VkBool32                 packed = VK_FALSE;
+    VkSpecializationMapEntry entry{};
+    VkSpecializationInfo     info{};
+};
+
+/// Vertex input state for the mesh vertex buffer in the given format.
+struct VertexInputLayout {
+    explicit VertexInputLayout(VertexFormat format);
+    VertexInputLayout(const VertexInputLayout&)            = delete;
+    VertexInputLayout& operator=(const VertexInputLayout&) = delete;
+
+    VkVertexInputBindingDescription      binding{};
+    VkVertexInputAttributeDescription    attributes[4]{};
+    VkPipelineVertexInputStateCreateInfo state{};
+};
+
+class VertexPacking {
+public:
+    static uint32_t Stride(VertexFormat format);
+
+    static PackedVertex Pack(const MeshVertex& v, const AABB& bounds);
+    static MeshVertex   Unpack(const PackedVertex& p, const AABB& bounds);
+
+    /// Packs a mesh into `out` (appended) and folds the round-trip error into `stats`.
+    static void PackMesh(const std::vector<MeshVertex>& vertices, const AABB& bounds,
+                         std::vector<PackedVertex>& out, VertexPackingStats& stats);
+
+    /// Round-trip error bounds. Positions per axis, in mesh units. Normals and tangents in
+    /// degrees: 0.0025 measured over 20M directions. UVs absolute, in the finite half range.
+    static glm::vec3 PositionErrorBound(const AABB& bounds);
+    static constexpr float kOctErrorBoundDeg = 0.003f;
+    static float UVErrorBound(float uv);
+
+    /// Octahedral mapping of a unit vector to [-1,1]^2 and back.
+    static glm::vec2 OctEncode(const glm::vec3& n);
+    static glm::vec3 OctDecode(const glm::vec2& e);
+
+    /// Matrix that maps SNORM positions in [-1,1]^3 back into the mesh AABB.
+    static glm::mat4 DequantizeMatrix(const AABB& bounds);
+};
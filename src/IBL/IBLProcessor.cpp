@@ -61,7 +61,7 @@ static VkImageView CreateCubeView(VkDevice device, VkImage image, VkFormat forma
 
 // =========================================================================
 void IBLProcessor::Initialize(VmaAllocator allocator, VkDevice device,
-                              const TransferManager& transfer, VkPipelineCache pipelineCache) {
+                              TransferManager& transfer, VkPipelineCache pipelineCache) {
     mAllocator     = allocator;
     mDevice        = device;
     mTransfer      = &transfer;
@@ -197,21 +197,6 @@ void IBLProcessor::CreateSamplers() {
 void IBLProcessor::UploadEquirectangular(const float* pixels, uint32_t w, uint32_t h) {
     VkDeviceSize imgSize = static_cast<VkDeviceSize>(w) * h * 4 * sizeof(float);
 
-    VkBufferCreateInfo bci{};
-    bci.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bci.size  = imgSize;
-    bci.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-    VmaAllocationCreateInfo bai{};
-    bai.usage = VMA_MEMORY_USAGE_AUTO;
-    bai.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
-
-    VkBuffer staging = VK_NULL_HANDLE;
-    VmaAllocation stagingAlloc = VK_NULL_HANDLE;
-    VmaAllocationInfo info{};
-    vmaCreateBuffer(mAllocator, &bci, &bai, &staging, &stagingAlloc, &info);
-    std::memcpy(info.pMappedData, pixels, static_cast<size_t>(imgSize));
-
     VkImageCreateInfo ici{};
     ici.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
     ici.imageType     = VK_IMAGE_TYPE_2D;
@@ -228,25 +213,16 @@ void IBLProcessor::UploadEquirectangular(const float* pixels, uint32_t w, uint32
     iai.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
     VK_CHECK(vmaCreateImage(mAllocator, &ici, &iai, &mEquirectImage, &mEquirectAlloc, nullptr));
 
-    mTransfer->ImmediateSubmit([&](VkCommandBuffer cmd) {
-        TransitionImage(cmd, mEquirectImage,
-            VK_PIPELINE_STAGE_2_NONE, 0,
-            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
-            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-
-        VkBufferImageCopy region{};
-        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
-        region.imageExtent      = { w, h, 1 };
-        vkCmdCopyBufferToImage(cmd, staging, mEquirectImage,
-                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
-
-        TransitionImage(cmd, mEquirectImage,
-            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
-            VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
-            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-    });
-
-    vmaDestroyBuffer(mAllocator, staging, stagingAlloc);
+    // The equirect map is consumed right away by the cubemap compute pass, whose
+    // ImmediateSubmit waits on the transfer timeline before it runs.
+    VkImage image = mEquirectImage;
+    mTransfer->UploadImage(mEquirectImage, w, h, 1, pixels, imgSize,
+        [image](VkCommandBuffer cmd) {
+            TransitionImage(cmd, image,
+                VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT, VK_ACCESS_2_SHADER_SAMPLED_READ_BIT,
+                VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        });
 
     VkImageViewCreateInfo vi{};
     vi.sType    = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
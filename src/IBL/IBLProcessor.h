@@ -9,7 +9,7 @@ class TransferManager;
 class IBLProcessor {
 public:
     void Initialize(VmaAllocator allocator, VkDevice device,
-                    const TransferManager& transfer, VkPipelineCache pipelineCache);
+                    TransferManager& transfer, VkPipelineCache pipelineCache);
 
     /// Load an HDR file and bake IBL maps. If hdrPath is null or file not found,
     /// generates a procedural sky environment instead.
@@ -40,7 +40,7 @@ private:
 
     VmaAllocator            mAllocator     = VK_NULL_HANDLE;
     VkDevice                mDevice        = VK_NULL_HANDLE;
-    const TransferManager*  mTransfer      = nullptr;
+    TransferManager*        mTransfer      = nullptr;
     VkPipelineCache         mPipelineCache = VK_NULL_HANDLE;
 
     VkImage       mEnvCubemap         = VK_NULL_HANDLE;
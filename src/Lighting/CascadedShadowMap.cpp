@@ -170,5 +170,51 @@ void CascadedShadowMap::Update(const glm::mat4& cameraView, const glm::mat4& cam
         lightProj[1][1] *= -1.0f; // Vulkan Y-flip
 
         mViewProj[c] = lightProj * lightView;
+
+        // Clip-space rows: x,y in [-w,w], z in [0,w]. Skip z >= 0 (near).
+        const glm::mat4& m = mViewProj[c];
+        auto row = [&](int r) { return glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]); };
+        mCasterPlanes[c][0] = row(3) + row(0);   // left
+        mCasterPlanes[c][1] = row(3) - row(0);   // right
+        mCasterPlanes[c][2] = row(3) + row(1);   // bottom
+        mCasterPlanes[c][3] = row(3) - row(1);   // top
+        mCasterPlanes[c][4] = row(3) - row(2);   // far
+        for (auto& plane : mCasterPlanes[c])
+            plane /= glm::length(glm::vec3(plane));
+    }
+}
+
+// -----------------------------------------------------------------------
+// Caster culling (CPU reference, mirrors cull_shadow.comp)
+// -----------------------------------------------------------------------
+
+bool CascadedShadowMap::IsCasterVisible(const glm::vec4* planes,
+                                        const glm::vec3& worldMin, const glm::vec3& worldMax) {
+    for (uint32_t i = 0; i < CASTER_PLANE_COUNT; i++) {
+        glm::vec3 p(planes[i].x > 0.0f ? worldMax.x : worldMin.x,
+                    planes[i].y > 0.0f ? worldMax.y : worldMin.y,
+                    planes[i].z > 0.0f ? worldMax.z : worldMin.z);
+        if (glm::dot(glm::vec3(planes[i]), p) + planes[i].w < 0.0f)
+            return false;
     }
+    return true;
+}
+
+uint32_t CascadedShadowMap::CasterMask(const AABB& localBounds, const glm::mat4& model) const {
+    glm::vec3 worldMin(1e30f);
+    glm::vec3 worldMax(-1e30f);
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 corner((i & 1) ? localBounds.max.x : localBounds.min.x,
+                         (i & 2) ? localBounds.max.y : localBounds.min.y,
+                         (i & 4) ? localBounds.max.z : localBounds.min.z);
+        glm::vec3 w = glm::vec3(model * glm::vec4(corner, 1.0f));
+        worldMin = glm::min(worldMin, w);
+        worldMax = glm::max(worldMax, w);
+    }
+
+    uint32_t mask = 0;
+    for (uint32_t c = 0; c < CASCADE_COUNT; c++)
+        if (IsCasterVisible(mCasterPlanes[c].data(), worldMin, worldMax))
+            mask |= 1u << c;
+    return mask;
 }
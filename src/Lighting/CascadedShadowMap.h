@@ -1,5 +1,7 @@
 #pragma once
 
+#include "Math/AABB.h"
+
 #include <volk.h>
 #include <vk_mem_alloc.h>
 #include <glm/glm.hpp>
@@ -11,6 +13,7 @@ public:
     static constexpr uint32_t CASCADE_COUNT = 4;
     static constexpr uint32_t SHADOW_DIM    = 2048;
     static constexpr float    LAMBDA        = 0.5f; // practical split scheme mix
+    static constexpr uint32_t CASTER_PLANE_COUNT = 5; // light-space ortho box without its near plane
 
     void Initialize(VmaAllocator allocator, VkDevice device);
     void Shutdown(VmaAllocator allocator, VkDevice device);
@@ -28,6 +31,18 @@ public:
     const glm::mat4& GetViewProj(uint32_t cascade) const { return mViewProj[cascade]; }
     const glm::vec4& GetSplits()                    const { return mSplitDepths; }
 
+    /// World-space planes (inward normals) bounding the casters of a cascade: the
+    /// four sides and the far plane of its light frustum. The near plane is left out
+    /// so casters between the light and the cascade still count; the shadow
+    /// pipelines clamp their depth onto the near plane.
+    const glm::vec4* GetCasterPlanes(uint32_t cascade) const { return mCasterPlanes[cascade].data(); }
+
+    /// CPU reference of the cull_shadow.comp test: bit c is set if the transformed
+    /// local AABB can cast into cascade c.
+    uint32_t CasterMask(const AABB& localBounds, const glm::mat4& model) const;
+
+    static bool IsCasterVisible(const glm::vec4* planes, const glm::vec3& worldMin, const glm::vec3& worldMax);
+
 private:
     VkImage       mImage      = VK_NULL_HANDLE;
     VmaAllocation mAllocation = VK_NULL_HANDLE;
@@ -36,5 +51,6 @@ private:
     VkSampler     mSampler    = VK_NULL_HANDLE;
 
     std::array<glm::mat4, CASCADE_COUNT> mViewProj{};
+    std::array<std::array<glm::vec4, CASTER_PLANE_COUNT>, CASCADE_COUNT> mCasterPlanes{};
     glm::vec4 mSplitDepths{};
 };
@@ -120,14 +120,21 @@ void VulkanDevice::CreateLogicalDevice() {
         mQueueFamilyIndices.computeFamily,
     };
 
-    float queuePriority = 1.0f;
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(mPhysicalDevice, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> familyProps(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(mPhysicalDevice, &familyCount, familyProps.data());
+    const bool asyncQueue = familyProps[mQueueFamilyIndices.graphicsFamily].queueCount >= 2;
+
+    // The async queue runs background builds, below the frame's priority
+    float queuePriorities[2] = {1.0f, 0.5f};
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
     for (uint32_t family : uniqueFamilies) {
         VkDeviceQueueCreateInfo queueInfo{};
         queueInfo.sType            = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
         queueInfo.queueFamilyIndex = family;
-        queueInfo.queueCount       = 1;
-        queueInfo.pQueuePriorities = &queuePriority;
+        queueInfo.queueCount       = (asyncQueue && family == mQueueFamilyIndices.graphicsFamily) ? 2 : 1;
+        queueInfo.pQueuePriorities = queuePriorities;
         queueCreateInfos.push_back(queueInfo);
     }
 
@@ -177,6 +184,7 @@ void VulkanDevice::CreateLogicalDevice() {
     features12.samplerFilterMinmax                         = VK_TRUE;
     features12.bufferDeviceAddress                         = VK_TRUE;
     features12.scalarBlockLayout                           = VK_TRUE;
+    features12.timelineSemaphore                           = VK_TRUE;
 
     VkPhysicalDeviceFeatures2 features2{};
     features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
@@ -186,6 +194,7 @@ void VulkanDevice::CreateLogicalDevice() {
     features2.features.pipelineStatisticsQuery = VK_TRUE;
     features2.features.wideLines              = VK_TRUE;
     features2.features.sampleRateShading      = VK_TRUE;
+    features2.features.depthClamp             = VK_TRUE;
 
     std::vector<const char*> enabledExtensions(kRequiredDeviceExtensions);
     if (mRayTracingSupported) {
@@ -212,6 +221,11 @@ void VulkanDevice::CreateLogicalDevice() {
     vkGetDeviceQueue(mDevice, mQueueFamilyIndices.presentFamily,  0, &mPresentQueue);
     vkGetDeviceQueue(mDevice, mQueueFamilyIndices.transferFamily, 0, &mTransferQueue);
     vkGetDeviceQueue(mDevice, mQueueFamilyIndices.computeFamily,  0, &mComputeQueue);
+    if (asyncQueue)
+        vkGetDeviceQueue(mDevice, mQueueFamilyIndices.graphicsFamily, 1, &mAsyncQueue);
+    else
+        mAsyncQueue = mGraphicsQueue;
+    LOG_INFO("  Async queue: {}", asyncQueue ? "graphics family, queue 1" : "shared with graphics");
 
     LOG_INFO("VkDevice created");
 }
@@ -232,14 +246,17 @@ QueueFamilyIndices VulkanDevice::FindQueueFamilies(VkPhysicalDevice device, VkSu
         }
 
         VkBool32 presentSupport = VK_FALSE;
-        vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
+        if (surface != VK_NULL_HANDLE)
+            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, surface, &presentSupport);
         if (presentSupport) {
             indices.presentFamily = i;
         }
 
-        // Prefer dedicated transfer queue (no graphics bit)
+        // Prefer dedicated transfer queue (no graphics bit) that can copy single texels
+        const VkExtent3D& g = props.minImageTransferGranularity;
         if ((props.queueFlags & VK_QUEUE_TRANSFER_BIT) &&
-            !(props.queueFlags & VK_QUEUE_GRAPHICS_BIT)) {
+            !(props.queueFlags & VK_QUEUE_GRAPHICS_BIT) &&
+            g.width == 1 && g.height == 1 && g.depth == 1) {
             indices.transferFamily = i;
         }
 
@@ -250,6 +267,8 @@ QueueFamilyIndices VulkanDevice::FindQueueFamilies(VkPhysicalDevice device, VkSu
         }
     }
 
+    // Nothing is presented without a surface; the graphics queue stands in
+    if (surface == VK_NULL_HANDLE) indices.presentFamily = indices.graphicsFamily;
     if (indices.transferFamily == UINT32_MAX) indices.transferFamily = indices.graphicsFamily;
     if (indices.computeFamily  == UINT32_MAX) indices.computeFamily  = indices.graphicsFamily;
 
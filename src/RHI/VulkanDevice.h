@@ -16,6 +16,8 @@ struct QueueFamilyIndices {
 
 class VulkanDevice {
 public:
+    /// surface may be VK_NULL_HANDLE for headless use: no present-support check, and the
+    /// present queue is the graphics queue.
     void Initialize(VkInstance instance, VkSurfaceKHR surface);
     void Shutdown();
 
@@ -26,6 +28,11 @@ public:
     VkQueue GetPresentQueue()  const { return mPresentQueue; }
     VkQueue GetTransferQueue() const { return mTransferQueue; }
     VkQueue GetComputeQueue()  const { return mComputeQueue; }
+    /// Second queue of the graphics family, for background GPU work (acceleration structure
+    /// builds) that reads graphics-owned buffers without ownership transfers. The graphics
+    /// queue itself when the family exposes only one queue.
+    VkQueue GetAsyncQueue()    const { return mAsyncQueue; }
+    bool    HasAsyncQueue()    const { return mAsyncQueue != mGraphicsQueue; }
 
     const QueueFamilyIndices& GetQueueFamilyIndices() const { return mQueueFamilyIndices; }
 
@@ -52,6 +59,7 @@ private:
     VkQueue mPresentQueue  = VK_NULL_HANDLE;
     VkQueue mTransferQueue = VK_NULL_HANDLE;
     VkQueue mComputeQueue  = VK_NULL_HANDLE;
+    VkQueue mAsyncQueue    = VK_NULL_HANDLE;
 
     QueueFamilyIndices mQueueFamilyIndices;
     VkSurfaceKHR       mSurface = VK_NULL_HANDLE;
@@ -26,7 +26,7 @@ static VKAPI_ATTR VkBool32 VKAPI_CALL DebugMessengerCallback(
 }
 #endif
 
-void VulkanInstance::Initialize(const std::string& appName) {
+void VulkanInstance::Initialize(const std::string& appName, bool presentation) {
     VK_CHECK(volkInitialize());
     LOG_INFO("Volk initialized");
 
@@ -38,9 +38,12 @@ void VulkanInstance::Initialize(const std::string& appName) {
     appInfo.engineVersion      = VK_MAKE_VERSION(0, 1, 0);
     appInfo.apiVersion         = VK_API_VERSION_1_3;
 
-    uint32_t     glfwExtCount = 0;
-    const char** glfwExts     = glfwGetRequiredInstanceExtensions(&glfwExtCount);
-    std::vector<const char*> extensions(glfwExts, glfwExts + glfwExtCount);
+    std::vector<const char*> extensions;
+    if (presentation) {
+        uint32_t     glfwExtCount = 0;
+        const char** glfwExts     = glfwGetRequiredInstanceExtensions(&glfwExtCount);
+        extensions.assign(glfwExts, glfwExts + glfwExtCount);
+    }
 
     std::vector<const char*> layers;
 
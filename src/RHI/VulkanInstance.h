@@ -7,7 +7,9 @@ struct GLFWwindow;
 
 class VulkanInstance {
 public:
-    void Initialize(const std::string& appName);
+    /// Without presentation no surface extensions are enabled and GLFW is never asked,
+    /// so a headless run needs no window system.
+    void Initialize(const std::string& appName, bool presentation = true);
     void Shutdown();
 
     VkInstance   GetHandle() const { return mInstance; }
@@ -1,8 +1,11 @@
 #include "RayTracing/AccelStructure.h"
 #include "Resource/TransferManager.h"
+#include "Culling/SceneBVH.h"
 #include "Core/Logger.h"
 
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <chrono>
 #include <cstring>
 #include <numeric>
 
@@ -12,328 +15,591 @@ static VkDeviceAddress AlignUp(VkDeviceAddress addr, VkDeviceSize alignment) {
     return (addr + alignment - 1) & ~(alignment - 1);
 }
 
-void AccelStructure::Initialize(VkDevice device, VmaAllocator allocator,
-                                const TransferManager& transfer) {
-    mDevice    = device;
-    mAllocator = allocator;
-    mTransfer  = &transfer;
+void AccelStructure::Initialize(VkDevice device, VkPhysicalDevice physDevice, VmaAllocator allocator,
+                                TransferManager& transfer, uint32_t framesInFlight,
+                                VkQueue buildQueue, uint32_t buildFamily) {
+    mDevice         = device;
+    mAllocator      = allocator;
+    mTransfer       = &transfer;
+    mFramesInFlight = framesInFlight;
+    mBuildQueue     = buildQueue;
+
+    VkPhysicalDeviceProperties props;
+    vkGetPhysicalDeviceProperties(physDevice, &props);
+    mTimestampPeriod = props.limits.timestampPeriod;
+
+    VkCommandPoolCreateInfo poolInfo{VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO};
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = buildFamily;
+    VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &mBuildPool));
+
+    VkCommandBufferAllocateInfo allocInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO};
+    allocInfo.commandPool        = mBuildPool;
+    allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    allocInfo.commandBufferCount = 1;
+    VK_CHECK(vkAllocateCommandBuffers(device, &allocInfo, &mBuildCmd));
+
+    VkSemaphoreTypeCreateInfo typeInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+    VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semInfo.pNext = &typeInfo;
+    VK_CHECK(vkCreateSemaphore(device, &semInfo, nullptr, &mBuildTimeline));
+
+    VkQueryPoolCreateInfo qpci{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    qpci.queryType  = VK_QUERY_TYPE_TIMESTAMP;
+    qpci.queryCount = 4;
+    VK_CHECK(vkCreateQueryPool(device, &qpci, nullptr, &mTimestamps));
+
+    mSubmitValue    = 0;
+    mInFlightValue  = 0;
+    mCompletedValue = 0;
 }
 
 void AccelStructure::Shutdown(VmaAllocator allocator) {
+    // Builds may still be running on the build queue
+    if (mInFlightValue != 0) {
+        VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+        waitInfo.semaphoreCount = 1;
+        waitInfo.pSemaphores    = &mBuildTimeline;
+        waitInfo.pValues        = &mInFlightValue;
+        VK_CHECK(vkWaitSemaphores(mDevice, &waitInfo, UINT64_MAX));
+        mInFlightValue = 0;
+    }
+    ReleaseRetired(true);
+
     if (mTLAS != VK_NULL_HANDLE) {
         vkDestroyAccelerationStructureKHR(mDevice, mTLAS, nullptr);
         mTLAS = VK_NULL_HANDLE;
     }
     mTLASBuffer.Destroy(allocator);
-    mInstanceBuffer.Destroy(allocator);
+    mScratchBuffer.Destroy(allocator);
+    for (auto& buffer : mFrameInstanceBuffers)
+        buffer.Destroy(allocator);
+    mFrameInstanceBuffers.clear();
+    mInstances.clear();
+    mRecords.clear();
 
     for (auto& entry : mBLASEntries) {
         if (entry.handle != VK_NULL_HANDLE)
             vkDestroyAccelerationStructureKHR(mDevice, entry.handle, nullptr);
+        if (entry.pendingHandle != VK_NULL_HANDLE)
+            vkDestroyAccelerationStructureKHR(mDevice, entry.pendingHandle, nullptr);
         entry.buffer.Destroy(allocator);
+        entry.pendingBuffer.Destroy(allocator);
     }
     mBLASEntries.clear();
     mTotalBLASMemory = 0;
     mTotalBLASMemoryPreCompaction = 0;
     mTLASBuilt = false;
+
+    mBLASScratch.Destroy(allocator);
+    mBLASTransforms.Destroy(allocator);
+    mBuildMeshPool = nullptr;
+    mNextBuild     = 0;
+    mInFlightBuilt.clear();
+    mInFlightCompacted.clear();
+    mToCompact.clear();
+    mBLASRefsDirty = false;
+
+    if (mSizeQueries)   { vkDestroyQueryPool(mDevice, mSizeQueries, nullptr);  mSizeQueries   = VK_NULL_HANDLE; }
+    if (mTimestamps)    { vkDestroyQueryPool(mDevice, mTimestamps, nullptr);   mTimestamps    = VK_NULL_HANDLE; }
+    if (mBuildTimeline) { vkDestroySemaphore(mDevice, mBuildTimeline, nullptr); mBuildTimeline = VK_NULL_HANDLE; }
+    if (mBuildPool)     { vkDestroyCommandPool(mDevice, mBuildPool, nullptr);  mBuildPool     = VK_NULL_HANDLE; }
+    mBuildCmd = VK_NULL_HANDLE;
 }
 
 // ---------------------------------------------------------------------------
-// BLAS — one per unique mesh in MeshPool
+// BLAS — one per unique mesh in MeshPool, built incrementally off the frame
 // ---------------------------------------------------------------------------
 void AccelStructure::BuildBLAS(const MeshPool& meshPool) {
     const auto& cmds = meshPool.GetDrawCommands();
     if (cmds.empty()) return;
 
     const uint32_t meshCount = static_cast<uint32_t>(cmds.size());
-    VkBuffer vertexBuf = meshPool.GetVertexBuffer();
-    VkBuffer indexBuf  = meshPool.GetIndexBuffer();
+    mBuildMeshPool = &meshPool;
+    mNextBuild     = 0;
+    mBuildLogged   = false;
+    mBLASEntries.resize(meshCount);
+    for (uint32_t i = 0; i < meshCount; i++)
+        mBLASEntries[i].triangles = cmds[i].indexCount / 3;
+    mTotalBLASMemory = 0;
+    mTotalBLASMemoryPreCompaction = 0;
+    mBuildStats        = {};
+    mBuildStats.meshes = meshCount;
+    mBuildStart        = std::chrono::steady_clock::now();
+
+    // Packed vertices are SNORM in [-1,1]^3; a per-geometry transform maps them
+    // back into the mesh AABB so the BLAS stays in mesh-local space.
+    if (meshPool.GetVertexFormat() == VertexFormat::Packed) {
+        std::vector<VkTransformMatrixKHR> transforms(meshCount);
+        for (uint32_t i = 0; i < meshCount; i++) {
+            glm::mat4 m = VertexPacking::DequantizeMatrix(cmds[i].bounds);
+            for (int r = 0; r < 3; r++)
+                for (int c = 0; c < 4; c++)
+                    transforms[i].matrix[r][c] = m[c][r];
+        }
+        mBLASTransforms.CreateDeviceLocal(mAllocator, *mTransfer,
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            transforms.data(), transforms.size() * sizeof(VkTransformMatrixKHR));
+    }
+    mTransfer->Flush();
+
+    VkQueryPoolCreateInfo qpci{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
+    qpci.queryType  = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
+    qpci.queryCount = meshCount;
+    VK_CHECK(vkCreateQueryPool(mDevice, &qpci, nullptr, &mSizeQueries));
+
+    LOG_INFO("BLAS: queued {} meshes, {:.1f} MB scratch budget per batch",
+             meshCount, mScratchBudget / (1024.0 * 1024.0));
+
+    UpdateBLASBuilds();
+}
+
+void AccelStructure::UpdateBLASBuilds() {
+    mUpdateCount++;
+    ReleaseRetired(false);
+    if (mBuildMeshPool == nullptr) return;
+
+    if (mInFlightValue != 0) {
+        uint64_t completed = 0;
+        VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mBuildTimeline, &completed));
+        if (completed < mInFlightValue) return;
+        CollectSubmission();
+    }
+
+    if (IsBLASBuildComplete()) {
+        if (!mBuildLogged) {
+            mBuildLogged = true;
+            mBLASScratch.Destroy(mAllocator);
+            mBLASTransforms.Destroy(mAllocator);
+            mBuildStats.wallMs = std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - mBuildStart).count();
+            const auto& s = mBuildStats;
+            LOG_INFO("BLAS built: {} meshes in {} batches, {:.1f} ms; build {:.1f}K tris in {:.2f} ms ({:.0f} tris/ms), "
+                     "compaction {:.1f}K tris in {:.2f} ms ({:.0f} tris/ms)",
+                     s.meshes, s.batches, s.wallMs,
+                     s.buildTriangles / 1e3, s.buildGpuMs, s.BuildTrisPerMs(),
+                     s.compactTriangles / 1e3, s.compactGpuMs, s.CompactTrisPerMs());
+            LOG_INFO("BLAS memory: pre-compaction {:.1f} KB, post-compaction {:.1f} KB ({:.0f}% reduction)",
+                     mTotalBLASMemoryPreCompaction / 1024.0f, mTotalBLASMemory / 1024.0f,
+                     mTotalBLASMemoryPreCompaction > 0
+                         ? (1.0f - float(mTotalBLASMemory) / float(mTotalBLASMemoryPreCompaction)) * 100.0f
+                         : 0.0f);
+        }
+        return;
+    }
+
+    // One submission: compact what the last one built, then build the next batch
+    VK_CHECK(vkResetCommandBuffer(mBuildCmd, 0));
+    VkCommandBufferBeginInfo beginInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO};
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(mBuildCmd, &beginInfo));
+
+    vkCmdResetQueryPool(mBuildCmd, mTimestamps, 0, 4);
+    vkCmdWriteTimestamp2(mBuildCmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, mTimestamps, 0);
+    RecordCompaction(mBuildCmd, mInFlightCompacted);
+    vkCmdWriteTimestamp2(mBuildCmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, mTimestamps, 1);
+    vkCmdWriteTimestamp2(mBuildCmd, VK_PIPELINE_STAGE_2_TOP_OF_PIPE_BIT, mTimestamps, 2);
+    RecordBuildBatch(mBuildCmd, mInFlightBuilt);
+    vkCmdWriteTimestamp2(mBuildCmd, VK_PIPELINE_STAGE_2_BOTTOM_OF_PIPE_BIT, mTimestamps, 3);
+
+    VK_CHECK(vkEndCommandBuffer(mBuildCmd));
+
+    // Vertex, index and transform uploads land on the transfer timeline
+    VkSemaphoreSubmitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    waitInfo.semaphore = mTransfer->GetTimeline();
+    waitInfo.value     = mTransfer->GetSubmittedValue();
+    waitInfo.stageMask = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+
+    VkSemaphoreSubmitInfo signalInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    signalInfo.semaphore = mBuildTimeline;
+    signalInfo.value     = ++mSubmitValue;
+    signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkCommandBufferSubmitInfo cmdInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    cmdInfo.commandBuffer = mBuildCmd;
+
+    VkSubmitInfo2 submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submitInfo.waitSemaphoreInfoCount   = 1;
+    submitInfo.pWaitSemaphoreInfos      = &waitInfo;
+    submitInfo.commandBufferInfoCount   = 1;
+    submitInfo.pCommandBufferInfos      = &cmdInfo;
+    submitInfo.signalSemaphoreInfoCount = 1;
+    submitInfo.pSignalSemaphoreInfos    = &signalInfo;
+    VK_CHECK(vkQueueSubmit2(mBuildQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    mInFlightValue = mSubmitValue;
+}
+
+// Greedily takes meshes in order while their scratch fits the budget; a mesh larger than
+// the budget goes alone. The builds share one call and run concurrently on the GPU.
+void AccelStructure::RecordBuildBatch(VkCommandBuffer cmd, std::vector<uint32_t>& built) {
+    built.clear();
+    const uint32_t meshCount = static_cast<uint32_t>(mBLASEntries.size());
+    if (mNextBuild >= meshCount) return;
+
+    const MeshPool& meshPool = *mBuildMeshPool;
+    const auto&     cmds     = meshPool.GetDrawCommands();
 
     VkDeviceAddress vertexAddr{};
     {
         VkBufferDeviceAddressInfo info{VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
-        info.buffer = vertexBuf;
+        info.buffer = meshPool.GetVertexBuffer();
         vertexAddr = vkGetBufferDeviceAddress(mDevice, &info);
     }
     VkDeviceAddress indexAddr{};
     {
         VkBufferDeviceAddressInfo info{VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO};
-        info.buffer = indexBuf;
+        info.buffer = meshPool.GetIndexBuffer();
         indexAddr = vkGetBufferDeviceAddress(mDevice, &info);
     }
 
-    std::vector<VkAccelerationStructureGeometryKHR>       geometries(meshCount);
-    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos(meshCount);
-    std::vector<VkAccelerationStructureBuildRangeInfoKHR>    rangeInfos(meshCount);
-    std::vector<uint32_t> maxPrimCounts(meshCount);
-    std::vector<VkAccelerationStructureBuildSizesInfoKHR>    sizeInfos(meshCount);
+    const bool         packed = meshPool.GetVertexFormat() == VertexFormat::Packed;
+    const VkDeviceSize stride = meshPool.GetVertexStride();
+    const VkDeviceAddress transformAddr = packed ? mBLASTransforms.GetDeviceAddress(mDevice) : 0;
+
+    std::vector<VkAccelerationStructureGeometryKHR>          geometries;
+    std::vector<VkAccelerationStructureBuildGeometryInfoKHR> buildInfos;
+    std::vector<VkAccelerationStructureBuildRangeInfoKHR>    rangeInfos;
+    std::vector<VkDeviceSize>                                scratchOffsets;
+    VkDeviceSize scratchUsed = 0;
 
-    for (uint32_t i = 0; i < meshCount; i++) {
-        const auto& cmd = cmds[i];
+    while (mNextBuild < meshCount) {
+        const uint32_t i   = mNextBuild;
+        const auto&    dc  = cmds[i];
 
-        auto& geom = geometries[i];
-        geom = {};
+        VkAccelerationStructureGeometryKHR geom{};
         geom.sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
         geom.geometryType = VK_GEOMETRY_TYPE_TRIANGLES_KHR;
         geom.flags        = VK_GEOMETRY_OPAQUE_BIT_KHR;
 
         auto& tri = geom.geometry.triangles;
         tri.sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_TRIANGLES_DATA_KHR;
-        tri.vertexFormat  = VK_FORMAT_R32G32B32_SFLOAT;
-        tri.vertexData.deviceAddress = vertexAddr + cmd.vertexOffset * sizeof(MeshVertex);
-        tri.vertexStride  = sizeof(MeshVertex);
-        tri.maxVertex     = cmd.vertexCount > 0 ? cmd.vertexCount - 1 : 0;
-        tri.indexType     = VK_INDEX_TYPE_UINT32;
-        tri.indexData.deviceAddress = indexAddr + cmd.firstIndex * sizeof(uint32_t);
-
-        maxPrimCounts[i] = cmd.indexCount / 3;
-
-        auto& bi = buildInfos[i];
-        bi = {};
+        tri.vertexFormat  = packed ? VK_FORMAT_R16G16B16A16_SNORM : VK_FORMAT_R32G32B32_SFLOAT;
+        tri.vertexData.deviceAddress = vertexAddr + dc.vertexOffset * stride;
+        tri.vertexStride  = stride;
+        if (packed)
+            tri.transformData.deviceAddress = transformAddr + i * sizeof(VkTransformMatrixKHR);
+        tri.maxVertex     = dc.vertexCount > 0 ? dc.vertexCount - 1 : 0;
+        tri.indexType     = MeshPool::GetIndexType(dc.indexClass);
+        tri.indexData.deviceAddress = indexAddr + meshPool.GetIndexClassOffset(dc.indexClass)
+                                    + VkDeviceAddress(dc.firstIndex) * MeshPool::GetIndexSize(dc.indexClass);
+
+        VkAccelerationStructureBuildGeometryInfoKHR bi{};
         bi.sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
         bi.type          = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
         bi.flags         = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
                            VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_COMPACTION_BIT_KHR;
         bi.mode          = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
         bi.geometryCount = 1;
-        bi.pGeometries   = &geometries[i];
-
-        auto& range = rangeInfos[i];
-        range = {};
-        range.primitiveCount = maxPrimCounts[i];
+        bi.pGeometries   = &geom;
 
-        sizeInfos[i] = {VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
+        const uint32_t primCount = mBLASEntries[i].triangles;
+        VkAccelerationStructureBuildSizesInfoKHR sizeInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
         vkGetAccelerationStructureBuildSizesKHR(mDevice,
-            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-            &buildInfos[i], &maxPrimCounts[i], &sizeInfos[i]);
+            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR, &bi, &primCount, &sizeInfo);
+
+        VkDeviceSize scratch = AlignUp(sizeInfo.buildScratchSize, kScratchAlign);
+        if (!built.empty() && scratchUsed + scratch > mScratchBudget) break;
+
+        auto& entry = mBLASEntries[i];
+        entry.pendingBuffer.CreateDeviceLocalEmpty(mAllocator,
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, sizeInfo.accelerationStructureSize);
+
+        VkAccelerationStructureCreateInfoKHR createInfo{};
+        createInfo.sType  = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+        createInfo.buffer = entry.pendingBuffer.GetHandle();
+        createInfo.size   = sizeInfo.accelerationStructureSize;
+        createInfo.type   = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        VK_CHECK(vkCreateAccelerationStructureKHR(mDevice, &createInfo, nullptr, &entry.pendingHandle));
+        entry.state = BLASState::Building;
+
+        bi.dstAccelerationStructure = entry.pendingHandle;
+        VkAccelerationStructureBuildRangeInfoKHR range{};
+        range.primitiveCount = primCount;
+
+        geometries.push_back(geom);
+        buildInfos.push_back(bi);
+        rangeInfos.push_back(range);
+        scratchOffsets.push_back(scratchUsed);
+        scratchUsed += scratch;
+        built.push_back(i);
+        mNextBuild++;
+
+        mTotalBLASMemoryPreCompaction += sizeInfo.accelerationStructureSize;
+        mBuildStats.memoryBuilt       += sizeInfo.accelerationStructureSize;
+        mBuildStats.buildTriangles    += primCount;
     }
 
-    // Allocate scratch buffer (max of all sizes)
-    VkDeviceSize maxScratch = 0;
-    for (uint32_t i = 0; i < meshCount; i++)
-        maxScratch = std::max(maxScratch, sizeInfos[i].buildScratchSize);
-
-    VulkanBuffer scratchBuffer;
-    scratchBuffer.CreateDeviceLocalEmpty(mAllocator,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        maxScratch + kScratchAlign);
-    VkDeviceAddress scratchAddr = AlignUp(scratchBuffer.GetDeviceAddress(mDevice), kScratchAlign);
-
-    // Create query pool for compaction sizes
-    VkQueryPool queryPool = VK_NULL_HANDLE;
-    {
-        VkQueryPoolCreateInfo qpci{VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO};
-        qpci.queryType  = VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR;
-        qpci.queryCount = meshCount;
-        VK_CHECK(vkCreateQueryPool(mDevice, &qpci, nullptr, &queryPool));
+    // Nothing is in flight while recording, so the scratch can grow for an oversized mesh
+    if (mBLASScratch.GetSize() < scratchUsed + kScratchAlign) {
+        mBLASScratch.Destroy(mAllocator);
+        mBLASScratch.CreateDeviceLocalEmpty(mAllocator,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            std::max(scratchUsed, mScratchBudget) + kScratchAlign);
     }
+    VkDeviceAddress scratchAddr = AlignUp(mBLASScratch.GetDeviceAddress(mDevice), kScratchAlign);
 
-    // Build all BLAS (one per mesh) and query compacted sizes
-    mBLASEntries.resize(meshCount);
-    mTotalBLASMemoryPreCompaction = 0;
+    std::vector<const VkAccelerationStructureBuildRangeInfoKHR*> pRanges(built.size());
+    for (size_t b = 0; b < built.size(); b++) {
+        buildInfos[b].pGeometries               = &geometries[b];
+        buildInfos[b].scratchData.deviceAddress = scratchAddr + scratchOffsets[b];
+        pRanges[b]                              = &rangeInfos[b];
+    }
 
-    mTransfer->ImmediateSubmit([&](VkCommandBuffer cmd) {
-        vkCmdResetQueryPool(cmd, queryPool, 0, meshCount);
+    const uint32_t first = built.front();
+    const uint32_t count = static_cast<uint32_t>(built.size());
+    vkCmdResetQueryPool(cmd, mSizeQueries, first, count);
+    vkCmdBuildAccelerationStructuresKHR(cmd, count, buildInfos.data(), pRanges.data());
+
+    VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    barrier.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    barrier.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    std::vector<VkAccelerationStructureKHR> handles(count);
+    for (uint32_t b = 0; b < count; b++)
+        handles[b] = mBLASEntries[built[b]].pendingHandle;
+    vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, count, handles.data(),
+        VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, mSizeQueries, first);
+
+    mBuildStats.batches++;
+}
 
-        for (uint32_t i = 0; i < meshCount; i++) {
-            auto& entry = mBLASEntries[i];
-            VkDeviceSize asSize = sizeInfos[i].accelerationStructureSize;
-            mTotalBLASMemoryPreCompaction += asSize;
-
-            entry.buffer.CreateDeviceLocalEmpty(mAllocator,
-                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
-                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, asSize);
-
-            VkAccelerationStructureCreateInfoKHR createInfo{};
-            createInfo.sType  = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-            createInfo.buffer = entry.buffer.GetHandle();
-            createInfo.size   = asSize;
-            createInfo.type   = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-            VK_CHECK(vkCreateAccelerationStructureKHR(mDevice, &createInfo, nullptr, &entry.handle));
-
-            buildInfos[i].dstAccelerationStructure  = entry.handle;
-            buildInfos[i].scratchData.deviceAddress = scratchAddr;
-
-            const VkAccelerationStructureBuildRangeInfoKHR* pRange = &rangeInfos[i];
-            vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfos[i], &pRange);
-
-            VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
-            barrier.srcStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
-            barrier.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
-            barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
-            barrier.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR;
-            VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-            dep.memoryBarrierCount = 1;
-            dep.pMemoryBarriers    = &barrier;
-            vkCmdPipelineBarrier2(cmd, &dep);
-
-            vkCmdWriteAccelerationStructuresPropertiesKHR(cmd, 1, &entry.handle,
-                VK_QUERY_TYPE_ACCELERATION_STRUCTURE_COMPACTED_SIZE_KHR, queryPool, i);
+// Copies every BLAS whose compacted size came back smaller into a tight allocation.
+// The originals stay traceable until the copies land.
+void AccelStructure::RecordCompaction(VkCommandBuffer cmd, std::vector<uint32_t>& compacted) {
+    compacted.clear();
+    for (uint32_t i : mToCompact) {
+        auto& entry = mBLASEntries[i];
+        if (entry.compactedSize == 0 || entry.compactedSize >= entry.buffer.GetSize()) {
+            entry.state = BLASState::Ready;
+            mTotalBLASMemory             += entry.buffer.GetSize();
+            mBuildStats.memoryCompacted  += entry.buffer.GetSize();
+            continue;
         }
-    });
-
-    // Read compacted sizes
-    std::vector<VkDeviceSize> compactedSizes(meshCount);
-    VK_CHECK(vkGetQueryPoolResults(mDevice, queryPool, 0, meshCount,
-        meshCount * sizeof(VkDeviceSize), compactedSizes.data(),
-        sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT));
-
-    for (uint32_t i = 0; i < meshCount; i++)
-        mBLASEntries[i].compactedSize = compactedSizes[i];
-
-    vkDestroyQueryPool(mDevice, queryPool, nullptr);
-    scratchBuffer.Destroy(mAllocator);
-
-    CompactBLAS();
 
-    LOG_INFO("BLAS built: {} meshes, pre-compaction {:.1f} KB, post-compaction {:.1f} KB ({:.0f}% reduction)",
-             meshCount,
-             mTotalBLASMemoryPreCompaction / 1024.0f,
-             mTotalBLASMemory / 1024.0f,
-             mTotalBLASMemoryPreCompaction > 0
-                 ? (1.0f - float(mTotalBLASMemory) / float(mTotalBLASMemoryPreCompaction)) * 100.0f
-                 : 0.0f);
+        entry.pendingBuffer.CreateDeviceLocalEmpty(mAllocator,
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            entry.compactedSize);
+
+        VkAccelerationStructureCreateInfoKHR createInfo{};
+        createInfo.sType  = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+        createInfo.buffer = entry.pendingBuffer.GetHandle();
+        createInfo.size   = entry.compactedSize;
+        createInfo.type   = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
+        VK_CHECK(vkCreateAccelerationStructureKHR(mDevice, &createInfo, nullptr, &entry.pendingHandle));
+
+        VkCopyAccelerationStructureInfoKHR copyInfo{};
+        copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
+        copyInfo.src   = entry.handle;
+        copyInfo.dst   = entry.pendingHandle;
+        copyInfo.mode  = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
+        vkCmdCopyAccelerationStructureKHR(cmd, &copyInfo);
+
+        entry.state = BLASState::Compacting;
+        mBuildStats.compactTriangles += entry.triangles;
+        compacted.push_back(i);
+    }
+    mToCompact.clear();
 }
 
-// ---------------------------------------------------------------------------
-// BLAS compaction — copy each BLAS into a tighter allocation
-// ---------------------------------------------------------------------------
-void AccelStructure::CompactBLAS() {
-    mTotalBLASMemory = 0;
-
-    struct OldResource {
-        VkAccelerationStructureKHR handle;
-        VulkanBuffer               buffer;
-    };
-    std::vector<OldResource> oldResources;
-    std::vector<VkAccelerationStructureKHR> newHandles(mBLASEntries.size(), VK_NULL_HANDLE);
-    std::vector<VulkanBuffer>               newBuffers(mBLASEntries.size());
-
-    mTransfer->ImmediateSubmit([&](VkCommandBuffer cmd) {
-        for (size_t i = 0; i < mBLASEntries.size(); i++) {
-            auto& entry = mBLASEntries[i];
-            if (entry.compactedSize == 0 || entry.compactedSize >= entry.buffer.GetSize()) {
-                mTotalBLASMemory += entry.buffer.GetSize();
-                continue;
-            }
+// The submission in flight has completed: its builds become traceable and its compacted
+// copies replace the originals, which are destroyed once no frame in flight can use them.
+void AccelStructure::CollectSubmission() {
+    uint64_t ticks[4] = {};
+    if (vkGetQueryPoolResults(mDevice, mTimestamps, 0, 4, sizeof(ticks), ticks,
+                              sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS) {
+        mBuildStats.compactGpuMs += double(ticks[1] - ticks[0]) * mTimestampPeriod * 1e-6;
+        mBuildStats.buildGpuMs   += double(ticks[3] - ticks[2]) * mTimestampPeriod * 1e-6;
+    }
 
-            newBuffers[i].CreateDeviceLocalEmpty(mAllocator,
-                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
-                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-                entry.compactedSize);
-
-            VkAccelerationStructureCreateInfoKHR createInfo{};
-            createInfo.sType  = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
-            createInfo.buffer = newBuffers[i].GetHandle();
-            createInfo.size   = entry.compactedSize;
-            createInfo.type   = VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR;
-            VK_CHECK(vkCreateAccelerationStructureKHR(mDevice, &createInfo, nullptr, &newHandles[i]));
-
-            VkCopyAccelerationStructureInfoKHR copyInfo{};
-            copyInfo.sType = VK_STRUCTURE_TYPE_COPY_ACCELERATION_STRUCTURE_INFO_KHR;
-            copyInfo.src   = entry.handle;
-            copyInfo.dst   = newHandles[i];
-            copyInfo.mode  = VK_COPY_ACCELERATION_STRUCTURE_MODE_COMPACT_KHR;
-            vkCmdCopyAccelerationStructureKHR(cmd, &copyInfo);
-
-            oldResources.push_back({entry.handle, entry.buffer});
-            mTotalBLASMemory += entry.compactedSize;
+    if (!mInFlightBuilt.empty()) {
+        const uint32_t first = mInFlightBuilt.front();
+        const uint32_t count = static_cast<uint32_t>(mInFlightBuilt.size());
+        std::vector<VkDeviceSize> sizes(count, 0);
+        VK_CHECK(vkGetQueryPoolResults(mDevice, mSizeQueries, first, count,
+            count * sizeof(VkDeviceSize), sizes.data(), sizeof(VkDeviceSize), VK_QUERY_RESULT_64_BIT));
+
+        for (uint32_t b = 0; b < count; b++) {
+            auto& entry = mBLASEntries[mInFlightBuilt[b]];
+            entry.handle        = entry.pendingHandle;
+            entry.buffer        = entry.pendingBuffer;
+            entry.pendingHandle = VK_NULL_HANDLE;
+            entry.pendingBuffer = {};
+            entry.compactedSize = sizes[b];
+            entry.state         = BLASState::Built;
+            mToCompact.push_back(mInFlightBuilt[b]);
         }
-    });
+        mBuildStats.meshesReady += count;
+    }
 
-    for (size_t i = 0; i < mBLASEntries.size(); i++) {
-        if (newHandles[i] != VK_NULL_HANDLE) {
-            mBLASEntries[i].handle = newHandles[i];
-            mBLASEntries[i].buffer = newBuffers[i];
-        }
+    for (uint32_t i : mInFlightCompacted) {
+        auto& entry = mBLASEntries[i];
+        mRetired.push_back({entry.handle, entry.buffer, mUpdateCount + mFramesInFlight});
+        entry.handle        = entry.pendingHandle;
+        entry.buffer        = entry.pendingBuffer;
+        entry.pendingHandle = VK_NULL_HANDLE;
+        entry.pendingBuffer = {};
+        entry.state         = BLASState::Ready;
+        mTotalBLASMemory            += entry.compactedSize;
+        mBuildStats.memoryCompacted += entry.compactedSize;
     }
 
-    for (auto& old : oldResources) {
+    mBLASRefsDirty  = mBLASRefsDirty || !mInFlightBuilt.empty() || !mInFlightCompacted.empty();
+    mInFlightBuilt.clear();
+    mInFlightCompacted.clear();
+    mCompletedValue = mInFlightValue;
+    mInFlightValue  = 0;
+}
+
+void AccelStructure::ReleaseRetired(bool all) {
+    auto it = std::remove_if(mRetired.begin(), mRetired.end(), [&](RetiredBLAS& old) {
+        if (!all && old.retireAt > mUpdateCount) return false;
         vkDestroyAccelerationStructureKHR(mDevice, old.handle, nullptr);
         old.buffer.Destroy(mAllocator);
+        return true;
+    });
+    mRetired.erase(it, mRetired.end());
+}
+
+bool AccelStructure::RefreshBLASReferences() {
+    const uint8_t allFrames = static_cast<uint8_t>((1u << mFramesInFlight) - 1);
+    bool changed = false;
+    for (size_t i = 0; i < mRecords.size(); i++) {
+        VkDeviceAddress addr = BLASAddress(mRecords[i].meshIndex);
+        if (mInstances[i].accelerationStructureReference == addr) continue;
+        mInstances[i].accelerationStructureReference = addr;
+        mRecords[i].dirtyFrames = allFrames;
+        changed = true;
     }
+    return changed;
+}
+
+VkDeviceAddress AccelStructure::BLASAddress(int meshIndex) const {
+    VkAccelerationStructureKHR handle = mBLASEntries[meshIndex].handle;
+    if (handle == VK_NULL_HANDLE) return 0;   // inactive instance until the build lands
+    VkAccelerationStructureDeviceAddressInfoKHR addrInfo{};
+    addrInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+    addrInfo.accelerationStructure = handle;
+    return vkGetAccelerationStructureDeviceAddressKHR(mDevice, &addrInfo);
 }
 
 // ---------------------------------------------------------------------------
 // TLAS — one instance per renderable entity
 // ---------------------------------------------------------------------------
+static VkTransformMatrixKHR ToVkTransform(const glm::mat4& m) {
+    VkTransformMatrixKHR xform{};
+    for (int r = 0; r < 3; r++)
+        for (int c = 0; c < 4; c++)
+            xform.matrix[r][c] = m[c][r];
+    return xform;
+}
+
+static float HalfArea(const AABB& b) {
+    if (!b.Valid()) return 0.0f;
+    glm::vec3 e = b.Extent();
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+AABB AccelStructure::InstanceBounds(const MeshPool& meshPool, const InstanceRecord& rec) {
+    return SceneBVH::TransformBounds(meshPool.GetDrawCommands()[rec.meshIndex].bounds, rec.model);
+}
+
 void AccelStructure::BuildTLAS(const Registry& registry, const MeshPool& meshPool,
                                uint32_t numRayTypes) {
-    std::vector<VkAccelerationStructureInstanceKHR> instances;
+    mInstances.clear();
+    mRecords.clear();
     mInstanceInfos.clear();
+    mClassInstances.fill(0);
     uint32_t instanceIdx = 0;
     const auto& drawCmds = meshPool.GetDrawCommands();
 
     registry.ForEachRenderable(
-        [&](uint32_t, const TransformComponent& xform, const MeshComponent& mesh, const MaterialComponent& mat) {
-            if (mesh.meshIndex >= static_cast<int>(mBLASEntries.size())) return;
-            const auto& blas = mBLASEntries[mesh.meshIndex];
-            if (blas.handle == VK_NULL_HANDLE) return;
+        [&](uint32_t entity, const TransformComponent& xform, const MeshComponent& mesh, const MaterialComponent& mat) {
+            if (mesh.meshIndex < 0 || mesh.meshIndex >= static_cast<int>(mBLASEntries.size())) return;
 
-            VkAccelerationStructureDeviceAddressInfoKHR addrInfo{};
-            addrInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-            addrInfo.accelerationStructure = blas.handle;
-            VkDeviceAddress blasAddr = vkGetAccelerationStructureDeviceAddressKHR(mDevice, &addrInfo);
-
-            VkAccelerationStructureInstanceKHR inst{};
-            const glm::mat4& m = xform.worldMatrix;
-            VkTransformMatrixKHR xformMat{};
-            for (int r = 0; r < 3; r++)
-                for (int c = 0; c < 4; c++)
-                    xformMat.matrix[r][c] = m[c][r];
+            // Meshes whose BLAS has not landed yet are inactive (reference 0) until it does
+            VkDeviceAddress blasAddr = BLASAddress(mesh.meshIndex);
 
             uint32_t matIdx = (mat.materialIndex >= 0)
                                   ? static_cast<uint32_t>(mat.materialIndex) : 0u;
 
-            inst.transform                              = xformMat;
+            RTMaterialClass cls = matIdx < mMaterialClasses.size()
+                                      ? mMaterialClasses[matIdx] : RTMaterialClass::AlphaTested;
+            mClassInstances[static_cast<uint32_t>(cls)]++;
+
+            // The instance flag overrides the BLAS geometry's OPAQUE bit either way
+            bool opaque = mForceOpaque && cls != RTMaterialClass::AlphaTested;
+
+            VkAccelerationStructureInstanceKHR inst{};
+            inst.transform                              = ToVkTransform(xform.worldMatrix);
             inst.instanceCustomIndex                    = instanceIdx;
             inst.mask                                   = 0xFF;
-            inst.instanceShaderBindingTableRecordOffset  = (numRayTypes > 0) ? matIdx * numRayTypes : 0;
-            inst.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
+            inst.instanceShaderBindingTableRecordOffset  = static_cast<uint32_t>(cls) * numRayTypes;
+            inst.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR |
+                                                          (opaque ? VK_GEOMETRY_INSTANCE_FORCE_OPAQUE_BIT_KHR
+                                                                  : VK_GEOMETRY_INSTANCE_FORCE_NO_OPAQUE_BIT_KHR);
             inst.accelerationStructureReference          = blasAddr;
-            instances.push_back(inst);
+            mInstances.push_back(inst);
+
+            InstanceRecord rec{};
+            rec.entity        = entity;
+            rec.meshIndex     = mesh.meshIndex;
+            rec.materialIndex = mat.materialIndex;
+            rec.model         = xform.worldMatrix;
+            mRecords.push_back(rec);
 
             const auto& cmd = drawCmds[mesh.meshIndex];
             RTInstanceInfo info{};
             info.vertexOffset  = cmd.vertexOffset;
-            info.firstIndex    = cmd.firstIndex;
+            info.firstIndex    = static_cast<uint32_t>(meshPool.GetIndexClassOffset(cmd.indexClass)
+                                 / MeshPool::GetIndexSize(cmd.indexClass)) + cmd.firstIndex;
             info.indexCount    = cmd.indexCount;
             info.materialIndex = matIdx;
+            info.indexClass    = cmd.indexClass;
             mInstanceInfos.push_back(info);
 
             instanceIdx++;
         });
 
-    if (instances.empty()) return;
-
-    VkDeviceSize instancesSize = instances.size() * sizeof(VkAccelerationStructureInstanceKHR);
-
-    mInstanceBuffer.Destroy(mAllocator);
-    mInstanceBuffer.CreateDeviceLocal(mAllocator, *mTransfer,
-        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        instances.data(), instancesSize);
+    if (mTLAS != VK_NULL_HANDLE) {
+        vkDestroyAccelerationStructureKHR(mDevice, mTLAS, nullptr);
+        mTLAS = VK_NULL_HANDLE;
+    }
+    mTLASBuffer.Destroy(mAllocator);
+    mScratchBuffer.Destroy(mAllocator);
+    for (auto& buffer : mFrameInstanceBuffers)
+        buffer.Destroy(mAllocator);
+    mTLASBuilt = false;
 
-    VkDeviceAddress instanceAddr = mInstanceBuffer.GetDeviceAddress(mDevice);
+    if (mInstances.empty()) return;
+
+    // One mapped copy of the instances per frame in flight: the CPU patches frame N's
+    // copy while the GPU may still be building from frame N-1's
+    VkDeviceSize instancesSize = mInstances.size() * sizeof(VkAccelerationStructureInstanceKHR);
+    mFrameInstanceBuffers.resize(mFramesInFlight);
+    for (auto& buffer : mFrameInstanceBuffers) {
+        buffer.CreateHostVisible(mAllocator,
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
+            VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, instancesSize);
+        std::memcpy(buffer.GetMappedData(), mInstances.data(), instancesSize);
+    }
 
     VkAccelerationStructureGeometryKHR geom{};
-    geom.sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-    geom.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-    geom.flags        = VK_GEOMETRY_OPAQUE_BIT_KHR;
-    geom.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-    geom.geometry.instances.arrayOfPointers    = VK_FALSE;
-    geom.geometry.instances.data.deviceAddress = instanceAddr;
-
     VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
-    buildInfo.sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-    buildInfo.type          = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-    buildInfo.flags         = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
-                              VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
-    buildInfo.mode          = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
-    buildInfo.geometryCount = 1;
-    buildInfo.pGeometries   = &geom;
+    FillTLASBuildInfo(0, VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR, geom, buildInfo);
 
-    uint32_t primCount = static_cast<uint32_t>(instances.size());
+    uint32_t primCount = static_cast<uint32_t>(mInstances.size());
 
     VkAccelerationStructureBuildSizesInfoKHR sizeInfo{};
     sizeInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
@@ -341,12 +607,6 @@ void AccelStructure::BuildTLAS(const Registry& registry, const MeshPool& meshPoo
         VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
         &buildInfo, &primCount, &sizeInfo);
 
-    if (mTLAS != VK_NULL_HANDLE) {
-        vkDestroyAccelerationStructureKHR(mDevice, mTLAS, nullptr);
-        mTLAS = VK_NULL_HANDLE;
-    }
-    mTLASBuffer.Destroy(mAllocator);
-
     mTLASBuffer.CreateDeviceLocalEmpty(mAllocator,
         VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR |
         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
@@ -359,13 +619,13 @@ void AccelStructure::BuildTLAS(const Registry& registry, const MeshPool& meshPoo
     createInfo.type   = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
     VK_CHECK(vkCreateAccelerationStructureKHR(mDevice, &createInfo, nullptr, &mTLAS));
 
-    VulkanBuffer scratchBuffer;
-    scratchBuffer.CreateDeviceLocalEmpty(mAllocator,
+    // Kept for the per-frame refits and rebuilds
+    mScratchBuffer.CreateDeviceLocalEmpty(mAllocator,
         VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        sizeInfo.buildScratchSize + kScratchAlign);
+        std::max(sizeInfo.buildScratchSize, sizeInfo.updateScratchSize) + kScratchAlign);
 
     buildInfo.dstAccelerationStructure  = mTLAS;
-    buildInfo.scratchData.deviceAddress = AlignUp(scratchBuffer.GetDeviceAddress(mDevice), kScratchAlign);
+    buildInfo.scratchData.deviceAddress = AlignUp(mScratchBuffer.GetDeviceAddress(mDevice), kScratchAlign);
 
     VkAccelerationStructureBuildRangeInfoKHR rangeInfo{};
     rangeInfo.primitiveCount = primCount;
@@ -375,116 +635,180 @@ void AccelStructure::BuildTLAS(const Registry& registry, const MeshPool& meshPoo
         vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfo, &pRange);
     });
 
-    scratchBuffer.Destroy(mAllocator);
-    mTLASBuilt = true;
+    ResetRefitState(meshPool);
+    mPendingMode   = TLASUpdate::None;
+    mBLASRefsDirty = false;
+    mTLASBuilt     = true;
 
     LOG_INFO("TLAS built: {} instances, {:.1f} KB", primCount, sizeInfo.accelerationStructureSize / 1024.0f);
+    LOG_INFO("TLAS instances: {} opaque, {} alpha-tested, {} emissive ({})",
+             mClassInstances[0], mClassInstances[1], mClassInstances[2],
+             mForceOpaque ? "opaque classes forced opaque" : "all forced non-opaque");
 }
 
-// ---------------------------------------------------------------------------
-// TLAS update (incremental rebuild for dynamic objects)
-// ---------------------------------------------------------------------------
-void AccelStructure::UpdateTLAS(const Registry& registry, const MeshPool& meshPool,
-                                uint32_t numRayTypes) {
-    if (!mTLASBuilt) {
-        BuildTLAS(registry, meshPool, numRayTypes);
-        return;
+void AccelStructure::ResetRefitState(const MeshPool& meshPool) {
+    AABB root;
+    for (auto& rec : mRecords) {
+        rec.builtBounds = InstanceBounds(meshPool, rec);
+        rec.growth      = 0.0f;
+        root.Include(rec.builtBounds);
     }
+    mRootArea         = HalfArea(root);
+    mGrowth           = 0.0f;
+    mRefitsSinceBuild = 0;
+}
 
-    std::vector<VkAccelerationStructureInstanceKHR> instances;
-    mInstanceInfos.clear();
-    uint32_t instanceIdx = 0;
-    const auto& drawCmds = meshPool.GetDrawCommands();
-
-    registry.ForEachRenderable(
-        [&](uint32_t, const TransformComponent& xform, const MeshComponent& mesh, const MaterialComponent& mat) {
-            if (mesh.meshIndex >= static_cast<int>(mBLASEntries.size())) return;
-            const auto& blas = mBLASEntries[mesh.meshIndex];
-            if (blas.handle == VK_NULL_HANDLE) return;
-
-            VkAccelerationStructureDeviceAddressInfoKHR addrInfo{};
-            addrInfo.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
-            addrInfo.accelerationStructure = blas.handle;
-            VkDeviceAddress blasAddr = vkGetAccelerationStructureDeviceAddressKHR(mDevice, &addrInfo);
+void AccelStructure::FillTLASBuildInfo(uint32_t frameIndex, VkBuildAccelerationStructureModeKHR mode,
+                                       VkAccelerationStructureGeometryKHR& geom,
+                                       VkAccelerationStructureBuildGeometryInfoKHR& buildInfo) const {
+    geom = {};
+    geom.sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    geom.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+    geom.flags        = VK_GEOMETRY_OPAQUE_BIT_KHR;
+    geom.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+    geom.geometry.instances.arrayOfPointers    = VK_FALSE;
+    geom.geometry.instances.data.deviceAddress = mFrameInstanceBuffers[frameIndex].GetDeviceAddress(mDevice);
 
-            VkAccelerationStructureInstanceKHR inst{};
-            const glm::mat4& m = xform.worldMatrix;
-            VkTransformMatrixKHR xformMat{};
-            for (int r = 0; r < 3; r++)
-                for (int c = 0; c < 4; c++)
-                    xformMat.matrix[r][c] = m[c][r];
+    buildInfo = {};
+    buildInfo.sType         = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    buildInfo.type          = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
+    buildInfo.flags         = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
+                              VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
+    buildInfo.mode          = mode;
+    buildInfo.geometryCount = 1;
+    buildInfo.pGeometries   = &geom;
+}
 
-            uint32_t matIdx = (mat.materialIndex >= 0)
-                                  ? static_cast<uint32_t>(mat.materialIndex) : 0u;
+// ---------------------------------------------------------------------------
+// Per-frame TLAS maintenance
+// ---------------------------------------------------------------------------
+TLASUpdate AccelStructure::PrepareUpdate(uint32_t frameIndex, const Registry& registry,
+                                         const MeshPool& meshPool) {
+    auto start = std::chrono::steady_clock::now();
+    mPendingMode  = TLASUpdate::None;
+    mPendingFrame = frameIndex;
+    if (!mTLASBuilt) return TLASUpdate::None;
+    mUpdateStats.frames++;
+
+    // Same walk and filter as BuildTLAS; any difference in the instance list is structural
+    const uint8_t allFrames = static_cast<uint8_t>((1u << mFramesInFlight) - 1);
+    bool     structural = false;
+    uint32_t index      = 0;
+    uint32_t moved      = 0;
+    registry.ForEachRenderable(
+        [&](uint32_t entity, const TransformComponent& xform, const MeshComponent& mesh, const MaterialComponent& mat) {
+            if (structural) return;
+            if (mesh.meshIndex < 0 || mesh.meshIndex >= static_cast<int>(mBLASEntries.size())) return;
+
+            if (index >= mRecords.size()) { structural = true; return; }
+            InstanceRecord& rec = mRecords[index];
+            if (rec.entity != entity || rec.meshIndex != mesh.meshIndex ||
+                rec.materialIndex != mat.materialIndex) {
+                structural = true;
+                return;
+            }
+            if (std::memcmp(&rec.model, &xform.worldMatrix, sizeof(glm::mat4)) != 0) {
+                rec.model = xform.worldMatrix;
+                mInstances[index].transform = ToVkTransform(xform.worldMatrix);
+                rec.dirtyFrames = allFrames;
+
+                // Surface area the refit stretches this instance's boxes by, against the build
+                AABB stretched = rec.builtBounds;
+                stretched.Include(InstanceBounds(meshPool, rec));
+                float growth = HalfArea(stretched) - HalfArea(rec.builtBounds);
+                mGrowth   += growth - rec.growth;
+                rec.growth = growth;
+                moved++;
+            }
+            index++;
+        });
+    if (index != mRecords.size()) structural = true;
 
-            inst.transform                              = xformMat;
-            inst.instanceCustomIndex                    = instanceIdx;
-            inst.mask                                   = 0xFF;
-            inst.instanceShaderBindingTableRecordOffset  = (numRayTypes > 0) ? matIdx * numRayTypes : 0;
-            inst.flags                                  = VK_GEOMETRY_INSTANCE_TRIANGLE_FACING_CULL_DISABLE_BIT_KHR;
-            inst.accelerationStructureReference          = blasAddr;
-            instances.push_back(inst);
+    if (structural) {
+        mUpdateStats.restructures++;
+        mUpdateStats.cpuMs += std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start).count();
+        return TLASUpdate::Restructure;
+    }
 
-            const auto& cmd = drawCmds[mesh.meshIndex];
-            RTInstanceInfo info{};
-            info.vertexOffset  = cmd.vertexOffset;
-            info.firstIndex    = cmd.firstIndex;
-            info.indexCount    = cmd.indexCount;
-            info.materialIndex = matIdx;
-            mInstanceInfos.push_back(info);
+    // BLAS that landed or were compacted since the last build: instances switch from
+    // inactive or from the old handle, which a refit may not do
+    bool relinked = false;
+    if (mBLASRefsDirty) {
+        relinked       = RefreshBLASReferences();
+        mBLASRefsDirty = false;
+    }
 
-            instanceIdx++;
-        });
+    // Bring this frame's copy up to date with every change it has not seen yet
+    auto*         dst = static_cast<VkAccelerationStructureInstanceKHR*>(mFrameInstanceBuffers[frameIndex].GetMappedData());
+    const uint8_t bit = static_cast<uint8_t>(1u << frameIndex);
+    for (uint32_t i = 0; i < mRecords.size(); i++) {
+        if (!(mRecords[i].dirtyFrames & bit)) continue;
+        dst[i] = mInstances[i];
+        mRecords[i].dirtyFrames &= ~bit;
+        mUpdateStats.instancesWritten++;
+    }
 
-    if (instances.empty()) return;
+    if (moved > 0 || relinked) {
+        mUpdateStats.movedInstances += moved;
+        bool degraded = relinked || mRefitsSinceBuild >= MAX_REFITS ||
+                        (mRootArea > 0.0f && mGrowth > REBUILD_GROWTH * mRootArea);
+        if (degraded) {
+            mPendingMode = TLASUpdate::Rebuild;
+            ResetRefitState(meshPool);
+            mUpdateStats.rebuilds++;
+        } else {
+            mPendingMode = TLASUpdate::Refit;
+            mRefitsSinceBuild++;
+            mUpdateStats.refits++;
+        }
+    }
 
-    VkDeviceSize instancesSize = instances.size() * sizeof(VkAccelerationStructureInstanceKHR);
+    mUpdateStats.cpuMs += std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - start).count();
+    return mPendingMode;
+}
 
-    mInstanceBuffer.Destroy(mAllocator);
-    mInstanceBuffer.CreateDeviceLocal(mAllocator, *mTransfer,
-        VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR |
-        VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        instances.data(), instancesSize);
+void AccelStructure::RecordUpdate(VkCommandBuffer cmd) {
+    if (mPendingMode != TLASUpdate::Refit && mPendingMode != TLASUpdate::Rebuild) return;
+
+    // The build writes the TLAS and scratch that earlier frames' traces and builds used
+    VkMemoryBarrier2 before{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    before.srcStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+    before.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR |
+                           VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    before.dstStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    before.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR |
+                           VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &before;
+    vkCmdPipelineBarrier2(cmd, &dep);
 
     VkAccelerationStructureGeometryKHR geom{};
-    geom.sType        = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
-    geom.geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
-    geom.flags        = VK_GEOMETRY_OPAQUE_BIT_KHR;
-    geom.geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
-    geom.geometry.instances.arrayOfPointers    = VK_FALSE;
-    geom.geometry.instances.data.deviceAddress = mInstanceBuffer.GetDeviceAddress(mDevice);
-
     VkAccelerationStructureBuildGeometryInfoKHR buildInfo{};
-    buildInfo.sType                    = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
-    buildInfo.type                     = VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR;
-    buildInfo.flags                    = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR |
-                                         VK_BUILD_ACCELERATION_STRUCTURE_ALLOW_UPDATE_BIT_KHR;
-    buildInfo.mode                     = VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR;
-    buildInfo.srcAccelerationStructure = mTLAS;
-    buildInfo.dstAccelerationStructure = mTLAS;
-    buildInfo.geometryCount            = 1;
-    buildInfo.pGeometries              = &geom;
-
-    uint32_t primCount = static_cast<uint32_t>(instances.size());
-    VkAccelerationStructureBuildSizesInfoKHR sizeInfo{VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR};
-    vkGetAccelerationStructureBuildSizesKHR(mDevice,
-        VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
-        &buildInfo, &primCount, &sizeInfo);
-
-    VulkanBuffer scratchBuffer;
-    scratchBuffer.CreateDeviceLocalEmpty(mAllocator,
-        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
-        sizeInfo.updateScratchSize + kScratchAlign);
-
-    buildInfo.scratchData.deviceAddress = AlignUp(scratchBuffer.GetDeviceAddress(mDevice), kScratchAlign);
+    bool refit = mPendingMode == TLASUpdate::Refit;
+    FillTLASBuildInfo(mPendingFrame, refit ? VK_BUILD_ACCELERATION_STRUCTURE_MODE_UPDATE_KHR
+                                           : VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR,
+                      geom, buildInfo);
+    buildInfo.srcAccelerationStructure  = refit ? mTLAS : VK_NULL_HANDLE;
+    buildInfo.dstAccelerationStructure  = mTLAS;
+    buildInfo.scratchData.deviceAddress = AlignUp(mScratchBuffer.GetDeviceAddress(mDevice), kScratchAlign);
 
     VkAccelerationStructureBuildRangeInfoKHR rangeInfo{};
-    rangeInfo.primitiveCount = primCount;
+    rangeInfo.primitiveCount = static_cast<uint32_t>(mInstances.size());
     const VkAccelerationStructureBuildRangeInfoKHR* pRange = &rangeInfo;
-
-    mTransfer->ImmediateSubmit([&](VkCommandBuffer cmd) {
-        vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfo, &pRange);
-    });
-
-    scratchBuffer.Destroy(mAllocator);
+    vkCmdBuildAccelerationStructuresKHR(cmd, 1, &buildInfo, &pRange);
+
+    VkMemoryBarrier2 after{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    after.srcStageMask  = VK_PIPELINE_STAGE_2_ACCELERATION_STRUCTURE_BUILD_BIT_KHR;
+    after.srcAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+    after.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR |
+                          VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT |
+                          VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+    after.dstAccessMask = VK_ACCESS_2_ACCELERATION_STRUCTURE_READ_BIT_KHR;
+    dep.pMemoryBarriers = &after;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    mPendingMode = TLASUpdate::None;
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "Resource/VulkanBuffer.h"
+#include "RayTracing/RTMaterialClass.h"
 #include "GPU/MeshPool.h"
 #include "Scene/ECS.h"
 
@@ -9,28 +10,135 @@
 #include <glm/glm.hpp>
 
 #include <vector>
+#include <chrono>
 #include <cstdint>
 
 class TransferManager;
 
+enum class BLASState : uint8_t {
+    Pending,      // waiting for a batch
+    Building,     // in the submission in flight, not traceable yet
+    Built,        // traceable at full size, compaction size known
+    Compacting,   // compact copy in the submission in flight
+    Ready,        // final (compacted unless compaction would not shrink it)
+};
+
 struct BLASEntry {
-    VkAccelerationStructureKHR handle    = VK_NULL_HANDLE;
+    VkAccelerationStructureKHR handle    = VK_NULL_HANDLE;   // null until the first build lands
     VulkanBuffer               buffer;
     VkDeviceSize               compactedSize = 0;
+    uint32_t                   triangles     = 0;
+    BLASState                  state         = BLASState::Pending;
+    // Written by the submission in flight; becomes handle/buffer once it completes
+    VkAccelerationStructureKHR pendingHandle = VK_NULL_HANDLE;
+    VulkanBuffer               pendingBuffer;
+};
+
+/// BLAS building and compaction since the last BuildBLAS().
+struct BLASBuildStats {
+    uint32_t     meshes            = 0;
+    uint32_t     meshesReady       = 0;   // traceable, compacted or not
+    uint32_t     batches           = 0;
+    uint64_t     buildTriangles    = 0;
+    uint64_t     compactTriangles  = 0;
+    double       buildGpuMs        = 0.0;
+    double       compactGpuMs      = 0.0;
+    double       wallMs            = 0.0;   // BuildBLAS() until the last swap
+    VkDeviceSize memoryBuilt       = 0;     // sizes as built
+    VkDeviceSize memoryCompacted   = 0;     // the same meshes after compaction
+
+    double BuildTrisPerMs()   const { return buildGpuMs   > 0.0 ? buildTriangles   / buildGpuMs   : 0.0; }
+    double CompactTrisPerMs() const { return compactGpuMs > 0.0 ? compactTriangles / compactGpuMs : 0.0; }
 };
 
 struct RTInstanceInfo;
 
+/// What PrepareUpdate decided for this frame.
+enum class TLASUpdate {
+    None,          // no instance moved
+    Refit,         // MODE_UPDATE in place
+    Rebuild,       // MODE_BUILD into the same TLAS, refits had degraded it
+    Restructure,   // renderables added, removed or remapped: BuildTLAS outside the frame
+};
+
+/// Per-frame TLAS maintenance since the last ResetUpdateStats().
+struct TLASUpdateStats {
+    uint64_t frames           = 0;
+    uint64_t refits           = 0;
+    uint64_t rebuilds         = 0;
+    uint64_t restructures     = 0;
+    uint64_t movedInstances   = 0;
+    uint64_t instancesWritten = 0;   // into the mapped per-frame instance buffers
+    double   cpuMs            = 0.0;
+    double   gpuMs            = 0.0;   // fed back from the "TLAS Update" profiler scope
+    uint64_t gpuSamples       = 0;
+
+    double PerFrame(uint64_t v) const { return frames ? double(v) / double(frames) : 0.0; }
+    double AvgCpuMs() const { return frames ? cpuMs / double(frames) : 0.0; }
+    double AvgGpuMs() const { return gpuSamples ? gpuMs / double(gpuSamples) : 0.0; }
+};
+
 class AccelStructure {
 public:
-    void Initialize(VkDevice device, VmaAllocator allocator, const TransferManager& transfer);
+    /// Refits since the last build after which the next one rebuilds, whatever the growth.
+    static constexpr uint32_t MAX_REFITS     = 240;
+    /// Rebuild once moved instances have stretched their boxes by this fraction of the
+    /// TLAS root's surface area, the SAH estimate of extra node visits per ray.
+    static constexpr float    REBUILD_GROWTH = 0.25f;
+
+    /// Scratch memory one BLAS batch may use unless SetScratchBudget says otherwise.
+    static constexpr VkDeviceSize DEFAULT_SCRATCH_BUDGET = 32ull * 1024 * 1024;
+
+    /// BLAS builds run on buildQueue, which must belong to the graphics family so the
+    /// MeshPool buffers are read without queue-ownership transfers.
+    void Initialize(VkDevice device, VkPhysicalDevice physDevice, VmaAllocator allocator,
+                    TransferManager& transfer, uint32_t framesInFlight,
+                    VkQueue buildQueue, uint32_t buildFamily);
     void Shutdown(VmaAllocator allocator);
 
+    void SetScratchBudget(VkDeviceSize bytes) { mScratchBudget = bytes; }
+
+    /// Queues a BLAS for every mesh and submits the first batch; returns without waiting.
+    /// Meshes stay out of the TLAS (inactive instances) until their build lands.
     void BuildBLAS(const MeshPool& meshPool);
+    /// Once per frame: collects the submission in flight if it has completed, swaps in the
+    /// new and compacted BLAS, and submits the next batch under the scratch budget. When a
+    /// BLAS handle changed, the next PrepareUpdate relinks the instances and rebuilds.
+    void UpdateBLASBuilds();
+    bool IsBLASBuildComplete() const {
+        return mBuildMeshPool && mNextBuild == mBLASEntries.size() && mToCompact.empty() && mInFlightValue == 0;
+    }
+    /// The frame that traces the swapped-in BLAS waits on this value of this semaphore.
+    VkSemaphore GetBLASTimeline()   const { return mBuildTimeline; }
+    uint64_t    GetBLASReadyValue() const { return mCompletedValue; }
+    const BLASBuildStats& GetBLASBuildStats() const { return mBuildStats; }
+    /// Blocking; creates a new TLAS handle. Structural changes come back through here.
+    /// With numRayTypes > 0 an instance's SBT record offset selects its material class's
+    /// hit groups (class * numRayTypes); otherwise every instance uses the first ones.
     void BuildTLAS(const Registry& registry, const MeshPool& meshPool,
                    uint32_t numRayTypes = 0);
-    void UpdateTLAS(const Registry& registry, const MeshPool& meshPool,
-                    uint32_t numRayTypes = 0);
+
+    /// RTMaterialClass per material index, read by the next BuildTLAS. Unknown materials
+    /// count as alpha-tested so their any-hit shader still runs.
+    void SetMaterialClasses(std::vector<RTMaterialClass> classes) { mMaterialClasses = std::move(classes); }
+    /// Opaque and emissive instances carry FORCE_OPAQUE and skip any-hit entirely; off,
+    /// every instance is FORCE_NO_OPAQUE (the A/B baseline). Takes effect at the next BuildTLAS.
+    void SetForceOpaque(bool enabled) { mForceOpaque = enabled; }
+    bool IsForceOpaque() const { return mForceOpaque; }
+    /// TLAS instances per RTMaterialClass as of the last BuildTLAS.
+    const RTClassCounts& GetClassInstanceCounts() const { return mClassInstances; }
+
+    /// CPU half of the per-frame update: instances whose world matrix changed are patched
+    /// into frameIndex's mapped instance buffer, and a refit or rebuild is chosen. Nothing
+    /// is recorded for Restructure; the caller rebuilds with BuildTLAS instead.
+    TLASUpdate PrepareUpdate(uint32_t frameIndex, const Registry& registry, const MeshPool& meshPool);
+    /// Records the build PrepareUpdate chose into the frame's command buffer, between
+    /// barriers against earlier frames' traces and this frame's. Keeps the TLAS handle.
+    void RecordUpdate(VkCommandBuffer cmd);
+
+    const TLASUpdateStats& GetUpdateStats() const { return mUpdateStats; }
+    void AddUpdateGPUTime(float ms) { mUpdateStats.gpuMs += ms; mUpdateStats.gpuSamples++; }
+    void ResetUpdateStats() { mUpdateStats = {}; }
 
     VkAccelerationStructureKHR GetTLAS() const { return mTLAS; }
     VkDeviceSize GetTotalBLASMemory() const { return mTotalBLASMemory; }
@@ -38,29 +146,102 @@ public:
     VkDeviceSize GetTLASMemory() const { return mTLASBuffer.GetSize(); }
 
     const std::vector<RTInstanceInfo>& GetInstanceInfos() const { return mInstanceInfos; }
+    /// Mesh and world transform TLAS instance i (its instanceCustomIndex) was built with.
+    int              GetInstanceMesh(uint32_t i) const      { return mRecords[i].meshIndex; }
+    const glm::mat4& GetInstanceTransform(uint32_t i) const { return mRecords[i].model; }
 
 private:
-    void CompactBLAS();
+    struct InstanceRecord {
+        Entity    entity        = INVALID_ENTITY;
+        int       meshIndex     = -1;
+        int       materialIndex = -1;
+        glm::mat4 model{1.0f};
+        AABB      builtBounds;          // world bounds at the last full build
+        float     growth      = 0.0f;   // surface area added by refits since then
+        uint8_t   dirtyFrames = 0;      // bit f: frame f's instance buffer is stale
+    };
+
+    struct RetiredBLAS {
+        VkAccelerationStructureKHR handle = VK_NULL_HANDLE;
+        VulkanBuffer               buffer;
+        uint64_t                   retireAt = 0;   // mUpdateCount at which no frame uses it
+    };
+
+    void RecordBuildBatch(VkCommandBuffer cmd, std::vector<uint32_t>& built);
+    void RecordCompaction(VkCommandBuffer cmd, std::vector<uint32_t>& compacted);
+    void CollectSubmission();
+    void ReleaseRetired(bool all);
+    bool RefreshBLASReferences();
+    VkDeviceAddress BLASAddress(int meshIndex) const;
+    void ResetRefitState(const MeshPool& meshPool);
+    void FillTLASBuildInfo(uint32_t frameIndex, VkBuildAccelerationStructureModeKHR mode,
+                           VkAccelerationStructureGeometryKHR& geom,
+                           VkAccelerationStructureBuildGeometryInfoKHR& buildInfo) const;
+    static AABB InstanceBounds(const MeshPool& meshPool, const InstanceRecord& rec);
 
     VkDevice     mDevice    = VK_NULL_HANDLE;
     VmaAllocator mAllocator = VK_NULL_HANDLE;
-    const TransferManager* mTransfer = nullptr;
+    TransferManager* mTransfer = nullptr;
 
     std::vector<BLASEntry> mBLASEntries;
     VkDeviceSize mTotalBLASMemory = 0;
     VkDeviceSize mTotalBLASMemoryPreCompaction = 0;
 
+    // Incremental BLAS builds: one submission in flight on the build queue at a time
+    VkQueue                  mBuildQueue      = VK_NULL_HANDLE;
+    VkCommandPool            mBuildPool       = VK_NULL_HANDLE;
+    VkCommandBuffer          mBuildCmd        = VK_NULL_HANDLE;
+    VkSemaphore              mBuildTimeline   = VK_NULL_HANDLE;
+    VkQueryPool              mSizeQueries     = VK_NULL_HANDLE;   // compacted size, one per mesh
+    VkQueryPool              mTimestamps      = VK_NULL_HANDLE;   // compaction begin/end, build begin/end
+    float                    mTimestampPeriod = 1.0f;
+    VkDeviceSize             mScratchBudget   = DEFAULT_SCRATCH_BUDGET;
+    VulkanBuffer             mBLASScratch;
+    VulkanBuffer             mBLASTransforms;                     // packed vertices: SNORM-to-AABB per mesh
+    const MeshPool*          mBuildMeshPool   = nullptr;
+    uint32_t                 mNextBuild       = 0;                // first mesh not yet in a batch
+    uint64_t                 mSubmitValue     = 0;
+    uint64_t                 mInFlightValue   = 0;                // 0: nothing in flight
+    uint64_t                 mCompletedValue  = 0;
+    uint64_t                 mUpdateCount     = 0;
+    std::vector<uint32_t>    mInFlightBuilt;
+    std::vector<uint32_t>    mInFlightCompacted;
+    std::vector<uint32_t>    mToCompact;                          // built, compaction not recorded yet
+    std::vector<RetiredBLAS> mRetired;
+    bool                     mBLASRefsDirty   = false;
+    bool                     mBuildLogged     = false;
+    BLASBuildStats           mBuildStats;
+    std::chrono::steady_clock::time_point mBuildStart;
+
     VkAccelerationStructureKHR mTLAS = VK_NULL_HANDLE;
     VulkanBuffer mTLASBuffer;
-    VulkanBuffer mInstanceBuffer;
+    VulkanBuffer mScratchBuffer;
     bool         mTLASBuilt = false;
 
+    // Per-frame maintenance: instance list in TLAS order, mapped copies per frame in flight
+    uint32_t                                        mFramesInFlight = 2;
+    std::vector<VkAccelerationStructureInstanceKHR> mInstances;
+    std::vector<InstanceRecord>                     mRecords;
+    std::vector<VulkanBuffer>                       mFrameInstanceBuffers;
+    float                                           mRootArea         = 0.0f;
+    float                                           mGrowth           = 0.0f;
+    uint32_t                                        mRefitsSinceBuild = 0;
+    TLASUpdate                                      mPendingMode      = TLASUpdate::None;
+    uint32_t                                        mPendingFrame     = 0;
+    TLASUpdateStats                                 mUpdateStats;
+
     std::vector<RTInstanceInfo> mInstanceInfos;
+
+    std::vector<RTMaterialClass> mMaterialClasses;
+    RTClassCounts                mClassInstances{};
+    bool                         mForceOpaque = true;
 };
 
 struct RTInstanceInfo {
     int32_t  vertexOffset;
-    uint32_t firstIndex;
+    uint32_t firstIndex;      // absolute element index within the instance's index sub-pool width
     uint32_t indexCount;
     uint32_t materialIndex;
+    uint32_t indexClass;
+    uint32_t lightOffset = ~0u;   // first light of the instance's triangles (LightBuffer), ~0u = none
 };
@@ -0,0 +1,399 @@
+#include "RayTracing/CPUBVH.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VRB_CPURT_SSE 1
+#include <emmintrin.h>
+#endif
+
+// -----------------------------------------------------------------------
+// Helpers
+// -----------------------------------------------------------------------
+
+// Half the surface area, the SAH cost measure
+static float Area(const AABB& b) {
+    if (!b.Valid()) return 0.0f;
+    glm::vec3 e = b.Extent();
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+static AABB TransformBounds(const AABB& local, const glm::mat4& m) {
+    glm::vec3 c = glm::vec3(m * glm::vec4(local.Center(), 1.0f));
+    glm::vec3 h = local.Extent() * 0.5f;
+    glm::vec3 e(std::abs(m[0][0]) * h.x + std::abs(m[1][0]) * h.y + std::abs(m[2][0]) * h.z,
+                std::abs(m[0][1]) * h.x + std::abs(m[1][1]) * h.y + std::abs(m[2][1]) * h.z,
+                std::abs(m[0][2]) * h.x + std::abs(m[1][2]) * h.y + std::abs(m[2][2]) * h.z);
+    AABB r;
+    r.min = c - e;
+    r.max = c + e;
+    return r;
+}
+
+// -----------------------------------------------------------------------
+// BVH4 build
+// -----------------------------------------------------------------------
+
+std::vector<uint32_t> BVH4::Build(const std::vector<AABB>& bounds) {
+    const uint32_t n = static_cast<uint32_t>(bounds.size());
+    mNodes.clear();
+    mBounds  = AABB{};
+    mSAHCost = 0.0f;
+
+    std::vector<uint32_t> order(n);
+    std::iota(order.begin(), order.end(), 0u);
+    if (n == 0) return order;
+
+    std::vector<glm::vec3> centroids(n);
+    for (uint32_t i = 0; i < n; i++) {
+        centroids[i] = bounds[i].Center();
+        mBounds.Include(bounds[i]);
+    }
+
+    std::vector<BuildNode> binary;
+    binary.reserve(2 * (n / MAX_LEAF_SIZE) + 1);
+    binary.push_back({});
+    binary[0].bounds = mBounds;
+    binary[0].count  = n;
+
+    struct Task { uint32_t node, depth; };
+    std::vector<Task> tasks{{0, 0}};
+
+    while (!tasks.empty()) {
+        Task task = tasks.back();
+        tasks.pop_back();
+
+        const uint32_t first = binary[task.node].first;
+        const uint32_t count = binary[task.node].count;
+        const float    area  = Area(binary[task.node].bounds);
+        uint32_t* const begin = order.data() + first;
+        uint32_t* const end   = begin + count;
+        if (count <= 1) continue;
+
+        AABB centroidBounds;
+        for (uint32_t* it = begin; it != end; ++it) centroidBounds.Include(centroids[*it]);
+        glm::vec3 ext  = centroidBounds.Extent();
+        int       axis = (ext.x >= ext.y && ext.x >= ext.z) ? 0 : (ext.y >= ext.z ? 1 : 2);
+        float     cmin = centroidBounds.min[axis];
+
+        uint32_t* mid = nullptr;
+        if (ext[axis] > 0.0f && task.depth < SAH_DEPTH) {
+            AABB     binBounds[BIN_COUNT];
+            uint32_t binCount[BIN_COUNT]{};
+            const float scale = static_cast<float>(BIN_COUNT) * 0.99999f / ext[axis];
+            auto binOf = [&](uint32_t i) {
+                return std::min(static_cast<uint32_t>((centroids[i][axis] - cmin) * scale), BIN_COUNT - 1);
+            };
+            for (uint32_t* it = begin; it != end; ++it) {
+                uint32_t b = binOf(*it);
+                binCount[b]++;
+                binBounds[b].Include(bounds[*it]);
+            }
+
+            // Sweep from the right for the suffix areas, then from the left for the cost
+            float    rightArea[BIN_COUNT];
+            uint32_t rightCount[BIN_COUNT];
+            AABB     acc;
+            uint32_t accCount = 0;
+            for (uint32_t b = BIN_COUNT - 1; b > 0; b--) {
+                acc.Include(binBounds[b]);
+                accCount += binCount[b];
+                rightArea[b]  = Area(acc);
+                rightCount[b] = accCount;
+            }
+            float    bestCost  = std::numeric_limits<float>::max();
+            uint32_t bestSplit = 0;   // bins [0, bestSplit) go left
+            acc      = AABB{};
+            accCount = 0;
+            for (uint32_t b = 1; b < BIN_COUNT; b++) {
+                acc.Include(binBounds[b - 1]);
+                accCount += binCount[b - 1];
+                if (accCount == 0 || rightCount[b] == 0) continue;
+                float cost = Area(acc) * static_cast<float>(accCount) + rightArea[b] * static_cast<float>(rightCount[b]);
+                if (cost < bestCost) {
+                    bestCost  = cost;
+                    bestSplit = b;
+                }
+            }
+
+            // One node test against count triangle tests; small ranges stay leaves when that is cheaper
+            float splitCost = 1.0f + (area > 0.0f ? bestCost / area : 0.0f);
+            if (count <= MAX_LEAF_SIZE && static_cast<float>(count) <= splitCost) continue;
+            if (bestSplit > 0)
+                mid = std::partition(begin, end, [&](uint32_t i) { return binOf(i) < bestSplit; });
+        } else if (count <= MAX_LEAF_SIZE) {
+            continue;   // coincident centroids: nothing to separate
+        }
+
+        if (!mid || mid == begin || mid == end) {
+            mid = begin + count / 2;
+            std::nth_element(begin, mid, end, [&](uint32_t a, uint32_t b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+        }
+
+        BuildNode halves[2];
+        halves[0].first = first;
+        halves[0].count = static_cast<uint32_t>(mid - begin);
+        halves[1].first = first + halves[0].count;
+        halves[1].count = count - halves[0].count;
+        for (BuildNode& h : halves)
+            for (uint32_t i = h.first; i < h.first + h.count; i++)
+                h.bounds.Include(bounds[order[i]]);
+
+        uint32_t left = static_cast<uint32_t>(binary.size());
+        binary.push_back(halves[0]);
+        binary.push_back(halves[1]);
+        binary[task.node].child[0] = left;
+        binary[task.node].child[1] = left + 1;
+        binary[task.node].count    = 0;
+        tasks.push_back({left, task.depth + 1});
+        tasks.push_back({left + 1, task.depth + 1});
+    }
+
+    Collapse(binary, 0);
+    if (float rootArea = Area(mBounds); rootArea > 0.0f)
+        mSAHCost /= rootArea;
+    return order;
+}
+
+// Pulls up to four binary descendants into one node, always opening the widest inner
+// child, and recurses into the inner ones. A leaf root gets a node of its own.
+uint32_t BVH4::Collapse(const std::vector<BuildNode>& binary, uint32_t root) {
+    uint32_t index = static_cast<uint32_t>(mNodes.size());
+    mNodes.emplace_back();
+    mSAHCost += Area(binary[root].bounds);
+
+    uint32_t kids[4];
+    uint32_t count = 0;
+    if (binary[root].count > 0) {
+        kids[count++] = root;
+    } else {
+        kids[count++] = binary[root].child[0];
+        kids[count++] = binary[root].child[1];
+        while (count < 4) {
+            int   widest = -1;
+            float widestArea = -1.0f;
+            for (uint32_t k = 0; k < count; k++) {
+                const BuildNode& b = binary[kids[k]];
+                if (b.count == 0 && Area(b.bounds) > widestArea) {
+                    widest     = static_cast<int>(k);
+                    widestArea = Area(b.bounds);
+                }
+            }
+            if (widest < 0) break;
+            uint32_t opened = kids[widest];
+            kids[widest]    = binary[opened].child[0];
+            kids[count++]   = binary[opened].child[1];
+        }
+    }
+
+    uint32_t child[4];
+    for (uint32_t k = 0; k < 4; k++) {
+        if (k >= count) {
+            child[k] = EMPTY_SLOT;
+        } else if (const BuildNode& b = binary[kids[k]]; b.count > 0) {
+            child[k] = LEAF_BIT | (b.first << 3) | (b.count - 1);
+            mSAHCost += Area(b.bounds) * static_cast<float>(b.count);
+        } else {
+            child[k] = Collapse(binary, kids[k]);
+        }
+    }
+
+    Node& node = mNodes[index];
+    for (uint32_t k = 0; k < 4; k++) {
+        const float inf = std::numeric_limits<float>::infinity();
+        AABB b;
+        if (k < count) b = binary[kids[k]].bounds;
+        node.minX[k] = k < count ? b.min.x :  inf;
+        node.minY[k] = k < count ? b.min.y :  inf;
+        node.minZ[k] = k < count ? b.min.z :  inf;
+        node.maxX[k] = k < count ? b.max.x : -inf;
+        node.maxY[k] = k < count ? b.max.y : -inf;
+        node.maxZ[k] = k < count ? b.max.z : -inf;
+        node.child[k] = child[k];
+    }
+    return index;
+}
+
+// -----------------------------------------------------------------------
+// BVH4 traversal
+// -----------------------------------------------------------------------
+
+// Slab test against the near and far planes picked by the direction's signs, so the
+// inverted bounds of empty slots give tNear = +inf > tFar = -inf and always miss
+uint32_t BVH4::IntersectNode(const Node& node, const CPURay& ray, const glm::vec3& invDir, float tNear[4]) {
+    const float* nearX = invDir.x >= 0.0f ? node.minX : node.maxX;
+    const float* nearY = invDir.y >= 0.0f ? node.minY : node.maxY;
+    const float* nearZ = invDir.z >= 0.0f ? node.minZ : node.maxZ;
+    const float* farX  = invDir.x >= 0.0f ? node.maxX : node.minX;
+    const float* farY  = invDir.y >= 0.0f ? node.maxY : node.minY;
+    const float* farZ  = invDir.z >= 0.0f ? node.maxZ : node.minZ;
+
+#if defined(VRB_CPURT_SSE)
+    const __m128 ox = _mm_set1_ps(ray.origin.x), oy = _mm_set1_ps(ray.origin.y), oz = _mm_set1_ps(ray.origin.z);
+    const __m128 ix = _mm_set1_ps(invDir.x),     iy = _mm_set1_ps(invDir.y),     iz = _mm_set1_ps(invDir.z);
+
+    __m128 t0 = _mm_max_ps(_mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearX), ox), ix),
+                                      _mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearY), oy), iy)),
+                           _mm_max_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(nearZ), oz), iz),
+                                      _mm_set1_ps(ray.tMin)));
+    __m128 t1 = _mm_min_ps(_mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farX), ox), ix),
+                                      _mm_mul_ps(_mm_sub_ps(_mm_load_ps(farY), oy), iy)),
+                           _mm_min_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(farZ), oz), iz),
+                                      _mm_set1_ps(ray.tMax)));
+    _mm_storeu_ps(tNear, t0);
+    return static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(t0, t1)));
+#else
+    uint32_t mask = 0;
+    for (uint32_t c = 0; c < 4; c++) {
+        float t0 = std::max(std::max((nearX[c] - ray.origin.x) * invDir.x, (nearY[c] - ray.origin.y) * invDir.y),
+                            std::max((nearZ[c] - ray.origin.z) * invDir.z, ray.tMin));
+        float t1 = std::min(std::min((farX[c] - ray.origin.x) * invDir.x, (farY[c] - ray.origin.y) * invDir.y),
+                            std::min((farZ[c] - ray.origin.z) * invDir.z, ray.tMax));
+        tNear[c] = t0;
+        if (t0 <= t1) mask |= 1u << c;
+    }
+    return mask;
+#endif
+}
+
+// -----------------------------------------------------------------------
+// TriangleBVH
+// -----------------------------------------------------------------------
+
+void TriangleBVH::Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices) {
+    const uint32_t triCount = static_cast<uint32_t>(indices.size() / 3);
+    std::vector<AABB> bounds(triCount);
+    for (uint32_t t = 0; t < triCount; t++)
+        for (uint32_t k = 0; k < 3; k++)
+            bounds[t].Include(positions[indices[t * 3 + k]]);
+
+    std::vector<uint32_t> order = mBVH.Build(bounds);
+
+    mTriangles.resize(triCount);
+    for (uint32_t i = 0; i < triCount; i++) {
+        uint32_t t = order[i];
+        const glm::vec3& p0 = positions[indices[t * 3 + 0]];
+        const glm::vec3& p1 = positions[indices[t * 3 + 1]];
+        const glm::vec3& p2 = positions[indices[t * 3 + 2]];
+        mTriangles[i] = {p0, p1 - p0, p2 - p0, t};
+    }
+}
+
+// Moller-Trumbore, both faces (the TLAS instances disable facing culls too)
+bool TriangleBVH::IntersectLeaf(uint32_t first, uint32_t count, CPURay& ray, CPUHit* hit,
+                                CPUTraversalStats& stats) const {
+    bool found = false;
+    stats.triTests += count;
+    for (uint32_t i = first; i < first + count; i++) {
+        const Triangle& tri = mTriangles[i];
+        glm::vec3 p   = glm::cross(ray.dir, tri.e2);
+        float     det = glm::dot(tri.e1, p);
+        if (det == 0.0f) continue;
+        float     inv = 1.0f / det;
+        glm::vec3 s   = ray.origin - tri.v0;
+        float     u   = glm::dot(s, p) * inv;
+        if (u < 0.0f || u > 1.0f) continue;
+        glm::vec3 q = glm::cross(s, tri.e1);
+        float     v = glm::dot(ray.dir, q) * inv;
+        if (v < 0.0f || u + v > 1.0f) continue;
+        float     t = glm::dot(tri.e2, q) * inv;
+        if (t <= ray.tMin || t >= ray.tMax) continue;
+
+        found = true;
+        if (!hit) return true;
+        ray.tMax       = t;
+        hit->t         = t;
+        hit->u         = u;
+        hit->v         = v;
+        hit->primitive = tri.primitive;
+    }
+    return found;
+}
+
+bool TriangleBVH::Intersect(CPURay& ray, CPUHit& hit, CPUTraversalStats& stats) const {
+    bool found = false;
+    mBVH.Traverse(ray, stats, [&](uint32_t first, uint32_t count, CPURay& r) {
+        found |= IntersectLeaf(first, count, r, &hit, stats);
+        return false;
+    });
+    return found;
+}
+
+bool TriangleBVH::Occluded(const CPURay& ray, CPUTraversalStats& stats) const {
+    CPURay r = ray;
+    bool   found = false;
+    mBVH.Traverse(r, stats, [&](uint32_t first, uint32_t count, CPURay& leafRay) {
+        found = IntersectLeaf(first, count, leafRay, nullptr, stats);
+        return found;
+    });
+    return found;
+}
+
+// -----------------------------------------------------------------------
+// InstanceBVH
+// -----------------------------------------------------------------------
+
+void InstanceBVH::Add(const TriangleBVH* mesh, uint32_t meshIndex, uint32_t materialIndex,
+                      const glm::mat4& objectToWorld) {
+    if (!mesh || mesh->GetTriangleCount() == 0) return;
+    Instance inst;
+    inst.objectToWorld = objectToWorld;
+    inst.worldToObject = glm::inverse(objectToWorld);
+    inst.mesh          = mesh;
+    inst.meshIndex     = meshIndex;
+    inst.materialIndex = materialIndex;
+    mInstances.push_back(inst);
+}
+
+void InstanceBVH::Build() {
+    std::vector<AABB> bounds(mInstances.size());
+    for (size_t i = 0; i < mInstances.size(); i++)
+        bounds[i] = TransformBounds(mInstances[i].mesh->GetBounds(), mInstances[i].objectToWorld);
+
+    std::vector<uint32_t> order = mBVH.Build(bounds);
+    std::vector<Instance> sorted(mInstances.size());
+    for (size_t i = 0; i < order.size(); i++)
+        sorted[i] = mInstances[order[i]];
+    mInstances.swap(sorted);
+}
+
+// The direction is not renormalized, so object-space t equals world-space t
+CPURay InstanceBVH::ToObject(const CPURay& ray, const Instance& inst) {
+    CPURay r;
+    r.origin = glm::vec3(inst.worldToObject * glm::vec4(ray.origin, 1.0f));
+    r.dir    = glm::mat3(inst.worldToObject) * ray.dir;
+    r.tMin   = ray.tMin;
+    r.tMax   = ray.tMax;
+    return r;
+}
+
+bool InstanceBVH::Intersect(CPURay& ray, CPUHit& hit, CPUTraversalStats& stats) const {
+    bool found = false;
+    mBVH.Traverse(ray, stats, [&](uint32_t first, uint32_t count, CPURay& r) {
+        for (uint32_t i = first; i < first + count; i++) {
+            CPURay local = ToObject(r, mInstances[i]);
+            if (mInstances[i].mesh->Intersect(local, hit, stats)) {
+                r.tMax       = local.tMax;
+                hit.instance = i;
+                found        = true;
+            }
+        }
+        return false;
+    });
+    return found;
+}
+
+bool InstanceBVH::Occluded(const CPURay& ray, CPUTraversalStats& stats) const {
+    CPURay r = ray;
+    bool   found = false;
+    mBVH.Traverse(r, stats, [&](uint32_t first, uint32_t count, CPURay& leafRay) {
+        for (uint32_t i = first; i < first + count && !found; i++)
+            found = mInstances[i].mesh->Occluded(ToObject(leafRay, mInstances[i]), stats);
+        return found;
+    });
+    return found;
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include "Math/AABB.h"
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cmath>
+#include <cstdint>
+
+/// World- or object-space ray; dir need not be normalized, t is in units of dir.
+struct CPURay {
+    glm::vec3 origin;
+    float     tMin = 0.0f;
+    glm::vec3 dir;
+    float     tMax = 1e30f;
+};
+
+/// Closest hit; t < 0 means the ray missed. u, v are the barycentrics of vertices 1
+/// and 2, as in a hit group's hit attributes.
+struct CPUHit {
+    float    t         = -1.0f;
+    float    u         = 0.0f;
+    float    v         = 0.0f;
+    uint32_t primitive = 0;   // triangle within the mesh
+    uint32_t instance  = 0;   // InstanceBVH only
+};
+
+/// Work done by traversals; not synchronized, so one block per thread.
+struct CPUTraversalStats {
+    uint64_t nodeTests = 0;   // BVH4 nodes, four boxes each
+    uint64_t triTests  = 0;
+
+    CPUTraversalStats& operator+=(const CPUTraversalStats& o) {
+        nodeTests += o.nodeTests; triTests += o.triTests;
+        return *this;
+    }
+};
+
+/// Four-wide BVH over boxes, for the CPU ray tracer. Built top-down as a binary tree
+/// with binned SAH (BIN_COUNT buckets along the longest centroid axis), then collapsed
+/// so every node holds up to four children; a ray tests all four boxes of a node in
+/// one SSE step and descends into the hits nearest first. Leaves reference runs of
+/// the build order, which the owner uses to lay out its primitives.
+class BVH4 {
+public:
+    static constexpr uint32_t BIN_COUNT     = 16;
+    static constexpr uint32_t MAX_LEAF_SIZE = 4;
+    static constexpr uint32_t SAH_DEPTH     = 32;   // deeper ranges split at the median
+    static constexpr uint32_t MAX_DEPTH     = 64;   // SAH_DEPTH + log2 of any 32-bit count
+    static constexpr uint32_t STACK_SIZE    = 3 * MAX_DEPTH + 1;
+
+    struct alignas(16) Node {
+        float    minX[4], minY[4], minZ[4];
+        float    maxX[4], maxY[4], maxZ[4];
+        uint32_t child[4];   // inner node index, or LEAF_BIT | first << 3 | (count - 1)
+    };
+    static constexpr uint32_t LEAF_BIT   = 0x80000000u;
+    static constexpr uint32_t EMPTY_SLOT = 0xFFFFFFFFu;   // bounds are inverted, never hit
+
+    static bool     IsLeaf(uint32_t child)     { return (child & LEAF_BIT) != 0; }
+    static uint32_t LeafFirst(uint32_t child)  { return (child & ~LEAF_BIT) >> 3; }
+    static uint32_t LeafCount(uint32_t child)  { return (child & 7u) + 1; }
+
+    /// Returns the permutation of [0, bounds.size()) the leaves index into.
+    std::vector<uint32_t> Build(const std::vector<AABB>& bounds);
+
+    bool        Empty()        const { return mNodes.empty(); }
+    const Node& GetNode(uint32_t i) const { return mNodes[i]; }
+    uint32_t    GetNodeCount() const { return static_cast<uint32_t>(mNodes.size()); }
+    AABB        GetBounds()    const { return mBounds; }
+    float       GetSAHCost()   const { return mSAHCost; }   // expected node + leaf tests per ray
+
+    /// Visits the leaves whose boxes the ray enters before ray.tMax, nearest box first.
+    /// leafFn(first, count, ray) may shorten ray.tMax; returning true stops the walk.
+    template<typename LeafFn>
+    void Traverse(CPURay& ray, CPUTraversalStats& stats, LeafFn&& leafFn) const;
+
+private:
+    struct BuildNode {
+        AABB     bounds;
+        uint32_t child[2] = {0, 0};
+        uint32_t first    = 0;
+        uint32_t count    = 0;   // > 0: leaf
+    };
+
+    uint32_t Collapse(const std::vector<BuildNode>& binary, uint32_t node);
+
+    /// Bitmask of the children whose boxes the ray enters, and their entry distances.
+    static uint32_t IntersectNode(const Node& node, const CPURay& ray, const glm::vec3& invDir, float tNear[4]);
+
+    std::vector<Node> mNodes;
+    AABB              mBounds;
+    float             mSAHCost = 0.0f;
+};
+
+/// Bottom-level structure over one mesh's triangles, the CPU counterpart of a BLAS.
+/// Triangles are stored in leaf order as a vertex plus two edges for Moller-Trumbore.
+class TriangleBVH {
+public:
+    void Build(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
+
+    /// Shortens ray.tMax and fills hit (except hit.instance) on a closer hit.
+    bool Intersect(CPURay& ray, CPUHit& hit, CPUTraversalStats& stats) const;
+    /// Any hit in (tMin, tMax).
+    bool Occluded(const CPURay& ray, CPUTraversalStats& stats) const;
+
+    AABB     GetBounds()        const { return mBVH.GetBounds(); }
+    uint32_t GetTriangleCount() const { return static_cast<uint32_t>(mTriangles.size()); }
+    const BVH4& GetBVH()        const { return mBVH; }
+
+private:
+    struct Triangle {
+        glm::vec3 v0, e1, e2;
+        uint32_t  primitive;
+    };
+
+    bool IntersectLeaf(uint32_t first, uint32_t count, CPURay& ray, CPUHit* hit, CPUTraversalStats& stats) const;
+
+    BVH4                  mBVH;
+    std::vector<Triangle> mTriangles;
+};
+
+/// Top-level structure over placed TriangleBVHs, the CPU counterpart of the TLAS: one
+/// instance per renderable with its world matrix, mesh and material. Rays enter an
+/// instance in its object space, so t is shared between the levels.
+class InstanceBVH {
+public:
+    struct Instance {
+        glm::mat4          objectToWorld{1.0f};
+        glm::mat4          worldToObject{1.0f};
+        const TriangleBVH* mesh          = nullptr;
+        uint32_t           meshIndex     = 0;
+        uint32_t           materialIndex = 0;
+    };
+
+    void Clear() { mInstances.clear(); }
+    void Add(const TriangleBVH* mesh, uint32_t meshIndex, uint32_t materialIndex, const glm::mat4& objectToWorld);
+    /// Builds over the instances added since Clear().
+    void Build();
+
+    bool Intersect(CPURay& ray, CPUHit& hit, CPUTraversalStats& stats) const;
+    bool Occluded(const CPURay& ray, CPUTraversalStats& stats) const;
+
+    const std::vector<Instance>& GetInstances() const { return mInstances; }
+    const BVH4& GetBVH() const { return mBVH; }
+
+private:
+    static CPURay ToObject(const CPURay& ray, const Instance& inst);
+
+    BVH4                  mBVH;
+    std::vector<Instance> mInstances;   // in leaf order after Build()
+};
+
+// -----------------------------------------------------------------------
+
+template<typename LeafFn>
+void BVH4::Traverse(CPURay& ray, CPUTraversalStats& stats, LeafFn&& leafFn) const {
+    if (mNodes.empty()) return;
+
+    // Zero direction components become huge but finite, so 0 * inv never makes a NaN
+    glm::vec3 invDir;
+    for (int a = 0; a < 3; a++) {
+        float d = ray.dir[a];
+        invDir[a] = 1.0f / (std::abs(d) > 1e-20f ? d : (d < 0.0f ? -1e-20f : 1e-20f));
+    }
+
+    struct Entry { uint32_t child; float t; };
+    Entry    stack[STACK_SIZE];
+    uint32_t top = 0;
+    stack[top++] = {0, ray.tMin};
+
+    while (top > 0) {
+        Entry e = stack[--top];
+        if (e.t > ray.tMax) continue;   // a closer hit was found after the push
+
+        if (IsLeaf(e.child)) {
+            if (leafFn(LeafFirst(e.child), LeafCount(e.child), ray)) return;
+            continue;
+        }
+
+        const Node& node = mNodes[e.child];
+        float    tNear[4];
+        uint32_t mask = IntersectNode(node, ray, invDir, tNear);
+        stats.nodeTests++;
+
+        // Push farthest first so the nearest child is popped next
+        uint32_t order[4], count = 0;
+        for (uint32_t c = 0; c < 4; c++) {
+            if (!(mask & (1u << c))) continue;
+            uint32_t i = count++;
+            while (i > 0 && tNear[order[i - 1]] < tNear[c]) { order[i] = order[i - 1]; i--; }
+            order[i] = c;
+        }
+        for (uint32_t i = 0; i < count; i++)
+            stack[top++] = {node.child[order[i]], tNear[order[i]]};
+    }
+}
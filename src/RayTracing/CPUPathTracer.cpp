@@ -0,0 +1,372 @@
+#include "RayTracing/CPUPathTracer.h"
+#include "Core/ThreadPool.h"
+#include "Core/Logger.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+
+// Constants, RNG, sampling and BRDF terms of pt_common.glsl
+constexpr float PI       = 3.14159265359f;
+constexpr float INV_PI   = 0.31830988618f;
+constexpr float EPSILON  = 1e-4f;
+constexpr float RAY_TMAX = 10000.0f;
+
+uint32_t PcgHash(uint32_t v) {
+    uint32_t state = v * 747796405u + 2891336453u;
+    uint32_t word  = ((state >> ((state >> 28u) + 4u)) ^ state) * 277803737u;
+    return (word >> 22u) ^ word;
+}
+
+struct Rng {
+    uint32_t state;
+
+    float Next() {
+        state = PcgHash(state);
+        return static_cast<float>(state) / 4294967296.0f;
+    }
+    glm::vec2 Next2() { return {Next(), Next()}; }   // braced: left to right, like rand2()
+};
+
+glm::vec3 SampleCosineHemisphere(const glm::vec3& N, const glm::vec2& u) {
+    float phi      = 2.0f * PI * u.x;
+    float cosTheta = std::sqrt(u.y);
+    float sinTheta = std::sqrt(1.0f - u.y);
+    glm::vec3 T = glm::normalize(glm::cross(N, std::abs(N.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0)));
+    glm::vec3 B = glm::cross(N, T);
+    return glm::normalize(T * std::cos(phi) * sinTheta + B * std::sin(phi) * sinTheta + N * cosTheta);
+}
+
+glm::vec3 SampleGGXVNDF(const glm::vec3& Ve, float roughness, const glm::vec2& u) {
+    float a = roughness * roughness;
+    glm::vec3 Vh = glm::normalize(glm::vec3(a * Ve.x, a * Ve.y, Ve.z));
+    float lensq = Vh.x * Vh.x + Vh.y * Vh.y;
+    glm::vec3 T1 = lensq > 0.0f ? glm::vec3(-Vh.y, Vh.x, 0.0f) / std::sqrt(lensq) : glm::vec3(1, 0, 0);
+    glm::vec3 T2 = glm::cross(Vh, T1);
+    float r   = std::sqrt(u.x);
+    float phi = 2.0f * PI * u.y;
+    float t1  = r * std::cos(phi);
+    float t2  = r * std::sin(phi);
+    float s   = 0.5f * (1.0f + Vh.z);
+    t2 = (1.0f - s) * std::sqrt(1.0f - t1 * t1) + s * t2;
+    glm::vec3 Nh = t1 * T1 + t2 * T2 + std::sqrt(std::max(0.0f, 1.0f - t1 * t1 - t2 * t2)) * Vh;
+    return glm::normalize(glm::vec3(a * Nh.x, a * Nh.y, std::max(0.0f, Nh.z)));
+}
+
+float DistributionGGX(float NdotH, float a2) {
+    float d = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+    return a2 / (PI * d * d);
+}
+
+float GeometrySmithG1(float NdotV, float a2) {
+    return 2.0f * NdotV / (NdotV + std::sqrt(a2 + (1.0f - a2) * NdotV * NdotV));
+}
+
+float GeometrySmith(float NdotV, float NdotL, float a2) {
+    return GeometrySmithG1(NdotV, a2) * GeometrySmithG1(NdotL, a2);
+}
+
+glm::vec3 FresnelSchlick(float cosTheta, const glm::vec3& F0) {
+    return F0 + (1.0f - F0) * std::pow(std::clamp(1.0f - cosTheta, 0.0f, 1.0f), 5.0f);
+}
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+// -----------------------------------------------------------------------
+// Scene
+// -----------------------------------------------------------------------
+
+void CPUPathTracer::SetMeshes(const std::vector<MeshData>& meshes) {
+    mMeshes.clear();
+    mMeshes.resize(meshes.size());
+    for (size_t m = 0; m < meshes.size(); m++) {
+        Mesh& dst = mMeshes[m];
+        dst.positions.reserve(meshes[m].vertices.size());
+        dst.normals.reserve(meshes[m].vertices.size());
+        for (const MeshVertex& v : meshes[m].vertices) {
+            dst.positions.push_back(v.position);
+            dst.normals.push_back(v.normal);
+        }
+        dst.indices = meshes[m].indices;
+    }
+}
+
+void CPUPathTracer::SetScene(const Registry& registry, const std::vector<GPUMaterialData>& materials,
+                             ThreadPool* pool) {
+    auto start = std::chrono::steady_clock::now();
+
+    // Mesh BVHs not built yet, largest first so the last ones to finish are small
+    std::vector<uint32_t> pending;
+    for (uint32_t m = 0; m < mMeshes.size(); m++)
+        if (!mMeshes[m].built) pending.push_back(m);
+    std::sort(pending.begin(), pending.end(), [this](uint32_t a, uint32_t b) {
+        return mMeshes[a].indices.size() > mMeshes[b].indices.size();
+    });
+
+    // One chunk per worker; each claims meshes from the shared counter
+    std::atomic<uint32_t> next{0};
+    uint32_t workers = ParallelChunkCount(pool, pending.size());
+    ParallelForChunks(pool, workers, workers, [&](uint32_t, size_t, size_t) {
+        for (uint32_t i; (i = next.fetch_add(1)) < pending.size();) {
+            Mesh& mesh = mMeshes[pending[i]];
+            mesh.bvh.Build(mesh.positions, mesh.indices);
+            mesh.positions = {};
+            mesh.built     = true;
+        }
+    });
+
+    mStats.blasMs    = MsSince(start);
+    mStats.meshes    = static_cast<uint32_t>(mMeshes.size());
+    mStats.triangles = 0;
+    double weightedCost = 0.0;
+    for (const Mesh& mesh : mMeshes) {
+        mStats.triangles += mesh.bvh.GetTriangleCount();
+        weightedCost     += double(mesh.bvh.GetBVH().GetSAHCost()) * mesh.bvh.GetTriangleCount();
+    }
+    mStats.blasSAHCost = mStats.triangles ? static_cast<float>(weightedCost / double(mStats.triangles)) : 0.0f;
+
+    // Factors only: the GPU tracer's default textures are white, so untextured
+    // materials shade the same
+    mMaterials.assign(std::max<size_t>(materials.size(), 1), Material{});
+    for (size_t i = 0; i < materials.size(); i++) {
+        mMaterials[i].baseColor = glm::vec3(materials[i].baseColorFactor);
+        mMaterials[i].metallic  = std::clamp(materials[i].metallicFactor, 0.0f, 1.0f);
+        mMaterials[i].roughness = std::clamp(materials[i].roughnessFactor, 0.04f, 1.0f);
+    }
+
+    auto tlasStart = std::chrono::steady_clock::now();
+    const uint32_t maxMaterial = static_cast<uint32_t>(mMaterials.size()) - 1;
+    mScene.Clear();
+    registry.ForEachRenderable(
+        [&](uint32_t, const TransformComponent& xform, const MeshComponent& mesh, const MaterialComponent& mat) {
+            if (mesh.meshIndex < 0 || mesh.meshIndex >= static_cast<int>(mMeshes.size())) return;
+            uint32_t material = std::min(static_cast<uint32_t>(std::max(mat.materialIndex, 0)), maxMaterial);
+            mScene.Add(&mMeshes[mesh.meshIndex].bvh, static_cast<uint32_t>(mesh.meshIndex), material,
+                       xform.worldMatrix);
+        });
+    mScene.Build();
+    mStats.tlasMs      = MsSince(tlasStart);
+    mStats.instances   = static_cast<uint32_t>(mScene.GetInstances().size());
+    mStats.tlasSAHCost = mScene.GetBVH().GetSAHCost();
+
+    LOG_INFO("CPU path tracer: {} mesh BVHs ({:.2f}M tris) in {:.1f} ms, {} instances in {:.2f} ms",
+             pending.size(), mStats.triangles / 1e6, mStats.blasMs, mStats.instances, mStats.tlasMs);
+}
+
+// -----------------------------------------------------------------------
+// Integrator
+// -----------------------------------------------------------------------
+
+// One path of pt_raygen.rgen: the same seed, jitter, bounce loop and clamps
+glm::vec3 CPUPathTracer::TracePath(uint32_t x, uint32_t y, uint32_t sample, const CPUTraceView& view,
+                                   WorkerStats& ws) const {
+    const uint32_t w = mSettings.width;
+    const uint32_t h = mSettings.height;
+    Rng rng{PcgHash(x + y * w + sample * w * h)};
+
+    glm::vec2 jitter = rng.Next2() - 0.5f;
+    glm::vec2 uv     = (glm::vec2(float(x), float(y)) + 0.5f + jitter) / glm::vec2(float(w), float(h));
+    glm::vec4 target = view.invViewProj * glm::vec4(uv * 2.0f - 1.0f, 0.0f, 1.0f);
+
+    glm::vec3 origin    = view.cameraPos;
+    glm::vec3 direction = glm::normalize(glm::vec3(target) / target.w - origin);
+
+    glm::vec3 color(0.0f);
+    glm::vec3 throughput(1.0f);
+    const auto& instances = mScene.GetInstances();
+
+    for (uint32_t bounce = 0; bounce < mSettings.maxBounces; bounce++) {
+        CPURay ray{origin, EPSILON, direction, RAY_TMAX};
+        CPUHit hit;
+        (bounce == 0 ? ws.primaryRays : ws.bounceRays)++;
+        if (!mScene.Intersect(ray, hit, ws.traversal)) {
+            color += throughput * mSettings.skyColor;
+            break;
+        }
+
+        // pt_closesthit.rchit without the texture fetches
+        const InstanceBVH::Instance& inst = instances[hit.instance];
+        const Mesh&     mesh = mMeshes[inst.meshIndex];
+        const uint32_t* tri  = &mesh.indices[size_t(hit.primitive) * 3];
+        glm::vec3 localNormal = mesh.normals[tri[0]] * (1.0f - hit.u - hit.v)
+                              + mesh.normals[tri[1]] * hit.u
+                              + mesh.normals[tri[2]] * hit.v;
+        glm::vec3 N = glm::normalize(glm::mat3(inst.objectToWorld) * localNormal);
+
+        const Material& mat = mMaterials[inst.materialIndex];
+        glm::vec3 hitPos     = origin + direction * hit.t;
+        glm::vec3 surfAlbedo = mat.baseColor;
+        float     metallic   = mat.metallic;
+        float     roughness  = mat.roughness;
+
+        glm::vec3 V  = -direction;
+        glm::vec3 F0 = glm::mix(glm::vec3(0.04f), surfAlbedo, metallic);
+
+        // Direct lighting with shadow ray
+        glm::vec3 L = glm::normalize(view.sunDir);
+        float NdotL = std::max(glm::dot(N, L), 0.0f);
+        if (NdotL > 0.0f) {
+            glm::vec3 T_ = glm::normalize(glm::cross(L, std::abs(L.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0)));
+            glm::vec3 B_ = glm::cross(L, T_);
+            float angle_ = rng.Next() * 2.0f * PI;
+            float r_     = std::sqrt(rng.Next()) * view.lightRadius;
+            glm::vec3 jitteredL = glm::normalize(L + T_ * std::cos(angle_) * r_ + B_ * std::sin(angle_) * r_);
+
+            CPURay shadow{hitPos + N * EPSILON, EPSILON, jitteredL, RAY_TMAX};
+            ws.shadowRays++;
+            if (!mScene.Occluded(shadow, ws.traversal)) {
+                glm::vec3 H = glm::normalize(V + jitteredL);
+                float NdotH = std::max(glm::dot(N, H), 0.0f);
+                float VdotH = std::max(glm::dot(V, H), 0.0f);
+                float NdotV = std::max(glm::dot(N, V), 0.001f);
+                float a2    = roughness * roughness * roughness * roughness;
+
+                float     D = DistributionGGX(NdotH, a2);
+                float     G = GeometrySmith(NdotV, NdotL, a2);
+                glm::vec3 F = FresnelSchlick(VdotH, F0);
+
+                glm::vec3 spec = (D * G * F) / (4.0f * NdotV * NdotL + 0.0001f);
+                glm::vec3 kD   = (1.0f - F) * (1.0f - metallic);
+                glm::vec3 diff = kD * surfAlbedo * INV_PI;
+
+                glm::vec3 radiance = view.sunColor * view.sunIntensity;
+                color += throughput * (diff + spec) * radiance * NdotL;
+            }
+        }
+
+        // BSDF importance sampling for next bounce
+        float     NdotV      = std::max(glm::dot(N, V), 0.001f);
+        glm::vec3 F_avg      = FresnelSchlick(NdotV, F0);
+        float     specWeight = (F_avg.r + F_avg.g + F_avg.b) / 3.0f;
+        float     diffWeight = (1.0f - specWeight) * (1.0f - metallic);
+        float     pSpec      = std::clamp(specWeight / std::max(specWeight + diffWeight, 0.001f), 0.1f, 0.9f);
+
+        // Lobe choice and roulette come from one 2D draw, like PathSample2D(SAMPLE_LOBE_RR)
+        glm::vec2 uLobeRR = rng.Next2();
+        glm::vec3 newDir;
+        glm::vec3 bsdfWeight;
+        if (uLobeRR.x < pSpec) {
+            float a = std::max(roughness * roughness, 0.001f);
+            glm::vec3 T_ = glm::normalize(glm::cross(N, std::abs(N.y) < 0.99f ? glm::vec3(0, 1, 0) : glm::vec3(1, 0, 0)));
+            glm::vec3 B_ = glm::cross(N, T_);
+            glm::mat3 TBN(T_, B_, N);
+            glm::vec3 Ve = glm::transpose(TBN) * V;
+
+            glm::vec3 H = TBN * SampleGGXVNDF(Ve, roughness, rng.Next2());
+            newDir = glm::reflect(-V, H);
+            if (glm::dot(newDir, N) <= 0.0f) break;
+
+            float VdotH  = std::max(glm::dot(V, H), 0.0f);
+            float NdotL_ = std::max(glm::dot(N, newDir), 0.0f);
+            float a2     = a * a;
+
+            glm::vec3 F  = FresnelSchlick(VdotH, F0);
+            float     G  = GeometrySmith(NdotV, NdotL_, a2);
+            float     G1 = GeometrySmithG1(NdotV, a2);
+
+            bsdfWeight = F * (G / std::max(G1, 0.001f)) / pSpec;
+        } else {
+            newDir = SampleCosineHemisphere(N, rng.Next2());
+            glm::vec3 kD = (1.0f - F_avg) * (1.0f - metallic);
+            bsdfWeight = kD * surfAlbedo / (1.0f - pSpec);
+        }
+
+        throughput *= bsdfWeight;
+
+        float tMax = std::max(throughput.r, std::max(throughput.g, throughput.b));
+        if (tMax > 2.0f)
+            throughput *= 2.0f / tMax;
+
+        // Russian roulette after bounce 2
+        if (bounce > 1) {
+            float p = std::clamp(tMax, 0.05f, 0.9f);
+            if (uLobeRR.y > p) break;
+            throughput /= p;
+        }
+
+        origin    = hitPos + N * EPSILON;
+        direction = newDir;
+    }
+
+    // NaN / Inf protection and firefly suppression
+    for (int c = 0; c < 3; c++)
+        if (!std::isfinite(color[c])) return glm::vec3(0.0f);
+    color = glm::max(color, glm::vec3(0.0f));
+    float cMax = std::max(color.r, std::max(color.g, color.b));
+    if (cMax > 50.0f)
+        color *= 50.0f / cMax;
+    return color;
+}
+
+void CPUPathTracer::RenderTile(uint32_t tile, const CPUTraceView& view, WorkerStats& ws) {
+    const uint32_t ts     = mSettings.tileSize;
+    const uint32_t tilesX = (mSettings.width + ts - 1) / ts;
+    const uint32_t x0 = (tile % tilesX) * ts, x1 = std::min(x0 + ts, mSettings.width);
+    const uint32_t y0 = (tile / tilesX) * ts, y1 = std::min(y0 + ts, mSettings.height);
+    const float    invSpp = 1.0f / static_cast<float>(mSettings.samplesPerPixel);
+
+    for (uint32_t y = y0; y < y1; y++)
+        for (uint32_t x = x0; x < x1; x++) {
+            glm::vec3 sum(0.0f);
+            for (uint32_t s = 0; s < mSettings.samplesPerPixel; s++)
+                sum += TracePath(x, y, s, view, ws);
+            mImage[size_t(y) * mSettings.width + x] = sum * invSpp;
+        }
+}
+
+void CPUPathTracer::Render(const CPUTraceView& view, ThreadPool* pool) {
+    auto start = std::chrono::steady_clock::now();
+
+    mSettings.samplesPerPixel = std::max(mSettings.samplesPerPixel, 1u);
+    mSettings.tileSize        = std::max(mSettings.tileSize, 1u);
+    mImage.assign(size_t(mSettings.width) * mSettings.height, glm::vec3(0.0f));
+
+    const uint32_t ts    = mSettings.tileSize;
+    const uint32_t tiles = ((mSettings.width + ts - 1) / ts) * ((mSettings.height + ts - 1) / ts);
+    const uint32_t workers = ParallelChunkCount(pool, tiles);
+
+    // One chunk per worker; each claims tiles from the shared counter
+    std::vector<WorkerStats> workerStats(workers);
+    std::atomic<uint32_t>    next{0};
+    ParallelForChunks(pool, workers, workers, [&](uint32_t worker, size_t, size_t) {
+        for (uint32_t t; (t = next.fetch_add(1)) < tiles;)
+            RenderTile(t, view, workerStats[worker]);
+    });
+
+    mStats.primaryRays = mStats.bounceRays = mStats.shadowRays = 0;
+    mStats.traversal   = {};
+    for (const WorkerStats& ws : workerStats) {
+        mStats.primaryRays += ws.primaryRays;
+        mStats.bounceRays  += ws.bounceRays;
+        mStats.shadowRays  += ws.shadowRays;
+        mStats.traversal   += ws.traversal;
+    }
+    mStats.threads  = workers;
+    mStats.renderMs = MsSince(start);
+}
+
+bool CPUPathTracer::WritePFM(const std::string& path) const {
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "PFM rows are written as packed RGB floats");
+    if (mImage.empty()) return false;
+
+    FILE* f = std::fopen(path.c_str(), "wb");
+    if (!f) {
+        LOG_ERROR("Cannot write {}", path);
+        return false;
+    }
+    // Little-endian (negative scale), rows bottom to top
+    std::fprintf(f, "PF\n%u %u\n-1.0\n", mSettings.width, mSettings.height);
+    for (uint32_t y = mSettings.height; y-- > 0;)
+        std::fwrite(&mImage[size_t(y) * mSettings.width], sizeof(glm::vec3), mSettings.width, f);
+    bool ok = std::ferror(f) == 0;
+    std::fclose(f);
+    return ok;
+}
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "RayTracing/CPUBVH.h"
+#include "Asset/ModelLoader.h"
+#include "Scene/Scene.h"
+#include "Scene/ECS.h"
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class ThreadPool;
+
+/// Camera and sun of one reference frame, the inputs of CPUPathTracer::Render.
+struct CPUTraceView {
+    glm::mat4 invViewProj{1.0f};
+    glm::vec3 cameraPos{0.0f};
+    glm::vec3 sunDir{0.0f, 1.0f, 0.0f};   // towards the sun
+    glm::vec3 sunColor{1.0f};
+    float     sunIntensity = 1.0f;
+    float     lightRadius  = 0.0f;
+};
+
+/// Of the last SetScene() and Render().
+struct CPUPathTracerStats {
+    uint32_t meshes      = 0;
+    uint64_t triangles   = 0;
+    uint32_t instances   = 0;
+    double   blasMs      = 0.0;   // mesh BVHs built by this SetScene, in parallel
+    double   tlasMs      = 0.0;
+    float    blasSAHCost = 0.0f;  // triangle-weighted mean over the meshes
+    float    tlasSAHCost = 0.0f;
+
+    uint64_t primaryRays = 0;
+    uint64_t bounceRays  = 0;
+    uint64_t shadowRays  = 0;
+    CPUTraversalStats traversal;
+    uint32_t threads     = 0;
+    double   renderMs    = 0.0;
+
+    uint64_t Rays() const { return primaryRays + bounceRays + shadowRays; }
+    double MRaysPerSecond() const { return renderMs > 0.0 ? double(Rays()) / (renderMs * 1e3) : 0.0; }
+    double MRaysPerSecondPerCore() const { return threads ? MRaysPerSecond() / threads : 0.0; }
+};
+
+/// Reference path tracer on the CPU, independent of Vulkan: the integrator of
+/// pt_raygen.rgen with the surface model of pt_closesthit.rchit (GGX specular with VNDF
+/// sampling, Lambert diffuse, one jittered sun shadow ray per bounce, Russian roulette
+/// after bounce 2) over a TriangleBVH per mesh and an InstanceBVH per scene. Textures
+/// and the environment map are not sampled: materials use their factors and misses
+/// return Settings::skyColor, so results match the GPU tracer on untextured scenes.
+/// Pixels are seeded like the ray generation shader and rendered in tiles spread over
+/// a ThreadPool, so the image does not depend on the thread count.
+class CPUPathTracer {
+public:
+    struct Settings {
+        uint32_t  width           = 640;
+        uint32_t  height          = 360;
+        uint32_t  samplesPerPixel = 16;
+        uint32_t  maxBounces      = 8;
+        uint32_t  tileSize        = 16;
+        glm::vec3 skyColor{0.6f, 0.7f, 0.9f};
+    };
+
+    /// Keeps LOD0 positions, normals and indices of every mesh, indexed like
+    /// MeshComponent::meshIndex. Their BVHs are built by the next SetScene().
+    void SetMeshes(const std::vector<MeshData>& meshes);
+
+    /// Builds missing mesh BVHs and the instance BVH over every renderable. pool may be null.
+    void SetScene(const Registry& registry, const std::vector<GPUMaterialData>& materials, ThreadPool* pool);
+
+    /// Averages Settings::samplesPerPixel paths per pixel into GetImage(). pool may be null.
+    void Render(const CPUTraceView& view, ThreadPool* pool);
+
+    /// Linear HDR, row 0 at the top.
+    const std::vector<glm::vec3>& GetImage() const { return mImage; }
+    /// Portable float map, the golden-image format: lossless and trivially diffable.
+    bool WritePFM(const std::string& path) const;
+
+    bool HasMeshes() const { return !mMeshes.empty(); }
+
+    Settings&       GetSettings()       { return mSettings; }
+    const Settings& GetSettings() const { return mSettings; }
+    const CPUPathTracerStats& GetStats() const { return mStats; }
+
+private:
+    struct Mesh {
+        std::vector<glm::vec3> positions;   // dropped once the BVH is built
+        std::vector<glm::vec3> normals;
+        std::vector<uint32_t>  indices;
+        TriangleBVH            bvh;
+        bool                   built = false;
+    };
+
+    struct Material {
+        glm::vec3 baseColor{1.0f};
+        float     metallic  = 0.0f;
+        float     roughness = 0.5f;
+    };
+
+    struct WorkerStats {
+        uint64_t          primaryRays = 0;
+        uint64_t          bounceRays  = 0;
+        uint64_t          shadowRays  = 0;
+        CPUTraversalStats traversal;
+    };
+
+    glm::vec3 TracePath(uint32_t x, uint32_t y, uint32_t sample, const CPUTraceView& view, WorkerStats& ws) const;
+    void      RenderTile(uint32_t tile, const CPUTraceView& view, WorkerStats& ws);
+
+    Settings               mSettings;
+    std::vector<Mesh>      mMeshes;
+    std::vector<Material>  mMaterials;
+    InstanceBVH            mScene;
+    std::vector<glm::vec3> mImage;
+    CPUPathTracerStats     mStats;
+};
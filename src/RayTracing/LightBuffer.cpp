@@ -0,0 +1,202 @@
+#include "RayTracing/LightBuffer.h"
+#include "RayTracing/AccelStructure.h"
+#include "Resource/TransferManager.h"
+#include "Core/Logger.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr float kPi = 3.14159265359f;
+
+float Luminance(const glm::vec3& c) { return 0.2126f * c.r + 0.7152f * c.g + 0.0722f * c.b; }
+
+float SRGBToLinear(uint8_t v) {
+    float c = float(v) / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// Nearest texel with repeat wrapping; emissive textures are uploaded as sRGB
+glm::vec3 SampleEmissive(const TextureData& tex, glm::vec2 uv) {
+    if (tex.width == 0 || tex.height == 0 || tex.pixels.size() < size_t(tex.width) * tex.height * 4)
+        return glm::vec3(0.0f);
+    uv -= glm::floor(uv);
+    uint32_t x = std::min(uint32_t(uv.x * float(tex.width)),  tex.width - 1);
+    uint32_t y = std::min(uint32_t(uv.y * float(tex.height)), tex.height - 1);
+    const uint8_t* p = &tex.pixels[(size_t(y) * tex.width + x) * 4];
+    return glm::vec3(SRGBToLinear(p[0]), SRGBToLinear(p[1]), SRGBToLinear(p[2]));
+}
+
+} // namespace
+
+void LightBuffer::SetMeshes(const std::vector<MeshData>& meshes,
+                            const std::vector<MaterialData>& materials,
+                            const std::vector<TextureData>& textures) {
+    mMeshTriangles.assign(meshes.size(), {});
+    mMeshMaterials.assign(meshes.size(), -1);
+
+    size_t triangles = 0;
+    for (size_t m = 0; m < meshes.size(); m++) {
+        const MeshData& mesh = meshes[m];
+        if (mesh.materialIndex < 0 || mesh.materialIndex >= static_cast<int>(materials.size())) continue;
+        const MaterialData& mat = materials[mesh.materialIndex];
+        if (mat.emissiveTextureIndex < 0 || mat.emissiveTextureIndex >= static_cast<int>(textures.size())) continue;
+
+        const TextureData& tex = textures[mat.emissiveTextureIndex];
+        glm::vec3 factor = glm::vec3(mat.baseColorFactor);
+
+        // Keep every triangle, black ones included, so primitive IDs index the light list
+        std::vector<EmissiveTriangle> tris;
+        tris.reserve(mesh.indices.size() / 3);
+        bool emits = false;
+        for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+            const MeshVertex& v0 = mesh.vertices[mesh.indices[i]];
+            const MeshVertex& v1 = mesh.vertices[mesh.indices[i + 1]];
+            const MeshVertex& v2 = mesh.vertices[mesh.indices[i + 2]];
+
+            glm::vec3 e = SampleEmissive(tex, v0.texCoord) + SampleEmissive(tex, v1.texCoord) +
+                          SampleEmissive(tex, v2.texCoord) +
+                          SampleEmissive(tex, (v0.texCoord + v1.texCoord + v2.texCoord) / 3.0f);
+
+            EmissiveTriangle t;
+            t.p0 = v0.position;
+            t.p1 = v1.position;
+            t.p2 = v2.position;
+            t.radiance = e * 0.25f * factor;
+            emits |= Luminance(t.radiance) > 0.0f;
+            tris.push_back(t);
+        }
+        if (!emits) continue;
+
+        triangles += tris.size();
+        mMeshTriangles[m] = std::move(tris);
+        mMeshMaterials[m] = mesh.materialIndex;
+    }
+
+    LOG_INFO("LightBuffer: {} emissive triangles in {} meshes", triangles,
+             std::count_if(mMeshTriangles.begin(), mMeshTriangles.end(),
+                           [](const auto& t) { return !t.empty(); }));
+}
+
+void LightBuffer::Build(VmaAllocator allocator, TransferManager& transfer,
+                        const Registry& registry, const AccelStructure& accel,
+                        std::vector<RTInstanceInfo>& instanceInfos) {
+    Destroy(allocator);
+
+    std::vector<GPULight> lights;
+    std::vector<float>    power;
+
+    registry.ForEachLight([&](Entity, const LightComponent& lc, const TransformComponent* tc) {
+        if (lc.type == LightComponent::Type::Directional || !tc) return;
+        if (lights.size() >= kMaxLights) return;
+
+        GPULight l{};
+        l.position  = glm::vec3(tc->worldMatrix[3]);
+        l.direction = glm::normalize(lc.direction);
+        l.radiance  = lc.color * lc.intensity;
+        l.range     = lc.range;
+        float solidAngle = 4.0f * kPi;
+        if (lc.type == LightComponent::Type::Spot) {
+            l.type     = Spot;
+            l.cosOuter = std::cos(lc.outerConeAngle);
+            l.cosInner = std::cos(std::min(lc.innerConeAngle, lc.outerConeAngle));
+            solidAngle = 2.0f * kPi * (1.0f - 0.5f * (l.cosInner + l.cosOuter));
+        } else {
+            l.type     = Point;
+            l.cosOuter = -1.0f;
+            l.cosInner = -1.0f;
+        }
+        lights.push_back(l);
+        power.push_back(Luminance(l.radiance) * solidAngle);
+    });
+    mPunctualCount = static_cast<uint32_t>(lights.size());
+
+    uint32_t skipped = 0;
+    for (uint32_t i = 0; i < static_cast<uint32_t>(instanceInfos.size()); i++) {
+        instanceInfos[i].lightOffset = ~0u;
+
+        int mesh = accel.GetInstanceMesh(i);
+        if (mesh < 0 || mesh >= static_cast<int>(mMeshTriangles.size())) continue;
+        const auto& tris = mMeshTriangles[mesh];
+        // Emission is a property of the material: instances re-using the mesh with another one don't emit
+        if (tris.empty() || static_cast<int>(instanceInfos[i].materialIndex) != mMeshMaterials[mesh]) continue;
+        if (lights.size() + tris.size() > kMaxLights) { skipped++; continue; }
+
+        instanceInfos[i].lightOffset = static_cast<uint32_t>(lights.size());
+        const glm::mat4& model = accel.GetInstanceTransform(i);
+        for (const EmissiveTriangle& t : tris) {
+            glm::vec3 p0 = glm::vec3(model * glm::vec4(t.p0, 1.0f));
+            glm::vec3 e1 = glm::vec3(model * glm::vec4(t.p1, 1.0f)) - p0;
+            glm::vec3 e2 = glm::vec3(model * glm::vec4(t.p2, 1.0f)) - p0;
+            float area = 0.5f * glm::length(glm::cross(e1, e2));
+
+            GPULight l{};
+            l.position  = p0;
+            l.type      = Triangle;
+            l.direction = e1;
+            l.range     = area;
+            l.radiance  = t.radiance;
+            l.edge2     = e2;
+            lights.push_back(l);
+            // Two-sided Lambertian emitter
+            power.push_back(area > 0.0f ? Luminance(t.radiance) * area * 2.0f * kPi : 0.0f);
+        }
+    }
+    mTriangleCount = static_cast<uint32_t>(lights.size()) - mPunctualCount;
+    if (skipped > 0)
+        LOG_WARN("LightBuffer: {} emissive instances over the {} light cap are not sampled", skipped, kMaxLights);
+
+    // The shaders index by frame.lights.x; a one-entry dummy keeps the bindings valid
+    std::vector<AliasEntry> alias = BuildAliasTable(power);
+    if (lights.empty()) {
+        lights.push_back(GPULight{});
+        alias.push_back(AliasEntry{1.0f, 0u, 0.0f, 0u});
+    }
+    mLightBuffer.CreateDeviceLocal(allocator, transfer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                   lights.data(), lights.size() * sizeof(GPULight));
+    mAliasBuffer.CreateDeviceLocal(allocator, transfer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                   alias.data(), alias.size() * sizeof(AliasEntry));
+    mVersion++;
+
+    LOG_INFO("LightBuffer built: {} punctual + {} triangle lights", mPunctualCount, mTriangleCount);
+}
+
+void LightBuffer::Destroy(VmaAllocator allocator) {
+    mLightBuffer.Destroy(allocator);
+    mAliasBuffer.Destroy(allocator);
+    mPunctualCount = 0;
+    mTriangleCount = 0;
+}
+
+std::vector<LightBuffer::AliasEntry> LightBuffer::BuildAliasTable(const std::vector<float>& weights) {
+    const uint32_t n = static_cast<uint32_t>(weights.size());
+    std::vector<AliasEntry> table(n);
+    if (n == 0) return table;
+
+    double total = 0.0;
+    for (float w : weights) total += std::max(w, 0.0f);
+
+    std::vector<double>   scaled(n);
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < n; i++) {
+        double p = total > 0.0 ? std::max(weights[i], 0.0f) / total : 1.0 / n;
+        table[i].pdf   = static_cast<float>(p);
+        table[i].alias = i;
+        scaled[i]      = p * n;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back(); small.pop_back();
+        uint32_t l = large.back(); large.pop_back();
+        table[s].prob  = static_cast<float>(scaled[s]);
+        table[s].alias = l;
+        scaled[l] -= 1.0 - scaled[s];
+        (scaled[l] < 1.0 ? small : large).push_back(l);
+    }
+    // Leftovers are 1 up to rounding
+    for (uint32_t i : large) table[i].prob = 1.0f;
+    for (uint32_t i : small) table[i].prob = 1.0f;
+    return table;
+}
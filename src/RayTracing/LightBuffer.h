@@ -0,0 +1,92 @@
+#pragma once
+
+#include "Resource/VulkanBuffer.h"
+#include "Asset/ModelLoader.h"
+#include "Scene/ECS.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+class TransferManager;
+class AccelStructure;
+struct RTInstanceInfo;
+
+/// Lights the path tracer samples explicitly (pt_lights.glsl, set 0 bindings 21-22):
+/// the registry's point and spot lights, then every triangle of each instance drawn with
+/// an emissive material, grouped per TLAS instance so a hit's light is
+/// RTInstanceInfo::lightOffset + gl_PrimitiveID. An alias table picks lights in
+/// proportion to their emitted power in O(1). The sun stays outside the buffer.
+class LightBuffer {
+public:
+    static constexpr uint32_t kMaxLights = 1u << 20;
+
+    enum LightType : uint32_t { Point = 0, Spot = 1, Triangle = 2 };   // LIGHT_* in pt_lights.glsl
+
+    /// PTLight in pt_lights.glsl
+    struct GPULight {
+        glm::vec3 position;    // point/spot position, triangle vertex 0
+        uint32_t  type;
+        glm::vec3 direction;   // spot axis, triangle edge v1 - v0
+        float     range;       // punctual range, triangle area
+        glm::vec3 radiance;    // punctual color * intensity, triangle emitted radiance
+        float     cosOuter;
+        glm::vec3 edge2;       // triangle edge v2 - v0
+        float     cosInner;
+    };
+    static_assert(sizeof(GPULight) == 64, "GPULight must match PTLight");
+
+    /// AliasEntry in pt_lights.glsl
+    struct AliasEntry {
+        float    prob;
+        uint32_t alias;
+        float    pdf;
+        uint32_t pad;
+    };
+
+    /// Keeps the object-space triangles of every mesh whose material emits, indexed like
+    /// MeshComponent::meshIndex. A triangle's radiance is the emissive texture averaged at
+    /// its corners and centroid times the base color factor, as ShadeSurface shades it.
+    void SetMeshes(const std::vector<MeshData>& meshes,
+                   const std::vector<MaterialData>& materials,
+                   const std::vector<TextureData>& textures);
+
+    /// Rebuilds the buffers in TLAS instance order and fills instanceInfos[i].lightOffset.
+    /// Instances are added whole until kMaxLights; the rest are only hit by chance.
+    void Build(VmaAllocator allocator, TransferManager& transfer,
+               const Registry& registry, const AccelStructure& accel,
+               std::vector<RTInstanceInfo>& instanceInfos);
+
+    void Destroy(VmaAllocator allocator);
+
+    VkBuffer     GetLightBuffer() const     { return mLightBuffer.GetHandle(); }
+    VkDeviceSize GetLightBufferSize() const { return mLightBuffer.GetSize(); }
+    VkBuffer     GetAliasBuffer() const     { return mAliasBuffer.GetHandle(); }
+    VkDeviceSize GetAliasBufferSize() const { return mAliasBuffer.GetSize(); }
+
+    uint32_t GetLightCount() const    { return mPunctualCount + mTriangleCount; }
+    uint32_t GetPunctualCount() const { return mPunctualCount; }
+    uint32_t GetTriangleCount() const { return mTriangleCount; }
+    /// Changes with every Build, so light indices held in reservoirs can be invalidated.
+    uint32_t GetVersion() const       { return mVersion; }
+
+    /// Vose's alias method over non-negative weights; all-zero weights give a uniform table.
+    static std::vector<AliasEntry> BuildAliasTable(const std::vector<float>& weights);
+
+private:
+    struct EmissiveTriangle {
+        glm::vec3 p0, p1, p2;
+        glm::vec3 radiance;
+    };
+
+    std::vector<std::vector<EmissiveTriangle>> mMeshTriangles;   // empty for non-emissive meshes
+    std::vector<int>                           mMeshMaterials;   // material the emission was taken from
+
+    VulkanBuffer mLightBuffer;
+    VulkanBuffer mAliasBuffer;
+    uint32_t     mPunctualCount = 0;
+    uint32_t     mTriangleCount = 0;
+    uint32_t     mVersion       = 0;
+};
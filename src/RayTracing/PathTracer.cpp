@@ -4,14 +4,15 @@
 #include "Core/Logger.h"
 
 #include <cmath>
+#include <cstddef>
 #include <cstring>
 #include <algorithm>
 
 void PathTracer::Initialize(VkDevice device, VmaAllocator allocator,
                              ShaderManager& shaders,
-                             const TransferManager& transfer,
+                             TransferManager& transfer,
                              const VkPhysicalDeviceRayTracingPipelinePropertiesKHR& rtProps,
-                             uint32_t width, uint32_t height) {
+                             uint32_t width, uint32_t height, uint32_t framesInFlight) {
     mDevice    = device;
     mAllocator = allocator;
     mTransfer  = &transfer;
@@ -22,6 +23,20 @@ void PathTracer::Initialize(VkDevice device, VmaAllocator allocator,
 
     CreateImages(width, height);
     CreateDescriptors();
+    mWavefront.Initialize(device, allocator, width, height);
+    mReSTIR.Initialize(device, allocator, width, height);
+
+    mAdaptiveTotals.CreateDeviceLocalEmpty(allocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, sizeof(glm::vec4));
+    mAdaptiveReadback.resize(framesInFlight);
+    for (auto& rb : mAdaptiveReadback)
+        rb.CreateReadback(allocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(glm::vec4));
+    mAdaptivePending.assign(framesInFlight, 0);
+    CreateHitStatsBuffers(framesInFlight);
+    CreateTileBuffers();
+    UpdateImageDescriptors();
+    UpdateAdaptiveDescriptors();
+    CreateAdaptivePipelines(shaders);
 
     LOG_INFO("PathTracer initialized: {}x{}", width, height);
 }
@@ -29,6 +44,8 @@ void PathTracer::Initialize(VkDevice device, VmaAllocator allocator,
 void PathTracer::Shutdown(VkDevice device, VmaAllocator allocator) {
     mPipeline.Destroy(device);
     mSBT.Destroy(allocator);
+    mWavefront.Shutdown(device, allocator);
+    mReSTIR.Shutdown(device, allocator);
 
     mColorOutput.Destroy(allocator, device);
     mAlbedoOutput.Destroy(allocator, device);
@@ -36,9 +53,26 @@ void PathTracer::Shutdown(VkDevice device, VmaAllocator allocator) {
     mDepthOutput.Destroy(allocator, device);
     mMotionOutput.Destroy(allocator, device);
     mAccumBuffer.Destroy(allocator, device);
+    mMomentsBuffer.Destroy(allocator, device);
+    mSurfaceOutput.Destroy(allocator, device);
     mInstanceInfoBuffer.Destroy(allocator);
     mFrameUBO.Destroy(allocator);
 
+    mTileSppBuffer.Destroy(allocator);
+    mTileStatsBuffer.Destroy(allocator);
+    mAdaptiveTotals.Destroy(allocator);
+    for (auto& rb : mAdaptiveReadback) rb.Destroy(allocator);
+    mAdaptiveReadback.clear();
+    mAdaptivePending.clear();
+    mHitStatsCounters.Destroy(allocator);
+    for (auto& rb : mHitStatsReadback) rb.Destroy(allocator);
+    mHitStatsReadback.clear();
+    mHitStatsPending.clear();
+    mHitStatsEnabledOnGPU = false;
+    if (mAdaptivePipeline)       { vkDestroyPipeline(device, mAdaptivePipeline, nullptr);       mAdaptivePipeline = VK_NULL_HANDLE; }
+    if (mAdaptiveReducePipeline) { vkDestroyPipeline(device, mAdaptiveReducePipeline, nullptr); mAdaptiveReducePipeline = VK_NULL_HANDLE; }
+    if (mAdaptivePipeLayout)     { vkDestroyPipelineLayout(device, mAdaptivePipeLayout, nullptr); mAdaptivePipeLayout = VK_NULL_HANDLE; }
+
     if (mPipelineLayout)    { vkDestroyPipelineLayout(device, mPipelineLayout, nullptr);    mPipelineLayout = VK_NULL_HANDLE; }
     if (mSceneDescLayout)   { vkDestroyDescriptorSetLayout(device, mSceneDescLayout, nullptr); mSceneDescLayout = VK_NULL_HANDLE; }
     if (mDescPool)          { vkDestroyDescriptorPool(device, mDescPool, nullptr);          mDescPool = VK_NULL_HANDLE; }
@@ -58,9 +92,18 @@ void PathTracer::Resize(VkDevice device, VmaAllocator allocator, uint32_t w, uin
     mDepthOutput.Destroy(allocator, device);
     mMotionOutput.Destroy(allocator, device);
     mAccumBuffer.Destroy(allocator, device);
+    mMomentsBuffer.Destroy(allocator, device);
+    mSurfaceOutput.Destroy(allocator, device);
 
     CreateImages(w, h);
     UpdateImageDescriptors();
+    mWavefront.Resize(device, allocator, w, h);
+    mReSTIR.Resize(device, allocator, w, h);
+
+    mTileSppBuffer.Destroy(allocator);
+    mTileStatsBuffer.Destroy(allocator);
+    CreateTileBuffers();
+    UpdateAdaptiveDescriptors();
     mAccumFrames = 0;
 }
 
@@ -73,8 +116,10 @@ void PathTracer::UpdateImageDescriptors() {
     VkDescriptorImageInfo albedoInfo{VK_NULL_HANDLE, mAlbedoOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
     VkDescriptorImageInfo depthInfo{VK_NULL_HANDLE, mDepthOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
     VkDescriptorImageInfo motionInfo{VK_NULL_HANDLE, mMotionOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo momentsInfo{VK_NULL_HANDLE, mMomentsBuffer.GetView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo surfaceInfo{VK_NULL_HANDLE, mSurfaceOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
 
-    VkWriteDescriptorSet writes[6] = {};
+    VkWriteDescriptorSet writes[8] = {};
     auto makeWrite = [&](int idx, uint32_t binding, VkDescriptorImageInfo* info) {
         writes[idx] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
         writes[idx].dstSet = mSceneDescSet; writes[idx].dstBinding = binding;
@@ -87,8 +132,114 @@ void PathTracer::UpdateImageDescriptors() {
     makeWrite(3, 4, &albedoInfo);
     makeWrite(4, 5, &depthInfo);
     makeWrite(5, 13, &motionInfo);
+    makeWrite(6, 15, &momentsInfo);
+    makeWrite(7, 23, &surfaceInfo);
 
-    vkUpdateDescriptorSets(mDevice, 6, writes, 0, nullptr);
+    vkUpdateDescriptorSets(mDevice, 8, writes, 0, nullptr);
+}
+
+void PathTracer::CreateTileBuffers() {
+    mTilesX = (mWidth  + kAdaptiveTile - 1) / kAdaptiveTile;
+    mTilesY = (mHeight + kAdaptiveTile - 1) / kAdaptiveTile;
+    VkDeviceSize tiles = VkDeviceSize(mTilesX) * mTilesY;
+
+    mTileSppBuffer.CreateDeviceLocalEmpty(mAllocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, tiles * sizeof(uint32_t));
+    mTileStatsBuffer.CreateDeviceLocalEmpty(mAllocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, tiles * sizeof(glm::vec4));
+}
+
+void PathTracer::UpdateAdaptiveDescriptors() {
+    if (mSceneDescSet == VK_NULL_HANDLE) return;
+
+    // Exact range for the tile stats: the reduce pass sums tileStats.length() entries
+    VkDescriptorBufferInfo infos[3] = {
+        {mTileSppBuffer.GetHandle(),   0, VK_WHOLE_SIZE},
+        {mTileStatsBuffer.GetHandle(), 0, mTileStatsBuffer.GetSize()},
+        {mAdaptiveTotals.GetHandle(),  0, VK_WHOLE_SIZE},
+    };
+    VkWriteDescriptorSet writes[3] = {};
+    for (uint32_t i = 0; i < 3; i++) {
+        writes[i] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        writes[i].dstSet = mSceneDescSet; writes[i].dstBinding = 16 + i;
+        writes[i].descriptorCount = 1; writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &infos[i];
+    }
+    vkUpdateDescriptorSets(mDevice, 3, writes, 0, nullptr);
+}
+
+void PathTracer::CreateAdaptivePipelines(ShaderManager& shaders) {
+    VkPushConstantRange pcRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(AdaptivePushConstants)};
+    VkPipelineLayoutCreateInfo plCI{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    plCI.setLayoutCount         = 1;
+    plCI.pSetLayouts            = &mSceneDescLayout;
+    plCI.pushConstantRangeCount = 1;
+    plCI.pPushConstantRanges    = &pcRange;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &plCI, nullptr, &mAdaptivePipeLayout));
+
+    auto create = [&](const char* path, VkPipeline& pipeline) {
+        VkComputePipelineCreateInfo pipeCI{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipeCI.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeCI.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeCI.stage.module = shaders.GetOrLoad(path);
+        pipeCI.stage.pName  = "main";
+        pipeCI.layout       = mAdaptivePipeLayout;
+        VK_CHECK(vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipeCI, nullptr, &pipeline));
+    };
+    create("shaders/pt_adaptive.comp.spv", mAdaptivePipeline);
+    create("shaders/pt_adaptive_reduce.comp.spv", mAdaptiveReducePipeline);
+}
+
+void PathTracer::CreateHitStatsBuffers(uint32_t framesInFlight) {
+    // Zeroed, so the hit shaders see the counters disabled until the first BeginHitStats
+    HitStatsCounters zero{};
+    mHitStatsCounters.CreateDeviceLocal(mAllocator, *mTransfer,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+        &zero, sizeof(zero));
+    mHitStatsReadback.resize(framesInFlight);
+    for (auto& rb : mHitStatsReadback)
+        rb.CreateReadback(mAllocator, VK_BUFFER_USAGE_TRANSFER_DST_BIT, sizeof(HitStatsCounters));
+    mHitStatsPending.assign(framesInFlight, 0);
+
+    VkDescriptorBufferInfo info{mHitStatsCounters.GetHandle(), 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet          = mSceneDescSet;
+    write.dstBinding      = 24;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo     = &info;
+    vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+}
+
+void PathTracer::BeginFrame(uint32_t frameIndex) {
+    mFrameSlot = frameIndex;
+    if (frameIndex < mHitStatsPending.size() && mHitStatsPending[frameIndex]) {
+        mHitStatsPending[frameIndex] = 0;
+
+        const VulkanBuffer& rb = mHitStatsReadback[frameIndex];
+        rb.Invalidate(mAllocator);
+        HitStatsCounters c;
+        std::memcpy(&c, rb.GetMappedData(), sizeof(c));
+        mHitStats.frames++;
+        for (uint32_t i = 0; i < kRTMaterialClassCount; i++) {
+            mHitStats.anyHit[i]     += c.anyHit[i];
+            mHitStats.closestHit[i] += c.closestHit[i];
+        }
+    }
+
+    if (frameIndex >= mAdaptivePending.size() || !mAdaptivePending[frameIndex]) return;
+    mAdaptivePending[frameIndex] = 0;
+
+    const VulkanBuffer& rb = mAdaptiveReadback[frameIndex];
+    rb.Invalidate(mAllocator);
+    const float* t = static_cast<const float*>(rb.GetMappedData());
+
+    mAdaptiveStats.tiles           = mTilesX * mTilesY;
+    mAdaptiveStats.pixels          = uint64_t(mWidth) * mHeight;
+    mAdaptiveStats.sumVariance     = t[0];
+    mAdaptiveStats.sumMeanVariance = t[1];
+    mAdaptiveStats.samples         = t[2];
+    mAdaptiveStats.convergedTiles  = static_cast<uint32_t>(t[3] + 0.5f);
 }
 
 void PathTracer::CreateImages(uint32_t w, uint32_t h) {
@@ -98,6 +249,8 @@ void PathTracer::CreateImages(uint32_t w, uint32_t h) {
     mDepthOutput.CreateStorageImage(mAllocator, mDevice, w, h, VK_FORMAT_R32_SFLOAT);
     mMotionOutput.CreateStorageImage(mAllocator, mDevice, w, h, VK_FORMAT_R32G32_SFLOAT);
     mAccumBuffer.CreateStorageImage(mAllocator, mDevice, w, h, VK_FORMAT_R32G32B32A32_SFLOAT);
+    mMomentsBuffer.CreateStorageImage(mAllocator, mDevice, w, h, VK_FORMAT_R32G32B32A32_SFLOAT);
+    mSurfaceOutput.CreateStorageImage(mAllocator, mDevice, w, h, VK_FORMAT_R32G32B32A32_SFLOAT);
 }
 
 void PathTracer::CreateDescriptors() {
@@ -106,7 +259,11 @@ void PathTracer::CreateDescriptors() {
     // Bindings 6-9: vertex, index, material, instance SSBOs
     // Binding 10: env map, 11: BRDF LUT, 12: irradiance
     // Binding 13: motion output
-    // Binding 14: frame UBO (viewProj + prevViewProj)
+    // Binding 14: frame UBO (viewProj + prevViewProj + adaptive flags + sampler mode + ReSTIR/light params)
+    // Bindings 15-18: adaptive sampling moments, tile budgets, tile stats, totals
+    // Bindings 19-20: Sobol direction numbers, blue-noise texture (RTSampler)
+    // Bindings 21-22: light list, alias table (LightBuffer); 23: primary surface for ReSTIR
+    // Binding 24: hit-shader invocation counters per material class
     VkDescriptorSetLayoutBinding bindings[] = {
         {0,  VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
         {1,  VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
@@ -123,8 +280,22 @@ void PathTracer::CreateDescriptors() {
         {12, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, nullptr},
         {13, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
         {14, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {15, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {16, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {17, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, 0, nullptr},
+        {18, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, 0, nullptr},
+        {19, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {20, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {21, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {22, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {23, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_RAYGEN_BIT_KHR, nullptr},
+        {24, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR, nullptr},
     };
 
+    // The wavefront integrator, ReSTIR and the adaptive sampling passes use the same bindings from compute
+    for (VkDescriptorSetLayoutBinding& b : bindings)
+        b.stageFlags |= VK_SHADER_STAGE_COMPUTE_BIT;
+
     VkDescriptorSetLayoutCreateInfo layoutCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
     layoutCI.bindingCount = static_cast<uint32_t>(std::size(bindings));
     layoutCI.pBindings    = bindings;
@@ -132,9 +303,9 @@ void PathTracer::CreateDescriptors() {
 
     VkDescriptorPoolSize poolSizes[] = {
         {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1},
-        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 7},
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
+        {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 9},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 11},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
         {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1},
     };
     VkDescriptorPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
@@ -164,19 +335,42 @@ void PathTracer::CreatePipeline(ShaderManager& shaders) {
     auto chitMod    = shaders.GetOrLoad("shaders/pt_closesthit.rchit.spv");
     auto ahitMod    = shaders.GetOrLoad("shaders/pt_anyhit.rahit.spv");
 
+    // Hit shaders are specialized on the vertex format (constant 0) and the material
+    // class (constant 1, HIT_CLASS); the infos must outlive Build below
+    struct HitSpecData {
+        VkBool32 packedVertices;
+        uint32_t hitClass;
+    };
+    const VkSpecializationMapEntry hitSpecEntries[] = {
+        {0, offsetof(HitSpecData, packedVertices), sizeof(VkBool32)},
+        {1, offsetof(HitSpecData, hitClass),       sizeof(uint32_t)},
+    };
+    std::array<HitSpecData, kRTMaterialClassCount>          hitSpecData{};
+    std::array<VkSpecializationInfo, kRTMaterialClassCount> hitSpec{};
+    for (uint32_t c = 0; c < kRTMaterialClassCount; c++) {
+        hitSpecData[c] = {mVertexFormat == VertexFormat::Packed ? VK_TRUE : VK_FALSE, c};
+        hitSpec[c].mapEntryCount = static_cast<uint32_t>(std::size(hitSpecEntries));
+        hitSpec[c].pMapEntries   = hitSpecEntries;
+        hitSpec[c].dataSize      = sizeof(HitSpecData);
+        hitSpec[c].pData         = &hitSpecData[c];
+    }
+
     uint32_t raygenIdx    = mPipeline.AddStage(VK_SHADER_STAGE_RAYGEN_BIT_KHR, raygenMod);
     uint32_t missIdx      = mPipeline.AddStage(VK_SHADER_STAGE_MISS_BIT_KHR, missMod);
     uint32_t shadowMissIdx = mPipeline.AddStage(VK_SHADER_STAGE_MISS_BIT_KHR, shadowMiss);
-    uint32_t chitIdx      = mPipeline.AddStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, chitMod);
-    uint32_t ahitIdx      = mPipeline.AddStage(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, ahitMod);
 
     mPipeline.AddRayGenGroup(raygenIdx);
     mPipeline.AddMissGroup(missIdx);
     mPipeline.AddMissGroup(shadowMissIdx);
 
-    // Single hit group pair for all materials (SBT simplification)
-    mPipeline.AddHitGroup(chitIdx, ahitIdx);                    // primary
-    mPipeline.AddHitGroup(VK_SHADER_UNUSED_KHR, ahitIdx);      // shadow
+    // kRayTypes hit groups per RTMaterialClass, in class order: instances select theirs
+    // with an SBT record offset of class * kRayTypes
+    for (uint32_t c = 0; c < kRTMaterialClassCount; c++) {
+        uint32_t chitIdx = mPipeline.AddStage(VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR, chitMod, "main", &hitSpec[c]);
+        uint32_t ahitIdx = mPipeline.AddStage(VK_SHADER_STAGE_ANY_HIT_BIT_KHR, ahitMod, "main", &hitSpec[c]);
+        mPipeline.AddHitGroup(chitIdx, ahitIdx);                    // primary
+        mPipeline.AddHitGroup(VK_SHADER_UNUSED_KHR, ahitIdx);      // shadow
+    }
 
     if (mPipelineLayout != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
@@ -187,7 +381,7 @@ void PathTracer::CreatePipeline(ShaderManager& shaders) {
         VkPushConstantRange pcRange{
             VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR |
             VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR,
-            0, sizeof(PushConstants)
+            0, sizeof(PTPushConstants)
         };
         VkPipelineLayoutCreateInfo plCI{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
         plCI.setLayoutCount         = mBindlessDescLayout ? 2u : 1u;
@@ -199,16 +393,17 @@ void PathTracer::CreatePipeline(ShaderManager& shaders) {
 
     mPipeline.Build(mDevice, mPipelineLayout, 1);
 
-    // Single hit group pair — no per-material SBT data needed
+    // No per-record data: materials come from the instance buffer
     mSBT.Build(mDevice, mAllocator, mPipeline, mRTProps,
-               1, 2, 2, 0, 0);
+               1, 2, kRayTypes * kRTMaterialClassCount, 0, 0);
     mSBT.UploadToGPU(mAllocator, mDevice, *mTransfer);
 
-    LOG_INFO("PathTracer pipeline created: single hit group pair (SBT simplified)");
+    LOG_INFO("PathTracer pipeline created: {} hit groups ({} material classes x {} ray types)",
+             kRayTypes * kRTMaterialClassCount, kRTMaterialClassCount, kRayTypes);
 }
 
 void PathTracer::UpdateScene(VkDevice device, VmaAllocator allocator,
-                              const TransferManager& transfer,
+                              TransferManager& transfer,
                               VkAccelerationStructureKHR tlas,
                               const MeshPool& meshPool,
                               const std::vector<RTInstanceInfo>& instanceInfos,
@@ -229,10 +424,20 @@ void PathTracer::UpdateScene(VkDevice device, VmaAllocator allocator,
             instanceInfos.data(), instanceInfos.size() * sizeof(RTInstanceInfo));
     }
 
-    // Build pipeline once (no per-material rebuild needed)
-    if (mShaders && mPipeline.GetPipeline() == VK_NULL_HANDLE) {
+    // Build pipeline once (no per-material rebuild needed); hit shaders are
+    // specialized on the vertex format
+    if (mShaders && (mPipeline.GetPipeline() == VK_NULL_HANDLE ||
+                     mVertexFormat != meshPool.GetVertexFormat())) {
+        mVertexFormat = meshPool.GetVertexFormat();
         CreatePipeline(*mShaders);
     }
+    if (mShaders) {
+        mWavefront.UpdateScene(*mShaders, mSceneDescLayout, bindlessTexLayout,
+                               mVertexFormat, materialSSBOSize);
+        mReSTIR.UpdateScene(*mShaders, mSceneDescLayout, bindlessTexLayout, mVertexFormat);
+    }
+    // Reservoirs hold light indices into the list being replaced
+    mReSTIR.InvalidateHistory();
 
     // Update descriptor set
     VkWriteDescriptorSetAccelerationStructureKHR asWrite{
@@ -246,6 +451,7 @@ void PathTracer::UpdateScene(VkDevice device, VmaAllocator allocator,
     VkDescriptorImageInfo albedoInfo{VK_NULL_HANDLE, mAlbedoOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
     VkDescriptorImageInfo depthInfo{VK_NULL_HANDLE, mDepthOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
     VkDescriptorImageInfo motionInfo{VK_NULL_HANDLE, mMotionOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo surfaceInfo{VK_NULL_HANDLE, mSurfaceOutput.GetView(), VK_IMAGE_LAYOUT_GENERAL};
 
     VkDescriptorBufferInfo vertBufInfo{meshPool.GetVertexBuffer(), 0, VK_WHOLE_SIZE};
     VkDescriptorBufferInfo idxBufInfo{meshPool.GetIndexBuffer(), 0, VK_WHOLE_SIZE};
@@ -258,7 +464,22 @@ void PathTracer::UpdateScene(VkDevice device, VmaAllocator allocator,
 
     VkDescriptorBufferInfo uboInfo{mFrameUBO.GetHandle(), 0, sizeof(FrameUBOData)};
 
-    VkWriteDescriptorSet writes[16] = {};
+    VkDescriptorBufferInfo sobolInfo{};
+    VkDescriptorImageInfo  blueNoiseInfo{};
+    if (mSampler) {
+        sobolInfo     = {mSampler->GetSobolBuffer(), 0, mSampler->GetSobolBufferSize()};
+        blueNoiseInfo = {mSampler->GetBlueNoiseSampler(), mSampler->GetBlueNoiseView(),
+                         VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+    }
+
+    VkDescriptorBufferInfo lightInfo{};
+    VkDescriptorBufferInfo aliasInfo{};
+    if (mLights) {
+        lightInfo = {mLights->GetLightBuffer(), 0, mLights->GetLightBufferSize()};
+        aliasInfo = {mLights->GetAliasBuffer(), 0, mLights->GetAliasBufferSize()};
+    }
+
+    VkWriteDescriptorSet writes[20] = {};
 
     writes[0] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
     writes[0].pNext = &asWrite;
@@ -278,6 +499,7 @@ void PathTracer::UpdateScene(VkDevice device, VmaAllocator allocator,
     makeImageWrite(4, 4, &albedoInfo);
     makeImageWrite(5, 5, &depthInfo);
     makeImageWrite(6, 13, &motionInfo);
+    makeImageWrite(15, 23, &surfaceInfo);
 
     auto makeBufferWrite = [&](int idx, uint32_t binding, VkDescriptorBufferInfo* info) {
         writes[idx] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
@@ -308,7 +530,17 @@ void PathTracer::UpdateScene(VkDevice device, VmaAllocator allocator,
     writes[14].descriptorCount = 1; writes[14].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
     writes[14].pBufferInfo = &uboInfo;
 
-    vkUpdateDescriptorSets(device, 15, writes, 0, nullptr);
+    uint32_t writeCount = 16;
+    if (mSampler) {
+        makeBufferWrite(writeCount++, 19, &sobolInfo);
+        makeSamplerWrite(writeCount++, 20, &blueNoiseInfo);
+    }
+    if (mLights && mLights->GetLightBuffer() != VK_NULL_HANDLE) {
+        makeBufferWrite(writeCount++, 21, &lightInfo);
+        makeBufferWrite(writeCount++, 22, &aliasInfo);
+    }
+
+    vkUpdateDescriptorSets(device, writeCount, writes, 0, nullptr);
 
     mSceneDirty = false;
     mAccumFrames = 0;
@@ -322,9 +554,41 @@ void PathTracer::Trace(VkCommandBuffer cmd,
                         const glm::vec3& sunColor,
                         float sunIntensity,
                         float lightRadius,
-                        bool /*denoiserEnabled*/) {
+                        bool denoiserEnabled) {
     if (mPipeline.GetPipeline() == VK_NULL_HANDLE) return;
 
+    // Adaptive budgets only make sense on the converging accumulation; the denoiser
+    // wants a uniform 1 spp input every frame
+    bool adaptive = adaptiveSampling && progressive && !denoiserEnabled &&
+                    GetActiveIntegrator() == PTIntegrator::Megakernel &&
+                    mAdaptivePipeline != VK_NULL_HANDLE;
+    if (adaptive != mAdaptiveActive) {
+        mAdaptiveActive = adaptive;
+        mAdaptiveStats  = {};
+        mAccumFrames    = 0;
+    }
+
+    // ReSTIR replaces the primary hit's light sample; with only the sun plain NEE is as good
+    uint32_t lightCount = mLights ? mLights->GetLightCount() : 0u;
+    bool restir = restirDI && lightCount > 0 && !adaptive && mReSTIR.IsReady();
+    if (restir != mReSTIRActive) {
+        mReSTIRActive = restir;
+        mReSTIR.InvalidateHistory();
+        mAccumFrames  = 0;
+    }
+    float sunPdf = lightCount == 0 ? 1.0f
+                 : (sunIntensity > 0.0f ? std::clamp(sunSelectProbability, 0.0f, 1.0f) : 0.0f);
+
+    // Sobol points only stratify a converging accumulation; the denoiser and the 1 spp
+    // display get spatiotemporal blue noise instead
+    uint32_t samplerMode = 0;
+    if (sampler == PTSampler::LowDiscrepancy && mSampler)
+        samplerMode = (progressive && !denoiserEnabled) ? 1u : 2u;
+    if (samplerMode != mSamplerMode) {
+        mSamplerMode = samplerMode;
+        mAccumFrames = 0;
+    }
+
     mAccumReset = false;
     // Discard temporal info on camera move/zoom: any viewProj change invalidates history
     // Use 1e-4 (not 1e-5) to avoid spurious resets from floating-point drift; NRD needs stable history for temporal denoising
@@ -344,17 +608,24 @@ void PathTracer::Trace(VkCommandBuffer cmd,
         uboData.viewProj     = viewProj;
         glm::mat4 prevVP     = (mPrevViewProj == glm::mat4(1.0f)) ? viewProj : mPrevViewProj;
         uboData.prevViewProj = prevVP;
+        uboData.adaptive     = glm::uvec4(adaptive ? 1u : 0u, mTilesX, 0u, 0u);
+        uboData.sampling     = glm::uvec4(samplerMode, 0u, 0u, 0u);
+        uboData.restir       = glm::uvec4(restir ? 1u : 0u,
+                                          static_cast<uint32_t>(std::max(restirCandidates, 1)),
+                                          static_cast<uint32_t>(std::max(restirSpatialSamples, 0)),
+                                          mReSTIR.GetSliceFlags());
+        uboData.lights       = glm::vec4(float(lightCount), sunPdf, punctualLightScale, restirRadius);
         std::memcpy(mFrameUBO.GetMappedData(), &uboData, sizeof(uboData));
     }
 
     // Transition images to GENERAL (use correct oldLayout: UNDEFINED on first frame, GENERAL thereafter)
     VkImageLayout oldLayout = (mAccumFrames > 0) ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
-    VkImageMemoryBarrier2 barriers[6]{};
+    VkImageMemoryBarrier2 barriers[8]{};
     auto makeBarrier = [oldLayout](VkImage image) {
         VkImageMemoryBarrier2 b{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
         b.srcStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
         b.srcAccessMask = (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED) ? 0u : (VK_ACCESS_2_MEMORY_WRITE_BIT | VK_ACCESS_2_MEMORY_READ_BIT);
-        b.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+        b.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
         b.dstAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_READ_BIT;
         b.oldLayout     = oldLayout;
         b.newLayout     = VK_IMAGE_LAYOUT_GENERAL;
@@ -368,9 +639,11 @@ void PathTracer::Trace(VkCommandBuffer cmd,
     barriers[3] = makeBarrier(mAlbedoOutput.GetImage());
     barriers[4] = makeBarrier(mDepthOutput.GetImage());
     barriers[5] = makeBarrier(mMotionOutput.GetImage());
+    barriers[6] = makeBarrier(mMomentsBuffer.GetImage());
+    barriers[7] = makeBarrier(mSurfaceOutput.GetImage());
 
     VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-    dep.imageMemoryBarrierCount = 6;
+    dep.imageMemoryBarrierCount = 8;
     dep.pImageMemoryBarriers    = barriers;
     vkCmdPipelineBarrier2(cmd, &dep);
 
@@ -383,7 +656,7 @@ void PathTracer::Trace(VkCommandBuffer cmd,
         VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
         mb.srcStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT;
         mb.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
-        mb.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
         mb.dstAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_READ_BIT;
         VkDependencyInfo clearDep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
         clearDep.memoryBarrierCount = 1;
@@ -391,13 +664,56 @@ void PathTracer::Trace(VkCommandBuffer cmd,
         vkCmdPipelineBarrier2(cmd, &clearDep);
     }
 
-    PushConstants pc{};
+    // Adaptive restart: no moments yet, every tile gets 1 spp until the estimate is trusted
+    if (adaptive && mAccumFrames == 0) {
+        VkClearColorValue clearVal = {{0.0f, 0.0f, 0.0f, 0.0f}};
+        VkImageSubresourceRange range = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        vkCmdClearColorImage(cmd, mMomentsBuffer.GetImage(), VK_IMAGE_LAYOUT_GENERAL,
+                             &clearVal, 1, &range);
+        vkCmdFillBuffer(cmd, mTileSppBuffer.GetHandle(), 0, VK_WHOLE_SIZE, 1u);
+
+        VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        mb.srcStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+        mb.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.dstAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_READ_BIT;
+        VkDependencyInfo clearDep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        clearDep.memoryBarrierCount = 1;
+        clearDep.pMemoryBarriers    = &mb;
+        vkCmdPipelineBarrier2(cmd, &clearDep);
+
+        // Reports recorded before the restart describe the old accumulation
+        std::fill(mAdaptivePending.begin(), mAdaptivePending.end(), uint8_t(0));
+        mAdaptiveStats = {};
+    }
+
+    // Point of the low-discrepancy sequence: restarts with the accumulation for Sobol,
+    // advances every frame for blue noise (kept below 2^24 so the float stays exact)
+    uint32_t sequenceIndex = (samplerMode == 1u ? mAccumFrames : mSampleOffset) & 0xFFFFFFu;
+
+    PTPushConstants pc{};
     pc.invViewProj       = invViewProj;
-    pc.cameraPosAndFrame = glm::vec4(cameraPos, float(mSampleOffset));
+    pc.cameraPosAndFrame = glm::vec4(cameraPos, float(sequenceIndex));
     pc.sunDirAndRadius   = glm::vec4(sunDir, lightRadius);
     pc.sunColorIntensity = glm::vec4(sunColor, sunIntensity);
     pc.params            = glm::uvec4(maxBounces, mSampleOffset, enableMIS ? 1 : 0, mAccumFrames);
 
+    if (GetActiveIntegrator() == PTIntegrator::Wavefront) {
+        mWavefront.Dispatch(cmd, mSceneDescSet, mBindlessDescSet, pc);
+    } else {
+        BeginHitStats(cmd, hitClassStats);
+        TraceMegakernel(cmd, pc);
+        if (hitClassStats) EndHitStats(cmd);
+        if (adaptive) DispatchAdaptive(cmd);
+    }
+    if (restir) mReSTIR.Dispatch(cmd, mSceneDescSet, mBindlessDescSet, pc);
+
+    if (progressive) mAccumFrames++;
+    mSampleOffset++;
+    mPrevViewProj = viewProj;
+}
+
+void PathTracer::TraceMegakernel(VkCommandBuffer cmd, const PTPushConstants& pc) {
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR, mPipeline.GetPipeline());
     vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_RAY_TRACING_KHR,
                             mPipelineLayout, 0, 1, &mSceneDescSet, 0, nullptr);
@@ -407,7 +723,7 @@ void PathTracer::Trace(VkCommandBuffer cmd,
     }
     vkCmdPushConstants(cmd, mPipelineLayout,
         VK_SHADER_STAGE_RAYGEN_BIT_KHR | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR | VK_SHADER_STAGE_MISS_BIT_KHR | VK_SHADER_STAGE_ANY_HIT_BIT_KHR,
-        0, sizeof(PushConstants), &pc);
+        0, sizeof(PTPushConstants), &pc);
 
     auto rayGenRegion  = mSBT.GetRayGenRegion();
     auto missRegion    = mSBT.GetMissRegion();
@@ -416,8 +732,112 @@ void PathTracer::Trace(VkCommandBuffer cmd,
 
     vkCmdTraceRaysKHR(cmd, &rayGenRegion, &missRegion, &hitRegion, &callRegion,
                       mWidth, mHeight, 1);
+}
 
-    if (progressive) mAccumFrames++;
-    mSampleOffset++;
-    mPrevViewProj = viewProj;
+void PathTracer::DispatchAdaptive(VkCommandBuffer cmd) {
+    // Raygen wrote the moments and read the tile budgets this pass overwrites
+    {
+        VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        mb.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+        mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.memoryBarrierCount = 1;
+        dep.pMemoryBarriers    = &mb;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    AdaptivePushConstants pc{};
+    pc.threshold  = adaptiveThreshold;
+    pc.minSamples = static_cast<uint32_t>(std::max(adaptiveMinSamples, 1));
+    pc.maxSpp     = static_cast<uint32_t>(std::max(adaptiveMaxSpp, 1));
+    pc.tilesX     = mTilesX;
+
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mAdaptivePipeLayout,
+                            0, 1, &mSceneDescSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mAdaptivePipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mAdaptivePipeline);
+    vkCmdDispatch(cmd, mTilesX, mTilesY, 1);
+
+    {
+        VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        mb.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.memoryBarrierCount = 1;
+        dep.pMemoryBarriers    = &mb;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mAdaptiveReducePipeline);
+    vkCmdDispatch(cmd, 1, 1, 1);
+
+    // Totals -> readback; tile budgets -> next frame's raygen
+    {
+        VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        mb.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT | VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+        mb.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_SHADER_READ_BIT;
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.memoryBarrierCount = 1;
+        dep.pMemoryBarriers    = &mb;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    if (mFrameSlot < mAdaptiveReadback.size()) {
+        VkBufferCopy region{0, 0, sizeof(glm::vec4)};
+        vkCmdCopyBuffer(cmd, mAdaptiveTotals.GetHandle(),
+                        mAdaptiveReadback[mFrameSlot].GetHandle(), 1, &region);
+        mAdaptivePending[mFrameSlot] = 1;
+    }
+}
+
+void PathTracer::BeginHitStats(VkCommandBuffer cmd, bool enabled) {
+    // Counting frames restart from zero; the frame after the last one only clears the flag
+    if (!enabled && !mHitStatsEnabledOnGPU) return;
+    mHitStatsEnabledOnGPU = enabled;
+
+    // Last frame's hit shaders and readback copy are done with the counters
+    VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    mb.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COPY_BIT;
+    mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_READ_BIT;
+    mb.dstStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+    mb.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &mb;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    HitStatsCounters counters{};
+    counters.enabled = enabled ? 1u : 0u;
+    vkCmdUpdateBuffer(cmd, mHitStatsCounters.GetHandle(), 0, sizeof(counters), &counters);
+
+    mb.srcStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+    mb.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    mb.dstStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+    mb.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+void PathTracer::EndHitStats(VkCommandBuffer cmd) {
+    if (mFrameSlot >= mHitStatsReadback.size()) return;
+
+    VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    mb.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+    mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    mb.dstStageMask  = VK_PIPELINE_STAGE_2_COPY_BIT;
+    mb.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &mb;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    VkBufferCopy region{0, 0, sizeof(HitStatsCounters)};
+    vkCmdCopyBuffer(cmd, mHitStatsCounters.GetHandle(),
+                    mHitStatsReadback[mFrameSlot].GetHandle(), 1, &region);
+    mHitStatsPending[mFrameSlot] = 1;
 }
@@ -3,6 +3,11 @@
 #include "RayTracing/RTPipeline.h"
 #include "RayTracing/ShaderBindingTable.h"
 #include "RayTracing/AccelStructure.h"
+#include "RayTracing/WavefrontIntegrator.h"
+#include "RayTracing/RTSampler.h"
+#include "RayTracing/ReSTIRDI.h"
+#include "RayTracing/LightBuffer.h"
+#include "RayTracing/RTMaterialClass.h"
 #include "Resource/VulkanBuffer.h"
 #include "Resource/VulkanImage.h"
 #include "Resource/ShaderManager.h"
@@ -11,24 +16,71 @@
 #include <volk.h>
 #include <vk_mem_alloc.h>
 #include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <cstdint>
+#include <vector>
 
 class TransferManager;
 class DescriptorManager;
 
+/// Convergence report of adaptive sampling since the last accumulation reset.
+/// Variances are of pixel luminance; the uniform baseline is the sample count a
+/// fixed spp would need to reach the same image RMSE.
+struct PTAdaptiveStats {
+    uint32_t tiles          = 0;
+    uint32_t convergedTiles = 0;
+    uint64_t pixels         = 0;
+    double   samples        = 0.0;   // paths accumulated over all pixels
+    double   sumVariance    = 0.0;   // per-sample variance, summed over pixels
+    double   sumMeanVariance = 0.0;  // variance of the accumulated mean, summed over pixels
+
+    double Rmse() const { return pixels ? std::sqrt(sumMeanVariance / double(pixels)) : 0.0; }
+    double UniformSamples() const {
+        return sumMeanVariance > 0.0 ? double(pixels) * sumVariance / sumMeanVariance : samples;
+    }
+    double ConvergedFraction() const { return tiles ? double(convergedTiles) / tiles : 0.0; }
+    bool   Converged() const { return tiles > 0 && convergedTiles == tiles; }
+};
+
+/// Megakernel hit-shader invocations per RTMaterialClass since the last reset, counted
+/// in the shaders (pipeline statistics queries have no any-hit counter).
+struct PTHitClassStats {
+    uint64_t frames = 0;
+    std::array<uint64_t, kRTMaterialClassCount> anyHit{};
+    std::array<uint64_t, kRTMaterialClassCount> closestHit{};
+
+    double AnyHitPerFrame(uint32_t c) const     { return frames ? double(anyHit[c]) / double(frames) : 0.0; }
+    double ClosestHitPerFrame(uint32_t c) const { return frames ? double(closestHit[c]) / double(frames) : 0.0; }
+};
+
 class PathTracer {
 public:
+    /// Hit groups per material class: primary (closest + any hit) and shadow (any hit).
+    /// TLAS instances are built with this as BuildTLAS's numRayTypes.
+    static constexpr uint32_t kRayTypes = 2;
+
     void Initialize(VkDevice device, VmaAllocator allocator,
                     ShaderManager& shaders,
-                    const TransferManager& transfer,
+                    TransferManager& transfer,
                     const VkPhysicalDeviceRayTracingPipelinePropertiesKHR& rtProps,
-                    uint32_t width, uint32_t height);
+                    uint32_t width, uint32_t height, uint32_t framesInFlight);
+
+    /// Sobol table and blue-noise texture bound at set 0, bindings 19-20. Set before UpdateScene.
+    void SetSampler(const RTSampler* sampler) { mSampler = sampler; }
+
+    /// Point, spot and emissive-triangle lights bound at set 0, bindings 21-22. Set before UpdateScene.
+    void SetLightBuffer(const LightBuffer* lights) { mLights = lights; }
+
+    /// Collects the adaptive-sampling and hit-class statistics this frame slot recorded last time.
+    void BeginFrame(uint32_t frameIndex);
 
     void Shutdown(VkDevice device, VmaAllocator allocator);
     void Resize(VkDevice device, VmaAllocator allocator, uint32_t w, uint32_t h);
 
     void UpdateScene(VkDevice device, VmaAllocator allocator,
-                     const TransferManager& transfer,
+                     TransferManager& transfer,
                      VkAccelerationStructureKHR tlas,
                      const MeshPool& meshPool,
                      const std::vector<RTInstanceInfo>& instanceInfos,
@@ -47,11 +99,17 @@ public:
                const glm::vec3& sunColor,
                float sunIntensity,
                float lightRadius,
-               bool denoiserEnabled = false);  // unused, kept for API compatibility
+               bool denoiserEnabled = false);  // adaptive sampling only runs without the denoiser
 
     void ResetAccumulation() { mAccumFrames = 0; mAccumReset = true; }
     bool WasAccumulationReset() const { return mAccumReset; }
 
+    const PTAdaptiveStats& GetAdaptiveStats() const { return mAdaptiveStats; }
+    bool IsConverged() const { return mAdaptiveActive && mAdaptiveStats.Converged(); }
+
+    const PTHitClassStats& GetHitClassStats() const { return mHitStats; }
+    void ResetHitClassStats() { mHitStats = {}; std::fill(mHitStatsPending.begin(), mHitStatsPending.end(), uint8_t(0)); }
+
     VkImageView GetColorOutputView()  const { return mColorOutput.GetView(); }
     VkImageView GetAccumOutputView()  const { return mAccumBuffer.GetView(); }
     VkImageView GetAlbedoOutputView() const { return mAlbedoOutput.GetView(); }
@@ -67,22 +125,61 @@ public:
     int      maxBounces   = 8;
     bool     enableMIS    = true;
     bool     progressive  = true;
+    PTIntegrator integrator = PTIntegrator::Megakernel;
+    PTSampler    sampler    = PTSampler::LowDiscrepancy;
+
+    // Adaptive sampling: progressive megakernel without the denoiser only
+    bool     adaptiveSampling   = false;
+    float    adaptiveThreshold  = 0.02f;  // relative standard error at which a tile stops
+    int      adaptiveMinSamples = 16;
+    int      adaptiveMaxSpp     = 4;
+
+    // ReSTIR DI at the primary hit; needs buffer lights and is off while adaptive sampling runs
+    bool     restirDI              = true;
+    int      restirCandidates      = 8;      // initial RIS candidates per pixel
+    int      restirSpatialSamples  = 4;      // neighbors merged by the spatial pass
+    float    restirRadius          = 16.0f;  // spatial neighbor radius in pixels
+    float    sunSelectProbability  = 0.5f;   // chance a light sample picks the sun over the buffer
+    float    punctualLightScale    = 1.0f;   // multiplies glTF point/spot intensities
+
+    // Per-class any-hit / closest-hit counters; atomics in every hit shader, so off by default
+    bool     hitClassStats         = false;
+
+    bool IsReSTIRActive() const { return mReSTIRActive; }
+
+    /// Integrator that Trace actually runs (wavefront falls back to the megakernel until ready).
+    PTIntegrator GetActiveIntegrator() const {
+        return (integrator == PTIntegrator::Wavefront && mWavefront.IsReady())
+            ? PTIntegrator::Wavefront : PTIntegrator::Megakernel;
+    }
 
 private:
     void CreateImages(uint32_t w, uint32_t h);
     void CreatePipeline(ShaderManager& shaders);
     void CreateDescriptors();
     void UpdateImageDescriptors();
+    void TraceMegakernel(VkCommandBuffer cmd, const PTPushConstants& pc);
+    void CreateAdaptivePipelines(ShaderManager& shaders);
+    void CreateTileBuffers();
+    void UpdateAdaptiveDescriptors();
+    void DispatchAdaptive(VkCommandBuffer cmd);
+    void CreateHitStatsBuffers(uint32_t framesInFlight);
+    void BeginHitStats(VkCommandBuffer cmd, bool enabled);
+    void EndHitStats(VkCommandBuffer cmd);
 
     VkDevice     mDevice    = VK_NULL_HANDLE;
     VmaAllocator mAllocator = VK_NULL_HANDLE;
-    const TransferManager* mTransfer = nullptr;
+    TransferManager* mTransfer = nullptr;
     ShaderManager* mShaders = nullptr;
+    const RTSampler* mSampler = nullptr;
+    const LightBuffer* mLights = nullptr;
 
     VkPhysicalDeviceRayTracingPipelinePropertiesKHR mRTProps{};
 
     RTPipeline         mPipeline;
     ShaderBindingTable mSBT;
+    WavefrontIntegrator mWavefront;
+    ReSTIRDI            mReSTIR;
 
     VulkanImage mColorOutput;
     VulkanImage mAlbedoOutput;
@@ -90,6 +187,30 @@ private:
     VulkanImage mDepthOutput;
     VulkanImage mMotionOutput;
     VulkanImage mAccumBuffer;
+    VulkanImage mMomentsBuffer;     // adaptive: mean luminance, mean luminance^2, sample count
+    VulkanImage mSurfaceOutput;     // ReSTIR: primary hit position, metallic (-1 on a miss)
+
+    // Adaptive sampling
+    VulkanBuffer mTileSppBuffer;    // per-tile sample budget read by the raygen shader
+    VulkanBuffer mTileStatsBuffer;
+    VulkanBuffer mAdaptiveTotals;
+    std::vector<VulkanBuffer> mAdaptiveReadback;   // per frame in flight
+    std::vector<uint8_t>      mAdaptivePending;
+    static constexpr uint32_t kAdaptiveTile = 8;   // ADAPTIVE_TILE in pt_common.glsl
+    uint32_t         mFrameSlot = 0;
+    uint32_t         mTilesX = 0, mTilesY = 0;
+    bool             mAdaptiveActive = false;
+    PTAdaptiveStats  mAdaptiveStats;
+    VkPipelineLayout mAdaptivePipeLayout     = VK_NULL_HANDLE;
+    VkPipeline       mAdaptivePipeline       = VK_NULL_HANDLE;
+    VkPipeline       mAdaptiveReducePipeline = VK_NULL_HANDLE;
+
+    // Hit-class statistics (binding 24): reset and enabled per traced frame, read back per frame in flight
+    VulkanBuffer mHitStatsCounters;
+    std::vector<VulkanBuffer> mHitStatsReadback;
+    std::vector<uint8_t>      mHitStatsPending;
+    bool             mHitStatsEnabledOnGPU = false;
+    PTHitClassStats  mHitStats;
 
     VulkanBuffer mInstanceInfoBuffer;
     VulkanBuffer mFrameUBO;
@@ -105,21 +226,32 @@ private:
     uint32_t mAccumFrames   = 0;
     bool     mAccumReset    = false;
     uint32_t mSampleOffset  = 0;
+    uint32_t mSamplerMode   = 0;    // SAMPLER_* in sampling.glsl, chosen per frame
     bool     mSceneDirty    = true;
+    VertexFormat mVertexFormat = VertexFormat::Float;
+    bool     mReSTIRActive  = false;
 
     glm::mat4 mPrevViewProj{1.0f};
 
-    struct PushConstants {
-        glm::mat4  invViewProj;
-        glm::vec4  cameraPosAndFrame;
-        glm::vec4  sunDirAndRadius;
-        glm::vec4  sunColorIntensity;
-        glm::uvec4 params;
+    struct FrameUBOData {
+        glm::mat4  viewProj;
+        glm::mat4  prevViewProj;
+        glm::uvec4 adaptive;    // x = enabled, y = tiles per row
+        glm::uvec4 sampling;    // x = SAMPLER_* mode
+        glm::uvec4 restir;      // x = enabled, y = candidates, z = spatial neighbors, w = ReSTIRDI::GetSliceFlags
+        glm::vec4  lights;      // x = buffer light count, y = sun probability, z = punctual scale, w = spatial radius
     };
-    static_assert(sizeof(PushConstants) == 128, "PathTracer push constants must be 128 bytes");
 
-    struct FrameUBOData {
-        glm::mat4 viewProj;
-        glm::mat4 prevViewProj;
+    struct HitStatsCounters {    // HitClassCounters in pt_closesthit.rchit / pt_anyhit.rahit
+        uint32_t anyHit[kRTMaterialClassCount];
+        uint32_t closestHit[kRTMaterialClassCount];
+        uint32_t enabled;
+    };
+
+    struct AdaptivePushConstants {
+        float    threshold;
+        uint32_t minSamples;
+        uint32_t maxSpp;
+        uint32_t tilesX;
     };
 };
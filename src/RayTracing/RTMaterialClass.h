@@ -0,0 +1,45 @@
+#pragma once
+
+#include "Scene/Scene.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/// Hit-group class of a material (HIT_CLASS_* in pt_surface.glsl / pt_anyhit.rahit).
+/// Materials are classified once at load; each class gets its own specialized primary and
+/// shadow hit group, and TLAS instances pick theirs through the SBT record offset.
+enum class RTMaterialClass : uint32_t {
+    Opaque      = 0,  // no coverage test, no emission: instances are FORCE_OPAQUE
+    AlphaTested = 1,  // mask or blend: the any-hit shader decides coverage
+    Emissive    = 2,  // opaque, closest hit fetches the emissive texture
+};
+
+inline constexpr uint32_t kRTMaterialClassCount = 3;
+
+inline const char* RTMaterialClassName(RTMaterialClass c) {
+    switch (c) {
+    case RTMaterialClass::AlphaTested: return "Alpha-tested";
+    case RTMaterialClass::Emissive:    return "Emissive";
+    default:                           return "Opaque";
+    }
+}
+
+/// Coverage wins over emission: an alpha-tested emitter keeps its any-hit shader.
+/// Materials without emission reference the shared black texture.
+inline RTMaterialClass ClassifyMaterial(const GPUMaterialData& mat, uint32_t blackTexIdx) {
+    if (mat.alphaMode != 0) return RTMaterialClass::AlphaTested;
+    if (mat.emissiveTexIdx != blackTexIdx) return RTMaterialClass::Emissive;
+    return RTMaterialClass::Opaque;
+}
+
+inline std::vector<RTMaterialClass> ClassifyMaterials(const std::vector<GPUMaterialData>& materials,
+                                                      uint32_t blackTexIdx) {
+    std::vector<RTMaterialClass> classes;
+    classes.reserve(materials.size());
+    for (const GPUMaterialData& mat : materials)
+        classes.push_back(ClassifyMaterial(mat, blackTexIdx));
+    return classes;
+}
+
+using RTClassCounts = std::array<uint32_t, kRTMaterialClassCount>;
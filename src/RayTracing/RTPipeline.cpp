@@ -4,12 +4,14 @@
 #include <cstring>
 
 uint32_t RTPipeline::AddStage(VkShaderStageFlagBits stage, VkShaderModule module,
-                               const char* entryPoint) {
+                               const char* entryPoint,
+                               const VkSpecializationInfo* specialization) {
     VkPipelineShaderStageCreateInfo ci{};
-    ci.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    ci.stage  = stage;
-    ci.module = module;
-    ci.pName  = entryPoint;
+    ci.sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    ci.stage               = stage;
+    ci.module              = module;
+    ci.pName               = entryPoint;
+    ci.pSpecializationInfo = specialization;
     mStages.push_back(ci);
     return static_cast<uint32_t>(mStages.size() - 1);
 }
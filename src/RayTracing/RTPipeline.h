@@ -6,8 +6,10 @@
 
 class RTPipeline {
 public:
+    /// `specialization` must stay alive until Build().
     uint32_t AddStage(VkShaderStageFlagBits stage, VkShaderModule module,
-                      const char* entryPoint = "main");
+                      const char* entryPoint = "main",
+                      const VkSpecializationInfo* specialization = nullptr);
 
     uint32_t AddRayGenGroup(uint32_t generalShaderIdx);
     uint32_t AddMissGroup(uint32_t generalShaderIdx);
@@ -3,6 +3,7 @@
 #include "Resource/VulkanBuffer.h"
 #include "Resource/VulkanImage.h"
 #include "Resource/ShaderManager.h"
+#include "RayTracing/RTTraceMode.h"
 
 #include <volk.h>
 #include <vk_mem_alloc.h>
@@ -23,47 +24,78 @@ public:
     void Denoise(VkCommandBuffer cmd, VkImageView depthView, VkSampler depthSampler,
                  const glm::mat4& invViewProj);
 
+    /// Reduced trace modes: bilateral upsample + temporal accumulation, as in RTShadows.
+    void Upsample(VkCommandBuffer cmd, const glm::mat4& invViewProj);
+
     VkImageView GetOutputView() const { return mReflImage[mOutputIdx].GetView(); }
     VkImage     GetOutputImage() const { return mReflImage[mOutputIdx].GetImage(); }
 
+    /// Blue-noise texture from RTSampler (trace binding 3). Set before the first Dispatch.
+    void SetBlueNoise(VkImageView view, VkSampler sampler) {
+        mBlueNoiseView = view; mBlueNoiseSampler = sampler; mDescriptorsDirty = true;
+    }
+
     bool IsEnabled() const { return mEnabled; }
     void SetEnabled(bool e) { mEnabled = e; }
 
+    RTTraceMode GetTraceMode() const { return mMode; }
+    void SetTraceMode(RTTraceMode mode) {
+        if (mode != mMode) { mMode = mode; mHistoryValid = false; }
+    }
+
 private:
     void CreateImages(uint32_t width, uint32_t height);
     void CreateDescriptors();
     void UpdateTraceDescriptors(VkAccelerationStructureKHR tlas,
                                 VkImageView depthView, VkSampler depthSampler);
     void UpdateDenoiseDescriptors(VkImageView depthView, VkSampler depthSampler);
+    void UpdateUpsampleDescriptors(VkImageView depthView, VkSampler depthSampler);
 
     VkDevice     mDevice    = VK_NULL_HANDLE;
     VmaAllocator mAllocator = VK_NULL_HANDLE;
     uint32_t     mWidth = 0, mHeight = 0;
     bool         mEnabled = true;
     bool         mDescriptorsDirty = true;
+    uint32_t     mFrameIndex = 0;   // animates the blue noise
+    uint32_t     mTraceFrame = 0;   // mFrameIndex of this frame's trace, picks the traced pixels
 
-    VulkanImage  mReflImage[2];  // ping-pong for denoise
+    RTTraceMode  mMode = RTTraceMode::Full;
+    bool         mHistoryValid = false;
+    glm::mat4    mPrevViewProj{1.0f};
+
+    VkImageView  mBlueNoiseView    = VK_NULL_HANDLE;
+    VkSampler    mBlueNoiseSampler = VK_NULL_HANDLE;
+
+    VulkanImage  mReflImage[2];  // ping-pong for denoise; reduced modes: [1] output, [0] history
+    VulkanImage  mTraceImage[2]; // reduced modes: trace + denoise ping-pong, sized for Checkerboard
     VkSampler    mSampler = VK_NULL_HANDLE;
     int          mOutputIdx = 1;  // denoise with 3 iters always ends at image[1]
 
     VkDescriptorSetLayout mTraceDescLayout = VK_NULL_HANDLE;
     VkDescriptorPool      mTraceDescPool   = VK_NULL_HANDLE;
-    VkDescriptorSet       mTraceDescSet    = VK_NULL_HANDLE;
+    VkDescriptorSet       mTraceDescSets[2] = {};   // [0] Full, [1] reduced modes
     VkPipelineLayout      mTracePipeLayout = VK_NULL_HANDLE;
     VkPipeline            mTracePipeline   = VK_NULL_HANDLE;
 
     VkDescriptorSetLayout mDenoiseDescLayout = VK_NULL_HANDLE;
     VkDescriptorPool      mDenoiseDescPool   = VK_NULL_HANDLE;
-    VkDescriptorSet       mDenoiseDescSets[3] = {};
+    VkDescriptorSet       mDenoiseDescSets[2][3] = {};
     VkPipelineLayout      mDenoisePipeLayout = VK_NULL_HANDLE;
     VkPipeline            mDenoisePipeline   = VK_NULL_HANDLE;
 
+    VkDescriptorSetLayout mUpsampleDescLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      mUpsampleDescPool   = VK_NULL_HANDLE;
+    VkDescriptorSet       mUpsampleDescSet    = VK_NULL_HANDLE;
+    VkPipelineLayout      mUpsamplePipeLayout = VK_NULL_HANDLE;
+    VkPipeline            mUpsamplePipeline   = VK_NULL_HANDLE;
+
     struct TracePushConstants {
         glm::mat4  invViewProj;
         glm::vec4  cameraPos;
         glm::uvec2 resolution;
         float      roughness;
-        float      _pad;
+        uint32_t   frameIndex;
+        uint32_t   traceMode;
     };
 
     struct DenoisePushConstants {
@@ -73,5 +105,16 @@ private:
         float      depthSigma;
         float      normalSigma;
         float      colorSigma;
+        uint32_t   traceMode;
+        uint32_t   frameIndex;
+    };
+
+    struct UpsamplePushConstants {
+        glm::mat4  invViewProj;
+        glm::vec4  prevViewProjRows[3];   // x, y, w
+        uint32_t   traceMode;
+        uint32_t   frameIndex;
+        float      historyBlend;
+        float      _pad;
     };
 };
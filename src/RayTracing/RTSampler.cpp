@@ -0,0 +1,246 @@
+#include "RayTracing/RTSampler.h"
+#include "Resource/TransferManager.h"
+#include "Core/Logger.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <random>
+
+namespace {
+
+constexpr char     kCacheMagic[4]   = {'R', 'T', 'S', 'M'};
+constexpr uint32_t kCacheVersion    = 1;
+constexpr uint32_t kBlueNoiseSeed   = 0x5eed0001u;
+
+struct CacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t sobolDimensions;
+    uint32_t sobolBits;
+    uint32_t blueNoiseSize;
+    uint32_t blueNoiseSeed;
+};
+
+} // namespace
+
+void RTSampler::Initialize(VkDevice device, VmaAllocator allocator, TransferManager& transfer,
+                           const std::string& cachePath) {
+    auto t0 = std::chrono::steady_clock::now();
+
+    std::vector<uint32_t> sobol;
+    std::vector<uint8_t>  noise;
+    mFromCache = LoadCache(cachePath, sobol, noise);
+    if (!mFromCache) {
+        sobol = GenerateSobolDirections();
+
+        // One independent mask per channel so a pixel gets four uncorrelated blue-noise values
+        const uint32_t texels = kBlueNoiseSize * kBlueNoiseSize;
+        noise.resize(size_t(texels) * 4);
+        for (uint32_t c = 0; c < 4; c++) {
+            std::vector<uint8_t> mask = GenerateBlueNoise(kBlueNoiseSize, kBlueNoiseSeed + c);
+            for (uint32_t i = 0; i < texels; i++)
+                noise[size_t(i) * 4 + c] = mask[i];
+        }
+        SaveCache(cachePath, sobol, noise);
+    }
+    mGenerateMs = std::chrono::duration<double, std::milli>(
+        std::chrono::steady_clock::now() - t0).count();
+
+    mSobolBuffer.CreateDeviceLocal(allocator, transfer, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                   sobol.data(), GetSobolBufferSize());
+    mBlueNoise.CreateTexture2D(allocator, device, transfer, kBlueNoiseSize, kBlueNoiseSize,
+                               VK_FORMAT_R8G8B8A8_UNORM, noise.data());
+
+    // Fetched with texelFetch and wrapped in the shader; the sampler only has to exist
+    VkSamplerCreateInfo samplerCI{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
+    samplerCI.magFilter    = VK_FILTER_NEAREST;
+    samplerCI.minFilter    = VK_FILTER_NEAREST;
+    samplerCI.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCI.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    samplerCI.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    VK_CHECK(vkCreateSampler(device, &samplerCI, nullptr, &mSampler));
+
+    LOG_INFO("RT sampler: {} Sobol dimensions, {}x{} blue noise ({} in {:.1f} ms)",
+             kSobolDimensions, kBlueNoiseSize, kBlueNoiseSize,
+             mFromCache ? "loaded" : "generated", mGenerateMs);
+}
+
+void RTSampler::Shutdown(VkDevice device, VmaAllocator allocator) {
+    mSobolBuffer.Destroy(allocator);
+    mBlueNoise.Destroy(allocator, device);
+    if (mSampler) { vkDestroySampler(device, mSampler, nullptr); mSampler = VK_NULL_HANDLE; }
+}
+
+std::vector<uint32_t> RTSampler::GenerateSobolDirections() {
+    // Joe & Kuo primitive polynomials for the dimensions after the first:
+    // degree s, interior coefficients a, initial direction integers m
+    struct Polynomial { uint32_t s, a; uint32_t m[8]; };
+    static constexpr Polynomial kPolynomials[kSobolDimensions - 1] = {
+        {1, 0, {1}},
+    };
+
+    std::vector<uint32_t> v(size_t(kSobolDimensions) * kSobolBits);
+
+    // Dimension 0 is the van der Corput sequence
+    for (uint32_t i = 0; i < kSobolBits; i++)
+        v[i] = 1u << (31 - i);
+
+    for (uint32_t d = 1; d < kSobolDimensions; d++) {
+        const Polynomial& p = kPolynomials[d - 1];
+        uint32_t* dir = &v[size_t(d) * kSobolBits];
+        for (uint32_t i = 0; i < std::min(p.s, kSobolBits); i++)
+            dir[i] = p.m[i] << (31 - i);
+        for (uint32_t i = p.s; i < kSobolBits; i++) {
+            dir[i] = dir[i - p.s] ^ (dir[i - p.s] >> p.s);
+            for (uint32_t k = 1; k < p.s; k++)
+                if ((p.a >> (p.s - 1 - k)) & 1u)
+                    dir[i] ^= dir[i - k];
+        }
+    }
+    return v;
+}
+
+// Ulichney's void-and-cluster method on a torus. Phase 3 (filling the majority
+// pixels) is the same search as phase 2: the zero pixel with the highest energy of
+// zeros is the one with the lowest energy of ones, because the kernel sums to a constant.
+std::vector<uint8_t> RTSampler::GenerateBlueNoise(uint32_t size, uint32_t seed) {
+    assert((size & (size - 1)) == 0 && "blue-noise size must be a power of two");
+    const uint32_t n    = size * size;
+    const uint32_t mask = size - 1;
+
+    // Gaussian energy of a point at each wrapped offset (sigma = 1.5)
+    std::vector<float> kernel(n);
+    for (uint32_t y = 0; y < size; y++) {
+        for (uint32_t x = 0; x < size; x++) {
+            float dx = float(std::min(x, size - x));
+            float dy = float(std::min(y, size - y));
+            kernel[y * size + x] = std::exp(-(dx * dx + dy * dy) / (2.0f * 1.5f * 1.5f));
+        }
+    }
+
+    std::vector<uint8_t> binary(n, 0);
+    std::vector<float>   energy(n, 0.0f);
+    auto splat = [&](uint32_t p, float sign) {
+        uint32_t px = p & mask, py = p / size;
+        for (uint32_t y = 0; y < size; y++) {
+            const float* row = &kernel[((y - py) & mask) * size];
+            float* e = &energy[y * size];
+            for (uint32_t x = 0; x < size; x++)
+                e[x] += sign * row[(x - px) & mask];
+        }
+    };
+    auto tightestCluster = [&]() {
+        uint32_t best = 0;
+        float    bestE = -std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < n; i++)
+            if (binary[i] && energy[i] > bestE) { bestE = energy[i]; best = i; }
+        return best;
+    };
+    auto largestVoid = [&]() {
+        uint32_t best = 0;
+        float    bestE = std::numeric_limits<float>::max();
+        for (uint32_t i = 0; i < n; i++)
+            if (!binary[i] && energy[i] < bestE) { bestE = energy[i]; best = i; }
+        return best;
+    };
+
+    // Initial pattern: 10% random minority pixels, then swap clusters into voids until stable
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<uint32_t> pick(0, n - 1);
+    const uint32_t ones = std::max(n / 10, 1u);
+    for (uint32_t placed = 0; placed < ones;) {
+        uint32_t p = pick(rng);
+        if (binary[p]) continue;
+        binary[p] = 1;
+        splat(p, 1.0f);
+        placed++;
+    }
+    for (uint32_t iter = 0; iter < n; iter++) {
+        uint32_t cluster = tightestCluster();
+        binary[cluster] = 0;
+        splat(cluster, -1.0f);
+        uint32_t hole = largestVoid();
+        binary[hole] = 1;
+        splat(hole, 1.0f);
+        if (hole == cluster) break;
+    }
+
+    std::vector<uint32_t> rank(n);
+    const std::vector<uint8_t> prototype       = binary;
+    const std::vector<float>   prototypeEnergy = energy;
+
+    // Phase 1: strip the prototype's tightest clusters, ranking downwards
+    for (uint32_t r = ones; r-- > 0;) {
+        uint32_t cluster = tightestCluster();
+        binary[cluster] = 0;
+        splat(cluster, -1.0f);
+        rank[cluster] = r;
+    }
+
+    // Phases 2 and 3: fill the largest voids, ranking upwards
+    binary = prototype;
+    energy = prototypeEnergy;
+    for (uint32_t r = ones; r < n; r++) {
+        uint32_t hole = largestVoid();
+        binary[hole] = 1;
+        splat(hole, 1.0f);
+        rank[hole] = r;
+    }
+
+    std::vector<uint8_t> out(n);
+    for (uint32_t i = 0; i < n; i++)
+        out[i] = static_cast<uint8_t>((uint64_t(rank[i]) * 256) / n);
+    return out;
+}
+
+bool RTSampler::LoadCache(const std::string& path, std::vector<uint32_t>& sobol,
+                          std::vector<uint8_t>& noise) const {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        LOG_INFO("No existing sampler cache at {}", path);
+        return false;
+    }
+
+    CacheHeader header{};
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || std::memcmp(header.magic, kCacheMagic, 4) != 0 ||
+        header.version != kCacheVersion ||
+        header.sobolDimensions != kSobolDimensions || header.sobolBits != kSobolBits ||
+        header.blueNoiseSize != kBlueNoiseSize || header.blueNoiseSeed != kBlueNoiseSeed) {
+        LOG_INFO("Sampler cache {} is stale, regenerating", path);
+        return false;
+    }
+
+    sobol.resize(size_t(kSobolDimensions) * kSobolBits);
+    noise.resize(size_t(kBlueNoiseSize) * kBlueNoiseSize * 4);
+    file.read(reinterpret_cast<char*>(sobol.data()), static_cast<std::streamsize>(sobol.size() * sizeof(uint32_t)));
+    file.read(reinterpret_cast<char*>(noise.data()), static_cast<std::streamsize>(noise.size()));
+    if (!file) {
+        LOG_INFO("Sampler cache {} is truncated, regenerating", path);
+        return false;
+    }
+    return true;
+}
+
+void RTSampler::SaveCache(const std::string& path, const std::vector<uint32_t>& sobol,
+                          const std::vector<uint8_t>& noise) const {
+    CacheHeader header{};
+    std::memcpy(header.magic, kCacheMagic, 4);
+    header.version         = kCacheVersion;
+    header.sobolDimensions = kSobolDimensions;
+    header.sobolBits       = kSobolBits;
+    header.blueNoiseSize   = kBlueNoiseSize;
+    header.blueNoiseSeed   = kBlueNoiseSeed;
+
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) return;
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(sobol.data()), static_cast<std::streamsize>(sobol.size() * sizeof(uint32_t)));
+    file.write(reinterpret_cast<const char*>(noise.data()), static_cast<std::streamsize>(noise.size()));
+    LOG_INFO("Sampler cache saved to {}", path);
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "Resource/VulkanBuffer.h"
+#include "Resource/VulkanImage.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class TransferManager;
+
+/// Per-dimension sample source of the path tracer (SAMPLER_* in sampling.glsl).
+enum class PTSampler : int {
+    Random         = 0,  // per-pixel PCG hash (white noise)
+    LowDiscrepancy = 1,  // Owen-scrambled Sobol when accumulating, blue noise for the denoiser
+};
+
+/// Sample tables shared by every RT pass: Sobol direction numbers (storage buffer) and
+/// a tileable blue-noise texture with one independent void-and-cluster mask per channel.
+/// Both are generated on the CPU at startup, or read back from a baked cache file.
+class RTSampler {
+public:
+    static constexpr uint32_t kSobolDimensions = 2;
+    static constexpr uint32_t kSobolBits       = 32;
+    static constexpr uint32_t kBlueNoiseSize   = 64;   // BLUE_NOISE_SIZE in sampling.glsl
+
+    void Initialize(VkDevice device, VmaAllocator allocator, TransferManager& transfer,
+                    const std::string& cachePath);
+    void Shutdown(VkDevice device, VmaAllocator allocator);
+
+    VkBuffer     GetSobolBuffer() const { return mSobolBuffer.GetHandle(); }
+    VkDeviceSize GetSobolBufferSize() const { return VkDeviceSize(kSobolDimensions) * kSobolBits * sizeof(uint32_t); }
+    VkImageView  GetBlueNoiseView() const { return mBlueNoise.GetView(); }
+    VkSampler    GetBlueNoiseSampler() const { return mSampler; }
+
+    bool   IsLoadedFromCache() const { return mFromCache; }
+    double GetGenerateMs() const { return mGenerateMs; }
+
+    /// Joe-Kuo direction numbers, dimension-major: [dim * kSobolBits + bit].
+    static std::vector<uint32_t> GenerateSobolDirections();
+
+    /// Void-and-cluster dither array of size*size ranks mapped to 8-bit thresholds.
+    static std::vector<uint8_t> GenerateBlueNoise(uint32_t size, uint32_t seed);
+
+private:
+    bool LoadCache(const std::string& path, std::vector<uint32_t>& sobol, std::vector<uint8_t>& noise) const;
+    void SaveCache(const std::string& path, const std::vector<uint32_t>& sobol, const std::vector<uint8_t>& noise) const;
+
+    VulkanBuffer mSobolBuffer;
+    VulkanImage  mBlueNoise;      // RGBA8, kBlueNoiseSize^2
+    VkSampler    mSampler = VK_NULL_HANDLE;
+    bool         mFromCache  = false;
+    double       mGenerateMs = 0.0;
+};
@@ -1,6 +1,62 @@
 #include "RayTracing/RTShadows.h"
 #include "Core/Logger.h"
 
+#include <algorithm>
+
+namespace {
+
+// Reduced modes blend at least this much of each new frame into the history
+constexpr float kMinHistoryBlend = 0.1f;
+
+void CreateShadowImage(VmaAllocator allocator, VkDevice device, uint32_t w, uint32_t h,
+                       VkImageUsageFlags usage, VulkanImage& out) {
+    VkImageCreateInfo imgCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
+    imgCI.imageType     = VK_IMAGE_TYPE_2D;
+    imgCI.format        = VK_FORMAT_R16_SFLOAT;
+    imgCI.extent        = {w, h, 1};
+    imgCI.mipLevels     = 1;
+    imgCI.arrayLayers   = 1;
+    imgCI.samples       = VK_SAMPLE_COUNT_1_BIT;
+    imgCI.tiling        = VK_IMAGE_TILING_OPTIMAL;
+    imgCI.usage         = usage;
+    imgCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    VmaAllocationCreateInfo allocCI{};
+    allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+
+    VkImage image;
+    VmaAllocation alloc;
+    VK_CHECK(vmaCreateImage(allocator, &imgCI, &allocCI, &image, &alloc, nullptr));
+
+    VkImageViewCreateInfo viewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
+    viewCI.image    = image;
+    viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewCI.format   = VK_FORMAT_R16_SFLOAT;
+    viewCI.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    VkImageView view;
+    VK_CHECK(vkCreateImageView(device, &viewCI, nullptr, &view));
+
+    out.SetHandles(image, view, alloc);
+}
+
+} // namespace
+
+void RTShadows::CreateImages(uint32_t width, uint32_t height) {
+    // The output doubles as the temporal history in reduced modes: copied to [0] each frame
+    for (int i = 0; i < 2; i++)
+        CreateShadowImage(mAllocator, mDevice, width, height,
+                          VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT |
+                          VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+                          mShadowImage[i]);
+
+    // Checkerboard has the largest trace extent; Half and Quarter use its top-left corner
+    VkExtent2D traceExtent = RTTraceExtent(RTTraceMode::Checkerboard, width, height);
+    for (int i = 0; i < 2; i++)
+        CreateShadowImage(mAllocator, mDevice, traceExtent.width, traceExtent.height,
+                          VK_IMAGE_USAGE_STORAGE_BIT, mTraceImage[i]);
+    mHistoryValid = false;
+}
+
 void RTShadows::Initialize(VkDevice device, VmaAllocator allocator,
                             ShaderManager& shaders, uint32_t width, uint32_t height) {
     mDevice    = device;
@@ -9,36 +65,7 @@ void RTShadows::Initialize(VkDevice device, VmaAllocator allocator,
     mHeight    = height;
     mDescriptorsDirty = true;
 
-    for (int i = 0; i < 2; i++) {
-        VkImageCreateInfo imgCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
-        imgCI.imageType   = VK_IMAGE_TYPE_2D;
-        imgCI.format      = VK_FORMAT_R16_SFLOAT;
-        imgCI.extent      = {width, height, 1};
-        imgCI.mipLevels   = 1;
-        imgCI.arrayLayers = 1;
-        imgCI.samples     = VK_SAMPLE_COUNT_1_BIT;
-        imgCI.tiling      = VK_IMAGE_TILING_OPTIMAL;
-        imgCI.usage       = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-        imgCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-        VmaAllocationCreateInfo allocCI{};
-        allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-
-        VkImage image;
-        VmaAllocation alloc;
-        VK_CHECK(vmaCreateImage(allocator, &imgCI, &allocCI, &image, &alloc, nullptr));
-
-        VkImageViewCreateInfo viewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
-        viewCI.image    = image;
-        viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewCI.format   = VK_FORMAT_R16_SFLOAT;
-        viewCI.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
-
-        VkImageView view;
-        VK_CHECK(vkCreateImageView(device, &viewCI, nullptr, &view));
-
-        mShadowImage[i].SetHandles(image, view, alloc);
-    }
+    CreateImages(width, height);
 
     VkSamplerCreateInfo samplerCI{VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO};
     samplerCI.magFilter    = VK_FILTER_LINEAR;
@@ -89,38 +116,61 @@ void RTShadows::Initialize(VkDevice device, VmaAllocator allocator,
         VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeCI, nullptr, &mDenoisePipeline));
     }
 
+    // Upsample pipeline
+    {
+        VkPushConstantRange pcRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(UpsamplePushConstants)};
+        VkPipelineLayoutCreateInfo layoutCI{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+        layoutCI.setLayoutCount         = 1;
+        layoutCI.pSetLayouts            = &mUpsampleDescLayout;
+        layoutCI.pushConstantRangeCount = 1;
+        layoutCI.pPushConstantRanges    = &pcRange;
+        VK_CHECK(vkCreatePipelineLayout(device, &layoutCI, nullptr, &mUpsamplePipeLayout));
+
+        VkShaderModule mod = shaders.GetOrLoad("shaders/rt_shadow_upsample.comp.spv");
+        VkComputePipelineCreateInfo pipeCI{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipeCI.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeCI.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeCI.stage.module = mod;
+        pipeCI.stage.pName  = "main";
+        pipeCI.layout       = mUpsamplePipeLayout;
+        VK_CHECK(vkCreateComputePipelines(device, VK_NULL_HANDLE, 1, &pipeCI, nullptr, &mUpsamplePipeline));
+    }
+
     LOG_INFO("RTShadows initialized ({}x{})", width, height);
 }
 
 void RTShadows::CreateDescriptors() {
-    // Trace: TLAS, output, depth (3 bindings, no prev image)
+    // Trace: TLAS, output, depth, blue noise (no prev image)
     {
-        VkDescriptorSetLayoutBinding bindings[3] = {};
+        VkDescriptorSetLayoutBinding bindings[4] = {};
         bindings[0] = {0, VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1, VK_SHADER_STAGE_COMPUTE_BIT};
         bindings[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT};
         bindings[2] = {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT};
+        bindings[3] = {3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT};
 
         VkDescriptorSetLayoutCreateInfo layoutCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
-        layoutCI.bindingCount = 3;
+        layoutCI.bindingCount = 4;
         layoutCI.pBindings    = bindings;
         VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutCI, nullptr, &mTraceDescLayout));
 
         VkDescriptorPoolSize poolSizes[] = {
-            {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 1},
-            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1},
-            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+            {VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR, 2},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 4},
         };
         VkDescriptorPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-        poolCI.maxSets       = 1;
+        poolCI.maxSets       = 2;
         poolCI.poolSizeCount = 3;
         poolCI.pPoolSizes    = poolSizes;
         VK_CHECK(vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mTraceDescPool));
 
+        // One set per output so switching trace modes never rewrites a set in flight
+        VkDescriptorSetLayout layouts[2] = {mTraceDescLayout, mTraceDescLayout};
         VkDescriptorSetAllocateInfo allocCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
         allocCI.descriptorPool     = mTraceDescPool;
-        allocCI.descriptorSetCount = 1;
-        allocCI.pSetLayouts        = &mTraceDescLayout;
-        VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocCI, &mTraceDescSet));
+        allocCI.descriptorSetCount = 2;
+        allocCI.pSetLayouts        = layouts;
+        VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocCI, mTraceDescSets));
     }
 
     // Denoise: input, output, depth
@@ -136,23 +186,55 @@ void RTShadows::CreateDescriptors() {
         VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutCI, nullptr, &mDenoiseDescLayout));
 
         VkDescriptorPoolSize poolSizes[] = {
-            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 6},
-            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 3},
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 12},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 6},
         };
         VkDescriptorPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
-        poolCI.maxSets       = 3;
+        poolCI.maxSets       = 6;
         poolCI.poolSizeCount = 2;
         poolCI.pPoolSizes    = poolSizes;
         VK_CHECK(vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mDenoiseDescPool));
 
-        for (int i = 0; i < 3; i++) {
-            VkDescriptorSetAllocateInfo allocCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
-            allocCI.descriptorPool     = mDenoiseDescPool;
-            allocCI.descriptorSetCount = 1;
-            allocCI.pSetLayouts        = &mDenoiseDescLayout;
-            VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocCI, &mDenoiseDescSets[i]));
+        for (int m = 0; m < 2; m++) {
+            for (int i = 0; i < 3; i++) {
+                VkDescriptorSetAllocateInfo allocCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+                allocCI.descriptorPool     = mDenoiseDescPool;
+                allocCI.descriptorSetCount = 1;
+                allocCI.pSetLayouts        = &mDenoiseDescLayout;
+                VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocCI, &mDenoiseDescSets[m][i]));
+            }
         }
     }
+
+    // Upsample: trace input, output, history, depth
+    {
+        VkDescriptorSetLayoutBinding bindings[4] = {};
+        bindings[0] = {0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT};
+        bindings[1] = {1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, VK_SHADER_STAGE_COMPUTE_BIT};
+        bindings[2] = {2, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT};
+        bindings[3] = {3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, VK_SHADER_STAGE_COMPUTE_BIT};
+
+        VkDescriptorSetLayoutCreateInfo layoutCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+        layoutCI.bindingCount = 4;
+        layoutCI.pBindings    = bindings;
+        VK_CHECK(vkCreateDescriptorSetLayout(mDevice, &layoutCI, nullptr, &mUpsampleDescLayout));
+
+        VkDescriptorPoolSize poolSizes[] = {
+            {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 2},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2},
+        };
+        VkDescriptorPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+        poolCI.maxSets       = 1;
+        poolCI.poolSizeCount = 2;
+        poolCI.pPoolSizes    = poolSizes;
+        VK_CHECK(vkCreateDescriptorPool(mDevice, &poolCI, nullptr, &mUpsampleDescPool));
+
+        VkDescriptorSetAllocateInfo allocCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+        allocCI.descriptorPool     = mUpsampleDescPool;
+        allocCI.descriptorSetCount = 1;
+        allocCI.pSetLayouts        = &mUpsampleDescLayout;
+        VK_CHECK(vkAllocateDescriptorSets(mDevice, &allocCI, &mUpsampleDescSet));
+    }
 }
 
 void RTShadows::UpdateDescriptors(VkAccelerationStructureKHR tlas,
@@ -162,55 +244,88 @@ void RTShadows::UpdateDescriptors(VkAccelerationStructureKHR tlas,
     asWrite.accelerationStructureCount = 1;
     asWrite.pAccelerationStructures    = &tlas;
 
-    VkDescriptorImageInfo outputInfo{VK_NULL_HANDLE, mShadowImage[0].GetView(), VK_IMAGE_LAYOUT_GENERAL};
     VkDescriptorImageInfo depthInfo{depthSampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
-
-    VkWriteDescriptorSet writes[3] = {};
-    writes[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[0].pNext           = &asWrite;
-    writes[0].dstSet          = mTraceDescSet;
-    writes[0].dstBinding      = 0;
-    writes[0].descriptorCount = 1;
-    writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
-
-    writes[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[1].dstSet          = mTraceDescSet;
-    writes[1].dstBinding      = 1;
-    writes[1].descriptorCount = 1;
-    writes[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
-    writes[1].pImageInfo      = &outputInfo;
-
-    writes[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-    writes[2].dstSet          = mTraceDescSet;
-    writes[2].dstBinding      = 2;
-    writes[2].descriptorCount = 1;
-    writes[2].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-    writes[2].pImageInfo      = &depthInfo;
-
-    vkUpdateDescriptorSets(mDevice, 3, writes, 0, nullptr);
+    VkDescriptorImageInfo noiseInfo{mBlueNoiseSampler, mBlueNoiseView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    for (int m = 0; m < 2; m++) {
+        VkImageView output = m == 0 ? mShadowImage[0].GetView() : mTraceImage[0].GetView();
+        VkDescriptorImageInfo outputInfo{VK_NULL_HANDLE, output, VK_IMAGE_LAYOUT_GENERAL};
+
+        VkWriteDescriptorSet writes[4] = {};
+        writes[0].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[0].pNext           = &asWrite;
+        writes[0].dstSet          = mTraceDescSets[m];
+        writes[0].dstBinding      = 0;
+        writes[0].descriptorCount = 1;
+        writes[0].descriptorType  = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+
+        writes[1].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[1].dstSet          = mTraceDescSets[m];
+        writes[1].dstBinding      = 1;
+        writes[1].descriptorCount = 1;
+        writes[1].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        writes[1].pImageInfo      = &outputInfo;
+
+        writes[2].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[2].dstSet          = mTraceDescSets[m];
+        writes[2].dstBinding      = 2;
+        writes[2].descriptorCount = 1;
+        writes[2].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[2].pImageInfo      = &depthInfo;
+
+        writes[3].sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[3].dstSet          = mTraceDescSets[m];
+        writes[3].dstBinding      = 3;
+        writes[3].descriptorCount = 1;
+        writes[3].descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        writes[3].pImageInfo      = &noiseInfo;
+
+        vkUpdateDescriptorSets(mDevice, 4, writes, 0, nullptr);
+    }
 }
 
 void RTShadows::UpdateDenoiseDescriptors(VkImageView depthView, VkSampler depthSampler) {
     VkDescriptorImageInfo depthInfo{depthSampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
 
-    for (int iter = 0; iter < 3; iter++) {
-        int srcIdx = (iter % 2 == 0) ? 0 : 1;
-        int dstIdx = 1 - srcIdx;
-
-        VkDescriptorImageInfo srcInfo{VK_NULL_HANDLE, mShadowImage[srcIdx].GetView(), VK_IMAGE_LAYOUT_GENERAL};
-        VkDescriptorImageInfo dstInfo{VK_NULL_HANDLE, mShadowImage[dstIdx].GetView(), VK_IMAGE_LAYOUT_GENERAL};
-
-        VkWriteDescriptorSet writes[3] = {};
-        writes[0] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mDenoiseDescSets[iter],
-                      0, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &srcInfo};
-        writes[1] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mDenoiseDescSets[iter],
-                      1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &dstInfo};
-        writes[2] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mDenoiseDescSets[iter],
-                      2, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &depthInfo};
-        vkUpdateDescriptorSets(mDevice, 3, writes, 0, nullptr);
+    for (int m = 0; m < 2; m++) {
+        const VulkanImage* images = m == 0 ? mShadowImage : mTraceImage;
+        for (int iter = 0; iter < 3; iter++) {
+            int srcIdx = (iter % 2 == 0) ? 0 : 1;
+            int dstIdx = 1 - srcIdx;
+
+            VkDescriptorImageInfo srcInfo{VK_NULL_HANDLE, images[srcIdx].GetView(), VK_IMAGE_LAYOUT_GENERAL};
+            VkDescriptorImageInfo dstInfo{VK_NULL_HANDLE, images[dstIdx].GetView(), VK_IMAGE_LAYOUT_GENERAL};
+
+            VkWriteDescriptorSet writes[3] = {};
+            writes[0] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mDenoiseDescSets[m][iter],
+                          0, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &srcInfo};
+            writes[1] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mDenoiseDescSets[m][iter],
+                          1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &dstInfo};
+            writes[2] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mDenoiseDescSets[m][iter],
+                          2, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &depthInfo};
+            vkUpdateDescriptorSets(mDevice, 3, writes, 0, nullptr);
+        }
     }
 }
 
+void RTShadows::UpdateUpsampleDescriptors(VkImageView depthView, VkSampler depthSampler) {
+    VkDescriptorImageInfo inputInfo{VK_NULL_HANDLE, mTraceImage[1].GetView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo outputInfo{VK_NULL_HANDLE, mShadowImage[1].GetView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo historyInfo{mSampler, mShadowImage[0].GetView(), VK_IMAGE_LAYOUT_GENERAL};
+    VkDescriptorImageInfo depthInfo{depthSampler, depthView, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL};
+
+    VkWriteDescriptorSet writes[4] = {};
+    writes[0] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mUpsampleDescSet,
+                  0, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &inputInfo};
+    writes[1] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mUpsampleDescSet,
+                  1, 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, &outputInfo};
+    writes[2] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mUpsampleDescSet,
+                  2, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &historyInfo};
+    writes[3] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET, nullptr, mUpsampleDescSet,
+                  3, 0, 1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, &depthInfo};
+    vkUpdateDescriptorSets(mDevice, 4, writes, 0, nullptr);
+}
+
 void RTShadows::Dispatch(VkCommandBuffer cmd, VkAccelerationStructureKHR tlas,
                           VkImageView depthView, VkSampler depthSampler,
                           const glm::mat4& invViewProj,
@@ -219,37 +334,53 @@ void RTShadows::Dispatch(VkCommandBuffer cmd, VkAccelerationStructureKHR tlas,
     if (mDescriptorsDirty) {
         UpdateDescriptors(tlas, depthView, depthSampler);
         UpdateDenoiseDescriptors(depthView, depthSampler);
+        UpdateUpsampleDescriptors(depthView, depthSampler);
         mDescriptorsDirty = false;
     }
 
-    // Transition both images to GENERAL (discard old content each frame)
-    VkImageMemoryBarrier2 barriers[2] = {};
+    const bool reduced = mMode != RTTraceMode::Full;
+    const VkExtent2D traceExtent = RTTraceExtent(mMode, mWidth, mHeight);
+
+    // Transition the working images to GENERAL, discarding old content. Reduced modes keep
+    // the full-resolution pair: it holds the history (and waits for last frame's copy).
+    VkImageMemoryBarrier2 barriers[4] = {};
+    uint32_t barrierCount = 0;
+    auto toGeneral = [&](const VulkanImage& image, bool keepContent) {
+        VkImageMemoryBarrier2& b = barriers[barrierCount++];
+        b.sType         = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
+        b.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+        b.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        b.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        b.dstAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_READ_BIT;
+        b.oldLayout     = keepContent ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED;
+        b.newLayout     = VK_IMAGE_LAYOUT_GENERAL;
+        b.image         = image.GetImage();
+        b.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+    };
     for (int i = 0; i < 2; i++) {
-        barriers[i].sType         = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2;
-        barriers[i].srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-        barriers[i].srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
-        barriers[i].dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
-        barriers[i].dstAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT | VK_ACCESS_2_SHADER_READ_BIT;
-        barriers[i].oldLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
-        barriers[i].newLayout     = VK_IMAGE_LAYOUT_GENERAL;
-        barriers[i].image         = mShadowImage[i].GetImage();
-        barriers[i].subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
+        toGeneral(mShadowImage[i], reduced && mHistoryValid);
+        if (reduced) toGeneral(mTraceImage[i], false);
     }
     VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
-    dep.imageMemoryBarrierCount = 2;
+    dep.imageMemoryBarrierCount = barrierCount;
     dep.pImageMemoryBarriers    = barriers;
     vkCmdPipelineBarrier2(cmd, &dep);
 
+    mTraceFrame = mFrameIndex++;
+
     TracePushConstants pc{};
     pc.invViewProj = invViewProj;
     pc.lightDir    = glm::vec4(lightDir, lightRadius);
     pc.cameraPos   = glm::vec4(cameraPos, 0.0f);
     pc.resolution  = {mWidth, mHeight};
+    pc.frameIndex  = mTraceFrame;
+    pc.traceMode   = static_cast<uint32_t>(mMode);
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mTracePipeline);
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mTracePipeLayout, 0, 1, &mTraceDescSet, 0, nullptr);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mTracePipeLayout, 0, 1,
+                            &mTraceDescSets[reduced ? 1 : 0], 0, nullptr);
     vkCmdPushConstants(cmd, mTracePipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
-    vkCmdDispatch(cmd, (mWidth + 7) / 8, (mHeight + 7) / 8, 1);
+    vkCmdDispatch(cmd, (traceExtent.width + 7) / 8, (traceExtent.height + 7) / 8, 1);
 
     {
         VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
@@ -269,6 +400,10 @@ void RTShadows::Denoise(VkCommandBuffer cmd, VkImageView depthView, VkSampler de
 
     vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mDenoisePipeline);
 
+    // Reduced modes filter at trace resolution, before the upsample
+    const int set = mMode != RTTraceMode::Full ? 1 : 0;
+    const VkExtent2D traceExtent = RTTraceExtent(mMode, mWidth, mHeight);
+
     constexpr int kIterations = 3;
     int stepSizes[] = {1, 2, 4};
     for (int iter = 0; iter < kIterations; iter++) {
@@ -278,11 +413,13 @@ void RTShadows::Denoise(VkCommandBuffer cmd, VkImageView depthView, VkSampler de
         pc.stepSize    = stepSizes[iter];
         pc.depthSigma  = 0.01f;
         pc.normalSigma = 128.0f;
+        pc.traceMode   = static_cast<uint32_t>(mMode);
+        pc.frameIndex  = mTraceFrame;
 
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mDenoisePipeLayout,
-                                0, 1, &mDenoiseDescSets[iter], 0, nullptr);
+                                0, 1, &mDenoiseDescSets[set][iter], 0, nullptr);
         vkCmdPushConstants(cmd, mDenoisePipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
-        vkCmdDispatch(cmd, (mWidth + 7) / 8, (mHeight + 7) / 8, 1);
+        vkCmdDispatch(cmd, (traceExtent.width + 7) / 8, (traceExtent.height + 7) / 8, 1);
 
         VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
         barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
@@ -298,58 +435,86 @@ void RTShadows::Denoise(VkCommandBuffer cmd, VkImageView depthView, VkSampler de
     mOutputIdx = (kIterations % 2 == 0) ? 0 : 1;
 }
 
+void RTShadows::Upsample(VkCommandBuffer cmd, const glm::mat4& invViewProj) {
+    if (mMode == RTTraceMode::Full) return;
+
+    const glm::mat4 viewProj = glm::inverse(invViewProj);
+    const VkExtent2D scale   = RTTraceScale(mMode);
+
+    UpsamplePushConstants pc{};
+    pc.invViewProj = invViewProj;
+    for (int r = 0, row = 0; row < 4; row++) {
+        if (row == 2) continue;   // depth is not needed to find the history texel
+        pc.prevViewProjRows[r++] = glm::vec4(mPrevViewProj[0][row], mPrevViewProj[1][row],
+                                             mPrevViewProj[2][row], mPrevViewProj[3][row]);
+    }
+    pc.traceMode    = static_cast<uint32_t>(mMode);
+    pc.frameIndex   = mTraceFrame;
+    pc.historyBlend = mHistoryValid ? std::max(1.0f / float(scale.width * scale.height), kMinHistoryBlend) : 1.0f;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mUpsamplePipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mUpsamplePipeLayout,
+                            0, 1, &mUpsampleDescSet, 0, nullptr);
+    vkCmdPushConstants(cmd, mUpsamplePipeLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(pc), &pc);
+    vkCmdDispatch(cmd, (mWidth + 7) / 8, (mHeight + 7) / 8, 1);
+
+    // The output feeds the composite and becomes next frame's history
+    VkMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    barrier.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    barrier.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    barrier.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_COPY_BIT;
+    barrier.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &barrier;
+    vkCmdPipelineBarrier2(cmd, &dep);
+
+    VkImageCopy region{};
+    region.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1};
+    region.extent         = {mWidth, mHeight, 1};
+    vkCmdCopyImage(cmd, mShadowImage[1].GetImage(), VK_IMAGE_LAYOUT_GENERAL,
+                   mShadowImage[0].GetImage(), VK_IMAGE_LAYOUT_GENERAL, 1, &region);
+
+    mPrevViewProj = viewProj;
+    mHistoryValid = true;
+}
+
 void RTShadows::Resize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height) {
     if (width == mWidth && height == mHeight) return;
     mDescriptorsDirty = true;
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < 2; i++) {
         mShadowImage[i].Destroy(allocator, device);
+        mTraceImage[i].Destroy(allocator, device);
+    }
     mWidth  = width;
     mHeight = height;
-
-    for (int i = 0; i < 2; i++) {
-        VkImageCreateInfo imgCI{VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO};
-        imgCI.imageType     = VK_IMAGE_TYPE_2D;
-        imgCI.format        = VK_FORMAT_R16_SFLOAT;
-        imgCI.extent        = {width, height, 1};
-        imgCI.mipLevels     = 1;
-        imgCI.arrayLayers   = 1;
-        imgCI.samples       = VK_SAMPLE_COUNT_1_BIT;
-        imgCI.tiling        = VK_IMAGE_TILING_OPTIMAL;
-        imgCI.usage         = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
-        imgCI.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-
-        VmaAllocationCreateInfo allocCI{};
-        allocCI.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
-
-        VkImage image;
-        VmaAllocation alloc;
-        VK_CHECK(vmaCreateImage(allocator, &imgCI, &allocCI, &image, &alloc, nullptr));
-
-        VkImageViewCreateInfo viewCI{VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO};
-        viewCI.image    = image;
-        viewCI.viewType = VK_IMAGE_VIEW_TYPE_2D;
-        viewCI.format   = VK_FORMAT_R16_SFLOAT;
-        viewCI.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1};
-        VkImageView view;
-        VK_CHECK(vkCreateImageView(device, &viewCI, nullptr, &view));
-        mShadowImage[i].SetHandles(image, view, alloc);
-    }
+    CreateImages(width, height);
 }
 
 void RTShadows::Shutdown(VkDevice device, VmaAllocator allocator) {
-    for (int i = 0; i < 2; i++)
+    for (int i = 0; i < 2; i++) {
         mShadowImage[i].Destroy(allocator, device);
+        mTraceImage[i].Destroy(allocator, device);
+    }
 
-    if (mSampler)           { vkDestroySampler(device, mSampler, nullptr);                       mSampler = VK_NULL_HANDLE; }
-    if (mTracePipeline)     { vkDestroyPipeline(device, mTracePipeline, nullptr);                mTracePipeline = VK_NULL_HANDLE; }
-    if (mTracePipeLayout)   { vkDestroyPipelineLayout(device, mTracePipeLayout, nullptr);        mTracePipeLayout = VK_NULL_HANDLE; }
-    if (mTraceDescPool)     { vkDestroyDescriptorPool(device, mTraceDescPool, nullptr);          mTraceDescPool = VK_NULL_HANDLE; }
-    if (mTraceDescLayout)   { vkDestroyDescriptorSetLayout(device, mTraceDescLayout, nullptr);   mTraceDescLayout = VK_NULL_HANDLE; }
-    if (mDenoisePipeline)   { vkDestroyPipeline(device, mDenoisePipeline, nullptr);              mDenoisePipeline = VK_NULL_HANDLE; }
-    if (mDenoisePipeLayout) { vkDestroyPipelineLayout(device, mDenoisePipeLayout, nullptr);      mDenoisePipeLayout = VK_NULL_HANDLE; }
-    if (mDenoiseDescPool)   { vkDestroyDescriptorPool(device, mDenoiseDescPool, nullptr);        mDenoiseDescPool = VK_NULL_HANDLE; }
-    if (mDenoiseDescLayout) { vkDestroyDescriptorSetLayout(device, mDenoiseDescLayout, nullptr); mDenoiseDescLayout = VK_NULL_HANDLE; }
-    mTraceDescSet = VK_NULL_HANDLE;
-    for (int i = 0; i < 3; i++) mDenoiseDescSets[i] = VK_NULL_HANDLE;
+    if (mSampler)            { vkDestroySampler(device, mSampler, nullptr);                        mSampler = VK_NULL_HANDLE; }
+    if (mTracePipeline)      { vkDestroyPipeline(device, mTracePipeline, nullptr);                 mTracePipeline = VK_NULL_HANDLE; }
+    if (mTracePipeLayout)    { vkDestroyPipelineLayout(device, mTracePipeLayout, nullptr);         mTracePipeLayout = VK_NULL_HANDLE; }
+    if (mTraceDescPool)      { vkDestroyDescriptorPool(device, mTraceDescPool, nullptr);           mTraceDescPool = VK_NULL_HANDLE; }
+    if (mTraceDescLayout)    { vkDestroyDescriptorSetLayout(device, mTraceDescLayout, nullptr);    mTraceDescLayout = VK_NULL_HANDLE; }
+    if (mDenoisePipeline)    { vkDestroyPipeline(device, mDenoisePipeline, nullptr);               mDenoisePipeline = VK_NULL_HANDLE; }
+    if (mDenoisePipeLayout)  { vkDestroyPipelineLayout(device, mDenoisePipeLayout, nullptr);       mDenoisePipeLayout = VK_NULL_HANDLE; }
+    if (mDenoiseDescPool)    { vkDestroyDescriptorPool(device, mDenoiseDescPool, nullptr);         mDenoiseDescPool = VK_NULL_HANDLE; }
+    if (mDenoiseDescLayout)  { vkDestroyDescriptorSetLayout(device, mDenoiseDescLayout, nullptr);  mDenoiseDescLayout = VK_NULL_HANDLE; }
+    if (mUpsamplePipeline)   { vkDestroyPipeline(device, mUpsamplePipeline, nullptr);              mUpsamplePipeline = VK_NULL_HANDLE; }
+    if (mUpsamplePipeLayout) { vkDestroyPipelineLayout(device, mUpsamplePipeLayout, nullptr);      mUpsamplePipeLayout = VK_NULL_HANDLE; }
+    if (mUpsampleDescPool)   { vkDestroyDescriptorPool(device, mUpsampleDescPool, nullptr);        mUpsampleDescPool = VK_NULL_HANDLE; }
+    if (mUpsampleDescLayout) { vkDestroyDescriptorSetLayout(device, mUpsampleDescLayout, nullptr); mUpsampleDescLayout = VK_NULL_HANDLE; }
+    for (auto& set : mTraceDescSets) set = VK_NULL_HANDLE;
+    for (auto& sets : mDenoiseDescSets)
+        for (auto& set : sets) set = VK_NULL_HANDLE;
+    mUpsampleDescSet  = VK_NULL_HANDLE;
     mDescriptorsDirty = true;
+    mHistoryValid     = false;
 }
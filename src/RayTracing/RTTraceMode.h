@@ -0,0 +1,50 @@
+#pragma once
+
+#include <volk.h>
+#include <cstdint>
+
+/// Rays per frame of the RT shadow and reflection passes (RT_TRACE_* in rt_trace_mode.glsl).
+/// Reduced modes trace a rotating pixel of each block, A-Trous filter at trace resolution,
+/// then upsample bilaterally and accumulate over frames back to full resolution.
+enum class RTTraceMode : int {
+    Full         = 0,  // one ray per pixel
+    Half         = 1,  // one ray per 2x2 block
+    Quarter      = 2,  // one ray per 4x4 block
+    Checkerboard = 3,  // one ray per horizontal pixel pair, alternating each frame
+};
+
+inline VkExtent2D RTTraceScale(RTTraceMode mode) {
+    switch (mode) {
+    case RTTraceMode::Half:         return {2, 2};
+    case RTTraceMode::Quarter:      return {4, 4};
+    case RTTraceMode::Checkerboard: return {2, 1};
+    default:                        return {1, 1};
+    }
+}
+
+inline VkExtent2D RTTraceExtent(RTTraceMode mode, uint32_t width, uint32_t height) {
+    VkExtent2D s = RTTraceScale(mode);
+    return {(width + s.width - 1) / s.width, (height + s.height - 1) / s.height};
+}
+
+inline const char* RTTraceModeName(RTTraceMode mode) {
+    switch (mode) {
+    case RTTraceMode::Half:         return "Half";
+    case RTTraceMode::Quarter:      return "Quarter";
+    case RTTraceMode::Checkerboard: return "Checkerboard";
+    default:                        return "Full";
+    }
+}
+
+/// Debug UI / --rt-preset quality levels
+struct RTTracePreset {
+    const char* name;
+    RTTraceMode shadows;
+    RTTraceMode reflections;
+};
+
+inline constexpr RTTracePreset kRTTracePresets[] = {
+    {"Quality",     RTTraceMode::Full,         RTTraceMode::Full},
+    {"Balanced",    RTTraceMode::Checkerboard, RTTraceMode::Half},
+    {"Performance", RTTraceMode::Half,         RTTraceMode::Quarter},
+};
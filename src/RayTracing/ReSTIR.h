@@ -0,0 +1,99 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+/// Reservoir math of ReSTIR DI (Bitterli et al., "Spatiotemporal reservoir resampling
+/// for real-time ray tracing with dynamic direct lighting", 2020), the CPU reference of
+/// restir.glsl. Same struct layout and the same arithmetic, so reservoirs read back from
+/// the GPU can be checked against it and the estimators tested without a device.
+///
+/// A reservoir streams candidates x_i drawn from source pdfs p_i and keeps one with
+/// probability proportional to w_i = p-hat(x_i) / p_i. After Finalize, `weight` holds the
+/// unbiased contribution weight W = wSum / (M * p-hat(y)), so f(y) * W estimates the
+/// integral of f for any target p-hat that is non-zero wherever f is.
+namespace ReSTIR {
+
+constexpr uint32_t kLightSun  = 0xFFFFFFFEu;   // LIGHT_SUN in pt_common.glsl
+constexpr uint32_t kLightNone = 0xFFFFFFFFu;   // LIGHT_NONE
+
+/// Candidate history a temporal neighbor may bring, relative to the current M
+constexpr float kMaxHistory = 20.0f;
+
+struct Reservoir {
+    glm::vec2 uv{0.0f};            // sample position on the light
+    uint32_t  light     = kLightNone;
+    float     M         = 0.0f;    // candidates the reservoir stands for
+    float     weight    = 0.0f;    // wSum while streaming, W after Finalize
+    float     targetPdf = 0.0f;    // p-hat of the selected sample at the reservoir's surface
+    float     depth     = 0.0f;    // view depth of that surface, for reuse validation
+    uint32_t  normal    = 0;       // octahedral-packed surface normal
+};
+static_assert(sizeof(Reservoir) == 32, "Reservoir must match restir.glsl");
+
+/// Streams one candidate drawn with sourcePdf; u is uniform in [0, 1).
+/// Returns true when the candidate replaced the selected sample.
+inline bool Update(Reservoir& r, uint32_t light, glm::vec2 uv,
+                   float targetPdf, float sourcePdf, float u) {
+    float w = sourcePdf > 0.0f ? targetPdf / sourcePdf : 0.0f;
+    r.weight += w;
+    r.M      += 1.0f;
+    if (w > 0.0f && u * r.weight < w) {
+        r.light     = light;
+        r.uv        = uv;
+        r.targetPdf = targetPdf;
+        return true;
+    }
+    return false;
+}
+
+/// Streams a finalized reservoir as one candidate standing for other.M samples;
+/// targetPdfHere is p-hat of other's sample re-evaluated at r's surface.
+inline bool Merge(Reservoir& r, const Reservoir& other, float targetPdfHere, float u) {
+    float w = targetPdfHere * other.weight * other.M;
+    r.weight += w;
+    r.M      += other.M;
+    if (w > 0.0f && u * r.weight < w) {
+        r.light     = other.light;
+        r.uv        = other.uv;
+        r.targetPdf = targetPdfHere;
+        return true;
+    }
+    return false;
+}
+
+/// wSum -> W. Reservoirs that never selected anything end with W = 0.
+inline void Finalize(Reservoir& r) {
+    float denom = r.M * r.targetPdf;
+    r.weight = denom > 0.0f ? r.weight / denom : 0.0f;
+}
+
+/// Bounds the temporal history to kMaxHistory times the current candidate count, so a
+/// stale reservoir cannot outweigh this frame's samples forever.
+inline void ClampHistory(Reservoir& history, float currentM) {
+    history.M = std::min(history.M, kMaxHistory * std::max(currentM, 1.0f));
+}
+
+/// Octahedral normal encoding, 16 bits per axis.
+inline uint32_t PackNormal(glm::vec3 n) {
+    n /= std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    glm::vec2 p(n.x, n.y);
+    if (n.z < 0.0f)
+        p = (1.0f - glm::abs(glm::vec2(p.y, p.x))) *
+            glm::vec2(p.x >= 0.0f ? 1.0f : -1.0f, p.y >= 0.0f ? 1.0f : -1.0f);
+    glm::uvec2 q = glm::uvec2(glm::clamp(p * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f + 0.5f);
+    return q.x | (q.y << 16);
+}
+
+inline glm::vec3 UnpackNormal(uint32_t packed) {
+    glm::vec2 p = glm::vec2(float(packed & 0xFFFFu), float(packed >> 16)) / 65535.0f * 2.0f - 1.0f;
+    glm::vec3 n(p.x, p.y, 1.0f - std::abs(p.x) - std::abs(p.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+} // namespace ReSTIR
@@ -0,0 +1,162 @@
+#include "RayTracing/ReSTIRDI.h"
+#include "RayTracing/ReSTIR.h"
+#include "Core/Logger.h"
+
+#include <iterator>
+
+namespace {
+
+constexpr VkDeviceSize kSlices = 3;   // two final slices (ping-pong history) + initial
+
+void ComputeBarrier(VkCommandBuffer cmd, VkPipelineStageFlags2 srcStages) {
+    VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    mb.srcStageMask  = srcStages;
+    mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    mb.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    mb.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &mb;
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+} // namespace
+
+void ReSTIRDI::Initialize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height) {
+    mDevice    = device;
+    mAllocator = allocator;
+    mWidth     = width;
+    mHeight    = height;
+
+    VkDescriptorSetLayoutBinding binding{0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+    VkDescriptorSetLayoutCreateInfo layoutCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutCI.bindingCount = 1;
+    layoutCI.pBindings    = &binding;
+    VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &mDescLayout));
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1};
+    VkDescriptorPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolCI.maxSets       = 1;
+    poolCI.poolSizeCount = 1;
+    poolCI.pPoolSizes    = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(device, &poolCI, nullptr, &mDescPool));
+
+    VkDescriptorSetAllocateInfo allocCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocCI.descriptorPool     = mDescPool;
+    allocCI.descriptorSetCount = 1;
+    allocCI.pSetLayouts        = &mDescLayout;
+    VK_CHECK(vkAllocateDescriptorSets(device, &allocCI, &mDescSet));
+
+    CreateBuffers();
+}
+
+void ReSTIRDI::Shutdown(VkDevice device, VmaAllocator allocator) {
+    DestroyPipelines();
+    mReservoirs.Destroy(allocator);
+
+    if (mDescLayout) { vkDestroyDescriptorSetLayout(device, mDescLayout, nullptr); mDescLayout = VK_NULL_HANDLE; }
+    if (mDescPool)   { vkDestroyDescriptorPool(device, mDescPool, nullptr);        mDescPool = VK_NULL_HANDLE; }
+    mDescSet      = VK_NULL_HANDLE;
+    mHistoryValid = false;
+}
+
+void ReSTIRDI::Resize(VkDevice /*device*/, VmaAllocator allocator, uint32_t width, uint32_t height) {
+    if (width == mWidth && height == mHeight) return;
+    mWidth  = width;
+    mHeight = height;
+
+    mReservoirs.Destroy(allocator);
+    CreateBuffers();
+}
+
+void ReSTIRDI::CreateBuffers() {
+    VkDeviceSize size = kSlices * mWidth * mHeight * sizeof(ReSTIR::Reservoir);
+    mReservoirs.CreateDeviceLocalEmpty(mAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, size);
+    mHistoryValid = false;
+    UpdateDescriptors();
+
+    LOG_INFO("ReSTIR DI reservoirs: {}x{} x {} slices, {:.1f} MB",
+             mWidth, mHeight, kSlices, double(size) / (1024.0 * 1024.0));
+}
+
+void ReSTIRDI::UpdateDescriptors() {
+    if (mDescSet == VK_NULL_HANDLE) return;
+
+    VkDescriptorBufferInfo info{mReservoirs.GetHandle(), 0, VK_WHOLE_SIZE};
+    VkWriteDescriptorSet write{VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet          = mDescSet;
+    write.dstBinding      = 0;
+    write.descriptorCount = 1;
+    write.descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo     = &info;
+    vkUpdateDescriptorSets(mDevice, 1, &write, 0, nullptr);
+}
+
+void ReSTIRDI::UpdateScene(ShaderManager& shaders,
+                           VkDescriptorSetLayout sceneLayout,
+                           VkDescriptorSetLayout bindlessLayout,
+                           VertexFormat vertexFormat) {
+    if (bindlessLayout == VK_NULL_HANDLE) return;
+    if (IsReady() && vertexFormat == mVertexFormat) return;
+    DestroyPipelines();
+    mVertexFormat = vertexFormat;
+
+    VkDescriptorSetLayout layouts[] = {sceneLayout, bindlessLayout, mDescLayout};
+    VkPushConstantRange pcRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PTPushConstants)};
+    VkPipelineLayoutCreateInfo plCI{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    plCI.setLayoutCount         = static_cast<uint32_t>(std::size(layouts));
+    plCI.pSetLayouts            = layouts;
+    plCI.pushConstantRangeCount = 1;
+    plCI.pPushConstantRanges    = &pcRange;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &plCI, nullptr, &mPipelineLayout));
+
+    VertexFormatSpecialization spec(vertexFormat);
+    auto create = [&](const char* path, VkPipeline& pipeline) {
+        VkComputePipelineCreateInfo pipeCI{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipeCI.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeCI.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeCI.stage.module = shaders.GetOrLoad(path);
+        pipeCI.stage.pName  = "main";
+        pipeCI.stage.pSpecializationInfo = &spec.info;
+        pipeCI.layout       = mPipelineLayout;
+        VK_CHECK(vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipeCI, nullptr, &pipeline));
+    };
+    create("shaders/pt_restir_initial.comp.spv", mInitialPipeline);
+    create("shaders/pt_restir_spatial.comp.spv", mSpatialPipeline);
+
+    LOG_INFO("ReSTIR DI pipelines created");
+}
+
+void ReSTIRDI::DestroyPipelines() {
+    if (mInitialPipeline) { vkDestroyPipeline(mDevice, mInitialPipeline, nullptr); mInitialPipeline = VK_NULL_HANDLE; }
+    if (mSpatialPipeline) { vkDestroyPipeline(mDevice, mSpatialPipeline, nullptr); mSpatialPipeline = VK_NULL_HANDLE; }
+    if (mPipelineLayout)  { vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr); mPipelineLayout = VK_NULL_HANDLE; }
+}
+
+void ReSTIRDI::Dispatch(VkCommandBuffer cmd, VkDescriptorSet sceneSet,
+                        VkDescriptorSet bindlessSet, const PTPushConstants& pc) {
+    if (!IsReady() || bindlessSet == VK_NULL_HANDLE) return;
+
+    // Surface, G-buffer and radiance writes of either integrator
+    ComputeBarrier(cmd, VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+    VkDescriptorSet sets[] = {sceneSet, bindlessSet, mDescSet};
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout,
+                            0, static_cast<uint32_t>(std::size(sets)), sets, 0, nullptr);
+    vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                       0, sizeof(PTPushConstants), &pc);
+
+    uint32_t groupsX = (mWidth  + 7) / 8;
+    uint32_t groupsY = (mHeight + 7) / 8;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mInitialPipeline);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+    ComputeBarrier(cmd, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mSpatialPipeline);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+
+    // This frame's output slice is the next frame's history
+    mFrame++;
+    mHistoryValid = true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "RayTracing/WavefrontIntegrator.h"
+#include "Resource/VulkanBuffer.h"
+#include "Resource/ShaderManager.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+#include <cstdint>
+
+/// ReSTIR DI for the path tracer's primary hits (pt_restir.glsl). The integrators store
+/// the primary surface and leave its direct light out; an initial pass resamples light
+/// candidates against the surface's reprojected reservoir from last frame, a spatial
+/// pass reuses neighbors, traces one shadow ray and accumulates the frame. Cost per pixel
+/// is fixed by the candidate and neighbor counts, not by the number of lights.
+/// Uses the PathTracer's scene set (0) and bindless set (1); owns the reservoirs (set 2).
+class ReSTIRDI {
+public:
+    void Initialize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height);
+    void Shutdown(VkDevice device, VmaAllocator allocator);
+    void Resize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height);
+
+    /// Creates the pipelines against the scene layouts; recreates them when the vertex
+    /// format changes, since the visibility rays fetch UVs for the alpha test.
+    void UpdateScene(ShaderManager& shaders,
+                     VkDescriptorSetLayout sceneLayout,
+                     VkDescriptorSetLayout bindlessLayout,
+                     VertexFormat vertexFormat);
+
+    /// FrameUBO restir.w for the next Dispatch: output slice | history valid << 1.
+    uint32_t GetSliceFlags() const { return (mFrame & 1u) | (mHistoryValid ? 2u : 0u); }
+
+    /// Drops the temporal history, e.g. after the light list was rebuilt.
+    void InvalidateHistory() { mHistoryValid = false; }
+
+    /// Records both passes. The integrator's writes must already be visible to compute.
+    void Dispatch(VkCommandBuffer cmd, VkDescriptorSet sceneSet, VkDescriptorSet bindlessSet,
+                  const PTPushConstants& pc);
+
+    bool IsReady() const { return mInitialPipeline != VK_NULL_HANDLE; }
+
+private:
+    void CreateBuffers();
+    void UpdateDescriptors();
+    void DestroyPipelines();
+
+    VkDevice     mDevice    = VK_NULL_HANDLE;
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+    uint32_t     mWidth = 0, mHeight = 0;
+
+    VulkanBuffer mReservoirs;     // 3 slices of one reservoir per pixel
+    uint32_t     mFrame = 0;
+    bool         mHistoryValid = false;
+
+    VkDescriptorSetLayout mDescLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      mDescPool   = VK_NULL_HANDLE;
+    VkDescriptorSet       mDescSet    = VK_NULL_HANDLE;
+
+    VkPipelineLayout mPipelineLayout  = VK_NULL_HANDLE;
+    VkPipeline       mInitialPipeline = VK_NULL_HANDLE;
+    VkPipeline       mSpatialPipeline = VK_NULL_HANDLE;
+    VertexFormat     mVertexFormat    = VertexFormat::Float;
+};
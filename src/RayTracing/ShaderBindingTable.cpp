@@ -88,7 +88,7 @@ void ShaderBindingTable::WriteHitGroupData(uint32_t hitGroupIndex,
 }
 
 void ShaderBindingTable::UploadToGPU(VmaAllocator allocator, VkDevice device,
-                                      const TransferManager& transfer) {
+                                      TransferManager& transfer) {
     mBuffer.Destroy(allocator);
     mBuffer.CreateDeviceLocal(allocator, transfer,
         VK_BUFFER_USAGE_SHADER_BINDING_TABLE_BIT_KHR |
@@ -22,7 +22,7 @@ public:
 
     void WriteHitGroupData(uint32_t hitGroupIndex, const void* data, uint32_t dataSize);
     void UploadToGPU(VmaAllocator allocator, VkDevice device,
-                     const class TransferManager& transfer);
+                     class TransferManager& transfer);
 
     void Destroy(VmaAllocator allocator);
 
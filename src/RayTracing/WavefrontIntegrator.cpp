@@ -0,0 +1,306 @@
+#include "RayTracing/WavefrontIntegrator.h"
+#include "Core/Logger.h"
+
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+// std430 sizes of the structs in pt_wavefront.glsl
+constexpr VkDeviceSize kPathStateSize  = 64;
+constexpr VkDeviceSize kHitRecordSize  = 64;
+constexpr VkDeviceSize kShadowRaySize  = 48;
+constexpr VkDeviceSize kCounterSize    = 64;
+constexpr VkDeviceSize kExtendArgsOffset  = 16;
+constexpr VkDeviceSize kShadeArgsOffset   = 32;
+constexpr VkDeviceSize kConnectArgsOffset = 48;
+// sizeof(MaterialParams) in pt_common.glsl
+constexpr VkDeviceSize kMaterialStride = 64;
+
+constexpr uint32_t kBindingCount = 7;
+
+const char* kStageShaders[] = {
+    "shaders/pt_wf_generate.comp.spv",
+    "shaders/pt_wf_extend.comp.spv",
+    "shaders/pt_wf_scan.comp.spv",
+    "shaders/pt_wf_scatter.comp.spv",
+    "shaders/pt_wf_shade.comp.spv",
+    "shaders/pt_wf_args.comp.spv",
+    "shaders/pt_wf_connect.comp.spv",
+    "shaders/pt_wf_resolve.comp.spv",
+};
+
+// Compute writes -> the next stage's storage reads and indirect argument fetch
+void StageBarrier(VkCommandBuffer cmd) {
+    VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+    mb.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+    mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+    mb.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+    mb.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT |
+                       VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+    VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    dep.memoryBarrierCount = 1;
+    dep.pMemoryBarriers    = &mb;
+    vkCmdPipelineBarrier2(cmd, &dep);
+}
+
+} // namespace
+
+void WavefrontIntegrator::Initialize(VkDevice device, VmaAllocator allocator,
+                                     uint32_t width, uint32_t height) {
+    mDevice    = device;
+    mAllocator = allocator;
+    mWidth     = width;
+    mHeight    = height;
+
+    VkDescriptorSetLayoutBinding bindings[kBindingCount] = {};
+    for (uint32_t i = 0; i < kBindingCount; i++)
+        bindings[i] = {i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+
+    VkDescriptorSetLayoutCreateInfo layoutCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutCI.bindingCount = kBindingCount;
+    layoutCI.pBindings    = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(device, &layoutCI, nullptr, &mDescLayout));
+
+    VkDescriptorPoolSize poolSize{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, kBindingCount};
+    VkDescriptorPoolCreateInfo poolCI{VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolCI.maxSets       = 1;
+    poolCI.poolSizeCount = 1;
+    poolCI.pPoolSizes    = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(device, &poolCI, nullptr, &mDescPool));
+
+    VkDescriptorSetAllocateInfo allocCI{VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocCI.descriptorPool     = mDescPool;
+    allocCI.descriptorSetCount = 1;
+    allocCI.pSetLayouts        = &mDescLayout;
+    VK_CHECK(vkAllocateDescriptorSets(device, &allocCI, &mDescSet));
+
+    CreateBuffers();
+}
+
+void WavefrontIntegrator::Shutdown(VkDevice device, VmaAllocator allocator) {
+    DestroyPipelines();
+    DestroyBuffers();
+    mMaterialBins.Destroy(allocator);
+    mMaterialCount = 0;
+
+    if (mDescLayout) { vkDestroyDescriptorSetLayout(device, mDescLayout, nullptr); mDescLayout = VK_NULL_HANDLE; }
+    if (mDescPool)   { vkDestroyDescriptorPool(device, mDescPool, nullptr);        mDescPool = VK_NULL_HANDLE; }
+    mDescSet = VK_NULL_HANDLE;
+}
+
+void WavefrontIntegrator::Resize(VkDevice /*device*/, VmaAllocator /*allocator*/,
+                                 uint32_t width, uint32_t height) {
+    if (width == mWidth && height == mHeight) return;
+    mWidth  = width;
+    mHeight = height;
+
+    DestroyBuffers();
+    CreateBuffers();
+}
+
+void WavefrontIntegrator::CreateBuffers() {
+    VkDeviceSize pathCount = VkDeviceSize(mWidth) * mHeight;
+
+    mPathBuffer.CreateDeviceLocalEmpty(mAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                       pathCount * kPathStateSize);
+    mHitBuffer.CreateDeviceLocalEmpty(mAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                      pathCount * kHitRecordSize);
+    mRayQueue.CreateDeviceLocalEmpty(mAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                     2 * pathCount * sizeof(uint32_t));
+    mSortedQueue.CreateDeviceLocalEmpty(mAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                        pathCount * sizeof(uint32_t));
+    mShadowBuffer.CreateDeviceLocalEmpty(mAllocator, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+                                         pathCount * kShadowRaySize);
+    mCounterBuffer.CreateDeviceLocalEmpty(mAllocator,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+        VK_BUFFER_USAGE_TRANSFER_DST_BIT, kCounterSize);
+
+    UpdateDescriptors();
+
+    LOG_INFO("Wavefront path tracer buffers: {} paths, {:.1f} MB",
+             pathCount,
+             double(pathCount * (kPathStateSize + kHitRecordSize + kShadowRaySize + 3 * sizeof(uint32_t)))
+                 / (1024.0 * 1024.0));
+}
+
+void WavefrontIntegrator::DestroyBuffers() {
+    mPathBuffer.Destroy(mAllocator);
+    mHitBuffer.Destroy(mAllocator);
+    mRayQueue.Destroy(mAllocator);
+    mSortedQueue.Destroy(mAllocator);
+    mShadowBuffer.Destroy(mAllocator);
+    mCounterBuffer.Destroy(mAllocator);
+}
+
+void WavefrontIntegrator::UpdateDescriptors() {
+    // The material bins only exist once a scene is bound
+    if (mDescSet == VK_NULL_HANDLE || mMaterialBins.GetHandle() == VK_NULL_HANDLE) return;
+
+    // Exact ranges: the shaders derive the path and material counts from .length()
+    const VulkanBuffer* buffers[kBindingCount] = {
+        &mPathBuffer, &mHitBuffer, &mRayQueue, &mSortedQueue,
+        &mShadowBuffer, &mCounterBuffer, &mMaterialBins,
+    };
+    VkDescriptorBufferInfo infos[kBindingCount];
+    VkWriteDescriptorSet   writes[kBindingCount] = {};
+    for (uint32_t i = 0; i < kBindingCount; i++) {
+        infos[i] = {buffers[i]->GetHandle(), 0, buffers[i]->GetSize()};
+        writes[i] = {VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+        writes[i].dstSet          = mDescSet;
+        writes[i].dstBinding      = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo     = &infos[i];
+    }
+    vkUpdateDescriptorSets(mDevice, kBindingCount, writes, 0, nullptr);
+}
+
+void WavefrontIntegrator::UpdateScene(ShaderManager& shaders,
+                                      VkDescriptorSetLayout sceneLayout,
+                                      VkDescriptorSetLayout bindlessLayout,
+                                      VertexFormat vertexFormat, VkDeviceSize materialBufferSize) {
+    uint32_t materialCount = std::max(static_cast<uint32_t>(materialBufferSize / kMaterialStride), 1u);
+    if (materialCount != mMaterialCount) {
+        mMaterialCount = materialCount;
+        mMaterialBins.Destroy(mAllocator);
+        mMaterialBins.CreateDeviceLocalEmpty(mAllocator,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            2 * VkDeviceSize(materialCount) * sizeof(uint32_t));
+        UpdateDescriptors();
+    }
+
+    // Hit-group textures live in the bindless set: without it there is nothing to shade
+    if (bindlessLayout == VK_NULL_HANDLE) return;
+    if (!IsReady() || vertexFormat != mVertexFormat)
+        CreatePipelines(shaders, sceneLayout, bindlessLayout, vertexFormat);
+}
+
+void WavefrontIntegrator::CreatePipelines(ShaderManager& shaders,
+                                          VkDescriptorSetLayout sceneLayout,
+                                          VkDescriptorSetLayout bindlessLayout,
+                                          VertexFormat vertexFormat) {
+    DestroyPipelines();
+    mVertexFormat = vertexFormat;
+
+    VkDescriptorSetLayout layouts[] = {sceneLayout, bindlessLayout, mDescLayout};
+    VkPushConstantRange pcRange{VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PTPushConstants)};
+    VkPipelineLayoutCreateInfo plCI{VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO};
+    plCI.setLayoutCount         = static_cast<uint32_t>(std::size(layouts));
+    plCI.pSetLayouts            = layouts;
+    plCI.pushConstantRangeCount = 1;
+    plCI.pPushConstantRanges    = &pcRange;
+    VK_CHECK(vkCreatePipelineLayout(mDevice, &plCI, nullptr, &mPipelineLayout));
+
+    // Extend fetches vertices; every stage gets the constant so the include stays uniform
+    VertexFormatSpecialization spec(vertexFormat);
+
+    for (uint32_t s = 0; s < StageCount; s++) {
+        VkComputePipelineCreateInfo pipeCI{VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+        pipeCI.stage.sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeCI.stage.stage  = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeCI.stage.module = shaders.GetOrLoad(kStageShaders[s]);
+        pipeCI.stage.pName  = "main";
+        pipeCI.stage.pSpecializationInfo = &spec.info;
+        pipeCI.layout       = mPipelineLayout;
+        VK_CHECK(vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipeCI, nullptr, &mPipelines[s]));
+    }
+
+    LOG_INFO("Wavefront path tracer pipelines created ({} stages)", uint32_t(StageCount));
+}
+
+void WavefrontIntegrator::DestroyPipelines() {
+    for (VkPipeline& p : mPipelines) {
+        if (p) { vkDestroyPipeline(mDevice, p, nullptr); p = VK_NULL_HANDLE; }
+    }
+    if (mPipelineLayout) { vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr); mPipelineLayout = VK_NULL_HANDLE; }
+}
+
+void WavefrontIntegrator::Dispatch(VkCommandBuffer cmd, VkDescriptorSet sceneSet,
+                                   VkDescriptorSet bindlessSet, const PTPushConstants& pc) {
+    if (!IsReady() || bindlessSet == VK_NULL_HANDLE) return;
+
+    VkBuffer counters = mCounterBuffer.GetHandle();
+
+    // The previous frame's stages may still be using the buffers
+    {
+        VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        mb.srcStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.dstAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.memoryBarrierCount = 1;
+        dep.pMemoryBarriers    = &mb;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    // Zero the queue counters and material bins
+    vkCmdFillBuffer(cmd, counters, 0, VK_WHOLE_SIZE, 0);
+    vkCmdFillBuffer(cmd, mMaterialBins.GetHandle(), 0, VK_WHOLE_SIZE, 0);
+    {
+        VkMemoryBarrier2 mb{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
+        mb.srcStageMask  = VK_PIPELINE_STAGE_2_CLEAR_BIT;
+        mb.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        mb.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        mb.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT | VK_ACCESS_2_SHADER_WRITE_BIT;
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.memoryBarrierCount = 1;
+        dep.pMemoryBarriers    = &mb;
+        vkCmdPipelineBarrier2(cmd, &dep);
+    }
+
+    VkDescriptorSet sets[] = {sceneSet, bindlessSet, mDescSet};
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout,
+                            0, static_cast<uint32_t>(std::size(sets)), sets, 0, nullptr);
+
+    PTPushConstants stagePC = pc;
+    auto push = [&](uint32_t bounce) {
+        stagePC.params.z = bounce;
+        vkCmdPushConstants(cmd, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT,
+                           0, sizeof(PTPushConstants), &stagePC);
+    };
+    auto bind = [&](Stage s) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelines[s]);
+    };
+
+    uint32_t groupsX = (mWidth  + 7) / 8;
+    uint32_t groupsY = (mHeight + 7) / 8;
+
+    push(0);
+    bind(Generate);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+    StageBarrier(cmd);
+
+    uint32_t maxBounces = pc.params.x;
+    for (uint32_t bounce = 0; bounce < maxBounces; bounce++) {
+        push(bounce);
+
+        bind(Extend);
+        vkCmdDispatchIndirect(cmd, counters, kExtendArgsOffset);
+        StageBarrier(cmd);
+
+        bind(Scan);
+        vkCmdDispatch(cmd, 1, 1, 1);
+        StageBarrier(cmd);
+
+        bind(Scatter);
+        vkCmdDispatchIndirect(cmd, counters, kShadeArgsOffset);
+        StageBarrier(cmd);
+
+        bind(Shade);
+        vkCmdDispatchIndirect(cmd, counters, kShadeArgsOffset);
+        StageBarrier(cmd);
+
+        bind(Args);
+        vkCmdDispatch(cmd, 1, 1, 1);
+        StageBarrier(cmd);
+
+        bind(Connect);
+        vkCmdDispatchIndirect(cmd, counters, kConnectArgsOffset);
+        StageBarrier(cmd);
+    }
+
+    bind(Resolve);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+}
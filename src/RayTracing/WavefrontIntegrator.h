@@ -0,0 +1,76 @@
+#pragma once
+
+#include "Resource/VulkanBuffer.h"
+#include "Resource/ShaderManager.h"
+#include "GPU/VertexFormat.h"
+
+#include <volk.h>
+#include <vk_mem_alloc.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+/// Push constants shared by the megakernel and the wavefront integrator.
+struct PTPushConstants {
+    glm::mat4  invViewProj;
+    glm::vec4  cameraPosAndFrame;   // w = low-discrepancy sequence index
+    glm::vec4  sunDirAndRadius;
+    glm::vec4  sunColorIntensity;
+    glm::uvec4 params;   // maxBounces, sample offset, MIS (megakernel) / bounce (wavefront), accumFrames
+};
+static_assert(sizeof(PTPushConstants) == 128, "PathTracer push constants must be 128 bytes");
+
+enum class PTIntegrator : int { Megakernel = 0, Wavefront = 1 };
+
+/// Compute + ray query path tracer split into generate / extend / shade / connect stages.
+/// Between bounces the hits are counting-sorted by material and terminated paths are
+/// dropped from the ray queue; queue sizes drive indirect dispatches, so the CPU never
+/// reads anything back. Uses the PathTracer's scene set (0) and bindless set (1).
+class WavefrontIntegrator {
+public:
+    void Initialize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height);
+    void Shutdown(VkDevice device, VmaAllocator allocator);
+    void Resize(VkDevice device, VmaAllocator allocator, uint32_t width, uint32_t height);
+
+    /// Sizes the material bins and (re)creates the pipelines against the scene layouts.
+    void UpdateScene(ShaderManager& shaders,
+                     VkDescriptorSetLayout sceneLayout,
+                     VkDescriptorSetLayout bindlessLayout,
+                     VertexFormat vertexFormat, VkDeviceSize materialBufferSize);
+
+    /// Records the whole frame. Images must already be in GENERAL and visible to compute.
+    void Dispatch(VkCommandBuffer cmd, VkDescriptorSet sceneSet, VkDescriptorSet bindlessSet,
+                  const PTPushConstants& pc);
+
+    bool IsReady() const { return mPipelines[0] != VK_NULL_HANDLE; }
+
+private:
+    enum Stage : uint32_t { Generate, Extend, Scan, Scatter, Shade, Args, Connect, Resolve, StageCount };
+
+    void CreateBuffers();
+    void DestroyBuffers();
+    void CreatePipelines(ShaderManager& shaders, VkDescriptorSetLayout sceneLayout,
+                         VkDescriptorSetLayout bindlessLayout, VertexFormat vertexFormat);
+    void DestroyPipelines();
+    void UpdateDescriptors();
+
+    VkDevice     mDevice    = VK_NULL_HANDLE;
+    VmaAllocator mAllocator = VK_NULL_HANDLE;
+    uint32_t     mWidth = 0, mHeight = 0;
+    uint32_t     mMaterialCount = 0;
+
+    VulkanBuffer mPathBuffer;      // PathState per pixel
+    VulkanBuffer mHitBuffer;       // HitRecord per path, appended by extend
+    VulkanBuffer mRayQueue;        // 2 x path count, ping-pong between bounces
+    VulkanBuffer mSortedQueue;     // hit indices ordered by material
+    VulkanBuffer mShadowBuffer;    // ShadowRay per path, appended by shade
+    VulkanBuffer mCounterBuffer;   // queue counts + indirect dispatch args
+    VulkanBuffer mMaterialBins;    // per-material counts then offsets
+
+    VkDescriptorSetLayout mDescLayout = VK_NULL_HANDLE;
+    VkDescriptorPool      mDescPool   = VK_NULL_HANDLE;
+    VkDescriptorSet       mDescSet    = VK_NULL_HANDLE;
+
+    VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline       mPipelines[StageCount] = {};
+    VertexFormat     mVertexFormat = VertexFormat::Float;
+};
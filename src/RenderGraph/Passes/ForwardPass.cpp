@@ -1,13 +1,20 @@
 #include "RenderGraph/Passes/ForwardPass.h"
 #include "RHI/VulkanUtils.h"
 #include "GPU/MeshPool.h"
+#include "GPU/InstanceBatcher.h"
+#include "GPU/ComputeCulling.h"
 
-#include <algorithm>
+#include <chrono>
+#include <cstddef>
 
+// Per batch; the world matrices come from the instance buffer
 struct PBRPushConstants {
-    glm::mat4 model;
     uint32_t  materialIndex;
+    uint32_t  _pad[3];
+    glm::vec4 aabbMin;      // dequantization box for packed vertices
+    glm::vec4 aabbMax;
 };
+static_assert(sizeof(PBRPushConstants) == 48, "PBR push constants must match pbr.vert");
 
 ForwardPass::ForwardPass(const Desc& desc)
     : RenderPass("Forward"), mDesc(desc) {}
@@ -99,7 +106,6 @@ void ForwardPass::Execute(VkCommandBuffer cmd) {
     VkBuffer vb[] = { mDesc.meshPool->GetVertexBuffer() };
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(cmd, 0, 1, vb, offsets);
-    vkCmdBindIndexBuffer(cmd, mDesc.meshPool->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
     if (mDesc.gpuDriven && mDesc.indirectPipeline != VK_NULL_HANDLE) {
         vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.indirectPipeline);
@@ -109,18 +115,39 @@ void ForwardPass::Execute(VkCommandBuffer cmd) {
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 mDesc.indirectPipelineLayout, 1, 1, &mDesc.frameDescSet, 0, nullptr);
 
-        const uint32_t stride = sizeof(VkDrawIndexedIndirectCommand);
-
-        vkCmdDrawIndexedIndirectCount(cmd,
-            mDesc.occluderBuffer, 0,
-            mDesc.occluderCountBuffer, 0,
-            mDesc.maxOccluderCount, stride);
+        mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+            mDesc.occluderBuffer, mDesc.occluderCountBuffer, mDesc.drawRanges);
+        if (mDesc.groupBuffer != VK_NULL_HANDLE)
+            mDesc.meshPool->DrawIndexedIndirect(cmd, mDesc.groupBuffer, mDesc.groupRanges);
 
         if (mDesc.occlusionEnabled) {
-            vkCmdDrawIndexedIndirectCount(cmd,
-                mDesc.visibleBuffer, 0,
-                mDesc.visibleCountBuffer, 0,
-                mDesc.maxVisibleCount, stride);
+            mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+                mDesc.visibleBuffer, mDesc.visibleCountBuffer, mDesc.drawRanges);
+            if (mDesc.groupBuffer != VK_NULL_HANDLE)
+                mDesc.meshPool->DrawIndexedIndirect(cmd, mDesc.groupBuffer, mDesc.groupRanges, mDesc.groupPhaseBase);
+        }
+
+        // Alpha-tested items after every opaque one, so only they give up early-Z
+        if (mDesc.indirectMaskedPipeline != VK_NULL_HANDLE) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.indirectMaskedPipeline);
+            mDesc.meshPool->DrawIndexedIndirectCount(cmd, mDesc.occluderBuffer, mDesc.occluderCountBuffer,
+                                                     mDesc.maskedRanges, ComputeCulling::MASKED_COUNT_OFFSET);
+            if (mDesc.groupBuffer != VK_NULL_HANDLE)
+                mDesc.meshPool->DrawIndexedIndirect(cmd, mDesc.groupBuffer, mDesc.maskedGroupRanges);
+            if (mDesc.occlusionEnabled) {
+                mDesc.meshPool->DrawIndexedIndirectCount(cmd, mDesc.visibleBuffer, mDesc.visibleCountBuffer,
+                                                         mDesc.maskedRanges, ComputeCulling::MASKED_COUNT_OFFSET);
+                if (mDesc.groupBuffer != VK_NULL_HANDLE)
+                    mDesc.meshPool->DrawIndexedIndirect(cmd, mDesc.groupBuffer, mDesc.maskedGroupRanges,
+                                                        mDesc.groupPhaseBase);
+            }
+        }
+
+        // Blended items last, sorted back to front per index class by the culling
+        if (mDesc.indirectBlendPipeline != VK_NULL_HANDLE) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.indirectBlendPipeline);
+            mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+                mDesc.transparentBuffer, mDesc.transparentCountBuffer, mDesc.drawRanges);
         }
     } else {
         vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.pipeline);
@@ -130,24 +157,65 @@ void ForwardPass::Execute(VkCommandBuffer cmd) {
         vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
                                 mDesc.pipelineLayout, 1, 1, &mDesc.frameDescSet, 0, nullptr);
 
-        const auto& drawCmds = mDesc.meshPool->GetDrawCommands();
+        VkDescriptorSet instanceSet = mDesc.instances->GetDescriptorSet();
+        vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                mDesc.pipelineLayout, 2, 1, &instanceSet, 0, nullptr);
 
-        mDesc.registry->ForEachRenderable([&](Entity, const TransformComponent& tc,
-                                              const MeshComponent& mc, const MaterialComponent& matc) {
-            if (mc.meshIndex < 0 || mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
-            int matIdx = std::clamp(matc.materialIndex, 0, static_cast<int>(mDesc.gpuMaterials->size()) - 1);
+        auto recordStart = std::chrono::steady_clock::now();
 
-            PBRPushConstants pc{};
-            pc.model         = tc.worldMatrix;
-            pc.materialIndex = static_cast<uint32_t>(matIdx);
+        // Batches arrive in draw-key order, so consecutive draws mostly share state:
+        // each part of the push block and the index buffer is only set when it changes
+        const auto& drawCmds = mDesc.meshPool->GetDrawCommands();
+        const VkShaderStageFlags pcStages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        DrawPass boundPass     = DrawPass::Opaque;
+        uint32_t boundClass    = INDEX_CLASS_COUNT;
+        uint32_t boundMaterial = UINT32_MAX;
+        uint32_t boundMesh     = UINT32_MAX;
+        DrawStateChanges changes{};
+        changes.pipelineBinds = 1;
+
+        for (const InstanceBatch& batch : mDesc.instances->GetForwardBatches()) {
+            const auto& poolCmd = drawCmds[batch.meshIndex];
+
+            // Passes come in order; the variants share the layout, so bound state survives
+            if (batch.pass != boundPass) {
+                VkPipeline pipeline = batch.pass == DrawPass::Masked ? mDesc.maskedPipeline
+                                    : batch.pass == DrawPass::Transparent ? mDesc.blendPipeline
+                                    : mDesc.pipeline;
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+                boundPass = batch.pass;
+                changes.pipelineBinds++;
+            }
 
-            vkCmdPushConstants(cmd, mDesc.pipelineLayout,
-                               VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
-                               0, static_cast<uint32_t>(sizeof(glm::mat4) + sizeof(uint32_t)), &pc);
+            PBRPushConstants pc{};
+            if (batch.materialIndex != boundMaterial) {
+                pc.materialIndex = batch.materialIndex;
+                vkCmdPushConstants(cmd, mDesc.pipelineLayout, pcStages,
+                                   offsetof(PBRPushConstants, materialIndex), 16, &pc.materialIndex);
+                boundMaterial = batch.materialIndex;
+                changes.materialPushes++;
+            }
+            if (batch.meshIndex != boundMesh) {
+                pc.aabbMin = glm::vec4(poolCmd.bounds.min, 0.0f);
+                pc.aabbMax = glm::vec4(poolCmd.bounds.max, 0.0f);
+                vkCmdPushConstants(cmd, mDesc.pipelineLayout, pcStages,
+                                   offsetof(PBRPushConstants, aabbMin), 2 * sizeof(glm::vec4), &pc.aabbMin);
+                boundMesh = batch.meshIndex;
+                changes.boundsPushes++;
+            }
+            if (poolCmd.indexClass != boundClass) {
+                mDesc.meshPool->BindIndexBuffer(cmd, poolCmd.indexClass);
+                boundClass = poolCmd.indexClass;
+                changes.indexBinds++;
+            }
+            const MeshLODRange& lod = poolCmd.lods[batch.lod];
+            vkCmdDrawIndexed(cmd, lod.indexCount, batch.instanceCount,
+                             lod.firstIndex, poolCmd.vertexOffset, batch.firstInstance);
+        }
 
-            const auto& poolCmd = drawCmds[mc.meshIndex];
-            vkCmdDrawIndexed(cmd, poolCmd.indexCount, 1, poolCmd.firstIndex, poolCmd.vertexOffset, 0);
-        });
+        mDesc.instances->AddStateChanges(changes, false);
+        mDesc.instances->AddRecordTime(std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - recordStart).count());
     }
     vkCmdEndRendering(cmd);
 }
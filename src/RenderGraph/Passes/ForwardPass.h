@@ -2,6 +2,7 @@
 
 #include "RenderGraph/RenderPass.h"
 #include "RenderGraph/RenderGraph.h"
+#include "GPU/MeshPool.h"
 #include "Scene/ECS.h"
 #include "Scene/Scene.h"
 
@@ -10,7 +11,7 @@
 #include <vector>
 
 class DescriptorManager;
-class MeshPool;
+class InstanceBatcher;
 
 class ForwardPass : public RenderPass {
 public:
@@ -24,6 +25,8 @@ public:
         VkImageView             depthView;
         VkPipeline              pipeline;
         VkPipelineLayout        pipelineLayout;
+        VkPipeline              maskedPipeline       = VK_NULL_HANDLE;   // CPU path: per DrawPass of the batches
+        VkPipeline              blendPipeline        = VK_NULL_HANDLE;
 
         VkSampleCountFlagBits   msaaSamples          = VK_SAMPLE_COUNT_1_BIT;
         VkImage                 msaaColorImage       = VK_NULL_HANDLE;
@@ -35,21 +38,28 @@ public:
         VkImageView             resolveDepthView     = VK_NULL_HANDLE;
         VkDescriptorSet         bindlessSet;
         VkDescriptorSet         frameDescSet;
-        const Registry*         registry;
         const MeshPool*         meshPool             = nullptr;
-        const std::vector<GPUMaterialData>* gpuMaterials;
+        InstanceBatcher*        instances            = nullptr;   // CPU path: this frame's batches
 
         bool                    gpuDriven            = false;
         bool                    occlusionEnabled     = false;
         VkPipeline              indirectPipeline     = VK_NULL_HANDLE;
         VkPipelineLayout        indirectPipelineLayout = VK_NULL_HANDLE;
+        VkPipeline              indirectMaskedPipeline = VK_NULL_HANDLE;   // null: no masked materials, skip
+        VkPipeline              indirectBlendPipeline  = VK_NULL_HANDLE;   // null: no blended materials, skip
 
         VkBuffer                occluderBuffer       = VK_NULL_HANDLE;
         VkBuffer                occluderCountBuffer  = VK_NULL_HANDLE;
-        uint32_t                maxOccluderCount     = 0;
         VkBuffer                visibleBuffer        = VK_NULL_HANDLE;
         VkBuffer                visibleCountBuffer   = VK_NULL_HANDLE;
-        uint32_t                maxVisibleCount      = 0;
+        IndexClassRanges        drawRanges;          // index-class split shared by both lists
+        IndexClassRanges        maskedRanges;        // the masked halves of both lists
+        VkBuffer                transparentBuffer      = VK_NULL_HANDLE;   // back to front, split like drawRanges
+        VkBuffer                transparentCountBuffer = VK_NULL_HANDLE;
+        VkBuffer                groupBuffer          = VK_NULL_HANDLE;   // instanced group draws; null: none
+        IndexClassRanges        groupRanges;         // phase one's opaque group commands
+        IndexClassRanges        maskedGroupRanges;
+        uint32_t                groupPhaseBase       = 0;   // phase two's follow this many commands on
 
         PassHandle              occlusionTestPassHandle = UINT32_MAX;
         PassHandle              frustumCullPassHandle   = UINT32_MAX;
@@ -2,7 +2,7 @@
 #include "GPU/HiZBuffer.h"
 
 HiZBuildPass::HiZBuildPass(const Desc& desc)
-    : RenderPass("HiZBuild"), mDesc(desc) {}
+    : RenderPass(desc.hiZ->UsesSinglePass() ? "HiZBuild (single pass)" : "HiZBuild (per mip)"), mDesc(desc) {}
 
 void HiZBuildPass::Setup(RenderGraph& graph, PassHandle self) {
     graph.Read(self, mDesc.depthResource, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
@@ -43,12 +43,22 @@ void OccluderDepthPass::Execute(VkCommandBuffer cmd) {
     VkBuffer vb[] = { mDesc.meshPool->GetVertexBuffer() };
     VkDeviceSize offsets[] = { 0 };
     vkCmdBindVertexBuffers(cmd, 0, 1, vb, offsets);
-    vkCmdBindIndexBuffer(cmd, mDesc.meshPool->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-    vkCmdDrawIndexedIndirectCount(cmd,
-        mDesc.culling->GetOccluderIndirectBuffer(), 0,
-        mDesc.culling->GetOccluderCountBuffer(), 0,
-        mDesc.maxDrawCount, sizeof(VkDrawIndexedIndirectCommand));
+    mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+        mDesc.culling->GetOccluderIndirectBuffer(),
+        mDesc.culling->GetOccluderCountBuffer(), mDesc.drawRanges);
+    if (mDesc.groupBuffer != VK_NULL_HANDLE)
+        mDesc.meshPool->DrawIndexedIndirect(cmd, mDesc.groupBuffer, mDesc.groupRanges);
+
+    // Masked occluders alpha-test so cutouts stay open in the depth and the Hi-Z
+    if (mDesc.maskedPipeline != VK_NULL_HANDLE) {
+        vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.maskedPipeline);
+        mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+            mDesc.culling->GetOccluderIndirectBuffer(),
+            mDesc.culling->GetOccluderCountBuffer(), mDesc.maskedRanges, ComputeCulling::MASKED_COUNT_OFFSET);
+        if (mDesc.groupBuffer != VK_NULL_HANDLE)
+            mDesc.meshPool->DrawIndexedIndirect(cmd, mDesc.groupBuffer, mDesc.maskedGroupRanges);
+    }
 
     vkCmdEndRendering(cmd);
 }
@@ -2,11 +2,11 @@
 
 #include "RenderGraph/RenderPass.h"
 #include "RenderGraph/RenderGraph.h"
+#include "GPU/MeshPool.h"
 
 #include <volk.h>
 
 class ComputeCulling;
-class MeshPool;
 
 class OccluderDepthPass : public RenderPass {
 public:
@@ -19,12 +19,17 @@ public:
         VkExtent2D              extent;
         VkImageView             depthView;
         VkPipeline              pipeline;
+        VkPipeline              maskedPipeline = VK_NULL_HANDLE;   // alpha-tested; null: no masked materials
         VkPipelineLayout        pipelineLayout;
         VkDescriptorSet         bindlessSet;
         VkDescriptorSet         frameDescSet;
         const MeshPool*         meshPool;
         const ComputeCulling*   culling;
-        uint32_t                maxDrawCount;
+        IndexClassRanges        drawRanges;
+        IndexClassRanges        maskedRanges;   // the occluder list's masked half
+        VkBuffer                groupBuffer = VK_NULL_HANDLE;   // phase one's instanced group draws; null: none
+        IndexClassRanges        groupRanges;
+        IndexClassRanges        maskedGroupRanges;
     };
 
     explicit OccluderDepthPass(const Desc& desc);
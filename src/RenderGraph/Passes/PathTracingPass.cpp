@@ -26,9 +26,9 @@ void PathTracingPass::Execute(VkCommandBuffer cmd) {
         if (cameraMoved)
             mDesc.denoiser->InvalidateHistory();
 
-        // Synchronize RT writes → Compute reads
+        // Synchronize RT (or wavefront compute) writes → Compute reads
         VkMemoryBarrier2 rtToCompute{VK_STRUCTURE_TYPE_MEMORY_BARRIER_2};
-        rtToCompute.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR;
+        rtToCompute.srcStageMask  = VK_PIPELINE_STAGE_2_RAY_TRACING_SHADER_BIT_KHR | VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
         rtToCompute.srcAccessMask = VK_ACCESS_2_SHADER_WRITE_BIT;
         rtToCompute.dstStageMask  = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
         rtToCompute.dstAccessMask = VK_ACCESS_2_SHADER_READ_BIT;
@@ -1,5 +1,7 @@
 #include "RenderGraph/Passes/RayTracingPass.h"
 
+#include <string>
+
 RayTracingPass::RayTracingPass(const Desc& desc)
     : RenderPass("RayTracing"), mDesc(desc) {}
 
@@ -13,27 +15,57 @@ void RayTracingPass::Setup(RenderGraph& graph, PassHandle self) {
     graph.DependsOn(self, mDesc.colorResource, mDesc.forwardPassHandle);
 }
 
+void RayTracingPass::BeginScope(VkCommandBuffer cmd, const char* name) {
+    if (mDesc.profiler) mDesc.profiler->BeginScope(cmd, mDesc.frameIndex, name);
+}
+
+void RayTracingPass::EndScope(VkCommandBuffer cmd) {
+    if (mDesc.profiler) mDesc.profiler->EndScope(cmd, mDesc.frameIndex);
+}
+
 void RayTracingPass::Execute(VkCommandBuffer cmd) {
     auto tlas = mDesc.accel->GetTLAS();
     if (tlas == VK_NULL_HANDLE) return;
 
     if (mDesc.shadows && mDesc.shadows->IsEnabled()) {
+        RTTraceMode mode = mDesc.shadows->GetTraceMode();
+        BeginScope(cmd, (std::string("RT Shadows Trace (") + RTTraceModeName(mode) + ")").c_str());
         mDesc.shadows->Dispatch(cmd, tlas,
             mDesc.depthView, mDesc.depthSampler,
             mDesc.invViewProj,
             mDesc.lightDir, mDesc.lightRadius,
             mDesc.cameraPos);
+        EndScope(cmd);
 
+        BeginScope(cmd, "RT Shadows Denoise");
         mDesc.shadows->Denoise(cmd, mDesc.depthView, mDesc.depthSampler, mDesc.invViewProj);
+        EndScope(cmd);
+
+        if (mode != RTTraceMode::Full) {
+            BeginScope(cmd, "RT Shadows Upsample");
+            mDesc.shadows->Upsample(cmd, mDesc.invViewProj);
+            EndScope(cmd);
+        }
     }
 
     if (mDesc.reflections && mDesc.reflections->IsEnabled()) {
+        RTTraceMode mode = mDesc.reflections->GetTraceMode();
+        BeginScope(cmd, (std::string("RT Reflections Trace (") + RTTraceModeName(mode) + ")").c_str());
         mDesc.reflections->Dispatch(cmd, tlas,
             mDesc.depthView, mDesc.depthSampler,
             mDesc.invViewProj,
             mDesc.cameraPos, mDesc.roughness);
+        EndScope(cmd);
 
+        BeginScope(cmd, "RT Reflections Denoise");
         mDesc.reflections->Denoise(cmd, mDesc.depthView, mDesc.depthSampler, mDesc.invViewProj);
+        EndScope(cmd);
+
+        if (mode != RTTraceMode::Full) {
+            BeginScope(cmd, "RT Reflections Upsample");
+            mDesc.reflections->Upsample(cmd, mDesc.invViewProj);
+            EndScope(cmd);
+        }
     }
 
     // Composite RT results into HDR
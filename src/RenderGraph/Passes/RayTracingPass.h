@@ -5,6 +5,7 @@
 #include "RayTracing/AccelStructure.h"
 #include "RayTracing/RTShadows.h"
 #include "RayTracing/RTReflections.h"
+#include "VisualUI/GPUProfiler.h"
 
 #include <volk.h>
 #include <glm/glm.hpp>
@@ -20,6 +21,10 @@ public:
         RTReflections*  reflections = nullptr;
         AccelStructure* accel       = nullptr;
 
+        // Optional per-stage timings (trace / denoise / upsample) nested in the pass scope
+        GPUProfiler*    profiler    = nullptr;
+        uint32_t        frameIndex  = 0;
+
         VkImageView depthView   = VK_NULL_HANDLE;
         VkSampler   depthSampler = VK_NULL_HANDLE;
         VkExtent2D  extent;
@@ -46,5 +51,8 @@ public:
     void Execute(VkCommandBuffer cmd) override;
 
 private:
+    void BeginScope(VkCommandBuffer cmd, const char* name);
+    void EndScope(VkCommandBuffer cmd);
+
     Desc mDesc;
 };
@@ -0,0 +1,11 @@
+#include "RenderGraph/Passes/ShadowCullPass.h"
+#include "GPU/ComputeCulling.h"
+
+ShadowCullPass::ShadowCullPass(const Desc& desc)
+    : RenderPass("ShadowCull"), mDesc(desc) {}
+
+void ShadowCullPass::Setup(RenderGraph&, PassHandle) {}
+
+void ShadowCullPass::Execute(VkCommandBuffer cmd) {
+    mDesc.culling->DispatchShadow(cmd, *mDesc.params);
+}
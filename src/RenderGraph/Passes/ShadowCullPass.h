@@ -0,0 +1,22 @@
+#pragma once
+
+#include "RenderGraph/RenderPass.h"
+
+class ComputeCulling;
+struct ShadowCullParams;
+
+class ShadowCullPass : public RenderPass {
+public:
+    struct Desc {
+        const ComputeCulling*   culling = nullptr;
+        const ShadowCullParams* params  = nullptr;
+    };
+
+    explicit ShadowCullPass(const Desc& desc);
+
+    void Setup(RenderGraph& graph, PassHandle self) override;
+    void Execute(VkCommandBuffer cmd) override;
+
+private:
+    Desc mDesc;
+};
@@ -1,5 +1,17 @@
 #include "RenderGraph/Passes/ShadowPass.h"
 #include "GPU/MeshPool.h"
+#include "GPU/InstanceBatcher.h"
+
+#include <chrono>
+#include <cstddef>
+
+// CPU path, per batch; the world matrices come from the instance buffer
+struct ShadowPushConstants {
+    glm::mat4 cascadeViewProj;
+    glm::vec4 aabbMin;      // dequantization box for packed vertices
+    glm::vec4 aabbMax;
+};
+static_assert(sizeof(ShadowPushConstants) == 96, "Shadow push constants must match shadow.vert");
 
 ShadowPass::ShadowPass(const Desc& desc)
     : RenderPass("Shadow"), mDesc(desc) {}
@@ -9,6 +21,8 @@ void ShadowPass::Setup(RenderGraph& graph, PassHandle self) {
     graph.Write(self, mDesc.csmResource, VK_IMAGE_LAYOUT_DEPTH_ATTACHMENT_OPTIMAL,
                 VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT,
                 VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT);
+    if (mDesc.cascadeCulled)
+        graph.DependsOn(self, mDesc.csmResource, mDesc.shadowCullPassHandle);
 }
 
 void ShadowPass::Execute(VkCommandBuffer cmd) {
@@ -17,6 +31,8 @@ void ShadowPass::Execute(VkCommandBuffer cmd) {
     constexpr uint32_t SD = CascadedShadowMap::SHADOW_DIM;
     constexpr uint32_t CC = CascadedShadowMap::CASCADE_COUNT;
 
+    const bool indirect = mDesc.gpuDriven && mDesc.indirectPipeline != VK_NULL_HANDLE;
+
     for (uint32_t cascade = 0; cascade < CC; cascade++) {
         VkRenderingAttachmentInfo depthAtt{};
         depthAtt.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
@@ -41,9 +57,8 @@ void ShadowPass::Execute(VkCommandBuffer cmd) {
         VkBuffer vb[] = { mDesc.meshPool->GetVertexBuffer() };
         VkDeviceSize offsets[] = { 0 };
         vkCmdBindVertexBuffers(cmd, 0, 1, vb, offsets);
-        vkCmdBindIndexBuffer(cmd, mDesc.meshPool->GetIndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
 
-        if (mDesc.gpuDriven && mDesc.indirectPipeline != VK_NULL_HANDLE) {
+        if (indirect) {
             vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.indirectPipeline);
 
             vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
@@ -55,25 +70,63 @@ void ShadowPass::Execute(VkCommandBuffer cmd) {
                                VK_SHADER_STAGE_VERTEX_BIT,
                                0, sizeof(glm::mat4), &cascadeVP);
 
-            vkCmdDrawIndexedIndirectCount(cmd,
-                mDesc.indirectBuffer, 0,
-                mDesc.countBuffer, 0,
-                mDesc.maxDrawCount,
-                sizeof(VkDrawIndexedIndirectCommand));
+            if (mDesc.cascadeCulled) {
+                IndexClassRanges ranges = mDesc.drawRanges;
+                for (uint32_t cls = 0; cls < INDEX_CLASS_COUNT; cls++)
+                    ranges.first[cls] += cascade * mDesc.cascadeListStride;
+                mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+                    mDesc.indirectBuffer, mDesc.countBuffer, ranges,
+                    cascade * mDesc.cascadeCountStride);
+            } else {
+                mDesc.meshPool->DrawIndexedIndirectCount(cmd,
+                    mDesc.indirectBuffer, mDesc.countBuffer, mDesc.drawRanges);
+            }
         } else {
             vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, mDesc.pipeline);
 
-            const auto& drawCmds = mDesc.meshPool->GetDrawCommands();
-
-            mDesc.registry->ForEachRenderable([&](Entity, const TransformComponent& tc,
-                                                  const MeshComponent& mc, const MaterialComponent&) {
-                if (mc.meshIndex < 0 || mc.meshIndex >= static_cast<int>(drawCmds.size())) return;
-                glm::mat4 mvp = mDesc.csm->GetViewProj(cascade) * tc.worldMatrix;
-                vkCmdPushConstants(cmd, mDesc.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
-                                   0, sizeof(glm::mat4), &mvp);
-                const auto& poolCmd = drawCmds[mc.meshIndex];
-                vkCmdDrawIndexed(cmd, poolCmd.indexCount, 1, poolCmd.firstIndex, poolCmd.vertexOffset, 0);
-            });
+            VkDescriptorSet instanceSet = mDesc.instances->GetDescriptorSet();
+            vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    mDesc.pipelineLayout, 0, 1, &instanceSet, 0, nullptr);
+
+            auto recordStart = std::chrono::steady_clock::now();
+
+            const auto& drawCmds   = mDesc.meshPool->GetDrawCommands();
+            uint32_t    boundClass = INDEX_CLASS_COUNT;
+            uint32_t    boundMesh  = UINT32_MAX;
+
+            // The cascade matrix once, then the bounds only when the mesh changes
+            ShadowPushConstants pc{};
+            pc.cascadeViewProj = mDesc.csm->GetViewProj(cascade);
+            vkCmdPushConstants(cmd, mDesc.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                               offsetof(ShadowPushConstants, cascadeViewProj), sizeof(glm::mat4),
+                               &pc.cascadeViewProj);
+            DrawStateChanges changes{};
+            changes.pipelineBinds  = 1;
+            changes.materialPushes = 1;
+
+            for (const InstanceBatch& batch : mDesc.instances->GetShadowBatches(cascade)) {
+                const auto& poolCmd = drawCmds[batch.meshIndex];
+                if (batch.meshIndex != boundMesh) {
+                    pc.aabbMin = glm::vec4(poolCmd.bounds.min, 0.0f);
+                    pc.aabbMax = glm::vec4(poolCmd.bounds.max, 0.0f);
+                    vkCmdPushConstants(cmd, mDesc.pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT,
+                                       offsetof(ShadowPushConstants, aabbMin), 2 * sizeof(glm::vec4),
+                                       &pc.aabbMin);
+                    boundMesh = batch.meshIndex;
+                    changes.boundsPushes++;
+                }
+                if (poolCmd.indexClass != boundClass) {
+                    mDesc.meshPool->BindIndexBuffer(cmd, poolCmd.indexClass);
+                    boundClass = poolCmd.indexClass;
+                    changes.indexBinds++;
+                }
+                vkCmdDrawIndexed(cmd, poolCmd.indexCount, batch.instanceCount,
+                                 poolCmd.firstIndex, poolCmd.vertexOffset, batch.firstInstance);
+            }
+
+            mDesc.instances->AddStateChanges(changes, true);
+            mDesc.instances->AddRecordTime(std::chrono::duration<double, std::milli>(
+                std::chrono::steady_clock::now() - recordStart).count());
         }
         vkCmdEndRendering(cmd);
     }
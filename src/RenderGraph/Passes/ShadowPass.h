@@ -3,13 +3,14 @@
 #include "RenderGraph/RenderPass.h"
 #include "RenderGraph/RenderGraph.h"
 #include "Lighting/CascadedShadowMap.h"
+#include "GPU/MeshPool.h"
 #include "Scene/ECS.h"
 
 #include <volk.h>
 #include <glm/glm.hpp>
 #include <vector>
 
-class MeshPool;
+class InstanceBatcher;
 
 class ShadowPass : public RenderPass {
 public:
@@ -18,9 +19,11 @@ public:
         const CascadedShadowMap* csm;
         VkPipeline             pipeline;
         VkPipelineLayout       pipelineLayout;
-        const Registry*        registry;
         const MeshPool*        meshPool                   = nullptr;
 
+        // CPU path: per-cascade batches built from the scene BVH's caster masks
+        InstanceBatcher*       instances                  = nullptr;
+
         bool                   skip                       = false;
         bool                   gpuDriven                  = false;
         VkPipeline             indirectPipeline           = VK_NULL_HANDLE;
@@ -28,7 +31,14 @@ public:
         VkDescriptorSet        indirectDescSet            = VK_NULL_HANDLE;
         VkBuffer               indirectBuffer             = VK_NULL_HANDLE;
         VkBuffer               countBuffer                = VK_NULL_HANDLE;
-        uint32_t               maxDrawCount               = 0;
+        IndexClassRanges       drawRanges;
+
+        // Per-cascade culled lists (ShadowCullPass). Cascade c draws drawRanges shifted
+        // by c * cascadeListStride, with counts at c * cascadeCountStride.
+        bool                   cascadeCulled              = false;
+        PassHandle             shadowCullPassHandle       = UINT32_MAX;
+        uint32_t               cascadeListStride          = 0;
+        VkDeviceSize           cascadeCountStride         = 0;
     };
 
     explicit ShadowPass(const Desc& desc);
@@ -26,7 +26,8 @@ void DescriptorManager::Initialize(VkDevice device) {
     binding.descriptorCount = MAX_TEXTURES;
     binding.stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT
                               | VK_SHADER_STAGE_CLOSEST_HIT_BIT_KHR
-                              | VK_SHADER_STAGE_ANY_HIT_BIT_KHR;
+                              | VK_SHADER_STAGE_ANY_HIT_BIT_KHR
+                              | VK_SHADER_STAGE_COMPUTE_BIT;
 
     VkDescriptorBindingFlags bindingFlags =
         VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
@@ -1,33 +1,99 @@
 #include "Resource/TransferManager.h"
+#include "RHI/VulkanUtils.h"
 #include "Core/Logger.h"
 
-void TransferManager::Initialize(VkDevice device, uint32_t queueFamily, VkQueue queue) {
-    mDevice = device;
-    mQueue  = queue;
+#include <algorithm>
+#include <cstring>
+
+static VkDeviceSize AlignUp(VkDeviceSize v, VkDeviceSize a) {
+    return (v + a - 1) & ~(a - 1);
+}
+
+void TransferManager::Initialize(VkDevice device, VmaAllocator allocator,
+                                 uint32_t transferFamily, VkQueue transferQueue,
+                                 uint32_t graphicsFamily, VkQueue graphicsQueue) {
+    mDevice         = device;
+    mAllocator      = allocator;
+    mTransferFamily = transferFamily;
+    mTransferQueue  = transferQueue;
+    mGraphicsFamily = graphicsFamily;
+    mGraphicsQueue  = graphicsQueue;
 
     VkCommandPoolCreateInfo poolInfo{};
     poolInfo.sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
     poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
-    poolInfo.queueFamilyIndex = queueFamily;
+    poolInfo.queueFamilyIndex = graphicsFamily;
     VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &mCommandPool));
 
+    poolInfo.flags            = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT |
+                                VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = transferFamily;
+    VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &mTransferPool));
+    if (Separate()) {
+        poolInfo.queueFamilyIndex = graphicsFamily;
+        VK_CHECK(vkCreateCommandPool(device, &poolInfo, nullptr, &mGraphicsPool));
+    }
+
     VkFenceCreateInfo fenceInfo{};
     fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
     VK_CHECK(vkCreateFence(device, &fenceInfo, nullptr, &mFence));
 
-    LOG_INFO("TransferManager initialized");
+    VkSemaphoreTypeCreateInfo typeInfo{VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO};
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue  = 0;
+    VkSemaphoreCreateInfo semInfo{VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO};
+    semInfo.pNext = &typeInfo;
+    VK_CHECK(vkCreateSemaphore(device, &semInfo, nullptr, &mTimeline));
+
+    // --- persistently mapped staging ring ---
+    VkBufferCreateInfo bufInfo{};
+    bufInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufInfo.size  = RING_SIZE;
+    bufInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+
+    VmaAllocationCreateInfo allocInfo{};
+    allocInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    allocInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                      VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo info{};
+    VK_CHECK(vmaCreateBuffer(allocator, &bufInfo, &allocInfo, &mRing, &mRingAlloc, &info));
+    mRingData = static_cast<uint8_t*>(info.pMappedData);
+
+    LOG_INFO("TransferManager initialized ({} MB staging ring, {} queue)",
+             RING_SIZE / (1024 * 1024), Separate() ? "dedicated transfer" : "graphics");
 }
 
 void TransferManager::Shutdown() {
     if (mDevice == VK_NULL_HANDLE) return;
-    if (mFence)       vkDestroyFence(mDevice, mFence, nullptr);
-    if (mCommandPool) vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
-    mFence       = VK_NULL_HANDLE;
-    mCommandPool = VK_NULL_HANDLE;
+    WaitIdle();
+
+    if (mRing)         vmaDestroyBuffer(mAllocator, mRing, mRingAlloc);
+    if (mTimeline)     vkDestroySemaphore(mDevice, mTimeline, nullptr);
+    if (mFence)        vkDestroyFence(mDevice, mFence, nullptr);
+    if (mGraphicsPool) vkDestroyCommandPool(mDevice, mGraphicsPool, nullptr);
+    if (mTransferPool) vkDestroyCommandPool(mDevice, mTransferPool, nullptr);
+    if (mCommandPool)  vkDestroyCommandPool(mDevice, mCommandPool, nullptr);
+    mRing         = VK_NULL_HANDLE;
+    mRingAlloc    = VK_NULL_HANDLE;
+    mRingData     = nullptr;
+    mTimeline     = VK_NULL_HANDLE;
+    mFence        = VK_NULL_HANDLE;
+    mGraphicsPool = VK_NULL_HANDLE;
+    mTransferPool = VK_NULL_HANDLE;
+    mCommandPool  = VK_NULL_HANDLE;
+    mInFlight.clear();
+    mFreeBatches.clear();
+    mRegions.clear();
     LOG_INFO("TransferManager destroyed");
 }
 
-void TransferManager::ImmediateSubmit(std::function<void(VkCommandBuffer)> fn) const {
+// ---------------------------------------------------------------------------
+// Immediate (blocking) submission
+// ---------------------------------------------------------------------------
+void TransferManager::ImmediateSubmit(std::function<void(VkCommandBuffer)> fn) {
+    UploadToken pending = Flush();
+
     VkCommandBufferAllocateInfo allocInfo{};
     allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
     allocInfo.commandPool        = mCommandPool;
@@ -46,13 +112,332 @@ void TransferManager::ImmediateSubmit(std::function<void(VkCommandBuffer)> fn) c
 
     VK_CHECK(vkEndCommandBuffer(cmd));
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType              = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers    = &cmd;
+    VkCommandBufferSubmitInfo cmdInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    cmdInfo.commandBuffer = cmd;
 
-    VK_CHECK(vkQueueSubmit(mQueue, 1, &submitInfo, mFence));
+    VkSemaphoreSubmitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    waitInfo.semaphore = mTimeline;
+    waitInfo.value     = pending;
+    waitInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo2 submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submitInfo.waitSemaphoreInfoCount = pending > 0 ? 1u : 0u;
+    submitInfo.pWaitSemaphoreInfos    = &waitInfo;
+    submitInfo.commandBufferInfoCount = 1;
+    submitInfo.pCommandBufferInfos    = &cmdInfo;
+
+    VK_CHECK(vkQueueSubmit2(mGraphicsQueue, 1, &submitInfo, mFence));
     VK_CHECK(vkWaitForFences(mDevice, 1, &mFence, VK_TRUE, UINT64_MAX));
     VK_CHECK(vkResetFences(mDevice, 1, &mFence));
     vkResetCommandPool(mDevice, mCommandPool, 0);
+    Reclaim();
+}
+
+// ---------------------------------------------------------------------------
+// Staging ring
+// ---------------------------------------------------------------------------
+bool TransferManager::TryAllocate(VkDeviceSize size, VkDeviceSize& offset) {
+    if (mRingUsed == 0) mRingHead = mRingTail = 0;
+    if (mRingUsed > 0 && mRingHead == mRingTail) return false;
+
+    VkDeviceSize waste = 0;
+    if (mRingHead >= mRingTail) {
+        if (RING_SIZE - mRingHead >= size) {
+            offset = mRingHead;
+        } else if (mRingTail >= size) {
+            waste  = RING_SIZE - mRingHead;
+            offset = 0;
+        } else {
+            return false;
+        }
+    } else {
+        if (mRingTail - mRingHead < size) return false;
+        offset = mRingHead;
+    }
+
+    // Regions are tagged with the token of the batch their copy will be recorded into
+    UploadToken token = mBatchOpen ? mBatch.token : mSubmittedValue + (Separate() ? 2 : 1);
+
+    mRingHead  = offset + size;
+    mRingUsed += size + waste;
+    mRegions.push_back({mRingHead, size + waste, token});
+    return true;
+}
+
+VkDeviceSize TransferManager::AllocateStaging(VkDeviceSize size) {
+    size = AlignUp(size, RING_ALIGNMENT);
+    VkDeviceSize offset = 0;
+    for (;;) {
+        if (TryAllocate(size, offset)) return offset;
+        Reclaim();
+        if (TryAllocate(size, offset)) return offset;
+
+        // Ring is full of in-flight data: submit what we have and wait for the oldest region
+        mStats.ringStalls++;
+        if (mBatchOpen) Flush();
+        Wait(mRegions.front().token);
+    }
+}
+
+void TransferManager::Reclaim() {
+    uint64_t completed = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mTimeline, &completed));
+
+    while (!mRegions.empty() && mRegions.front().token <= completed) {
+        mRingTail  = mRegions.front().end;
+        mRingUsed -= mRegions.front().bytes;
+        mRegions.pop_front();
+    }
+    while (!mInFlight.empty() && mInFlight.front().token <= completed) {
+        mFreeBatches.push_back(mInFlight.front());
+        mInFlight.pop_front();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Batching
+// ---------------------------------------------------------------------------
+void TransferManager::BeginBatch() {
+    if (!mFreeBatches.empty()) {
+        mBatch = mFreeBatches.back();
+        mFreeBatches.pop_back();
+        VK_CHECK(vkResetCommandBuffer(mBatch.transferCmd, 0));
+        if (Separate()) VK_CHECK(vkResetCommandBuffer(mBatch.graphicsCmd, 0));
+    } else {
+        mBatch = {};
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool        = mTransferPool;
+        allocInfo.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(mDevice, &allocInfo, &mBatch.transferCmd));
+        if (Separate()) {
+            allocInfo.commandPool = mGraphicsPool;
+            VK_CHECK(vkAllocateCommandBuffers(mDevice, &allocInfo, &mBatch.graphicsCmd));
+        }
+    }
+    if (!Separate()) mBatch.graphicsCmd = mBatch.transferCmd;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(mBatch.transferCmd, &beginInfo));
+    if (Separate()) VK_CHECK(vkBeginCommandBuffer(mBatch.graphicsCmd, &beginInfo));
+
+    // With a dedicated transfer queue each batch signals twice: the copy on the
+    // transfer queue, then the ownership acquire on the graphics queue.
+    mBatch.token = mSubmittedValue + (Separate() ? 2 : 1);
+    mBatchOpen   = true;
+}
+
+UploadToken TransferManager::Flush() {
+    if (!mBatchOpen) return mSubmittedValue;
+
+    VK_CHECK(vkEndCommandBuffer(mBatch.transferCmd));
+
+    VkCommandBufferSubmitInfo cmdInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+    cmdInfo.commandBuffer = mBatch.transferCmd;
+
+    VkSemaphoreSubmitInfo signalInfo{VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO};
+    signalInfo.semaphore = mTimeline;
+    signalInfo.value     = Separate() ? mBatch.token - 1 : mBatch.token;
+    signalInfo.stageMask = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+
+    VkSubmitInfo2 submitInfo{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+    submitInfo.commandBufferInfoCount   = 1;
+    submitInfo.pCommandBufferInfos      = &cmdInfo;
+    submitInfo.signalSemaphoreInfoCount = 1;
+    submitInfo.pSignalSemaphoreInfos    = &signalInfo;
+    VK_CHECK(vkQueueSubmit2(mTransferQueue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    if (Separate()) {
+        VK_CHECK(vkEndCommandBuffer(mBatch.graphicsCmd));
+
+        VkCommandBufferSubmitInfo gfxCmdInfo{VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO};
+        gfxCmdInfo.commandBuffer = mBatch.graphicsCmd;
+
+        VkSemaphoreSubmitInfo waitInfo = signalInfo;
+        VkSemaphoreSubmitInfo gfxSignalInfo = signalInfo;
+        gfxSignalInfo.value = mBatch.token;
+
+        VkSubmitInfo2 gfxSubmit{VK_STRUCTURE_TYPE_SUBMIT_INFO_2};
+        gfxSubmit.waitSemaphoreInfoCount   = 1;
+        gfxSubmit.pWaitSemaphoreInfos      = &waitInfo;
+        gfxSubmit.commandBufferInfoCount   = 1;
+        gfxSubmit.pCommandBufferInfos      = &gfxCmdInfo;
+        gfxSubmit.signalSemaphoreInfoCount = 1;
+        gfxSubmit.pSignalSemaphoreInfos    = &gfxSignalInfo;
+        VK_CHECK(vkQueueSubmit2(mGraphicsQueue, 1, &gfxSubmit, VK_NULL_HANDLE));
+    }
+
+    mSubmittedValue = mBatch.token;
+    mInFlight.push_back(mBatch);
+    mBatch     = {};
+    mBatchOpen = false;
+    mStats.submits++;
+    return mSubmittedValue;
+}
+
+bool TransferManager::IsComplete(UploadToken token) const {
+    uint64_t completed = 0;
+    VK_CHECK(vkGetSemaphoreCounterValue(mDevice, mTimeline, &completed));
+    return completed >= token;
+}
+
+void TransferManager::Wait(UploadToken token) {
+    if (mBatchOpen && token >= mBatch.token) Flush();
+    if (token == 0) return;
+
+    VkSemaphoreWaitInfo waitInfo{VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO};
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores    = &mTimeline;
+    waitInfo.pValues        = &token;
+    VK_CHECK(vkWaitSemaphores(mDevice, &waitInfo, UINT64_MAX));
+    Reclaim();
+}
+
+void TransferManager::WaitIdle() {
+    Wait(Flush());
+}
+
+// ---------------------------------------------------------------------------
+// Uploads
+// ---------------------------------------------------------------------------
+UploadToken TransferManager::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset,
+                                          const void* data, VkDeviceSize size) {
+    if (size == 0) return mSubmittedValue;
+    TouchStats();
+    const auto* src = static_cast<const uint8_t*>(data);
+
+    for (VkDeviceSize done = 0; done < size;) {
+        VkDeviceSize chunk  = std::min(size - done, RING_SIZE);
+        VkDeviceSize offset = AllocateStaging(chunk);
+        std::memcpy(mRingData + offset, src + done, static_cast<size_t>(chunk));
+        vmaFlushAllocation(mAllocator, mRingAlloc, offset, chunk);
+        if (!mBatchOpen) BeginBatch();
+
+        VkBufferCopy region{};
+        region.srcOffset = offset;
+        region.dstOffset = dstOffset + done;
+        region.size      = chunk;
+        vkCmdCopyBuffer(mBatch.transferCmd, mRing, dst, 1, &region);
+        done += chunk;
+    }
+
+    if (Separate()) {
+        VkBufferMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+        barrier.srcQueueFamilyIndex = mTransferFamily;
+        barrier.dstQueueFamilyIndex = mGraphicsFamily;
+        barrier.buffer              = dst;
+        barrier.offset              = dstOffset;
+        barrier.size                = size;
+
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.bufferMemoryBarrierCount = 1;
+        dep.pBufferMemoryBarriers    = &barrier;
+
+        // Release on the transfer queue ...
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier2(mBatch.transferCmd, &dep);
+
+        // ... acquire on the graphics queue
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+        barrier.srcAccessMask = 0;
+        barrier.dstStageMask  = VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_MEMORY_READ_BIT;
+        vkCmdPipelineBarrier2(mBatch.graphicsCmd, &dep);
+    }
+
+    mStats.uploadCount++;
+    mStats.bytes += size;
+    return mBatch.token;
+}
+
+UploadToken TransferManager::UploadImage(VkImage image, uint32_t width, uint32_t height,
+                                         uint32_t mipLevels, const void* data, VkDeviceSize size,
+                                         std::function<void(VkCommandBuffer)> graphicsFn) {
+    if (size == 0 || height == 0) return mSubmittedValue;
+    TouchStats();
+    const auto*  src          = static_cast<const uint8_t*>(data);
+    VkDeviceSize rowBytes     = size / height;
+    uint32_t     rowsPerChunk = static_cast<uint32_t>(std::max<VkDeviceSize>(1, RING_SIZE / rowBytes));
+
+    for (uint32_t y = 0; y < height;) {
+        uint32_t     rows   = std::min(rowsPerChunk, height - y);
+        VkDeviceSize bytes  = rowBytes * rows;
+        VkDeviceSize offset = AllocateStaging(bytes);
+        std::memcpy(mRingData + offset, src + rowBytes * y, static_cast<size_t>(bytes));
+        vmaFlushAllocation(mAllocator, mRingAlloc, offset, bytes);
+        if (!mBatchOpen) BeginBatch();
+
+        if (y == 0) {
+            TransitionImage(mBatch.transferCmd, image,
+                            VK_PIPELINE_STAGE_2_NONE, 0,
+                            VK_PIPELINE_STAGE_2_TRANSFER_BIT, VK_ACCESS_2_TRANSFER_WRITE_BIT,
+                            VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                            VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels);
+        }
+
+        VkBufferImageCopy region{};
+        region.bufferOffset     = offset;
+        region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        region.imageOffset      = { 0, static_cast<int32_t>(y), 0 };
+        region.imageExtent      = { width, rows, 1 };
+        vkCmdCopyBufferToImage(mBatch.transferCmd, mRing, image,
+                               VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+        y += rows;
+    }
+
+    if (Separate()) {
+        VkImageMemoryBarrier2 barrier{VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+        barrier.oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcQueueFamilyIndex = mTransferFamily;
+        barrier.dstQueueFamilyIndex = mGraphicsFamily;
+        barrier.image               = image;
+        barrier.subresourceRange    = { VK_IMAGE_ASPECT_COLOR_BIT, 0, mipLevels, 0, 1 };
+
+        VkDependencyInfo dep{VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+        dep.imageMemoryBarrierCount = 1;
+        dep.pImageMemoryBarriers    = &barrier;
+
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier.srcAccessMask = VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier2(mBatch.transferCmd, &dep);
+
+        barrier.srcStageMask  = VK_PIPELINE_STAGE_2_NONE;
+        barrier.srcAccessMask = 0;
+        barrier.dstStageMask  = VK_PIPELINE_STAGE_2_TRANSFER_BIT;
+        barrier.dstAccessMask = VK_ACCESS_2_TRANSFER_READ_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier2(mBatch.graphicsCmd, &dep);
+    }
+
+    if (graphicsFn) graphicsFn(mBatch.graphicsCmd);
+
+    mStats.uploadCount++;
+    mStats.bytes += size;
+    return mBatch.token;
+}
+
+// ---------------------------------------------------------------------------
+// Statistics
+// ---------------------------------------------------------------------------
+void TransferManager::TouchStats() {
+    if (mStatsRunning) return;
+    mStatsRunning = true;
+    mStatsStart   = std::chrono::steady_clock::now();
+}
+
+void TransferManager::ResetStats() {
+    mStats        = {};
+    mStatsRunning = false;
+}
+
+const TransferStats& TransferManager::GetStats() {
+    if (mStatsRunning) {
+        mStats.seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - mStatsStart).count();
+    }
+    return mStats;
 }
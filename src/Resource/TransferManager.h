@@ -1,21 +1,117 @@
 #pragma once
 
 #include <volk.h>
+#include <vk_mem_alloc.h>
 #include <functional>
+#include <vector>
+#include <deque>
+#include <chrono>
+#include <cstdint>
+
+/// Completion token for an asynchronous upload: the timeline semaphore value
+/// that is signaled once the copy (and any queue-ownership acquire) is done.
+using UploadToken = uint64_t;
+
+struct TransferStats {
+    uint64_t uploadCount  = 0;
+    uint64_t bytes        = 0;
+    uint64_t submits      = 0;
+    uint64_t ringStalls   = 0;
+    double   seconds      = 0.0;
+
+    double UploadsPerSecond() const { return seconds > 0.0 ? uploadCount / seconds : 0.0; }
+    double BytesPerSecond()   const { return seconds > 0.0 ? bytes / seconds : 0.0; }
+};
 
 class TransferManager {
 public:
-    void Initialize(VkDevice device, uint32_t queueFamily, VkQueue queue);
+    static constexpr VkDeviceSize RING_SIZE      = 64ull * 1024 * 1024;
+    static constexpr VkDeviceSize RING_ALIGNMENT = 256;
+
+    void Initialize(VkDevice device, VmaAllocator allocator,
+                    uint32_t transferFamily, VkQueue transferQueue,
+                    uint32_t graphicsFamily, VkQueue graphicsQueue);
     void Shutdown();
 
-    /// Records and submits a one-shot command buffer, then waits for completion.
-    void ImmediateSubmit(std::function<void(VkCommandBuffer)> fn) const;
+    /// Records and submits a one-shot command buffer on the graphics queue, then waits
+    /// for completion. Pending uploads are flushed and waited on by the GPU first.
+    void ImmediateSubmit(std::function<void(VkCommandBuffer)> fn);
+
+    /// Queues a copy of `size` bytes into `dst` through the staging ring.
+    /// The copy is batched with other uploads until Flush().
+    UploadToken UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset,
+                             const void* data, VkDeviceSize size);
+
+    /// Queues a copy into mip 0 / layer 0 of `image`. The whole mip chain is left in
+    /// TRANSFER_DST_OPTIMAL; `graphicsFn` runs on the graphics queue afterwards and
+    /// must transition the image to its final layout (e.g. by generating mips).
+    UploadToken UploadImage(VkImage image, uint32_t width, uint32_t height, uint32_t mipLevels,
+                            const void* data, VkDeviceSize size,
+                            std::function<void(VkCommandBuffer)> graphicsFn);
+
+    /// Submits the current batch (one submit on the transfer queue) and returns its token.
+    UploadToken Flush();
+    bool        IsComplete(UploadToken token) const;
+    void        Wait(UploadToken token);
+    void        WaitIdle();
 
-    VkQueue GetQueue() const { return mQueue; }
+    VkQueue     GetQueue()          const { return mGraphicsQueue; }
+    VkSemaphore GetTimeline()       const { return mTimeline; }
+    UploadToken GetSubmittedValue() const { return mSubmittedValue; }
+
+    void                 ResetStats();
+    const TransferStats& GetStats();
 
 private:
-    VkDevice      mDevice      = VK_NULL_HANDLE;
-    VkQueue       mQueue       = VK_NULL_HANDLE;
-    VkCommandPool mCommandPool = VK_NULL_HANDLE;
-    VkFence       mFence       = VK_NULL_HANDLE;
+    struct RingRegion {
+        VkDeviceSize end   = 0;
+        VkDeviceSize bytes = 0;
+        UploadToken  token = 0;
+    };
+
+    struct Batch {
+        VkCommandBuffer transferCmd = VK_NULL_HANDLE;
+        VkCommandBuffer graphicsCmd = VK_NULL_HANDLE;
+        UploadToken     token       = 0;
+    };
+
+    bool         Separate() const { return mTransferFamily != mGraphicsFamily; }
+    VkDeviceSize AllocateStaging(VkDeviceSize size);
+    bool         TryAllocate(VkDeviceSize size, VkDeviceSize& offset);
+    void         Reclaim();
+    void         BeginBatch();
+    void         TouchStats();
+
+    VkDevice      mDevice    = VK_NULL_HANDLE;
+    VmaAllocator  mAllocator = VK_NULL_HANDLE;
+
+    uint32_t      mTransferFamily = 0;
+    uint32_t      mGraphicsFamily = 0;
+    VkQueue       mTransferQueue  = VK_NULL_HANDLE;
+    VkQueue       mGraphicsQueue  = VK_NULL_HANDLE;
+    VkCommandPool mTransferPool   = VK_NULL_HANDLE;
+    VkCommandPool mGraphicsPool   = VK_NULL_HANDLE;
+    VkCommandPool mCommandPool    = VK_NULL_HANDLE;
+    VkFence       mFence          = VK_NULL_HANDLE;
+    VkSemaphore   mTimeline       = VK_NULL_HANDLE;
+
+    // Persistently mapped staging ring
+    VkBuffer      mRing           = VK_NULL_HANDLE;
+    VmaAllocation mRingAlloc      = VK_NULL_HANDLE;
+    uint8_t*      mRingData       = nullptr;
+    VkDeviceSize  mRingHead       = 0;
+    VkDeviceSize  mRingTail       = 0;
+    VkDeviceSize  mRingUsed       = 0;
+    std::deque<RingRegion> mRegions;
+
+    // Batching
+    bool               mBatchOpen      = false;
+    Batch              mBatch;
+    std::deque<Batch>  mInFlight;
+    std::vector<Batch> mFreeBatches;
+    UploadToken        mSubmittedValue = 0;
+
+    TransferStats mStats;
+    bool          mStatsRunning = false;
+    std::chrono::steady_clock::time_point mStatsStart;
 };
@@ -2,24 +2,32 @@
 
 #include <volk.h>
 #include <vk_mem_alloc.h>
+#include <cstdint>
 
 class TransferManager;
+using UploadToken = uint64_t;
 
 class VulkanBuffer {
 public:
     VulkanBuffer() = default;
 
-    /// Create a device-local buffer and upload data via a staging buffer.
-    void CreateDeviceLocal(VmaAllocator allocator,
-                           const TransferManager& transfer,
-                           VkBufferUsageFlags usage,
-                           const void* data, VkDeviceSize size);
+    /// Create a device-local buffer and queue its upload through the staging ring.
+    UploadToken CreateDeviceLocal(VmaAllocator allocator,
+                                  TransferManager& transfer,
+                                  VkBufferUsageFlags usage,
+                                  const void* data, VkDeviceSize size);
 
     /// Create a host-visible, persistently mapped buffer.
     void CreateHostVisible(VmaAllocator allocator,
                            VkBufferUsageFlags usage,
                            VkDeviceSize size);
 
+    /// Create a host-visible, persistently mapped buffer the GPU writes and the CPU reads.
+    /// Call Invalidate before reading.
+    void CreateReadback(VmaAllocator allocator,
+                        VkBufferUsageFlags usage,
+                        VkDeviceSize size);
+
     /// Create a device-local buffer without uploading initial data.
     void CreateDeviceLocalEmpty(VmaAllocator allocator,
                                 VkBufferUsageFlags usage,
@@ -27,6 +35,9 @@ public:
 
     void Destroy(VmaAllocator allocator);
 
+    /// Make GPU writes to a mapped buffer visible to the host (no-op on coherent memory).
+    void Invalidate(VmaAllocator allocator) const;
+
     VkBuffer     GetHandle()     const { return mBuffer; }
     VkDeviceSize GetSize()       const { return mSize; }
     void*        GetMappedData() const { return mMappedData; }
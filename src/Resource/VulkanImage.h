@@ -2,18 +2,21 @@
 
 #include <volk.h>
 #include <vk_mem_alloc.h>
+#include <cstdint>
 
 class TransferManager;
+using UploadToken = uint64_t;
 
 class VulkanImage {
 public:
     VulkanImage() = default;
 
-    /// Create a 2D texture from pixel data, upload via staging, and generate mipmaps.
-    void CreateTexture2D(VmaAllocator allocator, VkDevice device,
-                         const TransferManager& transfer,
-                         uint32_t width, uint32_t height,
-                         VkFormat format, const void* pixels);
+    /// Create a 2D texture from pixel data, queue its upload through the staging ring,
+    /// and generate mipmaps on the graphics queue once the copy lands.
+    UploadToken CreateTexture2D(VmaAllocator allocator, VkDevice device,
+                                TransferManager& transfer,
+                                uint32_t width, uint32_t height,
+                                VkFormat format, const void* pixels);
 
     /// Create a depth-only image (no upload needed).
     void CreateDepth(VmaAllocator allocator, VkDevice device,
@@ -38,7 +41,8 @@ public:
     }
 
 private:
-    void GenerateMipmaps(const TransferManager& transfer, VkFormat format);
+    static void RecordMipmaps(VkCommandBuffer cmd, VkImage image,
+                              uint32_t width, uint32_t height, uint32_t mipLevels);
 
     VkImage       mImage      = VK_NULL_HANDLE;
     VkImageView   mView       = VK_NULL_HANDLE;
@@ -0,0 +1,47 @@
+#include "Scene/CameraPath.h"
+#include "Core/Logger.h"
+
+#include <fstream>
+#include <sstream>
+
+bool CameraPath::Load(const std::string& path) {
+    mFrames.clear();
+
+    std::ifstream file(path);
+    if (!file) {
+        LOG_ERROR("Cannot open camera path {}", path);
+        return false;
+    }
+
+    float fovDeg = 45.0f;
+    std::string line;
+    for (uint32_t lineNo = 1; std::getline(file, line); lineNo++) {
+        size_t start = line.find_first_not_of(" \t\r");
+        if (start == std::string::npos || line[start] == '#') continue;
+
+        std::istringstream in(line);
+        Frame f;
+        in >> f.position.x >> f.position.y >> f.position.z
+           >> f.target.x >> f.target.y >> f.target.z;
+        if (!in) {
+            LOG_ERROR("{}:{}: expected \"px py pz tx ty tz [fovDeg]\"", path, lineNo);
+            return false;
+        }
+        float fov = 0.0f;
+        if (in >> fov) fovDeg = fov;
+        f.fovDeg = fovDeg;
+
+        if (glm::length(f.target - f.position) < 1e-4f) {
+            LOG_ERROR("{}:{}: camera position and target coincide", path, lineNo);
+            return false;
+        }
+        mFrames.push_back(f);
+    }
+
+    if (mFrames.empty()) {
+        LOG_ERROR("Camera path {} has no frames", path);
+        return false;
+    }
+    LOG_INFO("Camera path {}: {} frames", path, mFrames.size());
+    return true;
+}
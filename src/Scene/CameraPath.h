@@ -0,0 +1,25 @@
+#pragma once
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+/// One camera per output frame, read from a text file. Each non-empty line that is not
+/// a '#' comment holds "px py pz  tx ty tz  [fovDeg]": position, look-at target and an
+/// optional vertical field of view (the previous frame's, or 45, when omitted).
+class CameraPath {
+public:
+    struct Frame {
+        glm::vec3 position{0.0f};
+        glm::vec3 target{0.0f, 0.0f, -1.0f};
+        float     fovDeg = 45.0f;
+    };
+
+    bool Load(const std::string& path);
+
+    size_t       GetFrameCount() const { return mFrames.size(); }
+    const Frame& GetFrame(size_t i) const { return mFrames[i]; }
+
+private:
+    std::vector<Frame> mFrames;
+};
@@ -75,12 +75,17 @@ struct TransformComponent {
 struct MeshComponent     { int meshIndex     = -1; };
 struct MaterialComponent { int materialIndex = -1; };
 
+/// Directional lights use `direction`; point and spot lights take their position from the
+/// entity's transform (KHR_lights_punctual: intensity in candela, range 0 = unlimited).
 struct LightComponent {
-    enum class Type { Directional };
+    enum class Type { Directional, Point, Spot };
     Type      type      = Type::Directional;
     glm::vec3 direction{glm::normalize(glm::vec3(-0.4f, -0.8f, -0.3f))};
     glm::vec3 color{1.0f, 0.95f, 0.85f};
     float     intensity = 3.5f;
+    float     range          = 0.0f;
+    float     innerConeAngle = 0.0f;          // spot only, radians
+    float     outerConeAngle = 0.78539816f;   // spot only, radians
 };
 
 class Registry {
@@ -176,6 +181,13 @@ public:
         return sun;
     }
 
+    template<typename Fn>
+    void ForEachLight(Fn&& fn) const {
+        mLights.ForEach([&](Entity e, const LightComponent& lc) {
+            fn(e, lc, mTransforms.Get(e));
+        });
+    }
+
     template<typename Fn>
     void ForEachRenderable(Fn&& fn) const {
         mTransforms.ForEach([&](Entity e, const TransformComponent& tc) {
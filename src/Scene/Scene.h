@@ -3,7 +3,7 @@
 #include <glm/glm.hpp>
 #include <cstdint>
 
-/// GPU-side material parameters, must match GLSL layout (std430, 48 bytes).
+/// GPU-side material parameters, must match GLSL layout (std430, 64 bytes).
 struct GPUMaterialData {
     glm::vec4 baseColorFactor{1.0f};
     float     metallicFactor       = 0.0f;
@@ -13,9 +13,13 @@ struct GPUMaterialData {
     uint32_t  metallicRoughnessTexIdx = 0;
     uint32_t  aoTexIdx             = 0;
     uint32_t  emissiveTexIdx       = 0;
-    float     _pad                 = 0.0f;
+    float     alphaCutoff          = 0.5f;   // AlphaMode::Mask discards fragments below this alpha
+    uint32_t  alphaMode            = 0;      // AlphaMode
+    uint32_t  _pad0                = 0;
+    uint32_t  _pad1                = 0;
+    uint32_t  _pad2                = 0;
 };
-static_assert(sizeof(GPUMaterialData) == 48, "GPUMaterialData must be 48 bytes for std430");
+static_assert(sizeof(GPUMaterialData) == 64, "GPUMaterialData must be 64 bytes for std430");
 
 /// GPU-side per-frame uniform data, must match GLSL layout (std140, 512 bytes).
 struct FrameData {
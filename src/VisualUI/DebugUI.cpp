@@ -4,6 +4,8 @@
 #include "PostProcess/PostProcessStack.h"
 #include "Scene/ECS.h"
 #include "Scene/Scene.h"
+#include "RayTracing/RTTraceMode.h"
+#include "RayTracing/RTMaterialClass.h"
 #include "Core/Logger.h"
 
 #include <volk.h>
@@ -212,7 +214,7 @@ void DebugUI::DrawRenderSettingsPanel(float deltaTime, const std::vector<VkSampl
     ImGui::Text("GPU-Driven Rendering");
     ImGui::Checkbox("GPU Driven", &mState.gpuDriven);
     ImGui::Checkbox("Occlusion Culling", &mState.occlusionCulling);
-    ImGui::SliderFloat("Occluder Ratio", &mState.occluderRatio, 0.05f, 1.0f, "%.2f");
+    ImGui::Checkbox("Meshlet Culling", &mState.clusterCulling);
 
     ImGui::Separator();
     ImGui::Checkbox("Pipeline Statistics", &mState.pipelineStatsEnabled);
@@ -255,6 +257,21 @@ void DebugUI::DrawRenderSettingsPanel(float deltaTime, const std::vector<VkSampl
         ImGui::SliderFloat("Shadow Strength", &mState.rtShadowStrength, 0.0f, 1.0f, "%.2f");
         ImGui::SliderFloat("Reflection Strength", &mState.rtReflStrength, 0.0f, 1.0f, "%.2f");
         ImGui::SliderFloat("Reflection Roughness", &mState.rtReflRoughness, 0.01f, 1.0f, "%.3f");
+
+        constexpr int kPresetCount = static_cast<int>(std::size(kRTTracePresets));
+        const char* presets[kPresetCount + 1];
+        for (int i = 0; i < kPresetCount; i++) presets[i] = kRTTracePresets[i].name;
+        presets[kPresetCount] = "Custom";
+        if (ImGui::Combo("RT Quality", &mState.rtTracePreset, presets, kPresetCount + 1) &&
+            mState.rtTracePreset < kPresetCount) {
+            mState.rtShadowTrace = static_cast<int>(kRTTracePresets[mState.rtTracePreset].shadows);
+            mState.rtReflTrace   = static_cast<int>(kRTTracePresets[mState.rtTracePreset].reflections);
+        }
+        const char* traceModes[] = { "Full", "Half", "Quarter", "Checkerboard" };
+        if (ImGui::Combo("Shadow Rays", &mState.rtShadowTrace, traceModes, 4))
+            mState.rtTracePreset = kPresetCount;
+        if (ImGui::Combo("Reflection Rays", &mState.rtReflTrace, traceModes, 4))
+            mState.rtTracePreset = kPresetCount;
         ImGui::SliderFloat("Light Radius (soft shadow)", &mState.rtLightRadius, 0.0f, 0.2f, "%.3f");
         ImGui::Checkbox("Debug Shadow Map", &mState.rtDebugShadowVis);
     }
@@ -480,6 +497,12 @@ void DebugUI::DrawRenderModePanel() {
         mState.renderMode == DebugUIState::RenderMode::Hybrid) {
         ImGui::Separator();
         ImGui::Text("Path Tracer Settings");
+        const char* integrators[] = { "Megakernel", "Wavefront" };
+        ImGui::Combo("Integrator", &mState.ptIntegrator, integrators, 2);
+        const char* samplers[] = { "Random (hash)", "Low-discrepancy" };
+        ImGui::Combo("Sampler", &mState.ptSampler, samplers, 2);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Owen-scrambled Sobol when accumulating, blue noise with the denoiser");
         ImGui::SliderInt("Max Bounces", &mState.ptMaxBounces, 1, 32);
         ImGui::Checkbox("MIS (Multiple Importance Sampling)", &mState.ptEnableMIS);
         ImGui::Checkbox("Denoiser (NRD REBLUR)", &mState.ptEnableDenoiser);
@@ -492,6 +515,52 @@ void DebugUI::DrawRenderModePanel() {
             ImGui::Unindent();
         }
         ImGui::Checkbox("Progressive Accumulation", &mState.ptProgressive);
+        ImGui::BeginDisabled(!mState.ptProgressive || mState.ptEnableDenoiser || mState.ptIntegrator != 0);
+        ImGui::Checkbox("Adaptive Sampling", &mState.ptAdaptive);
+        if (mState.ptAdaptive) {
+            ImGui::Indent();
+            ImGui::SliderFloat("Error Threshold", &mState.ptAdaptiveThreshold, 0.002f, 0.2f, "%.3f",
+                               ImGuiSliderFlags_Logarithmic);
+            ImGui::SliderInt("Max Tile SPP", &mState.ptAdaptiveMaxSpp, 1, 16);
+            ImGui::Text("Converged: %.1f%%  %.1f spp  %.2fx vs uniform",
+                        mState.ptAdaptiveConverged * 100.0f, mState.ptAdaptiveSpp, mState.ptAdaptiveSavings);
+            ImGui::Unindent();
+        }
+        ImGui::EndDisabled();
+        ImGui::Checkbox("ReSTIR DI", &mState.ptReSTIR);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Reservoir resampling of point, spot and emissive lights at the primary hit");
+        if (mState.ptReSTIR) {
+            ImGui::Indent();
+            ImGui::SliderInt("Light Candidates", &mState.ptReSTIRCandidates, 1, 32);
+            ImGui::Unindent();
+        }
+        ImGui::SliderFloat("Punctual Light Scale", &mState.ptLightScale, 0.0f, 10.0f, "%.2f",
+                           ImGuiSliderFlags_Logarithmic);
+        ImGui::Text("Lights: %d  ReSTIR %s", mState.ptLightCount, mState.ptReSTIRActive ? "active" : "inactive");
+        ImGui::Checkbox("Force Opaque Instances", &mState.ptForceOpaque);
+        if (ImGui::IsItemHovered())
+            ImGui::SetTooltip("Opaque and emissive instances skip any-hit; off, every instance runs it (baseline)");
+        ImGui::BeginDisabled(mState.ptIntegrator != 0);
+        ImGui::Checkbox("Hit-Class Statistics", &mState.ptHitStats);
+        if (ImGui::IsItemHovered(ImGuiHoveredFlags_AllowWhenDisabled))
+            ImGui::SetTooltip("Per-class hit-shader invocations of the megakernel (atomics in every hit shader).\n"
+                              "Toggle Force Opaque Instances from the same view to measure the eliminated any-hits.");
+        if (mState.ptHitStats) {
+            ImGui::Indent();
+            for (uint32_t c = 0; c < kRTMaterialClassCount; c++) {
+                ImGui::Text("%-12s %5d inst  any-hit %8.1fK  closest-hit %8.1fK",
+                            RTMaterialClassName(static_cast<RTMaterialClass>(c)), mState.ptClassInstances[c],
+                            mState.ptClassAnyHit[c] / 1e3f, mState.ptClassClosestHit[c] / 1e3f);
+                if (mState.ptForceOpaque && mState.ptClassAnyHitBaseline[c] >= 0.0f) {
+                    ImGui::SameLine();
+                    ImGui::Text(" eliminated %.1fK",
+                                std::max(mState.ptClassAnyHitBaseline[c] - mState.ptClassAnyHit[c], 0.0f) / 1e3f);
+                }
+            }
+            ImGui::Unindent();
+        }
+        ImGui::EndDisabled();
     }
 
     ImGui::Separator();
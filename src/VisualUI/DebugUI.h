@@ -16,7 +16,7 @@ enum class SceneType : int { Sponza = 0, TestScene = 1 };
 struct DebugUIState {
     bool gpuDriven        = true;
     bool occlusionCulling = true;
-    float occluderRatio   = 0.2f;
+    bool clusterCulling   = false;
 
     SceneType sceneType    = SceneType::TestScene;
     bool      sceneChanged = false;
@@ -45,6 +45,9 @@ struct DebugUIState {
     float rtShadowStrength   = 1.0f;
     float rtReflStrength     = 0.5f;
     float rtReflRoughness    = 0.15f;
+    int   rtTracePreset      = 0;      // index into kRTTracePresets, or its size for Custom
+    int   rtShadowTrace      = 0;      // RTTraceMode
+    int   rtReflTrace        = 0;
     float rtLightRadius      = 0.02f;
     bool  rtAvailable        = false;
     bool  rtDebugShadowVis   = false;
@@ -66,9 +69,29 @@ struct DebugUIState {
 
     // Path tracer settings
     int   ptMaxBounces       = 8;
+    int   ptIntegrator       = 0;      // 0 = megakernel (traceRays), 1 = wavefront (compute + ray queries)
+    int   ptSampler          = 1;      // 0 = hash RNG, 1 = Sobol / blue noise (PTSampler)
     bool  ptEnableMIS        = true;
     bool  ptEnableDenoiser   = true;
     bool  ptProgressive      = true;
+    bool  ptAdaptive         = false;  // Per-tile spp from variance; progressive megakernel, denoiser off
+    float ptAdaptiveThreshold = 0.02f;
+    int   ptAdaptiveMaxSpp   = 4;
+    float ptAdaptiveConverged = 0.0f;  // Read-only: fraction of tiles below the threshold
+    float ptAdaptiveSpp      = 0.0f;   // Read-only: mean accumulated samples per pixel
+    float ptAdaptiveSavings  = 0.0f;   // Read-only: uniform samples at equal RMSE / adaptive samples
+    bool  ptReSTIR           = true;   // ReSTIR DI at the primary hit when the scene has buffer lights
+    int   ptReSTIRCandidates = 8;
+    float ptLightScale       = 1.0f;   // Multiplies glTF point/spot intensities
+    bool  ptReSTIRActive     = false;  // Read-only
+    int   ptLightCount       = 0;      // Read-only: punctual + emissive triangle lights
+    bool  ptForceOpaque      = true;   // FORCE_OPAQUE on opaque/emissive TLAS instances; off = any-hit everywhere
+    bool  ptHitStats         = false;  // Count megakernel hit-shader invocations per material class
+    // Read-only, indexed by RTMaterialClass (opaque, alpha-tested, emissive)
+    int   ptClassInstances[3]       = {};
+    float ptClassAnyHit[3]          = {};  // any-hit invocations per frame
+    float ptClassClosestHit[3]      = {};  // closest-hit invocations per frame
+    float ptClassAnyHitBaseline[3]  = {-1.0f, -1.0f, -1.0f};  // any-hit per frame without FORCE_OPAQUE, -1 = not measured
     bool  ptBypassNRDOutput  = false;  // When denoiser on: show accum instead of NRD output (debug)
     bool  ptDenoiserComparison = false;  // Split-screen: left=denoised, right=raw (for debugging)
 };
@@ -2,14 +2,17 @@
 #include "Resource/ShaderManager.h"
 #include "Resource/PipelineManager.h"
 #include "Asset/ModelLoader.h"
+#include "GPU/VertexFormat.h"
 #include "Core/Logger.h"
 
 void DebugVisualization::Initialize(VkDevice device, ShaderManager& shaders,
                                      PipelineManager& pipelines,
                                      VkFormat colorFormat,
                                      VkDescriptorSetLayout bindlessLayout,
-                                     VkDescriptorSetLayout frameLayout) {
-    CreateDebugPipeline(device, shaders, pipelines, colorFormat, bindlessLayout, frameLayout);
+                                     VkDescriptorSetLayout frameLayout,
+                                     VertexFormat vertexFormat) {
+    CreateDebugPipeline(device, shaders, pipelines, colorFormat, bindlessLayout, frameLayout,
+                        vertexFormat);
     LOG_INFO("DebugVisualization initialized");
 }
 
@@ -37,7 +40,8 @@ bool DebugVisualization::RequiresSpecialRendering(DebugUIState::VisMode mode) co
 void DebugVisualization::CreateDebugPipeline(VkDevice device, ShaderManager& shaders,
                                               PipelineManager& pipelines, VkFormat colorFormat,
                                               VkDescriptorSetLayout bindlessLayout,
-                                              VkDescriptorSetLayout frameLayout)
+                                              VkDescriptorSetLayout frameLayout,
+                                              VertexFormat vertexFormat)
 {
     VkShaderModule vertModule = shaders.GetOrLoad("shaders/pbr_indirect.vert.spv");
     VkShaderModule fragModule = shaders.GetOrLoad("shaders/debug_vis.frag.spv");
@@ -46,23 +50,9 @@ void DebugVisualization::CreateDebugPipeline(VkDevice device, ShaderManager& sha
         return;
     }
 
-    VkVertexInputBindingDescription bindingDesc{};
-    bindingDesc.binding   = 0;
-    bindingDesc.stride    = sizeof(MeshVertex);
-    bindingDesc.inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-
-    VkVertexInputAttributeDescription attrDescs[4]{};
-    attrDescs[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, position)};
-    attrDescs[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT,    offsetof(MeshVertex, normal)};
-    attrDescs[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT,       offsetof(MeshVertex, texCoord)};
-    attrDescs[3] = {3, 0, VK_FORMAT_R32G32B32A32_SFLOAT, offsetof(MeshVertex, tangent)};
-
-    VkPipelineVertexInputStateCreateInfo vertexInput{};
-    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInput.vertexBindingDescriptionCount   = 1;
-    vertexInput.pVertexBindingDescriptions      = &bindingDesc;
-    vertexInput.vertexAttributeDescriptionCount = 4;
-    vertexInput.pVertexAttributeDescriptions    = attrDescs;
+    VertexInputLayout          vertexLayout(vertexFormat);
+    VertexFormatSpecialization vertexSpec(vertexFormat);
+    const VkPipelineVertexInputStateCreateInfo& vertexInput = vertexLayout.state;
 
     VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
     inputAssembly.sType    = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
@@ -114,7 +104,7 @@ void DebugVisualization::CreateDebugPipeline(VkDevice device, ShaderManager& sha
 
     VkPipelineShaderStageCreateInfo stages[2]{};
     stages[0] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
-                 VK_SHADER_STAGE_VERTEX_BIT, vertModule, "main", nullptr};
+                 VK_SHADER_STAGE_VERTEX_BIT, vertModule, "main", &vertexSpec.info};
     stages[1] = {VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0,
                  VK_SHADER_STAGE_FRAGMENT_BIT, fragModule, "main", nullptr};
 
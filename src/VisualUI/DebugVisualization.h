@@ -1,6 +1,7 @@
 #pragma once
 
 #include "VisualUI/DebugUI.h"
+#include "GPU/VertexFormat.h"
 #include <volk.h>
 
 class ShaderManager;
@@ -10,7 +11,8 @@ class DebugVisualization {
 public:
     void Initialize(VkDevice device, ShaderManager& shaders, PipelineManager& pipelines,
                     VkFormat colorFormat, VkDescriptorSetLayout bindlessLayout,
-                    VkDescriptorSetLayout frameLayout);
+                    VkDescriptorSetLayout frameLayout,
+                    VertexFormat vertexFormat = VertexFormat::Float);
     void Shutdown(VkDevice device);
 
     VkPipeline       GetPipeline(DebugUIState::VisMode mode) const;
@@ -22,7 +24,8 @@ private:
     void CreateDebugPipeline(VkDevice device, ShaderManager& shaders, PipelineManager& pipelines,
                              VkFormat colorFormat,
                              VkDescriptorSetLayout bindlessLayout,
-                             VkDescriptorSetLayout frameLayout);
+                             VkDescriptorSetLayout frameLayout,
+                             VertexFormat vertexFormat);
 
     VkPipelineLayout mPipelineLayout = VK_NULL_HANDLE;
     VkPipeline       mWireframePipeline = VK_NULL_HANDLE;
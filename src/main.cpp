@@ -2,6 +2,7 @@
 #include "Core/Logger.h"
 
 #include <exception>
+#include <cstdio>
 #include <cstring>
 #include <string>
 
@@ -14,6 +15,24 @@ int main(int argc, char* argv[]) {
         std::string scenePath;
         bool pathTracing = false;
         bool denoiserOn = true;  // default on when path tracing
+        bool meshOpt = true;
+        bool packedVertices = false;
+        bool clusterCulling = false;
+        bool hiZSinglePass = true;
+        bool instancing = true;
+        bool meshLODs = true;
+        float lodError = -1.0f;
+        std::string cpuReferencePath;
+        uint32_t cpuSpp = 16;
+        uint32_t blasBudgetMB = 0;
+        bool wavefront = false;
+        bool restir = true;
+        int sampler = -1;
+        int rtPreset = -1;
+        float adaptiveThreshold = 0.0f;
+        bool forceOpaque = true;
+        bool hitStats = false;
+        OfflineRenderSettings render;
 
         for (int i = 1; i < argc; i++) {
             if (std::strcmp(argv[i], "--benchmark") == 0) benchmark = true;
@@ -23,6 +42,47 @@ int main(int argc, char* argv[]) {
             else if (std::strcmp(argv[i], "--scene") == 0 && i + 1 < argc) scenePath = argv[++i];
             else if (std::strcmp(argv[i], "--path-tracing") == 0) pathTracing = true;
             else if (std::strcmp(argv[i], "--no-denoiser") == 0) { denoiserOn = false; pathTracing = true; }
+            else if (std::strcmp(argv[i], "--no-mesh-opt") == 0) meshOpt = false;
+            else if (std::strcmp(argv[i], "--packed-vertices") == 0) packedVertices = true;
+            else if (std::strcmp(argv[i], "--cluster-culling") == 0) clusterCulling = true;
+            else if (std::strcmp(argv[i], "--hiz-per-mip") == 0) hiZSinglePass = false;
+            else if (std::strcmp(argv[i], "--no-instancing") == 0) instancing = false;
+            else if (std::strcmp(argv[i], "--no-lod") == 0) meshLODs = false;
+            else if (std::strcmp(argv[i], "--lod-error") == 0 && i + 1 < argc) lodError = static_cast<float>(std::atof(argv[++i]));
+            else if (std::strcmp(argv[i], "--cpu-reference") == 0 && i + 1 < argc) cpuReferencePath = argv[++i];
+            else if (std::strcmp(argv[i], "--cpu-spp") == 0 && i + 1 < argc) cpuSpp = std::atoi(argv[++i]);
+            else if (std::strcmp(argv[i], "--blas-budget") == 0 && i + 1 < argc) blasBudgetMB = std::atoi(argv[++i]);
+            else if (std::strcmp(argv[i], "--wavefront") == 0) { wavefront = true; pathTracing = true; }
+            else if (std::strcmp(argv[i], "--no-restir") == 0) restir = false;
+            else if (std::strcmp(argv[i], "--no-force-opaque") == 0) forceOpaque = false;
+            else if (std::strcmp(argv[i], "--hit-stats") == 0) hitStats = true;
+            else if (std::strcmp(argv[i], "--adaptive") == 0 && i + 1 < argc) {
+                adaptiveThreshold = static_cast<float>(std::atof(argv[++i]));
+                denoiserOn = false;
+                pathTracing = true;
+            }
+            else if (std::strcmp(argv[i], "--sampler") == 0 && i + 1 < argc) {
+                ++i;
+                if (std::strcmp(argv[i], "random") == 0) sampler = static_cast<int>(PTSampler::Random);
+                else if (std::strcmp(argv[i], "ld") == 0) sampler = static_cast<int>(PTSampler::LowDiscrepancy);
+                else LOG_ERROR("Unknown sampler '{}' (use random or ld)", argv[i]);
+            }
+            else if (std::strcmp(argv[i], "--rt-preset") == 0 && i + 1 < argc) {
+                ++i;
+                if (std::strcmp(argv[i], "quality") == 0) rtPreset = 0;
+                else if (std::strcmp(argv[i], "balanced") == 0) rtPreset = 1;
+                else if (std::strcmp(argv[i], "performance") == 0) rtPreset = 2;
+                else LOG_ERROR("Unknown RT preset '{}' (use quality, balanced or performance)", argv[i]);
+            }
+            else if (std::strcmp(argv[i], "--render") == 0 && i + 1 < argc) render.cameraPath = argv[++i];
+            else if (std::strcmp(argv[i], "--output") == 0 && i + 1 < argc) render.outputPattern = argv[++i];
+            else if (std::strcmp(argv[i], "--report") == 0 && i + 1 < argc) render.reportPath = argv[++i];
+            else if (std::strcmp(argv[i], "--spp") == 0 && i + 1 < argc) render.targetSpp = std::atoi(argv[++i]);
+            else if (std::strcmp(argv[i], "--reference") == 0 && i + 1 < argc) render.referencePath = argv[++i];
+            else if (std::strcmp(argv[i], "--resolution") == 0 && i + 1 < argc) {
+                unsigned w = 0, h = 0;
+                if (std::sscanf(argv[++i], "%ux%u", &w, &h) == 2) { render.width = w; render.height = h; }
+            }
         }
 
         Application app;
@@ -32,10 +92,45 @@ int main(int argc, char* argv[]) {
             app.SetInitialRenderMode(DebugUIState::RenderMode::FullPathTracing);
         if (!denoiserOn)
             app.SetInitialDenoiser(false);
+        if (!meshOpt)
+            app.SetMeshOptimization(false);
+        if (packedVertices)
+            app.SetPackedVertices(true);
+        if (clusterCulling)
+            app.SetClusterCulling(true);
+        if (!hiZSinglePass)
+            app.SetHiZSinglePass(false);
+        if (!instancing)
+            app.SetInstancing(false);
+        if (!meshLODs)
+            app.SetMeshLODs(false);
+        if (lodError >= 0.0f)
+            app.SetLODThreshold(lodError);
+        if (!cpuReferencePath.empty())
+            app.SetCPUReference(cpuReferencePath, cpuSpp);
+        if (blasBudgetMB > 0)
+            app.SetBLASScratchBudget(VkDeviceSize(blasBudgetMB) * 1024 * 1024);
+        if (wavefront)
+            app.SetPathTracerIntegrator(PTIntegrator::Wavefront);
+        if (!restir)
+            app.SetReSTIR(false);
+        if (adaptiveThreshold > 0.0f)
+            app.SetAdaptiveSampling(adaptiveThreshold);
+        if (!forceOpaque)
+            app.SetForceOpaqueInstances(false);
+        if (hitStats)
+            app.SetHitClassStats(true);
+        if (sampler >= 0)
+            app.SetPathTracerSampler(static_cast<PTSampler>(sampler));
+        if (rtPreset >= 0)
+            app.SetRTTracePreset(rtPreset);
+        if (!cpuReferencePath.empty() && !benchmark && render.cameraPath.empty())
+            return app.RunCPUReference(render.width, render.height) ? EXIT_SUCCESS : EXIT_FAILURE;
+        if (!render.cameraPath.empty())
+            return app.RunOfflineRender(render) ? EXIT_SUCCESS : EXIT_FAILURE;
         if (benchmark)
-            app.RunBenchmark(frames, gpuDriven, occlusion);
-        else
-            app.Run();
+            return app.RunBenchmark(frames, gpuDriven, occlusion) ? EXIT_SUCCESS : EXIT_FAILURE;
+        app.Run();
     } catch (const std::exception& e) {
         LOG_ERROR("Fatal exception: {}", e.what());
         return EXIT_FAILURE;
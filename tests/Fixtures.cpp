@@ -0,0 +1,91 @@
+#include "Fixtures.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cmath>
+
+namespace Fixtures {
+
+MeshData BuildBox(const glm::vec3& min, const glm::vec3& max) {
+    // Per face: normal, then u and v with cross(u, v) = normal
+    static const glm::vec3 kFaces[6][3] = {
+        {{ 1, 0, 0}, {0, 1, 0}, {0, 0, 1}}, {{-1, 0, 0}, {0, 0, 1}, {0, 1, 0}},
+        {{ 0, 1, 0}, {0, 0, 1}, {1, 0, 0}}, {{ 0,-1, 0}, {1, 0, 0}, {0, 0, 1}},
+        {{ 0, 0, 1}, {1, 0, 0}, {0, 1, 0}}, {{ 0, 0,-1}, {0, 1, 0}, {1, 0, 0}},
+    };
+    static const float kCorners[4][2] = {{-1, -1}, {1, -1}, {1, 1}, {-1, 1}};
+
+    const glm::vec3 center = (min + max) * 0.5f;
+    const glm::vec3 half   = (max - min) * 0.5f;
+    MeshData mesh;
+    for (const auto& face : kFaces) {
+        uint32_t base = static_cast<uint32_t>(mesh.vertices.size());
+        for (const auto& c : kCorners) {
+            MeshVertex v{};
+            v.position = center + (face[0] + c[0] * face[1] + c[1] * face[2]) * half;
+            v.normal   = face[0];
+            v.texCoord = glm::vec2(c[0], c[1]) * 0.5f + 0.5f;
+            mesh.vertices.push_back(v);
+        }
+        mesh.indices.insert(mesh.indices.end(), {base, base + 1, base + 2, base, base + 2, base + 3});
+    }
+    return mesh;
+}
+
+MeshData BuildUVSphere(uint32_t segments) {
+    const uint32_t seg = segments, rings = seg / 2;
+    MeshData mesh;
+    for (uint32_t r = 0; r <= rings; r++) {
+        for (uint32_t s = 0; s <= seg; s++) {
+            float theta = kPi * static_cast<float>(r) / static_cast<float>(rings);
+            float phi   = 2.0f * kPi * static_cast<float>(s % seg) / static_cast<float>(seg);
+            MeshVertex v{};
+            v.position = glm::vec3(std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi));
+            v.normal   = v.position;
+            v.texCoord = glm::vec2(static_cast<float>(s) / static_cast<float>(seg),
+                                   static_cast<float>(r) / static_cast<float>(rings));
+            mesh.vertices.push_back(v);
+        }
+    }
+    for (uint32_t r = 0; r < rings; r++) {
+        for (uint32_t s = 0; s < seg; s++) {
+            uint32_t a = r * (seg + 1) + s, b = a + seg + 1;
+            mesh.indices.insert(mesh.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+    return mesh;
+}
+
+glm::mat4 ViewProjection(const glm::vec3& eye, const glm::vec3& target, float aspect,
+                         float fovDeg, float nearPlane, float farPlane) {
+    glm::mat4 proj = glm::perspective(glm::radians(fovDeg), aspect, nearPlane, farPlane);
+    proj[1][1] *= -1.0f;
+    return proj * glm::lookAt(eye, target, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void FrustumPlanes(const glm::mat4& vp, glm::vec4 planes[6]) {
+    for (int i = 0; i < 3; i++) {
+        planes[i * 2 + 0] = glm::vec4(vp[0][3] + vp[0][i], vp[1][3] + vp[1][i], vp[2][3] + vp[2][i], vp[3][3] + vp[3][i]);
+        planes[i * 2 + 1] = glm::vec4(vp[0][3] - vp[0][i], vp[1][3] - vp[1][i], vp[2][3] - vp[2][i], vp[3][3] - vp[3][i]);
+    }
+    for (int i = 0; i < 6; i++)
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+std::vector<glm::vec3> FibonacciSphere(uint32_t count) {
+    const float golden = kPi * (3.0f - std::sqrt(5.0f));
+    std::vector<glm::vec3> dirs(count);
+    for (uint32_t i = 0; i < count; i++) {
+        float z = 1.0f - 2.0f * (static_cast<float>(i) + 0.5f) / static_cast<float>(count);
+        float r = std::sqrt(1.0f - z * z);
+        dirs[i] = glm::vec3(r * std::cos(golden * i), r * std::sin(golden * i), z);
+    }
+    return dirs;
+}
+
+double AngleDeg(const glm::vec3& a, const glm::vec3& b) {
+    glm::dvec3 da(a), db(b);
+    return std::atan2(glm::length(glm::cross(da, db)), glm::dot(da, db)) * (180.0 / 3.14159265358979323846);
+}
+
+} // namespace Fixtures
@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Asset/ModelLoader.h"
+
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+
+/// Synthetic inputs shared by the CPU tests.
+namespace Fixtures {
+
+constexpr float kPi = 3.14159265f;
+
+/// Box between min and max, 24 vertices with face normals. Faces wind counter-clockwise
+/// seen from outside, the renderer's front faces.
+MeshData BuildBox(const glm::vec3& min, const glm::vec3& max);
+
+/// Unit UV sphere with `segments` longitudes and half as many rings, seam duplicated.
+MeshData BuildUVSphere(uint32_t segments);
+
+/// Camera at eye looking at target with Camera::GetProjectionMatrix conventions:
+/// Y flipped for Vulkan, depth 0 at the near plane and 1 at the far plane.
+glm::mat4 ViewProjection(const glm::vec3& eye, const glm::vec3& target, float aspect,
+                         float fovDeg = 60.0f, float nearPlane = 0.1f, float farPlane = 150.0f);
+
+/// Normalized inward planes of viewProj (left, right, bottom, top, near, far), the same
+/// planes Application::ExtractFrustumPlanes feeds the culling paths.
+void FrustumPlanes(const glm::mat4& viewProj, glm::vec4 planes[6]);
+
+/// `count` unit directions spread evenly over the sphere (golden-angle spiral), from
+/// z = 1 down to z = -1.
+std::vector<glm::vec3> FibonacciSphere(uint32_t count);
+
+/// Angle between two directions in degrees. atan2 of |a x b| and a . b in double, since
+/// acos loses the small angles packing tests measure to rounding.
+double AngleDeg(const glm::vec3& a, const glm::vec3& b);
+
+} // namespace Fixtures
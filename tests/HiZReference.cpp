@@ -0,0 +1,199 @@
+#include "HiZReference.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace HiZReference {
+namespace {
+
+constexpr uint32_t kBlock = 32;   // mip 0 texels per workgroup side in hiz_spd.comp
+
+struct Reducer {
+    bool min;
+    float operator()(float a, float b) const { return min ? std::min(a, b) : std::max(a, b); }
+};
+
+// Level sizes as HiZBuffer::Resize computes them
+Pyramid AllocateLevels(uint32_t width, uint32_t height) {
+    uint32_t w = std::max(width / 2, 1u);
+    uint32_t h = std::max(height / 2, 1u);
+    uint32_t count = static_cast<uint32_t>(std::floor(std::log2(std::max(w, h)))) + 1;
+    Pyramid pyramid(count);
+    for (uint32_t i = 0; i < count; i++) {
+        pyramid[i].width  = std::max(w >> i, 1u);
+        pyramid[i].height = std::max(h >> i, 1u);
+        pyramid[i].texels.assign(size_t(pyramid[i].width) * pyramid[i].height, 0.0f);
+    }
+    return pyramid;
+}
+
+// Level -1 is the depth source. Sizes are defined past the last level like MipSize()
+// in the shader, and reads clamp to the edge.
+struct Source {
+    const std::vector<float>& depth;
+    uint32_t       width, height;
+    const Pyramid& pyramid;
+
+    uint32_t Width(int level) const  { return level < 0 ? width  : std::max(pyramid[0].width  >> level, 1u); }
+    uint32_t Height(int level) const { return level < 0 ? height : std::max(pyramid[0].height >> level, 1u); }
+
+    float Load(int level, int64_t x, int64_t y) const {
+        x = std::clamp<int64_t>(x, 0, Width(level) - 1);
+        y = std::clamp<int64_t>(y, 0, Height(level) - 1);
+        return level < 0 ? depth[size_t(y) * width + size_t(x)]
+                         : pyramid[level].At(uint32_t(x), uint32_t(y));
+    }
+};
+
+// The last texel of an axis whose source is odd reduces 3 source texels
+bool Wide(uint32_t src, uint32_t dst, uint32_t p) {
+    return src == 2 * dst + 1 && p == dst - 1;
+}
+
+float ReduceFootprint(const Source& s, int level, uint32_t x, uint32_t y, Reducer reduce) {
+    int      src   = level - 1;
+    uint32_t spanX = Wide(s.Width(src),  s.Width(level),  x) ? 3 : 2;
+    uint32_t spanY = Wide(s.Height(src), s.Height(level), y) ? 3 : 2;
+    float v = s.Load(src, int64_t(x) * 2, int64_t(y) * 2);
+    for (uint32_t j = 0; j < spanY; j++)
+        for (uint32_t i = 0; i < spanX; i++)
+            v = reduce(v, s.Load(src, int64_t(x) * 2 + i, int64_t(y) * 2 + j));
+    return v;
+}
+
+void Store(Pyramid& pyramid, int level, uint32_t x, uint32_t y, float v) {
+    if (level >= int(pyramid.size())) return;
+    Level& l = pyramid[level];
+    if (x < l.width && y < l.height) l.texels[size_t(y) * l.width + x] = v;
+}
+
+} // namespace
+
+Pyramid BuildConservative(const std::vector<float>& depth, uint32_t width, uint32_t height, bool reduceMin) {
+    Pyramid pyramid = AllocateLevels(width, height);
+    Source  s{depth, width, height, pyramid};
+    for (int level = 0; level < int(pyramid.size()); level++) {
+        Level& l = pyramid[level];
+        for (uint32_t y = 0; y < l.height; y++)
+            for (uint32_t x = 0; x < l.width; x++)
+                l.texels[size_t(y) * l.width + x] = ReduceFootprint(s, level, x, y, Reducer{reduceMin});
+    }
+    return pyramid;
+}
+
+Pyramid BuildSinglePass(const std::vector<float>& depth, uint32_t width, uint32_t height, bool reduceMin) {
+    Pyramid pyramid = AllocateLevels(width, height);
+    Source  s{depth, width, height, pyramid};
+    Reducer reduce{reduceMin};
+    const int mipCount = int(pyramid.size());
+
+    // ReduceBlock: one workgroup's tile, level by level
+    auto reduceBlock = [&](uint32_t ox, uint32_t oy, int baseMip) {
+        float tile[kBlock * kBlock];
+        for (uint32_t i = 0; i < kBlock * kBlock; i++) {
+            uint32_t px = ox + i % kBlock, py = oy + i / kBlock;
+            tile[i] = ReduceFootprint(s, baseMip, px, py, reduce);
+            Store(pyramid, baseMip, px, py, tile[i]);
+        }
+        for (int level = 1; level < 6; level++) {
+            const uint32_t size = kBlock >> level, row = size * 2;
+            const int      mip  = baseMip + level;
+            float next[kBlock * kBlock / 4];
+            for (uint32_t t = 0; t < size * size; t++) {
+                uint32_t lx = t % size, ly = t / size;
+                uint32_t gx = (ox >> level) + lx, gy = (oy >> level) + ly;
+                uint32_t i  = ly * 2 * row + lx * 2;
+                bool wideX = Wide(s.Width(mip - 1),  s.Width(mip),  gx) && lx * 2 + 2 < row;
+                bool wideY = Wide(s.Height(mip - 1), s.Height(mip), gy) && ly * 2 + 2 < row;
+                float v = reduce(reduce(tile[i], tile[i + 1]), reduce(tile[i + row], tile[i + row + 1]));
+                if (wideX)          v = reduce(v, reduce(tile[i + 2], tile[i + row + 2]));
+                if (wideY)          v = reduce(v, reduce(tile[i + 2 * row], tile[i + 2 * row + 1]));
+                if (wideX && wideY) v = reduce(v, tile[i + 2 * row + 2]);
+                next[t] = v;
+            }
+            for (uint32_t t = 0; t < size * size; t++) {
+                tile[t] = next[t];
+                Store(pyramid, mip, (ox >> level) + t % size, (oy >> level) + t / size, next[t]);
+            }
+        }
+    };
+
+    const uint32_t groupsX = (pyramid[0].width  + kBlock - 1) / kBlock;
+    const uint32_t groupsY = (pyramid[0].height + kBlock - 1) / kBlock;
+    for (uint32_t gy = 0; gy < groupsY; gy++)
+        for (uint32_t gx = 0; gx < groupsX; gx++)
+            reduceBlock(gx * kBlock, gy * kBlock, 0);
+
+    // FirstSplitMip, then FixEdges from there up to mip 5
+    int splitMip = 6;
+    for (int mip = 1; mip < std::min(6, mipCount) && splitMip == 6; mip++) {
+        uint32_t block = kBlock >> mip;
+        bool splitX = s.Width(mip - 1)  == 2 * s.Width(mip) + 1  && s.Width(mip)  % block == 0;
+        bool splitY = s.Height(mip - 1) == 2 * s.Height(mip) + 1 && s.Height(mip) % block == 0;
+        if (splitX || splitY) splitMip = mip;
+    }
+    for (int mip = splitMip; mip < std::min(6, mipCount); mip++) {
+        uint32_t w = s.Width(mip), h = s.Height(mip);
+        for (uint32_t i = 0; i < w + h - 1; i++) {
+            uint32_t x = i < h ? w - 1 : i - h;
+            uint32_t y = i < h ? i : h - 1;
+            Store(pyramid, mip, x, y, ReduceFootprint(s, mip, x, y, reduce));
+        }
+    }
+
+    if (mipCount > 6)
+        reduceBlock(0, 0, 6);
+    return pyramid;
+}
+
+Pyramid BuildPerMip(const std::vector<float>& depth, uint32_t width, uint32_t height, bool reduceMin) {
+    Pyramid pyramid = AllocateLevels(width, height);
+    Source  s{depth, width, height, pyramid};
+    Reducer reduce{reduceMin};
+
+    // First gathered texel: floor(u * S - 0.5) with u = (p + 0.5) / D, in integers
+    auto first = [](uint32_t p, uint32_t src, uint32_t dst) {
+        return int64_t((uint64_t(2 * p + 1) * src - dst) / (2 * uint64_t(dst)));
+    };
+    for (int level = 0; level < int(pyramid.size()); level++) {
+        Level& l = pyramid[level];
+        for (uint32_t y = 0; y < l.height; y++) {
+            int64_t y0 = first(y, s.Height(level - 1), l.height);
+            for (uint32_t x = 0; x < l.width; x++) {
+                int64_t x0 = first(x, s.Width(level - 1), l.width);
+                l.texels[size_t(y) * l.width + x] =
+                    reduce(reduce(s.Load(level - 1, x0, y0),     s.Load(level - 1, x0 + 1, y0)),
+                           reduce(s.Load(level - 1, x0, y0 + 1), s.Load(level - 1, x0 + 1, y0 + 1)));
+            }
+        }
+    }
+    return pyramid;
+}
+
+uint64_t CountNonConservative(const Pyramid& pyramid, const std::vector<float>& depth,
+                              uint32_t width, uint32_t height, bool reduceMin) {
+    uint64_t violations = 0;
+    for (uint32_t y = 0; y < height; y++) {
+        for (uint32_t x = 0; x < width; x++) {
+            float    d  = depth[size_t(y) * width + x];
+            uint32_t tx = x, ty = y;
+            for (const Level& l : pyramid) {
+                tx = std::min(tx / 2, l.width - 1);
+                ty = std::min(ty / 2, l.height - 1);
+                float t = l.At(tx, ty);
+                violations += reduceMin ? (t > d) : (t < d);
+            }
+        }
+    }
+    return violations;
+}
+
+uint64_t CountDifferences(const Pyramid& a, const Pyramid& b) {
+    uint64_t differences = 0;
+    for (size_t level = 0; level < std::min(a.size(), b.size()); level++)
+        for (size_t i = 0; i < std::min(a[level].texels.size(), b[level].texels.size()); i++)
+            differences += a[level].texels[i] != b[level].texels[i];
+    return differences;
+}
+
+} // namespace HiZReference
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// CPU models of the two Hi-Z builds, for the HiZ tests. Level 0 is Hi-Z mip 0: half the
+/// source size, rounded down like HiZBuffer, and each level halves the one below.
+///
+/// A source texel x reduces into texel min(x / 2, size - 1) of the next level, so the last
+/// texel of an odd axis owns 3 source texels. A pyramid is conservative when every texel
+/// bounds (max, or min for a nearest-depth pyramid) all depth texels that reduce into it.
+namespace HiZReference {
+
+struct Level {
+    uint32_t           width = 0, height = 0;
+    std::vector<float> texels;
+
+    float At(uint32_t x, uint32_t y) const { return texels[size_t(y) * width + x]; }
+};
+using Pyramid = std::vector<Level>;
+
+/// Each level reduced from the one below with the footprints above: the intended result.
+Pyramid BuildConservative(const std::vector<float>& depth, uint32_t width, uint32_t height, bool reduceMin);
+
+/// hiz_spd.comp as dispatched: 32x32 blocks of mip 0 reduced through a shared tile down
+/// to mip 5, the last group's edge fix-up, then mips 6 and up from mip 5.
+Pyramid BuildSinglePass(const std::vector<float>& depth, uint32_t width, uint32_t height, bool reduceMin);
+
+/// hiz_reduce.comp: the 2x2 textureGather footprint around uv = (p + 0.5) / size, taken
+/// from the level below. For an odd source that footprint slides by one texel across the
+/// level instead of widening at its end.
+Pyramid BuildPerMip(const std::vector<float>& depth, uint32_t width, uint32_t height, bool reduceMin);
+
+/// Depth texels, summed over levels, that the texel they reduce into does not bound.
+uint64_t CountNonConservative(const Pyramid& pyramid, const std::vector<float>& depth,
+                              uint32_t width, uint32_t height, bool reduceMin);
+
+/// Texels that differ between two pyramids of the same source size.
+uint64_t CountDifferences(const Pyramid& a, const Pyramid& b);
+
+} // namespace HiZReference
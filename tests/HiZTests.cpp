@@ -0,0 +1,59 @@
+#include "Test.h"
+#include "HiZReference.h"
+
+#include <random>
+
+namespace {
+
+// Full HD, an odd-sized window, odd on both axes and a single row
+constexpr uint32_t kSizes[][2] = {{1920, 1080}, {1366, 768}, {100, 37}, {333, 1}};
+
+std::vector<float> RandomDepth(uint32_t w, uint32_t h) {
+    std::vector<float> depth(size_t(w) * h);
+    std::mt19937 rng(w * 31 + h);
+    std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+    for (float& d : depth) d = dist(rng);
+    return depth;
+}
+
+} // namespace
+
+TEST_CASE(HiZ, SinglePassMatchesConservative) {
+    for (const auto& size : kSizes) {
+        const uint32_t w = size[0], h = size[1];
+        std::vector<float> depth = RandomDepth(w, h);
+        for (bool reduceMin : {false, true}) {
+            auto reference  = HiZReference::BuildConservative(depth, w, h, reduceMin);
+            auto singlePass = HiZReference::BuildSinglePass(depth, w, h, reduceMin);
+            CHECK(singlePass.size() == reference.size());
+            CHECK(HiZReference::CountDifferences(singlePass, reference) == 0);
+            CHECK(HiZReference::CountNonConservative(singlePass, depth, w, h, reduceMin) == 0);
+        }
+    }
+}
+
+TEST_CASE(HiZ, ReferenceIsConservative) {
+    for (const auto& size : kSizes) {
+        const uint32_t w = size[0], h = size[1];
+        std::vector<float> depth = RandomDepth(w, h);
+        for (bool reduceMin : {false, true})
+            CHECK(HiZReference::CountNonConservative(HiZReference::BuildConservative(depth, w, h, reduceMin),
+                                                     depth, w, h, reduceMin) == 0);
+    }
+}
+
+TEST_CASE(HiZ, PerMipSlidesAtOddSizes) {
+    // The per-mip gather footprint drops the last texel of an odd level; at power-of-two
+    // sizes it covers the same texels as the reference
+    std::vector<float> odd = RandomDepth(100, 37);
+    auto perMip = HiZReference::BuildPerMip(odd, 100, 37, false);
+    uint64_t unbounded = HiZReference::CountNonConservative(perMip, odd, 100, 37, false);
+    std::printf("    per mip at 100x37: %llu unbounded depth texels\n", static_cast<unsigned long long>(unbounded));
+    CHECK(unbounded > 0);
+
+    std::vector<float> even = RandomDepth(1024, 512);
+    for (bool reduceMin : {false, true}) {
+        auto reference = HiZReference::BuildConservative(even, 1024, 512, reduceMin);
+        CHECK(HiZReference::CountDifferences(HiZReference::BuildPerMip(even, 1024, 512, reduceMin), reference) == 0);
+    }
+}
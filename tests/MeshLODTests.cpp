@@ -0,0 +1,79 @@
+#include "Test.h"
+#include "Fixtures.h"
+
+#include "Asset/MeshSimplifier.h"
+#include "Core/ThreadPool.h"
+
+#include <algorithm>
+
+namespace {
+
+constexpr uint32_t kSegments[] = {32, 128, 512};
+
+bool SameLODs(const MeshData& a, const MeshData& b) {
+    if (a.lods.size() != b.lods.size()) return false;
+    for (size_t i = 0; i < a.lods.size(); i++)
+        if (a.lods[i].indices != b.lods[i].indices || a.lods[i].error != b.lods[i].error) return false;
+    return true;
+}
+
+} // namespace
+
+TEST_CASE(MeshLOD, Deterministic) {
+    for (uint32_t seg : kSegments) {
+        MeshData mesh  = Fixtures::BuildUVSphere(seg);
+        MeshData again = mesh;
+        MeshSimplifier::BuildLODChain(mesh);
+        MeshSimplifier::BuildLODChain(again);
+        CHECK(!mesh.lods.empty());
+        CHECK(SameLODs(mesh, again));
+    }
+}
+
+TEST_CASE(MeshLOD, Monotonic) {
+    // Every level has fewer triangles and no smaller error than the one before it, and
+    // indexes the mesh's own vertices
+    for (uint32_t seg : kSegments) {
+        MeshData mesh = Fixtures::BuildUVSphere(seg);
+        MeshSimplifier::BuildLODChain(mesh);
+        CHECK(mesh.lods.size() <= MeshSimplifier::MAX_LODS - 1);
+
+        size_t prevTris  = mesh.indices.size() / 3;
+        float  prevError = 0.0f;
+        std::printf("    %zu", prevTris);
+        for (const MeshLODData& lod : mesh.lods) {
+            size_t tris = lod.indices.size() / 3;
+            std::printf(" -> %zu (%.4f)", tris, lod.error);
+            CHECK(lod.indices.size() % 3 == 0);
+            CHECK(tris > 0 && tris < prevTris);
+            CHECK(lod.error >= prevError);
+            CHECK(*std::max_element(lod.indices.begin(), lod.indices.end()) < mesh.vertices.size());
+            prevTris  = tris;
+            prevError = lod.error;
+        }
+        std::printf("\n");
+    }
+}
+
+TEST_CASE(MeshLOD, SmallMeshGetsNoLODs) {
+    MeshData box = Fixtures::BuildBox(glm::vec3(-1.0f), glm::vec3(1.0f));
+    CHECK(box.indices.size() / 3 < MeshSimplifier::MIN_TRIANGLES);
+    MeshSimplifier::BuildLODChain(box);
+    CHECK(box.lods.empty());
+}
+
+TEST_CASE(MeshLOD, ThreadPoolMatchesSerial) {
+    std::vector<MeshData> serial;
+    for (uint32_t seg : kSegments) serial.push_back(Fixtures::BuildUVSphere(seg));
+    serial.push_back(Fixtures::BuildBox(glm::vec3(-1.0f), glm::vec3(1.0f)));
+    std::vector<MeshData> parallel = serial;
+
+    ThreadPool pool;
+    pool.Initialize(4);
+    MeshSimplifier::GenerateLODs(serial, nullptr);
+    MeshSimplifier::GenerateLODs(parallel, &pool);
+    pool.Shutdown();
+
+    for (size_t i = 0; i < serial.size(); i++)
+        CHECK(SameLODs(serial[i], parallel[i]));
+}
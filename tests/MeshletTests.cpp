@@ -0,0 +1,96 @@
+#include "Test.h"
+#include "Fixtures.h"
+
+#include "Asset/MeshletBuilder.h"
+
+#include <random>
+
+namespace {
+
+// Builds meshlets and checks the split: contiguous, within the limits, every triangle
+// once, and every view the cone test rejects sees no front-facing triangle
+MeshletStats BuildAndCheck(const MeshData& mesh) {
+    std::vector<Meshlet> meshlets;
+    MeshletStats stats;
+    MeshletBuilder::Build(mesh, meshlets, stats);
+
+    uint32_t next = 0;
+    MeshletConeCheck check;
+    for (const Meshlet& m : meshlets) {
+        CHECK(m.firstTriangle == next);
+        CHECK(m.triangleCount > 0 && m.triangleCount <= MeshletBuilder::MAX_TRIANGLES);
+        CHECK(m.vertexCount > 0 && m.vertexCount <= MeshletBuilder::MAX_VERTICES);
+        next += m.triangleCount;
+
+        MeshletConeCheck mc = MeshletBuilder::ValidateCone(mesh, m);
+        check.views      += mc.views;
+        check.violations += mc.violations;
+    }
+    CHECK(next == mesh.indices.size() / 3);
+    CHECK(stats.meshlets == meshlets.size());
+
+    std::printf("    %llu meshlets, %llu with cones, %llu views rejected, %llu bad\n",
+                static_cast<unsigned long long>(stats.meshlets),
+                static_cast<unsigned long long>(stats.coneCullable),
+                static_cast<unsigned long long>(check.views),
+                static_cast<unsigned long long>(check.violations));
+    CHECK(check.violations == 0);
+    // A usable cone must reject at least its own axis view, or the probe tested nothing
+    CHECK(stats.coneCullable == 0 || check.views > 0);
+    return stats;
+}
+
+} // namespace
+
+TEST_CASE(Meshlet, UVSphere) {
+    MeshletStats stats = BuildAndCheck(Fixtures::BuildUVSphere(128));
+    CHECK(stats.coneCullable > 0);
+}
+
+TEST_CASE(Meshlet, NoisySphere) {
+    // Radial noise tilts neighbouring normals apart, so cones are wide but still usable
+    MeshData mesh = Fixtures::BuildUVSphere(128);
+    std::mt19937 rng(30);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    for (MeshVertex& v : mesh.vertices)
+        v.position *= 1.0f + 0.05f * unit(rng);
+    MeshletStats stats = BuildAndCheck(mesh);
+    CHECK(stats.coneCullable > 0);
+}
+
+TEST_CASE(Meshlet, Plane) {
+    // Coplanar triangles: the tightest cone, apex at the plane
+    constexpr uint32_t kGrid = 64;
+    MeshData plane;
+    for (uint32_t y = 0; y <= kGrid; y++) {
+        for (uint32_t x = 0; x <= kGrid; x++) {
+            MeshVertex v{};
+            v.position = glm::vec3(static_cast<float>(x), 0.0f, static_cast<float>(y)) / float(kGrid);
+            v.normal   = glm::vec3(0.0f, 1.0f, 0.0f);
+            plane.vertices.push_back(v);
+        }
+    }
+    for (uint32_t y = 0; y < kGrid; y++) {
+        for (uint32_t x = 0; x < kGrid; x++) {
+            uint32_t a = y * (kGrid + 1) + x, b = a + kGrid + 1;
+            plane.indices.insert(plane.indices.end(), {a, b, a + 1, a + 1, b, b + 1});
+        }
+    }
+    MeshletStats stats = BuildAndCheck(plane);
+    CHECK(stats.coneCullable == stats.meshlets);
+}
+
+TEST_CASE(Meshlet, TriangleSoup) {
+    // Triangles facing every way: no normal cone fits, so the cone test stays disabled
+    std::mt19937 rng(31);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    MeshData soup;
+    for (uint32_t i = 0; i < 30000; i++) {
+        MeshVertex v{};
+        v.position = glm::vec3(unit(rng), unit(rng), unit(rng));
+        soup.vertices.push_back(v);
+        soup.indices.push_back(i);
+    }
+    MeshletStats stats = BuildAndCheck(soup);
+    CHECK(stats.coneCullable == 0);
+}
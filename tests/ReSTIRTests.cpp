@@ -0,0 +1,143 @@
+#include "Test.h"
+#include "Fixtures.h"
+
+#include "RayTracing/ReSTIR.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+// Estimates of the integral of f(x) = x^2 + 0.1 over [0, 1) with the target p-hat(x) =
+// x + 0.05, shaped like f but not equal
+constexpr uint32_t kTrials   = 20000;
+constexpr double   kIntegral = 1.0 / 3.0 + 0.1;
+
+float F(float x)      { return x * x + 0.1f; }
+float Target(float x) { return x + 0.05f; }
+
+struct Sampler {
+    std::mt19937 rng{1234};
+    std::uniform_real_distribution<float> uniform{0.0f, 1.0f};
+
+    // Streams count candidates from the uniform (pdf 1) or linear (pdf 2x) source
+    void Stream(ReSTIR::Reservoir& r, uint32_t count, bool linear) {
+        for (uint32_t i = 0; i < count; i++) {
+            float x   = linear ? std::sqrt(uniform(rng)) : uniform(rng);
+            float pdf = linear ? 2.0f * x : 1.0f;
+            ReSTIR::Update(r, i, glm::vec2(x, 0.0f), Target(x), pdf, uniform(rng));
+        }
+    }
+};
+
+// Mean of the estimates against the integral, within 4 standard errors
+void CheckUnbiased(const std::vector<double>& estimates) {
+    double sum = 0.0, sumSq = 0.0;
+    for (double e : estimates) { sum += e; sumSq += e * e; }
+    double n      = double(estimates.size());
+    double mean   = sum / n;
+    double stdErr = std::sqrt(std::max(sumSq / n - mean * mean, 0.0) / n);
+    std::printf("    %.5f vs %.5f (+-%.5f)\n", mean, kIntegral, stdErr);
+    CHECK(std::abs(mean - kIntegral) <= 4.0 * stdErr);
+}
+
+void CheckRIS(bool linear) {
+    Sampler s;
+    std::vector<double> estimates(kTrials);
+    for (double& e : estimates) {
+        ReSTIR::Reservoir r;
+        s.Stream(r, 8, linear);
+        ReSTIR::Finalize(r);
+        e = F(r.uv.x) * r.weight;
+    }
+    CheckUnbiased(estimates);
+}
+
+} // namespace
+
+TEST_CASE(ReSTIR, RISUniformPdf) { CheckRIS(false); }
+
+TEST_CASE(ReSTIR, RISLinearPdf) { CheckRIS(true); }
+
+TEST_CASE(ReSTIR, MergeCarriesWSum) {
+    // Four finalized reservoirs merged at the same surface: each one's wSum comes back as
+    // p-hat * W * M, so the merged wSum is their sum
+    Sampler s;
+    std::vector<double> estimates(kTrials);
+    double worstRel = 0.0;
+    for (double& e : estimates) {
+        ReSTIR::Reservoir merged;
+        double wSum = 0.0;
+        for (int k = 0; k < 4; k++) {
+            ReSTIR::Reservoir r;
+            s.Stream(r, 8, k & 1);
+            wSum += r.weight;
+            ReSTIR::Finalize(r);
+            ReSTIR::Merge(merged, r, r.targetPdf, s.uniform(s.rng));
+        }
+        worstRel = std::max(worstRel, std::abs(merged.weight - wSum) / std::max(wSum, 1e-30));
+        ReSTIR::Finalize(merged);
+        e = F(merged.uv.x) * merged.weight;
+    }
+    std::printf("    wSum off by %.1e\n", worstRel);
+    CHECK(worstRel < 1e-5);
+    CheckUnbiased(estimates);
+}
+
+TEST_CASE(ReSTIR, HistoryClamp) {
+    // A long history clamped to kMaxHistory times the 4 new candidates, as the initial pass does
+    Sampler s;
+    std::vector<double> estimates(kTrials);
+    bool clamped = true;
+    for (double& e : estimates) {
+        ReSTIR::Reservoir history;
+        s.Stream(history, 200, false);
+        ReSTIR::Finalize(history);
+        ReSTIR::Reservoir r;
+        s.Stream(r, 4, true);
+        ReSTIR::ClampHistory(history, r.M);
+        clamped &= history.M == ReSTIR::kMaxHistory * 4.0f;
+        ReSTIR::Merge(r, history, history.targetPdf, s.uniform(s.rng));
+        ReSTIR::Finalize(r);
+        e = F(r.uv.x) * r.weight;
+    }
+    CHECK(clamped);
+    CheckUnbiased(estimates);
+}
+
+TEST_CASE(ReSTIR, EmptyReservoir) {
+    // Nothing selectable: zero target, zero source pdf, no candidates at all
+    Sampler s;
+    ReSTIR::Reservoir zeroTarget, zeroSource, none, merged;
+    for (uint32_t i = 0; i < 8; i++) {
+        ReSTIR::Update(zeroTarget, i, glm::vec2(0.5f), 0.0f, 1.0f, s.uniform(s.rng));
+        ReSTIR::Update(zeroSource, i, glm::vec2(0.5f), 1.0f, 0.0f, s.uniform(s.rng));
+    }
+    ReSTIR::Finalize(zeroTarget);
+    ReSTIR::Finalize(zeroSource);
+    ReSTIR::Finalize(none);
+    ReSTIR::Merge(merged, zeroTarget, 1.0f, 0.0f);
+    ReSTIR::Merge(merged, none, 1.0f, 0.0f);
+    ReSTIR::Finalize(merged);
+    for (const ReSTIR::Reservoir* r : {&zeroTarget, &zeroSource, &none, &merged}) {
+        CHECK(r->weight == 0.0f);
+        CHECK(r->light == ReSTIR::kLightNone);
+    }
+}
+
+TEST_CASE(ReSTIR, NormalPacking) {
+    // Fibonacci sphere plus the axes and diagonals, where the octahedral fold is
+    constexpr double kNormalBoundDeg = 0.005;
+    std::vector<glm::vec3> normals = Fixtures::FibonacciSphere(100000);
+    for (int x = -1; x <= 1; x++)
+        for (int y = -1; y <= 1; y++)
+            for (int z = -1; z <= 1; z++)
+                if (x || y || z) normals.push_back(glm::normalize(glm::vec3(float(x), float(y), float(z))));
+
+    double worstDeg = 0.0;
+    for (const glm::vec3& n : normals)
+        worstDeg = std::max(worstDeg, Fixtures::AngleDeg(n, ReSTIR::UnpackNormal(ReSTIR::PackNormal(n))));
+    std::printf("    max %.4f deg over %zu normals\n", worstDeg, normals.size());
+    CHECK(worstDeg <= kNormalBoundDeg);
+}
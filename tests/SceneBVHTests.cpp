@@ -0,0 +1,182 @@
+#include "Test.h"
+#include "Fixtures.h"
+
+#include "Culling/SceneBVH.h"
+
+#include <cmath>
+#include <random>
+
+namespace {
+
+// Boxes of 0.5-2 units over a 100x25x100 block, about the benchmark's density
+std::vector<AABB> BuildField(uint32_t count, std::mt19937& rng) {
+    std::uniform_real_distribution<float> pos(-50.0f, 50.0f), size(0.25f, 1.0f);
+    std::vector<AABB> boxes(count);
+    for (auto& b : boxes) {
+        glm::vec3 c(pos(rng), pos(rng) * 0.25f, pos(rng));
+        glm::vec3 h(size(rng), size(rng), size(rng));
+        b.min = c - h;
+        b.max = c + h;
+    }
+    return boxes;
+}
+
+// Volume 0: a camera turning on the spot. Volume 1: a narrow view from above, standing
+// in for a shadow caster volume, so entities can touch either, both or neither.
+CullVolumes QueryVolumes(uint32_t q) {
+    float a = 0.39269908f * static_cast<float>(q);
+    glm::vec3 eye(0.0f, 2.0f, 0.0f);
+    glm::vec4 planes[6];
+    CullVolumes volumes;
+    Fixtures::FrustumPlanes(Fixtures::ViewProjection(eye, eye + glm::vec3(std::cos(a), -0.1f, std::sin(a)),
+                                                     16.0f / 9.0f), planes);
+    volumes.Set(0, planes, 6);
+    Fixtures::FrustumPlanes(Fixtures::ViewProjection(glm::vec3(20.0f * std::sin(a), 60.0f, 0.0f),
+                                                     glm::vec3(20.0f * std::sin(a), 0.0f, 0.1f), 1.0f, 20.0f), planes);
+    volumes.Set(1, planes, 6);
+    return volumes;
+}
+
+// Tree, SSE and scalar linear masks agree over 16 queries; returns the visible total
+uint64_t CheckAgainstLinear(SceneBVH& bvh) {
+    std::vector<uint8_t> tree, sse, scalar;
+    uint64_t visible = 0;
+    for (uint32_t q = 0; q < 16; q++) {
+        CullVolumes volumes = QueryVolumes(q);
+        uint32_t treeCount   = bvh.Cull(volumes, tree);
+        uint32_t sseCount    = bvh.CullLinear(volumes, sse, true);
+        uint32_t scalarCount = bvh.CullLinear(volumes, scalar, false);
+        CHECK(tree == sse);
+        CHECK(sse == scalar);
+        CHECK(treeCount == sseCount && sseCount == scalarCount);
+        visible += treeCount;
+    }
+    return visible;
+}
+
+} // namespace
+
+TEST_CASE(SceneBVH, TreeMatchesLinear) {
+    std::mt19937 rng(1234);
+    std::vector<AABB> boxes = BuildField(20000, rng);
+    SceneBVH bvh;
+    for (Entity e = 0; e < boxes.size(); e++)
+        bvh.Insert(e, boxes[e]);
+
+    CHECK(bvh.GetLeafCount() == boxes.size());
+    // AVL rotations keep the tree within a small factor of log2(20000) ~ 14.3
+    CHECK(bvh.GetHeight() <= 30);
+    uint64_t visible = CheckAgainstLinear(bvh);
+    CHECK(visible > 0 && visible < uint64_t(boxes.size()) * 16);
+}
+
+TEST_CASE(SceneBVH, MatchesLinearAfterUpdates) {
+    std::mt19937 rng(1235);
+    std::vector<AABB> boxes = BuildField(20000, rng);
+    SceneBVH bvh;
+    for (Entity e = 0; e < boxes.size(); e++)
+        bvh.Insert(e, boxes[e]);
+    CheckAgainstLinear(bvh);
+
+    // Small moves stay inside the fat bounds, large ones reinsert, some leaves go away
+    std::uniform_real_distribution<float> jitter(-0.05f, 0.05f), jump(-40.0f, 40.0f);
+    for (uint32_t i = 0; i < 2000; i++) {
+        Entity e = static_cast<Entity>(rng() % boxes.size());
+        glm::vec3 d = (i % 10 == 0) ? glm::vec3(jump(rng), 0.0f, jump(rng))
+                                    : glm::vec3(jitter(rng), jitter(rng), jitter(rng));
+        boxes[e].min += d;
+        boxes[e].max += d;
+        bvh.Update(e, boxes[e]);
+    }
+    for (Entity e = 0; e < boxes.size(); e += 20)
+        bvh.Remove(e);
+
+    CHECK(bvh.GetStats().refitted > 0);
+    CHECK(bvh.GetStats().reinserted > 0);
+    CHECK(bvh.GetLeafCount() == boxes.size() - boxes.size() / 20);
+    CheckAgainstLinear(bvh);
+
+    std::vector<uint8_t> masks;
+    for (uint32_t q = 0; q < 16; q++) {
+        bvh.Cull(QueryVolumes(q), masks);
+        for (Entity e = 0; e < boxes.size(); e += 20)
+            CHECK(e >= masks.size() || masks[e] == 0);
+    }
+}
+
+TEST_CASE(SceneBVH, MaskBitPerVolume) {
+    // Two 10-unit cubes side by side, split at x = 0
+    const glm::vec4 left[6] = {
+        {-1.0f, 0.0f, 0.0f,  0.0f}, { 1.0f, 0.0f, 0.0f, 10.0f},
+        { 0.0f, 1.0f, 0.0f,  5.0f}, { 0.0f,-1.0f, 0.0f,  5.0f},
+        { 0.0f, 0.0f, 1.0f,  5.0f}, { 0.0f, 0.0f,-1.0f,  5.0f},
+    };
+    const glm::vec4 right[6] = {
+        { 1.0f, 0.0f, 0.0f,  0.0f}, {-1.0f, 0.0f, 0.0f, 10.0f},
+        { 0.0f, 1.0f, 0.0f,  5.0f}, { 0.0f,-1.0f, 0.0f,  5.0f},
+        { 0.0f, 0.0f, 1.0f,  5.0f}, { 0.0f, 0.0f,-1.0f,  5.0f},
+    };
+    CullVolumes volumes;
+    volumes.Set(0, left, 6);
+    volumes.Set(1, right, 6);
+
+    SceneBVH bvh;
+    bvh.Insert(0, AABB{glm::vec3(-3.0f), glm::vec3(-2.0f)});                               // left only
+    bvh.Insert(1, AABB{glm::vec3(2.0f), glm::vec3(3.0f)});                                 // right only
+    bvh.Insert(2, AABB{glm::vec3(-1.0f), glm::vec3(1.0f)});                                // both
+    bvh.Insert(3, AABB{glm::vec3(20.0f, 0.0f, 0.0f), glm::vec3(21.0f, 1.0f, 1.0f)});        // neither
+
+    std::vector<uint8_t> masks;
+    CHECK(bvh.Cull(volumes, masks) == 3);
+    CHECK(masks.size() >= 4);
+    CHECK(masks[0] == 1);
+    CHECK(masks[1] == 2);
+    CHECK(masks[2] == 3);
+    CHECK(masks[3] == 0);
+}
+
+TEST_CASE(SceneBVH, SyncFollowsRegistry) {
+    Registry registry;
+    std::vector<MeshDrawCommand> drawCmds(1);
+    drawCmds[0].bounds = AABB{glm::vec3(-0.5f), glm::vec3(0.5f)};
+
+    std::vector<Entity> entities;
+    for (int i = 0; i < 64; i++) {
+        Entity e = registry.CreateEntity();
+        registry.AddTransform(e).worldMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(float(i % 8) * 3.0f, 0.0f, float(i / 8) * 3.0f));
+        registry.AddMesh(e).meshIndex = 0;
+        registry.AddMaterial(e).materialIndex = 0;
+        entities.push_back(e);
+    }
+
+    SceneBVH bvh;
+    bvh.Sync(registry, drawCmds);
+    CHECK(bvh.GetLeafCount() == 64);
+    CHECK(bvh.GetStats().inserted == 64);
+
+    // Nothing changed: the second sync touches no leaf
+    bvh.Sync(registry, drawCmds);
+    CHECK(bvh.GetStats().inserted == 64);
+    CHECK(bvh.GetStats().refitted + bvh.GetStats().reinserted == 0);
+
+    // One entity far away, one destroyed
+    registry.GetTransform(entities[0])->worldMatrix = glm::translate(glm::mat4(1.0f), glm::vec3(500.0f));
+    registry.DestroyEntity(entities[1]);
+    bvh.Sync(registry, drawCmds);
+    CHECK(bvh.GetLeafCount() == 63);
+    CHECK(bvh.GetStats().reinserted == 1);
+    CHECK(bvh.GetStats().removed == 1);
+
+    // A box around the original grid sees every entity but the moved and destroyed ones
+    glm::vec4 planes[6] = {
+        { 1.0f, 0.0f, 0.0f,  1.0f}, {-1.0f, 0.0f, 0.0f, 25.0f},
+        { 0.0f, 1.0f, 0.0f,  1.0f}, { 0.0f,-1.0f, 0.0f,  1.0f},
+        { 0.0f, 0.0f, 1.0f,  1.0f}, { 0.0f, 0.0f,-1.0f, 25.0f},
+    };
+    CullVolumes volumes;
+    volumes.Set(0, planes, 6);
+    std::vector<uint8_t> masks;
+    CHECK(bvh.Cull(volumes, masks) == 62);
+    CHECK(masks[entities[0]] == 0);
+    CHECK(entities[1] >= masks.size() || masks[entities[1]] == 0);
+}
@@ -0,0 +1,214 @@
+#include "Test.h"
+#include "Fixtures.h"
+
+#include "Culling/SoftwareOcclusion.h"
+#include "Core/ThreadPool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+// Camera at the origin looking down -z. At 60 degrees and 2:1 a wall at z = -5 covers
+// |y| < 2.9 and |x| < 5.8 of the view.
+const glm::mat4 kViewProj = Fixtures::ViewProjection(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), 2.0f);
+
+struct Scene {
+    Registry                     registry;
+    std::vector<MeshData>        meshes;
+    std::vector<MeshDrawCommand> drawCmds;
+
+    Entity Add(const glm::vec3& min, const glm::vec3& max) {
+        meshes.push_back(Fixtures::BuildBox(min, max));
+        MeshDrawCommand cmd{};
+        cmd.bounds.Include(min);
+        cmd.bounds.Include(max);
+        drawCmds.push_back(cmd);
+
+        Entity e = registry.CreateEntity();
+        registry.AddTransform(e).worldMatrix = glm::mat4(1.0f);
+        registry.AddMesh(e).meshIndex        = static_cast<int>(meshes.size()) - 1;
+        registry.AddMaterial(e).materialIndex = 0;
+        return e;
+    }
+
+    // A 10x10 wall facing the camera, its front at z = -5
+    Entity AddWall() { return Add(glm::vec3(-5.0f, -5.0f, -5.2f), glm::vec3(5.0f, 5.0f, -5.0f)); }
+
+    void Cull(SoftwareOcclusion& culler, const glm::mat4& viewProj = kViewProj, ThreadPool* pool = nullptr) {
+        culler.SetMeshes(meshes);
+        culler.Cull(registry, drawCmds, viewProj, pool);
+    }
+};
+
+// Walls and boxes on a 60x60 ground, seen from eight cameras walking through it
+Scene BuildCity(uint32_t seed) {
+    Scene scene;
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> pos(-30.0f, 30.0f), size(0.2f, 1.5f), wall(2.0f, 8.0f);
+    for (int i = 0; i < 40; i++) {
+        glm::vec3 c(pos(rng), 0.0f, pos(rng));
+        glm::vec3 h = (i & 1) ? glm::vec3(wall(rng), wall(rng) * 0.5f, 0.2f)
+                              : glm::vec3(0.2f, wall(rng) * 0.5f, wall(rng));
+        scene.Add(c - h + glm::vec3(0.0f, h.y, 0.0f), c + h + glm::vec3(0.0f, h.y, 0.0f));
+    }
+    for (int i = 0; i < 2000; i++) {
+        glm::vec3 c(pos(rng), 0.0f, pos(rng));
+        glm::vec3 h(size(rng), size(rng), size(rng));
+        scene.Add(c - h + glm::vec3(0.0f, h.y, 0.0f), c + h + glm::vec3(0.0f, h.y, 0.0f));
+    }
+    return scene;
+}
+
+glm::mat4 CityCamera(uint32_t i) {
+    float a = 0.785398f * static_cast<float>(i);
+    glm::vec3 eye(20.0f * std::cos(a), 1.6f, 20.0f * std::sin(a));
+    return Fixtures::ViewProjection(eye, glm::vec3(0.0f, 1.0f, 0.0f), 2.0f);
+}
+
+} // namespace
+
+TEST_CASE(SoftwareOcclusion, WallHidesBoxBehindIt) {
+    Scene scene;
+    Entity wall = scene.AddWall();
+    Entity box  = scene.Add(glm::vec3(-0.5f, -0.5f, -11.0f), glm::vec3(0.5f, 0.5f, -10.0f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(culler.IsVisible(wall));
+    CHECK(!culler.IsVisible(box));
+    CHECK(culler.GetStats().occluders == 1);
+    CHECK(culler.GetStats().occlusionCulled == 1);
+    CHECK(culler.GetStats().frustumCulled == 0);
+}
+
+TEST_CASE(SoftwareOcclusion, KeepsBoxInFrontOfWall) {
+    Scene scene;
+    scene.AddWall();
+    Entity box = scene.Add(glm::vec3(-0.5f, -0.5f, -4.0f), glm::vec3(0.5f, 0.5f, -3.0f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(culler.IsVisible(box));
+    CHECK(culler.GetStats().occlusionCulled == 0);
+}
+
+TEST_CASE(SoftwareOcclusion, KeepsBoxPeekingPastWall) {
+    // The wall's right edge projects to x / -z = 1; the box straddles it at z = -10
+    Scene scene;
+    scene.AddWall();
+    Entity box = scene.Add(glm::vec3(9.5f, -0.5f, -10.5f), glm::vec3(10.5f, 0.5f, -9.5f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(culler.IsVisible(box));
+}
+
+TEST_CASE(SoftwareOcclusion, HidesBoxNearWallEdge) {
+    // Hidden, but its rect reaches a tile the wall only partly covers, so the per-pixel
+    // test decides rather than the tile's max depth
+    Scene scene;
+    scene.AddWall();
+    Entity box = scene.Add(glm::vec3(9.0f, -0.5f, -10.5f), glm::vec3(9.7f, 0.5f, -10.0f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(!culler.IsVisible(box));
+}
+
+TEST_CASE(SoftwareOcclusion, FrustumCullsBoxBehindCamera) {
+    Scene scene;
+    scene.AddWall();
+    Entity box = scene.Add(glm::vec3(-0.5f, -0.5f, 5.0f), glm::vec3(0.5f, 0.5f, 6.0f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(!culler.IsVisible(box));
+    CHECK(culler.GetStats().frustumCulled == 1);
+    CHECK(culler.GetStats().occlusionCulled == 0);
+}
+
+TEST_CASE(SoftwareOcclusion, KeepsBoxAcrossNearPlane) {
+    // Bounds around the camera have no screen rect: never occlusion-culled, while the
+    // wall still hides what is behind it
+    Scene scene;
+    scene.AddWall();
+    Entity around = scene.Add(glm::vec3(-1.0f), glm::vec3(1.0f));
+    Entity hidden = scene.Add(glm::vec3(-0.5f, -0.5f, -11.0f), glm::vec3(0.5f, 0.5f, -10.0f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(culler.IsVisible(around));
+    CHECK(!culler.IsVisible(hidden));
+}
+
+TEST_CASE(SoftwareOcclusion, SmallObjectsDoNotOcclude) {
+    // Below minOccluderArea nothing is rasterized, so nothing is occlusion-culled
+    Scene scene;
+    scene.Add(glm::vec3(-0.1f, -0.1f, -5.1f), glm::vec3(0.1f, 0.1f, -5.0f));
+    Entity box = scene.Add(glm::vec3(-0.01f, -0.01f, -11.0f), glm::vec3(0.01f, 0.01f, -10.0f));
+
+    SoftwareOcclusion culler;
+    culler.Initialize();
+    scene.Cull(culler);
+
+    CHECK(culler.IsVisible(box));
+    CHECK(culler.GetStats().occluders == 0);
+}
+
+TEST_CASE(SoftwareOcclusion, ThreadPoolMatchesSerial) {
+    Scene scene = BuildCity(34);
+    ThreadPool pool;
+    pool.Initialize(4);
+
+    SoftwareOcclusion serial, parallel;
+    serial.Initialize();
+    parallel.Initialize();
+    for (uint32_t i = 0; i < 8; i++) {
+        scene.Cull(serial, CityCamera(i));
+        scene.Cull(parallel, CityCamera(i), &pool);
+        CHECK(serial.GetVisibility() == parallel.GetVisibility());
+        CHECK(std::equal(serial.GetDepth(), serial.GetDepth() + serial.GetWidth() * serial.GetHeight(),
+                         parallel.GetDepth()));
+    }
+    uint64_t occluded = serial.GetStats().occlusionCulled;
+    std::printf("    %llu of %llu objects occlusion-culled over 8 cameras\n",
+                static_cast<unsigned long long>(occluded),
+                static_cast<unsigned long long>(serial.GetStats().objects));
+    CHECK(occluded > 0);
+    pool.Shutdown();
+}
+
+TEST_CASE(SoftwareOcclusion, AVX2MatchesScalar) {
+    SoftwareOcclusion simd, scalar;
+    simd.Initialize();
+    scalar.Initialize();
+    scalar.GetSettings().allowAVX2 = false;
+    if (!simd.UsesAVX2()) {
+        std::printf("    no AVX2 on this CPU, nothing to compare\n");
+        return;
+    }
+    CHECK(!scalar.UsesAVX2());
+
+    Scene scene = BuildCity(35);
+    for (uint32_t i = 0; i < 8; i++) {
+        scene.Cull(simd, CityCamera(i));
+        scene.Cull(scalar, CityCamera(i));
+        CHECK(simd.GetVisibility() == scalar.GetVisibility());
+        CHECK(std::equal(simd.GetDepth(), simd.GetDepth() + simd.GetWidth() * simd.GetHeight(),
+                         scalar.GetDepth()));
+    }
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdio>
+
+/// Minimal test registry for VulkanRenderVBTests, the CPU test executable. Nothing it
+/// links needs a GPU, a window or a Vulkan device. Cases belong to a group; ctest runs
+/// one group per test (see CMakeLists.txt), the executable alone runs them all.
+namespace Test {
+
+using Fn = void (*)();
+
+/// Adds a case at static initialization; TEST_CASE does this.
+bool Register(const char* group, const char* name, Fn fn);
+
+/// Counts a failed CHECK against the running case and prints where it was.
+void Fail(const char* file, int line, const char* expr);
+
+} // namespace Test
+
+#define TEST_CASE(group, name)                                                       \
+    static void group##_##name();                                                    \
+    static const bool group##_##name##Registered = Test::Register(#group, #name,     \
+                                                                  group##_##name);   \
+    static void group##_##name()
+
+#define CHECK(expr)                                                 \
+    do {                                                            \
+        if (!(expr)) Test::Fail(__FILE__, __LINE__, #expr);         \
+    } while (0)
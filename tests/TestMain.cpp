@@ -0,0 +1,59 @@
+#include "Test.h"
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Test {
+namespace {
+
+struct Case {
+    const char* group;
+    const char* name;
+    Fn          fn;
+};
+
+std::vector<Case>& Cases() {
+    static std::vector<Case> cases;
+    return cases;
+}
+
+uint32_t gFailedChecks = 0;
+
+} // namespace
+
+bool Register(const char* group, const char* name, Fn fn) {
+    Cases().push_back({group, name, fn});
+    return true;
+}
+
+void Fail(const char* file, int line, const char* expr) {
+    std::printf("    %s:%d: CHECK(%s) failed\n", file, line, expr);
+    gFailedChecks++;
+}
+
+} // namespace Test
+
+// Runs every case, or those of the groups named on the command line. A group that
+// matches nothing fails, so a renamed group does not pass silently under ctest.
+int main(int argc, char* argv[]) {
+    uint32_t run = 0, failed = 0;
+    for (const Test::Case& c : Test::Cases()) {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; i++)
+            selected |= std::strcmp(argv[i], c.group) == 0;
+        if (!selected) continue;
+
+        std::printf("[ RUN    ] %s.%s\n", c.group, c.name);
+        std::fflush(stdout);
+        uint32_t before = Test::gFailedChecks;
+        c.fn();
+        bool passed = Test::gFailedChecks == before;
+        std::printf("[ %s ] %s.%s\n", passed ? "    OK" : "FAILED", c.group, c.name);
+        run++;
+        failed += !passed;
+    }
+
+    std::printf("%u of %u cases passed\n", run - failed, run);
+    return (run == 0 || failed > 0) ? 1 : 0;
+}
@@ -0,0 +1,127 @@
+#include "Test.h"
+#include "Fixtures.h"
+
+#include "GPU/VertexFormat.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+namespace {
+
+MeshVertex Vertex(glm::vec3 p, glm::vec3 n, glm::vec3 t, float sign, glm::vec2 uv) {
+    MeshVertex v{};
+    v.position = p;
+    v.normal   = glm::normalize(n);
+    v.tangent  = glm::vec4(glm::normalize(t), sign);
+    v.texCoord = uv;
+    return v;
+}
+
+// Any direction not parallel to n
+glm::vec3 Perpendicular(glm::vec3 n) {
+    return glm::cross(n, std::abs(n.y) < 0.9f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f));
+}
+
+// Every vertex round-trips through PackMesh within the per-attribute bounds of
+// VertexPacking; an invalid `bounds` is taken from the positions
+void CheckRoundTrip(const std::vector<MeshVertex>& vertices, AABB bounds) {
+    if (!bounds.Valid())
+        for (const MeshVertex& v : vertices) bounds.Include(v.position);
+
+    std::vector<PackedVertex> packed;
+    VertexPackingStats        stats;
+    VertexPacking::PackMesh(vertices, bounds, packed, stats);
+    CHECK(packed.size() == vertices.size());
+
+    // Worst error as a fraction of its bound per attribute: at most 1 passes
+    glm::vec3 posBound = VertexPacking::PositionErrorBound(bounds);
+    double pos = 0.0, normal = 0.0, tangent = 0.0, uv = 0.0;
+    uint32_t signs = 0;
+    for (size_t i = 0; i < vertices.size(); i++) {
+        const MeshVertex& v = vertices[i];
+        MeshVertex        r = VertexPacking::Unpack(packed[i], bounds);
+        glm::vec3 d = glm::abs(r.position - v.position) / posBound;
+        pos     = std::max({pos, double(d.x), double(d.y), double(d.z)});
+        normal  = std::max(normal,  Fixtures::AngleDeg(v.normal, r.normal) / VertexPacking::kOctErrorBoundDeg);
+        tangent = std::max(tangent, Fixtures::AngleDeg(glm::vec3(v.tangent), glm::vec3(r.tangent)) / VertexPacking::kOctErrorBoundDeg);
+        for (int k = 0; k < 2; k++)
+            uv = std::max(uv, double(std::abs(r.texCoord[k] - v.texCoord[k]) / VertexPacking::UVErrorBound(v.texCoord[k])));
+        signs += (r.tangent.w < 0.0f) != (v.tangent.w < 0.0f);
+    }
+    std::printf("    %zu verts: pos %.2f, normal %.2f, tangent %.2f, uv %.2f of bound, %u sign flips\n",
+                vertices.size(), pos, normal, tangent, uv, signs);
+    CHECK(pos <= 1.0);
+    CHECK(normal <= 1.0);
+    CHECK(tangent <= 1.0);
+    CHECK(uv <= 1.0);
+    CHECK(signs == 0);
+}
+
+} // namespace
+
+TEST_CASE(VertexPacking, NormalSphere) {
+    // Off the origin: dense normals and tangents in every octant
+    std::vector<glm::vec3> dirs = Fixtures::FibonacciSphere(100000);
+    std::vector<MeshVertex> vertices;
+    for (uint32_t i = 0; i < dirs.size(); i++) {
+        const glm::vec3& n = dirs[i];
+        vertices.push_back(Vertex(glm::vec3(10.0f, -5.0f, 2.0f) + 3.0f * n, n, Perpendicular(n), (i & 1) ? -1.0f : 1.0f,
+                                  glm::vec2(std::atan2(n.y, n.x) / (2.0f * Fixtures::kPi) + 0.5f,
+                                            std::acos(n.z) / Fixtures::kPi)));
+    }
+    CheckRoundTrip(vertices, AABB{});
+}
+
+TEST_CASE(VertexPacking, AABBCorners) {
+    // Corners, edge midpoints and center of an uneven box far from the origin, with axis
+    // and diagonal normals on the octahedral folds
+    AABB bounds;
+    bounds.min = glm::vec3(-7.25f, 0.5f, 1000.0f);
+    bounds.max = glm::vec3(13.0f, 0.75f, 1024.5f);
+    std::vector<MeshVertex> vertices;
+    for (int i = 0; i < 27; i++) {
+        glm::vec3 f(float(i % 3), float(i / 3 % 3), float(i / 9));
+        glm::vec3 n = (i == 13) ? glm::vec3(0.0f, 0.0f, -1.0f) : f - 1.0f;
+        vertices.push_back(Vertex(bounds.min + f * 0.5f * bounds.Extent(), n, Perpendicular(glm::normalize(n)),
+                                  (i & 1) ? -1.0f : 1.0f, glm::vec2(f) * 0.5f));
+    }
+    CheckRoundTrip(vertices, bounds);
+}
+
+TEST_CASE(VertexPacking, FlatAABB) {
+    // A plane with no y extent
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<MeshVertex> vertices;
+    for (int i = 0; i < 1000; i++)
+        vertices.push_back(Vertex(glm::vec3(50.0f * u(rng), 2.5f, 0.25f * u(rng)), glm::vec3(0.0f, 1.0f, 0.0f),
+                                  glm::vec3(1.0f, 0.0f, 0.0f), 1.0f, glm::vec2(u(rng), u(rng))));
+    CheckRoundTrip(vertices, AABB{});
+}
+
+TEST_CASE(VertexPacking, PointAABB) {
+    // Every vertex on one point far from the origin
+    std::mt19937 rng(1235);
+    std::uniform_real_distribution<float> u(-1.0f, 1.0f);
+    std::vector<MeshVertex> vertices;
+    for (int i = 0; i < 1000; i++) {
+        glm::vec3 n(u(rng), u(rng), u(rng));
+        if (glm::dot(n, n) < 1e-4f) n = glm::vec3(0.0f, 1.0f, 0.0f);
+        vertices.push_back(Vertex(glm::vec3(-3.0f, 4.0f, 1e4f), n, Perpendicular(glm::normalize(n)),
+                                  u(rng) < 0.0f ? -1.0f : 1.0f, glm::vec2(0.5f)));
+    }
+    CheckRoundTrip(vertices, AABB{});
+}
+
+TEST_CASE(VertexPacking, LargeUVs) {
+    // Tiled and atlas coordinates up to the top of the half range, subnormals and zero
+    const float uvs[] = {0.0f, 1e-6f, -3e-5f, 0.1f, 1.0f / 3.0f, 1.0f, 7.77f, -123.456f,
+                         1000.3f, -2047.7f, 4096.5f, 30000.1f, -60000.0f, 65504.0f};
+    std::vector<MeshVertex> vertices;
+    for (float s : uvs)
+        for (float t : uvs)
+            vertices.push_back(Vertex(glm::vec3(s, t, 0.0f) * 1e-3f, glm::vec3(0.0f, 0.0f, 1.0f),
+                                      glm::vec3(1.0f, 0.0f, 0.0f), -1.0f, glm::vec2(s, t)));
+    CheckRoundTrip(vertices, AABB{});
+}